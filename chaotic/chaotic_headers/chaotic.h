@@ -30,6 +30,7 @@ The classes included are the following:
  Image dependencies:
   * Color						 B8G8R8A8 Color class used for all coloring in the library.
   * Image						 Image as array of colors, with convenient operators and file support.
+  * Colormap					 Lookup table color gradients to color plots by scalar values.
  
  The UI static classes:
   * Keyboard					 Static keyboard class to capture keyboard interaction events.
@@ -49,6 +50,7 @@ The classes included are the following:
   * Surface						 Drawable to plot all kinds of mathematical defined surfaces.
  
  Other library classes:
+  * ParticleSystem				 Structure of arrays particle engine that feeds Scatters.
   * iGManager					 Support class to incorporate ImGui into the windows (optional).
   * Timer						 Timer class used by the internals added for convenience (optional).
   * ChaoticError				 Error base class used by the library for any error occurred. (optional).
@@ -1289,7 +1291,7 @@ constexpr inline Color Color::Transparent	= Color(   0,   0,   0,   0);
 -----------------------------------------------------------------------------------------------------------
 This image class allows for easy image manipulation from your code. To create an image
 you can create one yourself by specifying the dimensions and the color of each pixel 
-or you can load them from your computer from raw bitmap files using the load() function.
+or you can load them from your computer from bitmap or PNG files using the load() function.
 
 To manipulate the image you can access the pixels directly via tha operator(row,col), or 
 via the pixels() function, the Color class is a BGRA color format class that stores the 
@@ -1300,16 +1302,50 @@ Then after some image manipulation, using the save() function you can store them
 your computer to your specified path, or in the 3D rendering library you can send it to the 
 GPU as textures for your renderings.
 
-To obtain raw bitmap files from your images I strongly suggest the use of ImageMagick, 
-a simple console command like: "> magick initial_image.*** -compress none image.bmp"
-will give you a raw bitmap of any image.
+Files with the .png extension are read and written as PNG, with a built in codec, and any 
+other path is treated as a bitmap and gets the .bmp extension. PNG files are usually several 
+times smaller than bitmaps, and loaded files are recognized by their contents too.
+
+Big images, like texture cubes, can be opened with map() instead. If the file is a 32 bit 
+top down bitmap its pixel array already has the layout of the image, so the file is memory 
+mapped and the pixels are used in place, without allocating or copying anything. Bitmaps 
+saved with BMP_TOP_DOWN enabled keep their pixels aligned to 64 bytes and can always be 
+mapped, other files are loaded normally.
+
+Pixel arrays are allocated aligned to 64 bytes, and images can be moved, so returning or 
+storing them does not copy the pixels. To pass a region of an image, or a color buffer owned 
+by someone else, without copying it, an ImageView can be used. Views are accepted by textures, 
+backgrounds, surfaces and the ToCube functions, and Image(view) makes an owning copy.
+
+Whole images can be added, multiplied, scaled, interpolated, blended or premultiplied at once
+with the bulk color operations, that process several pixels per instruction with SIMD across 
+the thread pool, many times faster than a loop of Color operators over the pixels.
+
+Textures that are drawn smaller than their size alias unless they have mip levels, a MipChain
+builds them from an image on the CPU, in linear light and across the thread pool, and can be 
+uploaded by textures. Backgrounds and surfaces build them when texture_mipmaps is enabled.
+
+A CompressedImage stores an image or a mip chain as BC1, BC3 or BC7 blocks, compressed on 
+the CPU across the thread pool. Textures upload the blocks as they are, using a quarter or 
+an eighth of the GPU memory, and they can be saved and loaded as DDS files to skip encoding.
+
+An ImageF stores four floats or half floats per pixel instead of bytes, to accumulate many 
+frames or densities without saturating. It is converted from images and back to them with
+tone mapping in SIMD across the thread pool, and can be uploaded as a float texture.
+
+To obtain PNG or raw bitmap files from your images I strongly suggest the use of ImageMagick, 
+a simple console command like: "> magick initial_image.*** image.png" will give you a PNG 
+file of any image, and "-compress none image.bmp" a raw bitmap.
 
 For information on how to install and use ImageMagick you can check https://imagemagick.org/
 -----------------------------------------------------------------------------------------------------------
 -----------------------------------------------------------------------------------------------------------
 */
 
-// Simple class for handling images, and storing and loading them as BMP files.
+// Non owning view of an image region, declared below.
+class ImageView;
+
+// Simple class for handling images, and storing and loading them as BMP or PNG files.
 class Image
 {
 private:
@@ -1320,9 +1356,14 @@ private:
 	unsigned width_	 = 0u;	// Stores the width of the image
 	unsigned height_ = 0u;	// Stores the height of the image
 
+	void* mapping_ = nullptr;	// Mapped file holding the pixels, if mapped
+
 	// Internal function to format strings for the templates
 	const char* internal_formatting(const char* fmt_filename, ...);
 
+	// Frees the pixels, or unmaps the file if the image is mapped
+	void release();
+
 public:
 	// Constructors/Destructors
 
@@ -1342,6 +1383,16 @@ public:
 	// Copies the other image.
 	Image& operator=(const Image& other);
 
+	// Takes the pixels of the other image, leaving it empty.
+	Image(Image&& other) noexcept;
+
+	// Takes the pixels of the other image, leaving it empty.
+	Image& operator=(Image&& other) noexcept;
+
+	// Copies the pixels of the view, which can be a region of another image or any
+	// external color buffer, into a new image.
+	Image(const ImageView& view);
+
 	// Stores a copy of the color pointer.
 	Image(Color* pixels, unsigned width, unsigned height);
 
@@ -1356,6 +1407,14 @@ public:
 
 	// File functions
 
+	// Compression level used by save() for PNG files, from 0, stored, to 9, smallest.
+	// Low levels are much faster and still several times smaller than bitmaps.
+	static inline unsigned PNG_COMPRESSION_LEVEL = 6u;
+
+	// Whether save() writes bitmaps top down, in the same row order as the image, 
+	// so that they can be opened in place by map(). Bottom up is the common layout.
+	static inline bool BMP_TOP_DOWN = false;
+
 	// Loads an image from the specified file path. Regular string formatting.
 	template<class Arg0, class ...Args>
 	bool load(const char* fmt_filename, Arg0 arg0, Args... args) { return load(internal_formatting(fmt_filename, arg0, args...)); }
@@ -1363,6 +1422,13 @@ public:
 	// Loads an image from the specified file path.
 	bool load(const char* filename);
 
+	// Maps the file specified and uses its pixels in place if it is a 32 bit top down 
+	// bitmap whose pixels start at a multiple of 64 bytes, otherwise it is loaded normally.
+	// A read only mapping must not be written to, check isReadOnly(), with copy on write 
+	// the pixels can be modified and the file remains unchanged.
+	// The file stays mapped until the image is reset, loaded again or destroyed.
+	bool map(const char* filename, bool copy_on_write = false);
+
 	// Saves the image to the specified file path. Regular string formatting.
 	template<class Arg0, class ...Args>
 	bool save(const char* fmt_filename, Arg0 arg0, Args... args) const { return save(internal_formatting(fmt_filename, arg0, args...)); }
@@ -1384,6 +1450,17 @@ public:
 	// Returns the image height.
 	inline unsigned height() const { return height_; }
 
+	// Returns whether the pixels live in a mapped file.
+	inline bool isMapped() const { return mapping_ != nullptr; }
+
+	// Returns whether the pixels live in a file mapped read only, that can not be modified.
+	// The bulk color operations refuse these images, and pixels() must not be written to.
+	bool isReadOnly() const;
+
+	// Returns a view of the specified region of the image, that must be inside it.
+	// The view is only valid while the image pixels are not reset or destroyed.
+	ImageView view(unsigned x, unsigned y, unsigned width, unsigned height) const;
+
 	// Accessors
 
 	// Returns a color reference to the specified pixel coordinates.
@@ -1393,6 +1470,107 @@ public:
 	// Returns a constant color reference to the specified pixel coordinates.
 	inline const Color& operator()(unsigned row, unsigned col) const 
 	{ return pixels_[row * width_ + col]; }
+
+	// Bulk color operations
+
+	// They process the whole image with SIMD instructions, several pixels at once, and the 
+	// rows are spread across the thread pool. Where a Color operator exists the results are 
+	// the same as looping it over the pixels. Views must have the same dimensions as the image.
+
+	// Adds the colors of the view to the image, saturating at 255.
+	void add(const ImageView& other);
+
+	// Adds the color to every pixel, saturating at 255.
+	void add(Color color);
+
+	// Subtracts the colors of the view from the image, saturating at 0.
+	void subtract(const ImageView& other);
+
+	// Multiplies the image by the colors of the view, every channel as a fraction of 255.
+	void multiply(const ImageView& other);
+
+	// Multiplies every pixel by the color, every channel as a fraction of 255.
+	void multiply(Color color);
+
+	// Multiplies every channel by the non negative factor, saturating at 255.
+	void scale(float factor);
+
+	// Linearly interpolates every pixel towards the view by the weight, from 0 to 1.
+	void lerp(const ImageView& other, float weight);
+
+	// Draws the view over the image, with its alpha as the opacity of every pixel. The 
+	// image alpha accumulates the coverage, colors are blended as over an opaque image.
+	void blend(const ImageView& other);
+
+	// Multiplies the color channels of every pixel by its alpha.
+	void premultiply();
+
+	// Divides the color channels of every pixel by its alpha, rounding to the closest value,
+	// the inverse of premultiply(). Fully transparent pixels are left unchanged.
+	void unpremultiply();
+
+	// Replaces every channel by its entry in the table of that channel, which must have 256
+	// values. Channels with a null table are left unchanged. Tables are read per byte, so 
+	// this runs without SIMD, but it is still spread across the thread pool.
+	void applyLUT(const unsigned char* lut_r, const unsigned char* lut_g, const unsigned char* lut_b, const unsigned char* lut_a = nullptr);
+};
+
+// Non owning read only view of a grid of colors, given by a pointer to the first pixel, 
+// the dimensions, and the stride, the number of colors from one row to the next. Images 
+// convert to views of themselves, and views can point to a region of an image or to any
+// color buffer owned by the user, which must outlive the view. Nothing is ever copied.
+class ImageView
+{
+private:
+	// Private variables
+
+	const Color* pixels_ = nullptr;	// Pointer to the first pixel of the view
+
+	unsigned width_  = 0u;	// Stores the width of the view
+	unsigned height_ = 0u;	// Stores the height of the view
+	unsigned stride_ = 0u;	// Colors from the start of a row to the next one
+
+public:
+	// Empty view.
+	ImageView() {}
+
+	// Views the color buffer, if the stride is zero rows are expected to be packed.
+	ImageView(const Color* pixels, unsigned width, unsigned height, unsigned stride = 0u)
+		: pixels_{ pixels }, width_{ width }, height_{ height }, stride_{ stride ? stride : width } {}
+
+	// Views the entire image.
+	ImageView(const Image& image)
+		: ImageView(image.pixels(), image.width(), image.height()) {}
+
+	// Returns a view of the specified region of this view, that must be inside it.
+	ImageView subview(unsigned x, unsigned y, unsigned width, unsigned height) const;
+
+	// Getters
+
+	// Returns the constant pointer to the first pixel of the view.
+	inline const Color* pixels() const { return pixels_; }
+
+	// Returns the view width.
+	inline unsigned width() const { return width_; }
+
+	// Returns the view height.
+	inline unsigned height() const { return height_; }
+
+	// Returns the number of colors from the start of a row to the next one.
+	inline unsigned stride() const { return stride_; }
+
+	// Returns whether the rows are packed one after the other.
+	inline bool isContiguous() const { return stride_ == width_ || height_ <= 1u; }
+
+	// Accessors
+
+	// Returns the constant pointer to the first pixel of the specified row.
+	inline const Color* row(unsigned row) const 
+	{ return pixels_ + (unsigned long long)row * stride_; }
+
+	// Returns a constant color reference to the specified pixel coordinates.
+	inline const Color& operator()(unsigned row, unsigned col) const 
+	{ return pixels_[(unsigned long long)row * stride_ + col]; }
 };
 
 // Since the 3D library uses Texture Cubes as its preferred image projection to 
@@ -1402,13 +1580,15 @@ public:
 // They expect a valid images and a cube width for the output resolution, and 
 // they will create a cube image and sample its colors from your projection image. 
 // The image is allocated with 'new' and is to be destroyed by the user.
+// The cube rows are converted in parallel across the thread pool, with SIMD
+// projection math and fixed point bilinear sampling.
 struct ToCube
 {
 	// Equirectangular projections are extremely common, they follow the typical
 	// latitude longitude coordinate system and are widely used for all kinds of
 	// applications. This function allows you to convert equirectangular projection
 	// images to texture cubes.
-	static Image* from_equirect(const Image& equirect, unsigned cube_width);
+	static Image* from_equirect(const ImageView& equirect, unsigned cube_width);
 
 	// Depending on the fisheye image the distance from center to angle projection
 	// can be different. IF you are not sure which one your is just try different
@@ -1432,7 +1612,428 @@ struct ToCube
 	// you to convert your fish-eye 360 pictures into texture cubes.
 	// This function expects 360 fisheye images, so if your images are only half a 
 	// sphere, pass an image double the size with your fisheye image in the middle.
-	static Image* from_fisheye(const Image& fisheye, unsigned cube_width, FISHEYE_TYPE type);
+	static Image* from_fisheye(const ImageView& fisheye, unsigned cube_width, FISHEYE_TYPE type);
+};
+
+// Filters used to downsample the levels of a mip chain. The box filter averages the pixels
+// covered by every level pixel and is the fastest. Kaiser and Lanczos are windowed sinc 
+// filters that keep the levels sharp without aliasing, Lanczos being the sharpest of them.
+enum MIP_FILTER
+{
+	MIP_FILTER_BOX,
+	MIP_FILTER_KAISER,
+	MIP_FILTER_LANCZOS,
+};
+
+// Mip chains are lists of images, each one half the size of the previous one down to a 
+// single pixel, that the GPU samples from when a texture is drawn smaller than its size.
+// They avoid aliasing and shimmering at distance and reduce the texture bandwidth. 
+// This class builds the chain of an image on the CPU, the first level is the image itself,
+// viewed without copying, and every other level is filtered from the previous one with 
+// the rows spread across the thread pool. Filtering is done in linear light with alpha 
+// weighting, so colors keep their brightness and transparent pixels do not bleed. Cube-maps
+// are filtered face by face. To upload a chain to the GPU check the Texture header.
+class MipChain
+{
+private:
+	// Private variables
+
+	ImageView base_;				// View of the first level
+	Image* levels_ = nullptr;		// Array of the following levels
+	unsigned level_count_ = 0u;		// Number of levels including the first one
+
+public:
+	// Whether the colors are converted from sRGB to linear light before filtering, as 
+	// images usually store them. Disable it for images that store other kind of data.
+	static inline bool GAMMA_CORRECT = true;
+
+	// Returns the number of levels of a full chain for the specified dimensions. For 
+	// cube-maps the face width is to be used as both dimensions.
+	static unsigned levelCount(unsigned width, unsigned height);
+
+	// Empty constructor, generate() can be called to build a chain.
+	MipChain() {}
+
+	// Builds the mip chain of the image, check generate() for more information.
+	MipChain(const ImageView& image, MIP_FILTER filter = MIP_FILTER_KAISER, bool cubemap = false, unsigned max_levels = 0u);
+
+	// Frees the levels of the chain.
+	~MipChain();
+
+	// Copies of mip chains are not allowed.
+	MipChain(const MipChain&) = delete;
+	MipChain& operator=(const MipChain&) = delete;
+
+	// Builds the mip chain of the image with the specified filter, replacing the previous
+	// one. If cubemap is true the image is expected to have the six faces stacked, and 
+	// every level keeps that layout. If max levels is not zero the chain is cut there. 
+	// The image is only viewed, so it must outlive the chain.
+	void generate(const ImageView& image, MIP_FILTER filter = MIP_FILTER_KAISER, bool cubemap = false, unsigned max_levels = 0u);
+
+	// Returns the number of levels of the chain, including the first one.
+	inline unsigned levelCount() const { return level_count_; }
+
+	// Returns a view of the specified level, the first level is the original image.
+	ImageView level(unsigned index) const;
+};
+
+// Block compression formats, images are split in blocks of 4x4 pixels stored in a fixed 
+// number of bytes, that the GPU decodes when sampling. BC1 stores the colors in 8 bytes per
+// block with one bit alpha, BC3 adds 8 more bytes of smooth alpha, and BC7 uses 16 bytes 
+// to store colors and alpha with a much higher quality, at a slower compression.
+enum BLOCK_FORMAT
+{
+	BLOCK_FORMAT_BC1,
+	BLOCK_FORMAT_BC3,
+	BLOCK_FORMAT_BC7,
+};
+
+// Block compressed images take four to eight times less memory than regular images, both 
+// in RAM and in the GPU, and are faster to sample. This class compresses images or their 
+// mip chains, encoding the blocks in parallel across the thread pool, and reads and writes 
+// them as DDS files, so big textures can be compressed once offline and loaded directly.
+// Cube-maps store the six faces one after the other, each one with all its levels. The 
+// first level dimensions must be multiples of four. Textures can be created from them.
+class CompressedImage
+{
+private:
+	// Private variables
+
+	unsigned char* blocks_ = nullptr;	// Blocks of every face and level
+	unsigned long long size_ = 0u;		// Size of the blocks in bytes
+
+	BLOCK_FORMAT format_ = BLOCK_FORMAT_BC1;	// Format of the blocks
+	unsigned width_ = 0u;		// Width of the first level
+	unsigned height_ = 0u;		// Height of the first level, of a face for cube-maps
+	unsigned level_count_ = 0u;	// Number of mip levels
+	bool cubemap_ = false;		// Whether the six faces of a cube-map are stored
+
+	// Allocates the blocks for the layout specified, freeing the previous ones
+	void allocate(BLOCK_FORMAT format, unsigned width, unsigned height, unsigned level_count, bool cubemap);
+
+	// Compresses the levels specified, each one half the size of the previous one
+	void compress_levels(const ImageView* levels, unsigned level_count, BLOCK_FORMAT format, bool cubemap);
+
+public:
+	// Constructors/Destructors
+
+	// Empty constructor, compress() or load() can be called to fill it.
+	CompressedImage() {}
+
+	// Initializes the image as stored in the DDS file.
+	CompressedImage(const char* filename);
+
+	// Compresses the image in the format specified, check compress() for more information.
+	CompressedImage(const ImageView& image, BLOCK_FORMAT format, bool cubemap = false);
+
+	// Compresses all the levels of the mip chain in the format specified.
+	CompressedImage(const MipChain* chain, BLOCK_FORMAT format, bool cubemap = false);
+
+	// Takes the blocks of the other image, leaving it empty.
+	CompressedImage(CompressedImage&& other) noexcept;
+
+	// Takes the blocks of the other image, leaving it empty.
+	CompressedImage& operator=(CompressedImage&& other) noexcept;
+
+	// Copies of compressed images are not allowed.
+	CompressedImage(const CompressedImage&) = delete;
+	CompressedImage& operator=(const CompressedImage&) = delete;
+
+	// Frees the blocks.
+	~CompressedImage();
+
+	// Compresses the image in the format specified, replacing the previous contents. If
+	// cubemap is true the image is expected to have the six faces stacked vertically.
+	void compress(const ImageView& image, BLOCK_FORMAT format, bool cubemap = false);
+
+	// Compresses all the levels of the mip chain in the format specified. If cubemap is 
+	// true the chain is expected to have been generated as a cube-map.
+	void compress(const MipChain* chain, BLOCK_FORMAT format, bool cubemap = false);
+
+	// File functions
+
+	// Loads the image from the specified DDS file, with BC1, BC3 or BC7 blocks. 
+	bool load(const char* filename);
+
+	// Saves the image to the specified path as a DDS file.
+	bool save(const char* filename) const;
+
+	// Getters
+
+	// Returns the size in bytes of a block of the specified format.
+	static unsigned blockBytes(BLOCK_FORMAT format);
+
+	// Returns the format of the blocks.
+	inline BLOCK_FORMAT format() const { return format_; }
+
+	// Returns the width of the first level.
+	inline unsigned width() const { return width_; }
+
+	// Returns the height of the first level, for cube-maps the height of a face.
+	inline unsigned height() const { return height_; }
+
+	// Returns the number of mip levels.
+	inline unsigned levelCount() const { return level_count_; }
+
+	// Returns whether the image stores the six faces of a cube-map.
+	inline bool isCubemap() const { return cubemap_; }
+
+	// Returns the size in bytes of all the blocks.
+	inline unsigned long long size() const { return size_; }
+
+	// Returns the number of bytes from a row of blocks of the level to the next one.
+	unsigned rowPitch(unsigned level) const;
+
+	// Returns the pointer to the blocks of the specified level and cube-map face.
+	const unsigned char* blocks(unsigned level, unsigned face = 0u) const;
+};
+
+// Pixel formats of float images, four channels per pixel in RGBA order. RGBA32F stores
+// every channel as a 32 bit float. RGBA16F stores them as 16 bit half floats, using half 
+// the memory, with around three significant digits and values up to 65504.
+enum IMAGEF_FORMAT
+{
+	IMAGEF_RGBA32F,
+	IMAGEF_RGBA16F,
+};
+
+// Operators used when float images are converted to regular images, to bring the color 
+// channels to the range [0,1]. The exposure multiplies the values before the operator. 
+// The alpha channel is always clamped, and negative values always map to zero.
+enum TONE_MAP
+{
+	TONE_MAP_CLAMP,		// Values above one are clamped.
+	TONE_MAP_REINHARD,	// Values are mapped by x / (1 + x), smoothly compressing highlights.
+	TONE_MAP_ACES,		// Filmic curve fitted to the ACES tone mapping, with a toe and a shoulder.
+	TONE_MAP_NORMALIZE,	// Values are divided by the maximum color channel of the image.
+	TONE_MAP_LOG,		// Values are mapped by log(1 + x) / log(1 + max), for wide ranges.
+};
+
+// Images store colors as bytes, so adding many frames together saturates right away. Float 
+// images store four floats or half floats per pixel, to accumulate frames, densities or any 
+// other data at full precision, and are converted to regular images once at the end with a 
+// tone mapping operator. Conversions and accumulation process the pixels with SIMD across
+// the thread pool, and textures can be created from float images directly. Regular images 
+// can be read as they are or decoded from sRGB to linear light, and encoded back the same.
+class ImageF
+{
+private:
+	// Private variables
+
+	void* pixels_ = nullptr;	// Pointer to the pixels, floats or half floats
+
+	unsigned width_	 = 0u;	// Stores the width of the image
+	unsigned height_ = 0u;	// Stores the height of the image
+
+	IMAGEF_FORMAT format_ = IMAGEF_RGBA32F;	// Format of the pixels
+
+public:
+	// Constructors/Destructors
+
+	// Empty constructor, reset() can be called to reshape it.
+	ImageF() {}
+
+	// Creates a float image with the specified size and format, with all values at zero.
+	ImageF(unsigned width, unsigned height, IMAGEF_FORMAT format = IMAGEF_RGBA32F);
+
+	// Converts the colors of the view to floats in the specified format, check load().
+	ImageF(const ImageView& image, IMAGEF_FORMAT format = IMAGEF_RGBA32F, bool linear = false);
+
+	// Copies the other image.
+	ImageF(const ImageF& other);
+
+	// Copies the other image.
+	ImageF& operator=(const ImageF& other);
+
+	// Takes the pixels of the other image, leaving it empty.
+	ImageF(ImageF&& other) noexcept;
+
+	// Takes the pixels of the other image, leaving it empty.
+	ImageF& operator=(ImageF&& other) noexcept;
+
+	// Frees the pixels.
+	~ImageF();
+
+	// Resets the image to the new dimensions and format, with all values at zero.
+	void reset(unsigned width, unsigned height, IMAGEF_FORMAT format = IMAGEF_RGBA32F);
+
+	// Sets every pixel to the color.
+	void fill(_float4color color);
+
+	// Conversions
+
+	// Converts the colors of the view to floats from 0 to 1, replacing the image contents
+	// and keeping its format. If linear is true the colors are decoded from sRGB.
+	void load(const ImageView& image, bool linear = false);
+
+	// Converts the image to a regular image of the same dimensions, with the tone mapping
+	// operator and the exposure specified. If linear is true the colors are encoded to sRGB,
+	// as the inverse of load(). The image is reset if its dimensions are different.
+	void toImage(Image* image, TONE_MAP tone_map = TONE_MAP_CLAMP, float exposure = 1.f, bool linear = false) const;
+
+	// Converts the pixels to the specified format.
+	void convert(IMAGEF_FORMAT format);
+
+	// Accumulation
+
+	// Adds the colors of the view, as floats from 0 to 1 multiplied by the weight. If linear
+	// is true the colors are decoded from sRGB. Dimensions must match.
+	void add(const ImageView& image, float weight = 1.f, bool linear = false);
+
+	// Adds the values of the other float image multiplied by the weight. Dimensions must match.
+	void add(const ImageF& other, float weight = 1.f);
+
+	// Multiplies every channel by the factor.
+	void scale(float factor);
+
+	// Finds the minimum and maximum values of every channel, ignoring NaN and infinite values.
+	// Channels without finite values are set to zero.
+	void findRange(_float4color* min_values, _float4color* max_values) const;
+
+	// Getters
+
+	// Returns the image width.
+	inline unsigned width() const { return width_; }
+
+	// Returns the image height.
+	inline unsigned height() const { return height_; }
+
+	// Returns the format of the pixels.
+	inline IMAGEF_FORMAT format() const { return format_; }
+
+	// Returns the size in bytes of a pixel of the specified format.
+	static unsigned pixelBytes(IMAGEF_FORMAT format);
+
+	// Returns the pointer to the pixels, four floats or half floats per pixel.
+	inline void* data() { return pixels_; }
+
+	// Returns the constant pointer to the pixels, four floats or half floats per pixel.
+	inline const void* data() const { return pixels_; }
+
+	// Returns the pointer to the pixels as float colors if the format is RGBA32F, for 
+	// other formats it returns nullptr. Writing to them directly is the fastest access.
+	inline _float4color* pixels() 
+	{ return format_ == IMAGEF_RGBA32F ? (_float4color*)pixels_ : nullptr; }
+
+	// Returns the constant pointer to the pixels as float colors if the format is RGBA32F.
+	inline const _float4color* pixels() const 
+	{ return format_ == IMAGEF_RGBA32F ? (const _float4color*)pixels_ : nullptr; }
+
+	// Accessors
+
+	// Returns the color of the specified pixel coordinates, in any format.
+	_float4color getPixel(unsigned row, unsigned col) const;
+
+	// Sets the color of the specified pixel coordinates, in any format.
+	void setPixel(unsigned row, unsigned col, _float4color color);
+};
+
+
+/* COLORMAP CLASS HEADER
+-----------------------------------------------------------------------------------------------------------
+-----------------------------------------------------------------------------------------------------------
+Mathematical plots are usually colored by a scalar value of each point, like its height or
+its distance to the origin, mapped to a color gradient. This class stores such a gradient as
+a lookup table of colors, so mapping a value is a multiplication and a table read, and whole
+arrays of values are mapped at once with SIMD instructions by the map() functions.
+
+The most common gradients are built in. The perceptually uniform viridis, magma, inferno and
+plasma, the rainbow like turbo, and the diverging coolwarm and red-blue maps, that are white
+or gray at the center and are meant for signed values. Custom gradients are created from a
+list of colors at the positions specified, and interpolated in between.
+
+Surfaces, curves and scatters can be colored with a colormap directly from their descriptors,
+using the height, the radius or the generation parameter of every vertex, which is much faster
+than calling a coloring function per vertex.
+
+Tables have 256 colors by default, the resolution of the built in gradients. Bigger tables,
+like 4096 colors, give smoother custom gradients over large ranges of values.
+-----------------------------------------------------------------------------------------------------------
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Gradients built into the Colormap class.
+enum COLORMAP
+{
+	COLORMAP_VIRIDIS,	// Perceptually uniform, from dark blue to yellow.
+	COLORMAP_MAGMA,		// Perceptually uniform, from black to light yellow through purple.
+	COLORMAP_INFERNO,	// Perceptually uniform, from black to yellow through red.
+	COLORMAP_PLASMA,	// Perceptually uniform, from blue to yellow through pink.
+	COLORMAP_TURBO,		// Rainbow like, from dark blue to dark red.
+	COLORMAP_COOLWARM,	// Diverging, from blue to red through light gray.
+	COLORMAP_RED_BLUE,	// Diverging, from dark blue to dark red through white.
+	COLORMAP_GRAYSCALE,	// From black to white.
+};
+
+// Scalar value of every vertex that drawables use to color it with a colormap.
+enum COLORMAP_SCALAR
+{
+	COLORMAP_SCALAR_HEIGHT,			// The Z coordinate of the vertex.
+	COLORMAP_SCALAR_RADIUS,			// The distance from the vertex to the origin.
+	COLORMAP_SCALAR_PARAMETER,		// The first parameter of the vertex, check the descriptors.
+	COLORMAP_SCALAR_PARAMETER_V,	// The second parameter of surface vertices.
+};
+
+// Color gradient stored as a lookup table, to color scalar values. Values are mapped
+// linearly from the range given to the table, and values outside of it get the color
+// of the closest end. A reversed range, with the minimum above the maximum, reverses
+// the gradient, and NaN values get the first color.
+class Colormap
+{
+private:
+	// Private variables
+
+	Color* colors_ = nullptr;			// Table of colors of the gradient
+	_float4color* colors4_ = nullptr;	// Same table as float colors for vertex data
+	unsigned size_ = 0u;				// Number of colors in the table
+
+public:
+	// Empty constructor, call generate() before mapping values.
+	Colormap() {}
+
+	// Creates the table of the built in gradient with the number of colors specified.
+	Colormap(COLORMAP map, unsigned size = 256u);
+
+	// Creates the table of a custom gradient from a list of colors at the positions from 0
+	// to 1 specified, in increasing order. If the position list is null the colors are
+	// equally spaced. Colors are interpolated in between and extended past the ends.
+	Colormap(const Color* colors, unsigned count, const float* positions = nullptr, unsigned size = 256u);
+
+	// Copies the table of the other colormap.
+	Colormap(const Colormap& other);
+
+	// Copies the table of the other colormap.
+	Colormap& operator=(const Colormap& other);
+
+	// Frees the table.
+	~Colormap();
+
+	// Replaces the table with the one of the built in gradient specified.
+	void generate(COLORMAP map, unsigned size = 256u);
+
+	// Replaces the table with the one of the custom gradient specified.
+	void generate(const Color* colors, unsigned count, const float* positions = nullptr, unsigned size = 256u);
+
+	// Returns the number of colors in the table.
+	inline unsigned size() const { return size_; }
+
+	// Returns the table of colors, from the minimum value to the maximum.
+	inline const Color* colors() const { return colors_; }
+
+	// Returns the color of a single value in the range specified.
+	Color operator()(float value, float min_value = 0.f, float max_value = 1.f) const;
+
+	// Maps the list of values to colors with the range specified, several values at once.
+	void map(const float* values, Color* colors, unsigned count, float min_value = 0.f, float max_value = 1.f) const;
+
+	// Maps the list of values to float colors with the range specified. The stride is the
+	// distance in bytes between the output colors, so that they can be written directly
+	// inside of interleaved vertex arrays.
+	void map(const float* values, _float4color* colors, unsigned count, float min_value = 0.f, float max_value = 1.f, unsigned stride = sizeof(_float4color)) const;
+
+	// Finds the minimum and maximum values of the list, ignoring NaN and infinite values.
+	// If the list has no finite values both are set to zero.
+	static void findRange(const float* values, unsigned count, float* min_value, float* max_value);
 };
 
 
@@ -1791,6 +2392,11 @@ public:
 	// Returns the current scals.
 	inline float getScale() const { return Scale; }
 
+	// Computes the scene space ray that goes through the pixel specified, for example the
+	// mouse position, as seen from the current perspective. The origin lies on the plane 
+	// through the center facing the observer, and the direction points into the screen.
+	void getPixelRay(Vector2i pixel, Vector3f* origin, Vector3f* direction) const;
+
 private:
 	// Initializes the class data and calls the creation of the graphics instance.
 	// Initializes all the necessary GPU data to be able to render the graphics objects.
@@ -2231,6 +2837,20 @@ struct BACKGROUND_DESC
 	// texture. If the background is dynamic it expects valid cube-map dimensions.
 	Image* image = nullptr;
 
+	// Alternatively to the image pointer, a view of an image region or of a user color
+	// buffer can be given, it is used to create the texture if the image pointer is null.
+	ImageView image_view = {};
+
+	// If both the image pointer and the view are empty and this pointer is valid, the 
+	// background texture is created from this float image, as a floating point texture. 
+	// Float backgrounds are updated with float images and do not support mipmaps.
+	const ImageF* hdr_image = nullptr;
+
+	// If the image pointers and the view are empty, the background texture is created
+	// from this block compressed image, that must be a cube-map for dynamic backgrounds.
+	// Compressed backgrounds do not allow texture updates.
+	const CompressedImage* compressed_image = nullptr;
+
 	// Wether the background is static or dynamic.
 	enum BACKGROUND_TYPE
 	{
@@ -2246,6 +2866,13 @@ struct BACKGROUND_DESC
 	// Whether the Background texture is pixelated or linearly interpolates.
 	bool pixelated_texture = false;
 
+	// Whether the texture is uploaded with its full mip chain, so that it does not alias
+	// when the image is drawn smaller than its size. The chain is rebuilt on updates.
+	bool texture_mipmaps = false;
+
+	// Filter used to downsample the texture mip chain, check the Image header.
+	MIP_FILTER mipmap_filter = MIP_FILTER_KAISER;
+
 	// If true, when drawn it will override whatever is on the depth buffer and render
 	// target, basically clearing the screen with the background. If drawn first, set 
 	// to true and clearBuffer() is not necessary. Better for performance.
@@ -2274,6 +2901,14 @@ public:
 	// as the image used in the constructor.
 	void updateTexture(const Image* image);
 
+	// If updates are enabled, updates the background texture with the rows of the view.
+	// Dimensions must be equal to the image used in the constructor.
+	void updateTexture(const ImageView& image);
+
+	// If updates are enabled and the Background was created from a float image, updates
+	// the background texture with the new float image, of the same dimensions and format.
+	void updateTexture(const ImageF* image);
+
 	// If the Background is dynamic, it updates the rotation quaternion of the scene. If 
 	// multiplicative it will apply the rotation on top of the current rotation. For more 
 	// information on how to rotate with quaternions check the Quaternion header file.
@@ -2341,7 +2976,8 @@ struct CURVE_DESC
 	{
 		FUNCTION_COLORING,
 		LIST_COLORING,
-		GLOBAL_COLORING
+		GLOBAL_COLORING,
+		COLORMAP_COLORING
 	}
 	coloring = GLOBAL_COLORING; // Defaults to global color
 
@@ -2356,6 +2992,22 @@ struct CURVE_DESC
 	// colors as long as the vertex count.
 	Color* color_list = nullptr;
 
+	// If coloring is a colormap, the built in gradient used to color the vertices. Check
+	// the Colormap header for more information on colormaps.
+	COLORMAP colormap = COLORMAP_VIRIDIS;
+
+	// If coloring is a colormap and the pointer is valid, its gradient is used instead of 
+	// the built in one. It is copied, so it does not need to outlive the Curve.
+	const Colormap* custom_colormap = nullptr;
+
+	// If coloring is a colormap, the value of each vertex mapped to a color. The parameter
+	// of a vertex is the value given to the curve function to generate it.
+	COLORMAP_SCALAR colormap_scalar = COLORMAP_SCALAR_PARAMETER;
+
+	// If coloring is a colormap, values mapped to the ends of the gradient. If the range
+	// is empty the minimum and maximum values of the initial vertices are used.
+	Vector2f colormap_range = {};
+
 	// Sets Order Indepentdent Transparency for the Curve. Check 
 	// Graphics.h or Blender.h for more information on how to use it.
 	bool enable_transparency = false;
@@ -2385,10 +3037,15 @@ public:
 	// and will initialize everything as specified, can only be called once per object.
 	void initialize(const CURVE_DESC* pDesc);
 
+	// Draw override, sends the pending vertex and color updates to the GPU and 
+	// then issues the draw call. Updates are coalesced and uploaded only here.
+	void Draw() override;
+
 	// If updates are enabled this function allows to change the range of the curve function. It 
 	// expects the initial function pointer to still be callable, it will evaluate it on the new 
 	// range and send the vertices to the GPU. If coloring is functional it also expects the color 
-	// function to still be callable, if coloring is not functional it will reuse the old colors.
+	// function to still be callable, colormaps color the new vertices, and otherwise it will reuse 
+	// the old colors.
 	void updateRange(Vector2f range = {});
 
 	// If updates are enabled, and coloring is with a list, this function allows to change 
@@ -2396,6 +3053,11 @@ public:
 	// with a list of colors as long as the vertex count.
 	void updateColors(Color* color_list);
 
+	// If updates are enabled, and coloring is with a list, this function allows to change 
+	// the colors of a range of vertices, starting at the first vertex specified. It expects
+	// a valid pointer to a list of colors as long as the count.
+	void updateColors(const Color* color_list, unsigned first, unsigned count);
+
 	// If the coloring is set to global, updates the global Curve color.
 	void updateGlobalColor(Color color);
 
@@ -2570,7 +3232,9 @@ struct POLYHEDRON_DESC
 	} 
 	coloring = GLOBAL_COLORING; // Defaults to global color
 
-	// If coloring is set to global the shape will have this color.
+	// If coloring is set to global the shape will have this color. Global colored polyhedrons
+	// with per vertex list normals, or without illumination, upload every vertex only once and
+	// draw the triangles by index, which uses less memory and makes updates cheaper.
 	Color global_color = Color::White;
 
 	// If coloring is set to per vertex it expects a valid pointer 
@@ -2600,9 +3264,18 @@ struct POLYHEDRON_DESC
 		// the normal vector list. So the list must be as long as three times the number
 		// of triangles.
 		PER_TRIANGLE_LIST_NORMALS,
+		// The normal vectors will be computed per vertex by averaging the normals of all
+		// the triangles around it, weighted by their area or their corner angle. Smooth
+		// shading without providing a list, normals are updated along with the vertices.
+		COMPUTED_SMOOTH_NORMALS,
 	}
 	normal_computation = COMPUTED_TRIANGLE_NORMALS; // Defaults to computation.
 
+	// If normals are computed smooth, whether the triangle normals are weighted by the 
+	// angle of their corner at each vertex, instead of by their area. Angle weighting is
+	// more robust for irregular meshes with long thin triangles.
+	bool angle_weighted_normals = false;
+
 	// IF normals are not computed this variable is expected to contain a valid list
 	// of normal vectors as long as the vertex count in case of per vertex normals, 
 	// or as long a three times the triangle count in case of per triangle normals.
@@ -2623,6 +3296,18 @@ struct POLYHEDRON_DESC
 	// updateVertices(), updateColors(), updateTextureCoordinates() require it.
 	bool enable_updates	= false;
 
+	// Whether the triangles of indexed polyhedrons, global colored with per vertex list
+	// normals, smooth normals or without illumination, are reordered on creation so that
+	// the GPU transforms fewer vertices and draws the outer triangles first. Picked triangles
+	// keep being reported with their original index. Disabled by default, so that the draw
+	// order of existing meshes does not change, enable it for large static meshes.
+	bool optimize_triangle_order = false;
+
+	// Whether the Polyhedron keeps a copy of its positions and triangles on the CPU, along
+	// with a bounding volume hierarchy built over them, needed by pickTriangle() and queryBox().
+	// The hierarchy is built on the first query and refitted after vertex updates.
+	bool enable_picking = false;
+
 	// IF true renders only the aristas of the Polyhedron.
 	bool wire_frame_topology = false;
 
@@ -2635,6 +3320,68 @@ struct POLYHEDRON_DESC
 	bool default_initial_lights = true;
 };
 
+// Statistics of a vertex weld, optionally reported by Polyhedron::weldVertices().
+struct POLYHEDRON_WELD_STATS
+{
+	// Number of vertices referenced by the triangles before and after the weld.
+	unsigned input_vertex_count = 0u;
+	unsigned output_vertex_count = 0u;
+
+	// Number of triangles before and after the weld.
+	unsigned input_triangle_count = 0u;
+	unsigned output_triangle_count = 0u;
+
+	// Number of triangles dropped because they collapsed into a line or a point.
+	unsigned degenerate_triangle_count = 0u;
+};
+
+// Post transform vertex cache statistics of a descriptor, reported by Polyhedron::analyzeVertexCache().
+struct POLYHEDRON_CACHE_STATS
+{
+	// Number of vertices referenced by the triangles and number of simulated vertex shader 
+	// invocations when drawing them by index with a FIFO cache.
+	unsigned referenced_vertex_count = 0u;
+	unsigned transformed_vertex_count = 0u;
+
+	// Average cache miss ratio, transformed vertices per triangle, from 0.5 to 3.
+	float acmr = 0.f;
+
+	// Average transformed vertex ratio, transformed vertices per referenced vertex, 1 is ideal.
+	float atvr = 0.f;
+};
+
+// Statistics of a simplification, optionally reported by Polyhedron::simplify().
+struct POLYHEDRON_SIMPLIFY_STATS
+{
+	// Number of vertices referenced by the triangles before and after the simplification.
+	unsigned input_vertex_count = 0u;
+	unsigned output_vertex_count = 0u;
+
+	// Number of triangles before and after the simplification.
+	unsigned input_triangle_count = 0u;
+	unsigned output_triangle_count = 0u;
+
+	// Largest distance the surface was moved by a collapse, as a fraction of the mesh size.
+	float result_error = 0.f;
+};
+
+// Closest triangle hit by a ray, reported by the picking functions of the mesh drawables.
+struct MESH_PICK
+{
+	// Index of the triangle hit, on the triangle list of the drawable.
+	unsigned triangle = 0u;
+
+	// Distance from the ray origin to the hit point, in world units.
+	float distance = 0.f;
+
+	// Hit point and unit normal of the triangle, following its winding, in world coordinates.
+	Vector3f point = {};
+	Vector3f normal = {};
+
+	// Weights of the second and third vertices of the triangle at the hit point.
+	Vector2f barycentric = {};
+};
+
 // Polyhedron drawable class, used for drawing and interacting with user defined triangle 
 // meshes on a Graphics instance. Allows for different rendering settings including but not 
 // limited to textures, illumination, transparencies. Check the descriptor to see all options.
@@ -2644,9 +3391,83 @@ public:
 	// To facilitate the loading of triangle meshes, this function is a parser for 
 	// *.obj files, that reads the files and outputs a valid descriptor. If the file 
 	// supports texturing, optionally accepts an image to be used as texture_image.
+	// If the cache is enabled the result is also stored next to the obj file as a 
+	// binary mesh file (*.obj.cmesh), keyed by the obj file size and modification time,
+	// and later calls with the same obj file and texture size read it instead.
 	// NOTE: All data is allocated by (new) and its deletion must be handled by the 
 	// user. The image pointer used is the same as provided..
-	static POLYHEDRON_DESC getDescFromObj(const char* obj_file_path, Image* texture = nullptr);
+	static POLYHEDRON_DESC getDescFromObj(const char* obj_file_path, Image* texture = nullptr, bool use_cache = false);
+
+	// To facilitate the loading of CAD meshes, this function is a parser for binary *.stl
+	// files. STL stores every triangle with its own three vertices, so corners with the exact
+	// same position are welded into a shared vertex list. Normals are computed per triangle.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	static POLYHEDRON_DESC getDescFromStl(const char* stl_file_path);
+
+	// To facilitate the loading of scanned meshes, this function is a parser for binary *.ply
+	// files. It reads the vertex positions, and the normals, colors and texture coordinates if 
+	// present, and the faces, that are fan triangulated. Texture coordinates are only used if 
+	// an image is provided, otherwise vertex colors are used if present.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	// The image pointer used is the same as provided.
+	static POLYHEDRON_DESC getDescFromPly(const char* ply_file_path, Image* texture = nullptr);
+
+	// Writes the descriptor triangles to a binary *.stl file. STL files only store positions, 
+	// so every triangle is written with its three vertices and its normal.
+	static void writeStlFile(const char* stl_file_path, const POLYHEDRON_DESC* pDesc);
+
+	// Writes the descriptor to a binary little endian *.ply file. Vertex positions are always 
+	// written, normals if they are per vertex and colors if they are per vertex. As PLY colors 
+	// are per vertex, corners of the same vertex with different colors keep one of them.
+	static void writePlyFile(const char* ply_file_path, const POLYHEDRON_DESC* pDesc);
+
+	// Writes the geometry of the descriptor to a binary mesh file (*.cmesh), that can be 
+	// loaded back with getDescFromMesh() or a MeshView without any parsing. Vertices, 
+	// triangles, normals, colors and texture coordinates are stored, along with the coloring 
+	// and normal settings. Texture images are not stored.
+	static void writeMeshFile(const char* mesh_file_path, const POLYHEDRON_DESC* pDesc);
+
+	// Reads a binary mesh file written by writeMeshFile() and outputs a valid descriptor.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	// The image pointer used is the same as provided.
+	static POLYHEDRON_DESC getDescFromMesh(const char* mesh_file_path, Image* texture = nullptr);
+
+	// Welds the vertices of the descriptor that are closer than the epsilon, or that have the
+	// exact same position if it is zero, and outputs a compact descriptor with the vertices in
+	// order of first appearance. Triangles that collapse are dropped, and vertices that no 
+	// triangle references are removed. Useful to shrink meshes with duplicated positions, like
+	// the ones loaded from files with per corner attributes or exported from Surfaces.
+	// Vertices with per vertex normals are only welded if their normals are also equal.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	static POLYHEDRON_DESC weldVertices(const POLYHEDRON_DESC* pDesc, float epsilon = 0.f, POLYHEDRON_WELD_STATS* pStats = nullptr);
+
+	// Simulates the post transform vertex cache of the size specified over the triangles of
+	// the descriptor, as if they were drawn by index, and returns the cache statistics.
+	static POLYHEDRON_CACHE_STATS analyzeVertexCache(const POLYHEDRON_DESC* pDesc, unsigned cache_size = 16u);
+
+	// Reorders the triangles of the descriptor in place for the vertex cache and, optionally,
+	// to reduce overdraw. Per corner colors, texture coordinates and normals are reordered 
+	// along, so the result draws the same. Meant to preprocess meshes offline, for example
+	// before writing them with writeMeshFile(), as indexed polyhedrons already do it on creation.
+	static void optimizeTriangleOrder(POLYHEDRON_DESC* pDesc, bool optimize_overdraw = true);
+
+	// Simplifies the descriptor with quadric error metrics, collapsing vertices onto their
+	// neighbours until the triangle count is at most the target, or until the next collapse
+	// would move the surface further than the target error, given as a fraction of the mesh
+	// size. The target count is not reached if the error limit is hit first, the stats report
+	// the triangles left, and a target error of zero sets no limit. Borders keep their outline,
+	// and vertices where colors, texture coordinates or per triangle normals differ between
+	// corners are kept, so seams and UVs are preserved. The output is compact with the vertices
+	// in order of first appearance. Meshes with duplicated positions should be welded first,
+	// and Surfaces can be simplified through getMeshDesc().
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	static POLYHEDRON_DESC simplify(const POLYHEDRON_DESC* pDesc, unsigned target_triangle_count, float target_error = 0.01f, POLYHEDRON_SIMPLIFY_STATS* pStats = nullptr);
+
+	// Builds a chain of levels of detail of the descriptor, every level is simplified from the
+	// previous one to the reduction specified of its triangles, within the target error. Levels
+	// that reach the error limit stop shrinking. The list must be as long as the level count.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	static void simplifyLODChain(const POLYHEDRON_DESC* pDesc, POLYHEDRON_DESC* lod_list, unsigned lod_count, float reduction = 0.5f, float target_error = 0.05f);
 
 public:
 	// Polyhedron constructor, if the pointer is valid it will call the initializer.
@@ -2659,11 +3480,27 @@ public:
 	// and will initialize everything as specified, can only be called once per object.
 	void initialize(const POLYHEDRON_DESC* pDesc);
 
+	// Draw override, sends the pending vertex updates to the GPU and then issues
+	// the draw call. Updates are coalesced and uploaded only here.
+	void Draw() override;
+
 	// If updates are enabled this function allows to change the current vertex positions
 	// for the new ones specified. It expects a valid pointer with a list as long as the 
 	// highest index found in the triangle list used for initialization.
 	void updateVertices(const Vector3f* vertex_list);
 
+	// If updates are enabled this function allows to change the positions of a range of 
+	// vertices, starting at the first vertex specified. It expects a valid pointer to a list
+	// of vertices as long as the count. Only the triangles using those vertices are updated.
+	// If the range exceeds the vertex count of the Polyhedron it will cause assertion.
+	void updateVertices(const Vector3f* vertex_list, unsigned first, unsigned count);
+
+	// If updates are enabled this function allows to change the positions of the vertices in
+	// the dirty list. It expects a valid pointer to the full vertex list, of which only the
+	// listed vertices are read, and every vertex is expected to be listed only once. Only the 
+	// triangles using those vertices are updated, which makes local deformations cheap.
+	void updateVertices(const Vector3f* vertex_list, const unsigned* dirty_vertices, unsigned dirty_count);
+
 	// If updates are enabled, and coloring is per vertex, this function allows to change 
 	// the current vertex colors for the new ones specified. It expects a valid pointer 
 	// with a list of colors containing one color per every vertex of every triangle. 
@@ -2724,12 +3561,61 @@ public:
 
 	// Returns the current screen position.
 	Vector2f getScreenPosition() const;
+
+	// If picking is enabled, finds the closest triangle hit by the ray given in world 
+	// coordinates, taking into account the rotation, distortion and position of the Polyhedron.
+	// Returns false if no triangle is hit, otherwise writes the hit to the valid pointer.
+	bool pickTriangle(Vector3f origin, Vector3f direction, MESH_PICK* pPick = nullptr) const;
+
+	// If picking is enabled, finds the triangles that intersect the box given in world 
+	// coordinates and writes up to the maximum specified to the list. Returns the total
+	// number of triangles found, even if it is larger than the maximum.
+	unsigned queryBox(Vector3f box_min, Vector3f box_max, unsigned* triangle_list = nullptr, unsigned max_triangles = 0u) const;
 	
 private:
 	// Pointer to the internal class storage.
 	void* polyhedronData = nullptr;
 };
 
+// Read only view of a binary mesh file, the file is memory mapped and the descriptor lists
+// point straight into it, so loading a mesh does not parse or copy anything. The descriptor
+// is valid while the view is open and can be used to initialize any number of Polyhedrons.
+class MeshView
+{
+public:
+	// Mesh view constructor, if the path is valid it will open the mesh file.
+	MeshView(const char* mesh_file_path = nullptr, Image* texture = nullptr);
+
+	// Closes the view.
+	~MeshView();
+
+	// Copies of mesh views are not allowed.
+	MeshView(const MeshView&) = delete;
+	MeshView& operator=(const MeshView&) = delete;
+
+	// Maps the binary mesh file specified, closing the previous one if any. The texture
+	// pointer is set on the descriptor and must be valid for textured meshes.
+	void open(const char* mesh_file_path, Image* texture = nullptr);
+
+	// Opens an obj file through its sidecar cache, if the cache is missing or out of date
+	// the obj file is parsed and the cache written before mapping it.
+	void openObj(const char* obj_file_path, Image* texture = nullptr);
+
+	// Unmaps the file, the descriptor is no longer valid after this call.
+	void close();
+
+	// Returns whether a mesh is currently open.
+	bool isOpen() const;
+
+	// Returns the descriptor of the open mesh, its lists point inside the mapped file and are
+	// valid until the view is closed. It can be used to initialize any number of Polyhedrons.
+	const POLYHEDRON_DESC* getDesc() const;
+
+private:
+	// Pointer to the internal class storage.
+	void* meshData = nullptr;
+};
+
 
 /* SCATTER DRAWABLE CLASS
 -----------------------------------------------------------------------------------------------------------
@@ -2768,7 +3654,8 @@ struct SCATTER_DESC
 	enum SCATTER_COLORING
 	{
 		POINT_COLORING,
-		GLOBAL_COLORING
+		GLOBAL_COLORING,
+		COLORMAP_COLORING
 	}
 	coloring = GLOBAL_COLORING; // Defaults to global color
 
@@ -2779,6 +3666,27 @@ struct SCATTER_DESC
 	// to a list of colors containing one color per every point.
 	Color* color_list = nullptr;
 
+	// If coloring is a colormap, the built in gradient used to color the points. Check
+	// the Colormap header for more information on colormaps.
+	COLORMAP colormap = COLORMAP_VIRIDIS;
+
+	// If coloring is a colormap and the pointer is valid, its gradient is used instead of 
+	// the built in one. It is copied, so it does not need to outlive the Scatter.
+	const Colormap* custom_colormap = nullptr;
+
+	// If coloring is a colormap, the value of each point mapped to a color. The parameter
+	// of the points is read from the value list. Points colored by their height or radius 
+	// are colored again when their positions are updated.
+	COLORMAP_SCALAR colormap_scalar = COLORMAP_SCALAR_HEIGHT;
+
+	// If coloring is a colormap with the parameter scalar, it expects a valid pointer to
+	// a list of values containing one value per every point.
+	float* value_list = nullptr;
+
+	// If coloring is a colormap, values mapped to the ends of the gradient. If the range
+	// is empty the minimum and maximum values of the initial points are used.
+	Vector2f colormap_range = {};
+
 	// Specifies how the color of the points will blend with the render target.
 	enum BLENDING_MODE
 	{
@@ -2796,6 +3704,21 @@ struct SCATTER_DESC
 	// If true it will assume the points are a list of lines by pairs and 
 	// create a line-mesh out of them. Point count must be divisible by two.
 	bool line_mesh = false;
+
+	// If true it builds a hierarchy of voxel downsampled copies of the cloud, where 
+	// every voxel is drawn as the average position and color of its points. At draw 
+	// time the coarsest level that fits the render target scale is used, so huge clouds 
+	// cost as many points as the screen can show. Not compatible with updates or line-mesh.
+	bool enable_lod = false;
+
+	// If level of detail is enabled, maximum size in pixels of the voxels of the
+	// level drawn. Bigger values draw coarser levels and fewer points.
+	float lod_pixel_size = 1.f;
+
+	// If true it builds a spatial index of the points that enables the picking and
+	// neighbourhood queries of the Scatter. If updates are enabled the index is refitted
+	// on every point update, check the query functions for more information.
+	bool enable_spatial_index = false;
 };
 
 // Scatter drawable class, used for drawing and interaction with 3D user created 
@@ -2804,6 +3727,19 @@ struct SCATTER_DESC
 // more information about the class capabilities.
 class Scatter : public Drawable
 {
+public:
+	// To facilitate the loading of point clouds, this function is a parser for binary
+	// *.ply files, that maps the file and reads the vertex positions, and the vertex 
+	// colors if present, in parallel chunks. Outputs a valid descriptor for the cloud.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	static SCATTER_DESC getDescFromPly(const char* ply_file_path);
+
+	// Parser for plain text point clouds (*.xyz, *.txt, *.csv), one point per line with its
+	// values separated by spaces, commas or semicolons. If lines have six or more values the 
+	// fourth to sixth are read as 0-255 RGB colors. Lines not starting with a number are skipped.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	static SCATTER_DESC getDescFromXyz(const char* xyz_file_path);
+
 public:
 	// Scatter constructor, if the pointer is valid it will call the initializer.
 	Scatter(const SCATTER_DESC* pDesc = nullptr);
@@ -2815,19 +3751,61 @@ public:
 	// and will initialize everything as specified, can only be called once per object.
 	void initialize(const SCATTER_DESC* pDesc);
 
+	// Draw override, sends the pending point and color updates to the GPU, selects the
+	// level of detail if enabled, and then issues the draw call. Updates are coalesced 
+	// and uploaded only here.
+	void Draw() override;
+
 	// If updates are enabled this function allows to change the position of the points.
 	// It expects a valid pointer to a 3D vector list as long as the point count, it will 
 	// copy the position data and send it to the GPU for drawing.
 	void updatePoints(Vector3f* point_list);
 
+	// If updates are enabled this function allows to change the position of a range of 
+	// points, starting at the first point specified. It expects a valid pointer to a list 
+	// of 3D vectors as long as the count. Only the modified ranges are sent to the GPU.
+	void updatePoints(const Vector3f* point_list, unsigned first, unsigned count);
+
+	// If updates are enabled this function allows to change the position of a range of points
+	// from three separate coordinate lists, as stored by structure of arrays simulations. Each
+	// list must be as long as the count. Used by the ParticleSystem class for its uploads.
+	void updatePoints(const float* x_list, const float* y_list, const float* z_list, unsigned first, unsigned count);
+
 	// If updates are enabled, and coloring is with a list, this function allows to change 
 	// the current point colors for the new ones specified. It expects a valid pointer 
 	// with a list of colors as long as the point count.
 	void updateColors(Color* color_list);
 
+	// If updates are enabled, and coloring is with a list, this function allows to change 
+	// the colors of a range of points, starting at the first point specified. It expects a
+	// valid pointer to a list of colors as long as the count.
+	void updateColors(const Color* color_list, unsigned first, unsigned count);
+
 	// If the coloring is set to global, updates the global Scatter color.
 	void updateGlobalColor(Color color);
 
+	// If the spatial index is enabled rebuilds it from the current point positions. Refits after
+	// updates keep the original tree, so after big changes in the cloud a rebuild makes queries faster.
+	void rebuildSpatialIndex();
+
+	// If the spatial index is enabled, finds the points whose distance to the line defined by the ray
+	// is smaller than the radius, and writes to the index the one found first along the direction. 
+	// Returns false if no point is found. Coordinates are in scene space, the Scatter rotation, 
+	// distortion and position are taken into account. Points behind the origin are also considered,
+	// since orthographic views see the whole line, use Graphics::getPixelRay() for mouse picking.
+	bool pickPoint(Vector3f ray_origin, Vector3f ray_direction, float radius, unsigned* index) const;
+
+	// If the spatial index is enabled, finds all the points within the radius of the center and
+	// writes their indices to the list, up to the maximum count specified. Returns the number of 
+	// points found, that can be bigger than the maximum. Coordinates are in scene space.
+	unsigned queryRadius(Vector3f center, float radius, unsigned* index_list, unsigned max_count) const;
+
+	// If the spatial index is enabled, finds the k points closest to the point specified and 
+	// writes their indices to the list sorted by distance, and optionally their distances. 
+	// Returns the number of points written, k or the point count if smaller. Coordinates are in
+	// scene space, the Scatter rotation, distortion and position are taken into account.
+	unsigned queryNearest(Vector3f point, unsigned k, unsigned* index_list, float* distance_list = nullptr) const;
+
 	// Updates the rotation quaternion of the Scatter. If multiplicative it will apply
 	// the rotation on top of the current rotation. For more information on how to rotate
 	// with quaternions check the Quaternion header file.
@@ -2859,6 +3837,10 @@ public:
 	// Returns the current screen position.
 	Vector2f getScreenPosition() const;
 
+	// If level of detail is enabled returns the number of points drawn by the last Draw()
+	// call, otherwise returns the point count. Useful to check the level chosen.
+	unsigned getDrawnPointCount() const;
+
 private:
 	// Pointer to the internal class storage.
 	void* scatterData = nullptr;
@@ -2944,7 +3926,9 @@ struct SURFACE_DESC
 		// Colors for each vertex are sampled from an array.
 		ARRAY_COLORING,
 		// The entire function has the same color.
-		GLOBAL_COLORING
+		GLOBAL_COLORING,
+		// A colormap colors each vertex from its height, radius or coordinates.
+		COLORMAP_COLORING
 	}
 	coloring = GLOBAL_COLORING; // Defaults to global coloring.
 
@@ -2968,6 +3952,31 @@ struct SURFACE_DESC
 	// expected to be a cube-box. Check the texture header for more information.
 	Image* texture_image = nullptr;
 
+	// Alternatively to the image pointer, a view of an image region or of a user color
+	// buffer can be given, it is used to create the texture if the image pointer is null.
+	ImageView texture_view = {};
+
+	// If both the image pointer and the view are empty, the texture is created from this
+	// block compressed image, a cube-map for spherical surfaces. It can not be updated.
+	const CompressedImage* texture_compressed = nullptr;
+
+	// If coloring is a colormap, the built in gradient used to color the vertices. Check
+	// the Colormap header for more information on colormaps.
+	COLORMAP colormap = COLORMAP_VIRIDIS;
+
+	// If coloring is a colormap and the pointer is valid, its gradient is used instead of 
+	// the built in one. It is copied, so it does not need to outlive the Surface.
+	const Colormap* custom_colormap = nullptr;
+
+	// If coloring is a colormap, the value of each vertex mapped to a color. The parameters
+	// are the input coordinates u and v of explicit and parametric surfaces, spherical and 
+	// implicit surfaces can only be colored by height or radius.
+	COLORMAP_SCALAR colormap_scalar = COLORMAP_SCALAR_HEIGHT;
+
+	// If coloring is a colormap, values mapped to the ends of the gradient. If the range
+	// is empty the minimum and maximum values of the initial vertices are used.
+	Vector2f colormap_range = {};
+
 	// If the surface is illuminated it specifies how the normal vectors will be computed.
 	enum SURFACE_NORMALS
 	{
@@ -3044,6 +4053,13 @@ struct SURFACE_DESC
 	// Uses a nearest point sampler instead of a linear one.
 	bool pixelated_texture = false;
 
+	// Whether the texture is uploaded with its full mip chain, so that it does not alias
+	// when the Surface is seen from far away. The chain is rebuilt on texture updates.
+	bool texture_mipmaps = false;
+
+	// Filter used to downsample the texture mip chain, check the Image header.
+	MIP_FILTER mipmap_filter = MIP_FILTER_KAISER;
+
 	// Whether the edge values of the range are included in the set.
 	bool border_points_included = true;
 
@@ -3051,6 +4067,15 @@ struct SURFACE_DESC
 	// around the center of coordinates, allows for a nice default that illuminates
 	// everything and distiguishes different areas, disable to set all to black.
 	bool default_initial_lights = true;
+
+	// Whether the Surface keeps a copy of its generated triangle mesh on the CPU, so that
+	// it can be exported with getMeshDesc(), for example to store heavy implicit surfaces.
+	bool enable_mesh_export = false;
+
+	// Whether the Surface keeps a copy of its generated triangle mesh on the CPU, along with a
+	// bounding volume hierarchy built over it, needed by pickTriangle() and queryBox(). The 
+	// hierarchy is built on the first query and refitted or rebuilt after shape updates.
+	bool enable_picking = false;
 };
 
 // Surface drawable class, used for drawing, interaction and visualization of user defined 
@@ -3085,6 +4110,10 @@ public:
 	// uses it to update the texture. Image dimensions must be equal to the initial image.
 	void updateTexture(const Image* texture_image);
 
+	// If updates are enabled and coloring is textured, updates the texture with the rows
+	// of the view. Dimensions must be equal to the initial image.
+	void updateTexture(const ImageView& texture_image);
+
 	// If the coloring is set to global, updates the global Surface color.
 	void updateGlobalColor(Color color);
 
@@ -3129,11 +4158,206 @@ public:
 	// Returns the current screen position.
 	Vector2f getScreenPosition() const;
 
+	// If mesh export is enabled, outputs a Polyhedron descriptor with the current triangle mesh
+	// of the Surface, that can be written with the Polyhedron file writers and loaded back later 
+	// without evaluating the functions again. Positions and triangles are exported, along with
+	// the normals if the Surface is illuminated and the colors if they are per vertex.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	POLYHEDRON_DESC getMeshDesc() const;
+
+	// If picking is enabled, finds the closest triangle hit by the ray given in world 
+	// coordinates, taking into account the rotation, distortion and position of the Surface.
+	// Returns false if no triangle is hit, otherwise writes the hit to the valid pointer. 
+	// Triangle indices refer to the triangle list exported by getMeshDesc().
+	bool pickTriangle(Vector3f origin, Vector3f direction, MESH_PICK* pPick = nullptr) const;
+
+	// If picking is enabled, finds the triangles that intersect the box given in world 
+	// coordinates and writes up to the maximum specified to the list. Returns the total
+	// number of triangles found, even if it is larger than the maximum.
+	unsigned queryBox(Vector3f box_min, Vector3f box_max, unsigned* triangle_list = nullptr, unsigned max_triangles = 0u) const;
+
 private:
 	// Pointer to the internal class storage.
 	void* surfaceData = nullptr;
 };
 
+/* PARTICLE SYSTEM CLASS
+-----------------------------------------------------------------------------------------------------------
+-----------------------------------------------------------------------------------------------------------
+Scatter plots are perfect to display particle simulations, but stepping millions of
+particles one Vector3f at a time quickly becomes the bottleneck. This class is a small
+particle engine made to feed a Scatter at interactive rates.
+
+Particles are stored as a structure of arrays (separate x, y, z, velocity and color
+arrays), every step evaluates the force kernels and integrates the particles in chunks
+that are split across all cores, and the integrator uses SIMD instructions when they are
+available. Every thread has its own fast random generator for noisy forces.
+
+Forces are pluggable, the system comes with gravity, drag, springs to the rest positions
+and random noise, and any user function following the PARTICLE_FORCE signature can be
+added. Once stepped, upload() writes the new state straight into a Scatter created with
+updates enabled and the same point count, the next Draw() sends it to the GPU.
+-----------------------------------------------------------------------------------------------------------
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Particle system descriptor struct, to be created and passed as a pointer to initialize
+// a ParticleSystem. The pointers memory is to be managed by the user, the system copies
+// all the data it needs and does not store any of the original pointers.
+struct PARTICLE_SYSTEM_DESC
+{
+	// Number of particles of the system, to upload it to a Scatter the
+	// Scatter point count must match this number.
+	unsigned particle_count = 0u;
+
+	// Optional list of initial positions as long as the particle count. If nullptr
+	// the particles are spawned uniformly at random inside the spawn box. These are
+	// also the rest positions used by the spring force.
+	Vector3f* position_list = nullptr;
+
+	// If no position list is provided particles will spawn inside this box.
+	Vector3f spawn_min = { -1.f, -1.f, -1.f };
+	Vector3f spawn_max = {  1.f,  1.f,  1.f };
+
+	// Optional list of initial velocities as long as the particle count.
+	// If nullptr all particles start at rest.
+	Vector3f* velocity_list = nullptr;
+
+	// Optional list of colors as long as the particle count, if provided the
+	// colors can be modified and uploaded to point colored Scatters.
+	Color* color_list = nullptr;
+
+	// Seed for the per-thread random generators, if zero the system time is used.
+	unsigned long long seed = 0ull;
+};
+
+// Span of particles given to the force kernels. All arrays point to the first particle
+// of the span and are as long as the count. Kernels must add their acceleration to the
+// ax, ay and az arrays, which are set to zero before the first kernel is called.
+struct PARTICLE_SPAN
+{
+	// Current positions and velocities.
+	const float* x;
+	const float* y;
+	const float* z;
+	const float* vx;
+	const float* vy;
+	const float* vz;
+
+	// Rest positions, the initial particle positions.
+	const float* rest_x;
+	const float* rest_y;
+	const float* rest_z;
+
+	// Acceleration accumulators to be written by the kernels.
+	float* ax;
+	float* ay;
+	float* az;
+
+	// Index of the first particle of the span and number of particles.
+	unsigned first;
+	unsigned count;
+
+	// Time step of the current step call.
+	float dt;
+
+	// Random generator state of the thread running the span, to be used
+	// with ParticleSystem::random(), no other thread will touch it.
+	unsigned long long* random_state;
+};
+
+// Force kernel signature, called for every span of particles on every step. It can be
+// called from multiple threads at the same time on different spans, so it must only
+// write into the span accumulators.
+typedef void (*PARTICLE_FORCE)(const PARTICLE_SPAN& span, void* user_data);
+
+// Particle system class, stores the particles in structure of arrays layout and steps them
+// in parallel applying the forces added. Check the descriptor and the class functions for
+// more information on how to set it up and bind it to a Scatter.
+class ParticleSystem
+{
+public:
+	// Fast per-thread random generator used by the system, returns a uniformly
+	// distributed float in [0, 1) and advances the state (xorshift64*).
+	static inline float random(unsigned long long* state)
+	{
+		unsigned long long x = *state;
+		x ^= x >> 12;
+		x ^= x << 25;
+		x ^= x >> 27;
+		*state = x;
+		return float((x * 0x2545F4914F6CDD1Dull) >> 40) * (1.f / 16777216.f);
+	}
+
+public:
+	// Particle system constructor, if the pointer is valid it will call the initializer.
+	ParticleSystem(const PARTICLE_SYSTEM_DESC* pDesc = nullptr);
+
+	// Frees all the particle arrays.
+	~ParticleSystem();
+
+	// Copies of particle systems are not allowed.
+	ParticleSystem(const ParticleSystem&) = delete;
+	ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+	// Initializes the ParticleSystem, it expects a valid pointer to a descriptor and will
+	// allocate and fill the particle arrays, can only be called once per object.
+	void initialize(const PARTICLE_SYSTEM_DESC* pDesc);
+
+	// Adds a constant acceleration applied to all particles.
+	void addGravity(Vector3f gravity);
+
+	// Adds a linear drag force, the acceleration is minus the coefficient times the velocity.
+	void addDrag(float coefficient);
+
+	// Adds a spring that pulls every particle to its rest position with the stiffness
+	// specified, optionally damped proportionally to the particle velocity.
+	void addSprings(float stiffness, float damping = 0.f);
+
+	// Adds a random acceleration of the amplitude specified in every direction,
+	// generated with the per-thread random generators.
+	void addNoise(float amplitude);
+
+	// Adds a user defined force kernel, the user data pointer is passed to every call.
+	// A maximum of sixteen forces is allowed, built in forces included.
+	void addForce(PARTICLE_FORCE force, void* user_data = nullptr);
+
+	// Removes all the forces of the system.
+	void clearForces();
+
+	// Advances the simulation by the time step specified. Forces are evaluated and the
+	// particles integrated with semi-implicit Euler in parallel chunks.
+	void step(float dt);
+
+	// Writes the current particle positions to the Scatter, that must have been created
+	// with updates enabled and a point count equal to the particle count. If specified and
+	// the system has colors, they are also written to the point colored Scatter.
+	void upload(Scatter& scatter, bool upload_colors = false) const;
+
+	// Returns the number of particles in the system.
+	unsigned getCount() const;
+
+	// Returns the position of the particle specified.
+	Vector3f getPosition(unsigned index) const;
+
+	// Returns the velocity of the particle specified.
+	Vector3f getVelocity(unsigned index) const;
+
+	// Sets the position and velocity of the particle specified.
+	void setParticle(unsigned index, Vector3f position, Vector3f velocity = {});
+
+	// Sets the color of the particle specified, the system must have been created with colors.
+	void setColor(unsigned index, Color color);
+
+	// Direct access to the structure of arrays for custom processing, pointers are valid
+	// until the system is destroyed. Unused outputs can be set to nullptr.
+	void getArrays(float** x, float** y, float** z, float** vx, float** vy, float** vz, Color** colors = nullptr);
+
+private:
+	// Pointer to the internal class storage.
+	void* particleData = nullptr;
+};
+
 #ifdef _INCLUDE_IMGUI
 
 /* IMGUI BASE CLASS MANAGER
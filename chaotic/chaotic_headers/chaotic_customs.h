@@ -602,10 +602,13 @@ https://learn.microsoft.com/en-us/windows/win32/direct3d11/overviews-direct3d-11
 
 // Usage specifier, if the Drawable intends to update the vertices, this can be done from 
 // the Vertex Buffer itself without needing to replace it, set to dynamic if intended.
+// If the updates usually modify only some spans of the buffer set it to partial, then 
+// only the modified ranges are sent to the GPU instead of the entire vertex list.
 enum VERTEX_BUFFER_USAGE
 {
 	VB_USAGE_DEFAULT,
 	VB_USAGE_DYNAMIC,
+	VB_USAGE_PARTIAL,
 };
 
 // Vertex buffer bindable, takes an array of custom Vertices and manages the
@@ -627,18 +630,33 @@ public:
 	// Releases the GPU pointer and deletes the data.
 	~VertexBuffer() override;
 
-	// If the Vertex Buffer has dynamic usage it updates the data with the new Vertices
-	// information. If byteWidth is bigger or usage is not dynamic it will cause assertion.
+	// If the Vertex Buffer has dynamic or partial usage it updates the data with the new 
+	// Vertices information. If byteWidth is bigger or usage is default it will cause assertion.
 	template<typename V>
 	void updateVertices(const V* vertices, unsigned count)
 	{
 		updateVertices((const void*)vertices, sizeof(V), count);
 	}
 
-	// If the Vertex Buffer has dynamic usage it updates the data with the new Vertices
-	// information. If byteWidth is bigger or usage is not dynamic it will cause assertion.
+	// If the Vertex Buffer has dynamic or partial usage it updates the data with the new 
+	// Vertices information. If byteWidth is bigger or usage is default it will cause assertion.
 	void updateVertices(const void* vertices, unsigned stride, unsigned count);
 
+	// If the Vertex Buffer has partial usage it updates only the vertices in the range that 
+	// starts at first, the pointer must point to the new data of the first vertex of the 
+	// range. If the range exceeds the buffer or usage is not partial it will cause assertion.
+	void updateVertexRange(const void* vertices, unsigned first, unsigned count);
+
+	// Marks a range of vertices as modified, to be sent by the next uploadDirtyRanges() call.
+	// Overlapping and adjacent ranges are coalesced, so that few copies are issued per upload.
+	// If the range exceeds the buffer or usage is default it will cause assertion.
+	void markDirtyRange(unsigned first, unsigned count);
+
+	// Sends all the ranges marked as dirty to the GPU, reading them from the full vertex list 
+	// provided, which must have the same layout as the buffer. If most of the buffer is dirty 
+	// or the usage is dynamic the whole list is updated. Does nothing if no range is dirty.
+	void uploadDirtyRanges(const void* vertices);
+
 	// Binds the Vertex Buffer to the global context.
 	void Bind() override;
 
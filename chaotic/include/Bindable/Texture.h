@@ -15,6 +15,21 @@ their GPU binding. To create a texture the Image class is to be used. Internally
 a pointer to an array of colors and the image dimensions. It supports transparencies and 
 image loading and saving from memory.
 
+Textures can also be created from an ImageView, a region of an image or a color buffer owned
+by the user, the rows are read in place with the view stride, so nothing is copied on the CPU.
+
+Textures are created with a single level, unless a MipChain is given, in which case all its
+levels are uploaded and the samplers use the smaller ones when the texture is minified. 
+Dynamic textures with mip levels are updated from a chain with the same level count.
+
+Textures can also be created from a CompressedImage, its BC1, BC3 or BC7 blocks are uploaded
+as they are with all their levels, using a quarter or an eighth of the memory and bandwidth.
+Compressed textures are static, to change them a new Texture must be created.
+
+Float images are uploaded as floating point textures, with 32 or 16 bits per channel as the
+image format, so values outside of [0,1] reach the shaders. They have a single level and are
+updated from float images of the same format.
+
 This bindable also supports cube-maps for background creation. The image uploaded must contain
 the six faces of the cube stacked on top of each other in the order [+X,-X,+Y,-Y,+Z,-Z].
 And the orientation must correspond to what a camera at the origin would see when looking 
@@ -57,6 +72,21 @@ public:
 	// Expects a valid image pointer and creates the texture in the GPU.
 	Texture(const Image* image, TEXTURE_USAGE usage = TEXTURE_USAGE_DEFAULT, TEXTURE_TYPE type = TEXTURE_TYPE_IMAGE, unsigned slot = 0u);
 
+	// Expects a valid image view and creates the texture in the GPU from its rows.
+	Texture(const ImageView& image, TEXTURE_USAGE usage = TEXTURE_USAGE_DEFAULT, TEXTURE_TYPE type = TEXTURE_TYPE_IMAGE, unsigned slot = 0u);
+
+	// Expects a valid mip chain and creates the texture in the GPU with all its levels.
+	// For cube-maps the chain must have been generated as a cube-map.
+	Texture(const MipChain* chain, TEXTURE_USAGE usage = TEXTURE_USAGE_DEFAULT, TEXTURE_TYPE type = TEXTURE_TYPE_IMAGE, unsigned slot = 0u);
+
+	// Expects a valid compressed image and creates the texture in the GPU with all its levels.
+	// The type is deduced from the image, and compressed textures can not be updated.
+	Texture(const CompressedImage* image, unsigned slot = 0u);
+
+	// Expects a valid float image and creates a floating point texture in the GPU, with
+	// 32 or 16 bits per channel depending on the image format.
+	Texture(const ImageF* image, TEXTURE_USAGE usage = TEXTURE_USAGE_DEFAULT, TEXTURE_TYPE type = TEXTURE_TYPE_IMAGE, unsigned slot = 0u);
+
 	// Releases the GPU pointer and deletes the data.
 	~Texture() override;
 
@@ -70,6 +100,18 @@ public:
 	// Dimensions must match the initial image dimensions.
 	void update(const Image* image);
 
+	// If usage is dynamic updates the texture with the rows of the new view.
+	// Dimensions must match the initial image dimensions.
+	void update(const ImageView& image);
+
+	// If usage is dynamic updates every level of the texture with the new mip chain.
+	// Dimensions and level count must match the initial ones.
+	void update(const MipChain* chain);
+
+	// If usage is dynamic updates the texture with the new float image.
+	// Dimensions and format must match the initial image ones.
+	void update(const ImageF* image);
+
 private:
 	// Pointer to the internal Texture data.
 	void* BindableData = nullptr;
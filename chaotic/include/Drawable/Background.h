@@ -33,6 +33,20 @@ struct BACKGROUND_DESC
 	// texture. If the background is dynamic it expects valid cube-map dimensions.
 	Image* image = nullptr;
 
+	// Alternatively to the image pointer, a view of an image region or of a user color
+	// buffer can be given, it is used to create the texture if the image pointer is null.
+	ImageView image_view = {};
+
+	// If both the image pointer and the view are empty and this pointer is valid, the 
+	// background texture is created from this float image, as a floating point texture. 
+	// Float backgrounds are updated with float images and do not support mipmaps.
+	const ImageF* hdr_image = nullptr;
+
+	// If the image pointers and the view are empty, the background texture is created
+	// from this block compressed image, that must be a cube-map for dynamic backgrounds.
+	// Compressed backgrounds do not allow texture updates.
+	const CompressedImage* compressed_image = nullptr;
+
 	// Wether the background is static or dynamic.
 	enum BACKGROUND_TYPE
 	{
@@ -48,6 +62,13 @@ struct BACKGROUND_DESC
 	// Whether the Background texture is pixelated or linearly interpolates.
 	bool pixelated_texture = false;
 
+	// Whether the texture is uploaded with its full mip chain, so that it does not alias
+	// when the image is drawn smaller than its size. The chain is rebuilt on updates.
+	bool texture_mipmaps = false;
+
+	// Filter used to downsample the texture mip chain, check the Image header.
+	MIP_FILTER mipmap_filter = MIP_FILTER_KAISER;
+
 	// If true, when drawn it will override whatever is on the depth buffer and render
 	// target, basically clearing the screen with the background. If drawn first, set 
 	// to true and clearBuffer() is not necessary. Better for performance.
@@ -76,6 +97,14 @@ public:
 	// as the image used in the constructor.
 	void updateTexture(const Image* image);
 
+	// If updates are enabled, updates the background texture with the rows of the view.
+	// Dimensions must be equal to the image used in the constructor.
+	void updateTexture(const ImageView& image);
+
+	// If updates are enabled and the Background was created from a float image, updates
+	// the background texture with the new float image, of the same dimensions and format.
+	void updateTexture(const ImageF* image);
+
 	// If the Background is dynamic, it updates the rotation quaternion of the scene. If 
 	// multiplicative it will apply the rotation on top of the current rotation. For more 
 	// information on how to rotate with quaternions check the Quaternion header file.
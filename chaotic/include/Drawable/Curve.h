@@ -38,7 +38,8 @@ struct CURVE_DESC
 	{
 		FUNCTION_COLORING,
 		LIST_COLORING,
-		GLOBAL_COLORING
+		GLOBAL_COLORING,
+		COLORMAP_COLORING
 	}
 	coloring = GLOBAL_COLORING; // Defaults to global color
 
@@ -53,6 +54,22 @@ struct CURVE_DESC
 	// colors as long as the vertex count.
 	Color* color_list = nullptr;
 
+	// If coloring is a colormap, the built in gradient used to color the vertices. Check
+	// the Colormap header for more information on colormaps.
+	COLORMAP colormap = COLORMAP_VIRIDIS;
+
+	// If coloring is a colormap and the pointer is valid, its gradient is used instead of 
+	// the built in one. It is copied, so it does not need to outlive the Curve.
+	const Colormap* custom_colormap = nullptr;
+
+	// If coloring is a colormap, the value of each vertex mapped to a color. The parameter
+	// of a vertex is the value given to the curve function to generate it.
+	COLORMAP_SCALAR colormap_scalar = COLORMAP_SCALAR_PARAMETER;
+
+	// If coloring is a colormap, values mapped to the ends of the gradient. If the range
+	// is empty the minimum and maximum values of the initial vertices are used.
+	Vector2f colormap_range = {};
+
 	// Sets Order Indepentdent Transparency for the Curve. Check 
 	// Graphics.h or Blender.h for more information on how to use it.
 	bool enable_transparency = false;
@@ -82,10 +99,15 @@ public:
 	// and will initialize everything as specified, can only be called once per object.
 	void initialize(const CURVE_DESC* pDesc);
 
+	// Draw override, sends the pending vertex and color updates to the GPU and 
+	// then issues the draw call. Updates are coalesced and uploaded only here.
+	void Draw() override;
+
 	// If updates are enabled this function allows to change the range of the curve function. It 
 	// expects the initial function pointer to still be callable, it will evaluate it on the new 
 	// range and send the vertices to the GPU. If coloring is functional it also expects the color 
-	// function to still be callable, if coloring is not functional it will reuse the old colors.
+	// function to still be callable, colormaps color the new vertices, and otherwise it will reuse 
+	// the old colors.
 	void updateRange(Vector2f range = {});
 
 	// If updates are enabled, and coloring is with a list, this function allows to change 
@@ -93,6 +115,11 @@ public:
 	// with a list of colors as long as the vertex count.
 	void updateColors(Color* color_list);
 
+	// If updates are enabled, and coloring is with a list, this function allows to change 
+	// the colors of a range of vertices, starting at the first vertex specified. It expects
+	// a valid pointer to a list of colors as long as the count.
+	void updateColors(const Color* color_list, unsigned first, unsigned count);
+
 	// If the coloring is set to global, updates the global Curve color.
 	void updateGlobalColor(Color color);
 
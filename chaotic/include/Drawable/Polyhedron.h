@@ -46,7 +46,9 @@ struct POLYHEDRON_DESC
 	} 
 	coloring = GLOBAL_COLORING; // Defaults to global color
 
-	// If coloring is set to global the shape will have this color.
+	// If coloring is set to global the shape will have this color. Global colored polyhedrons
+	// with per vertex list normals, or without illumination, upload every vertex only once and
+	// draw the triangles by index, which uses less memory and makes updates cheaper.
 	Color global_color = Color::White;
 
 	// If coloring is set to per vertex it expects a valid pointer 
@@ -76,9 +78,18 @@ struct POLYHEDRON_DESC
 		// the normal vector list. So the list must be as long as three times the number
 		// of triangles.
 		PER_TRIANGLE_LIST_NORMALS,
+		// The normal vectors will be computed per vertex by averaging the normals of all
+		// the triangles around it, weighted by their area or their corner angle. Smooth
+		// shading without providing a list, normals are updated along with the vertices.
+		COMPUTED_SMOOTH_NORMALS,
 	}
 	normal_computation = COMPUTED_TRIANGLE_NORMALS; // Defaults to computation.
 
+	// If normals are computed smooth, whether the triangle normals are weighted by the 
+	// angle of their corner at each vertex, instead of by their area. Angle weighting is
+	// more robust for irregular meshes with long thin triangles.
+	bool angle_weighted_normals = false;
+
 	// IF normals are not computed this variable is expected to contain a valid list
 	// of normal vectors as long as the vertex count in case of per vertex normals, 
 	// or as long a three times the triangle count in case of per triangle normals.
@@ -99,6 +110,18 @@ struct POLYHEDRON_DESC
 	// updateVertices(), updateColors(), updateTextureCoordinates() require it.
 	bool enable_updates	= false;
 
+	// Whether the triangles of indexed polyhedrons, global colored with per vertex list
+	// normals, smooth normals or without illumination, are reordered on creation so that
+	// the GPU transforms fewer vertices and draws the outer triangles first. Picked triangles
+	// keep being reported with their original index. Disabled by default, so that the draw
+	// order of existing meshes does not change, enable it for large static meshes.
+	bool optimize_triangle_order = false;
+
+	// Whether the Polyhedron keeps a copy of its positions and triangles on the CPU, along
+	// with a bounding volume hierarchy built over them, needed by pickTriangle() and queryBox().
+	// The hierarchy is built on the first query and refitted after vertex updates.
+	bool enable_picking = false;
+
 	// IF true renders only the aristas of the Polyhedron.
 	bool wire_frame_topology = false;
 
@@ -111,6 +134,68 @@ struct POLYHEDRON_DESC
 	bool default_initial_lights = true;
 };
 
+// Statistics of a vertex weld, optionally reported by Polyhedron::weldVertices().
+struct POLYHEDRON_WELD_STATS
+{
+	// Number of vertices referenced by the triangles before and after the weld.
+	unsigned input_vertex_count = 0u;
+	unsigned output_vertex_count = 0u;
+
+	// Number of triangles before and after the weld.
+	unsigned input_triangle_count = 0u;
+	unsigned output_triangle_count = 0u;
+
+	// Number of triangles dropped because they collapsed into a line or a point.
+	unsigned degenerate_triangle_count = 0u;
+};
+
+// Post transform vertex cache statistics of a descriptor, reported by Polyhedron::analyzeVertexCache().
+struct POLYHEDRON_CACHE_STATS
+{
+	// Number of vertices referenced by the triangles and number of simulated vertex shader 
+	// invocations when drawing them by index with a FIFO cache.
+	unsigned referenced_vertex_count = 0u;
+	unsigned transformed_vertex_count = 0u;
+
+	// Average cache miss ratio, transformed vertices per triangle, from 0.5 to 3.
+	float acmr = 0.f;
+
+	// Average transformed vertex ratio, transformed vertices per referenced vertex, 1 is ideal.
+	float atvr = 0.f;
+};
+
+// Statistics of a simplification, optionally reported by Polyhedron::simplify().
+struct POLYHEDRON_SIMPLIFY_STATS
+{
+	// Number of vertices referenced by the triangles before and after the simplification.
+	unsigned input_vertex_count = 0u;
+	unsigned output_vertex_count = 0u;
+
+	// Number of triangles before and after the simplification.
+	unsigned input_triangle_count = 0u;
+	unsigned output_triangle_count = 0u;
+
+	// Largest distance the surface was moved by a collapse, as a fraction of the mesh size.
+	float result_error = 0.f;
+};
+
+// Closest triangle hit by a ray, reported by the picking functions of the mesh drawables.
+struct MESH_PICK
+{
+	// Index of the triangle hit, on the triangle list of the drawable.
+	unsigned triangle = 0u;
+
+	// Distance from the ray origin to the hit point, in world units.
+	float distance = 0.f;
+
+	// Hit point and unit normal of the triangle, following its winding, in world coordinates.
+	Vector3f point = {};
+	Vector3f normal = {};
+
+	// Weights of the second and third vertices of the triangle at the hit point.
+	Vector2f barycentric = {};
+};
+
 // Polyhedron drawable class, used for drawing and interacting with user defined triangle 
 // meshes on a Graphics instance. Allows for different rendering settings including but not 
 // limited to textures, illumination, transparencies. Check the descriptor to see all options.
@@ -120,9 +205,83 @@ public:
 	// To facilitate the loading of triangle meshes, this function is a parser for 
 	// *.obj files, that reads the files and outputs a valid descriptor. If the file 
 	// supports texturing, optionally accepts an image to be used as texture_image.
+	// If the cache is enabled the result is also stored next to the obj file as a 
+	// binary mesh file (*.obj.cmesh), keyed by the obj file size and modification time,
+	// and later calls with the same obj file and texture size read it instead.
 	// NOTE: All data is allocated by (new) and its deletion must be handled by the 
 	// user. The image pointer used is the same as provided.
-	static POLYHEDRON_DESC getDescFromObj(const char* obj_file_path, Image* texture = nullptr);
+	static POLYHEDRON_DESC getDescFromObj(const char* obj_file_path, Image* texture = nullptr, bool use_cache = false);
+
+	// To facilitate the loading of CAD meshes, this function is a parser for binary *.stl
+	// files. STL stores every triangle with its own three vertices, so corners with the exact
+	// same position are welded into a shared vertex list. Normals are computed per triangle.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	static POLYHEDRON_DESC getDescFromStl(const char* stl_file_path);
+
+	// To facilitate the loading of scanned meshes, this function is a parser for binary *.ply
+	// files. It reads the vertex positions, and the normals, colors and texture coordinates if 
+	// present, and the faces, that are fan triangulated. Texture coordinates are only used if 
+	// an image is provided, otherwise vertex colors are used if present.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	// The image pointer used is the same as provided.
+	static POLYHEDRON_DESC getDescFromPly(const char* ply_file_path, Image* texture = nullptr);
+
+	// Writes the descriptor triangles to a binary *.stl file. STL files only store positions, 
+	// so every triangle is written with its three vertices and its normal.
+	static void writeStlFile(const char* stl_file_path, const POLYHEDRON_DESC* pDesc);
+
+	// Writes the descriptor to a binary little endian *.ply file. Vertex positions are always 
+	// written, normals if they are per vertex and colors if they are per vertex. As PLY colors 
+	// are per vertex, corners of the same vertex with different colors keep one of them.
+	static void writePlyFile(const char* ply_file_path, const POLYHEDRON_DESC* pDesc);
+
+	// Writes the geometry of the descriptor to a binary mesh file (*.cmesh), that can be 
+	// loaded back with getDescFromMesh() or a MeshView without any parsing. Vertices, 
+	// triangles, normals, colors and texture coordinates are stored, along with the coloring 
+	// and normal settings. Texture images are not stored.
+	static void writeMeshFile(const char* mesh_file_path, const POLYHEDRON_DESC* pDesc);
+
+	// Reads a binary mesh file written by writeMeshFile() and outputs a valid descriptor.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	// The image pointer used is the same as provided.
+	static POLYHEDRON_DESC getDescFromMesh(const char* mesh_file_path, Image* texture = nullptr);
+
+	// Welds the vertices of the descriptor that are closer than the epsilon, or that have the
+	// exact same position if it is zero, and outputs a compact descriptor with the vertices in
+	// order of first appearance. Triangles that collapse are dropped, and vertices that no 
+	// triangle references are removed. Useful to shrink meshes with duplicated positions, like
+	// the ones loaded from files with per corner attributes or exported from Surfaces.
+	// Vertices with per vertex normals are only welded if their normals are also equal.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	static POLYHEDRON_DESC weldVertices(const POLYHEDRON_DESC* pDesc, float epsilon = 0.f, POLYHEDRON_WELD_STATS* pStats = nullptr);
+
+	// Simulates the post transform vertex cache of the size specified over the triangles of
+	// the descriptor, as if they were drawn by index, and returns the cache statistics.
+	static POLYHEDRON_CACHE_STATS analyzeVertexCache(const POLYHEDRON_DESC* pDesc, unsigned cache_size = 16u);
+
+	// Reorders the triangles of the descriptor in place for the vertex cache and, optionally,
+	// to reduce overdraw. Per corner colors, texture coordinates and normals are reordered 
+	// along, so the result draws the same. Meant to preprocess meshes offline, for example
+	// before writing them with writeMeshFile(), as indexed polyhedrons already do it on creation.
+	static void optimizeTriangleOrder(POLYHEDRON_DESC* pDesc, bool optimize_overdraw = true);
+
+	// Simplifies the descriptor with quadric error metrics, collapsing vertices onto their
+	// neighbours until the triangle count is at most the target, or until the next collapse
+	// would move the surface further than the target error, given as a fraction of the mesh
+	// size. The target count is not reached if the error limit is hit first, the stats report
+	// the triangles left, and a target error of zero sets no limit. Borders keep their outline,
+	// and vertices where colors, texture coordinates or per triangle normals differ between
+	// corners are kept, so seams and UVs are preserved. The output is compact with the vertices
+	// in order of first appearance. Meshes with duplicated positions should be welded first,
+	// and Surfaces can be simplified through getMeshDesc().
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	static POLYHEDRON_DESC simplify(const POLYHEDRON_DESC* pDesc, unsigned target_triangle_count, float target_error = 0.01f, POLYHEDRON_SIMPLIFY_STATS* pStats = nullptr);
+
+	// Builds a chain of levels of detail of the descriptor, every level is simplified from the
+	// previous one to the reduction specified of its triangles, within the target error. Levels
+	// that reach the error limit stop shrinking. The list must be as long as the level count.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	static void simplifyLODChain(const POLYHEDRON_DESC* pDesc, POLYHEDRON_DESC* lod_list, unsigned lod_count, float reduction = 0.5f, float target_error = 0.05f);
 
 public:
 	// Polyhedron constructor, if the pointer is valid it will call the initializer.
@@ -135,11 +294,27 @@ public:
 	// and will initialize everything as specified, can only be called once per object.
 	void initialize(const POLYHEDRON_DESC* pDesc);
 
+	// Draw override, sends the pending vertex updates to the GPU and then issues
+	// the draw call. Updates are coalesced and uploaded only here.
+	void Draw() override;
+
 	// If updates are enabled this function allows to change the current vertex positions
 	// for the new ones specified. It expects a valid pointer with a list as long as the 
 	// highest index found in the triangle list used for initialization.
 	void updateVertices(const Vector3f* vertex_list);
 
+	// If updates are enabled this function allows to change the positions of a range of 
+	// vertices, starting at the first vertex specified. It expects a valid pointer to a list
+	// of vertices as long as the count. Only the triangles using those vertices are updated.
+	// If the range exceeds the vertex count of the Polyhedron it will cause assertion.
+	void updateVertices(const Vector3f* vertex_list, unsigned first, unsigned count);
+
+	// If updates are enabled this function allows to change the positions of the vertices in
+	// the dirty list. It expects a valid pointer to the full vertex list, of which only the
+	// listed vertices are read, and every vertex is expected to be listed only once. Only the 
+	// triangles using those vertices are updated, which makes local deformations cheap.
+	void updateVertices(const Vector3f* vertex_list, const unsigned* dirty_vertices, unsigned dirty_count);
+
 	// If updates are enabled, and coloring is per vertex, this function allows to change 
 	// the current vertex colors for the new ones specified. It expects a valid pointer 
 	// with a list of colors containing one color per every vertex of every triangle. 
@@ -200,8 +375,57 @@ public:
 
 	// Returns the current screen position.
 	Vector2f getScreenPosition() const;
+
+	// If picking is enabled, finds the closest triangle hit by the ray given in world 
+	// coordinates, taking into account the rotation, distortion and position of the Polyhedron.
+	// Returns false if no triangle is hit, otherwise writes the hit to the valid pointer.
+	bool pickTriangle(Vector3f origin, Vector3f direction, MESH_PICK* pPick = nullptr) const;
+
+	// If picking is enabled, finds the triangles that intersect the box given in world 
+	// coordinates and writes up to the maximum specified to the list. Returns the total
+	// number of triangles found, even if it is larger than the maximum.
+	unsigned queryBox(Vector3f box_min, Vector3f box_max, unsigned* triangle_list = nullptr, unsigned max_triangles = 0u) const;
 	
 private:
 	// Pointer to the internal class storage.
 	void* polyhedronData = nullptr;
-};
\ No newline at end of file
+};
+
+// Read only view of a binary mesh file, the file is memory mapped and the descriptor lists
+// point straight into it, so loading a mesh does not parse or copy anything. The descriptor
+// is valid while the view is open and can be used to initialize any number of Polyhedrons.
+class MeshView
+{
+public:
+	// Mesh view constructor, if the path is valid it will open the mesh file.
+	MeshView(const char* mesh_file_path = nullptr, Image* texture = nullptr);
+
+	// Closes the view.
+	~MeshView();
+
+	// Copies of mesh views are not allowed.
+	MeshView(const MeshView&) = delete;
+	MeshView& operator=(const MeshView&) = delete;
+
+	// Maps the binary mesh file specified, closing the previous one if any. The texture
+	// pointer is set on the descriptor and must be valid for textured meshes.
+	void open(const char* mesh_file_path, Image* texture = nullptr);
+
+	// Opens an obj file through its sidecar cache, if the cache is missing or out of date
+	// the obj file is parsed and the cache written before mapping it.
+	void openObj(const char* obj_file_path, Image* texture = nullptr);
+
+	// Unmaps the file, the descriptor is no longer valid after this call.
+	void close();
+
+	// Returns whether a mesh is currently open.
+	bool isOpen() const;
+
+	// Returns the descriptor of the open mesh, its lists point inside the mapped file and are
+	// valid until the view is closed. It can be used to initialize any number of Polyhedrons.
+	const POLYHEDRON_DESC* getDesc() const;
+
+private:
+	// Pointer to the internal class storage.
+	void* meshData = nullptr;
+};
@@ -38,7 +38,8 @@ struct SCATTER_DESC
 	enum SCATTER_COLORING
 	{
 		POINT_COLORING,
-		GLOBAL_COLORING
+		GLOBAL_COLORING,
+		COLORMAP_COLORING
 	}
 	coloring = GLOBAL_COLORING; // Defaults to global color
 
@@ -49,6 +50,27 @@ struct SCATTER_DESC
 	// to a list of colors containing one color per every point.
 	Color* color_list = nullptr;
 
+	// If coloring is a colormap, the built in gradient used to color the points. Check
+	// the Colormap header for more information on colormaps.
+	COLORMAP colormap = COLORMAP_VIRIDIS;
+
+	// If coloring is a colormap and the pointer is valid, its gradient is used instead of 
+	// the built in one. It is copied, so it does not need to outlive the Scatter.
+	const Colormap* custom_colormap = nullptr;
+
+	// If coloring is a colormap, the value of each point mapped to a color. The parameter
+	// of the points is read from the value list. Points colored by their height or radius 
+	// are colored again when their positions are updated.
+	COLORMAP_SCALAR colormap_scalar = COLORMAP_SCALAR_HEIGHT;
+
+	// If coloring is a colormap with the parameter scalar, it expects a valid pointer to
+	// a list of values containing one value per every point.
+	float* value_list = nullptr;
+
+	// If coloring is a colormap, values mapped to the ends of the gradient. If the range
+	// is empty the minimum and maximum values of the initial points are used.
+	Vector2f colormap_range = {};
+
 	// Specifies how the color of the points will blend with the render target.
 	enum BLENDING_MODE
 	{
@@ -66,6 +88,21 @@ struct SCATTER_DESC
 	// If true it will assume the points are a list of lines by pairs and 
 	// create a line-mesh out of them. Point count must be divisible by two.
 	bool line_mesh = false;
+
+	// If true it builds a hierarchy of voxel downsampled copies of the cloud, where 
+	// every voxel is drawn as the average position and color of its points. At draw 
+	// time the coarsest level that fits the render target scale is used, so huge clouds 
+	// cost as many points as the screen can show. Not compatible with updates or line-mesh.
+	bool enable_lod = false;
+
+	// If level of detail is enabled, maximum size in pixels of the voxels of the
+	// level drawn. Bigger values draw coarser levels and fewer points.
+	float lod_pixel_size = 1.f;
+
+	// If true it builds a spatial index of the points that enables the picking and
+	// neighbourhood queries of the Scatter. If updates are enabled the index is refitted
+	// on every point update, check the query functions for more information.
+	bool enable_spatial_index = false;
 };
 
 // Scatter drawable class, used for drawing and interaction with 3D user created 
@@ -74,6 +111,19 @@ struct SCATTER_DESC
 // more information about the class capabilities.
 class Scatter : public Drawable
 {
+public:
+	// To facilitate the loading of point clouds, this function is a parser for binary
+	// *.ply files, that maps the file and reads the vertex positions, and the vertex 
+	// colors if present, in parallel chunks. Outputs a valid descriptor for the cloud.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	static SCATTER_DESC getDescFromPly(const char* ply_file_path);
+
+	// Parser for plain text point clouds (*.xyz, *.txt, *.csv), one point per line with its
+	// values separated by spaces, commas or semicolons. If lines have six or more values the 
+	// fourth to sixth are read as 0-255 RGB colors. Lines not starting with a number are skipped.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	static SCATTER_DESC getDescFromXyz(const char* xyz_file_path);
+
 public:
 	// Scatter constructor, if the pointer is valid it will call the initializer.
 	Scatter(const SCATTER_DESC* pDesc = nullptr);
@@ -85,19 +135,61 @@ public:
 	// and will initialize everything as specified, can only be called once per object.
 	void initialize(const SCATTER_DESC* pDesc);
 
+	// Draw override, sends the pending point and color updates to the GPU, selects the
+	// level of detail if enabled, and then issues the draw call. Updates are coalesced 
+	// and uploaded only here.
+	void Draw() override;
+
 	// If updates are enabled this function allows to change the position of the points.
 	// It expects a valid pointer to a 3D vector list as long as the point count, it will 
 	// copy the position data and send it to the GPU for drawing.
 	void updatePoints(Vector3f* point_list);
 
+	// If updates are enabled this function allows to change the position of a range of 
+	// points, starting at the first point specified. It expects a valid pointer to a list 
+	// of 3D vectors as long as the count. Only the modified ranges are sent to the GPU.
+	void updatePoints(const Vector3f* point_list, unsigned first, unsigned count);
+
+	// If updates are enabled this function allows to change the position of a range of points
+	// from three separate coordinate lists, as stored by structure of arrays simulations. Each
+	// list must be as long as the count. Used by the ParticleSystem class for its uploads.
+	void updatePoints(const float* x_list, const float* y_list, const float* z_list, unsigned first, unsigned count);
+
 	// If updates are enabled, and coloring is with a list, this function allows to change 
 	// the current point colors for the new ones specified. It expects a valid pointer 
 	// with a list of colors as long as the point count.
 	void updateColors(Color* color_list);
 
+	// If updates are enabled, and coloring is with a list, this function allows to change 
+	// the colors of a range of points, starting at the first point specified. It expects a
+	// valid pointer to a list of colors as long as the count.
+	void updateColors(const Color* color_list, unsigned first, unsigned count);
+
 	// If the coloring is set to global, updates the global Scatter color.
 	void updateGlobalColor(Color color);
 
+	// If the spatial index is enabled rebuilds it from the current point positions. Refits after
+	// updates keep the original tree, so after big changes in the cloud a rebuild makes queries faster.
+	void rebuildSpatialIndex();
+
+	// If the spatial index is enabled, finds the points whose distance to the line defined by the ray
+	// is smaller than the radius, and writes to the index the one found first along the direction. 
+	// Returns false if no point is found. Coordinates are in scene space, the Scatter rotation, 
+	// distortion and position are taken into account. Points behind the origin are also considered,
+	// since orthographic views see the whole line, use Graphics::getPixelRay() for mouse picking.
+	bool pickPoint(Vector3f ray_origin, Vector3f ray_direction, float radius, unsigned* index) const;
+
+	// If the spatial index is enabled, finds all the points within the radius of the center and
+	// writes their indices to the list, up to the maximum count specified. Returns the number of 
+	// points found, that can be bigger than the maximum. Coordinates are in scene space.
+	unsigned queryRadius(Vector3f center, float radius, unsigned* index_list, unsigned max_count) const;
+
+	// If the spatial index is enabled, finds the k points closest to the point specified and 
+	// writes their indices to the list sorted by distance, and optionally their distances. 
+	// Returns the number of points written, k or the point count if smaller. Coordinates are in
+	// scene space, the Scatter rotation, distortion and position are taken into account.
+	unsigned queryNearest(Vector3f point, unsigned k, unsigned* index_list, float* distance_list = nullptr) const;
+
 	// Updates the rotation quaternion of the Scatter. If multiplicative it will apply
 	// the rotation on top of the current rotation. For more information on how to rotate
 	// with quaternions check the Quaternion header file.
@@ -129,6 +221,10 @@ public:
 	// Returns the current screen position.
 	Vector2f getScreenPosition() const;
 
+	// If level of detail is enabled returns the number of points drawn by the last Draw()
+	// call, otherwise returns the point count. Useful to check the level chosen.
+	unsigned getDrawnPointCount() const;
+
 private:
 	// Pointer to the internal class storage.
 	void* scatterData = nullptr;
@@ -1,5 +1,6 @@
 #pragma once
 #include "Drawable.h"
+#include "Polyhedron.h"
 
 /* SURFACE DRAWABLE CLASS
 -------------------------------------------------------------------------------------------------------
@@ -80,7 +81,9 @@ struct SURFACE_DESC
 		// Colors for each vertex are sampled from an array.
 		ARRAY_COLORING,
 		// The entire function has the same color.
-		GLOBAL_COLORING
+		GLOBAL_COLORING,
+		// A colormap colors each vertex from its height, radius or coordinates.
+		COLORMAP_COLORING
 	}
 	coloring = GLOBAL_COLORING; // Defaults to global coloring.
 
@@ -104,6 +107,31 @@ struct SURFACE_DESC
 	// expected to be a cube-box. Check the texture header for more information.
 	Image* texture_image = nullptr;
 
+	// Alternatively to the image pointer, a view of an image region or of a user color
+	// buffer can be given, it is used to create the texture if the image pointer is null.
+	ImageView texture_view = {};
+
+	// If both the image pointer and the view are empty, the texture is created from this
+	// block compressed image, a cube-map for spherical surfaces. It can not be updated.
+	const CompressedImage* texture_compressed = nullptr;
+
+	// If coloring is a colormap, the built in gradient used to color the vertices. Check
+	// the Colormap header for more information on colormaps.
+	COLORMAP colormap = COLORMAP_VIRIDIS;
+
+	// If coloring is a colormap and the pointer is valid, its gradient is used instead of 
+	// the built in one. It is copied, so it does not need to outlive the Surface.
+	const Colormap* custom_colormap = nullptr;
+
+	// If coloring is a colormap, the value of each vertex mapped to a color. The parameters
+	// are the input coordinates u and v of explicit and parametric surfaces, spherical and 
+	// implicit surfaces can only be colored by height or radius.
+	COLORMAP_SCALAR colormap_scalar = COLORMAP_SCALAR_HEIGHT;
+
+	// If coloring is a colormap, values mapped to the ends of the gradient. If the range
+	// is empty the minimum and maximum values of the initial vertices are used.
+	Vector2f colormap_range = {};
+
 	// If the surface is illuminated it specifies how the normal vectors will be computed.
 	enum SURFACE_NORMALS
 	{
@@ -180,6 +208,13 @@ struct SURFACE_DESC
 	// Uses a nearest point sampler instead of a linear one.
 	bool pixelated_texture = false;
 
+	// Whether the texture is uploaded with its full mip chain, so that it does not alias
+	// when the Surface is seen from far away. The chain is rebuilt on texture updates.
+	bool texture_mipmaps = false;
+
+	// Filter used to downsample the texture mip chain, check the Image header.
+	MIP_FILTER mipmap_filter = MIP_FILTER_KAISER;
+
 	// Whether the edge values of the range are included in the set.
 	bool border_points_included = true;
 
@@ -187,6 +222,15 @@ struct SURFACE_DESC
 	// around the center of coordinates, allows for a nice default that illuminates
 	// everything and distiguishes different areas, disable to set all to black.
 	bool default_initial_lights = true;
+
+	// Whether the Surface keeps a copy of its generated triangle mesh on the CPU, so that
+	// it can be exported with getMeshDesc(), for example to store heavy implicit surfaces.
+	bool enable_mesh_export = false;
+
+	// Whether the Surface keeps a copy of its generated triangle mesh on the CPU, along with a
+	// bounding volume hierarchy built over it, needed by pickTriangle() and queryBox(). The 
+	// hierarchy is built on the first query and refitted or rebuilt after shape updates.
+	bool enable_picking = false;
 };
 
 // Surface drawable class, used for drawing, interaction and visualization of user defined 
@@ -221,6 +265,10 @@ public:
 	// uses it to update the texture. Image dimensions must be equal to the initial image.
 	void updateTexture(const Image* texture_image);
 
+	// If updates are enabled and coloring is textured, updates the texture with the rows
+	// of the view. Dimensions must be equal to the initial image.
+	void updateTexture(const ImageView& texture_image);
+
 	// If the coloring is set to global, updates the global Surface color.
 	void updateGlobalColor(Color color);
 
@@ -265,6 +313,24 @@ public:
 	// Returns the current screen position.
 	Vector2f getScreenPosition() const;
 
+	// If mesh export is enabled, outputs a Polyhedron descriptor with the current triangle mesh
+	// of the Surface, that can be written with the Polyhedron file writers and loaded back later 
+	// without evaluating the functions again. Positions and triangles are exported, along with
+	// the normals if the Surface is illuminated and the colors if they are per vertex.
+	// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+	POLYHEDRON_DESC getMeshDesc() const;
+
+	// If picking is enabled, finds the closest triangle hit by the ray given in world 
+	// coordinates, taking into account the rotation, distortion and position of the Surface.
+	// Returns false if no triangle is hit, otherwise writes the hit to the valid pointer. 
+	// Triangle indices refer to the triangle list exported by getMeshDesc().
+	bool pickTriangle(Vector3f origin, Vector3f direction, MESH_PICK* pPick = nullptr) const;
+
+	// If picking is enabled, finds the triangles that intersect the box given in world 
+	// coordinates and writes up to the maximum specified to the list. Returns the total
+	// number of triangles found, even if it is larger than the maximum.
+	unsigned queryBox(Vector3f box_min, Vector3f box_max, unsigned* triangle_list = nullptr, unsigned max_triangles = 0u) const;
+
 private:
 	// Pointer to the internal class storage.
 	void* surfaceData = nullptr;
@@ -130,6 +130,11 @@ public:
 	// Returns the current scals.
 	inline float getScale() const { return Scale; }
 
+	// Computes the scene space ray that goes through the pixel specified, for example the
+	// mouse position, as seen from the current perspective. The origin lies on the plane 
+	// through the center facing the observer, and the direction points into the screen.
+	void getPixelRay(Vector2i pixel, Vector3f* origin, Vector3f* direction) const;
+
 private:
 	// Initializes the class data and calls the creation of the graphics instance.
 	// Initializes all the necessary GPU data to be able to render the graphics objects.
@@ -34,3 +34,4 @@ to deal with library linkage yourself.
 #include "Math/Quaternion.h"
 #include "Math/constants.h"
 #include "Image/Image.h"
+#include "Image/Colormap.h"
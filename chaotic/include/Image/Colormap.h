@@ -0,0 +1,109 @@
+#pragma once
+#include "Color.h"
+
+/* COLORMAP CLASS HEADER
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+Mathematical plots are usually colored by a scalar value of each point, like its height or
+its distance to the origin, mapped to a color gradient. This class stores such a gradient as
+a lookup table of colors, so mapping a value is a multiplication and a table read, and whole
+arrays of values are mapped at once with SIMD instructions by the map() functions.
+
+The most common gradients are built in. The perceptually uniform viridis, magma, inferno and
+plasma, the rainbow like turbo, and the diverging coolwarm and red-blue maps, that are white
+or gray at the center and are meant for signed values. Custom gradients are created from a
+list of colors at the positions specified, and interpolated in between.
+
+Surfaces, curves and scatters can be colored with a colormap directly from their descriptors,
+using the height, the radius or the generation parameter of every vertex, which is much faster
+than calling a coloring function per vertex.
+
+Tables have 256 colors by default, the resolution of the built in gradients. Bigger tables,
+like 4096 colors, give smoother custom gradients over large ranges of values.
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Gradients built into the Colormap class.
+enum COLORMAP
+{
+	COLORMAP_VIRIDIS,	// Perceptually uniform, from dark blue to yellow.
+	COLORMAP_MAGMA,		// Perceptually uniform, from black to light yellow through purple.
+	COLORMAP_INFERNO,	// Perceptually uniform, from black to yellow through red.
+	COLORMAP_PLASMA,	// Perceptually uniform, from blue to yellow through pink.
+	COLORMAP_TURBO,		// Rainbow like, from dark blue to dark red.
+	COLORMAP_COOLWARM,	// Diverging, from blue to red through light gray.
+	COLORMAP_RED_BLUE,	// Diverging, from dark blue to dark red through white.
+	COLORMAP_GRAYSCALE,	// From black to white.
+};
+
+// Scalar value of every vertex that drawables use to color it with a colormap.
+enum COLORMAP_SCALAR
+{
+	COLORMAP_SCALAR_HEIGHT,			// The Z coordinate of the vertex.
+	COLORMAP_SCALAR_RADIUS,			// The distance from the vertex to the origin.
+	COLORMAP_SCALAR_PARAMETER,		// The first parameter of the vertex, check the descriptors.
+	COLORMAP_SCALAR_PARAMETER_V,	// The second parameter of surface vertices.
+};
+
+// Color gradient stored as a lookup table, to color scalar values. Values are mapped
+// linearly from the range given to the table, and values outside of it get the color
+// of the closest end. A reversed range, with the minimum above the maximum, reverses
+// the gradient, and NaN values get the first color.
+class Colormap
+{
+private:
+	// Private variables
+
+	Color* colors_ = nullptr;			// Table of colors of the gradient
+	_float4color* colors4_ = nullptr;	// Same table as float colors for vertex data
+	unsigned size_ = 0u;				// Number of colors in the table
+
+public:
+	// Empty constructor, call generate() before mapping values.
+	Colormap() {}
+
+	// Creates the table of the built in gradient with the number of colors specified.
+	Colormap(COLORMAP map, unsigned size = 256u);
+
+	// Creates the table of a custom gradient from a list of colors at the positions from 0
+	// to 1 specified, in increasing order. If the position list is null the colors are
+	// equally spaced. Colors are interpolated in between and extended past the ends.
+	Colormap(const Color* colors, unsigned count, const float* positions = nullptr, unsigned size = 256u);
+
+	// Copies the table of the other colormap.
+	Colormap(const Colormap& other);
+
+	// Copies the table of the other colormap.
+	Colormap& operator=(const Colormap& other);
+
+	// Frees the table.
+	~Colormap();
+
+	// Replaces the table with the one of the built in gradient specified.
+	void generate(COLORMAP map, unsigned size = 256u);
+
+	// Replaces the table with the one of the custom gradient specified.
+	void generate(const Color* colors, unsigned count, const float* positions = nullptr, unsigned size = 256u);
+
+	// Returns the number of colors in the table.
+	inline unsigned size() const { return size_; }
+
+	// Returns the table of colors, from the minimum value to the maximum.
+	inline const Color* colors() const { return colors_; }
+
+	// Returns the color of a single value in the range specified.
+	Color operator()(float value, float min_value = 0.f, float max_value = 1.f) const;
+
+	// Maps the list of values to colors with the range specified, several values at once.
+	void map(const float* values, Color* colors, unsigned count, float min_value = 0.f, float max_value = 1.f) const;
+
+	// Maps the list of values to float colors with the range specified. The stride is the
+	// distance in bytes between the output colors, so that they can be written directly
+	// inside of interleaved vertex arrays.
+	void map(const float* values, _float4color* colors, unsigned count, float min_value = 0.f, float max_value = 1.f, unsigned stride = sizeof(_float4color)) const;
+
+	// Finds the minimum and maximum values of the list, ignoring NaN and infinite values.
+	// If the list has no finite values both are set to zero.
+	static void findRange(const float* values, unsigned count, float* min_value, float* max_value);
+};
@@ -6,7 +6,7 @@
 -------------------------------------------------------------------------------------------------------
 This image class allows for easy image manipulation from your code. To create an image
 you can create one yourself by specifying the dimensions and the color of each pixel 
-or you can load them from your computer from raw bitmap files using the load() function.
+or you can load them from your computer from bitmap or PNG files using the load() function.
 
 To manipulate the image you can access the pixels directly via tha operator(row,col), or 
 via the pixels() function, the Color class is a BGRA color format class that stores the 
@@ -17,16 +17,50 @@ Then after some image manipulation, using the save() function you can store them
 your computer to your specified path, or in the 3D rendering library you can send it to the 
 GPU as textures for your renderings.
 
-To obtain raw bitmap files from your images I strongly suggest the use of ImageMagick, 
-a simple console command like: "> magick initial_image.*** -compress none image.bmp"
-will give you a raw bitmap of any image.
+Files with the .png extension are read and written as PNG, with a built in codec, and any 
+other path is treated as a bitmap and gets the .bmp extension. PNG files are usually several 
+times smaller than bitmaps, and loaded files are recognized by their contents too.
+
+Big images, like texture cubes, can be opened with map() instead. If the file is a 32 bit 
+top down bitmap its pixel array already has the layout of the image, so the file is memory 
+mapped and the pixels are used in place, without allocating or copying anything. Bitmaps 
+saved with BMP_TOP_DOWN enabled keep their pixels aligned to 64 bytes and can always be 
+mapped, other files are loaded normally.
+
+Pixel arrays are allocated aligned to 64 bytes, and images can be moved, so returning or 
+storing them does not copy the pixels. To pass a region of an image, or a color buffer owned 
+by someone else, without copying it, an ImageView can be used. Views are accepted by textures, 
+backgrounds, surfaces and the ToCube functions, and Image(view) makes an owning copy.
+
+Whole images can be added, multiplied, scaled, interpolated, blended or premultiplied at once
+with the bulk color operations, that process several pixels per instruction with SIMD across 
+the thread pool, many times faster than a loop of Color operators over the pixels.
+
+Textures that are drawn smaller than their size alias unless they have mip levels, a MipChain
+builds them from an image on the CPU, in linear light and across the thread pool, and can be 
+uploaded by textures. Backgrounds and surfaces build them when texture_mipmaps is enabled.
+
+A CompressedImage stores an image or a mip chain as BC1, BC3 or BC7 blocks, compressed on 
+the CPU across the thread pool. Textures upload the blocks as they are, using a quarter or 
+an eighth of the GPU memory, and they can be saved and loaded as DDS files to skip encoding.
+
+An ImageF stores four floats or half floats per pixel instead of bytes, to accumulate many 
+frames or densities without saturating. It is converted from images and back to them with
+tone mapping in SIMD across the thread pool, and can be uploaded as a float texture.
+
+To obtain PNG or raw bitmap files from your images I strongly suggest the use of ImageMagick, 
+a simple console command like: "> magick initial_image.*** image.png" will give you a PNG 
+file of any image, and "-compress none image.bmp" a raw bitmap.
 
 For information on how to install and use ImageMagick you can check https://imagemagick.org/
 -------------------------------------------------------------------------------------------------------
 -------------------------------------------------------------------------------------------------------
 */
 
-// Simple class for handling images, and storing and loading them as BMP files.
+// Non owning view of an image region, declared below.
+class ImageView;
+
+// Simple class for handling images, and storing and loading them as BMP or PNG files.
 class Image
 {
 private:
@@ -37,9 +71,14 @@ private:
 	unsigned width_	 = 0u;	// Stores the width of the image
 	unsigned height_ = 0u;	// Stores the height of the image
 
+	void* mapping_ = nullptr;	// Mapped file holding the pixels, if mapped
+
 	// Internal function to format strings for the templates
 	const char* internal_formatting(const char* fmt_filename, ...);
 
+	// Frees the pixels, or unmaps the file if the image is mapped
+	void release();
+
 public:
 	// Constructors/Destructors
 
@@ -59,6 +98,16 @@ public:
 	// Copies the other image.
 	Image& operator=(const Image& other);
 
+	// Takes the pixels of the other image, leaving it empty.
+	Image(Image&& other) noexcept;
+
+	// Takes the pixels of the other image, leaving it empty.
+	Image& operator=(Image&& other) noexcept;
+
+	// Copies the pixels of the view, which can be a region of another image or any
+	// external color buffer, into a new image.
+	Image(const ImageView& view);
+
 	// Stores a copy of the color pointer.
 	Image(Color* pixels, unsigned width, unsigned height);
 
@@ -73,6 +122,14 @@ public:
 
 	// File functions
 
+	// Compression level used by save() for PNG files, from 0, stored, to 9, smallest.
+	// Low levels are much faster and still several times smaller than bitmaps.
+	static inline unsigned PNG_COMPRESSION_LEVEL = 6u;
+
+	// Whether save() writes bitmaps top down, in the same row order as the image, 
+	// so that they can be opened in place by map(). Bottom up is the common layout.
+	static inline bool BMP_TOP_DOWN = false;
+
 	// Loads an image from the specified file path. Regular string formatting.
 	template<class Arg0, class ...Args>
 	bool load(const char* fmt_filename, Arg0 arg0, Args... args) { return load(internal_formatting(fmt_filename, arg0, args...)); }
@@ -80,6 +137,13 @@ public:
 	// Loads an image from the specified file path.
 	bool load(const char* filename);
 
+	// Maps the file specified and uses its pixels in place if it is a 32 bit top down 
+	// bitmap whose pixels start at a multiple of 64 bytes, otherwise it is loaded normally.
+	// A read only mapping must not be written to, check isReadOnly(), with copy on write 
+	// the pixels can be modified and the file remains unchanged.
+	// The file stays mapped until the image is reset, loaded again or destroyed.
+	bool map(const char* filename, bool copy_on_write = false);
+
 	// Saves the image to the specified file path. Regular string formatting.
 	template<class Arg0, class ...Args>
 	bool save(const char* fmt_filename, Arg0 arg0, Args... args) const { return save(internal_formatting(fmt_filename, arg0, args...)); }
@@ -101,6 +165,17 @@ public:
 	// Returns the image height.
 	inline unsigned height() const { return height_; }
 
+	// Returns whether the pixels live in a mapped file.
+	inline bool isMapped() const { return mapping_ != nullptr; }
+
+	// Returns whether the pixels live in a file mapped read only, that can not be modified.
+	// The bulk color operations refuse these images, and pixels() must not be written to.
+	bool isReadOnly() const;
+
+	// Returns a view of the specified region of the image, that must be inside it.
+	// The view is only valid while the image pixels are not reset or destroyed.
+	ImageView view(unsigned x, unsigned y, unsigned width, unsigned height) const;
+
 	// Accessors
 
 	// Returns a color reference to the specified pixel coordinates.
@@ -110,6 +185,107 @@ public:
 	// Returns a constant color reference to the specified pixel coordinates.
 	inline const Color& operator()(unsigned row, unsigned col) const 
 	{ return pixels_[row * width_ + col]; }
+
+	// Bulk color operations
+
+	// They process the whole image with SIMD instructions, several pixels at once, and the 
+	// rows are spread across the thread pool. Where a Color operator exists the results are 
+	// the same as looping it over the pixels. Views must have the same dimensions as the image.
+
+	// Adds the colors of the view to the image, saturating at 255.
+	void add(const ImageView& other);
+
+	// Adds the color to every pixel, saturating at 255.
+	void add(Color color);
+
+	// Subtracts the colors of the view from the image, saturating at 0.
+	void subtract(const ImageView& other);
+
+	// Multiplies the image by the colors of the view, every channel as a fraction of 255.
+	void multiply(const ImageView& other);
+
+	// Multiplies every pixel by the color, every channel as a fraction of 255.
+	void multiply(Color color);
+
+	// Multiplies every channel by the non negative factor, saturating at 255.
+	void scale(float factor);
+
+	// Linearly interpolates every pixel towards the view by the weight, from 0 to 1.
+	void lerp(const ImageView& other, float weight);
+
+	// Draws the view over the image, with its alpha as the opacity of every pixel. The 
+	// image alpha accumulates the coverage, colors are blended as over an opaque image.
+	void blend(const ImageView& other);
+
+	// Multiplies the color channels of every pixel by its alpha.
+	void premultiply();
+
+	// Divides the color channels of every pixel by its alpha, rounding to the closest value,
+	// the inverse of premultiply(). Fully transparent pixels are left unchanged.
+	void unpremultiply();
+
+	// Replaces every channel by its entry in the table of that channel, which must have 256
+	// values. Channels with a null table are left unchanged. Tables are read per byte, so 
+	// this runs without SIMD, but it is still spread across the thread pool.
+	void applyLUT(const unsigned char* lut_r, const unsigned char* lut_g, const unsigned char* lut_b, const unsigned char* lut_a = nullptr);
+};
+
+// Non owning read only view of a grid of colors, given by a pointer to the first pixel, 
+// the dimensions, and the stride, the number of colors from one row to the next. Images 
+// convert to views of themselves, and views can point to a region of an image or to any
+// color buffer owned by the user, which must outlive the view. Nothing is ever copied.
+class ImageView
+{
+private:
+	// Private variables
+
+	const Color* pixels_ = nullptr;	// Pointer to the first pixel of the view
+
+	unsigned width_  = 0u;	// Stores the width of the view
+	unsigned height_ = 0u;	// Stores the height of the view
+	unsigned stride_ = 0u;	// Colors from the start of a row to the next one
+
+public:
+	// Empty view.
+	ImageView() {}
+
+	// Views the color buffer, if the stride is zero rows are expected to be packed.
+	ImageView(const Color* pixels, unsigned width, unsigned height, unsigned stride = 0u)
+		: pixels_{ pixels }, width_{ width }, height_{ height }, stride_{ stride ? stride : width } {}
+
+	// Views the entire image.
+	ImageView(const Image& image)
+		: ImageView(image.pixels(), image.width(), image.height()) {}
+
+	// Returns a view of the specified region of this view, that must be inside it.
+	ImageView subview(unsigned x, unsigned y, unsigned width, unsigned height) const;
+
+	// Getters
+
+	// Returns the constant pointer to the first pixel of the view.
+	inline const Color* pixels() const { return pixels_; }
+
+	// Returns the view width.
+	inline unsigned width() const { return width_; }
+
+	// Returns the view height.
+	inline unsigned height() const { return height_; }
+
+	// Returns the number of colors from the start of a row to the next one.
+	inline unsigned stride() const { return stride_; }
+
+	// Returns whether the rows are packed one after the other.
+	inline bool isContiguous() const { return stride_ == width_ || height_ <= 1u; }
+
+	// Accessors
+
+	// Returns the constant pointer to the first pixel of the specified row.
+	inline const Color* row(unsigned row) const 
+	{ return pixels_ + (unsigned long long)row * stride_; }
+
+	// Returns a constant color reference to the specified pixel coordinates.
+	inline const Color& operator()(unsigned row, unsigned col) const 
+	{ return pixels_[(unsigned long long)row * stride_ + col]; }
 };
 
 // Since the 3D library uses Texture Cubes as its preferred image projection to 
@@ -119,13 +295,15 @@ public:
 // They expect a valid images and a cube width for the output resolution, and 
 // they will create a cube image and sample its colors from your projection image. 
 // The image is allocated with 'new' and is to be destroyed by the user.
+// The cube rows are converted in parallel across the thread pool, with SIMD
+// projection math and fixed point bilinear sampling.
 struct ToCube
 {
 	// Equirectangular projections are extremely common, they follow the typical
 	// latitude longitude coordinate system and are widely used for all kinds of
 	// applications. This function allows you to convert equirectangular projection
 	// images to texture cubes.
-	static Image* from_equirect(const Image& equirect, unsigned cube_width);
+	static Image* from_equirect(const ImageView& equirect, unsigned cube_width);
 
 	// Depending on the fisheye image the distance from center to angle projection
 	// can be different. IF you are not sure which one your is just try different
@@ -149,5 +327,318 @@ struct ToCube
 	// you to convert your fish-eye 360 pictures into texture cubes.
 	// This function expects 360 fisheye images, so if your images are only half a 
 	// sphere, pass an image double the size with your fisheye image in the middle.
-	static Image* from_fisheye(const Image& fisheye, unsigned cube_width, FISHEYE_TYPE type);
+	static Image* from_fisheye(const ImageView& fisheye, unsigned cube_width, FISHEYE_TYPE type);
+};
+
+// Filters used to downsample the levels of a mip chain. The box filter averages the pixels
+// covered by every level pixel and is the fastest. Kaiser and Lanczos are windowed sinc 
+// filters that keep the levels sharp without aliasing, Lanczos being the sharpest of them.
+enum MIP_FILTER
+{
+	MIP_FILTER_BOX,
+	MIP_FILTER_KAISER,
+	MIP_FILTER_LANCZOS,
+};
+
+// Mip chains are lists of images, each one half the size of the previous one down to a 
+// single pixel, that the GPU samples from when a texture is drawn smaller than its size.
+// They avoid aliasing and shimmering at distance and reduce the texture bandwidth. 
+// This class builds the chain of an image on the CPU, the first level is the image itself,
+// viewed without copying, and every other level is filtered from the previous one with 
+// the rows spread across the thread pool. Filtering is done in linear light with alpha 
+// weighting, so colors keep their brightness and transparent pixels do not bleed. Cube-maps
+// are filtered face by face. To upload a chain to the GPU check the Texture header.
+class MipChain
+{
+private:
+	// Private variables
+
+	ImageView base_;				// View of the first level
+	Image* levels_ = nullptr;		// Array of the following levels
+	unsigned level_count_ = 0u;		// Number of levels including the first one
+
+public:
+	// Whether the colors are converted from sRGB to linear light before filtering, as 
+	// images usually store them. Disable it for images that store other kind of data.
+	static inline bool GAMMA_CORRECT = true;
+
+	// Returns the number of levels of a full chain for the specified dimensions. For 
+	// cube-maps the face width is to be used as both dimensions.
+	static unsigned levelCount(unsigned width, unsigned height);
+
+	// Empty constructor, generate() can be called to build a chain.
+	MipChain() {}
+
+	// Builds the mip chain of the image, check generate() for more information.
+	MipChain(const ImageView& image, MIP_FILTER filter = MIP_FILTER_KAISER, bool cubemap = false, unsigned max_levels = 0u);
+
+	// Frees the levels of the chain.
+	~MipChain();
+
+	// Copies of mip chains are not allowed.
+	MipChain(const MipChain&) = delete;
+	MipChain& operator=(const MipChain&) = delete;
+
+	// Builds the mip chain of the image with the specified filter, replacing the previous
+	// one. If cubemap is true the image is expected to have the six faces stacked, and 
+	// every level keeps that layout. If max levels is not zero the chain is cut there. 
+	// The image is only viewed, so it must outlive the chain.
+	void generate(const ImageView& image, MIP_FILTER filter = MIP_FILTER_KAISER, bool cubemap = false, unsigned max_levels = 0u);
+
+	// Returns the number of levels of the chain, including the first one.
+	inline unsigned levelCount() const { return level_count_; }
+
+	// Returns a view of the specified level, the first level is the original image.
+	ImageView level(unsigned index) const;
+};
+
+// Block compression formats, images are split in blocks of 4x4 pixels stored in a fixed 
+// number of bytes, that the GPU decodes when sampling. BC1 stores the colors in 8 bytes per
+// block with one bit alpha, BC3 adds 8 more bytes of smooth alpha, and BC7 uses 16 bytes 
+// to store colors and alpha with a much higher quality, at a slower compression.
+enum BLOCK_FORMAT
+{
+	BLOCK_FORMAT_BC1,
+	BLOCK_FORMAT_BC3,
+	BLOCK_FORMAT_BC7,
+};
+
+// Block compressed images take four to eight times less memory than regular images, both 
+// in RAM and in the GPU, and are faster to sample. This class compresses images or their 
+// mip chains, encoding the blocks in parallel across the thread pool, and reads and writes 
+// them as DDS files, so big textures can be compressed once offline and loaded directly.
+// Cube-maps store the six faces one after the other, each one with all its levels. The 
+// first level dimensions must be multiples of four. Textures can be created from them.
+class CompressedImage
+{
+private:
+	// Private variables
+
+	unsigned char* blocks_ = nullptr;	// Blocks of every face and level
+	unsigned long long size_ = 0u;		// Size of the blocks in bytes
+
+	BLOCK_FORMAT format_ = BLOCK_FORMAT_BC1;	// Format of the blocks
+	unsigned width_ = 0u;		// Width of the first level
+	unsigned height_ = 0u;		// Height of the first level, of a face for cube-maps
+	unsigned level_count_ = 0u;	// Number of mip levels
+	bool cubemap_ = false;		// Whether the six faces of a cube-map are stored
+
+	// Allocates the blocks for the layout specified, freeing the previous ones
+	void allocate(BLOCK_FORMAT format, unsigned width, unsigned height, unsigned level_count, bool cubemap);
+
+	// Compresses the levels specified, each one half the size of the previous one
+	void compress_levels(const ImageView* levels, unsigned level_count, BLOCK_FORMAT format, bool cubemap);
+
+public:
+	// Constructors/Destructors
+
+	// Empty constructor, compress() or load() can be called to fill it.
+	CompressedImage() {}
+
+	// Initializes the image as stored in the DDS file.
+	CompressedImage(const char* filename);
+
+	// Compresses the image in the format specified, check compress() for more information.
+	CompressedImage(const ImageView& image, BLOCK_FORMAT format, bool cubemap = false);
+
+	// Compresses all the levels of the mip chain in the format specified.
+	CompressedImage(const MipChain* chain, BLOCK_FORMAT format, bool cubemap = false);
+
+	// Takes the blocks of the other image, leaving it empty.
+	CompressedImage(CompressedImage&& other) noexcept;
+
+	// Takes the blocks of the other image, leaving it empty.
+	CompressedImage& operator=(CompressedImage&& other) noexcept;
+
+	// Copies of compressed images are not allowed.
+	CompressedImage(const CompressedImage&) = delete;
+	CompressedImage& operator=(const CompressedImage&) = delete;
+
+	// Frees the blocks.
+	~CompressedImage();
+
+	// Compresses the image in the format specified, replacing the previous contents. If
+	// cubemap is true the image is expected to have the six faces stacked vertically.
+	void compress(const ImageView& image, BLOCK_FORMAT format, bool cubemap = false);
+
+	// Compresses all the levels of the mip chain in the format specified. If cubemap is 
+	// true the chain is expected to have been generated as a cube-map.
+	void compress(const MipChain* chain, BLOCK_FORMAT format, bool cubemap = false);
+
+	// File functions
+
+	// Loads the image from the specified DDS file, with BC1, BC3 or BC7 blocks. 
+	bool load(const char* filename);
+
+	// Saves the image to the specified path as a DDS file.
+	bool save(const char* filename) const;
+
+	// Getters
+
+	// Returns the size in bytes of a block of the specified format.
+	static unsigned blockBytes(BLOCK_FORMAT format);
+
+	// Returns the format of the blocks.
+	inline BLOCK_FORMAT format() const { return format_; }
+
+	// Returns the width of the first level.
+	inline unsigned width() const { return width_; }
+
+	// Returns the height of the first level, for cube-maps the height of a face.
+	inline unsigned height() const { return height_; }
+
+	// Returns the number of mip levels.
+	inline unsigned levelCount() const { return level_count_; }
+
+	// Returns whether the image stores the six faces of a cube-map.
+	inline bool isCubemap() const { return cubemap_; }
+
+	// Returns the size in bytes of all the blocks.
+	inline unsigned long long size() const { return size_; }
+
+	// Returns the number of bytes from a row of blocks of the level to the next one.
+	unsigned rowPitch(unsigned level) const;
+
+	// Returns the pointer to the blocks of the specified level and cube-map face.
+	const unsigned char* blocks(unsigned level, unsigned face = 0u) const;
+};
+
+// Pixel formats of float images, four channels per pixel in RGBA order. RGBA32F stores
+// every channel as a 32 bit float. RGBA16F stores them as 16 bit half floats, using half 
+// the memory, with around three significant digits and values up to 65504.
+enum IMAGEF_FORMAT
+{
+	IMAGEF_RGBA32F,
+	IMAGEF_RGBA16F,
+};
+
+// Operators used when float images are converted to regular images, to bring the color 
+// channels to the range [0,1]. The exposure multiplies the values before the operator. 
+// The alpha channel is always clamped, and negative values always map to zero.
+enum TONE_MAP
+{
+	TONE_MAP_CLAMP,		// Values above one are clamped.
+	TONE_MAP_REINHARD,	// Values are mapped by x / (1 + x), smoothly compressing highlights.
+	TONE_MAP_ACES,		// Filmic curve fitted to the ACES tone mapping, with a toe and a shoulder.
+	TONE_MAP_NORMALIZE,	// Values are divided by the maximum color channel of the image.
+	TONE_MAP_LOG,		// Values are mapped by log(1 + x) / log(1 + max), for wide ranges.
+};
+
+// Images store colors as bytes, so adding many frames together saturates right away. Float 
+// images store four floats or half floats per pixel, to accumulate frames, densities or any 
+// other data at full precision, and are converted to regular images once at the end with a 
+// tone mapping operator. Conversions and accumulation process the pixels with SIMD across
+// the thread pool, and textures can be created from float images directly. Regular images 
+// can be read as they are or decoded from sRGB to linear light, and encoded back the same.
+class ImageF
+{
+private:
+	// Private variables
+
+	void* pixels_ = nullptr;	// Pointer to the pixels, floats or half floats
+
+	unsigned width_	 = 0u;	// Stores the width of the image
+	unsigned height_ = 0u;	// Stores the height of the image
+
+	IMAGEF_FORMAT format_ = IMAGEF_RGBA32F;	// Format of the pixels
+
+public:
+	// Constructors/Destructors
+
+	// Empty constructor, reset() can be called to reshape it.
+	ImageF() {}
+
+	// Creates a float image with the specified size and format, with all values at zero.
+	ImageF(unsigned width, unsigned height, IMAGEF_FORMAT format = IMAGEF_RGBA32F);
+
+	// Converts the colors of the view to floats in the specified format, check load().
+	ImageF(const ImageView& image, IMAGEF_FORMAT format = IMAGEF_RGBA32F, bool linear = false);
+
+	// Copies the other image.
+	ImageF(const ImageF& other);
+
+	// Copies the other image.
+	ImageF& operator=(const ImageF& other);
+
+	// Takes the pixels of the other image, leaving it empty.
+	ImageF(ImageF&& other) noexcept;
+
+	// Takes the pixels of the other image, leaving it empty.
+	ImageF& operator=(ImageF&& other) noexcept;
+
+	// Frees the pixels.
+	~ImageF();
+
+	// Resets the image to the new dimensions and format, with all values at zero.
+	void reset(unsigned width, unsigned height, IMAGEF_FORMAT format = IMAGEF_RGBA32F);
+
+	// Sets every pixel to the color.
+	void fill(_float4color color);
+
+	// Conversions
+
+	// Converts the colors of the view to floats from 0 to 1, replacing the image contents
+	// and keeping its format. If linear is true the colors are decoded from sRGB.
+	void load(const ImageView& image, bool linear = false);
+
+	// Converts the image to a regular image of the same dimensions, with the tone mapping
+	// operator and the exposure specified. If linear is true the colors are encoded to sRGB,
+	// as the inverse of load(). The image is reset if its dimensions are different.
+	void toImage(Image* image, TONE_MAP tone_map = TONE_MAP_CLAMP, float exposure = 1.f, bool linear = false) const;
+
+	// Converts the pixels to the specified format.
+	void convert(IMAGEF_FORMAT format);
+
+	// Accumulation
+
+	// Adds the colors of the view, as floats from 0 to 1 multiplied by the weight. If linear
+	// is true the colors are decoded from sRGB. Dimensions must match.
+	void add(const ImageView& image, float weight = 1.f, bool linear = false);
+
+	// Adds the values of the other float image multiplied by the weight. Dimensions must match.
+	void add(const ImageF& other, float weight = 1.f);
+
+	// Multiplies every channel by the factor.
+	void scale(float factor);
+
+	// Finds the minimum and maximum values of every channel, ignoring NaN and infinite values.
+	// Channels without finite values are set to zero.
+	void findRange(_float4color* min_values, _float4color* max_values) const;
+
+	// Getters
+
+	// Returns the image width.
+	inline unsigned width() const { return width_; }
+
+	// Returns the image height.
+	inline unsigned height() const { return height_; }
+
+	// Returns the format of the pixels.
+	inline IMAGEF_FORMAT format() const { return format_; }
+
+	// Returns the size in bytes of a pixel of the specified format.
+	static unsigned pixelBytes(IMAGEF_FORMAT format);
+
+	// Returns the pointer to the pixels, four floats or half floats per pixel.
+	inline void* data() { return pixels_; }
+
+	// Returns the constant pointer to the pixels, four floats or half floats per pixel.
+	inline const void* data() const { return pixels_; }
+
+	// Returns the pointer to the pixels as float colors if the format is RGBA32F, for 
+	// other formats it returns nullptr. Writing to them directly is the fastest access.
+	inline _float4color* pixels() 
+	{ return format_ == IMAGEF_RGBA32F ? (_float4color*)pixels_ : nullptr; }
+
+	// Returns the constant pointer to the pixels as float colors if the format is RGBA32F.
+	inline const _float4color* pixels() const 
+	{ return format_ == IMAGEF_RGBA32F ? (const _float4color*)pixels_ : nullptr; }
+
+	// Accessors
+
+	// Returns the color of the specified pixel coordinates, in any format.
+	_float4color getPixel(unsigned row, unsigned col) const;
+
+	// Sets the color of the specified pixel coordinates, in any format.
+	void setPixel(unsigned row, unsigned col, _float4color color);
 };
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+/* MAPPED FILE HEADER FILE
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+This internal header contains a minimal read only memory mapped file, used by the file 
+loaders of the library to read big files without copying them into memory first. 
+
+The whole file is mapped on open and the pages are loaded by the operating system as they
+are touched, so multiple threads can parse different regions of the file at the same time.
+It uses file mappings on Windows and mmap for other operating systems.
+
+Files can also be mapped copy on write, then the view can be written through and the 
+modified pages become private copies of the process, the file itself is never changed.
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Read only or copy on write memory mapped file, the mapping lives until the object is
+// closed or destroyed.
+class MappedFile
+{
+public:
+	// Constructor, if the path is valid it will try to open the file.
+	MappedFile(const char* path = nullptr, bool copy_on_write = false);
+
+	// Unmaps the file if open.
+	~MappedFile();
+
+	// Copies of mapped files are not allowed.
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Maps the file specified, closing the previous one if any. Returns 
+	// false if the file could not be opened or mapped.
+	bool open(const char* path, bool copy_on_write = false);
+
+	// Unmaps the file and closes it.
+	void close();
+
+	// Whether a file is currently mapped.
+	inline bool isOpen() const { return is_open; }
+
+	// Pointer to the first byte of the file, nullptr for empty files.
+	inline const char* data() const { return view; }
+
+	// Whether the view is copy on write, only then it can be written to.
+	inline bool isCopyOnWrite() const { return copy_on_write; }
+
+	// Size of the file in bytes.
+	inline unsigned long long size() const { return file_size; }
+
+private:
+	const char* view = nullptr;
+	unsigned long long file_size = 0ull;
+	bool is_open = false;
+	bool copy_on_write = false;
+
+	// Operating system handles.
+	void* file_handle = nullptr;
+	void* mapping_handle = nullptr;
+};
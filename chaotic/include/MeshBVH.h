@@ -0,0 +1,70 @@
+#pragma once
+#include "Math/Matrix.h"
+
+/* MESH BVH HEADER FILE
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+This internal header contains the bounding volume hierarchy used by the triangle mesh
+drawables to answer ray picking and box queries without testing every triangle.
+
+The hierarchy is built top down with the surface area heuristic evaluated over a fixed
+number of bins per axis. The top levels bin their triangles in parallel, and once the
+nodes are small enough every subtree is built on its own thread. When the vertices move
+but the triangles stay the same the node boxes can be refitted bottom up instead.
+
+Queries are given in world coordinates along with the linear transform and the position
+of the drawable, rays are moved to the mesh space, where the boxes were built, and boxes
+are tested against the transformed triangles, so any rotation or distortion is supported.
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Bounding volume hierarchy over an indexed triangle list.
+class MeshBVH
+{
+public:
+	// Closest triangle hit by a ray, in world coordinates.
+	struct Hit
+	{
+		unsigned triangle;		// Index of the triangle in the list used for the build.
+		float distance;			// Distance from the ray origin to the point.
+		Vector3f point;			// Point where the ray hits the triangle.
+		Vector3f normal;		// Unit normal of the triangle, following its winding.
+		Vector2f barycentric;	// Weights of the second and third triangle vertices.
+	};
+
+	// Constructor, the hierarchy is empty until built.
+	MeshBVH() = default;
+
+	// Frees the hierarchy.
+	~MeshBVH();
+
+	// Copies of hierarchies are not allowed.
+	MeshBVH(const MeshBVH&) = delete;
+	MeshBVH& operator=(const MeshBVH&) = delete;
+
+	// Builds the hierarchy over the triangles, replacing the previous one. The indices are
+	// copied but the positions are only referenced, so they must stay valid for the queries.
+	void build(const Vector3f* positions, const unsigned* indices, unsigned triangle_count);
+
+	// Recomputes the node boxes for the new positions, keeping the tree structure. The same
+	// triangles must be used, the positions pointer replaces the one given before.
+	void refit(const Vector3f* positions);
+
+	// Whether the hierarchy has been built.
+	inline bool isBuilt() const { return bvhData != nullptr; }
+
+	// Finds the closest triangle hit by the world ray, given the linear transform and the
+	// position of the mesh. The direction does not need to be normalized. Returns false if
+	// no triangle is hit, both sides of the triangles are considered.
+	bool raycast(const Matrix& transform, Vector3f position, Vector3f origin, Vector3f direction, Hit* pHit) const;
+
+	// Finds the triangles that intersect the world box, given the linear transform and the
+	// position of the mesh, and writes up to the maximum specified to the list. Returns the
+	// total number of triangles found, even if it is larger than the maximum.
+	unsigned queryBox(const Matrix& transform, Vector3f position, Vector3f box_min, Vector3f box_max, unsigned* triangles, unsigned max_triangles) const;
+
+private:
+	// Pointer to the internal hierarchy storage.
+	void* bvhData = nullptr;
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include "Math/Vectors.h"
+
+/* MESH OPTIMIZER HEADER FILE
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+This internal header contains the triangle order optimizers used by the indexed drawables.
+Index order usually comes straight from generation order, which makes the GPU transform
+the same vertices many times and draw hidden triangles before the visible ones.
+
+The vertex cache optimizer follows Tom Forsyth's linear speed algorithm, triangles are
+greedily emitted by a score that favours vertices already in a simulated cache and with
+few triangles left. Big meshes are split in contiguous chunks optimized in parallel.
+
+The overdraw optimizer then splits the cache optimized order in clusters where the cache
+restarts anyway, and sorts the clusters so that the ones facing outwards are drawn first,
+which lets the depth test reject more pixels without ruining the cache efficiency.
+
+The cache analyzer simulates a FIFO cache on the CPU and reports the average cache miss
+ratio (ACMR), transformed vertices per triangle, and the average transformed vertex ratio
+(ATVR), transformed vertices per referenced vertex, so no GPU is needed to measure them.
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Static struct containing the triangle order optimizers.
+struct MeshOptimizer
+{
+	// Post transform vertex cache statistics of an index list.
+	struct CacheStats
+	{
+		unsigned transformed_vertices;	// Simulated vertex shader invocations.
+		unsigned referenced_vertices;	// Different vertices used by the triangles.
+		float acmr;						// Transformed vertices per triangle, from 0.5 to 3.
+		float atvr;						// Transformed vertices per referenced vertex, 1 is ideal.
+	};
+
+	// Simulates a FIFO post transform cache of the size specified over the triangle list and
+	// returns its statistics. Every index must be smaller than the vertex count.
+	static CacheStats analyzeVertexCache(const unsigned* indices, unsigned triangle_count, unsigned vertex_count, unsigned cache_size = 16u);
+
+	// Computes a triangle order for the vertex cache, writes for every new position the index
+	// of the triangle that goes there. The indices themselves are not modified.
+	static void optimizeVertexCache(const unsigned* indices, unsigned triangle_count, unsigned* triangle_order);
+
+	// Computes a triangle order that reduces overdraw while keeping most of the vertex cache
+	// efficiency of the current order, which should already be cache optimized. Clusters are
+	// split wherever the cache efficiency stays within the threshold of the original one.
+	static void optimizeOverdraw(const unsigned* indices, unsigned triangle_count, const Vector3f* positions, unsigned vertex_count, unsigned* triangle_order, float threshold = 1.05f);
+
+	// Optimizes the vertex cache and, if positions are provided, the overdraw of the triangle
+	// list, reordering the indices in place. If an order pointer is provided it receives for
+	// every new position the original triangle, to reorder any per triangle data along.
+	static void optimizeTriangleOrder(unsigned* indices, unsigned triangle_count, unsigned vertex_count, const Vector3f* positions = nullptr, unsigned* triangle_order = nullptr);
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include "Math/Vectors.h"
+
+/* MESH SIMPLIFIER HEADER FILE
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+This internal header contains the triangle mesh simplifier used by the Polyhedron class to
+reduce the triangle count of heavy meshes while keeping their shape.
+
+It follows Garland and Heckbert's quadric error metrics with half edge collapses, every
+vertex accumulates the planes of its triangles, and collapsing a vertex onto a neighbour
+costs the squared distance from the neighbour to those planes. Since vertices are only
+collapsed onto existing ones no new attributes are ever interpolated.
+
+Collapses are applied in passes, every pass finds the cheapest collapse of each vertex in
+parallel, sorts them by cost and applies them greedily while their neighbourhoods do not
+overlap, until the triangle target is met or the error limit is reached.
+
+Border edges add a plane perpendicular to their triangle, so borders keep their outline and
+border vertices only slide along them. Vertices on attribute seams, where the corners of a
+vertex have different attributes, and non manifold vertices are never collapsed.
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Static struct containing the mesh simplifier.
+struct MeshSimplifier
+{
+	// Simplifies the triangle list until it has at most the target triangle count, or until
+	// the next collapse would move the surface further than the target error, given as a
+	// fraction of the mesh size. A target error of zero sets no limit, so only the triangle
+	// count is used. Corner attributes are optional ids, corners with equal ids have equal
+	// attributes. Writes the new triangles, indexing the same vertex list, and for every new
+	// corner the input corner its attributes come from. Both outputs must be as long as the
+	// input indices. Returns the new triangle count and optionally the error.
+	static unsigned simplify(const unsigned* indices, unsigned triangle_count, const Vector3f* positions, unsigned vertex_count,
+		const unsigned long long* corner_attributes, unsigned target_triangle_count, float target_error,
+		unsigned* out_indices, unsigned* out_corners, float* pResultError = nullptr);
+};
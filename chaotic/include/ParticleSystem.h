@@ -0,0 +1,179 @@
+#pragma once
+#include "Drawable/Scatter.h"
+
+/* PARTICLE SYSTEM CLASS
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+Scatter plots are perfect to display particle simulations, but stepping millions of
+particles one Vector3f at a time quickly becomes the bottleneck. This class is a small
+particle engine made to feed a Scatter at interactive rates.
+
+Particles are stored as a structure of arrays (separate x, y, z, velocity and color
+arrays), every step evaluates the force kernels and integrates the particles in chunks
+that are split across all cores, and the integrator uses SIMD instructions when they are
+available. Every thread has its own fast random generator for noisy forces.
+
+Forces are pluggable, the system comes with gravity, drag, springs to the rest positions
+and random noise, and any user function following the PARTICLE_FORCE signature can be
+added. Once stepped, upload() writes the new state straight into a Scatter created with
+updates enabled and the same point count, the next Draw() sends it to the GPU.
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Particle system descriptor struct, to be created and passed as a pointer to initialize
+// a ParticleSystem. The pointers memory is to be managed by the user, the system copies
+// all the data it needs and does not store any of the original pointers.
+struct PARTICLE_SYSTEM_DESC
+{
+	// Number of particles of the system, to upload it to a Scatter the
+	// Scatter point count must match this number.
+	unsigned particle_count = 0u;
+
+	// Optional list of initial positions as long as the particle count. If nullptr
+	// the particles are spawned uniformly at random inside the spawn box. These are
+	// also the rest positions used by the spring force.
+	Vector3f* position_list = nullptr;
+
+	// If no position list is provided particles will spawn inside this box.
+	Vector3f spawn_min = { -1.f, -1.f, -1.f };
+	Vector3f spawn_max = {  1.f,  1.f,  1.f };
+
+	// Optional list of initial velocities as long as the particle count.
+	// If nullptr all particles start at rest.
+	Vector3f* velocity_list = nullptr;
+
+	// Optional list of colors as long as the particle count, if provided the
+	// colors can be modified and uploaded to point colored Scatters.
+	Color* color_list = nullptr;
+
+	// Seed for the per-thread random generators, if zero the system time is used.
+	unsigned long long seed = 0ull;
+};
+
+// Span of particles given to the force kernels. All arrays point to the first particle
+// of the span and are as long as the count. Kernels must add their acceleration to the
+// ax, ay and az arrays, which are set to zero before the first kernel is called.
+struct PARTICLE_SPAN
+{
+	// Current positions and velocities.
+	const float* x;
+	const float* y;
+	const float* z;
+	const float* vx;
+	const float* vy;
+	const float* vz;
+
+	// Rest positions, the initial particle positions.
+	const float* rest_x;
+	const float* rest_y;
+	const float* rest_z;
+
+	// Acceleration accumulators to be written by the kernels.
+	float* ax;
+	float* ay;
+	float* az;
+
+	// Index of the first particle of the span and number of particles.
+	unsigned first;
+	unsigned count;
+
+	// Time step of the current step call.
+	float dt;
+
+	// Random generator state of the thread running the span, to be used
+	// with ParticleSystem::random(), no other thread will touch it.
+	unsigned long long* random_state;
+};
+
+// Force kernel signature, called for every span of particles on every step. It can be
+// called from multiple threads at the same time on different spans, so it must only
+// write into the span accumulators.
+typedef void (*PARTICLE_FORCE)(const PARTICLE_SPAN& span, void* user_data);
+
+// Particle system class, stores the particles in structure of arrays layout and steps them
+// in parallel applying the forces added. Check the descriptor and the class functions for
+// more information on how to set it up and bind it to a Scatter.
+class ParticleSystem
+{
+public:
+	// Fast per-thread random generator used by the system, returns a uniformly
+	// distributed float in [0, 1) and advances the state (xorshift64*).
+	static inline float random(unsigned long long* state)
+	{
+		unsigned long long x = *state;
+		x ^= x >> 12;
+		x ^= x << 25;
+		x ^= x >> 27;
+		*state = x;
+		return float((x * 0x2545F4914F6CDD1Dull) >> 40) * (1.f / 16777216.f);
+	}
+
+public:
+	// Particle system constructor, if the pointer is valid it will call the initializer.
+	ParticleSystem(const PARTICLE_SYSTEM_DESC* pDesc = nullptr);
+
+	// Frees all the particle arrays.
+	~ParticleSystem();
+
+	// Copies of particle systems are not allowed.
+	ParticleSystem(const ParticleSystem&) = delete;
+	ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+	// Initializes the ParticleSystem, it expects a valid pointer to a descriptor and will
+	// allocate and fill the particle arrays, can only be called once per object.
+	void initialize(const PARTICLE_SYSTEM_DESC* pDesc);
+
+	// Adds a constant acceleration applied to all particles.
+	void addGravity(Vector3f gravity);
+
+	// Adds a linear drag force, the acceleration is minus the coefficient times the velocity.
+	void addDrag(float coefficient);
+
+	// Adds a spring that pulls every particle to its rest position with the stiffness
+	// specified, optionally damped proportionally to the particle velocity.
+	void addSprings(float stiffness, float damping = 0.f);
+
+	// Adds a random acceleration of the amplitude specified in every direction,
+	// generated with the per-thread random generators.
+	void addNoise(float amplitude);
+
+	// Adds a user defined force kernel, the user data pointer is passed to every call.
+	// A maximum of sixteen forces is allowed, built in forces included.
+	void addForce(PARTICLE_FORCE force, void* user_data = nullptr);
+
+	// Removes all the forces of the system.
+	void clearForces();
+
+	// Advances the simulation by the time step specified. Forces are evaluated and the
+	// particles integrated with semi-implicit Euler in parallel chunks.
+	void step(float dt);
+
+	// Writes the current particle positions to the Scatter, that must have been created
+	// with updates enabled and a point count equal to the particle count. If specified and
+	// the system has colors, they are also written to the point colored Scatter.
+	void upload(Scatter& scatter, bool upload_colors = false) const;
+
+	// Returns the number of particles in the system.
+	unsigned getCount() const;
+
+	// Returns the position of the particle specified.
+	Vector3f getPosition(unsigned index) const;
+
+	// Returns the velocity of the particle specified.
+	Vector3f getVelocity(unsigned index) const;
+
+	// Sets the position and velocity of the particle specified.
+	void setParticle(unsigned index, Vector3f position, Vector3f velocity = {});
+
+	// Sets the color of the particle specified, the system must have been created with colors.
+	void setColor(unsigned index, Color color);
+
+	// Direct access to the structure of arrays for custom processing, pointers are valid
+	// until the system is destroyed. Unused outputs can be set to nullptr.
+	void getArrays(float** x, float** y, float** z, float** vx, float** vy, float** vz, Color** colors = nullptr);
+
+private:
+	// Pointer to the internal class storage.
+	void* particleData = nullptr;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+/* PLY FORMAT HEADER FILE
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+This internal header contains the small helpers shared by the PLY loaders of the library,
+the point cloud loader of the Scatter class and the mesh loader of the Polyhedron class.
+
+They convert the property type names found on the PLY headers, read scalar values of any
+type and byte order from the mapped file data, and split the header into words.
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+*/
+
+#include <cstring>
+
+// Scalar types found in PLY properties.
+enum PLY_TYPE
+{
+	PLY_INVALID,
+	PLY_INT8,
+	PLY_UINT8,
+	PLY_INT16,
+	PLY_UINT16,
+	PLY_INT32,
+	PLY_UINT32,
+	PLY_FLOAT32,
+	PLY_FLOAT64,
+};
+
+// Returns the PLY type from its name, both naming conventions are accepted.
+static inline PLY_TYPE ply_type(const char* name, unsigned length)
+{
+	struct { const char* name; PLY_TYPE type; } names[] =
+	{
+		{ "char", PLY_INT8 },		{ "int8", PLY_INT8 },
+		{ "uchar", PLY_UINT8 },		{ "uint8", PLY_UINT8 },
+		{ "short", PLY_INT16 },		{ "int16", PLY_INT16 },
+		{ "ushort", PLY_UINT16 },	{ "uint16", PLY_UINT16 },
+		{ "int", PLY_INT32 },		{ "int32", PLY_INT32 },
+		{ "uint", PLY_UINT32 },		{ "uint32", PLY_UINT32 },
+		{ "float", PLY_FLOAT32 },	{ "float32", PLY_FLOAT32 },
+		{ "double", PLY_FLOAT64 },	{ "float64", PLY_FLOAT64 },
+	};
+
+	for (auto& entry : names)
+		if (strlen(entry.name) == length && !strncmp(entry.name, name, length))
+			return entry.type;
+
+	return PLY_INVALID;
+}
+
+// Returns the size in bytes of a PLY type.
+static inline unsigned ply_size(PLY_TYPE type)
+{
+	switch (type)
+	{
+	case PLY_INT8: case PLY_UINT8:		return 1u;
+	case PLY_INT16: case PLY_UINT16:	return 2u;
+	case PLY_INT32: case PLY_UINT32:	return 4u;
+	case PLY_FLOAT32:					return 4u;
+	case PLY_FLOAT64:					return 8u;
+	default:							return 0u;
+	}
+}
+
+// Reads a PLY value of the type specified, swapping the bytes if the file endianness differs.
+static inline double ply_read(const char* src, PLY_TYPE type, bool swap)
+{
+	unsigned char bytes[8];
+	unsigned size = ply_size(type);
+	for (unsigned i = 0u; i < size; i++)
+		bytes[i] = (unsigned char)src[swap ? size - 1u - i : i];
+
+	switch (type)
+	{
+	case PLY_INT8:		{ signed char v;			memcpy(&v, bytes, 1u); return v; }
+	case PLY_UINT8:		{ unsigned char v;			memcpy(&v, bytes, 1u); return v; }
+	case PLY_INT16:		{ short v;					memcpy(&v, bytes, 2u); return v; }
+	case PLY_UINT16:	{ unsigned short v;			memcpy(&v, bytes, 2u); return v; }
+	case PLY_INT32:		{ int v;					memcpy(&v, bytes, 4u); return v; }
+	case PLY_UINT32:	{ unsigned v;				memcpy(&v, bytes, 4u); return v; }
+	case PLY_FLOAT32:	{ float v;					memcpy(&v, bytes, 4u); return v; }
+	case PLY_FLOAT64:	{ double v;					memcpy(&v, bytes, 8u); return v; }
+	default:			return 0.0;
+	}
+}
+
+// Converts a PLY color channel to 8 bits, integers are scaled by their range, floats from [0,1].
+static inline unsigned char ply_channel(double value, PLY_TYPE type)
+{
+	switch (type)
+	{
+	case PLY_UINT16:	value /= 257.0;			break;
+	case PLY_FLOAT32:
+	case PLY_FLOAT64:	value *= 255.0;			break;
+	default:									break;
+	}
+
+	return value <= 0.0 ? 0u : value >= 255.0 ? 255u : (unsigned char)(value + 0.5);
+}
+
+// Returns the next whitespace separated word of the PLY header and advances the cursor.
+// Stops at line ends, the word length is written to the length pointer.
+static inline const char* ply_word(const char*& cursor, const char* end, unsigned* length)
+{
+	while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+		cursor++;
+
+	const char* word = cursor;
+	while (cursor < end && *cursor != ' ' && *cursor != '\t' && *cursor != '\r' && *cursor != '\n')
+		cursor++;
+
+	*length = unsigned(cursor - word);
+	return word;
+}
+
+// Whether the header word is equal to the name specified.
+static inline bool ply_equals(const char* word, unsigned length, const char* name)
+{
+	return strlen(name) == length && !strncmp(word, name, length);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "Image/Image.h"
+
+/* PNG CODEC HEADER FILE
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+This internal header contains the self contained PNG decoder and encoder used by the Image
+class to load and save compressed images without any external dependency.
+
+The decoder supports every standard PNG format, all bit depths and color types, palettes,
+transparency chunks and interlaced images, and converts them to BGRA colors. The inflater
+decodes the Huffman codes through lookup tables and checks the stream checksum.
+
+The encoder writes 8 bit RGB images, or RGBA if any pixel is not opaque. Every row gets the
+filter with the smallest sum of absolute differences, and the filtered data is compressed
+with hash chain LZ77 and dynamic Huffman blocks, in independent chunks across the thread
+pool that are joined into a single stream. Level 0 stores the data, 1 to 3 use greedy
+matching with short chains, and higher levels use lazy matching with longer chains.
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Static struct containing the PNG codec.
+struct PngCodec
+{
+	// Whether the data starts with the PNG signature.
+	static bool isPng(const void* data, unsigned long long size);
+
+	// Decodes the PNG file data into the image. Returns false if the data is not a valid 
+	// PNG file, in which case the image is left unchanged.
+	static bool decode(const void* data, unsigned long long size, Image* pImage);
+
+	// Encodes the pixels as a PNG file with the compression level specified, from 0 to 9.
+	// The file data is allocated with malloc() and must be freed by the caller.
+	static bool encode(const Color* pixels, unsigned width, unsigned height, unsigned level, unsigned char** pData, unsigned long long* pSize);
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+/* THREAD POOL HEADER FILE
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+This internal header contains the small thread pool used by the library to split heavy
+CPU work, like particle stepping, mesh processing or image conversions, across all the
+available cores.
+
+The pool is created the first time it is used and lives until the program ends. Work is
+handed out in chunks of a fixed size, so the caller can rely on every chunk being at most
+that long, and every chunk receives the index of the thread running it, which allows for
+per-thread scratch memory or random generators without any locking.
+
+Calls to parallelFor() made from inside a chunk run serially on the calling thread, and
+calls from different user threads are serialized, so the helpers are always safe to use.
+-------------------------------------------------------------------------------------------------------
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Static struct containing the thread pool helpers, the pool itself is internal.
+struct ThreadPool
+{
+	// Task signature, processes the elements [begin, end) on the thread specified.
+	typedef void (*TASK)(unsigned begin, unsigned end, unsigned thread, void* user_data);
+
+	// Returns the number of threads that can run chunks simultaneously, including the
+	// calling thread. Thread indices given to the tasks are always smaller than this.
+	static unsigned threadCount();
+
+	// Splits the range [0, count) in chunks of the size specified and calls the task for
+	// every chunk across the pool threads. The call blocks until all chunks are done.
+	static void parallelFor(unsigned count, unsigned chunk, TASK task, void* user_data);
+
+	// Templated version of parallelFor(), accepts any callable object with the signature
+	// (unsigned begin, unsigned end, unsigned thread), for example a capturing lambda.
+	template<typename F>
+	static void parallelFor(unsigned count, unsigned chunk, const F& func)
+	{
+		parallelFor(count, chunk,
+			[](unsigned begin, unsigned end, unsigned thread, void* user_data)
+			{ (*(const F*)user_data)(begin, end, thread); },
+			(void*)&func);
+	}
+
+	// Sorts the keys in ascending order in parallel, moving the values along with them.
+	// Least significant digit radix sort, only the lowest key bits specified are sorted,
+	// so for example 63 bit Morton codes only need six passes. The sort is stable.
+	static void radixSort(unsigned long long* keys, unsigned* values, unsigned count, unsigned key_bits = 64u);
+};
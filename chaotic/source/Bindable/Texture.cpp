@@ -12,115 +12,266 @@ struct TextureInternals
 	ComPtr<ID3D11ShaderResourceView> pTextureView;
 	Vector2i dimensions;
 	unsigned slot;
+	unsigned levels;
+	DXGI_FORMAT format;
 	TEXTURE_USAGE usage;
 	TEXTURE_TYPE type;
 };
 
+// Maximum number of mip levels of a texture, enough for any dimensions.
+#define MAX_TEXTURE_LEVELS 32u
+
 /*
 --------------------------------------------------------------------------------------------
  Texture Functions
 --------------------------------------------------------------------------------------------
 */
 
-// Takes the Images reference and creates the texture in the GPU.
+// Helper function to check the image pointer before viewing it.
 
-Texture::Texture(const Image* image, TEXTURE_USAGE usage, TEXTURE_TYPE type, unsigned slot)
+static ImageView checked_view(const Image* image)
 {
 	USER_CHECK(image,
-		"Found nullptr when expecting an Image to create a Texture."
+		"Found nullptr when expecting an Image to create or update a Texture."
 	);
 
-	BindableData = new TextureInternals;
-	TextureInternals& data = *(TextureInternals*)BindableData;
-	data.slot = slot;
-	data.usage = usage;
-	data.type = type;
-	data.dimensions = { image->width(), image->height() };
+	return ImageView(*image);
+}
+
+// Creates the texture resource and its view with the format, the face dimensions and the
+// level count stored in the data. The subresources are stored face by face with their mip 
+// levels. Dynamic textures with mip levels are updated with UpdateSubresource(), since the 
+// mappable dynamic usage only allows a single level.
 
-	switch (type)
+static void create_resource(ID3D11Device* pDevice, TextureInternals& data, DXGI_FORMAT format, unsigned width, unsigned height, const D3D11_SUBRESOURCE_DATA* psd)
+{
+	data.format = format;
+
+	const bool mappable = data.usage == TEXTURE_USAGE_DYNAMIC && data.levels == 1u;
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Usage				= mappable ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
+	textureDesc.CPUAccessFlags		= mappable ? D3D11_CPU_ACCESS_WRITE : 0u;
+	textureDesc.Width				= width;
+	textureDesc.Height				= height;
+	textureDesc.MipLevels			= data.levels;
+	textureDesc.Format				= format;
+	textureDesc.SampleDesc.Count	= 1u;
+	textureDesc.SampleDesc.Quality	= 0u;
+	textureDesc.BindFlags			= D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = format;
+
+	switch (data.type)
 	{
 	case TEXTURE_TYPE_IMAGE:
-	{
-		// Create texture resource 
-
-		D3D11_TEXTURE2D_DESC textureDesc = {};
-		textureDesc.Width				= image->width();
-		textureDesc.Height				= image->height();
-		textureDesc.Usage				= (usage == TEXTURE_USAGE_DYNAMIC) ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
-		textureDesc.CPUAccessFlags		= (usage == TEXTURE_USAGE_DYNAMIC) ? D3D11_CPU_ACCESS_WRITE : 0u;
-		textureDesc.MipLevels			= 1u;
-		textureDesc.ArraySize			= 1u;
-		textureDesc.Format				= DXGI_FORMAT_B8G8R8A8_UNORM;
-		textureDesc.SampleDesc.Count	= 1u;
-		textureDesc.SampleDesc.Quality	= 0u;
-		textureDesc.BindFlags			= D3D11_BIND_SHADER_RESOURCE;
-		textureDesc.MiscFlags			= 0u;
-		D3D11_SUBRESOURCE_DATA sd = {};
-		sd.pSysMem = image->pixels();
-		sd.SysMemPitch = image->width() * sizeof(Color);
-
-		GRAPHICS_HR_CHECK(_device->CreateTexture2D(&textureDesc, &sd, data.pTexture.GetAddressOf()));
-
-		// Create the resource view on the texture
-
-		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Format = textureDesc.Format;
+		textureDesc.ArraySize	= 1u;
+		textureDesc.MiscFlags	= 0u;
+
 		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 		srvDesc.Texture2D.MostDetailedMip = 0u;
-		srvDesc.Texture2D.MipLevels = 1u;
+		srvDesc.Texture2D.MipLevels = data.levels;
+		break;
+
+	case TEXTURE_TYPE_CUBEMAP:
+		textureDesc.ArraySize	= 6u;
+		textureDesc.MiscFlags	= D3D11_RESOURCE_MISC_TEXTURECUBE;
 
-		GRAPHICS_HR_CHECK(_device->CreateShaderResourceView(data.pTexture.Get(), &srvDesc, data.pTextureView.GetAddressOf()));
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MostDetailedMip = 0u;
+		srvDesc.TextureCube.MipLevels = data.levels;
 		break;
+
+	default:
+		USER_ERROR("Unknown texture type found when trying to create a Texture.");
 	}
 
-	case TEXTURE_TYPE_CUBEMAP:
-	{
-		USER_CHECK(image->width() * 6u == image->height(),
-			"Invalid image dimensions found when trying to create a cubemap Texture.\n"
-			"To create a cubemap Texture the 6 sides must be stacked on top of each other.\n"
-			"Image dimensions must be (width, height = 6 * width)."
-		);
-
-		// Create cubemap texture resource
-
-		D3D11_TEXTURE2D_DESC textureDesc = {};
-		textureDesc.Width				= image->width();
-		textureDesc.Height				= image->width();
-		textureDesc.Usage				= (usage == TEXTURE_USAGE_DYNAMIC) ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
-		textureDesc.CPUAccessFlags		= (usage == TEXTURE_USAGE_DYNAMIC) ? D3D11_CPU_ACCESS_WRITE : 0u;
-		textureDesc.MipLevels			= 1u;
-		textureDesc.ArraySize			= 6u;
-		textureDesc.Format				= DXGI_FORMAT_B8G8R8A8_UNORM;
-		textureDesc.SampleDesc.Count	= 1u;
-		textureDesc.SampleDesc.Quality	= 0u;
-		textureDesc.BindFlags			= D3D11_BIND_SHADER_RESOURCE;
-		textureDesc.MiscFlags			= D3D11_RESOURCE_MISC_TEXTURECUBE;
-
-		D3D11_SUBRESOURCE_DATA psd[6] = {};
-		const unsigned faceBytes = image->width() * image->width() * sizeof(Color);
-		for (unsigned face = 0u; face < 6; face++)
+	GRAPHICS_HR_CHECK(pDevice->CreateTexture2D(&textureDesc, psd, data.pTexture.GetAddressOf()));
+	GRAPHICS_HR_CHECK(pDevice->CreateShaderResourceView(data.pTexture.Get(), &srvDesc, data.pTextureView.GetAddressOf()));
+}
+
+// Creates the texture from the levels specified, that must be consecutive mip levels 
+// starting at the full size one. Cube-map levels contain the six faces stacked.
+
+static void create_texture(ID3D11Device* pDevice, TextureInternals& data, const ImageView* levels, unsigned level_count)
+{
+	const ImageView& image = levels[0];
+
+	USER_CHECK(image.pixels() && image.width() && image.height(),
+		"Found an empty image view when trying to create a Texture."
+	);
+
+	USER_CHECK(data.type != TEXTURE_TYPE_CUBEMAP || image.width() * 6u == image.height(),
+		"Invalid image dimensions found when trying to create a cubemap Texture.\n"
+		"To create a cubemap Texture the 6 sides must be stacked on top of each other.\n"
+		"Image dimensions must be (width, height = 6 * width)."
+	);
+
+	data.dimensions = { image.width(), image.height() };
+	data.levels = level_count;
+
+	const unsigned faces = data.type == TEXTURE_TYPE_CUBEMAP ? 6u : 1u;
+
+	D3D11_SUBRESOURCE_DATA psd[6u * MAX_TEXTURE_LEVELS] = {};
+	for (unsigned face = 0u; face < faces; face++)
+		for (unsigned mip = 0u; mip < level_count; mip++)
 		{
-			psd[face].pSysMem = (byte*)image->pixels() + face * faceBytes;
-			psd[face].SysMemPitch = image->width() * sizeof(Color);
+			const unsigned face_height = levels[mip].height() / faces;
+
+			psd[face * level_count + mip].pSysMem = levels[mip].row(face * face_height);
+			psd[face * level_count + mip].SysMemPitch = levels[mip].stride() * sizeof(Color);
 		}
-		GRAPHICS_HR_CHECK(_device->CreateTexture2D(&textureDesc, psd, data.pTexture.GetAddressOf()));
 
-		// Create the resource view on the texture
+	create_resource(pDevice, data, DXGI_FORMAT_B8G8R8A8_UNORM, image.width(), image.height() / faces, psd);
+}
 
-		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Format = textureDesc.Format;
-		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
-		srvDesc.TextureCube.MostDetailedMip = 0u;
-		srvDesc.TextureCube.MipLevels = 1u;
+// Returns the texture format of the float image format.
 
-		GRAPHICS_HR_CHECK(_device->CreateShaderResourceView(data.pTexture.Get(), &srvDesc, data.pTextureView.GetAddressOf()));
-		break;
+static DXGI_FORMAT float_format(IMAGEF_FORMAT format)
+{
+	return format == IMAGEF_RGBA32F ? DXGI_FORMAT_R32G32B32A32_FLOAT : DXGI_FORMAT_R16G16B16A16_FLOAT;
+}
+
+// Copies the rows to the mapped texture, face by face for cube-maps. Rows are read with
+// the pitch given, and the dimensions must have been checked against the texture ones.
+
+static void map_rows(ID3D11DeviceContext* pContext, TextureInternals& data, const unsigned char* rows, size_t pitch, unsigned row_bytes)
+{
+	const unsigned faces = data.type == TEXTURE_TYPE_CUBEMAP ? 6u : 1u;
+	const unsigned face_height = data.dimensions.y / faces;
+
+	for (unsigned face = 0u; face < faces; face++)
+	{
+		// Create the mapping to the face data
+		D3D11_MAPPED_SUBRESOURCE msr;
+		GRAPHICS_HR_CHECK(pContext->Map(data.pTexture.Get(), face, D3D11_MAP_WRITE_DISCARD, 0u, &msr));
+
+		// Copy the new face rows
+		for (unsigned y = 0; y < face_height; y++)
+			memcpy((byte*)msr.pData + y * msr.RowPitch, rows + (face * face_height + y) * pitch, row_bytes);
+
+		// Unmap the data
+		GRAPHICS_INFO_CHECK(pContext->Unmap(data.pTexture.Get(), face));
 	}
+}
+
+// Takes the Images reference and creates the texture in the GPU.
+
+Texture::Texture(const Image* image, TEXTURE_USAGE usage, TEXTURE_TYPE type, unsigned slot)
+	: Texture(checked_view(image), usage, type, slot)
+{
+}
+
+// Expects a valid image view and creates the texture in the GPU from its rows.
+
+Texture::Texture(const ImageView& image, TEXTURE_USAGE usage, TEXTURE_TYPE type, unsigned slot)
+{
+	BindableData = new TextureInternals;
+	TextureInternals& data = *(TextureInternals*)BindableData;
+	data.slot = slot;
+	data.usage = usage;
+	data.type = type;
+
+	create_texture(_device, data, &image, 1u);
+}
+
+// Expects a valid mip chain and creates the texture in the GPU with all its levels.
+
+Texture::Texture(const MipChain* chain, TEXTURE_USAGE usage, TEXTURE_TYPE type, unsigned slot)
+{
+	USER_CHECK(chain && chain->levelCount(),
+		"Found an empty mip chain when trying to create a Texture."
+	);
+
+	BindableData = new TextureInternals;
+	TextureInternals& data = *(TextureInternals*)BindableData;
+	data.slot = slot;
+	data.usage = usage;
+	data.type = type;
+
+	ImageView levels[MAX_TEXTURE_LEVELS];
+	for (unsigned mip = 0u; mip < chain->levelCount(); mip++)
+		levels[mip] = chain->level(mip);
+
+	create_texture(_device, data, levels, chain->levelCount());
+}
+
+// Expects a valid compressed image and creates the texture in the GPU with its blocks as 
+// they are, the texture type is deduced from the image and its usage is always default.
 
+Texture::Texture(const CompressedImage* image, unsigned slot)
+{
+	USER_CHECK(image && image->size(),
+		"Found an empty compressed image when trying to create a Texture."
+	);
+
+	BindableData = new TextureInternals;
+	TextureInternals& data = *(TextureInternals*)BindableData;
+	data.slot = slot;
+	data.usage = TEXTURE_USAGE_DEFAULT;
+	data.type = image->isCubemap() ? TEXTURE_TYPE_CUBEMAP : TEXTURE_TYPE_IMAGE;
+	data.levels = image->levelCount();
+
+	const unsigned faces = image->isCubemap() ? 6u : 1u;
+	data.dimensions = { image->width(), image->height() * faces };
+
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	switch (image->format())
+	{
+	case BLOCK_FORMAT_BC1: format = DXGI_FORMAT_BC1_UNORM; break;
+	case BLOCK_FORMAT_BC3: format = DXGI_FORMAT_BC3_UNORM; break;
+	case BLOCK_FORMAT_BC7: format = DXGI_FORMAT_BC7_UNORM; break;
 	default:
-		USER_ERROR("Unknown texture type found when trying to create a Texture.");
+		USER_ERROR("Unknown block format found when trying to create a Texture.");
 	}
 
+	D3D11_SUBRESOURCE_DATA psd[6u * MAX_TEXTURE_LEVELS] = {};
+	for (unsigned face = 0u; face < faces; face++)
+		for (unsigned mip = 0u; mip < data.levels; mip++)
+		{
+			psd[face * data.levels + mip].pSysMem = image->blocks(mip, face);
+			psd[face * data.levels + mip].SysMemPitch = image->rowPitch(mip);
+		}
+
+	create_resource(_device, data, format, image->width(), image->height(), psd);
+}
+
+// Expects a valid float image and creates a floating point texture in the GPU, with the
+// channels as 32 or 16 bit floats depending on the image format.
+
+Texture::Texture(const ImageF* image, TEXTURE_USAGE usage, TEXTURE_TYPE type, unsigned slot)
+{
+	USER_CHECK(image && image->data() && image->width() && image->height(),
+		"Found an empty float image when trying to create a Texture."
+	);
+
+	USER_CHECK(type != TEXTURE_TYPE_CUBEMAP || image->width() * 6u == image->height(),
+		"Invalid image dimensions found when trying to create a cubemap Texture.\n"
+		"To create a cubemap Texture the 6 sides must be stacked on top of each other.\n"
+		"Image dimensions must be (width, height = 6 * width)."
+	);
+
+	BindableData = new TextureInternals;
+	TextureInternals& data = *(TextureInternals*)BindableData;
+	data.slot = slot;
+	data.usage = usage;
+	data.type = type;
+	data.levels = 1u;
+	data.dimensions = { image->width(), image->height() };
+
+	const unsigned faces = type == TEXTURE_TYPE_CUBEMAP ? 6u : 1u;
+	const unsigned pitch = image->width() * ImageF::pixelBytes(image->format());
+
+	D3D11_SUBRESOURCE_DATA psd[6u] = {};
+	for (unsigned face = 0u; face < faces; face++)
+	{
+		psd[face].pSysMem = (const unsigned char*)image->data() + (size_t)face * image->width() * pitch;
+		psd[face].SysMemPitch = pitch;
+	}
+
+	const DXGI_FORMAT format = float_format(image->format());
+	create_resource(_device, data, format, image->width(), image->height() / faces, psd);
 }
 
 // Releases the GPU pointer and deletes the data.
@@ -153,12 +304,48 @@ void Texture::setSlot(unsigned slot)
 
 void Texture::update(const Image* image)
 {
-	USER_CHECK(image,
-		"Found nullptr when expecting an Image to update a Texture."
+	update(checked_view(image));
+}
+
+// If usage is dynamic updates the texture with the rows of the new view.
+// Dimensions must match the initial image dimensions.
+
+void Texture::update(const ImageView& image)
+{
+	TextureInternals& data = *(TextureInternals*)BindableData;
+
+	USER_CHECK(data.usage == TEXTURE_USAGE_DYNAMIC,
+		"Trying to update a texture without dynamic usage.\n"
+		"To use the update function on a Texture you should set TEXTURE_USAGE_DYNAMIC on the constructor."
 	);
 
+	USER_CHECK(data.levels == 1u,
+		"Trying to update a texture with mip levels from a single image.\n"
+		"Textures created from a MipChain must be updated with a MipChain of the same levels."
+	);
+
+	USER_CHECK(data.dimensions == Vector2i(image.width(), image.height()),
+		"Trying to update a texture with an image of different dimensions to the one used in the constructor."
+	);
+
+	USER_CHECK(data.format == DXGI_FORMAT_B8G8R8A8_UNORM,
+		"Trying to update a float texture with a regular image, float textures are updated with float images."
+	);
+
+	map_rows(_context, data, (const unsigned char*)image.pixels(), image.stride() * sizeof(Color), image.width() * sizeof(Color));
+}
+
+// If usage is dynamic updates the texture with the new float image.
+// Dimensions and format must match the initial image ones.
+
+void Texture::update(const ImageF* image)
+{
 	TextureInternals& data = *(TextureInternals*)BindableData;
 
+	USER_CHECK(image,
+		"Found nullptr when expecting a float image to update a Texture."
+	);
+
 	USER_CHECK(data.usage == TEXTURE_USAGE_DYNAMIC,
 		"Trying to update a texture without dynamic usage.\n"
 		"To use the update function on a Texture you should set TEXTURE_USAGE_DYNAMIC on the constructor."
@@ -168,42 +355,55 @@ void Texture::update(const Image* image)
 		"Trying to update a texture with an image of different dimensions to the one used in the constructor."
 	);
 
-	switch (data.type)
-	{
-		case TEXTURE_TYPE_IMAGE:
-		{
-			// Create the mapping to the image data
-			D3D11_MAPPED_SUBRESOURCE msr;
-			GRAPHICS_HR_CHECK(_context->Map(data.pTexture.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &msr));
-
-			// Copy the new image pixels
-			const unsigned rowBytes = image->width() * sizeof(Color);
-			for (unsigned y = 0; y < image->height(); y++)
-				memcpy((byte*)msr.pData + y * msr.RowPitch, (byte*)image->pixels() + y * rowBytes, rowBytes);
-
-			// Unmap the data
-			GRAPHICS_INFO_CHECK(_context->Unmap(data.pTexture.Get(), 0u));
-			break;
-		}
+	const DXGI_FORMAT format = float_format(image->format());
+	USER_CHECK(data.format == format,
+		"Trying to update a texture with a float image of a different format to the one used in the constructor."
+	);
+
+	const unsigned pitch = image->width() * ImageF::pixelBytes(image->format());
+	map_rows(_context, data, (const unsigned char*)image->data(), pitch, pitch);
+}
 
-		case TEXTURE_TYPE_CUBEMAP:
+// If usage is dynamic updates every level of the texture with the new mip chain.
+// Dimensions and level count must match the initial ones.
+
+void Texture::update(const MipChain* chain)
+{
+	TextureInternals& data = *(TextureInternals*)BindableData;
+
+	USER_CHECK(chain && chain->levelCount(),
+		"Found an empty mip chain when trying to update a Texture."
+	);
+
+	// Single level textures are mapped as usual
+	if (data.levels == 1u && chain->levelCount() == 1u)
+		return update(chain->level(0u));
+
+	USER_CHECK(data.usage == TEXTURE_USAGE_DYNAMIC,
+		"Trying to update a texture without dynamic usage.\n"
+		"To use the update function on a Texture you should set TEXTURE_USAGE_DYNAMIC on the constructor."
+	);
+
+	USER_CHECK(data.dimensions == Vector2i(chain->level(0u).width(), chain->level(0u).height()),
+		"Trying to update a texture with an image of different dimensions to the one used in the constructor."
+	);
+
+	USER_CHECK(data.levels == chain->levelCount(),
+		"Trying to update a texture with a mip chain of a different level count to the one used in the constructor."
+	);
+
+	USER_CHECK(data.format == DXGI_FORMAT_B8G8R8A8_UNORM,
+		"Trying to update a float texture with a mip chain, float textures are updated with float images."
+	);
+
+	const unsigned faces = data.type == TEXTURE_TYPE_CUBEMAP ? 6u : 1u;
+	for (unsigned face = 0u; face < faces; face++)
+		for (unsigned mip = 0u; mip < data.levels; mip++)
 		{
-			const unsigned faceBytes = image->width() * image->width() * sizeof(Color);
-			const unsigned rowBytes = image->width() * sizeof(Color);
-			for (unsigned face = 0u; face < 6u; face++)
-			{
-				// Create the mapping to the face data
-				D3D11_MAPPED_SUBRESOURCE msr;
-				GRAPHICS_HR_CHECK(_context->Map(data.pTexture.Get(), face, D3D11_MAP_WRITE_DISCARD, 0u, &msr));
-
-				// Copy the new cube face pixels
-				for (unsigned y = 0; y < image->height() / 6u; y++)
-					memcpy((byte*)msr.pData + y * msr.RowPitch, (byte*)image->pixels() + face * faceBytes + y * rowBytes, rowBytes);
-
-				// Unmap the data
-				GRAPHICS_INFO_CHECK(_context->Unmap(data.pTexture.Get(), face));
-			}
-			break;
+			const ImageView level = chain->level(mip);
+			const unsigned face_height = level.height() / faces;
+
+			GRAPHICS_INFO_CHECK(_context->UpdateSubresource(data.pTexture.Get(), D3D11CalcSubresource(mip, face, data.levels), 
+				nullptr, level.row(face * face_height), level.stride() * sizeof(Color), 0u));
 		}
-	}
 }
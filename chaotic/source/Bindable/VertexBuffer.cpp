@@ -12,6 +12,19 @@ struct VertexBufferInternals
 	VERTEX_BUFFER_USAGE usage;
 	UINT byteWidth;
 	UINT stride;
+
+	// Maximum amount of separate dirty ranges stored, if more ranges
+	// are marked the closest ones get merged together.
+	static constexpr unsigned MAX_DIRTY_RANGES = 32u;
+
+	// Sorted list of disjoint dirty ranges in vertices [first, end).
+	struct DirtyRange
+	{
+		UINT first;
+		UINT end;
+	}
+	dirty[MAX_DIRTY_RANGES] = {};
+	unsigned n_dirty = 0u;
 };
 
 /*
@@ -62,30 +75,164 @@ void VertexBuffer::updateVertices(const void* vertices, unsigned stride, unsigne
 {
 	VertexBufferInternals& data = *(VertexBufferInternals*)BindableData;
 
-	USER_CHECK(data.usage == VB_USAGE_DYNAMIC,
+	USER_CHECK(data.usage != VB_USAGE_DEFAULT,
 		"Trying to update vertices on a non-dynamic Vertex Buffer is not allowed. \n"
-		"Set the VERTEX_BUFFER_USAGE in the constructor to VB_USAGE_DYNAMIC if you intend to use this function.\n"
+		"Set the VERTEX_BUFFER_USAGE in the constructor to VB_USAGE_DYNAMIC or VB_USAGE_PARTIAL if you intend to use this function.\n"
 		"Or alternatively replace the Vertex Buffer entirely by calling Drawable::changeBind()."
 	);
 
-	USER_CHECK(stride * count <= data.byteWidth,
+	USER_CHECK((unsigned long long)stride * count <= data.byteWidth,
 		"Trying to update vertices with a higher byteWidth than the one created in the constructor is not allowed."
 	);
 
-	// Create the mapping
-	D3D11_MAPPED_SUBRESOURCE msr;
-	GRAPHICS_HR_CHECK(_context->Map(data.pVertexBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &msr));
-
-	// Copy the data
-	memcpy(msr.pData, vertices, count * stride);
-
-	// Unmap the data
-	GRAPHICS_INFO_CHECK(_context->Unmap(data.pVertexBuffer.Get(), 0u));
+	// Partial buffers live in GPU memory, let the driver schedule the copy.
+	if (data.usage == VB_USAGE_PARTIAL)
+	{
+		D3D11_BOX box = { 0u, 0u, 0u, stride * count, 1u, 1u };
+		GRAPHICS_INFO_CHECK(_context->UpdateSubresource(data.pVertexBuffer.Get(), 0u, &box, vertices, 0u, 0u));
+	}
+	else
+	{
+		// Create the mapping
+		D3D11_MAPPED_SUBRESOURCE msr;
+		GRAPHICS_HR_CHECK(_context->Map(data.pVertexBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &msr));
+
+		// Copy the data
+		memcpy(msr.pData, vertices, count * stride);
+
+		// Unmap the data
+		GRAPHICS_INFO_CHECK(_context->Unmap(data.pVertexBuffer.Get(), 0u));
+	}
 
 	// Store the new stride for binding calls
 	data.stride = stride;
 }
 
+// If the Vertex Buffer has partial usage it updates only the vertices in the range that 
+// starts at first, the pointer must point to the new data of the first vertex of the 
+// range. If the range exceeds the buffer or usage is not partial it will cause assertion.
+
+void VertexBuffer::updateVertexRange(const void* vertices, unsigned first, unsigned count)
+{
+	VertexBufferInternals& data = *(VertexBufferInternals*)BindableData;
+
+	USER_CHECK(data.usage == VB_USAGE_PARTIAL,
+		"Trying to update a vertex range on a non-partial Vertex Buffer is not allowed. \n"
+		"Set the VERTEX_BUFFER_USAGE in the constructor to VB_USAGE_PARTIAL if you intend to use this function."
+	);
+
+	// Compared against the buffer capacity, so that large ranges can not overflow.
+	const UINT capacity = data.byteWidth / data.stride;
+
+	USER_CHECK(first <= capacity && count <= capacity - first,
+		"Trying to update a vertex range that exceeds the size of the Vertex Buffer is not allowed."
+	);
+
+	if (!count)
+		return;
+
+	// Only the bytes inside the box are copied to the buffer.
+	D3D11_BOX box = { first * data.stride, 0u, 0u, (first + count) * data.stride, 1u, 1u };
+	GRAPHICS_INFO_CHECK(_context->UpdateSubresource(data.pVertexBuffer.Get(), 0u, &box, vertices, 0u, 0u));
+}
+
+// Marks a range of vertices as modified, to be sent by the next uploadDirtyRanges() call.
+// Overlapping and adjacent ranges are coalesced, so that few copies are issued per upload.
+// If the range exceeds the buffer or usage is default it will cause assertion.
+
+void VertexBuffer::markDirtyRange(unsigned first, unsigned count)
+{
+	VertexBufferInternals& data = *(VertexBufferInternals*)BindableData;
+
+	USER_CHECK(data.usage != VB_USAGE_DEFAULT,
+		"Trying to mark a dirty range on a non-dynamic Vertex Buffer is not allowed. \n"
+		"Set the VERTEX_BUFFER_USAGE in the constructor to VB_USAGE_DYNAMIC or VB_USAGE_PARTIAL if you intend to use this function."
+	);
+
+	// Compared against the buffer capacity, so that large ranges can not overflow.
+	const UINT capacity = data.byteWidth / data.stride;
+
+	USER_CHECK(first <= capacity && count <= capacity - first,
+		"Trying to mark a dirty range that exceeds the size of the Vertex Buffer is not allowed."
+	);
+
+	if (!count)
+		return;
+
+	UINT new_first = first;
+	UINT new_end = first + count;
+
+	// Absorb all the stored ranges that overlap or touch the new one.
+	unsigned n = 0u;
+	for (unsigned i = 0u; i < data.n_dirty; i++)
+	{
+		VertexBufferInternals::DirtyRange& range = data.dirty[i];
+
+		if (range.first <= new_end && new_first <= range.end)
+		{
+			new_first = range.first < new_first ? range.first : new_first;
+			new_end = range.end > new_end ? range.end : new_end;
+		}
+		else
+			data.dirty[n++] = range;
+	}
+	data.n_dirty = n;
+
+	// If the list is full merge the two neighbours with the smallest gap.
+	if (data.n_dirty == VertexBufferInternals::MAX_DIRTY_RANGES)
+	{
+		unsigned closest = 0u;
+		for (unsigned i = 1u; i < data.n_dirty - 1u; i++)
+			if (data.dirty[i + 1].first - data.dirty[i].end < data.dirty[closest + 1].first - data.dirty[closest].end)
+				closest = i;
+
+		data.dirty[closest].end = data.dirty[closest + 1].end;
+
+		for (unsigned i = closest + 1u; i < data.n_dirty - 1u; i++)
+			data.dirty[i] = data.dirty[i + 1];
+
+		data.n_dirty--;
+	}
+
+	// Insert the new range keeping the list sorted.
+	unsigned pos = data.n_dirty;
+	while (pos > 0u && data.dirty[pos - 1].first > new_first)
+	{
+		data.dirty[pos] = data.dirty[pos - 1];
+		pos--;
+	}
+	data.dirty[pos] = { new_first, new_end };
+	data.n_dirty++;
+}
+
+// Sends all the ranges marked as dirty to the GPU, reading them from the full vertex list 
+// provided, which must have the same layout as the buffer. If most of the buffer is dirty 
+// or the usage is dynamic the whole list is updated. Does nothing if no range is dirty.
+
+void VertexBuffer::uploadDirtyRanges(const void* vertices)
+{
+	VertexBufferInternals& data = *(VertexBufferInternals*)BindableData;
+
+	if (!data.n_dirty)
+		return;
+
+	const UINT vertex_count = data.byteWidth / data.stride;
+
+	UINT dirty_count = 0u;
+	for (unsigned i = 0u; i < data.n_dirty; i++)
+		dirty_count += data.dirty[i].end - data.dirty[i].first;
+
+	// Dynamic buffers can only be rewritten entirely, and if more than half 
+	// of the buffer is dirty a single copy is cheaper than many small ones.
+	if (data.usage == VB_USAGE_DYNAMIC || 2u * dirty_count >= vertex_count)
+		updateVertices(vertices, data.stride, vertex_count);
+
+	else for (unsigned i = 0u; i < data.n_dirty; i++)
+		updateVertexRange((const char*)vertices + data.dirty[i].first * data.stride, data.dirty[i].first, data.dirty[i].end - data.dirty[i].first);
+
+	data.n_dirty = 0u;
+}
+
 // Binds the Vertex Buffer to the global context.
 
 void VertexBuffer::Bind()
@@ -30,6 +30,24 @@ struct BackgroundInternals
 	BACKGROUND_DESC desc = {};
 };
 
+// Creates the Background texture from the image, with its full mip chain if mipmaps
+// are enabled on the descriptor. If the view is empty the float image is used, or the 
+// compressed image if there is no float image.
+
+static Texture* create_texture(const BACKGROUND_DESC& desc, const ImageView& image, TEXTURE_TYPE type)
+{
+	const TEXTURE_USAGE usage = desc.texture_updates ? TEXTURE_USAGE_DYNAMIC : TEXTURE_USAGE_DEFAULT;
+
+	if (!image.pixels())
+		return desc.hdr_image ? new Texture(desc.hdr_image, usage, type) : new Texture(desc.compressed_image);
+
+	if (!desc.texture_mipmaps)
+		return new Texture(image, usage, type);
+
+	MipChain chain(image, desc.mipmap_filter, type == TEXTURE_TYPE_CUBEMAP);
+	return new Texture(&chain, usage, type);
+}
+
 /*
 -----------------------------------------------------------------------------------------------------------
  Constructors / Destructors
@@ -76,11 +94,40 @@ void Background::initialize(const BACKGROUND_DESC* pDesc)
 
 	data.desc = *pDesc;
 
-	USER_CHECK(data.desc.image,
+	USER_CHECK(data.desc.image || data.desc.image_view.pixels() || data.desc.hdr_image || data.desc.compressed_image,
 		"Found nullptr when trying to access an Image to create a Background."
 	);
 
-	data.imageDim = { data.desc.image->width(), data.desc.image->height() };
+	// The image pointer takes preference over the view, then the float and the compressed image.
+	const ImageView image = data.desc.image ? ImageView(*data.desc.image) : data.desc.image_view;
+
+	if (image.pixels())
+		data.imageDim = { image.width(), image.height() };
+	else if (data.desc.hdr_image)
+	{
+		USER_CHECK(!data.desc.texture_mipmaps,
+			"Trying to create a Background with mipmaps from a float image.\n"
+			"Mip chains are only built for regular images, disable texture_mipmaps for float backgrounds."
+		);
+
+		data.imageDim = { data.desc.hdr_image->width(), data.desc.hdr_image->height() };
+	}
+	else
+	{
+		const CompressedImage& compressed = *data.desc.compressed_image;
+
+		USER_CHECK(!data.desc.texture_updates,
+			"Trying to create a Background with texture updates from a compressed image.\n"
+			"Compressed textures can not be updated, use an Image or an ImageView instead."
+		);
+
+		USER_CHECK(compressed.isCubemap() == (data.desc.type == BACKGROUND_DESC::DYNAMIC_BACKGROUND),
+			"Found a compressed image of the wrong type when trying to create a Background.\n"
+			"Dynamic backgrounds expect a compressed cube-map, and static ones a regular image."
+		);
+
+		data.imageDim = { compressed.width(), compressed.height() * (compressed.isCubemap() ? 6u : 1u) };
+	}
 
 	VertexShader* pvs;
 	switch (data.desc.type)
@@ -98,7 +145,7 @@ void Background::initialize(const BACKGROUND_DESC* pDesc)
 		_float4vector rectangle = { 0.f, 0.f, 1.f, 1.f };
 		data.pCBuff = AddBind(new ConstantBuffer(&rectangle, VERTEX_CONSTANT_BUFFER));
 
-		data.textureUpdates = AddBind(new Texture(data.desc.image, data.desc.texture_updates ? TEXTURE_USAGE_DYNAMIC : TEXTURE_USAGE_DEFAULT));
+		data.textureUpdates = AddBind(create_texture(data.desc, image, TEXTURE_TYPE_IMAGE));
 		break;
 	}
 
@@ -114,7 +161,7 @@ void Background::initialize(const BACKGROUND_DESC* pDesc)
 
 		data.pCBuff = AddBind(new ConstantBuffer(&data.projection, VERTEX_CONSTANT_BUFFER));
 
-		data.textureUpdates = AddBind(new Texture(data.desc.image, data.desc.texture_updates ? TEXTURE_USAGE_DYNAMIC : TEXTURE_USAGE_DEFAULT, TEXTURE_TYPE_CUBEMAP));
+		data.textureUpdates = AddBind(create_texture(data.desc, image, TEXTURE_TYPE_CUBEMAP));
 		break;
 	}
 
@@ -160,6 +207,18 @@ void Background::initialize(const BACKGROUND_DESC* pDesc)
 // as the image used in the constructor.
 
 void Background::updateTexture(const Image* image)
+{
+	USER_CHECK(image,
+		"Found nullptr when trying to access an Image to update a Background."
+	);
+
+	updateTexture(ImageView(*image));
+}
+
+// If updates are enabled, updates the background texture with the rows of the view.
+// Dimensions must be equal to the image used in the constructor.
+
+void Background::updateTexture(const ImageView& image)
 {
 	USER_CHECK(isInit,
 		"Trying to update the texture on an uninitialized Background."
@@ -167,10 +226,32 @@ void Background::updateTexture(const Image* image)
 
 	BackgroundInternals& data = *(BackgroundInternals*)backgroundData;
 
-	USER_CHECK(image,
-		"Found nullptr when trying to access an Image to update a Background."
+	USER_CHECK(data.desc.texture_updates,
+		"Trying to update the texture on a Background without updates enabled.\n"
+		"To update the texture on a background set texture_updates on the descriptor to true."
 	);
 
+	// Mipmapped textures get the chain of the new image, dynamic backgrounds use cube-maps.
+	if (data.desc.texture_mipmaps)
+	{
+		MipChain chain(image, data.desc.mipmap_filter, data.desc.type == BACKGROUND_DESC::DYNAMIC_BACKGROUND);
+		data.textureUpdates->update(&chain);
+	}
+	else
+		data.textureUpdates->update(image);
+}
+
+// If updates are enabled and the Background was created from a float image, updates
+// the background texture with the new float image, of the same dimensions and format.
+
+void Background::updateTexture(const ImageF* image)
+{
+	USER_CHECK(isInit,
+		"Trying to update the texture on an uninitialized Background."
+	);
+
+	BackgroundInternals& data = *(BackgroundInternals*)backgroundData;
+
 	USER_CHECK(data.desc.texture_updates,
 		"Trying to update the texture on a Background without updates enabled.\n"
 		"To update the texture on a background set texture_updates on the descriptor to true."
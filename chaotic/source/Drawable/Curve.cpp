@@ -46,9 +46,53 @@ struct CurveInternals
 	ConstantBuffer* pVSCB = nullptr;
 	ConstantBuffer* pGlobalColorCB = nullptr;
 
+	Colormap colormap;
+
 	CURVE_DESC desc = {};
 };
 
+// Colors the vertices of a function or colormap colored Curve, whose parameters start at 
+// t_i with increments of dt. Colormaps map all the vertices at once, and if the range of 
+// the descriptor is empty they store the one of the first values for the later updates.
+
+static void color_vertices(CurveInternals& data, float t_i, float dt)
+{
+	const unsigned count = data.desc.vertex_count;
+
+	if (data.desc.coloring == CURVE_DESC::FUNCTION_COLORING)
+	{
+		for (unsigned n = 0u; n < count; n++)
+			data.ColVertices[n].color = data.desc.color_function(t_i + n * dt).getColor4();
+		return;
+	}
+
+	float* values = new float[count];
+	switch (data.desc.colormap_scalar)
+	{
+	case COLORMAP_SCALAR_HEIGHT:
+		for (unsigned n = 0u; n < count; n++)
+			values[n] = data.ColVertices[n].position.z;
+		break;
+
+	case COLORMAP_SCALAR_RADIUS:
+		for (unsigned n = 0u; n < count; n++)
+			values[n] = Vector3f(data.ColVertices[n].position).abs();
+		break;
+
+	default:
+		for (unsigned n = 0u; n < count; n++)
+			values[n] = t_i + n * dt;
+		break;
+	}
+
+	Vector2f& range = data.desc.colormap_range;
+	if (range.x == range.y)
+		Colormap::findRange(values, count, &range.x, &range.y);
+
+	data.colormap.map(values, &data.ColVertices[0].color, count, range.x, range.y, sizeof(CurveInternals::ColVertex));
+	delete[] values;
+}
+
 /*
 -----------------------------------------------------------------------------------------------------------
  Constructors / Destructors
@@ -126,7 +170,7 @@ void Curve::initialize(const CURVE_DESC* pDesc)
 			for (unsigned n = 0u; n < data.desc.vertex_count; n++)
 				data.Vertices[n] = data.desc.curve_function(t_i + n * dt).getVector4();
 
-			data.pUpdateVB = AddBind(new VertexBuffer(data.Vertices, data.desc.vertex_count, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
+			data.pUpdateVB = AddBind(new VertexBuffer(data.Vertices, data.desc.vertex_count, data.desc.enable_updates ? VB_USAGE_PARTIAL : VB_USAGE_DEFAULT));
 
 			// If updates disabled delete the vertices
 			if (!data.desc.enable_updates)
@@ -186,7 +230,7 @@ void Curve::initialize(const CURVE_DESC* pDesc)
 				data.ColVertices[n].color = data.desc.color_list[n].getColor4();
 			}
 
-			data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, data.desc.vertex_count, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
+			data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, data.desc.vertex_count, data.desc.enable_updates ? VB_USAGE_PARTIAL : VB_USAGE_DEFAULT));
 
 			// If updates disabled delete the vertices
 			if (!data.desc.enable_updates)
@@ -230,20 +274,34 @@ void Curve::initialize(const CURVE_DESC* pDesc)
 		}
 
 		case CURVE_DESC::FUNCTION_COLORING:
+		case CURVE_DESC::COLORMAP_COLORING:
 		{
-			USER_CHECK(data.desc.color_function,
+			USER_CHECK(data.desc.coloring != CURVE_DESC::FUNCTION_COLORING || data.desc.color_function,
 				"Found nullptr when trying to access a color function to create a Curve."
 			);
 
+			USER_CHECK(data.desc.coloring != CURVE_DESC::COLORMAP_COLORING || data.desc.colormap_scalar != COLORMAP_SCALAR_PARAMETER_V,
+				"Found the second parameter as the colormap scalar when trying to create a Curve.\n"
+				"Curves only have one parameter, use COLORMAP_SCALAR_PARAMETER instead."
+			);
+
+			// Colormaps are copied, the custom one or the built in one.
+			if (data.desc.coloring == CURVE_DESC::COLORMAP_COLORING)
+			{
+				if (data.desc.custom_colormap)
+					data.colormap = *data.desc.custom_colormap;
+				else
+					data.colormap.generate(data.desc.colormap);
+			}
+
 			data.ColVertices = new CurveInternals::ColVertex[data.desc.vertex_count];
 
 			for (unsigned n = 0u; n < data.desc.vertex_count; n++)
-			{
 				data.ColVertices[n].position = data.desc.curve_function(t_i + n * dt).getVector4();
-				data.ColVertices[n].color = data.desc.color_function(t_i + n * dt).getColor4();
-			}
 
-			data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, data.desc.vertex_count, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
+			color_vertices(data, t_i, dt);
+
+			data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, data.desc.vertex_count, data.desc.enable_updates ? VB_USAGE_PARTIAL : VB_USAGE_DEFAULT));
 
 			// If updates disabled delete the vertices
 			if (!data.desc.enable_updates)
@@ -309,10 +367,33 @@ void Curve::initialize(const CURVE_DESC* pDesc)
 -----------------------------------------------------------------------------------------------------------
 */
 
+// Draw override, sends the pending vertex and color updates to the GPU and 
+// then issues the draw call. Updates are coalesced and uploaded only here.
+
+void Curve::Draw()
+{
+	USER_CHECK(isInit,
+		"Trying to draw an uninitialized Curve."
+	);
+
+	CurveInternals& data = *(CurveInternals*)curveData;
+
+	if (data.desc.enable_updates)
+	{
+		if (data.desc.coloring == CURVE_DESC::GLOBAL_COLORING)
+			data.pUpdateVB->uploadDirtyRanges(data.Vertices);
+		else
+			data.pUpdateVB->uploadDirtyRanges(data.ColVertices);
+	}
+
+	_draw();
+}
+
 // If updates are enabled this function allows to change the range of the curve function. It 
 // expects the initial function pointer to still be callable, it will evaluate it on the new 
 // range and send the vertices to the GPU. If coloring is functional it also expects the color 
-// function to still be callable, if coloring is not functional it will reuse the old colors.
+// function to still be callable, colormaps color the new vertices, and otherwise it will reuse 
+// the old colors.
 
 void Curve::updateRange(Vector2f range)
 {
@@ -344,7 +425,7 @@ void Curve::updateRange(Vector2f range)
 			for (unsigned n = 0u; n < data.desc.vertex_count; n++)
 				data.Vertices[n] = data.desc.curve_function(t_i + n * dt).getVector4();
 
-			data.pUpdateVB->updateVertices(data.Vertices, data.desc.vertex_count);
+			data.pUpdateVB->markDirtyRange(0u, data.desc.vertex_count);
 			break;
 		}
 
@@ -353,19 +434,19 @@ void Curve::updateRange(Vector2f range)
 			for (unsigned n = 0u; n < data.desc.vertex_count; n++)
 				data.ColVertices[n].position = data.desc.curve_function(t_i + n * dt).getVector4();
 
-			data.pUpdateVB->updateVertices(data.ColVertices, data.desc.vertex_count);
+			data.pUpdateVB->markDirtyRange(0u, data.desc.vertex_count);
 			break;
 		}
 
 		case CURVE_DESC::FUNCTION_COLORING:
+		case CURVE_DESC::COLORMAP_COLORING:
 		{
 			for (unsigned n = 0u; n < data.desc.vertex_count; n++)
-			{
 				data.ColVertices[n].position = data.desc.curve_function(t_i + n * dt).getVector4();
-				data.ColVertices[n].color = data.desc.color_function(t_i + n * dt).getColor4();
-			}
 
-			data.pUpdateVB->updateVertices(data.ColVertices, data.desc.vertex_count);
+			color_vertices(data, t_i, dt);
+
+			data.pUpdateVB->markDirtyRange(0u, data.desc.vertex_count);
 			break;
 		}
 	}
@@ -398,7 +479,41 @@ void Curve::updateColors(Color* color_list)
 	for (unsigned i = 0u; i < data.desc.vertex_count; i++)
 		data.ColVertices[i].color = color_list[i].getColor4();
 
-	data.pUpdateVB->updateVertices(data.ColVertices, data.desc.vertex_count);
+	data.pUpdateVB->markDirtyRange(0u, data.desc.vertex_count);
+}
+
+// If updates are enabled, and coloring is with a list, this function allows to change 
+// the colors of a range of vertices, starting at the first vertex specified. It expects
+// a valid pointer to a list of colors as long as the count.
+
+void Curve::updateColors(const Color* color_list, unsigned first, unsigned count)
+{
+	USER_CHECK(isInit,
+		"Trying to update the colors on an uninitialized Curve."
+	);
+
+	USER_CHECK(color_list,
+		"Trying to update the colors on a Curve with an invalid color list."
+	);
+
+	CurveInternals& data = *(CurveInternals*)curveData;
+
+	USER_CHECK(data.desc.coloring == CURVE_DESC::LIST_COLORING,
+		"Trying to update the colors on a Curve with a different coloring."
+	);
+
+	USER_CHECK(data.desc.enable_updates,
+		"Trying to update the colors on a Curve with updates disabled."
+	);
+
+	USER_CHECK(first <= data.desc.vertex_count && count <= data.desc.vertex_count - first,
+		"Trying to update a range of colors that exceeds the vertex count of the Curve."
+	);
+
+	for (unsigned i = 0u; i < count; i++)
+		data.ColVertices[first + i].color = color_list[i].getColor4();
+
+	data.pUpdateVB->markDirtyRange(first, count);
 }
 
 // If the coloring is set to global, updates the global Curve color.
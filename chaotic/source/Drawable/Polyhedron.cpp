@@ -2,9 +2,23 @@
 #include "Bindable/BindableBase.h"
 
 #include "Error/_erDefault.h"
-
-#include <cstdio> // For mesh support
-#include <cstdlib> // For mesh support
+#include "ThreadPool.h"
+#include "MappedFile.h"
+#include "PlyFormat.h"
+#include "MeshOptimizer.h"
+#include "MeshBVH.h"
+#include "MeshSimplifier.h"
+
+#include <cstring> // For mesh support
+#include <climits> // For mesh support
+#include <charconv> // For mesh support
+#include <atomic> // For mesh support
+#include <vector> // For mesh support
+#include <string> // For mesh support
+#include <filesystem> // For mesh support
+#include <type_traits> // For mesh support
+#include <cmath> // For smooth normals
+#include <algorithm> // For smooth normals
 
 #ifdef _DEPLOYMENT
 #include "embedded_resources.h"
@@ -82,380 +96,2950 @@ struct PolyhedronInternals
 
 	VertexBuffer* pUpdateVB = nullptr;
 
+	// Whether the vertex list is uploaded once and indexed by the triangle list, 
+	// instead of expanding every triangle into three vertices.
+	bool indexed = false;
+	unsigned vertex_count = 0u;
+
+	// Smooth normal data kept for updates. The vertex to corner adjacency of the triangle
+	// list in compressed rows, a copy of the vertex positions, the weighted normal of every
+	// corner and the visited flags used to gather the triangles around updated vertices.
+	unsigned* adjacency_offsets = nullptr;
+	unsigned* adjacency_corners = nullptr;
+	Vector3f* smooth_positions = nullptr;
+	Vector3f* corner_weights = nullptr;
+	bool* visited_triangles = nullptr;
+	bool* visited_vertices = nullptr;
+
+	// Picking data. A copy of the vertex positions, the hierarchy built over them, whether it
+	// has to be refitted before the next query, and the original index of every triangle if 
+	// they were reordered on creation.
+	Vector3f* pick_positions = nullptr;
+	MeshBVH* bvh = nullptr;
+	bool bvh_outdated = false;
+	unsigned* pick_triangle_ids = nullptr;
+
 	POLYHEDRON_DESC desc = {};
 };
 
 /*
 -----------------------------------------------------------------------------------------------------------
- Triangle mesh formatting support
+ Binary mesh support
 -----------------------------------------------------------------------------------------------------------
 */
 
-// To facilitate the loading of triangle meshes, this function is a parser for 
-// *.obj files, that reads the files and outputs a valid descriptor. If the file 
-// supports texturing, optionally accepts an image to be used as texture_image.
-// NOTE: All data is allocated by (new) and its deletion must be handled by the 
-// user. The image pointer used is the same as provided.
+// Identifier and version of the binary mesh files.
+#define MESH_FILE_MAGIC "CHAOMESH"
+#define MESH_FILE_VERSION 1u
+// Written as is, so readers with a different byte order can reject the file.
+#define MESH_FILE_ENDIANNESS 0x01020304u
+// Alignment in bytes of the header and every list inside the file.
+#define MESH_FILE_ALIGNMENT 64ull
+// Extension appended to the obj file path for the sidecar caches.
+#define MESH_CACHE_EXTENSION ".cmesh"
+
+// Header of the binary mesh files, followed by the lists at the offsets specified. All data 
+// is stored little-endian with the same layout it has in memory, so it can be used in place.
+struct MeshFileHeader
+{
+	char magic[8];
+	unsigned version;
+	unsigned endianness;
+
+	unsigned vertex_count;
+	unsigned triangle_count;
+	unsigned normal_count;
+	unsigned coloring;
+	unsigned normal_computation;
+	Color global_color;
+
+	// Texture size used to convert the texture coordinates, zero if none.
+	unsigned texture_width;
+	unsigned texture_height;
+
+	// Size and modification time of the source file for sidecar caches, zero otherwise.
+	unsigned long long source_size;
+	long long source_time;
+
+	// Offsets of the lists from the start of the file, zero if not present.
+	unsigned long long vertex_offset;
+	unsigned long long triangle_offset;
+	unsigned long long normal_offset;
+	unsigned long long color_offset;
+	unsigned long long texcoord_offset;
+};
 
-POLYHEDRON_DESC Polyhedron::getDescFromObj(const char* obj_file_path, Image* texture)
+// Struct that stores the internal data for a given MeshView object.
+struct MeshViewInternals
 {
-	// First let's open the file.
-	FILE* file = nullptr;
-	fopen_s(&file, obj_file_path, "r");
-	USER_CHECK(file,
-		"OBJ parse error: Unable to open OBJ file."
+	MappedFile file;
+	POLYHEDRON_DESC desc = {};
+
+	// If the view could not map a cache it owns a parsed copy of the mesh instead.
+	bool owns_lists = false;
+};
+
+// Rounds the offset up to the file alignment.
+
+static inline unsigned long long align_mesh_offset(unsigned long long offset)
+{
+	return (offset + MESH_FILE_ALIGNMENT - 1ull) & ~(MESH_FILE_ALIGNMENT - 1ull);
+}
+
+// Returns the number of normals stored by the descriptor normal setting.
+
+static inline unsigned mesh_normal_count(const POLYHEDRON_DESC& desc, unsigned vertex_count)
+{
+	switch (desc.normal_computation)
+	{
+	case POLYHEDRON_DESC::PER_VERTEX_LIST_NORMALS:
+		return vertex_count;
+	case POLYHEDRON_DESC::PER_TRIANGLE_LIST_NORMALS:
+		return 3u * desc.triangle_count;
+	default:
+		return 0u;
+	}
+}
+
+// Returns the number of vertices referenced by the descriptor, the highest index plus one.
+
+static unsigned referenced_vertex_count(const POLYHEDRON_DESC& desc)
+{
+	int highest = -1;
+	const int* indices = (const int*)desc.triangle_list;
+	for (unsigned i = 0u; i < 3u * desc.triangle_count; i++)
+		highest = indices[i] > highest ? indices[i] : highest;
+
+	return unsigned(highest + 1);
+}
+
+// Returns the number of distinct vertices used by the triangles of the descriptor, given the
+// highest index plus one. Vertices of the list that no triangle uses are not counted.
+
+static unsigned distinct_vertex_count(const POLYHEDRON_DESC& desc, unsigned vertex_count)
+{
+	bool* used = new bool[vertex_count]();
+	const unsigned* indices = (const unsigned*)desc.triangle_list;
+
+	unsigned count = 0u;
+	for (unsigned i = 0u; i < 3u * desc.triangle_count; i++)
+	{
+		if (used[indices[i]])
+			continue;
+
+		used[indices[i]] = true;
+		count++;
+	}
+
+	delete[] used;
+	return count;
+}
+
+// Checks the descriptor lists needed by the mesh writers.
+
+static void check_writable_desc(const POLYHEDRON_DESC* pDesc)
+{
+	USER_CHECK(pDesc,
+		"Trying to write a mesh file with an invalid descriptor pointer."
 	);
 
-	POLYHEDRON_DESC desc = {};
-	desc.texture_image = texture;
+	USER_CHECK(pDesc->vertex_list && pDesc->triangle_list && pDesc->triangle_count,
+		"Trying to write a mesh file from a descriptor without vertices or triangles."
+	);
+}
 
-	// Define convenient helpers
+// Outputs the size and modification time of the file, used as key for the sidecar caches.
+// Returns false if the file does not exist.
 
-	auto startsWith = [](const char* s, const char* prefix) -> bool
-		{
-			while (*prefix)
-			{
-				if (*s++ != *prefix++) return false;
-			}
-			return true;
-		};
+static bool get_file_key(const char* path, unsigned long long* size, long long* time)
+{
+	std::error_code error;
+	std::filesystem::path file_path(path);
+
+	*size = (unsigned long long)std::filesystem::file_size(file_path, error);
+	if (error)
+		return false;
+
+	*time = (long long)std::filesystem::last_write_time(file_path, error).time_since_epoch().count();
+	return !error;
+}
+
+// Writes the descriptor lists to a binary mesh file with the texture size and source key
+// specified. Returns false if the file could not be written.
+
+static bool write_mesh_file(const char* path, const POLYHEDRON_DESC& desc, unsigned texture_width, unsigned texture_height, unsigned long long source_size, long long source_time)
+{
+	MeshFileHeader header = {};
+	memcpy(header.magic, MESH_FILE_MAGIC, sizeof(header.magic));
+	header.version = MESH_FILE_VERSION;
+	header.endianness = MESH_FILE_ENDIANNESS;
+	header.vertex_count = referenced_vertex_count(desc);
+	header.triangle_count = desc.triangle_count;
+	header.normal_count = desc.normal_vectors_list ? mesh_normal_count(desc, header.vertex_count) : 0u;
+	header.coloring = (unsigned)desc.coloring;
+	header.normal_computation = (header.normal_count || desc.normal_computation == POLYHEDRON_DESC::COMPUTED_SMOOTH_NORMALS) ? (unsigned)desc.normal_computation : (unsigned)POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS;
+	header.global_color = desc.global_color;
+	header.texture_width = texture_width;
+	header.texture_height = texture_height;
+	header.source_size = source_size;
+	header.source_time = source_time;
+
+	// Lay out the lists one after the other.
+	struct { const void* list; unsigned long long bytes; unsigned long long* offset; } lists[] =
+	{
+		{ desc.vertex_list, header.vertex_count * sizeof(Vector3f), &header.vertex_offset },
+		{ desc.triangle_list, header.triangle_count * sizeof(Vector3i), &header.triangle_offset },
+		{ desc.normal_vectors_list, header.normal_count * sizeof(Vector3f), &header.normal_offset },
+		{ desc.coloring == POLYHEDRON_DESC::PER_VERTEX_COLORING ? desc.color_list : nullptr, 3ull * header.triangle_count * sizeof(Color), &header.color_offset },
+		{ desc.coloring == POLYHEDRON_DESC::TEXTURED_COLORING ? desc.texture_coordinates_list : nullptr, 3ull * header.triangle_count * sizeof(Vector2i), &header.texcoord_offset },
+	};
+
+	unsigned long long offset = align_mesh_offset(sizeof(MeshFileHeader));
+	for (auto& list : lists)
+	{
+		if (!list.list || !list.bytes)
+			continue;
 
-	auto objToZeroBased = [](long idx, int countSoFar)
+		*list.offset = offset;
+		offset = align_mesh_offset(offset + list.bytes);
+	}
+
+	FILE* file = nullptr;
+	fopen_s(&file, path, "wb");
+	if (!file)
+		return false;
+
+	static const char zeros[MESH_FILE_ALIGNMENT] = {};
+	unsigned long long written = 0ull;
+	bool success = fwrite(&header, sizeof(MeshFileHeader), 1, file) == 1;
+	written += sizeof(MeshFileHeader);
+
+	for (auto& list : lists)
+	{
+		if (!success || !*list.offset)
+			continue;
+
+		success = fwrite(zeros, 1, size_t(*list.offset - written), file) == size_t(*list.offset - written)
+			&& fwrite(list.list, 1, size_t(list.bytes), file) == size_t(list.bytes);
+
+		written = *list.offset + list.bytes;
+	}
+
+	success = fclose(file) == 0 && success;
+
+	// Do not leave truncated files behind.
+	if (!success)
+		remove(path);
+
+	return success;
+}
+
+// Maps a binary mesh file and points the descriptor lists straight to the mapped data. 
+// Returns false if the file can not be opened or is not a valid mesh file, including files
+// with indices out of the vertex list. The header is optionally written to the pointer.
+
+static bool map_mesh_file(MappedFile& file, const char* path, POLYHEDRON_DESC& desc, MeshFileHeader* pHeader = nullptr)
+{
+	if (!file.open(path))
+		return false;
+
+	MeshFileHeader header;
+	if (file.size() < sizeof(MeshFileHeader))
+		return false;
+
+	memcpy(&header, file.data(), sizeof(MeshFileHeader));
+
+	if (memcmp(header.magic, MESH_FILE_MAGIC, sizeof(header.magic)) || header.version != MESH_FILE_VERSION || header.endianness != MESH_FILE_ENDIANNESS)
+		return false;
+
+	if (header.coloring > POLYHEDRON_DESC::GLOBAL_COLORING || header.normal_computation > POLYHEDRON_DESC::COMPUTED_SMOOTH_NORMALS)
+		return false;
+
+	// Every list must be aligned and fully inside the file.
+	auto list = [&](unsigned long long offset, unsigned long long bytes) -> void*
 		{
-			if (idx > 0) return (int)(idx - 1);
-			if (idx < 0) return (int)(countSoFar + idx); // idx is negative
-			return -1; // invalid in OBJ
+			if (!offset || offset % MESH_FILE_ALIGNMENT || offset > file.size() || bytes > file.size() - offset)
+				return nullptr;
+
+			return (void*)(file.data() + offset);
 		};
 
-	auto parseFaceCornerToken = [objToZeroBased](
-		const char* token,
-		int vpCountSoFar, int vtCountSoFar, int vnCountSoFar,
-		int& out_vp, int& out_vt, int& out_vn)
-		{
-			out_vp = out_vt = out_vn = -1;
+	desc = {};
+	desc.coloring = (POLYHEDRON_DESC::POLYHEDRON_COLORING)header.coloring;
+	desc.normal_computation = (POLYHEDRON_DESC::POLYHEDRON_NORMALS)header.normal_computation;
+	desc.global_color = header.global_color;
+	desc.triangle_count = header.triangle_count;
 
-			const char* p = token;
+	desc.vertex_list = (Vector3f*)list(header.vertex_offset, header.vertex_count * sizeof(Vector3f));
+	desc.triangle_list = (Vector3i*)list(header.triangle_offset, header.triangle_count * sizeof(Vector3i));
 
-			// v
-			char* end = nullptr;
-			long v = std::strtol(p, &end, 10);
-			USER_CHECK(end != p, "OBJ parse error: face token missing vertex index.");
-			out_vp = objToZeroBased(v, vpCountSoFar);
-			p = end;
+	if (!desc.vertex_list || !desc.triangle_list || !header.triangle_count)
+		return false;
 
-			if (*p == '\0') return;
-			USER_CHECK(*p == '/', "OBJ parse error: invalid face token format.");
+	// Every index must reference a stored vertex, stale or corrupt files are rejected.
+	const unsigned* indices = (const unsigned*)desc.triangle_list;
+	for (unsigned long long i = 0ull; i < 3ull * header.triangle_count; i++)
+		if (indices[i] >= header.vertex_count)
+			return false;
 
-			++p; // skip '/'
+	if (header.normal_count != mesh_normal_count(desc, header.vertex_count))
+		return false;
 
-			// Could be v//vn or v/vt[/vn]
-			if (*p != '/')
-			{
-				long vt = std::strtol(p, &end, 10);
-				if (end != p) out_vt = objToZeroBased(vt, vtCountSoFar);
-				p = end;
-			}
+	if (header.normal_count && !(desc.normal_vectors_list = (Vector3f*)list(header.normal_offset, header.normal_count * sizeof(Vector3f))))
+		return false;
 
-			if (*p == '\0') return;
-			USER_CHECK(*p == '/', "OBJ parse error: invalid face token format.");
+	if (desc.coloring == POLYHEDRON_DESC::PER_VERTEX_COLORING && !(desc.color_list = (Color*)list(header.color_offset, 3ull * header.triangle_count * sizeof(Color))))
+		return false;
 
-			++p; // skip '/'
+	if (desc.coloring == POLYHEDRON_DESC::TEXTURED_COLORING && !(desc.texture_coordinates_list = (Vector2i*)list(header.texcoord_offset, 3ull * header.triangle_count * sizeof(Vector2i))))
+		return false;
 
-			// vn (may be empty in malformed files; treat as missing)
-			if (*p != '\0')
-			{
-				long vn = std::strtol(p, &end, 10);
-				if (end != p) out_vn = objToZeroBased(vn, vnCountSoFar);
-			}
-		};
+	if (pHeader)
+		*pHeader = header;
+
+	return true;
+}
+
+// Copies the lists of a mapped descriptor to new allocations owned by the user.
+
+static POLYHEDRON_DESC copy_mesh_desc(const POLYHEDRON_DESC& view, const MeshFileHeader& header)
+{
+	POLYHEDRON_DESC desc = view;
 
-	auto countFaceCorners = [](char* lineAfterF)
+	auto copy = [](const auto* list, unsigned long long count)
 		{
-			// Counts tokens separated by whitespace
-			int count = 0;
-			char* p = lineAfterF;
-			while (*p)
-			{
-				while (*p == ' ' || *p == '\t') ++p;
-				if (*p == '\0' || *p == '\n' || *p == '\r') break;
+			typedef std::remove_const_t<std::remove_pointer_t<decltype(list)>> T;
+			if (!list)
+				return (T*)nullptr;
 
-				// token start
-				++count;
-				while (*p && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') ++p;
-			}
-			return count;
+			T* new_list = new T[count];
+			memcpy(new_list, list, count * sizeof(T));
+			return new_list;
 		};
 
-	// Pass 1: count
+	desc.vertex_list = copy(view.vertex_list, header.vertex_count);
+	desc.triangle_list = copy(view.triangle_list, header.triangle_count);
+	desc.normal_vectors_list = copy(view.normal_vectors_list, header.normal_count);
+	desc.color_list = copy(view.color_list, 3ull * header.triangle_count);
+	desc.texture_coordinates_list = copy(view.texture_coordinates_list, 3ull * header.triangle_count);
 
-	unsigned vertexCount = 0;
-	unsigned uvCount = 0;
-	unsigned normalCount = 0;
-	unsigned triangleCount = 0;
+	return desc;
+}
 
-	int W = 0, H = 0;
-	if (texture)
-		W = texture->width(), H = texture->height();
+// Maps the sidecar cache of an obj file if it exists and matches the current obj file 
+// size, modification time and the texture size. Returns false if the cache is not usable.
 
-	{
-		char line[2048];
-		while (fgets(line, sizeof(line), file))
-		{
-			char* p = line;
-			while (*p == ' ' || *p == '\t') ++p;
+static bool map_obj_cache(MappedFile& file, const char* obj_file_path, const Image* texture, POLYHEDRON_DESC& desc, MeshFileHeader* pHeader = nullptr)
+{
+	unsigned long long source_size;
+	long long source_time;
+	if (!get_file_key(obj_file_path, &source_size, &source_time))
+		return false;
 
-			if (*p == '\0' || *p == '\n' || *p == '\r' || *p == '#') continue;
+	MeshFileHeader header;
+	std::string cache_path = std::string(obj_file_path) + MESH_CACHE_EXTENSION;
+	if (!map_mesh_file(file, cache_path.c_str(), desc, &header))
+		return false;
 
-			if (startsWith(p, "v "))
-				++vertexCount;
+	if (header.source_size != source_size || header.source_time != source_time ||
+		header.texture_width != (texture ? texture->width() : 0u) ||
+		header.texture_height != (texture ? texture->height() : 0u))
+		return false;
 
-			else if (startsWith(p, "vt "))
-				++uvCount;
+	desc.texture_image = (Image*)texture;
 
-			else if (startsWith(p, "vn "))
-				++normalCount;
+	if (pHeader)
+		*pHeader = header;
 
-			else if (startsWith(p, "f "))
-			{
-				p += 2; // skip "f "
-				int corners = countFaceCorners(p);
-				USER_CHECK(corners >= 3, "OBJ parse error: face has fewer than 3 vertices.");
-				triangleCount += (unsigned)(corners - 2);
-			}
-		}
-	}
+	return true;
+}
 
-	if (vertexCount == 0 || triangleCount == 0)
+// Writes the sidecar cache of an obj file for the descriptor parsed from it. Failing to
+// write it is not an error, for example if the folder is read only.
+
+static void write_obj_cache(const char* obj_file_path, const Image* texture, const POLYHEDRON_DESC& desc)
+{
+	unsigned long long source_size;
+	long long source_time;
+	if (!get_file_key(obj_file_path, &source_size, &source_time))
+		return;
+
+	std::string cache_path = std::string(obj_file_path) + MESH_CACHE_EXTENSION;
+	write_mesh_file(cache_path.c_str(), desc, texture ? texture->width() : 0u, texture ? texture->height() : 0u, source_size, source_time);
+}
+
+// Writes the geometry of the descriptor to a binary mesh file (*.cmesh), that can be 
+// loaded back with getDescFromMesh() or a MeshView without any parsing. Vertices, 
+// triangles, normals, colors and texture coordinates are stored, along with the coloring 
+// and normal settings. Texture images are not stored.
+
+void Polyhedron::writeMeshFile(const char* mesh_file_path, const POLYHEDRON_DESC* pDesc)
+{
+	check_writable_desc(pDesc);
+
+	USER_CHECK(pDesc->coloring != POLYHEDRON_DESC::PER_VERTEX_COLORING || pDesc->color_list,
+		"Trying to write a mesh file from a per vertex colored descriptor without a color list."
+	);
+
+	USER_CHECK(pDesc->coloring != POLYHEDRON_DESC::TEXTURED_COLORING || pDesc->texture_coordinates_list,
+		"Trying to write a mesh file from a textured descriptor without texture coordinates."
+	);
+
+	const Image* texture = pDesc->coloring == POLYHEDRON_DESC::TEXTURED_COLORING ? pDesc->texture_image : nullptr;
+
+	USER_CHECK(write_mesh_file(mesh_file_path, *pDesc, texture ? texture->width() : 0u, texture ? texture->height() : 0u, 0ull, 0ll),
+		"Mesh file error: Unable to write the mesh file."
+	);
+}
+
+// Reads a binary mesh file written by writeMeshFile() and outputs a valid descriptor.
+// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+// The image pointer used is the same as provided.
+
+POLYHEDRON_DESC Polyhedron::getDescFromMesh(const char* mesh_file_path, Image* texture)
+{
+	MappedFile file;
+	POLYHEDRON_DESC view;
+	MeshFileHeader header;
+
+	USER_CHECK(map_mesh_file(file, mesh_file_path, view, &header),
+		"Mesh file error: Unable to open the file or it is not a valid mesh file."
+	);
+
+	POLYHEDRON_DESC desc = copy_mesh_desc(view, header);
+	desc.texture_image = texture;
+	return desc;
+}
+
+// Mesh view constructor, if the path is valid it will open the mesh file.
+
+MeshView::MeshView(const char* mesh_file_path, Image* texture)
+{
+	meshData = new MeshViewInternals;
+
+	if (mesh_file_path)
+		open(mesh_file_path, texture);
+}
+
+// Closes the view.
+
+MeshView::~MeshView()
+{
+	close();
+
+	delete (MeshViewInternals*)meshData;
+}
+
+// Maps the binary mesh file specified, closing the previous one if any. The texture
+// pointer is set on the descriptor and must be valid for textured meshes.
+
+void MeshView::open(const char* mesh_file_path, Image* texture)
+{
+	MeshViewInternals& data = *(MeshViewInternals*)meshData;
+
+	close();
+
+	bool valid = map_mesh_file(data.file, mesh_file_path, data.desc);
+	if (!valid)
 	{
-		fclose(file);
-		USER_ERROR("OBJ parse error: file contains no vertices or no faces.");
+		data.file.close();
+		data.desc = {};
 	}
 
-	// Allocate arrays owned by the user
-	desc.vertex_list = new Vector3f[vertexCount];
-	desc.triangle_list = new Vector3i[triangleCount];
-	desc.triangle_count = triangleCount;
+	USER_CHECK(valid,
+		"Mesh file error: Unable to open the file or it is not a valid mesh file."
+	);
 
-	// Temporary raw arrays for vt/vn
-	Vector2f* rawUV = nullptr;
-	Vector3f* rawNrm = nullptr;
-	if (uvCount) rawUV = new Vector2f[uvCount];
-	if (normalCount) rawNrm = new Vector3f[normalCount];
+	data.desc.texture_image = texture;
+}
 
-	// Decide whether to allocate per-triangle UVs and normals
-	bool wantTextured = (texture != nullptr) && (uvCount > 0);
-	bool wantPerTriNormals = (normalCount > 0);
+// Opens an obj file through its sidecar cache, if the cache is missing or out of date
+// the obj file is parsed and the cache written before mapping it.
 
-	// Set parameters
-	if (wantTextured)
+void MeshView::openObj(const char* obj_file_path, Image* texture)
+{
+	MeshViewInternals& data = *(MeshViewInternals*)meshData;
+
+	close();
+
+	if (map_obj_cache(data.file, obj_file_path, texture, data.desc))
+		return;
+
+	data.file.close();
+	data.desc = Polyhedron::getDescFromObj(obj_file_path, texture, true);
+
+	// If the cache could not be written keep the parsed lists instead.
+	POLYHEDRON_DESC view;
+	if (map_obj_cache(data.file, obj_file_path, texture, view))
 	{
-		desc.coloring = POLYHEDRON_DESC::TEXTURED_COLORING;
-		desc.texture_coordinates_list = new Vector2i[triangleCount * 3u];
+		delete[] data.desc.vertex_list;
+		delete[] data.desc.triangle_list;
+		delete[] data.desc.normal_vectors_list;
+		delete[] data.desc.texture_coordinates_list;
+		data.desc = view;
 	}
 	else
-		desc.coloring = POLYHEDRON_DESC::GLOBAL_COLORING;
+	{
+		data.file.close();
+		data.owns_lists = true;
+	}
+}
 
-	if (wantPerTriNormals)
+// Unmaps the file, the descriptor is no longer valid after this call.
+
+void MeshView::close()
+{
+	MeshViewInternals& data = *(MeshViewInternals*)meshData;
+
+	if (data.owns_lists)
 	{
-		desc.normal_computation = POLYHEDRON_DESC::PER_TRIANGLE_LIST_NORMALS;
-		desc.normal_vectors_list = new Vector3f[triangleCount * 3u];
+		delete[] data.desc.vertex_list;
+		delete[] data.desc.triangle_list;
+		delete[] data.desc.normal_vectors_list;
+		delete[] data.desc.color_list;
+		delete[] data.desc.texture_coordinates_list;
+		data.owns_lists = false;
 	}
-	else
-		desc.normal_computation = POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS;
 
+	data.file.close();
+	data.desc = {};
+}
 
-	// Cleanup helper
-	auto cleanupAndError = [&](const char* msg) -> void
-		{
-			delete[] desc.vertex_list;
-			delete[] desc.triangle_list;
-			delete[] desc.texture_coordinates_list;
-			delete[] desc.normal_vectors_list;
-			delete[] rawUV;
-			delete[] rawNrm;
+// Returns whether a mesh is currently open.
 
-			desc.vertex_list = nullptr;
-			desc.triangle_list = nullptr;
-			desc.texture_coordinates_list = nullptr;
-			desc.normal_vectors_list = nullptr;
+bool MeshView::isOpen() const
+{
+	MeshViewInternals& data = *(MeshViewInternals*)meshData;
 
-			fclose(file);
-			USER_ERROR(msg);
-		};
+	return data.desc.vertex_list != nullptr;
+}
+
+// Returns the descriptor of the open mesh, its lists point inside the mapped file and are
+// valid until the view is closed. It can be used to initialize any number of Polyhedrons.
+
+const POLYHEDRON_DESC* MeshView::getDesc() const
+{
+	MeshViewInternals& data = *(MeshViewInternals*)meshData;
+
+	USER_CHECK(data.desc.vertex_list,
+		"Trying to get the descriptor of a MeshView that is not open."
+	);
+
+	return &data.desc;
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Triangle mesh formatting support
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Number of bytes of text parsed by every parallel chunk of an OBJ file.
+#define OBJ_TEXT_CHUNK (1u << 22)
+
+// Face corner as read from an OBJ file, with zero based indices or -1 if missing. Negative 
+// indices are stored relative to the elements found on the chunk so far and flagged, they 
+// are fixed up once the element counts of the previous chunks are known.
+struct ObjCorner
+{
+	int vp, vt, vn;
+	unsigned char relative;
+};
+
+// Relative index flags of the face corners.
+#define OBJ_RELATIVE_VP 1u
+#define OBJ_RELATIVE_VT 2u
+#define OBJ_RELATIVE_VN 4u
+
+// Elements parsed from a chunk of an OBJ file, faces are stored already triangulated.
+struct ObjChunk
+{
+	const char* begin = nullptr;
+	const char* end = nullptr;
+
+	std::vector<Vector3f> positions;
+	std::vector<Vector2f> uvs;
+	std::vector<Vector3f> normals;
+	std::vector<ObjCorner> corners;
+
+	// Number of elements found on the previous chunks.
+	unsigned vp_base = 0u;
+	unsigned vt_base = 0u;
+	unsigned vn_base = 0u;
+	unsigned tri_base = 0u;
+
+	// First error found on the chunk, if any.
+	const char* error = nullptr;
+};
+
+// Skips the spaces and tabs at the cursor, carriage returns are treated as blanks.
+
+static inline const char* skip_obj_blanks(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		p++;
+	return p;
+}
+
+// Reads up to the maximum number of floats separated by blanks, returns how many were read.
+
+static unsigned read_obj_floats(const char* p, const char* end, float* values, unsigned max)
+{
+	unsigned n = 0u;
+	while (n < max)
+	{
+		p = skip_obj_blanks(p, end);
+		if (p < end && *p == '+')
+			p++;
+
+		std::from_chars_result result = std::from_chars(p, end, values[n]);
+		if (result.ec != std::errc())
+			break;
+
+		p = result.ptr;
+		n++;
+	}
+	return n;
+}
 
-	// Pass 2: fill
+// Reads an OBJ index at the cursor and advances it. Positive indices are converted to zero 
+// based, negative ones are converted relative to the local count and the flag is added to 
+// the corner. Returns false if there is no valid index at the cursor.
+
+static bool read_obj_index(const char*& p, const char* end, size_t local_count, int& index, unsigned char& relative, unsigned char flag)
+{
+	if (p < end && *p == '+')
+		p++;
 
-	rewind(file);
+	long long value = 0;
+	std::from_chars_result result = std::from_chars(p, end, value);
+	if (result.ec != std::errc() || value == 0 || value > INT_MAX || value < -INT_MAX)
+		return false;
 
-	unsigned vpSoFar = 0;
-	unsigned vtSoFar = 0;
-	unsigned vnSoFar = 0;
-	unsigned triSoFar = 0;
+	p = result.ptr;
+	if (value > 0)
+		index = int(value - 1);
+	else
+	{
+		index = int((long long)local_count + value);
+		relative |= flag;
+	}
+	return true;
+}
 
-	// We keep texturing enabled when possible, and default missing VT to (0,0).
-	// We keep normals enabled only if faces actually provide them.
+// Parses the corners of a face line and stores it fan triangulated on the chunk. 
+// Faces can have any number of corners. Returns an error message if the line is invalid.
 
-	const int MAX_FACE_CORNERS = 256;
-	int faceVP[MAX_FACE_CORNERS];
-	int faceVT[MAX_FACE_CORNERS];
-	int faceVN[MAX_FACE_CORNERS];
+static const char* parse_obj_face(const char* p, const char* end, ObjChunk& chunk)
+{
+	ObjCorner first = {};
+	ObjCorner previous = {};
+	unsigned corner_count = 0u;
 
-	char line[2048];
-	while (fgets(line, (int)sizeof(line), file))
+	while (true)
 	{
-		char* p = line;
-		while (*p == ' ' || *p == '\t') ++p;
+		p = skip_obj_blanks(p, end);
+		if (p >= end || *p == '#')
+			break;
 
-		if (*p == '\0' || *p == '\n' || *p == '\r' || *p == '#') continue;
+		ObjCorner corner = { -1, -1, -1, 0u };
+		if (!read_obj_index(p, end, chunk.positions.size(), corner.vp, corner.relative, OBJ_RELATIVE_VP))
+			return "OBJ parse error: face token missing vertex index.";
 
-		if (startsWith(p, "v "))
+		// Could be v/vt, v//vn or v/vt/vn, missing attributes stay at -1.
+		if (p < end && *p == '/')
 		{
-			p += 2;
-			char* end = nullptr;
-			float x = strtof(p, &end); if (end == p) cleanupAndError("OBJ parse error: invalid v line.");
-			p = end; float y = strtof(p, &end); if (end == p) cleanupAndError("OBJ parse error: invalid v line.");
-			p = end; float z = strtof(p, &end); if (end == p) cleanupAndError("OBJ parse error: invalid v line.");
+			p++;
+			if (p < end && *p != '/')
+				read_obj_index(p, end, chunk.uvs.size(), corner.vt, corner.relative, OBJ_RELATIVE_VT);
 
-			desc.vertex_list[vpSoFar] = { x, y, z };
-			++vpSoFar;
+			if (p < end && *p == '/')
+			{
+				p++;
+				read_obj_index(p, end, chunk.normals.size(), corner.vn, corner.relative, OBJ_RELATIVE_VN);
+			}
 		}
-		else if (startsWith(p, "vt "))
-		{
-			p += 3;
-			char* end = nullptr;
-			float u = strtof(p, &end); if (end == p) cleanupAndError("OBJ parse error: invalid vt line.");
-			p = end; float v = strtof(p, &end); if (end == p) cleanupAndError("OBJ parse error: invalid vt line.");
 
-			if (rawUV)
-				rawUV[vtSoFar] = { u, v };
+		if (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+			return "OBJ parse error: invalid face token format.";
 
-			++vtSoFar;
-		}
-		else if (startsWith(p, "vn "))
+		// Fan triangulation: (0, i, i+1)
+		if (corner_count >= 2u)
 		{
-			p += 3;
-			char* end = nullptr;
-			float x = strtof(p, &end); if (end == p) cleanupAndError("OBJ parse error: invalid vn line.");
-			p = end; float y = strtof(p, &end); if (end == p) cleanupAndError("OBJ parse error: invalid vn line.");
-			p = end; float z = strtof(p, &end); if (end == p) cleanupAndError("OBJ parse error: invalid vn line.");
+			chunk.corners.push_back(first);
+			chunk.corners.push_back(previous);
+			chunk.corners.push_back(corner);
+		}
+		else if (!corner_count)
+			first = corner;
 
-			if (rawNrm)
-				rawNrm[vnSoFar] = { x, y, z };
+		previous = corner;
+		corner_count++;
+	}
 
-			++vnSoFar;
-		}
-		else if (startsWith(p, "f "))
-		{
-			p += 2;
+	if (corner_count < 3u)
+		return "OBJ parse error: face has fewer than 3 vertices.";
 
-			// Extract tokens
-			int cornerCount = 0;
-			while (*p)
-			{
-				while (*p == ' ' || *p == '\t') ++p;
-				if (*p == '\0' || *p == '\n' || *p == '\r') break;
+	return nullptr;
+}
 
-				if (cornerCount >= MAX_FACE_CORNERS)
-					cleanupAndError("OBJ parse error: face has too many vertices (increase MAX_FACE_CORNERS).");
+// Parses all the lines of a chunk in a single pass, the elements are stored on the chunk 
+// lists and the first error found stops the parsing. Unsupported lines are ignored.
+
+static void parse_obj_chunk(ObjChunk& chunk)
+{
+	const char* line = chunk.begin;
+	while (line < chunk.end && !chunk.error)
+	{
+		const char* line_end = (const char*)memchr(line, '\n', size_t(chunk.end - line));
+		if (!line_end)
+			line_end = chunk.end;
+
+		const char* p = skip_obj_blanks(line, line_end);
+		line = line_end + 1;
+
+		if (line_end - p < 2)
+			continue;
+
+		auto blank = [](char c) { return c == ' ' || c == '\t'; };
+
+		if (p[0] == 'v' && blank(p[1]))
+		{
+			float v[3];
+			if (read_obj_floats(p + 2, line_end, v, 3u) < 3u)
+				chunk.error = "OBJ parse error: invalid v line.";
+			else
+				chunk.positions.push_back({ v[0], v[1], v[2] });
+		}
+		else if (p[0] == 'v' && p[1] == 't' && line_end - p > 2 && blank(p[2]))
+		{
+			// The second texture coordinate is optional and defaults to zero.
+			float v[2] = { 0.f, 0.f };
+			if (!read_obj_floats(p + 3, line_end, v, 2u))
+				chunk.error = "OBJ parse error: invalid vt line.";
+			else
+				chunk.uvs.push_back({ v[0], v[1] });
+		}
+		else if (p[0] == 'v' && p[1] == 'n' && line_end - p > 2 && blank(p[2]))
+		{
+			float v[3];
+			if (read_obj_floats(p + 3, line_end, v, 3u) < 3u)
+				chunk.error = "OBJ parse error: invalid vn line.";
+			else
+				chunk.normals.push_back({ v[0], v[1], v[2] });
+		}
+		else if (p[0] == 'f' && blank(p[1]))
+			chunk.error = parse_obj_face(p + 2, line_end, chunk);
+
+		// else ignore: comments, usemtl, mtllib, o, g, s, etc.
+	}
+}
+
+// To facilitate the loading of triangle meshes, this function is a parser for 
+// *.obj files, that reads the files and outputs a valid descriptor. If the file 
+// supports texturing, optionally accepts an image to be used as texture_image.
+// If the cache is enabled the result is also stored next to the obj file as a 
+// binary mesh file, and later calls with the same obj file and texture size 
+// read it instead of parsing the text again.
+// NOTE: All data is allocated by (new) and its deletion must be handled by the 
+// user. The image pointer used is the same as provided.
+
+POLYHEDRON_DESC Polyhedron::getDescFromObj(const char* obj_file_path, Image* texture, bool use_cache)
+{
+	// A valid sidecar cache skips the parsing entirely.
+	if (use_cache)
+	{
+		MappedFile cache;
+		POLYHEDRON_DESC view;
+		MeshFileHeader header;
+
+		if (map_obj_cache(cache, obj_file_path, texture, view, &header))
+			return copy_mesh_desc(view, header);
+	}
+
+	// The file is mapped and parsed in a single pass by chunks in parallel.
+	MappedFile file(obj_file_path);
+	USER_CHECK(file.isOpen(),
+		"OBJ parse error: Unable to open OBJ file."
+	);
+
+	const char* begin = file.data();
+	const char* end = begin + file.size();
+
+	// Split the file in chunks that start at line beginnings, so lines of any length
+	// are always parsed whole by the same chunk.
+	unsigned n_chunks = unsigned(file.size() / OBJ_TEXT_CHUNK) + 1u;
+	ObjChunk* chunks = new ObjChunk[n_chunks];
+
+	const char* start = begin;
+	for (unsigned c = 0u; c < n_chunks; c++)
+	{
+		const char* stop = end;
+		if (c + 1u < n_chunks)
+		{
+			stop = begin + (unsigned long long)(c + 1u) * OBJ_TEXT_CHUNK;
+			if (stop < start)
+				stop = start;
+
+			const char* new_line = (const char*)memchr(stop, '\n', size_t(end - stop));
+			stop = new_line ? new_line + 1 : end;
+		}
+
+		chunks[c].begin = start;
+		chunks[c].end = stop;
+		start = stop;
+	}
+
+	ThreadPool::parallelFor(n_chunks, 1u, [&](unsigned first, unsigned last, unsigned)
+	{
+		for (unsigned c = first; c < last; c++)
+			parse_obj_chunk(chunks[c]);
+	});
+
+	// Report the first error of the file, if any.
+	for (unsigned c = 0u; c < n_chunks; c++)
+	{
+		if (chunks[c].error)
+		{
+			const char* error = chunks[c].error;
+			delete[] chunks;
+			USER_ERROR(error);
+		}
+	}
+
+	// Prefix sums of the element counts, every chunk learns where its elements go.
+	unsigned vertexCount = 0u;
+	unsigned uvCount = 0u;
+	unsigned normalCount = 0u;
+	unsigned triangleCount = 0u;
+
+	for (unsigned c = 0u; c < n_chunks; c++)
+	{
+		chunks[c].vp_base = vertexCount;
+		chunks[c].vt_base = uvCount;
+		chunks[c].vn_base = normalCount;
+		chunks[c].tri_base = triangleCount;
+
+		vertexCount += (unsigned)chunks[c].positions.size();
+		uvCount += (unsigned)chunks[c].uvs.size();
+		normalCount += (unsigned)chunks[c].normals.size();
+		triangleCount += (unsigned)chunks[c].corners.size() / 3u;
+	}
+
+	if (vertexCount == 0 || triangleCount == 0)
+	{
+		delete[] chunks;
+		USER_ERROR("OBJ parse error: file contains no vertices or no faces.");
+	}
+
+	POLYHEDRON_DESC desc = {};
+	desc.texture_image = texture;
+
+	int W = 0, H = 0;
+	if (texture)
+		W = texture->width(), H = texture->height();
+
+	// Allocate arrays owned by the user
+	desc.vertex_list = new Vector3f[vertexCount];
+	desc.triangle_list = new Vector3i[triangleCount];
+	desc.triangle_count = triangleCount;
+
+	// Decide whether to allocate per-triangle UVs and normals
+	bool wantTextured = (texture != nullptr) && (uvCount > 0);
+	bool wantPerTriNormals = (normalCount > 0);
+
+	// Temporary raw arrays for vt/vn
+	Vector2f* rawUV = nullptr;
+	Vector3f* rawNrm = nullptr;
+	if (wantTextured) rawUV = new Vector2f[uvCount];
+	if (wantPerTriNormals) rawNrm = new Vector3f[normalCount];
+
+	// Set parameters
+	if (wantTextured)
+	{
+		desc.coloring = POLYHEDRON_DESC::TEXTURED_COLORING;
+		desc.texture_coordinates_list = new Vector2i[triangleCount * 3u];
+	}
+	else
+		desc.coloring = POLYHEDRON_DESC::GLOBAL_COLORING;
+
+	if (wantPerTriNormals)
+	{
+		desc.normal_computation = POLYHEDRON_DESC::PER_TRIANGLE_LIST_NORMALS;
+		desc.normal_vectors_list = new Vector3f[triangleCount * 3u];
+	}
+	else
+		desc.normal_computation = POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS;
+
+	// Gather the elements of every chunk, faces can reference elements of any chunk 
+	// so all of them must be in place before the fix-up.
+	ThreadPool::parallelFor(n_chunks, 1u, [&](unsigned first, unsigned last, unsigned)
+	{
+		for (unsigned c = first; c < last; c++)
+		{
+			ObjChunk& chunk = chunks[c];
+
+			if (!chunk.positions.empty())
+				memcpy(desc.vertex_list + chunk.vp_base, chunk.positions.data(), chunk.positions.size() * sizeof(Vector3f));
+
+			if (rawUV && !chunk.uvs.empty())
+				memcpy(rawUV + chunk.vt_base, chunk.uvs.data(), chunk.uvs.size() * sizeof(Vector2f));
+
+			if (rawNrm && !chunk.normals.empty())
+				memcpy(rawNrm + chunk.vn_base, chunk.normals.data(), chunk.normals.size() * sizeof(Vector3f));
+
+			std::vector<Vector3f>().swap(chunk.positions);
+			std::vector<Vector2f>().swap(chunk.uvs);
+			std::vector<Vector3f>().swap(chunk.normals);
+		}
+	});
+
+	// Fix-up pass, relative indices get the chunk bases added and the triangles are 
+	// written with their texture coordinates and normals.
+	std::atomic<bool> out_of_range = false;
+	std::atomic<bool> missing_normals = false;
+
+	ThreadPool::parallelFor(n_chunks, 1u, [&](unsigned first, unsigned last, unsigned)
+	{
+		// Common convention: flip V. If your textures appear upside down, remove (1 - v).
+		auto uvToPixel = [&](const Vector2f& uv) -> Vector2i
+			{
+				int px = (int)(uv.x * (float)(W - 1) + 0.5f);
+				int py = (int)((1.0f - uv.y) * (float)(H - 1) + 0.5f);
+
+				if (px < 0) px = 0; else if (px >= W) px = W - 1;
+				if (py < 0) py = 0; else if (py >= H) py = H - 1;
+				return Vector2i{ px, py };
+			};
+
+		for (unsigned c = first; c < last; c++)
+		{
+			ObjChunk& chunk = chunks[c];
+			unsigned chunk_triangles = (unsigned)chunk.corners.size() / 3u;
+
+			for (unsigned t = 0u; t < chunk_triangles; t++)
+			{
+				unsigned tri = chunk.tri_base + t;
+				int vp[3], vt[3], vn[3];
+
+				for (unsigned k = 0u; k < 3u; k++)
+				{
+					const ObjCorner& corner = chunk.corners[3u * t + k];
+
+					vp[k] = (corner.relative & OBJ_RELATIVE_VP) ? corner.vp + (int)chunk.vp_base : corner.vp;
+					vt[k] = (corner.relative & OBJ_RELATIVE_VT) ? corner.vt + (int)chunk.vt_base : corner.vt;
+					vn[k] = (corner.relative & OBJ_RELATIVE_VN) ? corner.vn + (int)chunk.vn_base : corner.vn;
+
+					if (vp[k] < 0 || vp[k] >= (int)vertexCount)
+						out_of_range = true;
+				}
+
+				desc.triangle_list[tri] = Vector3i{ vp[0], vp[1], vp[2] };
+
+				// Per-triangle UVs -> pixel coords (3 per triangle), missing VT default to (0,0).
+				if (wantTextured)
+				{
+					for (unsigned k = 0u; k < 3u; k++)
+						desc.texture_coordinates_list[3u * tri + k] = (vt[k] < 0 || vt[k] >= (int)uvCount) ? Vector2i{ 0, 0 } : uvToPixel(rawUV[vt[k]]);
+				}
+
+				// Per-triangle-corner normals (3 per triangle), if any corner lacks 
+				// a normal the list is dropped and normals are computed instead.
+				if (wantPerTriNormals)
+				{
+					for (unsigned k = 0u; k < 3u; k++)
+					{
+						if (vn[k] < 0 || vn[k] >= (int)normalCount)
+							missing_normals = true;
+						else
+							desc.normal_vectors_list[3u * tri + k] = rawNrm[vn[k]];
+					}
+				}
+			}
+		}
+	});
+
+	// Temp arrays no longer needed
+	delete[] chunks;
+	delete[] rawUV;
+	delete[] rawNrm;
+
+	if (out_of_range)
+	{
+		delete[] desc.vertex_list;
+		delete[] desc.triangle_list;
+		delete[] desc.texture_coordinates_list;
+		delete[] desc.normal_vectors_list;
+
+		USER_ERROR("OBJ parse error: face vertex index out of range.");
+	}
+
+	if (missing_normals)
+	{
+		delete[] desc.normal_vectors_list;
+		desc.normal_vectors_list = nullptr;
+		desc.normal_computation = POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS;
+	}
+
+	if (use_cache)
+		write_obj_cache(obj_file_path, texture, desc);
+
+	return desc;
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Binary STL and PLY support
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Number of triangles or vertices processed per parallel chunk by the binary formats.
+#define BINARY_MESH_CHUNK 65536u
+// Size in bytes of the STL header and of every STL triangle record.
+#define STL_HEADER_SIZE 84u
+#define STL_TRIANGLE_SIZE 50u
+
+// Returns a hash of the position, used to find the corners that share a vertex. Negative 
+// zeros are hashed as zeros so that they can be welded with their positive counterparts.
+
+static inline unsigned long long position_hash(const Vector3f& p)
+{
+	float coords[3] = { p.x == 0.f ? 0.f : p.x, p.y == 0.f ? 0.f : p.y, p.z == 0.f ? 0.f : p.z };
+	unsigned bits[3];
+	memcpy(bits, coords, sizeof(bits));
+
+	unsigned long long h = (((unsigned long long)bits[0] << 32) | bits[1]) * 0x9E3779B97F4A7C15ull;
+	h ^= (unsigned long long)bits[2] * 0xC2B2AE3D27D4EB4Full;
+	h ^= h >> 31;
+	h *= 0x94D049BB133111EBull;
+	return h ^ (h >> 29);
+}
+
+// Welds the corners that have the exact same position. Writes the vertex index of every corner
+// and allocates the vertex list, with the vertices in order of first appearance. Returns the
+// vertex count. Corners are sorted by position hash and every run of equal hashes is resolved
+// by comparing the actual positions, so hash collisions never weld different vertices.
+
+static unsigned weld_exact_corners(const Vector3f* corners, unsigned count, unsigned* corner_vertex, Vector3f** vertex_list)
+{
+	unsigned long long* keys = new unsigned long long[count];
+	unsigned* order = new unsigned[count];
+	unsigned* representative = new unsigned[count];
+
+	ThreadPool::parallelFor(count, BINARY_MESH_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = begin; i < end; i++)
+		{
+			keys[i] = position_hash(corners[i]);
+			order[i] = i;
+		}
+	});
+
+	ThreadPool::radixSort(keys, order, count);
+
+	// Chunks start and end at run boundaries. The sort is stable, so the first corner
+	// of every group of equal positions is its first appearance and its representative.
+	ThreadPool::parallelFor(count, BINARY_MESH_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		while (begin > 0u && begin < count && keys[begin] == keys[begin - 1u])
+			begin++;
+		while (end < count && keys[end] == keys[end - 1u])
+			end++;
+
+		std::vector<unsigned> groups;
+		for (unsigned i = begin; i < end; i++)
+		{
+			if (i == begin || keys[i] != keys[i - 1u])
+				groups.clear();
+
+			unsigned corner = order[i];
+			const Vector3f& p = corners[corner];
+
+			unsigned rep = corner;
+			for (unsigned g : groups)
+			{
+				const Vector3f& q = corners[g];
+				if (p.x == q.x && p.y == q.y && p.z == q.z)
+				{
+					rep = g;
+					break;
+				}
+			}
+
+			if (rep == corner)
+				groups.push_back(corner);
+
+			representative[corner] = rep;
+		}
+	});
+
+	// Number the representatives in corner order, reusing the order array for the indices.
+	unsigned n_chunks = (count + BINARY_MESH_CHUNK - 1u) / BINARY_MESH_CHUNK;
+	unsigned* chunk_offsets = new unsigned[n_chunks];
+
+	ThreadPool::parallelFor(count, BINARY_MESH_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		unsigned n = 0u;
+		for (unsigned i = begin; i < end; i++)
+			n += representative[i] == i;
+		chunk_offsets[begin / BINARY_MESH_CHUNK] = n;
+	});
+
+	unsigned vertex_count = 0u;
+	for (unsigned c = 0u; c < n_chunks; c++)
+	{
+		unsigned n = chunk_offsets[c];
+		chunk_offsets[c] = vertex_count;
+		vertex_count += n;
+	}
+
+	Vector3f* vertices = new Vector3f[vertex_count];
+
+	ThreadPool::parallelFor(count, BINARY_MESH_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		unsigned index = chunk_offsets[begin / BINARY_MESH_CHUNK];
+		for (unsigned i = begin; i < end; i++)
+		{
+			if (representative[i] == i)
+			{
+				vertices[index] = corners[i];
+				order[i] = index++;
+			}
+		}
+	});
+
+	// Representatives always come before the corners they represent.
+	ThreadPool::parallelFor(count, BINARY_MESH_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = begin; i < end; i++)
+			corner_vertex[i] = order[representative[i]];
+	});
+
+	delete[] keys;
+	delete[] order;
+	delete[] representative;
+	delete[] chunk_offsets;
+
+	*vertex_list = vertices;
+	return vertex_count;
+}
+
+// To facilitate the loading of CAD meshes, this function is a parser for binary *.stl
+// files. STL stores every triangle with its own three vertices, so corners with the exact
+// same position are welded into a shared vertex list. Normals are computed per triangle.
+// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+
+POLYHEDRON_DESC Polyhedron::getDescFromStl(const char* stl_file_path)
+{
+	MappedFile file(stl_file_path);
+	USER_CHECK(file.isOpen(),
+		"STL parse error: Unable to open STL file."
+	);
+
+	unsigned triangle_count = 0u;
+	if (file.size() >= STL_HEADER_SIZE)
+		memcpy(&triangle_count, file.data() + STL_HEADER_SIZE - 4u, 4u);
+
+	// Binary files can also start with "solid", so the size is what identifies them.
+	bool binary = file.size() >= STL_HEADER_SIZE && file.size() == STL_HEADER_SIZE + (unsigned long long)triangle_count * STL_TRIANGLE_SIZE;
+
+	USER_CHECK(binary || file.size() < 5u || strncmp(file.data(), "solid", 5u),
+		"STL parse error: ASCII STL files are not supported, only binary STL files can be loaded."
+	);
+
+	USER_CHECK(binary,
+		"STL parse error: The file size does not match the triangle count of its header."
+	);
+
+	USER_CHECK(triangle_count && triangle_count < 0x55555555u,
+		"STL parse error: Invalid triangle count found on the STL header."
+	);
+
+	// Read the corners of every triangle, the facet normals are ignored.
+	unsigned corner_count = 3u * triangle_count;
+	Vector3f* corners = new Vector3f[corner_count];
+	const char* records = file.data() + STL_HEADER_SIZE;
+
+	ThreadPool::parallelFor(triangle_count, BINARY_MESH_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned t = begin; t < end; t++)
+		{
+			const char* record = records + (unsigned long long)t * STL_TRIANGLE_SIZE + 12u;
+			for (unsigned k = 0u; k < 3u; k++)
+			{
+				Vector3f& p = corners[3u * t + k];
+				memcpy(&p.x, record + 12u * k + 0u, 4u);
+				memcpy(&p.y, record + 12u * k + 4u, 4u);
+				memcpy(&p.z, record + 12u * k + 8u, 4u);
+			}
+		}
+	});
+
+	POLYHEDRON_DESC desc = {};
+	desc.triangle_count = triangle_count;
+	desc.triangle_list = new Vector3i[triangle_count];
+	desc.coloring = POLYHEDRON_DESC::GLOBAL_COLORING;
+	desc.normal_computation = POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS;
+
+	weld_exact_corners(corners, corner_count, (unsigned*)desc.triangle_list, &desc.vertex_list);
+
+	delete[] corners;
+	return desc;
+}
+
+// To facilitate the loading of scanned meshes, this function is a parser for binary *.ply
+// files. It reads the vertex positions, and the normals, colors and texture coordinates if 
+// present, and the faces, that are fan triangulated. Texture coordinates are only used if 
+// an image is provided, otherwise vertex colors are used if present.
+// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+// The image pointer used is the same as provided.
+
+POLYHEDRON_DESC Polyhedron::getDescFromPly(const char* ply_file_path, Image* texture)
+{
+	MappedFile file(ply_file_path);
+	USER_CHECK(file.isOpen(),
+		"PLY parse error: Unable to open PLY file."
+	);
+
+	const char* begin = file.data();
+	const char* end = begin + file.size();
+
+	USER_CHECK(file.size() >= 3u && !strncmp(begin, "ply", 3u),
+		"PLY parse error: The file does not start with the PLY magic number."
+	);
+
+	// Vertex layout found in the header.
+	enum { X, Y, Z, NX, NY, NZ, RED, GREEN, BLUE, ALPHA, U, V, N_FIELDS };
+	const char* field_names[N_FIELDS][3] =
+	{
+		{ "x" }, { "y" }, { "z" }, { "nx" }, { "ny" }, { "nz" },
+		{ "red", "diffuse_red" }, { "green", "diffuse_green" }, { "blue", "diffuse_blue" }, { "alpha", "diffuse_alpha" },
+		{ "u", "s", "texture_u" }, { "v", "t", "texture_v" },
+	};
+	unsigned offsets[N_FIELDS] = {};
+	PLY_TYPE types[N_FIELDS] = {};
+
+	// Face layout found in the header, lists have a count type.
+	struct FaceProperty
+	{
+		PLY_TYPE type;
+		PLY_TYPE count_type;
+		bool indices;
+	};
+	std::vector<FaceProperty> face_properties;
+
+	enum { BEFORE_VERTICES, VERTICES, BEFORE_FACES, FACES, AFTER_FACES } section = BEFORE_VERTICES;
+
+	bool binary = false, swap = false;
+	unsigned vertex_count = 0u, face_count = 0u, stride = 0u;
+	unsigned long long element_count = 0ull, skip_before = 0ull, skip_between = 0ull, header_size = 0ull;
+
+	// Parse the header line by line until end_header.
+	const char* cursor = begin;
+	while (true)
+	{
+		while (cursor < end && *cursor != '\n')
+			cursor++;
+
+		USER_CHECK(cursor < end,
+			"PLY parse error: The header end was not found."
+		);
+
+		cursor++;
+
+		unsigned length;
+		const char* keyword = ply_word(cursor, end, &length);
+
+		if (ply_equals(keyword, length, "end_header"))
+		{
+			while (cursor < end && *cursor != '\n')
+				cursor++;
+
+			header_size = (unsigned long long)(cursor + 1 - begin);
+			break;
+		}
+
+		if (ply_equals(keyword, length, "format"))
+		{
+			const char* format = ply_word(cursor, end, &length);
+
+			USER_CHECK(!ply_equals(format, length, "ascii"),
+				"PLY parse error: ASCII PLY meshes are not supported, only binary PLY files can be loaded."
+			);
+
+			binary = true;
+			swap = ply_equals(format, length, "binary_big_endian");
+		}
+		else if (ply_equals(keyword, length, "element"))
+		{
+			const char* name = ply_word(cursor, end, &length);
+			bool is_vertex = ply_equals(name, length, "vertex");
+			bool is_face = ply_equals(name, length, "face");
+
+			const char* count = ply_word(cursor, end, &length);
+			element_count = strtoull(count, nullptr, 10);
+
+			USER_CHECK(!is_face || section != BEFORE_VERTICES,
+				"PLY parse error: Faces declared before the vertices are not supported."
+			);
+
+			USER_CHECK(!(is_vertex || is_face) || (element_count && element_count < 0xFFFFFFFFull),
+				"PLY parse error: Invalid vertex or face count found on the PLY header."
+			);
+
+			if (is_vertex)
+			{
+				section = VERTICES;
+				vertex_count = unsigned(element_count);
+			}
+			else if (is_face)
+			{
+				section = FACES;
+				face_count = unsigned(element_count);
+			}
+			else if (section == VERTICES)
+				section = BEFORE_FACES;
+			else if (section == FACES)
+				section = AFTER_FACES;
+		}
+		else if (ply_equals(keyword, length, "property"))
+		{
+			// Elements after the faces are not read.
+			if (section == AFTER_FACES)
+				continue;
+
+			const char* type_name = ply_word(cursor, end, &length);
+			bool list = ply_equals(type_name, length, "list");
+
+			USER_CHECK(!list || section == FACES,
+				"PLY parse error: List properties are only supported on faces."
+			);
+
+			PLY_TYPE count_type = PLY_INVALID;
+			if (list)
+			{
+				const char* count_name = ply_word(cursor, end, &length);
+				count_type = ply_type(count_name, length);
+				type_name = ply_word(cursor, end, &length);
+
+				USER_CHECK(count_type != PLY_INVALID && count_type != PLY_FLOAT32 && count_type != PLY_FLOAT64,
+					"PLY parse error: Invalid list count type found on the PLY header."
+				);
+			}
+
+			PLY_TYPE type = ply_type(type_name, length);
+			USER_CHECK(type != PLY_INVALID,
+				"PLY parse error: Unrecognized property type found on the PLY header."
+			);
+
+			const char* name = ply_word(cursor, end, &length);
+
+			switch (section)
+			{
+			case VERTICES:
+				for (unsigned f = 0u; f < N_FIELDS; f++)
+					for (const char* field : field_names[f])
+						if (field && ply_equals(name, length, field))
+						{
+							offsets[f] = stride;
+							types[f] = type;
+						}
+
+				stride += ply_size(type);
+				break;
+
+			case FACES:
+				face_properties.push_back({ type, count_type, list && (ply_equals(name, length, "vertex_indices") || ply_equals(name, length, "vertex_index")) });
+				break;
+
+			// Other elements before the faces are skipped, they have fixed size.
+			case BEFORE_VERTICES:
+				skip_before += element_count * ply_size(type);
+				break;
+
+			default:
+				skip_between += element_count * ply_size(type);
+				break;
+			}
+		}
+	}
+
+	USER_CHECK(binary,
+		"PLY parse error: No format line found on the PLY header."
+	);
+
+	USER_CHECK(vertex_count && types[X] && types[Y] && types[Z],
+		"PLY parse error: The PLY file does not contain vertices with x, y and z coordinates."
+	);
+
+	unsigned index_property = 0u;
+	while (index_property < face_properties.size() && !face_properties[index_property].indices)
+		index_property++;
+
+	USER_CHECK(face_count && index_property < face_properties.size(),
+		"PLY parse error: The PLY file does not contain faces with a vertex index list."
+	);
+
+	unsigned long long vertex_offset = header_size + skip_before;
+	unsigned long long face_offset = vertex_offset + (unsigned long long)vertex_count * stride + skip_between;
+
+	USER_CHECK(face_offset <= file.size(),
+		"PLY parse error: The file is shorter than the data declared on its header."
+	);
+
+	// Faces have variable size, a quick scan finds where every chunk of faces starts and 
+	// how many triangles come before it, so they can be decoded in parallel afterwards.
+	unsigned n_chunks = (face_count + BINARY_MESH_CHUNK - 1u) / BINARY_MESH_CHUNK;
+	unsigned long long* chunk_starts = new unsigned long long[n_chunks];
+	unsigned* chunk_triangles = new unsigned[n_chunks];
+
+	const char* scan_error = nullptr;
+	unsigned long long triangle_total = 0ull;
+	const char* face = begin + face_offset;
+
+	for (unsigned f = 0u; f < face_count && !scan_error; f++)
+	{
+		if (f % BINARY_MESH_CHUNK == 0u)
+		{
+			chunk_starts[f / BINARY_MESH_CHUNK] = (unsigned long long)(face - begin);
+			chunk_triangles[f / BINARY_MESH_CHUNK] = unsigned(triangle_total);
+		}
+
+		for (unsigned p = 0u; p < face_properties.size(); p++)
+		{
+			const FaceProperty& property = face_properties[p];
+			unsigned count_size = ply_size(property.count_type);
+
+			if (end - face < (long long)(count_size ? count_size : ply_size(property.type)))
+			{
+				scan_error = "PLY parse error: The file is shorter than the data declared on its header.";
+				break;
+			}
+
+			if (!count_size)
+			{
+				face += ply_size(property.type);
+				continue;
+			}
+
+			double count = ply_read(face, property.count_type, swap);
+			face += count_size;
+
+			if (property.indices)
+			{
+				if (count < 3.0)
+				{
+					scan_error = "PLY parse error: face has fewer than 3 vertices.";
+					break;
+				}
+				triangle_total += (unsigned long long)count - 2ull;
+			}
+
+			if ((unsigned long long)(end - face) < (unsigned long long)count * ply_size(property.type))
+			{
+				scan_error = "PLY parse error: The file is shorter than the data declared on its header.";
+				break;
+			}
+			face += (unsigned long long)count * ply_size(property.type);
+		}
+	}
+
+	if (!scan_error && triangle_total >= 0xFFFFFFFFull)
+		scan_error = "PLY parse error: The mesh has too many triangles.";
+
+	if (scan_error)
+	{
+		delete[] chunk_starts;
+		delete[] chunk_triangles;
+		USER_ERROR(scan_error);
+	}
+
+	unsigned triangle_count = unsigned(triangle_total);
+
+	POLYHEDRON_DESC desc = {};
+	desc.texture_image = texture;
+	desc.vertex_list = new Vector3f[vertex_count];
+	desc.triangle_list = new Vector3i[triangle_count];
+	desc.triangle_count = triangle_count;
+
+	bool has_normals = types[NX] && types[NY] && types[NZ];
+	bool has_colors = types[RED] && types[GREEN] && types[BLUE];
+	bool has_uvs = types[U] && types[V];
+
+	if (has_normals)
+	{
+		desc.normal_computation = POLYHEDRON_DESC::PER_VERTEX_LIST_NORMALS;
+		desc.normal_vectors_list = new Vector3f[vertex_count];
+	}
+	else
+		desc.normal_computation = POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS;
+
+	// Per vertex attributes are expanded to the triangle corners once the faces are read.
+	Color* vertex_colors = nullptr;
+	Vector2f* vertex_uvs = nullptr;
+
+	if (texture && has_uvs)
+	{
+		desc.coloring = POLYHEDRON_DESC::TEXTURED_COLORING;
+		desc.texture_coordinates_list = new Vector2i[3u * triangle_count];
+		vertex_uvs = new Vector2f[vertex_count];
+	}
+	else if (has_colors)
+	{
+		desc.coloring = POLYHEDRON_DESC::PER_VERTEX_COLORING;
+		desc.color_list = new Color[3u * triangle_count];
+		vertex_colors = new Color[vertex_count];
+	}
+	else
+		desc.coloring = POLYHEDRON_DESC::GLOBAL_COLORING;
+
+	// Decode the vertices, with a fast path for the common little endian float coordinates.
+	const bool float_xyz = !swap && types[X] == PLY_FLOAT32 && types[Y] == PLY_FLOAT32 && types[Z] == PLY_FLOAT32;
+	const char* vertices = begin + vertex_offset;
+
+	ThreadPool::parallelFor(vertex_count, BINARY_MESH_CHUNK, [&](unsigned first, unsigned last, unsigned)
+	{
+		for (unsigned i = first; i < last; i++)
+		{
+			const char* vertex = vertices + (unsigned long long)i * stride;
+			Vector3f& p = desc.vertex_list[i];
+
+			if (float_xyz)
+			{
+				memcpy(&p.x, vertex + offsets[X], 4u);
+				memcpy(&p.y, vertex + offsets[Y], 4u);
+				memcpy(&p.z, vertex + offsets[Z], 4u);
+			}
+			else
+			{
+				p.x = float(ply_read(vertex + offsets[X], types[X], swap));
+				p.y = float(ply_read(vertex + offsets[Y], types[Y], swap));
+				p.z = float(ply_read(vertex + offsets[Z], types[Z], swap));
+			}
+
+			if (has_normals)
+			{
+				Vector3f& n = desc.normal_vectors_list[i];
+				n.x = float(ply_read(vertex + offsets[NX], types[NX], swap));
+				n.y = float(ply_read(vertex + offsets[NY], types[NY], swap));
+				n.z = float(ply_read(vertex + offsets[NZ], types[NZ], swap));
+			}
+
+			if (vertex_colors)
+			{
+				Color& c = vertex_colors[i];
+				c.R = ply_channel(ply_read(vertex + offsets[RED], types[RED], swap), types[RED]);
+				c.G = ply_channel(ply_read(vertex + offsets[GREEN], types[GREEN], swap), types[GREEN]);
+				c.B = ply_channel(ply_read(vertex + offsets[BLUE], types[BLUE], swap), types[BLUE]);
+				c.A = types[ALPHA] ? ply_channel(ply_read(vertex + offsets[ALPHA], types[ALPHA], swap), types[ALPHA]) : 255u;
+			}
+
+			if (vertex_uvs)
+			{
+				vertex_uvs[i].x = float(ply_read(vertex + offsets[U], types[U], swap));
+				vertex_uvs[i].y = float(ply_read(vertex + offsets[V], types[V], swap));
+			}
+		}
+	});
+
+	// Decode the faces of every chunk, fan triangulated, and expand the vertex attributes.
+	int W = texture ? (int)texture->width() : 0;
+	int H = texture ? (int)texture->height() : 0;
+
+	std::atomic<bool> out_of_range = false;
+	ThreadPool::parallelFor(n_chunks, 1u, [&](unsigned first, unsigned last, unsigned)
+	{
+		for (unsigned c = first; c < last; c++)
+		{
+			const char* face = begin + chunk_starts[c];
+			unsigned tri = chunk_triangles[c];
+			unsigned faces_end = (c + 1u) * BINARY_MESH_CHUNK < face_count ? (c + 1u) * BINARY_MESH_CHUNK : face_count;
+
+			for (unsigned f = c * BINARY_MESH_CHUNK; f < faces_end; f++)
+			{
+				for (const FaceProperty& property : face_properties)
+				{
+					if (property.count_type == PLY_INVALID)
+					{
+						face += ply_size(property.type);
+						continue;
+					}
+
+					unsigned count = unsigned(ply_read(face, property.count_type, swap));
+					face += ply_size(property.count_type);
+
+					if (property.indices)
+					{
+						unsigned item = ply_size(property.type);
+						bool int_indices = !swap && (property.type == PLY_INT32 || property.type == PLY_UINT32);
+
+						auto index = [&](unsigned k) -> int
+							{
+								if (int_indices)
+								{
+									int value;
+									memcpy(&value, face + 4u * k, 4u);
+									return value;
+								}
+								return int(ply_read(face + item * k, property.type, swap));
+							};
+
+						// Fan triangulation: (0, i, i+1)
+						int first_index = index(0u);
+						int previous = index(1u);
+						for (unsigned k = 2u; k < count; k++, tri++)
+						{
+							int current = index(k);
+							desc.triangle_list[tri] = Vector3i{ first_index, previous, current };
+
+							if (first_index < 0 || first_index >= (int)vertex_count ||
+								previous < 0 || previous >= (int)vertex_count ||
+								current < 0 || current >= (int)vertex_count)
+							{
+								out_of_range = true;
+								previous = current;
+								continue;
+							}
+
+							if (vertex_colors)
+							{
+								desc.color_list[3u * tri + 0u] = vertex_colors[first_index];
+								desc.color_list[3u * tri + 1u] = vertex_colors[previous];
+								desc.color_list[3u * tri + 2u] = vertex_colors[current];
+							}
+
+							// Common convention: flip V, same as the OBJ parser.
+							if (vertex_uvs)
+							{
+								int corners[3] = { first_index, previous, current };
+								for (unsigned j = 0u; j < 3u; j++)
+								{
+									const Vector2f& uv = vertex_uvs[corners[j]];
+									int px = (int)(uv.x * (float)(W - 1) + 0.5f);
+									int py = (int)((1.0f - uv.y) * (float)(H - 1) + 0.5f);
+
+									px = px < 0 ? 0 : px >= W ? W - 1 : px;
+									py = py < 0 ? 0 : py >= H ? H - 1 : py;
+									desc.texture_coordinates_list[3u * tri + j] = Vector2i{ px, py };
+								}
+							}
+
+							previous = current;
+						}
+					}
+
+					face += (unsigned long long)count * ply_size(property.type);
+				}
+			}
+		}
+	});
+
+	delete[] chunk_starts;
+	delete[] chunk_triangles;
+
+	if (vertex_colors)
+		delete[] vertex_colors;
+
+	if (vertex_uvs)
+		delete[] vertex_uvs;
+
+	if (out_of_range)
+	{
+		delete[] desc.vertex_list;
+		delete[] desc.triangle_list;
+		delete[] desc.normal_vectors_list;
+		delete[] desc.color_list;
+		delete[] desc.texture_coordinates_list;
+
+		USER_ERROR("PLY parse error: face vertex index out of range.");
+	}
+
+	return desc;
+}
+
+// Writes the descriptor triangles to a binary *.stl file. STL files only store positions, 
+// so every triangle is written with its three vertices and its normal.
+
+void Polyhedron::writeStlFile(const char* stl_file_path, const POLYHEDRON_DESC* pDesc)
+{
+	check_writable_desc(pDesc);
+
+	FILE* file = nullptr;
+	fopen_s(&file, stl_file_path, "wb");
+	USER_CHECK(file,
+		"STL write error: Unable to open the STL file for writing."
+	);
+
+	const POLYHEDRON_DESC& desc = *pDesc;
+
+	char header[STL_HEADER_SIZE] = "Binary STL file written by chaotic";
+	memcpy(header + STL_HEADER_SIZE - 4u, &desc.triangle_count, 4u);
+	bool success = fwrite(header, 1, STL_HEADER_SIZE, file) == STL_HEADER_SIZE;
+
+	// Triangles are encoded in parallel one chunk at a time.
+	char* buffer = new char[BINARY_MESH_CHUNK * STL_TRIANGLE_SIZE];
+
+	for (unsigned chunk = 0u; chunk < desc.triangle_count && success; chunk += BINARY_MESH_CHUNK)
+	{
+		unsigned count = desc.triangle_count - chunk < BINARY_MESH_CHUNK ? desc.triangle_count - chunk : BINARY_MESH_CHUNK;
+
+		ThreadPool::parallelFor(count, 4096u, [&](unsigned begin, unsigned end, unsigned)
+		{
+			for (unsigned i = begin; i < end; i++)
+			{
+				const Vector3i& triangle = desc.triangle_list[chunk + i];
+				Vector3f v[3] = { desc.vertex_list[triangle.x], desc.vertex_list[triangle.y], desc.vertex_list[triangle.z] };
+
+				// STL normals follow the right hand rule on the vertex order.
+				Vector3f normal = (v[2] - v[0]) * (v[1] - v[0]);
+				float length = normal.abs();
+				normal = length > 0.f ? normal / length : Vector3f();
+
+				char* record = buffer + i * STL_TRIANGLE_SIZE;
+				float values[12] = { normal.x, normal.y, normal.z, v[0].x, v[0].y, v[0].z, v[1].x, v[1].y, v[1].z, v[2].x, v[2].y, v[2].z };
+				memcpy(record, values, sizeof(values));
+				memset(record + sizeof(values), 0, 2u);
+			}
+		});
+
+		success = fwrite(buffer, STL_TRIANGLE_SIZE, count, file) == count;
+	}
+
+	delete[] buffer;
+
+	success = fclose(file) == 0 && success;
+	USER_CHECK(success,
+		"STL write error: Unable to write the STL file."
+	);
+}
+
+// Writes the descriptor to a binary little endian *.ply file. Vertex positions are always 
+// written, normals if they are per vertex and colors if they are per vertex. As PLY colors 
+// are per vertex, corners of the same vertex with different colors keep one of them.
+
+void Polyhedron::writePlyFile(const char* ply_file_path, const POLYHEDRON_DESC* pDesc)
+{
+	check_writable_desc(pDesc);
+
+	const POLYHEDRON_DESC& desc = *pDesc;
+	unsigned vertex_count = referenced_vertex_count(desc);
+
+	bool write_normals = desc.normal_computation == POLYHEDRON_DESC::PER_VERTEX_LIST_NORMALS && desc.normal_vectors_list;
+	bool write_colors = desc.coloring == POLYHEDRON_DESC::PER_VERTEX_COLORING && desc.color_list;
+
+	FILE* file = nullptr;
+	fopen_s(&file, ply_file_path, "wb");
+	USER_CHECK(file,
+		"PLY write error: Unable to open the PLY file for writing."
+	);
+
+	char header[512];
+	snprintf(header, sizeof(header),
+		"ply\nformat binary_little_endian 1.0\ncomment Written by chaotic\n"
+		"element vertex %u\nproperty float x\nproperty float y\nproperty float z\n%s%s"
+		"element face %u\nproperty list uchar int vertex_indices\nend_header\n",
+		vertex_count,
+		write_normals ? "property float nx\nproperty float ny\nproperty float nz\n" : "",
+		write_colors ? "property uchar red\nproperty uchar green\nproperty uchar blue\nproperty uchar alpha\n" : "",
+		desc.triangle_count
+	);
+
+	bool success = fwrite(header, 1, strlen(header), file) == strlen(header);
+
+	// Gather the colors of the corners into their vertices.
+	Color* vertex_colors = nullptr;
+	if (write_colors)
+	{
+		vertex_colors = new Color[vertex_count];
+		for (unsigned i = 0u; i < vertex_count; i++)
+			vertex_colors[i] = Color::White;
+
+		const int* indices = (const int*)desc.triangle_list;
+		for (unsigned i = 0u; i < 3u * desc.triangle_count; i++)
+			if (indices[i] >= 0)
+				vertex_colors[indices[i]] = desc.color_list[i];
+	}
+
+	// Vertices and faces are encoded in parallel one chunk at a time.
+	unsigned vertex_size = 12u + (write_normals ? 12u : 0u) + (write_colors ? 4u : 0u);
+	unsigned face_size = 13u;
+	char* buffer = new char[BINARY_MESH_CHUNK * (vertex_size > face_size ? vertex_size : face_size)];
+
+	for (unsigned chunk = 0u; chunk < vertex_count && success; chunk += BINARY_MESH_CHUNK)
+	{
+		unsigned count = vertex_count - chunk < BINARY_MESH_CHUNK ? vertex_count - chunk : BINARY_MESH_CHUNK;
+
+		ThreadPool::parallelFor(count, 4096u, [&](unsigned begin, unsigned end, unsigned)
+		{
+			for (unsigned i = begin; i < end; i++)
+			{
+				char* record = buffer + i * vertex_size;
+				memcpy(record, &desc.vertex_list[chunk + i].x, 4u);
+				memcpy(record + 4u, &desc.vertex_list[chunk + i].y, 4u);
+				memcpy(record + 8u, &desc.vertex_list[chunk + i].z, 4u);
+				record += 12u;
+
+				if (write_normals)
+				{
+					memcpy(record, &desc.normal_vectors_list[chunk + i].x, 4u);
+					memcpy(record + 4u, &desc.normal_vectors_list[chunk + i].y, 4u);
+					memcpy(record + 8u, &desc.normal_vectors_list[chunk + i].z, 4u);
+					record += 12u;
+				}
+
+				if (write_colors)
+				{
+					const Color& color = vertex_colors[chunk + i];
+					unsigned char rgba[4] = { color.R, color.G, color.B, color.A };
+					memcpy(record, rgba, 4u);
+				}
+			}
+		});
+
+		success = fwrite(buffer, vertex_size, count, file) == count;
+	}
+
+	for (unsigned chunk = 0u; chunk < desc.triangle_count && success; chunk += BINARY_MESH_CHUNK)
+	{
+		unsigned count = desc.triangle_count - chunk < BINARY_MESH_CHUNK ? desc.triangle_count - chunk : BINARY_MESH_CHUNK;
+
+		ThreadPool::parallelFor(count, 4096u, [&](unsigned begin, unsigned end, unsigned)
+		{
+			for (unsigned i = begin; i < end; i++)
+			{
+				char* record = buffer + i * face_size;
+				record[0] = 3;
+				memcpy(record + 1u, &desc.triangle_list[chunk + i], 12u);
+			}
+		});
+
+		success = fwrite(buffer, face_size, count, file) == count;
+	}
+
+	delete[] buffer;
+
+	if (vertex_colors)
+		delete[] vertex_colors;
+
+	success = fclose(file) == 0 && success;
+	USER_CHECK(success,
+		"PLY write error: Unable to write the PLY file."
+	);
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Vertex welding
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Number of elements processed per chunk by the welding passes.
+#define WELD_CHUNK 65536u
+
+// Empty slot marker of the weld cell table, cell keys always have the top bit cleared.
+#define WELD_EMPTY_SLOT 0xFFFFFFFFFFFFFFFFull
+
+// Returns the key of a weld cell, a hash of its integer coordinates with the top bit cleared.
+
+static inline unsigned long long weld_cell_key(long long x, long long y, long long z)
+{
+	unsigned long long h = (unsigned long long)x * 0x9E3779B97F4A7C15ull;
+	h ^= (unsigned long long)y * 0xC2B2AE3D27D4EB4Full;
+	h ^= (unsigned long long)z * 0x165667B19E3779F9ull;
+	h ^= h >> 31;
+	h *= 0x94D049BB133111EBull;
+	return (h ^ (h >> 29)) >> 1;
+}
+
+// Welds the vertices of the descriptor that are closer than the epsilon, or that have the
+// exact same position if it is zero, and outputs a compact descriptor with the vertices in
+// order of first appearance. Triangles that collapse are dropped, and vertices that no 
+// triangle references are removed. Useful to shrink meshes with duplicated positions, like
+// the ones loaded from files with per corner attributes or exported from Surfaces.
+// Vertices with per vertex normals are only welded if their normals are also equal.
+// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+
+POLYHEDRON_DESC Polyhedron::weldVertices(const POLYHEDRON_DESC* pDesc, float epsilon, POLYHEDRON_WELD_STATS* pStats)
+{
+	USER_CHECK(pDesc,
+		"Trying to weld the vertices of an invalid descriptor pointer."
+	);
+
+	const POLYHEDRON_DESC& desc = *pDesc;
+
+	USER_CHECK(desc.vertex_list && desc.triangle_list,
+		"Trying to weld the vertices of a descriptor without vertices or triangles."
+	);
+
+	USER_CHECK(epsilon >= 0.f,
+		"Trying to weld the vertices of a descriptor with a negative epsilon."
+	);
+
+	USER_CHECK(desc.coloring != POLYHEDRON_DESC::PER_VERTEX_COLORING || desc.color_list,
+		"Found nullptr when trying to access a color list to weld the vertices of a descriptor."
+	);
+
+	USER_CHECK(desc.coloring != POLYHEDRON_DESC::TEXTURED_COLORING || desc.texture_coordinates_list,
+		"Found nullptr when trying to access a texture coordinate list to weld the vertices of a descriptor."
+	);
+
+	const bool vertex_normals = desc.normal_computation == POLYHEDRON_DESC::PER_VERTEX_LIST_NORMALS;
+	const bool corner_normals = desc.normal_computation == POLYHEDRON_DESC::PER_TRIANGLE_LIST_NORMALS;
+
+	USER_CHECK(!(vertex_normals || corner_normals) || desc.normal_vectors_list,
+		"Found nullptr when trying to access a normal vector list to weld the vertices of a descriptor."
+	);
+
+	const unsigned vertex_count = referenced_vertex_count(desc);
+	const unsigned triangle_count = desc.triangle_count;
+	const Vector3f* positions = desc.vertex_list;
+
+	const double inv_cell = epsilon > 0.f ? 1.0 / epsilon : 0.0;
+	const float epsilon2 = epsilon * epsilon;
+
+	// With an epsilon every vertex closer than it lies in a neighbour cell of the grid,
+	// with no epsilon the cell is the position itself.
+	auto cell_of = [&](const Vector3f& p, long long* cell)
+	{
+		cell[0] = (long long)floor(p.x * inv_cell);
+		cell[1] = (long long)floor(p.y * inv_cell);
+		cell[2] = (long long)floor(p.z * inv_cell);
+	};
+
+	auto key_of = [&](const Vector3f& p) -> unsigned long long
+	{
+		if (!(epsilon > 0.f))
+			return position_hash(p) >> 1;
+
+		long long cell[3];
+		cell_of(p, cell);
+		return weld_cell_key(cell[0], cell[1], cell[2]);
+	};
+
+	// Whether two vertices can be welded together.
+	auto weldable = [&](unsigned a, unsigned b) -> bool
+	{
+		const Vector3f& p = positions[a];
+		const Vector3f& q = positions[b];
+
+		if (epsilon > 0.f)
+		{
+			Vector3f d = p - q;
+			if ((d ^ d) > epsilon2)
+				return false;
+		}
+		else if (p.x != q.x || p.y != q.y || p.z != q.z)
+			return false;
+
+		if (vertex_normals)
+		{
+			const Vector3f& n = desc.normal_vectors_list[a];
+			const Vector3f& m = desc.normal_vectors_list[b];
+			if (n.x != m.x || n.y != m.y || n.z != m.z)
+				return false;
+		}
+		return true;
+	};
+
+	// Sort the vertices by cell, the sort is stable so every cell run is in index order.
+	unsigned long long* keys = new unsigned long long[vertex_count];
+	unsigned* order = new unsigned[vertex_count];
+
+	ThreadPool::parallelFor(vertex_count, WELD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned v = begin; v < end; v++)
+		{
+			keys[v] = key_of(positions[v]);
+			order[v] = v;
+		}
+	});
+
+	ThreadPool::radixSort(keys, order, vertex_count, 63u);
+
+	// Open addressing table from every cell key to the start of its run.
+	unsigned table_size = 1u;
+	while (table_size < 2u * vertex_count)
+		table_size <<= 1;
+
+	std::atomic<unsigned long long>* table_keys = new std::atomic<unsigned long long>[table_size];
+	unsigned* table_runs = new unsigned[table_size];
+
+	ThreadPool::parallelFor(table_size, WELD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = begin; i < end; i++)
+			table_keys[i].store(WELD_EMPTY_SLOT, std::memory_order_relaxed);
+	});
+
+	ThreadPool::parallelFor(vertex_count, WELD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = begin; i < end; i++)
+		{
+			if (i && keys[i] == keys[i - 1u])
+				continue;
+
+			unsigned slot = unsigned(keys[i]) & (table_size - 1u);
+			unsigned long long expected = WELD_EMPTY_SLOT;
+			while (!table_keys[slot].compare_exchange_strong(expected, keys[i], std::memory_order_relaxed))
+			{
+				slot = (slot + 1u) & (table_size - 1u);
+				expected = WELD_EMPTY_SLOT;
+			}
+			table_runs[slot] = i;
+		}
+	});
+
+	// Every vertex finds the lowest index vertex of the cells around it that it can be welded 
+	// with. Runs are in index order, so the scan stops as soon as it reaches higher indices.
+	unsigned* representative = new unsigned[vertex_count];
+
+	ThreadPool::parallelFor(vertex_count, WELD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		auto scan_cell = [&](unsigned long long key, unsigned v, unsigned& best)
+		{
+			unsigned slot = unsigned(key) & (table_size - 1u);
+			unsigned long long stored;
+			while ((stored = table_keys[slot].load(std::memory_order_relaxed)) != key)
+			{
+				if (stored == WELD_EMPTY_SLOT)
+					return;
+				slot = (slot + 1u) & (table_size - 1u);
+			}
+
+			for (unsigned i = table_runs[slot]; i < vertex_count && keys[i] == key && order[i] < best; i++)
+				if (weldable(order[i], v))
+					best = order[i];
+		};
+
+		for (unsigned v = begin; v < end; v++)
+		{
+			unsigned best = v;
+
+			if (epsilon > 0.f)
+			{
+				long long cell[3];
+				cell_of(positions[v], cell);
+
+				for (long long dx = -1; dx <= 1; dx++)
+					for (long long dy = -1; dy <= 1; dy++)
+						for (long long dz = -1; dz <= 1; dz++)
+							scan_cell(weld_cell_key(cell[0] + dx, cell[1] + dy, cell[2] + dz), v, best);
+			}
+			else
+				scan_cell(key_of(positions[v]), v, best);
+
+			representative[v] = best;
+		}
+	});
+
+	delete[] keys;
+	delete[] order;
+	delete[] table_keys;
+	delete[] table_runs;
+
+	// Resolve the representatives in index order. A vertex joins the representative of its
+	// lowest neighbour only if it can be welded with it too, so clusters never chain further.
+	for (unsigned v = 0u; v < vertex_count; v++)
+	{
+		unsigned rep = representative[representative[v]];
+		representative[v] = weldable(rep, v) ? rep : v;
+	}
+
+	// Remap the triangles and drop the ones that collapse into a line or a point.
+	unsigned n_chunks = (triangle_count + WELD_CHUNK - 1u) / WELD_CHUNK;
+	unsigned* chunk_offsets = new unsigned[n_chunks + 1u];
+	bool* keep = new bool[triangle_count];
+
+	ThreadPool::parallelFor(triangle_count, WELD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		unsigned n = 0u;
+		for (unsigned t = begin; t < end; t++)
+		{
+			unsigned a = representative[desc.triangle_list[t].x];
+			unsigned b = representative[desc.triangle_list[t].y];
+			unsigned c = representative[desc.triangle_list[t].z];
+
+			keep[t] = a != b && b != c && c != a && bool((positions[b] - positions[a]) * (positions[c] - positions[a]));
+			n += keep[t];
+		}
+		chunk_offsets[begin / WELD_CHUNK] = n;
+	});
+
+	unsigned out_triangles = 0u;
+	for (unsigned c = 0u; c < n_chunks; c++)
+	{
+		unsigned n = chunk_offsets[c];
+		chunk_offsets[c] = out_triangles;
+		out_triangles += n;
+	}
+
+	POLYHEDRON_DESC weld = desc;
+	weld.triangle_count = out_triangles;
+	weld.triangle_list = new Vector3i[out_triangles];
+	weld.color_list = desc.coloring == POLYHEDRON_DESC::PER_VERTEX_COLORING ? new Color[3u * out_triangles] : nullptr;
+	weld.texture_coordinates_list = desc.coloring == POLYHEDRON_DESC::TEXTURED_COLORING ? new Vector2i[3u * out_triangles] : nullptr;
+	weld.normal_vectors_list = corner_normals ? new Vector3f[3u * out_triangles] : nullptr;
+
+	// The output corners store the representatives, along with every corner attribute. The
+	// first corner that uses every representative is found with an atomic minimum.
+	std::atomic<unsigned>* first_corner = new std::atomic<unsigned>[vertex_count];
+
+	ThreadPool::parallelFor(vertex_count, WELD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned v = begin; v < end; v++)
+			first_corner[v].store(UINT_MAX, std::memory_order_relaxed);
+	});
+
+	ThreadPool::parallelFor(triangle_count, WELD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		unsigned out = chunk_offsets[begin / WELD_CHUNK];
+		for (unsigned t = begin; t < end; t++)
+		{
+			if (!keep[t])
+				continue;
+
+			const int* corners = (const int*)&desc.triangle_list[t];
+			int* out_corners = (int*)&weld.triangle_list[out];
+
+			for (unsigned k = 0u; k < 3u; k++)
+			{
+				unsigned rep = representative[corners[k]];
+				out_corners[k] = int(rep);
+
+				unsigned corner = 3u * out + k;
+				unsigned current = first_corner[rep].load(std::memory_order_relaxed);
+				while (corner < current && !first_corner[rep].compare_exchange_weak(current, corner, std::memory_order_relaxed));
+
+				if (weld.color_list)
+					weld.color_list[corner] = desc.color_list[3u * t + k];
+
+				if (weld.texture_coordinates_list)
+					weld.texture_coordinates_list[corner] = desc.texture_coordinates_list[3u * t + k];
+
+				if (weld.normal_vectors_list)
+					weld.normal_vectors_list[corner] = desc.normal_vectors_list[3u * t + k];
+			}
+			out++;
+		}
+	});
+
+	delete[] keep;
+	delete[] chunk_offsets;
+
+	// Number the representatives in order of first appearance, reusing the representative
+	// array for the new indices, and finally remap the output triangles.
+	const unsigned out_corners = 3u * out_triangles;
+	const int* rep_corners = (const int*)weld.triangle_list;
+
+	n_chunks = (out_corners + WELD_CHUNK - 1u) / WELD_CHUNK;
+	chunk_offsets = new unsigned[n_chunks + 1u];
+
+	ThreadPool::parallelFor(out_corners, WELD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		unsigned n = 0u;
+		for (unsigned c = begin; c < end; c++)
+			n += first_corner[rep_corners[c]].load(std::memory_order_relaxed) == c;
+		chunk_offsets[begin / WELD_CHUNK] = n;
+	});
+
+	unsigned out_vertices = 0u;
+	for (unsigned c = 0u; c < n_chunks; c++)
+	{
+		unsigned n = chunk_offsets[c];
+		chunk_offsets[c] = out_vertices;
+		out_vertices += n;
+	}
+
+	weld.vertex_list = new Vector3f[out_vertices];
+	if (vertex_normals)
+		weld.normal_vectors_list = new Vector3f[out_vertices];
+
+	ThreadPool::parallelFor(out_corners, WELD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		unsigned index = chunk_offsets[begin / WELD_CHUNK];
+		for (unsigned c = begin; c < end; c++)
+		{
+			unsigned rep = rep_corners[c];
+			if (first_corner[rep].load(std::memory_order_relaxed) != c)
+				continue;
+
+			weld.vertex_list[index] = positions[rep];
+			if (vertex_normals)
+				weld.normal_vectors_list[index] = desc.normal_vectors_list[rep];
+
+			representative[rep] = index++;
+		}
+	});
+
+	ThreadPool::parallelFor(out_corners, WELD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned c = begin; c < end; c++)
+			((int*)weld.triangle_list)[c] = int(representative[rep_corners[c]]);
+	});
+
+	delete[] first_corner;
+	delete[] chunk_offsets;
+	delete[] representative;
+
+	if (pStats)
+	{
+		pStats->input_vertex_count = distinct_vertex_count(desc, vertex_count);
+		pStats->output_vertex_count = out_vertices;
+		pStats->input_triangle_count = triangle_count;
+		pStats->output_triangle_count = out_triangles;
+		pStats->degenerate_triangle_count = triangle_count - out_triangles;
+	}
+	return weld;
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Triangle order optimization
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Simulates the post transform vertex cache of the size specified over the triangles of
+// the descriptor, as if they were drawn by index, and returns the cache statistics.
+
+POLYHEDRON_CACHE_STATS Polyhedron::analyzeVertexCache(const POLYHEDRON_DESC* pDesc, unsigned cache_size)
+{
+	USER_CHECK(pDesc && pDesc->triangle_list,
+		"Trying to analyze the vertex cache of an invalid descriptor."
+	);
+
+	USER_CHECK(cache_size,
+		"Trying to analyze the vertex cache with a cache size of zero."
+	);
+
+	MeshOptimizer::CacheStats cache = MeshOptimizer::analyzeVertexCache((const unsigned*)pDesc->triangle_list, pDesc->triangle_count, referenced_vertex_count(*pDesc), cache_size);
+
+	POLYHEDRON_CACHE_STATS stats;
+	stats.referenced_vertex_count = cache.referenced_vertices;
+	stats.transformed_vertex_count = cache.transformed_vertices;
+	stats.acmr = cache.acmr;
+	stats.atvr = cache.atvr;
+	return stats;
+}
+
+// Reorders the triangles of the descriptor in place for the vertex cache and, optionally,
+// to reduce overdraw. Per corner colors, texture coordinates and normals are reordered 
+// along, so the result draws the same.
+
+void Polyhedron::optimizeTriangleOrder(POLYHEDRON_DESC* pDesc, bool optimize_overdraw)
+{
+	USER_CHECK(pDesc && pDesc->triangle_list && pDesc->vertex_list,
+		"Trying to optimize the triangle order of an invalid descriptor."
+	);
+
+	POLYHEDRON_DESC& desc = *pDesc;
+	const unsigned triangle_count = desc.triangle_count;
+
+	unsigned* triangle_order = new unsigned[triangle_count];
+	MeshOptimizer::optimizeTriangleOrder((unsigned*)desc.triangle_list, triangle_count, referenced_vertex_count(desc), optimize_overdraw ? desc.vertex_list : nullptr, triangle_order);
+
+	// Reorders a per corner list along with the triangles.
+	auto reorder_corners = [&](auto* list)
+	{
+		using T = std::remove_pointer_t<decltype(list)>;
+		T* reordered = new T[3u * triangle_count];
+
+		ThreadPool::parallelFor(triangle_count, WELD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+		{
+			for (unsigned t = begin; t < end; t++)
+				for (unsigned k = 0u; k < 3u; k++)
+					reordered[3u * t + k] = list[3u * triangle_order[t] + k];
+		});
+
+		memcpy(list, reordered, 3u * triangle_count * sizeof(T));
+		delete[] reordered;
+	};
+
+	if (desc.coloring == POLYHEDRON_DESC::PER_VERTEX_COLORING && desc.color_list)
+		reorder_corners(desc.color_list);
+
+	if (desc.coloring == POLYHEDRON_DESC::TEXTURED_COLORING && desc.texture_coordinates_list)
+		reorder_corners(desc.texture_coordinates_list);
+
+	if (desc.normal_computation == POLYHEDRON_DESC::PER_TRIANGLE_LIST_NORMALS && desc.normal_vectors_list)
+		reorder_corners(desc.normal_vectors_list);
+
+	delete[] triangle_order;
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Mesh simplification
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Mixes a corner attribute into the running id of the corner.
+
+static inline unsigned long long attribute_mix(unsigned long long h, unsigned long long value)
+{
+	h ^= value + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+	h ^= h >> 31;
+	h *= 0x94D049BB133111EBull;
+	return h ^ (h >> 29);
+}
+
+// Simplifies the descriptor with quadric error metrics, collapsing vertices onto their
+// neighbours until the triangle count is at most the target, or until the next collapse
+// would move the surface further than the target error, given as a fraction of the mesh
+// size. The target count is not reached if the error limit is hit first, the stats report
+// the triangles left, and a target error of zero sets no limit. Borders keep their outline,
+// and vertices where colors, texture coordinates or per triangle normals differ between
+// corners are kept, so seams and UVs are preserved.
+// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+
+POLYHEDRON_DESC Polyhedron::simplify(const POLYHEDRON_DESC* pDesc, unsigned target_triangle_count, float target_error, POLYHEDRON_SIMPLIFY_STATS* pStats)
+{
+	USER_CHECK(pDesc,
+		"Trying to simplify an invalid descriptor pointer."
+	);
+
+	const POLYHEDRON_DESC& desc = *pDesc;
+
+	USER_CHECK(desc.vertex_list && desc.triangle_list,
+		"Trying to simplify a descriptor without vertices or triangles."
+	);
+
+	USER_CHECK(target_error >= 0.f,
+		"Trying to simplify a descriptor with a negative target error."
+	);
+
+	const bool corner_colors = desc.coloring == POLYHEDRON_DESC::PER_VERTEX_COLORING;
+	const bool corner_coordinates = desc.coloring == POLYHEDRON_DESC::TEXTURED_COLORING;
+	const bool vertex_normals = desc.normal_computation == POLYHEDRON_DESC::PER_VERTEX_LIST_NORMALS;
+	const bool corner_normals = desc.normal_computation == POLYHEDRON_DESC::PER_TRIANGLE_LIST_NORMALS;
+
+	USER_CHECK(!corner_colors || desc.color_list,
+		"Found nullptr when trying to access a color list to simplify a descriptor."
+	);
+
+	USER_CHECK(!corner_coordinates || desc.texture_coordinates_list,
+		"Found nullptr when trying to access a texture coordinate list to simplify a descriptor."
+	);
+
+	USER_CHECK(!(vertex_normals || corner_normals) || desc.normal_vectors_list,
+		"Found nullptr when trying to access a normal vector list to simplify a descriptor."
+	);
+
+	const unsigned vertex_count = referenced_vertex_count(desc);
+	const unsigned triangle_count = desc.triangle_count;
+
+	// Every corner gets an id of its attributes, so the simplifier can find the seams.
+	unsigned long long* attributes = nullptr;
+	if (corner_colors || corner_coordinates || corner_normals)
+	{
+		attributes = new unsigned long long[3u * triangle_count];
+
+		ThreadPool::parallelFor(3u * triangle_count, WELD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+		{
+			for (unsigned c = begin; c < end; c++)
+			{
+				unsigned long long h = 0ull;
+
+				if (corner_colors)
+				{
+					unsigned bits;
+					memcpy(&bits, &desc.color_list[c], sizeof(unsigned));
+					h = attribute_mix(h, bits);
+				}
+				if (corner_coordinates)
+				{
+					const Vector2i& uv = desc.texture_coordinates_list[c];
+					h = attribute_mix(h, ((unsigned long long)(unsigned)uv.x << 32) | (unsigned)uv.y);
+				}
+				if (corner_normals)
+					h = attribute_mix(h, position_hash(desc.normal_vectors_list[c]));
+
+				attributes[c] = h;
+			}
+		});
+	}
+
+	unsigned* indices = new unsigned[3u * triangle_count];
+	unsigned* sources = new unsigned[3u * triangle_count];
+
+	float result_error = 0.f;
+	const unsigned out_triangles = MeshSimplifier::simplify((const unsigned*)desc.triangle_list, triangle_count, desc.vertex_list, vertex_count,
+		attributes, target_triangle_count, target_error, indices, sources, &result_error);
+
+	if (attributes)
+		delete[] attributes;
+
+	// Number the remaining vertices in order of first appearance.
+	unsigned* remap = new unsigned[vertex_count];
+	for (unsigned v = 0u; v < vertex_count; v++)
+		remap[v] = UINT_MAX;
+
+	unsigned out_vertices = 0u;
+	for (unsigned c = 0u; c < 3u * out_triangles; c++)
+		if (remap[indices[c]] == UINT_MAX)
+			remap[indices[c]] = out_vertices++;
+
+	POLYHEDRON_DESC simple = desc;
+	simple.triangle_count = out_triangles;
+	simple.vertex_list = new Vector3f[out_vertices];
+	simple.triangle_list = new Vector3i[out_triangles];
+	simple.color_list = corner_colors ? new Color[3u * out_triangles] : nullptr;
+	simple.texture_coordinates_list = corner_coordinates ? new Vector2i[3u * out_triangles] : nullptr;
+	simple.normal_vectors_list =
+		vertex_normals ? new Vector3f[out_vertices] : 
+		corner_normals ? new Vector3f[3u * out_triangles] : nullptr;
+
+	for (unsigned v = 0u; v < vertex_count; v++)
+	{
+		if (remap[v] == UINT_MAX)
+			continue;
+
+		simple.vertex_list[remap[v]] = desc.vertex_list[v];
+		if (vertex_normals)
+			simple.normal_vectors_list[remap[v]] = desc.normal_vectors_list[v];
+	}
+
+	ThreadPool::parallelFor(3u * out_triangles, WELD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned c = begin; c < end; c++)
+		{
+			((int*)simple.triangle_list)[c] = int(remap[indices[c]]);
+
+			if (corner_colors)
+				simple.color_list[c] = desc.color_list[sources[c]];
+
+			if (corner_coordinates)
+				simple.texture_coordinates_list[c] = desc.texture_coordinates_list[sources[c]];
+
+			if (corner_normals)
+				simple.normal_vectors_list[c] = desc.normal_vectors_list[sources[c]];
+		}
+	});
+
+	delete[] remap;
+	delete[] indices;
+	delete[] sources;
+
+	if (pStats)
+	{
+		pStats->input_vertex_count = distinct_vertex_count(desc, vertex_count);
+		pStats->output_vertex_count = out_vertices;
+		pStats->input_triangle_count = triangle_count;
+		pStats->output_triangle_count = out_triangles;
+		pStats->result_error = result_error;
+	}
+	return simple;
+}
+
+// Builds a chain of levels of detail of the descriptor, every level is simplified from the
+// previous one to the reduction specified of its triangles, within the target error.
+// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+
+void Polyhedron::simplifyLODChain(const POLYHEDRON_DESC* pDesc, POLYHEDRON_DESC* lod_list, unsigned lod_count, float reduction, float target_error)
+{
+	USER_CHECK(pDesc && lod_list,
+		"Trying to build a level of detail chain with an invalid descriptor or list pointer."
+	);
+
+	USER_CHECK(reduction > 0.f && reduction < 1.f,
+		"Trying to build a level of detail chain with a reduction outside of the (0,1) range."
+	);
+
+	const POLYHEDRON_DESC* previous = pDesc;
+	for (unsigned l = 0u; l < lod_count; l++)
+	{
+		const unsigned target = unsigned(float(previous->triangle_count) * reduction);
+
+		lod_list[l] = simplify(previous, target, target_error);
+		previous = &lod_list[l];
+	}
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Vertex adjacency helpers
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Number of elements processed per chunk by the adjacency and update passes.
+#define ADJACENCY_CHUNK 16384u
+
+// Builds the vertex to corner adjacency of the triangle list in compressed rows, the corners
+// of vertex v are stored from offsets[v] to offsets[v + 1]. Corners are sorted by vertex with
+// the parallel radix sort, which is stable, so every row is in increasing corner order.
+
+static void build_vertex_adjacency(const Vector3i* triangle_list, unsigned triangle_count, unsigned vertex_count, unsigned** offsets, unsigned** corners)
+{
+	const unsigned corner_count = 3u * triangle_count;
+	const int* indices = (const int*)triangle_list;
+
+	unsigned long long* keys = new unsigned long long[corner_count];
+	unsigned* row_offsets = new unsigned[vertex_count + 1u];
+	unsigned* row_corners = new unsigned[corner_count];
+
+	ThreadPool::parallelFor(corner_count, ADJACENCY_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned c = begin; c < end; c++)
+		{
+			keys[c] = (unsigned)indices[c];
+			row_corners[c] = c;
+		}
+	});
+
+	unsigned key_bits = 1u;
+	while (key_bits < 32u && (vertex_count - 1u) >> key_bits)
+		key_bits++;
+
+	ThreadPool::radixSort(keys, row_corners, corner_count, key_bits);
+
+	// Every sorted corner fills the offsets of the vertices between the previous key and its own.
+	ThreadPool::parallelFor(corner_count + 1u, ADJACENCY_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = begin; i < end; i++)
+		{
+			unsigned low = i ? unsigned(keys[i - 1u]) + 1u : 0u;
+			unsigned high = i < corner_count ? unsigned(keys[i]) : vertex_count;
+
+			for (unsigned v = low; v <= high; v++)
+				row_offsets[v] = i;
+		}
+	});
+
+	delete[] keys;
+
+	*offsets = row_offsets;
+	*corners = row_corners;
+}
+
+// Marks the vertex buffer elements specified as dirty. They are sorted first, so that runs
+// of consecutive elements are marked with a single range.
+
+static void mark_dirty_elements(VertexBuffer* pVB, std::vector<unsigned>& dirty)
+{
+	std::sort(dirty.begin(), dirty.end());
+	dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+	for (size_t i = 0u; i < dirty.size();)
+	{
+		size_t j = i + 1u;
+		while (j < dirty.size() && dirty[j] == dirty[j - 1u] + 1u)
+			j++;
+
+		pVB->markDirtyRange(dirty[i], unsigned(j - i));
+		i = j;
+	}
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Smooth normal helpers
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Number of elements processed per chunk by the smooth normal passes.
+#define SMOOTH_NORMALS_CHUNK 16384u
+
+// Computes the weighted normal contribution of the three corners of a triangle. Area weighted
+// contributions are the plain cross product, whose length is twice the triangle area, angle
+// weighted ones are the unit triangle normal scaled by the angle of each corner.
+
+static inline void smooth_corner_weights(const Vector3f& v0, const Vector3f& v1, const Vector3f& v2, bool angle_weighted, Vector3f* weights)
+{
+	Vector3f normal = (v1 - v0) * (v2 - v0);
+
+	if (!angle_weighted)
+	{
+		weights[0] = weights[1] = weights[2] = normal;
+		return;
+	}
+
+	float length = normal.abs();
+	if (!length)
+	{
+		weights[0] = weights[1] = weights[2] = Vector3f();
+		return;
+	}
+	normal = normal / length;
+
+	const Vector3f* p[3] = { &v0, &v1, &v2 };
+	for (unsigned k = 0u; k < 3u; k++)
+	{
+		Vector3f e1 = *p[(k + 1u) % 3u] - *p[k];
+		Vector3f e2 = *p[(k + 2u) % 3u] - *p[k];
+
+		float cosine = (e1 ^ e2) / (e1.abs() * e2.abs());
+		cosine = cosine < -1.f ? -1.f : cosine > 1.f ? 1.f : cosine;
+
+		weights[k] = normal * acosf(cosine);
+	}
+}
+
+// Computes the corner weights of the triangles specified, or of all of them if the subset is
+// nullptr, reading the positions from the vertex list. Every triangle only writes its corners.
+
+static void compute_corner_weights(PolyhedronInternals& data, const Vector3f* vertex_list, const unsigned* triangle_subset, unsigned count)
+{
+	ThreadPool::parallelFor(count, SMOOTH_NORMALS_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = begin; i < end; i++)
+		{
+			unsigned t = triangle_subset ? triangle_subset[i] : i;
+			const Vector3i& triangle = data.desc.triangle_list[t];
+
+			smooth_corner_weights(vertex_list[triangle.x], vertex_list[triangle.y], vertex_list[triangle.z], data.desc.angle_weighted_normals, data.corner_weights + 3u * t);
+		}
+	});
+}
+
+// Sums the corner weights around the vertices specified, or around all of them if the subset
+// is nullptr, and writes the normalized result to the vertex data. Every vertex gathers its own
+// corners instead of the triangles scattering to their vertices, so no atomics are needed and
+// the result does not depend on the number of threads.
+
+template<typename V>
+static void store_smooth_normals(V* vertices, const PolyhedronInternals& data, const unsigned* vertex_subset, unsigned count)
+{
+	ThreadPool::parallelFor(count, SMOOTH_NORMALS_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = begin; i < end; i++)
+		{
+			unsigned v = vertex_subset ? vertex_subset[i] : i;
+			const unsigned row_begin = data.adjacency_offsets[v];
+			const unsigned row_end = data.adjacency_offsets[v + 1u];
+
+			Vector3f normal = {};
+			for (unsigned k = row_begin; k < row_end; k++)
+				normal += data.corner_weights[data.adjacency_corners[k]];
+
+			if (normal)
+				normal.normalize();
+
+			if (data.indexed)
+				vertices[v].norm = normal.getVector4();
+			else for (unsigned k = row_begin; k < row_end; k++)
+				vertices[data.adjacency_corners[k]].norm = normal.getVector4();
+		}
+	});
+}
+
+// Computes the smooth normals of the freshly filled vertex data from the descriptor. If updates
+// are enabled the adjacency and the weights are kept, so that later updates only recompute the
+// neighbourhood of the modified vertices.
+
+template<typename V>
+static void initialize_smooth_normals(V* vertices, PolyhedronInternals& data)
+{
+	build_vertex_adjacency(data.desc.triangle_list, data.desc.triangle_count, data.vertex_count, &data.adjacency_offsets, &data.adjacency_corners);
+
+	data.corner_weights = new Vector3f[3u * data.desc.triangle_count];
+	compute_corner_weights(data, data.desc.vertex_list, nullptr, data.desc.triangle_count);
+	store_smooth_normals(vertices, data, nullptr, data.vertex_count);
+
+	if (data.desc.enable_updates)
+	{
+		data.smooth_positions = new Vector3f[data.vertex_count];
+		for (unsigned v = 0u; v < data.vertex_count; v++)
+			data.smooth_positions[v] = data.desc.vertex_list[v];
+
+		data.visited_triangles = new bool[data.desc.triangle_count]();
+		data.visited_vertices = new bool[data.vertex_count]();
+		return;
+	}
+
+	delete[] data.adjacency_offsets;
+	delete[] data.adjacency_corners;
+	delete[] data.corner_weights;
+
+	data.adjacency_offsets = nullptr;
+	data.adjacency_corners = nullptr;
+	data.corner_weights = nullptr;
+}
+
+// Helper for updateVertices() when normals are computed smooth. Moving a vertex changes the
+// weights of the triangles around it, and with them the normals of every vertex of those 
+// triangles. Only that neighbourhood is recomputed and marked as dirty, while large updates
+// simply recompute the whole mesh in parallel. If a dirty vertex list is provided the count
+// vertices listed are updated, reading their positions from the full vertex list, otherwise
+// the range starting at the first vertex is updated from a list as long as the count.
+
+template<typename V>
+static void update_smooth_range(V* vertices, PolyhedronInternals& data, const Vector3f* vertex_list, unsigned first, unsigned count, const unsigned* dirty_vertices)
+{
+	// Store the new positions on the copy and on every corner of the vertex data.
+	ThreadPool::parallelFor(count, ADJACENCY_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = begin; i < end; i++)
+		{
+			unsigned v = dirty_vertices ? dirty_vertices[i] : first + i;
+			const Vector3f& position = dirty_vertices ? vertex_list[v] : vertex_list[i];
+			data.smooth_positions[v] = position;
+
+			if (data.indexed)
+				vertices[v].vector = position.getVector4();
+			else for (unsigned k = data.adjacency_offsets[v]; k < data.adjacency_offsets[v + 1u]; k++)
+				vertices[data.adjacency_corners[k]].vector = position.getVector4();
+		}
+	});
+
+	if (4u * count >= data.vertex_count)
+	{
+		compute_corner_weights(data, data.smooth_positions, nullptr, data.desc.triangle_count);
+		store_smooth_normals(vertices, data, nullptr, data.vertex_count);
+
+		data.pUpdateVB->markDirtyRange(0u, data.indexed ? data.vertex_count : 3u * data.desc.triangle_count);
+		return;
+	}
+
+	// Gather the triangles around the updated vertices and every vertex of those triangles.
+	std::vector<unsigned> triangles;
+	std::vector<unsigned> ring;
+
+	for (unsigned i = 0u; i < count; i++)
+	{
+		unsigned v = dirty_vertices ? dirty_vertices[i] : first + i;
+		for (unsigned k = data.adjacency_offsets[v]; k < data.adjacency_offsets[v + 1u]; k++)
+		{
+			unsigned t = data.adjacency_corners[k] / 3u;
+			if (data.visited_triangles[t])
+				continue;
+
+			data.visited_triangles[t] = true;
+			triangles.push_back(t);
+
+			const int* corners = (const int*)&data.desc.triangle_list[t];
+			for (unsigned c = 0u; c < 3u; c++)
+			{
+				if (data.visited_vertices[corners[c]])
+					continue;
+
+				data.visited_vertices[corners[c]] = true;
+				ring.push_back(corners[c]);
+			}
+		}
+	}
+
+	compute_corner_weights(data, data.smooth_positions, triangles.data(), unsigned(triangles.size()));
+	store_smooth_normals(vertices, data, ring.data(), unsigned(ring.size()));
+
+	// Mark the modified elements as dirty, vertices without triangles only moved themselves.
+	std::vector<unsigned> dirty;
+	if (data.indexed)
+	{
+		dirty = ring;
+		for (unsigned i = 0u; i < count; i++)
+			dirty.push_back(dirty_vertices ? dirty_vertices[i] : first + i);
+	}
+	else for (unsigned u : ring)
+		for (unsigned k = data.adjacency_offsets[u]; k < data.adjacency_offsets[u + 1u]; k++)
+			dirty.push_back(data.adjacency_corners[k]);
+
+	mark_dirty_elements(data.pUpdateVB, dirty);
+
+	// Clear the visited flags for the next update.
+	for (unsigned t : triangles)
+		data.visited_triangles[t] = false;
+
+	for (unsigned u : ring)
+		data.visited_vertices[u] = false;
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Range update helpers
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Recomputes the normal of a triangle from the positions stored on its three corners.
+
+template<typename V>
+static inline void store_triangle_normal(V* vertices, unsigned t)
+{
+	Vector3f v0 = Vector3f(vertices[3 * t + 0].vector);
+	Vector3f v1 = Vector3f(vertices[3 * t + 1].vector);
+	Vector3f v2 = Vector3f(vertices[3 * t + 2].vector);
+
+	Vector3f norm = ((v1 - v0) * (v2 - v0)).normalize();
+
+	vertices[3 * t + 0].norm = norm.getVector4();
+	vertices[3 * t + 1].norm = norm.getVector4();
+	vertices[3 * t + 2].norm = norm.getVector4();
+}
+
+// Helper for the partial versions of updateVertices() on non indexed polyhedrons, the vertex 
+// type is templated since all vertex formats start with the position and normal. Walks the 
+// vertex to corner adjacency to rewrite only the corners of the updated vertices, recomputes
+// the normals of their triangles if they are computed, and marks every modified element as 
+// dirty on the vertex buffer, so only those spans are uploaded. Updated vertices are read as
+// in update_smooth_range(), from a dirty vertex list or from a range.
+
+template<typename V>
+static void update_vertex_range(V* vertices, PolyhedronInternals& data, const Vector3f* vertex_list, unsigned first, unsigned count, const unsigned* dirty_vertices)
+{
+	const bool compute_normals = data.desc.enable_illuminated && data.desc.normal_computation == POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS;
+
+	// Every corner belongs to a single vertex, so the corners can be written in parallel.
+	ThreadPool::parallelFor(count, ADJACENCY_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = begin; i < end; i++)
+		{
+			unsigned v = dirty_vertices ? dirty_vertices[i] : first + i;
+			const Vector3f& position = dirty_vertices ? vertex_list[v] : vertex_list[i];
+
+			for (unsigned k = data.adjacency_offsets[v]; k < data.adjacency_offsets[v + 1u]; k++)
+				vertices[data.adjacency_corners[k]].vector = position.getVector4();
+		}
+	});
+
+	// Large updates recompute every normal and upload the whole buffer.
+	if (4u * count >= data.vertex_count)
+	{
+		if (compute_normals)
+		{
+			ThreadPool::parallelFor(data.desc.triangle_count, ADJACENCY_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+			{
+				for (unsigned t = begin; t < end; t++)
+					store_triangle_normal(vertices, t);
+			});
+		}
+		data.pUpdateVB->markDirtyRange(0u, 3u * data.desc.triangle_count);
+		return;
+	}
+
+	std::vector<unsigned> dirty;
+
+	// Without computed normals only the corners of the updated vertices change.
+	if (!compute_normals)
+	{
+		for (unsigned i = 0u; i < count; i++)
+		{
+			unsigned v = dirty_vertices ? dirty_vertices[i] : first + i;
+			for (unsigned k = data.adjacency_offsets[v]; k < data.adjacency_offsets[v + 1u]; k++)
+				dirty.push_back(data.adjacency_corners[k]);
+		}
+		mark_dirty_elements(data.pUpdateVB, dirty);
+		return;
+	}
+
+	// Otherwise gather the triangles around the updated vertices and recompute their normals.
+	std::vector<unsigned> triangles;
+
+	for (unsigned i = 0u; i < count; i++)
+	{
+		unsigned v = dirty_vertices ? dirty_vertices[i] : first + i;
+		for (unsigned k = data.adjacency_offsets[v]; k < data.adjacency_offsets[v + 1u]; k++)
+		{
+			unsigned t = data.adjacency_corners[k] / 3u;
+			if (data.visited_triangles[t])
+				continue;
 
-				char* tokenStart = p;
-				while (*p && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') ++p;
+			data.visited_triangles[t] = true;
+			triangles.push_back(t);
+		}
+	}
 
-				char saved = *p;
-				*p = '\0';
+	ThreadPool::parallelFor(unsigned(triangles.size()), ADJACENCY_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = begin; i < end; i++)
+			store_triangle_normal(vertices, triangles[i]);
+	});
 
-				int vp = -1, vt = -1, vn = -1;
-				parseFaceCornerToken(tokenStart, (int)vpSoFar, (int)vtSoFar, (int)vnSoFar, vp, vt, vn);
+	for (unsigned t : triangles)
+	{
+		data.visited_triangles[t] = false;
 
-				if (vp < 0 || vp >= (int)vpSoFar) cleanupAndError("OBJ parse error: face vertex index out of range.");
+		dirty.push_back(3u * t + 0u);
+		dirty.push_back(3u * t + 1u);
+		dirty.push_back(3u * t + 2u);
+	}
+	mark_dirty_elements(data.pUpdateVB, dirty);
+}
 
-				faceVP[cornerCount] = vp;
-				faceVT[cornerCount] = vt;
-				faceVN[cornerCount] = vn;
+// Helper for the partial versions of updateVertices(), calls the range helper corresponding
+// to the normal mode with the vertex data used by the Polyhedron coloring. Indexed polyhedrons
+// without smooth normals just copy the updated vertices.
 
-				*p = saved;
-				++cornerCount;
-			}
+static void update_vertices(PolyhedronInternals& data, const Vector3f* vertex_list, unsigned first, unsigned count, const unsigned* dirty_vertices)
+{
+	if (data.pick_positions)
+	{
+		for (unsigned i = 0u; i < count; i++)
+		{
+			unsigned v = dirty_vertices ? dirty_vertices[i] : first + i;
+			data.pick_positions[v] = dirty_vertices ? vertex_list[v] : vertex_list[i];
+		}
+		data.bvh_outdated = true;
+	}
 
-			if (cornerCount < 3) cleanupAndError("OBJ parse error: face has fewer than 3 vertices.");
+	if (data.smooth_positions)
+	{
+		switch (data.desc.coloring)
+		{
+		case POLYHEDRON_DESC::GLOBAL_COLORING:
+			update_smooth_range(data.Vertices, data, vertex_list, first, count, dirty_vertices);
+			break;
 
-			// Fan triangulation: (0, i, i+1)
-			for (int i = 1; i < cornerCount - 1; ++i)
-			{
-				if (triSoFar >= triangleCount)
-					cleanupAndError("OBJ parse error: internal triangle count mismatch.");
+		case POLYHEDRON_DESC::PER_VERTEX_COLORING:
+			update_smooth_range(data.ColVertices, data, vertex_list, first, count, dirty_vertices);
+			break;
 
-				const int a = 0;
-				const int b = i;
-				const int c = i + 1;
+		case POLYHEDRON_DESC::TEXTURED_COLORING:
+			update_smooth_range(data.TexVertices, data, vertex_list, first, count, dirty_vertices);
+			break;
+		}
+		return;
+	}
 
-				desc.triangle_list[triSoFar] = Vector3i{ faceVP[a], faceVP[b], faceVP[c] };
+	if (data.indexed)
+	{
+		if (!dirty_vertices)
+		{
+			for (unsigned v = 0u; v < count; v++)
+				data.Vertices[first + v].vector = vertex_list[v].getVector4();
 
-				// Per-triangle UVs -> pixel coords (3 per triangle)
-				if (wantTextured)
-				{
-					auto uvToPixel = [&](const Vector2f& uv) -> Vector2i
-						{
-							float u = uv.x;
-							float v = uv.y;
+			data.pUpdateVB->markDirtyRange(first, count);
+			return;
+		}
 
-							// Common convention: flip V. If your textures appear upside down, remove (1 - v).
-							int px = (int)(u * (float)(W - 1) + 0.5f);
-							int py = (int)((1.0f - v) * (float)(H - 1) + 0.5f);
+		std::vector<unsigned> dirty(dirty_vertices, dirty_vertices + count);
+		for (unsigned v : dirty)
+			data.Vertices[v].vector = vertex_list[v].getVector4();
 
-							if (px < 0) px = 0; else if (px >= W) px = W - 1;
-							if (py < 0) py = 0; else if (py >= H) py = H - 1;
-							return Vector2i{ px, py };
-						};
+		mark_dirty_elements(data.pUpdateVB, dirty);
+		return;
+	}
 
-					auto cornerUV = [&](int vtIndex) -> Vector2i
-						{
-							if (vtIndex < 0 || vtIndex >= (int)vtSoFar) // missing or not yet defined
-								return Vector2i{ 0, 0 };
-							return uvToPixel(rawUV[vtIndex]);
-						};
-
-					desc.texture_coordinates_list[triSoFar * 3u + 0u] = cornerUV(faceVT[a]);
-					desc.texture_coordinates_list[triSoFar * 3u + 1u] = cornerUV(faceVT[b]);
-					desc.texture_coordinates_list[triSoFar * 3u + 2u] = cornerUV(faceVT[c]);
-				}
+	switch (data.desc.coloring)
+	{
+	case POLYHEDRON_DESC::GLOBAL_COLORING:
+		update_vertex_range(data.Vertices, data, vertex_list, first, count, dirty_vertices);
+		break;
 
-				// Per-triangle-corner normals (3 per triangle)
-				// (unchanged: if a face corner lacks VN, you will still have vn=-1 and likely want computed normals)
-				if (wantPerTriNormals)
-				{
-					// If VN is missing for any corner, we cannot safely index rawNrm.
-					// Keep the old "global downgrade" behavior for normals by detecting missing VN per triangle.
-					if (faceVN[a] < 0 || faceVN[a] >= (int)vnSoFar ||
-						faceVN[b] < 0 || faceVN[b] >= (int)vnSoFar ||
-						faceVN[c] < 0 || faceVN[c] >= (int)vnSoFar)
-					{
-						// Drop normals and compute later (same end-result as your previous logic)
-						delete[] desc.normal_vectors_list;
-						desc.normal_vectors_list = nullptr;
-						desc.normal_computation = POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS;
-						wantPerTriNormals = false;
-					}
-					else
-					{
-						desc.normal_vectors_list[triSoFar * 3u + 0u] = rawNrm[faceVN[a]];
-						desc.normal_vectors_list[triSoFar * 3u + 1u] = rawNrm[faceVN[b]];
-						desc.normal_vectors_list[triSoFar * 3u + 2u] = rawNrm[faceVN[c]];
-					}
-				}
+	case POLYHEDRON_DESC::PER_VERTEX_COLORING:
+		update_vertex_range(data.ColVertices, data, vertex_list, first, count, dirty_vertices);
+		break;
 
-				++triSoFar;
-			}
-		}
-		// else ignore: usemtl, mtllib, o, g, s, etc.
+	case POLYHEDRON_DESC::TEXTURED_COLORING:
+		update_vertex_range(data.TexVertices, data, vertex_list, first, count, dirty_vertices);
+		break;
 	}
+}
 
-	// Temp arrays no longer needed
-	delete[] rawUV;
-	delete[] rawNrm;
+/*
+-----------------------------------------------------------------------------------------------------------
+ Picking helpers
+-----------------------------------------------------------------------------------------------------------
+*/
 
-	fclose(file);
-	return desc;
+// Returns the hierarchy of a Polyhedron with picking enabled, building it the first time
+// and refitting it if the vertices were updated since the last query.
+
+static const MeshBVH& picking_bvh(PolyhedronInternals& data)
+{
+	if (!data.bvh->isBuilt())
+		data.bvh->build(data.pick_positions, (const unsigned*)data.desc.triangle_list, data.desc.triangle_count);
+	else if (data.bvh_outdated)
+		data.bvh->refit(data.pick_positions);
+
+	data.bvh_outdated = false;
+	return *data.bvh;
 }
 
 /*
@@ -493,6 +3077,33 @@ Polyhedron::~Polyhedron()
 	if (data.desc.triangle_list)
 		delete[] data.desc.triangle_list;
 
+	if (data.adjacency_offsets)
+		delete[] data.adjacency_offsets;
+
+	if (data.adjacency_corners)
+		delete[] data.adjacency_corners;
+
+	if (data.smooth_positions)
+		delete[] data.smooth_positions;
+
+	if (data.corner_weights)
+		delete[] data.corner_weights;
+
+	if (data.visited_triangles)
+		delete[] data.visited_triangles;
+
+	if (data.visited_vertices)
+		delete[] data.visited_vertices;
+
+	if (data.pick_positions)
+		delete[] data.pick_positions;
+
+	if (data.bvh)
+		delete data.bvh;
+
+	if (data.pick_triangle_ids)
+		delete[] data.pick_triangle_ids;
+
 	delete &data;
 }
 
@@ -524,62 +3135,111 @@ void Polyhedron::initialize(const POLYHEDRON_DESC* pDesc)
 		"Found nullptr when trying to access a triangle list to create a Polyhedron."
 	);
 
-	USER_CHECK(data.desc.normal_computation == POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS || data.desc.normal_vectors_list,
+	USER_CHECK(data.desc.normal_computation == POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS || data.desc.normal_computation == POLYHEDRON_DESC::COMPUTED_SMOOTH_NORMALS || data.desc.normal_vectors_list,
 		"Found nullptr when trying to access a normal vector list to create a Polyhedron."
 	);
 
+	// Smooth normals are computed per vertex after the vertex data is filled.
+	const bool smooth_normals = data.desc.enable_illuminated && data.desc.normal_computation == POLYHEDRON_DESC::COMPUTED_SMOOTH_NORMALS;
+
+	// Reordered copy of the triangle list used by indexed polyhedrons, if optimized.
+	Vector3i* optimized_triangles = nullptr;
+
 	switch (data.desc.coloring)
 	{
 	case POLYHEDRON_DESC::GLOBAL_COLORING:
 	{
-		data.Vertices = new PolyhedronInternals::Vertex[3 * data.desc.triangle_count];
+		// Without per corner attributes the vertex list is uploaded once and
+		// the triangle list is used as index buffer, sharing the vertices.
+		data.indexed = !data.desc.enable_illuminated || data.desc.normal_computation == POLYHEDRON_DESC::PER_VERTEX_LIST_NORMALS || smooth_normals;
 
-		for (unsigned i = 0u; i < data.desc.triangle_count; i++)
+		if (data.indexed || smooth_normals)
+			data.vertex_count = referenced_vertex_count(data.desc);
+
+		// Only the index buffer depends on the triangle order, so it can be optimized freely.
+		if (data.indexed && data.desc.optimize_triangle_order)
 		{
-			const Vector3f& v0 = data.desc.vertex_list[data.desc.triangle_list[i].x];
-			const Vector3f& v1 = data.desc.vertex_list[data.desc.triangle_list[i].y];
-			const Vector3f& v2 = data.desc.vertex_list[data.desc.triangle_list[i].z];
+			optimized_triangles = new Vector3i[data.desc.triangle_count];
+			memcpy(optimized_triangles, data.desc.triangle_list, data.desc.triangle_count * sizeof(Vector3i));
 
-			data.Vertices[3 * i + 0].vector = v0.getVector4();
-			data.Vertices[3 * i + 1].vector = v1.getVector4();
-			data.Vertices[3 * i + 2].vector = v2.getVector4();
+			// Picked triangles are reported with their original index.
+			if (data.desc.enable_picking)
+				data.pick_triangle_ids = new unsigned[data.desc.triangle_count];
 
-			if (data.desc.enable_illuminated)
+			MeshOptimizer::optimizeTriangleOrder((unsigned*)optimized_triangles, data.desc.triangle_count, data.vertex_count, data.desc.vertex_list, data.pick_triangle_ids);
+			data.desc.triangle_list = optimized_triangles;
+		}
+
+		if (data.indexed)
+		{
+			data.Vertices = new PolyhedronInternals::Vertex[data.vertex_count];
+
+			for (unsigned v = 0u; v < data.vertex_count; v++)
 			{
-				switch (data.desc.normal_computation)
-				{
-				case POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS:
-				{
-					Vector3f norm = ((v1 - v0) * (v2 - v0)).normalize();
+				data.Vertices[v].vector = data.desc.vertex_list[v].getVector4();
 
-					data.Vertices[3 * i + 0].norm = norm.getVector4();
-					data.Vertices[3 * i + 1].norm = norm.getVector4();
-					data.Vertices[3 * i + 2].norm = norm.getVector4();
-					break;
-				}
+				if (data.desc.enable_illuminated && !smooth_normals)
+					data.Vertices[v].norm = data.desc.normal_vectors_list[v].getVector4();
+			}
+		}
+		else
+		{
+			data.Vertices = new PolyhedronInternals::Vertex[3 * data.desc.triangle_count];
 
-				case POLYHEDRON_DESC::PER_TRIANGLE_LIST_NORMALS:
-				{
-					data.Vertices[3 * i + 0].norm = data.desc.normal_vectors_list[3 * i + 0].getVector4();
-					data.Vertices[3 * i + 1].norm = data.desc.normal_vectors_list[3 * i + 1].getVector4();
-					data.Vertices[3 * i + 2].norm = data.desc.normal_vectors_list[3 * i + 2].getVector4();
-					break;
-				}
+			for (unsigned i = 0u; i < data.desc.triangle_count; i++)
+			{
+				const Vector3f& v0 = data.desc.vertex_list[data.desc.triangle_list[i].x];
+				const Vector3f& v1 = data.desc.vertex_list[data.desc.triangle_list[i].y];
+				const Vector3f& v2 = data.desc.vertex_list[data.desc.triangle_list[i].z];
 
-				case POLYHEDRON_DESC::PER_VERTEX_LIST_NORMALS:
+				data.Vertices[3 * i + 0].vector = v0.getVector4();
+				data.Vertices[3 * i + 1].vector = v1.getVector4();
+				data.Vertices[3 * i + 2].vector = v2.getVector4();
+
+				if (data.desc.enable_illuminated)
 				{
-					data.Vertices[3 * i + 0].norm = data.desc.normal_vectors_list[data.desc.triangle_list[i].x].getVector4();
-					data.Vertices[3 * i + 1].norm = data.desc.normal_vectors_list[data.desc.triangle_list[i].y].getVector4();
-					data.Vertices[3 * i + 2].norm = data.desc.normal_vectors_list[data.desc.triangle_list[i].z].getVector4();
-					break;
-				}
+					switch (data.desc.normal_computation)
+					{
+					case POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS:
+					{
+						Vector3f norm = ((v1 - v0) * (v2 - v0)).normalize();
 
-				default:
-					USER_ERROR("Unknown normal computation mode found when trying to initialize a Polyhedron.");
+						data.Vertices[3 * i + 0].norm = norm.getVector4();
+						data.Vertices[3 * i + 1].norm = norm.getVector4();
+						data.Vertices[3 * i + 2].norm = norm.getVector4();
+						break;
+					}
+
+					case POLYHEDRON_DESC::PER_TRIANGLE_LIST_NORMALS:
+					{
+						data.Vertices[3 * i + 0].norm = data.desc.normal_vectors_list[3 * i + 0].getVector4();
+						data.Vertices[3 * i + 1].norm = data.desc.normal_vectors_list[3 * i + 1].getVector4();
+						data.Vertices[3 * i + 2].norm = data.desc.normal_vectors_list[3 * i + 2].getVector4();
+						break;
+					}
+
+					case POLYHEDRON_DESC::PER_VERTEX_LIST_NORMALS:
+					{
+						data.Vertices[3 * i + 0].norm = data.desc.normal_vectors_list[data.desc.triangle_list[i].x].getVector4();
+						data.Vertices[3 * i + 1].norm = data.desc.normal_vectors_list[data.desc.triangle_list[i].y].getVector4();
+						data.Vertices[3 * i + 2].norm = data.desc.normal_vectors_list[data.desc.triangle_list[i].z].getVector4();
+						break;
+					}
+
+					// Computed once the vertex data is filled.
+					case POLYHEDRON_DESC::COMPUTED_SMOOTH_NORMALS:
+						break;
+
+					default:
+						USER_ERROR("Unknown normal computation mode found when trying to initialize a Polyhedron.");
+					}
 				}
 			}
 		}
-		data.pUpdateVB = AddBind(new VertexBuffer(data.Vertices, 3u * data.desc.triangle_count, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
+		if (smooth_normals)
+			initialize_smooth_normals(data.Vertices, data);
+
+		data.pUpdateVB = AddBind(new VertexBuffer(data.Vertices, data.indexed ? data.vertex_count : 3u * data.desc.triangle_count, data.desc.enable_updates ? VB_USAGE_PARTIAL : VB_USAGE_DEFAULT));
 
 		// If updates disabled delete the vertexs
 		if (!data.desc.enable_updates)
@@ -684,12 +3344,22 @@ void Polyhedron::initialize(const POLYHEDRON_DESC* pDesc)
 					break;
 				}
 
+				// Computed once the vertex data is filled.
+				case POLYHEDRON_DESC::COMPUTED_SMOOTH_NORMALS:
+					break;
+
 				default:
 					USER_ERROR("Unknown normal computation mode found when trying to initialize a Polyhedron.");
 				}
 			}
 		}
-		data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, 3u * data.desc.triangle_count, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
+		if (smooth_normals)
+		{
+			data.vertex_count = referenced_vertex_count(data.desc);
+			initialize_smooth_normals(data.ColVertices, data);
+		}
+
+		data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, 3u * data.desc.triangle_count, data.desc.enable_updates ? VB_USAGE_PARTIAL : VB_USAGE_DEFAULT));
 
 		// If updates disabled delete the vertexs
 		if (!data.desc.enable_updates)
@@ -809,13 +3479,23 @@ void Polyhedron::initialize(const POLYHEDRON_DESC* pDesc)
 					break;
 				}
 
+				// Computed once the vertex data is filled.
+				case POLYHEDRON_DESC::COMPUTED_SMOOTH_NORMALS:
+					break;
+
 				default:
 					USER_ERROR("Unknown normal computation mode found when trying to initialize a Polyhedron.");
 				}
 			}
 
 		}
-		data.pUpdateVB = AddBind(new VertexBuffer(data.TexVertices, 3u * data.desc.triangle_count, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
+		if (smooth_normals)
+		{
+			data.vertex_count = referenced_vertex_count(data.desc);
+			initialize_smooth_normals(data.TexVertices, data);
+		}
+
+		data.pUpdateVB = AddBind(new VertexBuffer(data.TexVertices, 3u * data.desc.triangle_count, data.desc.enable_updates ? VB_USAGE_PARTIAL : VB_USAGE_DEFAULT));
 
 		// If updates disabled delete the vertexs
 		if (!data.desc.enable_updates)
@@ -875,8 +3555,21 @@ void Polyhedron::initialize(const POLYHEDRON_DESC* pDesc)
 		USER_ERROR("Found an unrecognized coloring mode when trying to create a Polyhedron.");
 	}
 
-	// If update enabled save a copy to update vertices
-	if (data.desc.enable_updates)
+	// Indexed polyhedrons use the triangle list, stored as three unsigned integers per triangle.
+	if (data.indexed)
+		AddBind(new IndexBuffer((const unsigned*)data.desc.triangle_list, 3u * data.desc.triangle_count));
+	else
+	{
+		unsigned* indexs = new unsigned[3u * data.desc.triangle_count];
+		for (unsigned i = 0; i < 3u * data.desc.triangle_count; i++)
+			indexs[i] = i;
+
+		AddBind(new IndexBuffer(indexs, 3u * data.desc.triangle_count));
+		delete[] indexs;
+	}
+
+	// If update or picking enabled save a copy of the triangles
+	if (data.desc.enable_updates || data.desc.enable_picking)
 	{
 		Vector3i* new_list = new Vector3i[data.desc.triangle_count];
 		for (unsigned i = 0u; i < data.desc.triangle_count; i++)
@@ -888,12 +3581,29 @@ void Polyhedron::initialize(const POLYHEDRON_DESC* pDesc)
 	else
 		data.desc.triangle_list = nullptr;
 
-	unsigned* indexs = new unsigned[3u * data.desc.triangle_count];
-	for (unsigned i = 0; i < 3u * data.desc.triangle_count; i++)
-		indexs[i] = i;
+	if (optimized_triangles)
+		delete[] optimized_triangles;
 
-	AddBind(new IndexBuffer(indexs, 3u * data.desc.triangle_count));
-	delete[] indexs;
+	// Non indexed polyhedrons with updates keep the vertex to corner adjacency, so that partial
+	// updates only rewrite the corners of the vertices modified. Smooth normals already have it.
+	if (data.desc.enable_updates && !data.indexed && !data.adjacency_offsets)
+	{
+		data.vertex_count = referenced_vertex_count(data.desc);
+		build_vertex_adjacency(data.desc.triangle_list, data.desc.triangle_count, data.vertex_count, &data.adjacency_offsets, &data.adjacency_corners);
+		data.visited_triangles = new bool[data.desc.triangle_count]();
+	}
+
+	// Picking keeps its own copy of the positions, the hierarchy is built on the first query.
+	if (data.desc.enable_picking)
+	{
+		if (!data.vertex_count)
+			data.vertex_count = referenced_vertex_count(data.desc);
+
+		data.pick_positions = new Vector3f[data.vertex_count];
+		memcpy(data.pick_positions, data.desc.vertex_list, data.vertex_count * sizeof(Vector3f));
+
+		data.bvh = new MeshBVH;
+	}
 
 	AddBind(new Topology(TRIANGLE_LIST));
 	AddBind(new Rasterizer(data.desc.double_sided_rendering, data.desc.wire_frame_topology));
@@ -932,6 +3642,38 @@ void Polyhedron::initialize(const POLYHEDRON_DESC* pDesc)
 -----------------------------------------------------------------------------------------------------------
 */
 
+// Draw override, sends the pending vertex updates to the GPU and then issues
+// the draw call. Updates are coalesced and uploaded only here.
+
+void Polyhedron::Draw()
+{
+	USER_CHECK(isInit,
+		"Trying to draw an uninitialized Polyhedron."
+	);
+
+	PolyhedronInternals& data = *(PolyhedronInternals*)polyhedronData;
+
+	if (data.desc.enable_updates)
+	{
+		switch (data.desc.coloring)
+		{
+		case POLYHEDRON_DESC::GLOBAL_COLORING:
+			data.pUpdateVB->uploadDirtyRanges(data.Vertices);
+			break;
+
+		case POLYHEDRON_DESC::PER_VERTEX_COLORING:
+			data.pUpdateVB->uploadDirtyRanges(data.ColVertices);
+			break;
+
+		case POLYHEDRON_DESC::TEXTURED_COLORING:
+			data.pUpdateVB->uploadDirtyRanges(data.TexVertices);
+			break;
+		}
+	}
+
+	_draw();
+}
+
 // If updates are enabled this function allows to change the current vertex positions
 // for the new ones specified. It expects a valid pointer with a list as long as the 
 // highest index found in the triangle list used for initialization.
@@ -952,6 +3694,29 @@ void Polyhedron::updateVertices(const Vector3f* vertex_list)
 		"Trying to update the vertices on a Polyhedron with updates disabled."
 	);
 
+	if (data.pick_positions)
+	{
+		memcpy(data.pick_positions, vertex_list, data.vertex_count * sizeof(Vector3f));
+		data.bvh_outdated = true;
+	}
+
+	// Smooth normals are recomputed for the whole mesh in parallel.
+	if (data.smooth_positions)
+	{
+		update_vertices(data, vertex_list, 0u, data.vertex_count, nullptr);
+		return;
+	}
+
+	// Indexed polyhedrons upload the vertex list as is.
+	if (data.indexed)
+	{
+		for (unsigned v = 0u; v < data.vertex_count; v++)
+			data.Vertices[v].vector = vertex_list[v].getVector4();
+
+		data.pUpdateVB->markDirtyRange(0u, data.vertex_count);
+		return;
+	}
+
 	switch (data.desc.coloring)
 	{
 	case POLYHEDRON_DESC::GLOBAL_COLORING:
@@ -975,7 +3740,7 @@ void Polyhedron::updateVertices(const Vector3f* vertex_list)
 				data.Vertices[3 * i + 2].norm = norm.getVector4();
 			}
 		}
-		data.pUpdateVB->updateVertices(data.Vertices, 3u * data.desc.triangle_count);
+		data.pUpdateVB->markDirtyRange(0u, 3u * data.desc.triangle_count);
 		break;
 	}
 
@@ -1000,7 +3765,7 @@ void Polyhedron::updateVertices(const Vector3f* vertex_list)
 				data.ColVertices[3 * i + 2].norm = norm.getVector4();
 			}
 		}
-		data.pUpdateVB->updateVertices(data.ColVertices, 3u * data.desc.triangle_count);
+		data.pUpdateVB->markDirtyRange(0u, 3u * data.desc.triangle_count);
 		break;
 	}
 
@@ -1025,12 +3790,78 @@ void Polyhedron::updateVertices(const Vector3f* vertex_list)
 				data.TexVertices[3 * i + 2].norm = norm.getVector4();
 			}
 		}
-		data.pUpdateVB->updateVertices(data.TexVertices, 3u * data.desc.triangle_count);
+		data.pUpdateVB->markDirtyRange(0u, 3u * data.desc.triangle_count);
 		break;
 	}
 	}
 }
 
+// If updates are enabled this function allows to change the positions of a range of 
+// vertices, starting at the first vertex specified. It expects a valid pointer to a list
+// of vertices as long as the count. Only the triangles using those vertices are updated.
+
+void Polyhedron::updateVertices(const Vector3f* vertex_list, unsigned first, unsigned count)
+{
+	USER_CHECK(isInit,
+		"Trying to update the vertices on an uninitialized Polyhedron."
+	);
+
+	USER_CHECK(vertex_list,
+		"Trying to update the vertices with an invalid vertex list."
+	);
+
+	PolyhedronInternals& data = *(PolyhedronInternals*)polyhedronData;
+
+	USER_CHECK(data.desc.enable_updates,
+		"Trying to update the vertices on a Polyhedron with updates disabled."
+	);
+
+	if (!count)
+		return;
+
+	USER_CHECK(first <= data.vertex_count && count <= data.vertex_count - first,
+		"Trying to update a range of vertices that exceeds the vertex count of the Polyhedron."
+	);
+
+	update_vertices(data, vertex_list, first, count, nullptr);
+}
+
+// If updates are enabled this function allows to change the positions of the vertices in
+// the dirty list. It expects a valid pointer to the full vertex list, of which only the
+// listed vertices are read, and every vertex is expected to be listed only once. Only the 
+// triangles using those vertices are updated, which makes local deformations cheap.
+
+void Polyhedron::updateVertices(const Vector3f* vertex_list, const unsigned* dirty_vertices, unsigned dirty_count)
+{
+	USER_CHECK(isInit,
+		"Trying to update the vertices on an uninitialized Polyhedron."
+	);
+
+	USER_CHECK(vertex_list,
+		"Trying to update the vertices with an invalid vertex list."
+	);
+
+	PolyhedronInternals& data = *(PolyhedronInternals*)polyhedronData;
+
+	USER_CHECK(data.desc.enable_updates,
+		"Trying to update the vertices on a Polyhedron with updates disabled."
+	);
+
+	if (!dirty_count)
+		return;
+
+	USER_CHECK(dirty_vertices,
+		"Trying to update the vertices with an invalid dirty vertex list."
+	);
+
+	for (unsigned i = 0u; i < dirty_count; i++)
+		USER_CHECK(dirty_vertices[i] < data.vertex_count,
+			"Trying to update a vertex that exceeds the vertex count of the Polyhedron."
+		);
+
+	update_vertices(data, vertex_list, 0u, dirty_count, dirty_vertices);
+}
+
 // If updates are enabled, and coloring is per vertex, this function allows to change 
 // the current vertex colors for the new ones specified. It expects a valid pointer 
 // with a list of colors containing one color per every vertex of every triangle. 
@@ -1059,7 +3890,7 @@ void Polyhedron::updateColors(const Color* color_list)
 	for (unsigned i = 0u; i < 3u * data.desc.triangle_count; i++)
 		data.ColVertices[i].color = color_list[i].getColor4();
 
-	data.pUpdateVB->updateVertices(data.ColVertices, 3u * data.desc.triangle_count);
+	data.pUpdateVB->markDirtyRange(0u, 3u * data.desc.triangle_count);
 }
 
 // If normals are provided this function allows to update the normal vectors in the 
@@ -1078,7 +3909,7 @@ void Polyhedron::updateNormals(const Vector3f* normal_vectors_list)
 
 	PolyhedronInternals& data = *(PolyhedronInternals*)polyhedronData;
 
-	USER_CHECK(data.desc.normal_computation != POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS,
+	USER_CHECK(data.desc.normal_computation != POLYHEDRON_DESC::COMPUTED_TRIANGLE_NORMALS && data.desc.normal_computation != POLYHEDRON_DESC::COMPUTED_SMOOTH_NORMALS,
 		"Trying to update the normal vectors on a Polyhedron with a different normal vectors setting.\n"
 		"When normals are on computed mode, they are recomputed automatically when vertices are updated."
 	);
@@ -1091,6 +3922,19 @@ void Polyhedron::updateNormals(const Vector3f* normal_vectors_list)
 	{
 	case POLYHEDRON_DESC::GLOBAL_COLORING:
 
+		// Indexed polyhedrons store one normal per vertex, or none if not illuminated.
+		if (data.indexed)
+		{
+			if (!data.desc.enable_illuminated)
+				break;
+
+			for (unsigned v = 0u; v < data.vertex_count; v++)
+				data.Vertices[v].norm = normal_vectors_list[v].getVector4();
+
+			data.pUpdateVB->markDirtyRange(0u, data.vertex_count);
+			break;
+		}
+
 		switch (data.desc.normal_computation)
 		{
 		case POLYHEDRON_DESC::PER_TRIANGLE_LIST_NORMALS:
@@ -1108,7 +3952,7 @@ void Polyhedron::updateNormals(const Vector3f* normal_vectors_list)
 			break;
 		}
 
-		data.pUpdateVB->updateVertices(data.Vertices, 3u * data.desc.triangle_count);
+		data.pUpdateVB->markDirtyRange(0u, 3u * data.desc.triangle_count);
 		break;
 
 	case POLYHEDRON_DESC::PER_VERTEX_COLORING:
@@ -1130,7 +3974,7 @@ void Polyhedron::updateNormals(const Vector3f* normal_vectors_list)
 			break;
 		}
 
-		data.pUpdateVB->updateVertices(data.ColVertices, 3u * data.desc.triangle_count);
+		data.pUpdateVB->markDirtyRange(0u, 3u * data.desc.triangle_count);
 		break;
 
 	case POLYHEDRON_DESC::TEXTURED_COLORING:
@@ -1152,7 +3996,7 @@ void Polyhedron::updateNormals(const Vector3f* normal_vectors_list)
 			break;
 		}
 
-		data.pUpdateVB->updateVertices(data.TexVertices, 3u * data.desc.triangle_count);
+		data.pUpdateVB->markDirtyRange(0u, 3u * data.desc.triangle_count);
 		break;
 	}
 
@@ -1189,7 +4033,7 @@ void Polyhedron::updateTextureCoordinates(const Vector2i* texture_coordinates_li
 			float(texture_coordinates_list[i].y) / data.image_height,
 			0.f, 0.f };
 
-	data.pUpdateVB->updateVertices(data.TexVertices, 3u * data.desc.triangle_count);
+	data.pUpdateVB->markDirtyRange(0u, 3u * data.desc.triangle_count);
 }
 
 // If the coloring is set to global, updates the global Polyhedron color.
@@ -1439,3 +4283,65 @@ Vector2f Polyhedron::getScreenPosition() const
 
 	return { data.vscBuff.displacement.x, data.vscBuff.displacement.y };
 }
+
+// If picking is enabled, finds the closest triangle hit by the ray given in world 
+// coordinates, taking into account the rotation, distortion and position of the Polyhedron.
+// Returns false if no triangle is hit, otherwise writes the hit to the valid pointer.
+
+bool Polyhedron::pickTriangle(Vector3f origin, Vector3f direction, MESH_PICK* pPick) const
+{
+	USER_CHECK(isInit,
+		"Trying to pick a triangle on an uninitialized Polyhedron."
+	);
+
+	PolyhedronInternals& data = *(PolyhedronInternals*)polyhedronData;
+
+	USER_CHECK(data.desc.enable_picking,
+		"Trying to pick a triangle on a Polyhedron without picking enabled.\n"
+		"To pick triangles of a Polyhedron you must set enable_picking to true on its descriptor."
+	);
+
+	MeshBVH::Hit hit;
+	if (!picking_bvh(data).raycast(data.rotation.getMatrix() * data.distortion, data.position, origin, direction, &hit))
+		return false;
+
+	if (pPick)
+	{
+		pPick->triangle = data.pick_triangle_ids ? data.pick_triangle_ids[hit.triangle] : hit.triangle;
+		pPick->distance = hit.distance;
+		pPick->point = hit.point;
+		pPick->normal = hit.normal;
+		pPick->barycentric = hit.barycentric;
+	}
+	return true;
+}
+
+// If picking is enabled, finds the triangles that intersect the box given in world 
+// coordinates and writes up to the maximum specified to the list. Returns the total
+// number of triangles found, even if it is larger than the maximum.
+
+unsigned Polyhedron::queryBox(Vector3f box_min, Vector3f box_max, unsigned* triangle_list, unsigned max_triangles) const
+{
+	USER_CHECK(isInit,
+		"Trying to query the triangles of an uninitialized Polyhedron."
+	);
+
+	PolyhedronInternals& data = *(PolyhedronInternals*)polyhedronData;
+
+	USER_CHECK(data.desc.enable_picking,
+		"Trying to query the triangles of a Polyhedron without picking enabled.\n"
+		"To query triangles of a Polyhedron you must set enable_picking to true on its descriptor."
+	);
+
+	USER_CHECK(box_min.x <= box_max.x && box_min.y <= box_max.y && box_min.z <= box_max.z,
+		"Trying to query the triangles of a Polyhedron with an invalid box, its minimum is larger than its maximum."
+	);
+
+	unsigned found = picking_bvh(data).queryBox(data.rotation.getMatrix() * data.distortion, data.position, box_min, box_max, triangle_list, max_triangles);
+
+	if (data.pick_triangle_ids && triangle_list)
+		for (unsigned i = 0u; i < found && i < max_triangles; i++)
+			triangle_list[i] = data.pick_triangle_ids[triangle_list[i]];
+
+	return found;
+}
@@ -2,6 +2,16 @@
 #include "Bindable/BindableBase.h"
 
 #include "Error/_erDefault.h"
+#include "ThreadPool.h"
+#include "MappedFile.h"
+#include "PlyFormat.h"
+
+#include <cstring> // For point cloud support
+#include <cstdlib> // For point cloud support
+#include <charconv> // For point cloud support
+#include <atomic> // For point cloud support
+#include <cfloat> // For spatial queries
+#include <cmath> // For spatial queries
 
 #ifdef _DEPLOYMENT
 #include "embedded_resources.h"
@@ -13,6 +23,9 @@
 -----------------------------------------------------------------------------------------------------------
 */
 
+// Spatial index of the points, defined with its helpers below.
+struct SpatialIndex;
+
 // Struct that stores the internal data for a given Scatter object.
 struct ScatterInternals
 {
@@ -42,13 +55,1087 @@ struct ScatterInternals
 	Vector3f position = {};
 
 	VertexBuffer* pUpdateVB = nullptr;
+	IndexBuffer* pIndexBuffer = nullptr;
+
+	// Level of detail storage, level zero is the full point list. Only
+	// the binds of the current level are in the drawable bind list.
+	struct LodLevel
+	{
+		VertexBuffer* pVB;
+		IndexBuffer* pIB;
+		float voxel_size;
+		unsigned count;
+	}
+	*lod_levels = nullptr;
+	unsigned n_lod_levels = 0u;
+	unsigned current_lod = 0u;
+
+	SpatialIndex* pIndex = nullptr;
 
 	ConstantBuffer* pVSCB = nullptr;
 	ConstantBuffer* pGlobalColorCB = nullptr;
 
+	Colormap colormap;
+
+	SCATTER_DESC desc = {};
+};
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Point cloud formatting support
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Number of points parsed per parallel chunk by the binary loaders.
+#define LOADER_CHUNK 65536u
+// Approximate size in bytes of the parallel chunks of the text loaders.
+#define LOADER_TEXT_CHUNK (1u << 22)
+
+// To facilitate the loading of point clouds, this function is a parser for binary
+// *.ply files, that maps the file and reads the vertex positions, and the vertex 
+// colors if present, in parallel chunks. Outputs a valid descriptor for the cloud.
+// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+
+SCATTER_DESC Scatter::getDescFromPly(const char* ply_file_path)
+{
+	MappedFile file(ply_file_path);
+	USER_CHECK(file.isOpen(),
+		"PLY parse error: Unable to open PLY file."
+	);
+
+	const char* begin = file.data();
+	const char* end = begin + file.size();
+
+	USER_CHECK(file.size() >= 3u && !strncmp(begin, "ply", 3u),
+		"PLY parse error: The file does not start with the PLY magic number."
+	);
+
+	// Vertex layout found in the header.
+	enum { X, Y, Z, RED, GREEN, BLUE, ALPHA, N_FIELDS };
+	const char* field_names[N_FIELDS][2] =
+	{
+		{ "x", "x" }, { "y", "y" }, { "z", "z" },
+		{ "red", "diffuse_red" }, { "green", "diffuse_green" }, { "blue", "diffuse_blue" }, { "alpha", "diffuse_alpha" },
+	};
+	unsigned offsets[N_FIELDS] = {};
+	PLY_TYPE types[N_FIELDS] = {};
+
+	bool binary = false, swap = false;
+	bool in_vertex = false, vertex_found = false;
+	unsigned vertex_count = 0u, stride = 0u;
+	unsigned long long element_count = 0ull, skip_bytes = 0ull, data_offset = 0ull;
+
+	// Parse the header line by line until end_header.
+	const char* cursor = begin;
+	while (true)
+	{
+		while (cursor < end && *cursor != '\n')
+			cursor++;
+
+		USER_CHECK(cursor < end,
+			"PLY parse error: The header end was not found."
+		);
+
+		cursor++;
+
+		unsigned length;
+		const char* keyword = ply_word(cursor, end, &length);
+
+		if (length == 10u && !strncmp(keyword, "end_header", 10u))
+		{
+			while (cursor < end && *cursor != '\n')
+				cursor++;
+
+			data_offset = (unsigned long long)(cursor + 1 - begin) + skip_bytes;
+			break;
+		}
+
+		if (length == 6u && !strncmp(keyword, "format", 6u))
+		{
+			const char* format = ply_word(cursor, end, &length);
+
+			USER_CHECK(!(length == 5u && !strncmp(format, "ascii", 5u)),
+				"PLY parse error: ASCII PLY files are not supported.\n"
+				"Only binary PLY point clouds can be loaded, ASCII clouds can be loaded as XYZ."
+			);
+
+			binary = true;
+			swap = length == 17u && !strncmp(format, "binary_big_endian", 17u);
+		}
+		else if (length == 7u && !strncmp(keyword, "element", 7u))
+		{
+			const char* name = ply_word(cursor, end, &length);
+			bool is_vertex = length == 6u && !strncmp(name, "vertex", 6u);
+
+			const char* count = ply_word(cursor, end, &length);
+			unsigned long long n = strtoull(count, nullptr, 10);
+			element_count = n;
+
+			if (is_vertex)
+			{
+				USER_CHECK(n && n < 0xFFFFFFFFull,
+					"PLY parse error: Invalid vertex count found on the PLY header."
+				);
+				vertex_count = unsigned(n);
+				vertex_found = true;
+			}
+			in_vertex = is_vertex;
+		}
+		else if (length == 8u && !strncmp(keyword, "property", 8u))
+		{
+			// Elements after the vertices are not read.
+			if (vertex_found && !in_vertex)
+				continue;
+
+			const char* type_name = ply_word(cursor, end, &length);
+
+			USER_CHECK(!in_vertex || !(length == 4u && !strncmp(type_name, "list", 4u)),
+				"PLY parse error: List properties on vertices are not supported."
+			);
+
+			USER_CHECK(in_vertex || !(length == 4u && !strncmp(type_name, "list", 4u)),
+				"PLY parse error: Elements with list properties before the vertices are not supported."
+			);
+
+			PLY_TYPE type = ply_type(type_name, length);
+			USER_CHECK(type != PLY_INVALID,
+				"PLY parse error: Unrecognized property type found on the PLY header."
+			);
+
+			if (in_vertex)
+			{
+				const char* name = ply_word(cursor, end, &length);
+				for (unsigned f = 0u; f < N_FIELDS; f++)
+					for (const char* field : field_names[f])
+						if (strlen(field) == length && !strncmp(field, name, length))
+						{
+							offsets[f] = stride;
+							types[f] = type;
+						}
+
+				stride += ply_size(type);
+			}
+			// Elements before the vertices are skipped, they must have fixed size.
+			else if (!vertex_found)
+				skip_bytes += element_count * ply_size(type);
+		}
+	}
+
+	USER_CHECK(binary,
+		"PLY parse error: No format line found on the PLY header."
+	);
+
+	USER_CHECK(vertex_found && types[X] && types[Y] && types[Z],
+		"PLY parse error: The PLY file does not contain vertices with x, y and z coordinates."
+	);
+
+	USER_CHECK(data_offset + (unsigned long long)vertex_count * stride <= file.size(),
+		"PLY parse error: The file is shorter than the data declared on its header."
+	);
+
 	SCATTER_DESC desc = {};
+	desc.point_count = vertex_count;
+	desc.point_list = new Vector3f[vertex_count];
+
+	bool has_colors = types[RED] && types[GREEN] && types[BLUE];
+	if (has_colors)
+	{
+		desc.coloring = SCATTER_DESC::POINT_COLORING;
+		desc.color_list = new Color[vertex_count];
+	}
+
+	// Fast path for the common little endian float coordinates.
+	const bool float_xyz = !swap && types[X] == PLY_FLOAT32 && types[Y] == PLY_FLOAT32 && types[Z] == PLY_FLOAT32;
+	const char* vertices = begin + data_offset;
+
+	ThreadPool::parallelFor(vertex_count, LOADER_CHUNK, [&](unsigned first, unsigned last, unsigned)
+	{
+		for (unsigned i = first; i < last; i++)
+		{
+			const char* vertex = vertices + (unsigned long long)i * stride;
+			Vector3f& p = desc.point_list[i];
+
+			if (float_xyz)
+			{
+				memcpy(&p.x, vertex + offsets[X], 4u);
+				memcpy(&p.y, vertex + offsets[Y], 4u);
+				memcpy(&p.z, vertex + offsets[Z], 4u);
+			}
+			else
+			{
+				p.x = float(ply_read(vertex + offsets[X], types[X], swap));
+				p.y = float(ply_read(vertex + offsets[Y], types[Y], swap));
+				p.z = float(ply_read(vertex + offsets[Z], types[Z], swap));
+			}
+
+			if (has_colors)
+			{
+				Color& c = desc.color_list[i];
+				c.R = ply_channel(ply_read(vertex + offsets[RED], types[RED], swap), types[RED]);
+				c.G = ply_channel(ply_read(vertex + offsets[GREEN], types[GREEN], swap), types[GREEN]);
+				c.B = ply_channel(ply_read(vertex + offsets[BLUE], types[BLUE], swap), types[BLUE]);
+				c.A = types[ALPHA] ? ply_channel(ply_read(vertex + offsets[ALPHA], types[ALPHA], swap), types[ALPHA]) : 255u;
+			}
+		}
+	});
+
+	return desc;
+}
+
+// Whether the character can be the first one of a number.
+static inline bool starts_number(char c)
+{
+	return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.';
+}
+
+// Whether the character separates values on a text point cloud.
+static inline bool is_separator(char c)
+{
+	return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r';
+}
+
+// Returns whether the line starting at the cursor contains a point, skipping its indentation.
+static inline bool is_point_line(const char* cursor, const char* end)
+{
+	while (cursor < end && (*cursor == ' ' || *cursor == '\t'))
+		cursor++;
+
+	return cursor < end && starts_number(*cursor);
+}
+
+// Parses up to the maximum number of values from the line starting at the cursor, and
+// returns the number of values read. Parsing stops at the line end or the first invalid value.
+static unsigned parse_line(const char* cursor, const char* end, float* values, unsigned max_values)
+{
+	unsigned n = 0u;
+	while (n < max_values)
+	{
+		while (cursor < end && is_separator(*cursor))
+			cursor++;
+
+		if (cursor >= end || *cursor == '\n')
+			break;
+
+		// Plus signs are not accepted by from_chars.
+		if (*cursor == '+')
+			cursor++;
+
+		std::from_chars_result result = std::from_chars(cursor, end, values[n]);
+		if (result.ec != std::errc())
+			break;
+
+		cursor = result.ptr;
+		n++;
+	}
+	return n;
+}
+
+// Parser for plain text point clouds (*.xyz, *.txt, *.csv), one point per line with its
+// values separated by spaces, commas or semicolons. If lines have six or more values the 
+// fourth to sixth are read as 0-255 RGB colors. Lines not starting with a number are skipped.
+// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+
+SCATTER_DESC Scatter::getDescFromXyz(const char* xyz_file_path)
+{
+	MappedFile file(xyz_file_path);
+	USER_CHECK(file.isOpen(),
+		"XYZ parse error: Unable to open XYZ file."
+	);
+
+	const char* begin = file.data();
+	const char* end = begin + file.size();
+
+	// Split the file in chunks that start at line beginnings.
+	unsigned n_chunks = unsigned(file.size() / LOADER_TEXT_CHUNK) + 1u;
+	const char** chunk_starts = new const char*[n_chunks + 1u];
+	unsigned* chunk_offsets = new unsigned[n_chunks + 1u];
+
+	chunk_starts[0] = begin;
+	for (unsigned c = 1u; c < n_chunks; c++)
+	{
+		const char* start = begin + (unsigned long long)c * LOADER_TEXT_CHUNK;
+		if (start < chunk_starts[c - 1u])
+			start = chunk_starts[c - 1u];
+
+		while (start < end && *start != '\n')
+			start++;
+
+		chunk_starts[c] = start < end ? start + 1 : end;
+	}
+	chunk_starts[n_chunks] = end;
+
+	// Count the point lines of every chunk.
+	ThreadPool::parallelFor(n_chunks, 1u, [&](unsigned first, unsigned last, unsigned)
+	{
+		for (unsigned c = first; c < last; c++)
+		{
+			unsigned lines = 0u;
+			for (const char* line = chunk_starts[c]; line < chunk_starts[c + 1u];)
+			{
+				if (is_point_line(line, chunk_starts[c + 1u]))
+					lines++;
+
+				while (line < chunk_starts[c + 1u] && *line != '\n')
+					line++;
+				line++;
+			}
+			chunk_offsets[c] = lines;
+		}
+	});
+
+	unsigned point_count = 0u;
+	for (unsigned c = 0u; c < n_chunks; c++)
+	{
+		unsigned lines = chunk_offsets[c];
+		chunk_offsets[c] = point_count;
+		point_count += lines;
+	}
+
+	USER_CHECK(point_count,
+		"XYZ parse error: No points found in the XYZ file."
+	);
+
+	// The first point line decides whether the cloud has colors.
+	const char* first_line = begin;
+	while (!is_point_line(first_line, end))
+	{
+		while (*first_line != '\n')
+			first_line++;
+		first_line++;
+	}
+
+	float values[6];
+	bool has_colors = parse_line(first_line, end, values, 6u) == 6u;
+
+	SCATTER_DESC desc = {};
+	desc.point_count = point_count;
+	desc.point_list = new Vector3f[point_count];
+
+	if (has_colors)
+	{
+		desc.coloring = SCATTER_DESC::POINT_COLORING;
+		desc.color_list = new Color[point_count];
+	}
+
+	// Parse every chunk into its own range of the output lists.
+	std::atomic<bool> invalid_line = false;
+	ThreadPool::parallelFor(n_chunks, 1u, [&](unsigned first, unsigned last, unsigned)
+	{
+		for (unsigned c = first; c < last; c++)
+		{
+			unsigned index = chunk_offsets[c];
+			const char* chunk_end = chunk_starts[c + 1u];
+
+			for (const char* line = chunk_starts[c]; line < chunk_end;)
+			{
+				if (is_point_line(line, chunk_end))
+				{
+					float v[6];
+					unsigned n = parse_line(line, chunk_end, v, has_colors ? 6u : 3u);
+
+					if (n < (has_colors ? 6u : 3u))
+					{
+						invalid_line = true;
+						n = 0u;
+						v[0] = v[1] = v[2] = 0.f;
+					}
+
+					desc.point_list[index] = { v[0], v[1], v[2] };
+
+					if (has_colors)
+					{
+						auto channel = [](float x) { return x <= 0.f ? (unsigned char)0u : x >= 255.f ? (unsigned char)255u : (unsigned char)(x + 0.5f); };
+						desc.color_list[index] = n ? Color(channel(v[3]), channel(v[4]), channel(v[5])) : Color::White;
+					}
+					index++;
+				}
+
+				while (line < chunk_end && *line != '\n')
+					line++;
+				line++;
+			}
+		}
+	});
+
+	delete[] chunk_starts;
+	delete[] chunk_offsets;
+
+	if (invalid_line)
+	{
+		delete[] desc.point_list;
+		if (desc.color_list)
+			delete[] desc.color_list;
+
+		USER_ERROR("XYZ parse error: Found a point line with missing or invalid values.");
+	}
+
+	return desc;
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Level Of Detail Helpers
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Bits per axis of the Morton codes, the finest voxel is the bounding cube over 2^21.
+#define LOD_AXIS_BITS 21u
+// Maximum number of levels stored, full resolution included.
+#define LOD_MAX_LEVELS 16u
+// Levels with less voxels than this are not stored.
+#define LOD_MIN_POINTS 64u
+// Number of points processed per parallel chunk.
+#define LOD_CHUNK 65536u
+
+// Bind list positions of the index and vertex buffers, swapped when the level changes.
+#define SCATTER_IB_BIND 0u
+#define SCATTER_VB_BIND 1u
+
+// Accumulator for the points averaged inside a voxel.
+struct LodAccumulator
+{
+	double x, y, z;
+	double r, g, b, a;
+	unsigned weight;
+};
+
+// Interleaves the lowest 21 bits of the value leaving two zero bits between them.
+static inline unsigned long long spread_bits(unsigned long long x)
+{
+	x &= 0x1FFFFFull;
+	x = (x | x << 32) & 0x1F00000000FFFFull;
+	x = (x | x << 16) & 0x1F0000FF0000FFull;
+	x = (x | x << 8) & 0x100F00F00F00F00Full;
+	x = (x | x << 4) & 0x10C30C30C30C30C3ull;
+	x = (x | x << 2) & 0x1249249249249249ull;
+	return x;
+}
+
+// Merges every run of sorted codes that fall in the same voxel, defined by the codes shifted
+// by the value specified. The fetch function adds the element to the accumulator. Outputs
+// the averaged points, colors if not nullptr, weights and a code per voxel, and returns the
+// number of voxels. Runs are assigned to the chunk where they start, so no merging is needed.
+
+template<typename F>
+static unsigned merge_voxels(const unsigned long long* codes, unsigned count, unsigned shift, const F& fetch,
+	unsigned long long* out_codes, unsigned* out_weights, _float4vector* out_points, _float4color* out_colors)
+{
+	unsigned n_chunks = (count + LOD_CHUNK - 1u) / LOD_CHUNK;
+	unsigned* chunk_offsets = new unsigned[n_chunks];
+
+	ThreadPool::parallelFor(count, LOD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		unsigned runs = 0u;
+		for (unsigned i = begin; i < end; i++)
+			if (!i || (codes[i] >> shift) != (codes[i - 1u] >> shift))
+				runs++;
+
+		chunk_offsets[begin / LOD_CHUNK] = runs;
+	});
+
+	unsigned total = 0u;
+	for (unsigned c = 0u; c < n_chunks; c++)
+	{
+		unsigned runs = chunk_offsets[c];
+		chunk_offsets[c] = total;
+		total += runs;
+	}
+
+	ThreadPool::parallelFor(count, LOD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		unsigned out = chunk_offsets[begin / LOD_CHUNK];
+
+		// Skip the tail of the run started by the previous chunk.
+		unsigned i = begin;
+		while (i < end && i && (codes[i] >> shift) == (codes[i - 1u] >> shift))
+			i++;
+
+		while (i < end)
+		{
+			LodAccumulator acc = {};
+			unsigned long long voxel = codes[i] >> shift;
+
+			unsigned j = i;
+			do fetch(j++, acc);
+			while (j < count && (codes[j] >> shift) == voxel);
+
+			double inv = 1.0 / acc.weight;
+			out_codes[out] = codes[i];
+			out_weights[out] = acc.weight;
+			out_points[out] = { float(acc.x * inv), float(acc.y * inv), float(acc.z * inv), 1.f };
+			if (out_colors)
+				out_colors[out] = { float(acc.r * inv), float(acc.g * inv), float(acc.b * inv), float(acc.a * inv) };
+
+			out++;
+			i = j;
+		}
+	});
+
+	delete[] chunk_offsets;
+	return total;
+}
+
+// Computes the Morton code of every point inside the bounding cube of the list, with 21 bits
+// per axis, and sorts the codes in parallel. The order list receives the point index of every
+// sorted code. Returns the side length of the bounding cube.
+
+static float sort_by_morton_code(const Vector3f* points, unsigned n, unsigned long long* codes, unsigned* order)
+{
+	const unsigned n_threads = ThreadPool::threadCount();
+
+	// Bounding box of the cloud, reduced per thread.
+	Vector3f* mins = new Vector3f[n_threads];
+	Vector3f* maxs = new Vector3f[n_threads];
+	for (unsigned t = 0u; t < n_threads; t++)
+		mins[t] = maxs[t] = points[0];
+
+	ThreadPool::parallelFor(n, LOD_CHUNK, [&](unsigned begin, unsigned end, unsigned thread)
+	{
+		Vector3f min = mins[thread], max = maxs[thread];
+		for (unsigned i = begin; i < end; i++)
+		{
+			const Vector3f& p = points[i];
+			min.x = p.x < min.x ? p.x : min.x;
+			max.x = p.x > max.x ? p.x : max.x;
+			min.y = p.y < min.y ? p.y : min.y;
+			max.y = p.y > max.y ? p.y : max.y;
+			min.z = p.z < min.z ? p.z : min.z;
+			max.z = p.z > max.z ? p.z : max.z;
+		}
+		mins[thread] = min;
+		maxs[thread] = max;
+	});
+
+	Vector3f min = mins[0], max = maxs[0];
+	for (unsigned t = 1u; t < n_threads; t++)
+	{
+		min.x = mins[t].x < min.x ? mins[t].x : min.x;
+		max.x = maxs[t].x > max.x ? maxs[t].x : max.x;
+		min.y = mins[t].y < min.y ? mins[t].y : min.y;
+		max.y = maxs[t].y > max.y ? maxs[t].y : max.y;
+		min.z = mins[t].z < min.z ? mins[t].z : min.z;
+		max.z = maxs[t].z > max.z ? maxs[t].z : max.z;
+	}
+	delete[] mins;
+	delete[] maxs;
+
+	float extent = max.x - min.x;
+	if (max.y - min.y > extent) extent = max.y - min.y;
+	if (max.z - min.z > extent) extent = max.z - min.z;
+	if (extent <= 0.f) extent = 1.f;
+
+	// Morton code of every point inside the bounding cube.
+	const unsigned cells = 1u << LOD_AXIS_BITS;
+	const float quantize = float(cells) / extent;
+
+	ThreadPool::parallelFor(n, LOD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = begin; i < end; i++)
+		{
+			Vector3f q = (points[i] - min) * quantize;
+			unsigned qx = q.x < float(cells - 1u) ? unsigned(q.x) : cells - 1u;
+			unsigned qy = q.y < float(cells - 1u) ? unsigned(q.y) : cells - 1u;
+			unsigned qz = q.z < float(cells - 1u) ? unsigned(q.z) : cells - 1u;
+
+			codes[i] = spread_bits(qx) | spread_bits(qy) << 1 | spread_bits(qz) << 2;
+			order[i] = i;
+		}
+	});
+
+	ThreadPool::radixSort(codes, order, n, 3u * LOD_AXIS_BITS);
+	return extent;
+}
+
+// Builds the voxel downsampled levels of the Scatter. Points are sorted by Morton code in
+// parallel, every voxel of a level is then a run of equal code prefixes, and every level is
+// averaged from the previous one weighting by point count. Only levels that at least halve
+// the point count of the previous one are stored.
+
+static void build_lod_levels(ScatterInternals& data)
+{
+	const unsigned n = data.desc.point_count;
+	const Vector3f* points = data.desc.point_list;
+	const Color* colors = data.desc.coloring != SCATTER_DESC::GLOBAL_COLORING ? data.desc.color_list : nullptr;
+	const unsigned n_threads = ThreadPool::threadCount();
+
+	// Sort the points by Morton code inside their bounding cube.
+	unsigned long long* codes = new unsigned long long[n];
+	unsigned* order = new unsigned[n];
+	const float extent = sort_by_morton_code(points, n, codes, order);
+	const unsigned cells = 1u << LOD_AXIS_BITS;
+
+	// Voxel count of every level in a single pass. Two consecutive codes start a new voxel
+	// on all levels below the highest differing bit, so a histogram of that bit is enough.
+	constexpr unsigned N_LEVELS = LOD_AXIS_BITS + 1u;
+	unsigned* hist = new unsigned[n_threads * N_LEVELS]();
+
+	ThreadPool::parallelFor(n, LOD_CHUNK, [&](unsigned begin, unsigned end, unsigned thread)
+	{
+		unsigned* h = hist + thread * N_LEVELS;
+		for (unsigned i = begin ? begin : 1u; i < end; i++)
+		{
+			unsigned long long diff = codes[i] ^ codes[i - 1u];
+			if (!diff)
+				continue;
+
+			unsigned msb = 0u;
+			while (diff >>= 1)
+				msb++;
+			h[msb / 3u]++;
+		}
+	});
+
+	unsigned voxels[N_LEVELS];
+	unsigned starts = 1u;
+	for (int l = N_LEVELS - 1; l >= 0; l--)
+	{
+		for (unsigned t = 0u; t < n_threads; t++)
+			starts += hist[t * N_LEVELS + l];
+		voxels[l] = starts;
+	}
+	delete[] hist;
+
+	// Choose the levels to be stored.
+	unsigned chosen[LOD_MAX_LEVELS];
+	unsigned n_chosen = 0u;
+	unsigned previous = n;
+	for (unsigned l = 1u; l < N_LEVELS && n_chosen < LOD_MAX_LEVELS - 1u; l++)
+	{
+		if (voxels[l] < LOD_MIN_POINTS)
+			break;
+
+		if (2u * voxels[l] <= previous)
+		{
+			chosen[n_chosen++] = l;
+			previous = voxels[l];
+		}
+	}
+
+	data.n_lod_levels = n_chosen + 1u;
+	data.lod_levels = new ScatterInternals::LodLevel[data.n_lod_levels];
+	data.lod_levels[0] = { data.pUpdateVB, data.pIndexBuffer, 0.f, n };
+
+	if (n_chosen)
+	{
+		// Storage for the current and previous level, the first one is the largest.
+		unsigned max_count = voxels[chosen[0]];
+		unsigned long long* level_codes[2] = { new unsigned long long[max_count], new unsigned long long[max_count] };
+		unsigned* level_weights[2] = { new unsigned[max_count], new unsigned[max_count] };
+		_float4vector* level_points[2] = { new _float4vector[max_count], new _float4vector[max_count] };
+		_float4color* level_colors[2] = { colors ? new _float4color[max_count] : nullptr, colors ? new _float4color[max_count] : nullptr };
+
+		ScatterInternals::ColPoint* col_points = colors ? new ScatterInternals::ColPoint[max_count] : nullptr;
+
+		unsigned* indices = new unsigned[max_count];
+		for (unsigned i = 0u; i < max_count; i++)
+			indices[i] = i;
+
+		unsigned last_count = 0u;
+		for (unsigned c = 0u; c < n_chosen; c++)
+		{
+			unsigned shift = 3u * chosen[c];
+			unsigned cur = c % 2u, prev = 1u - cur;
+			unsigned count;
+
+			// The first level reads the original points, next ones the previous level.
+			if (!c)
+			{
+				count = merge_voxels(codes, n, shift, [&](unsigned i, LodAccumulator& acc)
+				{
+					const Vector3f& p = points[order[i]];
+					acc.x += p.x; acc.y += p.y; acc.z += p.z;
+					if (colors)
+					{
+						_float4color col = colors[order[i]].getColor4();
+						acc.r += col.r; acc.g += col.g; acc.b += col.b; acc.a += col.a;
+					}
+					acc.weight++;
+				}, level_codes[cur], level_weights[cur], level_points[cur], level_colors[cur]);
+			}
+			else
+			{
+				count = merge_voxels(level_codes[prev], last_count, shift, [&](unsigned i, LodAccumulator& acc)
+				{
+					double w = level_weights[prev][i];
+					const _float4vector& p = level_points[prev][i];
+					acc.x += w * p.x; acc.y += w * p.y; acc.z += w * p.z;
+					if (colors)
+					{
+						const _float4color& col = level_colors[prev][i];
+						acc.r += w * col.r; acc.g += w * col.g; acc.b += w * col.b; acc.a += w * col.a;
+					}
+					acc.weight += level_weights[prev][i];
+				}, level_codes[cur], level_weights[cur], level_points[cur], level_colors[cur]);
+			}
+			last_count = count;
+
+			ScatterInternals::LodLevel& level = data.lod_levels[c + 1u];
+			level.count = count;
+			level.voxel_size = extent * float(1u << chosen[c]) / float(cells);
+			level.pIB = new IndexBuffer(indices, count);
+
+			if (colors)
+			{
+				for (unsigned i = 0u; i < count; i++)
+					col_points[i] = { level_points[cur][i], level_colors[cur][i] };
+
+				level.pVB = new VertexBuffer(col_points, count);
+			}
+			else
+				level.pVB = new VertexBuffer(level_points[cur], count);
+		}
+
+		for (unsigned k = 0u; k < 2u; k++)
+		{
+			delete[] level_codes[k];
+			delete[] level_weights[k];
+			delete[] level_points[k];
+			if (level_colors[k])
+				delete[] level_colors[k];
+		}
+		if (col_points)
+			delete[] col_points;
+		delete[] indices;
+	}
+
+	delete[] codes;
+	delete[] order;
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Spatial Index Helpers
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Maximum number of points per leaf of the spatial index.
+#define INDEX_LEAF_SIZE 16u
+// Updates of at least this fraction of the points are refitted as a whole on the next query.
+#define INDEX_FULL_REFIT_RATIO 8u
+// Maximum depth of the traversal stacks, the tree depth is at most 29.
+#define INDEX_STACK_SIZE 64u
+
+// Axis aligned box of a spatial index node.
+struct IndexBox
+{
+	Vector3f min;
+	Vector3f max;
 };
 
+// Point bounding volume hierarchy stored as a complete binary tree in heap order. Points are
+// sorted by Morton code and split evenly between the leaves, node k has children 2k + 1 and 
+// 2k + 2 and the leaves are the last nodes. Refits keep the tree and recompute the boxes.
+struct SpatialIndex
+{
+	unsigned count = 0u;				// Number of points.
+	unsigned n_leaves = 0u;				// Number of leaves, a power of two.
+	Vector3f* points = nullptr;			// Object space positions in sorted order.
+	unsigned* order = nullptr;			// Point index of every sorted slot.
+	unsigned* slot = nullptr;			// Sorted slot of every point index.
+	IndexBox* nodes = nullptr;			// Node boxes, twice the leaves minus one.
+	unsigned char* dirty = nullptr;		// Node marks used by incremental refits.
+	bool stale = false;					// Whether a full refit is pending.
+
+	~SpatialIndex()
+	{
+		delete[] points;
+		delete[] order;
+		delete[] slot;
+		delete[] nodes;
+		delete[] dirty;
+	}
+
+	// First sorted slot of the leaf specified, the leaf ends where the next one begins.
+	inline unsigned leafBegin(unsigned leaf) const
+	{
+		return unsigned((unsigned long long)leaf * count / n_leaves);
+	}
+
+	// Leaf that contains the sorted slot specified.
+	inline unsigned leafOf(unsigned s) const
+	{
+		return unsigned(((unsigned long long)(s + 1u) * n_leaves + count - 1u) / count) - 1u;
+	}
+};
+
+// Recomputes the box of the leaf specified from its points.
+static void refit_leaf(SpatialIndex& index, unsigned leaf)
+{
+	unsigned begin = index.leafBegin(leaf), end = index.leafBegin(leaf + 1u);
+
+	IndexBox box = { index.points[begin], index.points[begin] };
+	for (unsigned s = begin + 1u; s < end; s++)
+	{
+		const Vector3f& p = index.points[s];
+		box.min.x = p.x < box.min.x ? p.x : box.min.x;
+		box.max.x = p.x > box.max.x ? p.x : box.max.x;
+		box.min.y = p.y < box.min.y ? p.y : box.min.y;
+		box.max.y = p.y > box.max.y ? p.y : box.max.y;
+		box.min.z = p.z < box.min.z ? p.z : box.min.z;
+		box.max.z = p.z > box.max.z ? p.z : box.max.z;
+	}
+	index.nodes[index.n_leaves - 1u + leaf] = box;
+}
+
+// Recomputes the box of an inner node from its children.
+static void refit_node(SpatialIndex& index, unsigned node)
+{
+	const IndexBox& a = index.nodes[2u * node + 1u];
+	const IndexBox& b = index.nodes[2u * node + 2u];
+	IndexBox& box = index.nodes[node];
+
+	box.min.x = a.min.x < b.min.x ? a.min.x : b.min.x;
+	box.max.x = a.max.x > b.max.x ? a.max.x : b.max.x;
+	box.min.y = a.min.y < b.min.y ? a.min.y : b.min.y;
+	box.max.y = a.max.y > b.max.y ? a.max.y : b.max.y;
+	box.min.z = a.min.z < b.min.z ? a.min.z : b.min.z;
+	box.max.z = a.max.z > b.max.z ? a.max.z : b.max.z;
+}
+
+// Recomputes all the boxes of the tree in parallel, leaves first and then every level up.
+static void refit_all(SpatialIndex& index)
+{
+	ThreadPool::parallelFor(index.n_leaves, 1024u, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned leaf = begin; leaf < end; leaf++)
+			refit_leaf(index, leaf);
+	});
+
+	for (unsigned width = index.n_leaves / 2u; width; width /= 2u)
+	{
+		ThreadPool::parallelFor(width, 4096u, [&](unsigned begin, unsigned end, unsigned)
+		{
+			for (unsigned i = begin; i < end; i++)
+				refit_node(index, width - 1u + i);
+		});
+	}
+
+	index.stale = false;
+}
+
+// Builds the spatial index of the points in parallel, the points are sorted by Morton
+// code so that every leaf and every node contains points that are close together.
+static SpatialIndex* build_spatial_index(const Vector3f* points, unsigned n)
+{
+	SpatialIndex* index = new SpatialIndex;
+	index->count = n;
+	index->n_leaves = 1u;
+	while (index->n_leaves * INDEX_LEAF_SIZE < n)
+		index->n_leaves *= 2u;
+
+	unsigned long long* codes = new unsigned long long[n];
+	index->order = new unsigned[n];
+	sort_by_morton_code(points, n, codes, index->order);
+	delete[] codes;
+
+	index->points = new Vector3f[n];
+	index->slot = new unsigned[n];
+
+	ThreadPool::parallelFor(n, LOD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned s = begin; s < end; s++)
+		{
+			index->points[s] = points[index->order[s]];
+			index->slot[index->order[s]] = s;
+		}
+	});
+
+	index->nodes = new IndexBox[2u * index->n_leaves - 1u];
+	index->dirty = new unsigned char[2u * index->n_leaves - 1u]();
+
+	refit_all(*index);
+	return index;
+}
+
+// Copies the updated positions of a range of points into the index and refits the affected
+// leaves and their ancestors. Large updates are left for a full parallel refit on the next query.
+template<typename F>
+static void refit_spatial_index(SpatialIndex& index, unsigned first, unsigned count, const F& position)
+{
+	ThreadPool::parallelFor(count, LOD_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = first + begin; i < first + end; i++)
+			index.points[index.slot[i]] = position(i);
+	});
+
+	if (index.stale || INDEX_FULL_REFIT_RATIO * count >= index.count)
+	{
+		index.stale = true;
+		return;
+	}
+
+	// All the leaves are on the same level, so the marked nodes can be refitted level by level.
+	unsigned* nodes = new unsigned[count];
+	unsigned n_nodes = 0u;
+
+	for (unsigned i = first; i < first + count; i++)
+	{
+		unsigned node = index.n_leaves - 1u + index.leafOf(index.slot[i]);
+		if (!index.dirty[node])
+		{
+			index.dirty[node] = 1u;
+			nodes[n_nodes++] = node;
+		}
+	}
+
+	bool leaves = true;
+	while (n_nodes)
+	{
+		unsigned n_parents = 0u;
+		for (unsigned k = 0u; k < n_nodes; k++)
+		{
+			unsigned node = nodes[k];
+			index.dirty[node] = 0u;
+
+			if (leaves)
+				refit_leaf(index, node - (index.n_leaves - 1u));
+			else
+				refit_node(index, node);
+
+			if (node)
+			{
+				unsigned parent = (node - 1u) / 2u;
+				if (!index.dirty[parent])
+				{
+					index.dirty[parent] = 1u;
+					nodes[n_parents++] = parent;
+				}
+			}
+		}
+		n_nodes = n_parents;
+		leaves = false;
+	}
+
+	delete[] nodes;
+}
+
+// Sends the positions of the updated range to the spatial index, if the Scatter has one.
+static void update_spatial_index(ScatterInternals& data, unsigned first, unsigned count)
+{
+	if (!data.pIndex)
+		return;
+
+	if (data.desc.coloring == SCATTER_DESC::GLOBAL_COLORING)
+		refit_spatial_index(*data.pIndex, first, count, [&](unsigned i) { return Vector3f(data.Points[i]); });
+	else
+		refit_spatial_index(*data.pIndex, first, count, [&](unsigned i) { return Vector3f(data.ColPoints[i].position); });
+}
+
+// Upper bound of the stretch of a matrix, its Frobenius norm.
+static inline float max_stretch(const Matrix& M)
+{
+	return sqrtf(
+		M.a00 * M.a00 + M.a01 * M.a01 + M.a02 * M.a02 +
+		M.a10 * M.a10 + M.a11 * M.a11 + M.a12 * M.a12 +
+		M.a20 * M.a20 + M.a21 * M.a21 + M.a22 * M.a22
+	);
+}
+
+// Squared distance from a point to a box, zero if the point is inside.
+static inline float box_distance2(const IndexBox& box, const Vector3f& p)
+{
+	float dx = p.x < box.min.x ? box.min.x - p.x : p.x > box.max.x ? p.x - box.max.x : 0.f;
+	float dy = p.y < box.min.y ? box.min.y - p.y : p.y > box.max.y ? p.y - box.max.y : 0.f;
+	float dz = p.z < box.min.z ? box.min.z - p.z : p.z > box.max.z ? p.z - box.max.z : 0.f;
+	return dx * dx + dy * dy + dz * dz;
+}
+
+// Intersects a line with a box grown by the margin specified. Returns false if they do not
+// intersect, otherwise writes the line parameter where the line enters the box.
+static inline bool line_box(const IndexBox& box, float margin, const Vector3f& o, const Vector3f& d, float* t_enter)
+{
+	float t_in = -FLT_MAX, t_out = FLT_MAX;
+
+	const float o_axis[3] = { o.x, o.y, o.z };
+	const float d_axis[3] = { d.x, d.y, d.z };
+	const float min_axis[3] = { box.min.x - margin, box.min.y - margin, box.min.z - margin };
+	const float max_axis[3] = { box.max.x + margin, box.max.y + margin, box.max.z + margin };
+
+	for (unsigned a = 0u; a < 3u; a++)
+	{
+		if (d_axis[a] == 0.f)
+		{
+			if (o_axis[a] < min_axis[a] || o_axis[a] > max_axis[a])
+				return false;
+			continue;
+		}
+
+		float t0 = (min_axis[a] - o_axis[a]) / d_axis[a];
+		float t1 = (max_axis[a] - o_axis[a]) / d_axis[a];
+		if (t0 > t1) { float t = t0; t0 = t1; t1 = t; }
+
+		t_in = t0 > t_in ? t0 : t_in;
+		t_out = t1 < t_out ? t1 : t_out;
+		if (t_in > t_out)
+			return false;
+	}
+
+	*t_enter = t_in;
+	return true;
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Colormap Helpers
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Returns a new list with the colormap values of a range of points, read from the value list
+// of the descriptor or from the positions given by the function. If the colormap range of the
+// descriptor is empty it is set to the range of the values, and kept for the updates.
+
+template<typename F>
+static float* colormap_values(ScatterInternals& data, unsigned first, unsigned count, const F& position)
+{
+	float* values = new float[count];
+
+	ThreadPool::parallelFor(count, LOADER_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		switch (data.desc.colormap_scalar)
+		{
+		case COLORMAP_SCALAR_HEIGHT:
+			for (unsigned i = begin; i < end; i++)
+				values[i] = position(first + i).z;
+			break;
+
+		case COLORMAP_SCALAR_RADIUS:
+			for (unsigned i = begin; i < end; i++)
+				values[i] = position(first + i).abs();
+			break;
+
+		default:
+			for (unsigned i = begin; i < end; i++)
+				values[i] = data.desc.value_list[first + i];
+			break;
+		}
+	});
+
+	Vector2f& range = data.desc.colormap_range;
+	if (range.x == range.y)
+		Colormap::findRange(values, count, &range.x, &range.y);
+
+	return values;
+}
+
+// Colors a range of updated points again if the Scatter is colored by a colormap of their
+// positions. Colors mapped from the value list do not change with the positions.
+
+static void recolor_points(ScatterInternals& data, unsigned first, unsigned count)
+{
+	if (data.desc.coloring != SCATTER_DESC::COLORMAP_COLORING || data.desc.colormap_scalar == COLORMAP_SCALAR_PARAMETER)
+		return;
+
+	float* values = colormap_values(data, first, count, [&](unsigned i) { return Vector3f(data.ColPoints[i].position); });
+	const Vector2f range = data.desc.colormap_range;
+
+	ThreadPool::parallelFor(count, LOADER_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		data.colormap.map(values + begin, &data.ColPoints[first + begin].color, end - begin, range.x, range.y, sizeof(ScatterInternals::ColPoint));
+	});
+
+	delete[] values;
+}
+
 /*
 -----------------------------------------------------------------------------------------------------------
  Constructors / Destructors
@@ -70,7 +1157,27 @@ Scatter::~Scatter()
 	if (!isInit)
 		return;
 
-	ScatterInternals& data = *(ScatterInternals*)scatterData;
+	ScatterInternals& data = *(ScatterInternals*)scatterData;
+
+	// Give the full level back to the bind list and delete the rest.
+	if (data.lod_levels)
+	{
+		if (data.current_lod)
+		{
+			changeBind(data.pIndexBuffer, SCATTER_IB_BIND, false);
+			changeBind(data.pUpdateVB, SCATTER_VB_BIND, false);
+		}
+
+		for (unsigned l = 1u; l < data.n_lod_levels; l++)
+		{
+			delete data.lod_levels[l].pVB;
+			delete data.lod_levels[l].pIB;
+		}
+		delete[] data.lod_levels;
+	}
+
+	if (data.pIndex)
+		delete data.pIndex;
 
 	if (data.Points)
 		delete[] data.Points;
@@ -115,16 +1222,69 @@ void Scatter::initialize(const SCATTER_DESC* pDesc)
 		"If you want to set the Scatter to line-mesh the number of points must be divisible by two."
 	);
 
+	USER_CHECK(!data.desc.enable_lod || (!data.desc.enable_updates && !data.desc.line_mesh),
+		"Found level of detail enabled on a Scatter with updates or line-mesh enabled.\n"
+		"Downsampled levels are built once at initialization and are made of single points."
+	);
+
+	USER_CHECK(!data.desc.enable_lod || data.desc.lod_pixel_size > 0.f,
+		"Found a non positive level of detail pixel size when trying to create a Scatter."
+	);
+
+	// The index buffer goes first so that its bind position is known.
+	unsigned* indexs = new unsigned[data.desc.point_count];
+	for (unsigned i = 0; i < data.desc.point_count; i++)
+		indexs[i] = i;
+
+	data.pIndexBuffer = AddBind(new IndexBuffer(indexs, data.desc.point_count));
+	delete[] indexs;
+
+	// Colormapped points are point colored with the list of colors mapped from their values,
+	// that is only kept until the levels of detail are built.
+	Color* colormap_colors = nullptr;
+	if (data.desc.coloring == SCATTER_DESC::COLORMAP_COLORING)
+	{
+		USER_CHECK(data.desc.colormap_scalar != COLORMAP_SCALAR_PARAMETER_V,
+			"Found the second parameter as the colormap scalar when trying to create a Scatter.\n"
+			"Scatters only have one parameter, the value list, use COLORMAP_SCALAR_PARAMETER instead."
+		);
+
+		USER_CHECK(data.desc.colormap_scalar != COLORMAP_SCALAR_PARAMETER || data.desc.value_list,
+			"Found nullptr when trying to access a value list to color a Scatter with a colormap."
+		);
+
+		if (data.desc.custom_colormap)
+			data.colormap = *data.desc.custom_colormap;
+		else
+			data.colormap.generate(data.desc.colormap);
+
+		float* values = colormap_values(data, 0u, data.desc.point_count, [&](unsigned i) { return data.desc.point_list[i]; });
+		const Vector2f range = data.desc.colormap_range;
+
+		colormap_colors = new Color[data.desc.point_count];
+		ThreadPool::parallelFor(data.desc.point_count, LOADER_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+		{
+			data.colormap.map(values + begin, colormap_colors + begin, end - begin, range.x, range.y);
+		});
+
+		delete[] values;
+		data.desc.color_list = colormap_colors;
+	}
+
 	switch (data.desc.coloring)
 	{
 	case SCATTER_DESC::GLOBAL_COLORING:
 	{
 		data.Points = new _float4vector[data.desc.point_count];
 
-		for (unsigned n = 0u; n < data.desc.point_count; n++)
-			data.Points[n] = data.desc.point_list[n].getVector4();
+		// Loaded clouds can have millions of points, convert them in parallel.
+		ThreadPool::parallelFor(data.desc.point_count, LOADER_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+		{
+			for (unsigned n = begin; n < end; n++)
+				data.Points[n] = data.desc.point_list[n].getVector4();
+		});
 
-		data.pUpdateVB = AddBind(new VertexBuffer(data.Points, data.desc.point_count, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
+		data.pUpdateVB = AddBind(new VertexBuffer(data.Points, data.desc.point_count, data.desc.enable_updates ? VB_USAGE_PARTIAL : VB_USAGE_DEFAULT));
 
 		// If updates disabled delete the Points
 		if (!data.desc.enable_updates)
@@ -184,6 +1344,7 @@ void Scatter::initialize(const SCATTER_DESC* pDesc)
 	}
 
 	case SCATTER_DESC::POINT_COLORING:
+	case SCATTER_DESC::COLORMAP_COLORING:
 	{
 		USER_CHECK(data.desc.color_list,
 			"Found nullptr when trying to access a color list to create a Scatter."
@@ -191,13 +1352,16 @@ void Scatter::initialize(const SCATTER_DESC* pDesc)
 
 		data.ColPoints = new ScatterInternals::ColPoint[data.desc.point_count];
 
-		for (unsigned n = 0u; n < data.desc.point_count; n++)
+		ThreadPool::parallelFor(data.desc.point_count, LOADER_CHUNK, [&](unsigned begin, unsigned end, unsigned)
 		{
-			data.ColPoints[n].position = data.desc.point_list[n].getVector4();
-			data.ColPoints[n].color = data.desc.color_list[n].getColor4();
-		}
+			for (unsigned n = begin; n < end; n++)
+			{
+				data.ColPoints[n].position = data.desc.point_list[n].getVector4();
+				data.ColPoints[n].color = data.desc.color_list[n].getColor4();
+			}
+		});
 
-		data.pUpdateVB = AddBind(new VertexBuffer(data.ColPoints, data.desc.point_count, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
+		data.pUpdateVB = AddBind(new VertexBuffer(data.ColPoints, data.desc.point_count, data.desc.enable_updates ? VB_USAGE_PARTIAL : VB_USAGE_DEFAULT));
 
 		// If updates disabled delete the points
 		if (!data.desc.enable_updates)
@@ -258,12 +1422,17 @@ void Scatter::initialize(const SCATTER_DESC* pDesc)
 		USER_ERROR("Found an unrecognized coloring mode when trying to create a Scatter.");
 	}
 
-	unsigned* indexs = new unsigned[data.desc.point_count];
-	for (unsigned i = 0; i < data.desc.point_count; i++)
-		indexs[i] = i;
+	if (data.desc.enable_lod)
+		build_lod_levels(data);
 
-	AddBind(new IndexBuffer(indexs, data.desc.point_count));
-	delete[] indexs;
+	if (colormap_colors)
+	{
+		delete[] colormap_colors;
+		data.desc.color_list = nullptr;
+	}
+
+	if (data.desc.enable_spatial_index)
+		data.pIndex = build_spatial_index(data.desc.point_list, data.desc.point_count);
 
 	AddBind(new Topology(data.desc.line_mesh ? LINE_LIST : POINT_LIST));
 	AddBind(new Rasterizer());
@@ -277,6 +1446,53 @@ void Scatter::initialize(const SCATTER_DESC* pDesc)
 -----------------------------------------------------------------------------------------------------------
 */
 
+// Draw override, sends the pending point and color updates to the GPU and 
+// then issues the draw call. Updates are coalesced and uploaded only here.
+
+void Scatter::Draw()
+{
+	USER_CHECK(isInit,
+		"Trying to draw an uninitialized Scatter."
+	);
+
+	ScatterInternals& data = *(ScatterInternals*)scatterData;
+
+	if (data.desc.enable_updates)
+	{
+		if (data.desc.coloring == SCATTER_DESC::GLOBAL_COLORING)
+			data.pUpdateVB->uploadDirtyRanges(data.Points);
+		else
+			data.pUpdateVB->uploadDirtyRanges(data.ColPoints);
+	}
+
+	if (data.n_lod_levels > 1u)
+	{
+		// Size of the voxels allowed in object space. A unit of distance spans half the render
+		// target scale in pixels, and the distortion can stretch voxels up to its largest column.
+		const Matrix& D = data.distortion;
+		float stretch = Vector3f(D.a00, D.a10, D.a20).abs();
+		float column = Vector3f(D.a01, D.a11, D.a21).abs();
+		if (column > stretch) stretch = column;
+		column = Vector3f(D.a02, D.a12, D.a22).abs();
+		if (column > stretch) stretch = column;
+
+		float max_size = 2.f * data.desc.lod_pixel_size / (currentTarget()->getScale() * stretch);
+
+		unsigned level = 0u;
+		while (level + 1u < data.n_lod_levels && data.lod_levels[level + 1u].voxel_size <= max_size)
+			level++;
+
+		if (level != data.current_lod)
+		{
+			changeBind(data.lod_levels[level].pIB, SCATTER_IB_BIND, false);
+			changeBind(data.lod_levels[level].pVB, SCATTER_VB_BIND, false);
+			data.current_lod = level;
+		}
+	}
+
+	_draw();
+}
+
 // If updates are enabled this function allows to change the position of the points.
 // It expects a valid pointer to a 3D vector list as long as the point count, it will 
 // copy the position data and send it to the GPU for drawing.
@@ -303,16 +1519,110 @@ void Scatter::updatePoints(Vector3f* point_list)
 		for (unsigned i = 0u; i < data.desc.point_count; i++)
 			data.Points[i] = point_list[i].getVector4();
 
-		data.pUpdateVB->updateVertices(data.Points, data.desc.point_count);
+		data.pUpdateVB->markDirtyRange(0u, data.desc.point_count);
 		break;
 
 	case SCATTER_DESC::POINT_COLORING:
+	case SCATTER_DESC::COLORMAP_COLORING:
 		for (unsigned i = 0u; i < data.desc.point_count; i++)
 			data.ColPoints[i].position = point_list[i].getVector4();
 
-		data.pUpdateVB->updateVertices(data.ColPoints, data.desc.point_count);
+		data.pUpdateVB->markDirtyRange(0u, data.desc.point_count);
+		break;
+	}
+
+	recolor_points(data, 0u, data.desc.point_count);
+	update_spatial_index(data, 0u, data.desc.point_count);
+}
+
+// If updates are enabled this function allows to change the position of a range of 
+// points, starting at the first point specified. It expects a valid pointer to a list 
+// of 3D vectors as long as the count. Only the modified ranges are sent to the GPU.
+
+void Scatter::updatePoints(const Vector3f* point_list, unsigned first, unsigned count)
+{
+	USER_CHECK(isInit,
+		"Trying to update the points on an uninitialized Scatter."
+	);
+
+	USER_CHECK(point_list,
+		"Trying to update the points on a Scatter with an invalid point list."
+	);
+
+	ScatterInternals& data = *(ScatterInternals*)scatterData;
+
+	USER_CHECK(data.desc.enable_updates,
+		"Trying to update the points on a Scatter with updates disabled."
+	);
+
+	USER_CHECK(first <= data.desc.point_count && count <= data.desc.point_count - first,
+		"Trying to update a range of points that exceeds the point count of the Scatter."
+	);
+
+	switch (data.desc.coloring)
+	{
+	case SCATTER_DESC::GLOBAL_COLORING:
+		for (unsigned i = 0u; i < count; i++)
+			data.Points[first + i] = point_list[i].getVector4();
+		break;
+
+	case SCATTER_DESC::POINT_COLORING:
+	case SCATTER_DESC::COLORMAP_COLORING:
+		for (unsigned i = 0u; i < count; i++)
+			data.ColPoints[first + i].position = point_list[i].getVector4();
 		break;
 	}
+
+	recolor_points(data, first, count);
+	data.pUpdateVB->markDirtyRange(first, count);
+	update_spatial_index(data, first, count);
+}
+
+// If updates are enabled this function allows to change the position of a range of points
+// from three separate coordinate lists, as stored by structure of arrays simulations. Each
+// list must be as long as the count. Used by the ParticleSystem class for its uploads.
+
+void Scatter::updatePoints(const float* x_list, const float* y_list, const float* z_list, unsigned first, unsigned count)
+{
+	USER_CHECK(isInit,
+		"Trying to update the points on an uninitialized Scatter."
+	);
+
+	USER_CHECK(x_list && y_list && z_list,
+		"Trying to update the points on a Scatter with an invalid coordinate list."
+	);
+
+	ScatterInternals& data = *(ScatterInternals*)scatterData;
+
+	USER_CHECK(data.desc.enable_updates,
+		"Trying to update the points on a Scatter with updates disabled."
+	);
+
+	USER_CHECK(first <= data.desc.point_count && count <= data.desc.point_count - first,
+		"Trying to update a range of points that exceeds the point count of the Scatter."
+	);
+
+	// Interleaving millions of points is memory bound, split it across threads.
+	ThreadPool::parallelFor(count, 16384u, [&](unsigned begin, unsigned end, unsigned)
+	{
+		switch (data.desc.coloring)
+		{
+		case SCATTER_DESC::GLOBAL_COLORING:
+			for (unsigned i = begin; i < end; i++)
+				data.Points[first + i] = { x_list[i], y_list[i], z_list[i], 1.f };
+			break;
+
+		case SCATTER_DESC::POINT_COLORING:
+		case SCATTER_DESC::COLORMAP_COLORING:
+			for (unsigned i = begin; i < end; i++)
+				data.ColPoints[first + i].position = { x_list[i], y_list[i], z_list[i], 1.f };
+			break;
+		}
+	});
+
+	recolor_points(data, first, count);
+	data.pUpdateVB->markDirtyRange(first, count);
+	update_spatial_index(data, first, count);
 }
 
 // If updates are enabled, and coloring is with a list, this function allows to change 
@@ -342,7 +1652,41 @@ void Scatter::updateColors(Color* color_list)
 	for (unsigned i = 0u; i < data.desc.point_count; i++)
 		data.ColPoints[i].color = color_list[i].getColor4();
 
-	data.pUpdateVB->updateVertices(data.ColPoints, data.desc.point_count);
+	data.pUpdateVB->markDirtyRange(0u, data.desc.point_count);
+}
+
+// If updates are enabled, and coloring is with a list, this function allows to change 
+// the colors of a range of points, starting at the first point specified. It expects a
+// valid pointer to a list of colors as long as the count.
+
+void Scatter::updateColors(const Color* color_list, unsigned first, unsigned count)
+{
+	USER_CHECK(isInit,
+		"Trying to update the colors on an uninitialized Scatter."
+	);
+
+	USER_CHECK(color_list,
+		"Trying to update the colors on a Scatter with an invalid color list."
+	);
+
+	ScatterInternals& data = *(ScatterInternals*)scatterData;
+
+	USER_CHECK(data.desc.coloring == SCATTER_DESC::POINT_COLORING,
+		"Trying to update the colors on a Scatter with a different coloring."
+	);
+
+	USER_CHECK(data.desc.enable_updates,
+		"Trying to update the colors on a Scatter with updates disabled."
+	);
+
+	USER_CHECK(first <= data.desc.point_count && count <= data.desc.point_count - first,
+		"Trying to update a range of colors that exceeds the point count of the Scatter."
+	);
+
+	for (unsigned i = 0u; i < count; i++)
+		data.ColPoints[first + i].color = color_list[i].getColor4();
+
+	data.pUpdateVB->markDirtyRange(first, count);
 }
 
 // If the coloring is set to global, updates the global Scatter color.
@@ -457,6 +1801,306 @@ void Scatter::updateScreenPosition(Vector2f screenDisplacement)
 	data.pVSCB->update(&data.vscBuff);
 }
 
+// If the spatial index is enabled rebuilds it from the current point positions. Refits after
+// updates keep the original tree, so after big changes in the cloud a rebuild makes queries faster.
+
+void Scatter::rebuildSpatialIndex()
+{
+	USER_CHECK(isInit,
+		"Trying to rebuild the spatial index of an uninitialized Scatter."
+	);
+
+	ScatterInternals& data = *(ScatterInternals*)scatterData;
+
+	USER_CHECK(data.pIndex,
+		"Trying to rebuild the spatial index of a Scatter without spatial index enabled."
+	);
+
+	// Recover the current positions in the original order.
+	Vector3f* points = new Vector3f[data.desc.point_count];
+	SpatialIndex& index = *data.pIndex;
+	for (unsigned s = 0u; s < index.count; s++)
+		points[index.order[s]] = index.points[s];
+
+	delete data.pIndex;
+	data.pIndex = build_spatial_index(points, data.desc.point_count);
+	delete[] points;
+}
+
+// If the spatial index is enabled, finds the points whose distance to the line defined by the ray
+// is smaller than the radius, and writes to the index the one found first along the direction. 
+// Returns false if no point is found. Coordinates are in scene space, the Scatter rotation, 
+// distortion and position are taken into account. Points behind the origin are also considered,
+// since orthographic views see the whole line, use Graphics::getPixelRay() for mouse picking.
+
+bool Scatter::pickPoint(Vector3f ray_origin, Vector3f ray_direction, float radius, unsigned* index) const
+{
+	USER_CHECK(isInit,
+		"Trying to pick a point on an uninitialized Scatter."
+	);
+
+	ScatterInternals& data = *(ScatterInternals*)scatterData;
+
+	USER_CHECK(data.pIndex,
+		"Trying to pick a point on a Scatter without spatial index enabled."
+	);
+
+	USER_CHECK(index,
+		"Found nullptr when trying to write the picked point of a Scatter."
+	);
+
+	USER_CHECK((ray_direction ^ ray_direction) > 0.f,
+		"Found a zero ray direction when trying to pick a point on a Scatter."
+	);
+
+	SpatialIndex& tree = *data.pIndex;
+	if (tree.stale)
+		refit_all(tree);
+
+	// The line is traversed in object space, where the line parameter stays the same.
+	Matrix L = data.rotation.getMatrix() * data.distortion;
+	Matrix L_inv = L.inverse();
+
+	Vector3f o = L_inv * (ray_origin - data.position);
+	Vector3f d = L_inv * ray_direction;
+
+	const float direction2 = ray_direction ^ ray_direction;
+	const float radius2 = radius * radius;
+
+	// A box grown by the object space radius contains every candidate, and candidates found
+	// inside a box can be earlier along the ray than the box entry at most by the slack.
+	const float margin = radius * max_stretch(L_inv);
+	const float slack = max_stretch(L) * margin / sqrtf(direction2);
+
+	float best_t = FLT_MAX;
+	bool found = false;
+
+	struct { unsigned node; float t; } stack[INDEX_STACK_SIZE];
+	unsigned top = 0u;
+
+	float t_root;
+	if (line_box(tree.nodes[0], margin, o, d, &t_root))
+		stack[top++] = { 0u, t_root };
+
+	while (top)
+	{
+		auto entry = stack[--top];
+		if (entry.t - slack > best_t)
+			continue;
+
+		unsigned node = entry.node;
+
+		// Leaf, test the points in scene space.
+		if (node >= tree.n_leaves - 1u)
+		{
+			unsigned leaf = node - (tree.n_leaves - 1u);
+			for (unsigned s = tree.leafBegin(leaf); s < tree.leafBegin(leaf + 1u); s++)
+			{
+				Vector3f relative = L * tree.points[s] + data.position - ray_origin;
+				float t = (relative ^ ray_direction) / direction2;
+				Vector3f perpendicular = relative - ray_direction * t;
+
+				if ((perpendicular ^ perpendicular) <= radius2 && t < best_t)
+				{
+					best_t = t;
+					*index = tree.order[s];
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		// Push the farthest child first so the closest one is visited first.
+		float t_a, t_b;
+		bool hit_a = line_box(tree.nodes[2u * node + 1u], margin, o, d, &t_a);
+		bool hit_b = line_box(tree.nodes[2u * node + 2u], margin, o, d, &t_b);
+
+		if (hit_a && hit_b && t_a < t_b)
+		{
+			stack[top++] = { 2u * node + 2u, t_b };
+			stack[top++] = { 2u * node + 1u, t_a };
+		}
+		else
+		{
+			if (hit_a) stack[top++] = { 2u * node + 1u, t_a };
+			if (hit_b) stack[top++] = { 2u * node + 2u, t_b };
+		}
+	}
+
+	return found;
+}
+
+// If the spatial index is enabled, finds all the points within the radius of the center and
+// writes their indices to the list, up to the maximum count specified. Returns the number of 
+// points found, that can be bigger than the maximum. Coordinates are in scene space.
+
+unsigned Scatter::queryRadius(Vector3f center, float radius, unsigned* index_list, unsigned max_count) const
+{
+	USER_CHECK(isInit,
+		"Trying to query points on an uninitialized Scatter."
+	);
+
+	ScatterInternals& data = *(ScatterInternals*)scatterData;
+
+	USER_CHECK(data.pIndex,
+		"Trying to query points on a Scatter without spatial index enabled."
+	);
+
+	USER_CHECK(index_list || !max_count,
+		"Found nullptr when trying to write the queried points of a Scatter."
+	);
+
+	SpatialIndex& tree = *data.pIndex;
+	if (tree.stale)
+		refit_all(tree);
+
+	Matrix L = data.rotation.getMatrix() * data.distortion;
+	Matrix L_inv = L.inverse();
+
+	// The sphere fits inside a sphere of the object space radius around the center.
+	Vector3f c = L_inv * (center - data.position);
+	const float object_radius = radius * max_stretch(L_inv);
+	const float object_radius2 = object_radius * object_radius;
+	const float radius2 = radius * radius;
+
+	unsigned found = 0u;
+	unsigned stack[INDEX_STACK_SIZE];
+	unsigned top = 0u;
+	stack[top++] = 0u;
+
+	while (top)
+	{
+		unsigned node = stack[--top];
+		if (box_distance2(tree.nodes[node], c) > object_radius2)
+			continue;
+
+		if (node < tree.n_leaves - 1u)
+		{
+			stack[top++] = 2u * node + 1u;
+			stack[top++] = 2u * node + 2u;
+			continue;
+		}
+
+		unsigned leaf = node - (tree.n_leaves - 1u);
+		for (unsigned s = tree.leafBegin(leaf); s < tree.leafBegin(leaf + 1u); s++)
+		{
+			Vector3f relative = L * tree.points[s] + data.position - center;
+			if ((relative ^ relative) <= radius2)
+			{
+				if (found < max_count)
+					index_list[found] = tree.order[s];
+				found++;
+			}
+		}
+	}
+
+	return found;
+}
+
+// If the spatial index is enabled, finds the k points closest to the point specified and 
+// writes their indices to the list sorted by distance, and optionally their distances. 
+// Returns the number of points written, k or the point count if smaller. Coordinates are in
+// scene space, the Scatter rotation, distortion and position are taken into account.
+
+unsigned Scatter::queryNearest(Vector3f point, unsigned k, unsigned* index_list, float* distance_list) const
+{
+	USER_CHECK(isInit,
+		"Trying to query points on an uninitialized Scatter."
+	);
+
+	ScatterInternals& data = *(ScatterInternals*)scatterData;
+
+	USER_CHECK(data.pIndex,
+		"Trying to query points on a Scatter without spatial index enabled."
+	);
+
+	USER_CHECK(index_list,
+		"Found nullptr when trying to write the queried points of a Scatter."
+	);
+
+	SpatialIndex& tree = *data.pIndex;
+	if (tree.stale)
+		refit_all(tree);
+
+	if (k > tree.count)
+		k = tree.count;
+
+	if (!k)
+		return 0u;
+
+	Matrix L = data.rotation.getMatrix() * data.distortion;
+	Matrix L_inv = L.inverse();
+
+	// Scene distances are at least the object space distances over the inverse stretch.
+	Vector3f p = L_inv * (point - data.position);
+	const float shrink = max_stretch(L_inv);
+	const float shrink2 = shrink * shrink;
+
+	// Best candidates sorted by squared distance.
+	float* best = new float[k];
+	unsigned n_best = 0u;
+
+	struct { unsigned node; float bound2; } stack[INDEX_STACK_SIZE];
+	unsigned top = 0u;
+	stack[top++] = { 0u, box_distance2(tree.nodes[0], p) / shrink2 };
+
+	while (top)
+	{
+		auto entry = stack[--top];
+		if (n_best == k && entry.bound2 > best[k - 1u])
+			continue;
+
+		unsigned node = entry.node;
+
+		if (node >= tree.n_leaves - 1u)
+		{
+			unsigned leaf = node - (tree.n_leaves - 1u);
+			for (unsigned s = tree.leafBegin(leaf); s < tree.leafBegin(leaf + 1u); s++)
+			{
+				Vector3f relative = L * tree.points[s] + data.position - point;
+				float distance2 = relative ^ relative;
+
+				if (n_best == k && distance2 >= best[k - 1u])
+					continue;
+
+				// Insertion into the sorted candidates.
+				unsigned pos = n_best < k ? n_best++ : k - 1u;
+				while (pos && best[pos - 1u] > distance2)
+				{
+					best[pos] = best[pos - 1u];
+					index_list[pos] = index_list[pos - 1u];
+					pos--;
+				}
+				best[pos] = distance2;
+				index_list[pos] = tree.order[s];
+			}
+			continue;
+		}
+
+		// Push the farthest child first so the closest one is visited first.
+		float bound_a = box_distance2(tree.nodes[2u * node + 1u], p) / shrink2;
+		float bound_b = box_distance2(tree.nodes[2u * node + 2u], p) / shrink2;
+
+		if (bound_a < bound_b)
+		{
+			stack[top++] = { 2u * node + 2u, bound_b };
+			stack[top++] = { 2u * node + 1u, bound_a };
+		}
+		else
+		{
+			stack[top++] = { 2u * node + 1u, bound_a };
+			stack[top++] = { 2u * node + 2u, bound_b };
+		}
+	}
+
+	if (distance_list)
+		for (unsigned i = 0u; i < n_best; i++)
+			distance_list[i] = sqrtf(best[i]);
+
+	delete[] best;
+	return n_best;
+}
+
 /*
 -----------------------------------------------------------------------------------------------------------
  Getters
@@ -514,3 +2158,20 @@ Vector2f Scatter::getScreenPosition() const
 
 	return { data.vscBuff.displacement.x, data.vscBuff.displacement.y };
 }
+
+// If level of detail is enabled returns the number of points drawn by the last Draw()
+// call, otherwise returns the point count. Useful to check the level chosen.
+
+unsigned Scatter::getDrawnPointCount() const
+{
+	USER_CHECK(isInit,
+		"Trying to get the drawn point count of an uninitialized Scatter."
+	);
+
+	ScatterInternals& data = *(ScatterInternals*)scatterData;
+
+	if (data.lod_levels)
+		return data.lod_levels[data.current_lod].count;
+
+	return data.desc.point_count;
+}
@@ -2,6 +2,12 @@
 #include "Bindable/BindableBase.h"
 
 #include "Error/_erDefault.h"
+#include "ThreadPool.h"
+#include "MeshOptimizer.h"
+#include "MeshBVH.h"
+
+#include <cstring> // For mesh export
+#include <type_traits> // For mesh export
 
 #ifdef _DEPLOYMENT
 #include "embedded_resources.h"
@@ -85,9 +91,204 @@ struct SurfaceInternals
 	VertexBuffer* pUpdateVB = nullptr;
 	Texture* pUpdateTexture = nullptr;
 
+	// If mesh export or picking is enabled, copy of the last generated triangle mesh.
+	Vector3f* export_vertices = nullptr;
+	Vector3f* export_normals = nullptr;
+	Color* export_colors = nullptr;
+	unsigned export_vertex_count = 0u;
+	unsigned* export_indices = nullptr;
+	unsigned export_index_count = 0u;
+
+	// If picking is enabled, hierarchy built over the copy, and whether it has to be refitted
+	// or rebuilt before the next query because the positions or the triangles changed.
+	MeshBVH* bvh = nullptr;
+	bool bvh_outdated = false;
+	bool bvh_rebuild = false;
+
+	// If coloring is a colormap, copy of the colormap used.
+	Colormap colormap;
+
 	SURFACE_DESC desc = {};
 };
 
+/*
+-----------------------------------------------------------------------------------------------------------
+ Mesh Export Helpers
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Number of vertices copied per parallel chunk.
+#define EXPORT_CHUNK 65536u
+
+// If mesh export or picking is enabled stores a copy of the vertices sent to the GPU, colors
+// are only stored for the color vertices, the texture coordinates are not exported.
+
+template<typename V>
+static void store_export_vertices(SurfaceInternals& data, const V* vertices, unsigned count)
+{
+	constexpr bool has_colors = std::is_same_v<V, SurfaceInternals::ColorVertex>;
+
+	if (!data.desc.enable_mesh_export && !data.desc.enable_picking)
+		return;
+
+	// A new vertex array invalidates the positions referenced by the hierarchy.
+	data.bvh_outdated = true;
+	if (data.export_vertex_count != count)
+		data.bvh_rebuild = true;
+
+	if (data.export_vertex_count != count || (has_colors && !data.export_colors))
+	{
+		if (data.export_vertices)
+			delete[] data.export_vertices;
+
+		if (data.export_normals)
+			delete[] data.export_normals;
+
+		if (data.export_colors)
+			delete[] data.export_colors;
+
+		data.export_vertices = new Vector3f[count];
+		data.export_normals = new Vector3f[count];
+		data.export_colors = has_colors ? new Color[count] : nullptr;
+		data.export_vertex_count = count;
+	}
+
+	ThreadPool::parallelFor(count, EXPORT_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = begin; i < end; i++)
+		{
+			data.export_vertices[i] = Vector3f(vertices[i].vector);
+			data.export_normals[i] = Vector3f(vertices[i].norm);
+
+			if constexpr (has_colors)
+				data.export_colors[i] = Color(vertices[i].color);
+		}
+	});
+}
+
+// If mesh export or picking is enabled stores a copy of the triangle indices sent to the GPU.
+
+static void store_export_indices(SurfaceInternals& data, const unsigned* indices, unsigned count)
+{
+	if (!data.desc.enable_mesh_export && !data.desc.enable_picking)
+		return;
+
+	data.bvh_rebuild = true;
+
+	if (data.export_index_count != count)
+	{
+		if (data.export_indices)
+			delete[] data.export_indices;
+
+		data.export_indices = new unsigned[count];
+		data.export_index_count = count;
+	}
+
+	memcpy(data.export_indices, indices, count * sizeof(unsigned));
+}
+
+// Returns the hierarchy of a Surface with picking enabled, building it if the triangles
+// changed since the last query, or refitting it if only the positions did.
+
+static const MeshBVH& picking_bvh(SurfaceInternals& data)
+{
+	if (!data.bvh)
+		data.bvh = new MeshBVH;
+
+	if (data.bvh_rebuild || !data.bvh->isBuilt())
+		data.bvh->build(data.export_vertices, data.export_indices, data.export_index_count / 3u);
+	else if (data.bvh_outdated)
+		data.bvh->refit(data.export_vertices);
+
+	data.bvh_rebuild = false;
+	data.bvh_outdated = false;
+	return *data.bvh;
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Texture Helpers
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Creates the Surface texture from the descriptor image, or its view if there is no image,
+// with its full mip chain if mipmaps are enabled on the descriptor. If both are empty the
+// compressed image is uploaded as it is.
+
+static Texture* create_texture(const SURFACE_DESC& desc, TEXTURE_TYPE type)
+{
+	const ImageView image = desc.texture_image ? ImageView(*desc.texture_image) : desc.texture_view;
+
+	if (!image.pixels())
+	{
+		USER_CHECK(desc.texture_compressed->isCubemap() == (type == TEXTURE_TYPE_CUBEMAP),
+			"Found a compressed image of the wrong type when trying to create a texture for a textured Surface.\n"
+			"Spherical surfaces expect a compressed cube-map, and the other types a regular image."
+		);
+
+		return new Texture(desc.texture_compressed);
+	}
+
+	const TEXTURE_USAGE usage = desc.enable_updates ? TEXTURE_USAGE_DYNAMIC : TEXTURE_USAGE_DEFAULT;
+
+	if (!desc.texture_mipmaps)
+		return new Texture(image, usage, type);
+
+	MipChain chain(image, desc.mipmap_filter, type == TEXTURE_TYPE_CUBEMAP);
+	return new Texture(&chain, usage, type);
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Colormap Helpers
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Colors the vertices of a colormapped Surface with the scalar of the descriptor, all at once.
+// Grid surfaces store their vertices by columns, with coordinates starting at u_i and v_i with
+// increments of du and dv. If the colormap range of the descriptor is empty it is set to the 
+// range of the first values, and kept for the updates.
+
+static void colormap_vertices(SurfaceInternals& data, unsigned count, float u_i, float du, float v_i, float dv)
+{
+	SurfaceInternals::ColorVertex* vertices = data.ColVertices;
+	const unsigned num_v = data.desc.num_v;
+
+	float* values = new float[count];
+	switch (data.desc.colormap_scalar)
+	{
+	case COLORMAP_SCALAR_HEIGHT:
+		for (unsigned i = 0u; i < count; i++)
+			values[i] = vertices[i].vector.z;
+		break;
+
+	case COLORMAP_SCALAR_RADIUS:
+		for (unsigned i = 0u; i < count; i++)
+			values[i] = Vector3f(vertices[i].vector).abs();
+		break;
+
+	case COLORMAP_SCALAR_PARAMETER:
+		for (unsigned i = 0u; i < count; i++)
+			values[i] = u_i + (i / num_v) * du;
+		break;
+
+	case COLORMAP_SCALAR_PARAMETER_V:
+		for (unsigned i = 0u; i < count; i++)
+			values[i] = v_i + (i % num_v) * dv;
+		break;
+
+	default:
+		USER_ERROR("Unknown colormap scalar found when trying to color a Surface.");
+	}
+
+	Vector2f& range = data.desc.colormap_range;
+	if (range.x == range.y)
+		Colormap::findRange(values, count, &range.x, &range.y);
+
+	data.colormap.map(values, &vertices[0].color, count, range.x, range.y, sizeof(SurfaceInternals::ColorVertex));
+	delete[] values;
+}
+
 /*
 -----------------------------------------------------------------------------------------------------------
  Constructors / Destructors
@@ -129,6 +330,21 @@ Surface::~Surface()
 	if (data.spherical_vertices)
 		delete[] data.spherical_vertices;
 
+	if (data.export_vertices)
+		delete[] data.export_vertices;
+
+	if (data.export_normals)
+		delete[] data.export_normals;
+
+	if (data.export_colors)
+		delete[] data.export_colors;
+
+	if (data.export_indices)
+		delete[] data.export_indices;
+
+	if (data.bvh)
+		delete data.bvh;
+
 	delete& data;
 }
 
@@ -170,6 +386,21 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 		"At least two vertices in each dimension are needed to generate a grid."
 	);
 
+	USER_CHECK(data.desc.coloring != SURFACE_DESC::COLORMAP_COLORING || data.desc.type == SURFACE_DESC::EXPLICIT_SURFACE || data.desc.type == SURFACE_DESC::PARAMETRIC_SURFACE ||
+		(data.desc.colormap_scalar != COLORMAP_SCALAR_PARAMETER && data.desc.colormap_scalar != COLORMAP_SCALAR_PARAMETER_V),
+		"Found a parameter as the colormap scalar when trying to initialize a spherical or implicit Surface.\n"
+		"Since these surfaces are not generated from a grid they can only be colored by their height or radius."
+	);
+
+	// Colormaps are copied, the custom one or the built in one.
+	if (data.desc.coloring == SURFACE_DESC::COLORMAP_COLORING)
+	{
+		if (data.desc.custom_colormap)
+			data.colormap = *data.desc.custom_colormap;
+		else
+			data.colormap.generate(data.desc.colormap);
+	}
+
 	// Calculate initial values and deltas of both coordinates.
 
 	float du = data.desc.border_points_included ?
@@ -312,6 +543,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.Vertices, data.desc.num_u * data.desc.num_v);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.Vertices, data.desc.num_u * data.desc.num_v, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
 
@@ -361,12 +595,12 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 
 				case SURFACE_DESC::TEXTURED_COLORING:
 				{
-					USER_CHECK(data.desc.texture_image,
+					USER_CHECK(data.desc.texture_image || data.desc.texture_view.pixels() || data.desc.texture_compressed,
 						"Found nullptr when trying to acces an image to create a texture for a textured Surface."
 					);
 
-					// Create the texture from the input image.
-					data.pUpdateTexture = AddBind(new Texture(data.desc.texture_image, data.desc.enable_updates ? TEXTURE_USAGE_DYNAMIC : TEXTURE_USAGE_DEFAULT));
+					// Create the texture from the input image, or the view if there is no image, and its mip chain if enabled.
+					data.pUpdateTexture = AddBind(create_texture(data.desc, TEXTURE_TYPE_IMAGE));
 
 					// Create the sampler for the texture.
 					AddBind(new Sampler(data.desc.pixelated_texture ? SAMPLE_FILTER_POINT : SAMPLE_FILTER_LINEAR, SAMPLE_ADDRESS_CLAMP));
@@ -489,6 +723,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.TexVertices, data.desc.num_u * data.desc.num_v);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.TexVertices, data.desc.num_u * data.desc.num_v, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
 
@@ -661,6 +898,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.ColVertices, data.desc.num_u * data.desc.num_v);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, data.desc.num_u * data.desc.num_v, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
 
@@ -833,6 +1073,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.ColVertices, data.desc.num_u * data.desc.num_v);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, data.desc.num_u * data.desc.num_v, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
 
@@ -882,8 +1125,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 				}
 
 				case SURFACE_DESC::OUTPUT_FUNCTION_COLORING:
+				case SURFACE_DESC::COLORMAP_COLORING:
 				{
-					USER_CHECK(data.desc.output_color_func,
+					USER_CHECK(data.desc.coloring == SURFACE_DESC::COLORMAP_COLORING || data.desc.output_color_func,
 						"Found nullptr when trying to acces a color function to color an output function colored Surface."
 					);
 
@@ -904,11 +1148,16 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 							// Assign a value for each point of the function.
 							col[m].vector = _float4vector{ x, y, z, 0.f };
 
-							// Assign a color to the vertex given the output coordinates.
-							col[m].color = data.desc.output_color_func(x, y, z).getColor4();
+							// Assign a color to the vertex given the output coordinates, colormaps are applied afterwards.
+							if (data.desc.coloring == SURFACE_DESC::OUTPUT_FUNCTION_COLORING)
+								col[m].color = data.desc.output_color_func(x, y, z).getColor4();
 						}
 					}
 
+					// Colormaps color all the vertices at once from their scalar values.
+					if (data.desc.coloring == SURFACE_DESC::COLORMAP_COLORING)
+						colormap_vertices(data, data.desc.num_u * data.desc.num_v, u_i, du, v_i, dv);
+
 					// If illuminated find normal vector.
 					if (data.desc.enable_illuminated)
 					{
@@ -1005,6 +1254,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.ColVertices, data.desc.num_u * data.desc.num_v);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, data.desc.num_u * data.desc.num_v, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
 
@@ -1076,6 +1328,10 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 				}
 			}
 
+			// Strips of quads miss the vertex cache on every row, reorder them for it.
+			MeshOptimizer::optimizeTriangleOrder(indices, 2u * (data.desc.num_u - 1u) * (data.desc.num_v - 1u), data.desc.num_u * data.desc.num_v);
+
+			store_export_indices(data, indices, 6u * (data.desc.num_u - 1u) * (data.desc.num_v - 1u));
 			AddBind(new IndexBuffer(indices, 6u * (data.desc.num_u - 1u) * (data.desc.num_v - 1u)));
 
 			delete[] indices;
@@ -1246,6 +1502,10 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 
 			}
 
+			// Subdivided triangles come out scattered, reorder them for the vertex cache.
+			MeshOptimizer::optimizeTriangleOrder(indices, C, V);
+
+			store_export_indices(data, indices, 3u * C);
 			AddBind(new IndexBuffer(indices, 3u * C));
 
 			delete[] indices;
@@ -1324,6 +1584,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.Vertices, V);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.Vertices, V, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
 
@@ -1373,12 +1636,13 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 
 				case SURFACE_DESC::TEXTURED_COLORING:
 				{
-					USER_CHECK(data.desc.texture_image,
+					USER_CHECK(data.desc.texture_image || data.desc.texture_view.pixels() || data.desc.texture_compressed,
 						"Found nullptr when trying to acces an image to create a texture for a textured Surface."
 					);
 
-					// Create the texture from the input image. Since it is an icosphere the texture must be a cube-map.
-					data.pUpdateTexture = AddBind(new Texture(data.desc.texture_image, data.desc.enable_updates ? TEXTURE_USAGE_DYNAMIC : TEXTURE_USAGE_DEFAULT, TEXTURE_TYPE_CUBEMAP));
+					// Create the texture from the input image, or the view if there is no image. Since it is 
+					// an icosphere the texture must be a cube-map.
+					data.pUpdateTexture = AddBind(create_texture(data.desc, TEXTURE_TYPE_CUBEMAP));
 
 					// Create the sampler for the texture.
 					AddBind(new Sampler(data.desc.pixelated_texture ? SAMPLE_FILTER_POINT : SAMPLE_FILTER_LINEAR, SAMPLE_ADDRESS_CLAMP));
@@ -1454,6 +1718,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.TexVertices, V);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.TexVertices, V, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
 
@@ -1505,18 +1772,19 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 				case SURFACE_DESC::ARRAY_COLORING:
 					USER_ERROR(
 						"Array coloring is not supported for a spherical function Surface.\n"
-						"Since the function input is an unordered spherical vector the only colorings allowed are global, output function and cube-map textured."
+						"Since the function input is an unordered spherical vector the only colorings allowed are global, output function, colormap and cube-map textured."
 					);
 
 				case SURFACE_DESC::INPUT_FUNCTION_COLORING:
 					USER_ERROR(
 						"Input function coloring is not supported for a spherical function Surface.\n"
-						"Since the function input is an unordered spherical vector the only colorings allowed are global, output function and cube-map textured."
+						"Since the function input is an unordered spherical vector the only colorings allowed are global, output function, colormap and cube-map textured."
 					);
 
 				case SURFACE_DESC::OUTPUT_FUNCTION_COLORING:
+				case SURFACE_DESC::COLORMAP_COLORING:
 				{
-					USER_CHECK(data.desc.output_color_func,
+					USER_CHECK(data.desc.coloring == SURFACE_DESC::COLORMAP_COLORING || data.desc.output_color_func,
 						"Found nullptr when trying to acces a color function to color an output function colored Surface."
 					);
 
@@ -1530,10 +1798,15 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						// Assign a radius for each point of the sphere.
 						data.ColVertices[n].vector = (vertex * data.desc.spherical_func(vertex.x, vertex.y, vertex.z)).getVector4();
 
-						// Assign a color to the vertex given the output coordinates.
-						data.ColVertices[n].color = data.desc.output_color_func(data.ColVertices[n].vector.x, data.ColVertices[n].vector.y, data.ColVertices[n].vector.z).getColor4();
+						// Assign a color to the vertex given the output coordinates, colormaps are applied afterwards.
+						if (data.desc.coloring == SURFACE_DESC::OUTPUT_FUNCTION_COLORING)
+							data.ColVertices[n].color = data.desc.output_color_func(data.ColVertices[n].vector.x, data.ColVertices[n].vector.y, data.ColVertices[n].vector.z).getColor4();
 					}
 
+					// Colormaps color all the vertices at once from their scalar values.
+					if (data.desc.coloring == SURFACE_DESC::COLORMAP_COLORING)
+						colormap_vertices(data, V, u_i, du, v_i, dv);
+
 					// If illuminated find normal vector.
 					if (data.desc.enable_illuminated)
 					{
@@ -1591,6 +1864,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.ColVertices, V);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, V, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
 
@@ -1775,6 +2051,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.Vertices, data.desc.num_u * data.desc.num_v);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.Vertices, data.desc.num_u * data.desc.num_v, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
 
@@ -1824,12 +2103,12 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 
 				case SURFACE_DESC::TEXTURED_COLORING:
 				{
-					USER_CHECK(data.desc.texture_image,
+					USER_CHECK(data.desc.texture_image || data.desc.texture_view.pixels() || data.desc.texture_compressed,
 						"Found nullptr when trying to acces an image to create a texture for a textured Surface."
 					);
 
-					// Create the texture from the input image.
-					data.pUpdateTexture = AddBind(new Texture(data.desc.texture_image, data.desc.enable_updates ? TEXTURE_USAGE_DYNAMIC : TEXTURE_USAGE_DEFAULT));
+					// Create the texture from the input image, or the view if there is no image, and its mip chain if enabled.
+					data.pUpdateTexture = AddBind(create_texture(data.desc, TEXTURE_TYPE_IMAGE));
 
 					// Create the sampler for the texture.
 					AddBind(new Sampler(data.desc.pixelated_texture ? SAMPLE_FILTER_POINT : SAMPLE_FILTER_LINEAR, SAMPLE_ADDRESS_CLAMP));
@@ -1952,6 +2231,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.TexVertices, data.desc.num_u * data.desc.num_v);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.TexVertices, data.desc.num_u * data.desc.num_v, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
 
@@ -2124,6 +2406,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.ColVertices, data.desc.num_u * data.desc.num_v);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, data.desc.num_u * data.desc.num_v, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
 
@@ -2296,6 +2581,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.ColVertices, data.desc.num_u * data.desc.num_v);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, data.desc.num_u * data.desc.num_v, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
 
@@ -2345,8 +2633,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 				}
 
 				case SURFACE_DESC::OUTPUT_FUNCTION_COLORING:
+				case SURFACE_DESC::COLORMAP_COLORING:
 				{
-					USER_CHECK(data.desc.output_color_func,
+					USER_CHECK(data.desc.coloring == SURFACE_DESC::COLORMAP_COLORING || data.desc.output_color_func,
 						"Found nullptr when trying to acces a color function to color an output function colored Surface."
 					);
 
@@ -2367,11 +2656,16 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 							// Assign a value for each point of the function.
 							col[m].vector = pos.getVector4();
 
-							// Assign a color to the vertex given the output coordinates.
-							col[m].color = data.desc.output_color_func(pos.x, pos.y, pos.z).getColor4();
+							// Assign a color to the vertex given the output coordinates, colormaps are applied afterwards.
+							if (data.desc.coloring == SURFACE_DESC::OUTPUT_FUNCTION_COLORING)
+								col[m].color = data.desc.output_color_func(pos.x, pos.y, pos.z).getColor4();
 						}
 					}
 
+					// Colormaps color all the vertices at once from their scalar values.
+					if (data.desc.coloring == SURFACE_DESC::COLORMAP_COLORING)
+						colormap_vertices(data, data.desc.num_u * data.desc.num_v, u_i, du, v_i, dv);
+
 					// If illuminated find normal vector.
 					if (data.desc.enable_illuminated)
 					{
@@ -2468,6 +2762,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.ColVertices, data.desc.num_u * data.desc.num_v);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, data.desc.num_u * data.desc.num_v, data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
 
@@ -2539,6 +2836,10 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 				}
 			}
 
+			// Strips of quads miss the vertex cache on every row, reorder them for it.
+			MeshOptimizer::optimizeTriangleOrder(indices, 2u * (data.desc.num_u - 1u) * (data.desc.num_v - 1u), data.desc.num_u * data.desc.num_v);
+
+			store_export_indices(data, indices, 6u * (data.desc.num_u - 1u) * (data.desc.num_v - 1u));
 			AddBind(new IndexBuffer(indices, 6u * (data.desc.num_u - 1u) * (data.desc.num_v - 1u)));
 
 			delete[] indices;
@@ -2993,6 +3294,7 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 			cube_search::recursive_search(data, data.desc.range_u, data.desc.range_v, data.desc.range_w, 0u, data.implicit_vertices, data.implicit_triangles, n_vertices, n_triangles);
 
 			// First add the index buffer.
+			store_export_indices(data, (unsigned*)data.implicit_triangles, 3u * n_triangles);
 			AddBind(new IndexBuffer((unsigned*)data.implicit_triangles, 3u * n_triangles));
 
 			switch (data.desc.coloring)
@@ -3051,6 +3353,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.Vertices, data.desc.enable_updates ? 3u * data.desc.max_implicit_triangles : n_vertices);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.Vertices, data.desc.enable_updates ? 3u * data.desc.max_implicit_triangles : n_vertices, 
 						data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
@@ -3108,24 +3413,25 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 				case SURFACE_DESC::TEXTURED_COLORING:
 					USER_ERROR(
 						"Textured coloring is not supported for an implicit Surface.\n"
-						"Given the nature of the function the only colorings allowed are global and output function."
+						"Given the nature of the function the only colorings allowed are global, output function and colormap."
 					);
 
 				case SURFACE_DESC::ARRAY_COLORING:
 					USER_ERROR(
 						"Array coloring is not supported for an implicit Surface.\n"
-						"Given the nature of the function the only colorings allowed are global and output function."
+						"Given the nature of the function the only colorings allowed are global, output function and colormap."
 					);
 
 				case SURFACE_DESC::INPUT_FUNCTION_COLORING:
 					USER_ERROR(
 						"Input function coloring is not supported for an implicit Surface.\n"
-						"Given the nature of the function the only colorings allowed are global and output function."
+						"Given the nature of the function the only colorings allowed are global, output function and colormap."
 					);
 
 				case SURFACE_DESC::OUTPUT_FUNCTION_COLORING:
+				case SURFACE_DESC::COLORMAP_COLORING:
 				{
-					USER_CHECK(data.desc.output_color_func,
+					USER_CHECK(data.desc.coloring == SURFACE_DESC::COLORMAP_COLORING || data.desc.output_color_func,
 						"Found nullptr when trying to acces a color function to color an output function colored Surface."
 					);
 
@@ -3136,9 +3442,14 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 					{
 						data.ColVertices[n].vector = data.implicit_vertices[n].getVector4();
 
-						data.ColVertices[n].color = data.desc.output_color_func(data.implicit_vertices[n].x, data.implicit_vertices[n].y, data.implicit_vertices[n].z).getColor4();
+						if (data.desc.coloring == SURFACE_DESC::OUTPUT_FUNCTION_COLORING)
+							data.ColVertices[n].color = data.desc.output_color_func(data.implicit_vertices[n].x, data.implicit_vertices[n].y, data.implicit_vertices[n].z).getColor4();
 					}
 
+					// Colormaps color all the vertices at once from their scalar values.
+					if (data.desc.coloring == SURFACE_DESC::COLORMAP_COLORING)
+						colormap_vertices(data, n_vertices, u_i, du, v_i, dv);
+
 					// If illuminated find normal vector.
 					if (data.desc.enable_illuminated)
 					{
@@ -3185,6 +3496,9 @@ void Surface::initialize(const SURFACE_DESC* pDesc)
 						}
 					}
 
+					// Keep a copy of the mesh if export is enabled.
+					store_export_vertices(data, data.ColVertices, data.desc.enable_updates ? 3u * data.desc.max_implicit_triangles : n_vertices);
+
 					// Create the Vertex Buffer
 					data.pUpdateVB = AddBind(new VertexBuffer(data.ColVertices, data.desc.enable_updates ? 3u * data.desc.max_implicit_triangles : n_vertices, 
 						data.desc.enable_updates ? VB_USAGE_DYNAMIC : VB_USAGE_DEFAULT));
@@ -3455,6 +3769,7 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Update the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.Vertices, data.desc.num_u * data.desc.num_v);
+					store_export_vertices(data, data.Vertices, data.desc.num_u * data.desc.num_v);
 					break;
 				}
 
@@ -3572,6 +3887,7 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Create the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.TexVertices, data.desc.num_u * data.desc.num_v);
+					store_export_vertices(data, data.TexVertices, data.desc.num_u * data.desc.num_v);
 					break;
 				}
 
@@ -3689,6 +4005,7 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Update the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.ColVertices, data.desc.num_u * data.desc.num_v);
+					store_export_vertices(data, data.ColVertices, data.desc.num_u * data.desc.num_v);
 					break;
 				}
 
@@ -3809,10 +4126,12 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Update the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.ColVertices, data.desc.num_u * data.desc.num_v);
+					store_export_vertices(data, data.ColVertices, data.desc.num_u * data.desc.num_v);
 					break;
 				}
 
 				case SURFACE_DESC::OUTPUT_FUNCTION_COLORING:
+				case SURFACE_DESC::COLORMAP_COLORING:
 				{
 					// Assign a position to each vertex given the explicit function and a color.
 					for (unsigned n = 0u; n < data.desc.num_u; n++)
@@ -3829,11 +4148,16 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 							// Assign a value for each point of the function.
 							col[m].vector = _float4vector{ x, y, z, 0.f };
 
-							// Assign a color to the vertex given the output coordinates.
-							col[m].color = data.desc.output_color_func(x, y, z).getColor4();
+							// Assign a color to the vertex given the output coordinates, colormaps are applied afterwards.
+							if (data.desc.coloring == SURFACE_DESC::OUTPUT_FUNCTION_COLORING)
+								col[m].color = data.desc.output_color_func(x, y, z).getColor4();
 						}
 					}
 
+					// Colormaps color all the vertices at once from their scalar values.
+					if (data.desc.coloring == SURFACE_DESC::COLORMAP_COLORING)
+						colormap_vertices(data, data.desc.num_u * data.desc.num_v, u_i, du, v_i, dv);
+
 					// If illuminated find normal vector.
 					if (data.desc.enable_illuminated)
 					{
@@ -3929,6 +4253,7 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Update the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.ColVertices, data.desc.num_u * data.desc.num_v);
+					store_export_vertices(data, data.ColVertices, data.desc.num_u * data.desc.num_v);
 					break;
 				}
 			}
@@ -4004,6 +4329,7 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Create the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.Vertices, V);
+					store_export_vertices(data, data.Vertices, V);
 					break;
 				}
 
@@ -4063,10 +4389,12 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Create the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.TexVertices, V);
+					store_export_vertices(data, data.TexVertices, V);
 					break;
 				}
 
 				case SURFACE_DESC::OUTPUT_FUNCTION_COLORING:
+				case SURFACE_DESC::COLORMAP_COLORING:
 				{
 					// Assign a position to each vertex given the explicit function and a color.
 					for (unsigned n = 0u; n < V; n++)
@@ -4076,10 +4404,15 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 						// Assign a radius for each point of the sphere.
 						data.ColVertices[n].vector = (vertex * data.desc.spherical_func(vertex.x, vertex.y, vertex.z)).getVector4();
 
-						// Assign a color to the vertex given the output coordinates.
-						data.ColVertices[n].color = data.desc.output_color_func(data.ColVertices[n].vector.x, data.ColVertices[n].vector.y, data.ColVertices[n].vector.z).getColor4();
+						// Assign a color to the vertex given the output coordinates, colormaps are applied afterwards.
+						if (data.desc.coloring == SURFACE_DESC::OUTPUT_FUNCTION_COLORING)
+							data.ColVertices[n].color = data.desc.output_color_func(data.ColVertices[n].vector.x, data.ColVertices[n].vector.y, data.ColVertices[n].vector.z).getColor4();
 					}
 
+					// Colormaps color all the vertices at once from their scalar values.
+					if (data.desc.coloring == SURFACE_DESC::COLORMAP_COLORING)
+						colormap_vertices(data, V, u_i, du, v_i, dv);
+
 					// If illuminated find normal vector.
 					if (data.desc.enable_illuminated)
 					{
@@ -4125,6 +4458,7 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Create the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.ColVertices, V);
+					store_export_vertices(data, data.ColVertices, V);
 					break;
 				}
 			}
@@ -4249,6 +4583,7 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Create the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.Vertices, data.desc.num_u * data.desc.num_v);
+					store_export_vertices(data, data.Vertices, data.desc.num_u * data.desc.num_v);
 					break;
 				}
 
@@ -4366,6 +4701,7 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Create the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.TexVertices, data.desc.num_u * data.desc.num_v);
+					store_export_vertices(data, data.TexVertices, data.desc.num_u * data.desc.num_v);
 					break;
 				}
 
@@ -4483,6 +4819,7 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Create the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.ColVertices, data.desc.num_u * data.desc.num_v);
+					store_export_vertices(data, data.ColVertices, data.desc.num_u * data.desc.num_v);
 					break;
 				}
 
@@ -4603,10 +4940,12 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Create the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.ColVertices, data.desc.num_u * data.desc.num_v);
+					store_export_vertices(data, data.ColVertices, data.desc.num_u * data.desc.num_v);
 					break;
 				}
 
 				case SURFACE_DESC::OUTPUT_FUNCTION_COLORING:
+				case SURFACE_DESC::COLORMAP_COLORING:
 				{
 					// Assign a position to each vertex given the explicit function and a color.
 					for (unsigned n = 0u; n < data.desc.num_u; n++)
@@ -4623,11 +4962,16 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 							// Assign a value for each point of the function.
 							col[m].vector = pos.getVector4();
 
-							// Assign a color to the vertex given the output coordinates.
-							col[m].color = data.desc.output_color_func(pos.x, pos.y, pos.z).getColor4();
+							// Assign a color to the vertex given the output coordinates, colormaps are applied afterwards.
+							if (data.desc.coloring == SURFACE_DESC::OUTPUT_FUNCTION_COLORING)
+								col[m].color = data.desc.output_color_func(pos.x, pos.y, pos.z).getColor4();
 						}
 					}
 
+					// Colormaps color all the vertices at once from their scalar values.
+					if (data.desc.coloring == SURFACE_DESC::COLORMAP_COLORING)
+						colormap_vertices(data, data.desc.num_u * data.desc.num_v, u_i, du, v_i, dv);
+
 					// If illuminated find normal vector.
 					if (data.desc.enable_illuminated)
 					{
@@ -4723,6 +5067,7 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Update the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.ColVertices, data.desc.num_u* data.desc.num_v);
+					store_export_vertices(data, data.ColVertices, data.desc.num_u* data.desc.num_v);
 					break;
 				}
 			}
@@ -5158,6 +5503,7 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 			cube_search::recursive_search(data, data.desc.range_u, data.desc.range_v, data.desc.range_w, 0u, data.implicit_vertices, data.implicit_triangles, n_vertices, n_triangles);
 
 			// First replace the index buffer.
+			store_export_indices(data, (unsigned*)data.implicit_triangles, 3u * n_triangles);
 			changeBind(new IndexBuffer((unsigned*)data.implicit_triangles, 3u * n_triangles), 0u);
 
 			switch (data.desc.coloring)
@@ -5201,19 +5547,26 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Create the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.Vertices, 3u * data.desc.max_implicit_triangles);
+					store_export_vertices(data, data.Vertices, 3u * data.desc.max_implicit_triangles);
 					break;
 				}
 
 				case SURFACE_DESC::OUTPUT_FUNCTION_COLORING:
+				case SURFACE_DESC::COLORMAP_COLORING:
 				{
 					// Assign a position and color to each vertex.
 					for (unsigned n = 0u; n < n_vertices; n++)
 					{
 						data.ColVertices[n].vector = data.implicit_vertices[n].getVector4();
 
-						data.ColVertices[n].color = data.desc.output_color_func(data.implicit_vertices[n].x, data.implicit_vertices[n].y, data.implicit_vertices[n].z).getColor4();
+						if (data.desc.coloring == SURFACE_DESC::OUTPUT_FUNCTION_COLORING)
+							data.ColVertices[n].color = data.desc.output_color_func(data.implicit_vertices[n].x, data.implicit_vertices[n].y, data.implicit_vertices[n].z).getColor4();
 					}
 
+					// Colormaps color all the vertices at once from their scalar values.
+					if (data.desc.coloring == SURFACE_DESC::COLORMAP_COLORING)
+						colormap_vertices(data, n_vertices, u_i, du, v_i, dv);
+
 					// If illuminated find normal vector.
 					if (data.desc.enable_illuminated)
 					{
@@ -5247,6 +5600,7 @@ void Surface::updateShape(Vector2f range_u, Vector2f range_v, Vector2f range_w)
 
 					// Create the Vertex Buffer
 					data.pUpdateVB->updateVertices(data.ColVertices, 3u * data.desc.max_implicit_triangles);
+					store_export_vertices(data, data.ColVertices, 3u * data.desc.max_implicit_triangles);
 					break;
 				}
 			}
@@ -5293,12 +5647,25 @@ void Surface::updateColors(const Color** color_array)
 
 	// Update the vertex buffer.
 	data.pUpdateVB->updateVertices(data.ColVertices, data.desc.num_u * data.desc.num_v);
+	store_export_vertices(data, data.ColVertices, data.desc.num_u * data.desc.num_v);
 }
 
 // If updates are enabled and coloring is textured, it expects a valid image pointer and 
 // uses it to update the texture. Image dimensions must be equal to the initial image.
 
 void Surface::updateTexture(const Image* texture_image)
+{
+	USER_CHECK(texture_image,
+		"Found nullptr when trying to access an Image to update a textured Surface."
+	);
+
+	updateTexture(ImageView(*texture_image));
+}
+
+// If updates are enabled and coloring is textured, updates the texture with the rows
+// of the view. Dimensions must be equal to the initial image.
+
+void Surface::updateTexture(const ImageView& texture_image)
 {
 	USER_CHECK(isInit,
 		"Trying to update the texture on an uninitialized Surface."
@@ -5310,15 +5677,23 @@ void Surface::updateTexture(const Image* texture_image)
 		"Trying to update the texture on a Surface with a different coloring."
 	);
 
-	USER_CHECK(texture_image,
-		"Found nullptr when trying to access an Image to update a textured Surface."
-	);
-
 	USER_CHECK(data.desc.enable_updates,
 		"Trying to update the texture on a Surface with updates disabled."
 	);
 
-	data.pUpdateTexture->update(texture_image);
+	USER_CHECK(data.desc.texture_image || data.desc.texture_view.pixels(),
+		"Trying to update the texture on a Surface created from a compressed image.\n"
+		"Compressed textures can not be updated, use an Image or an ImageView instead."
+	);
+
+	// Mipmapped textures get the chain of the new image, spherical surfaces use cube-maps.
+	if (data.desc.texture_mipmaps)
+	{
+		MipChain chain(texture_image, data.desc.mipmap_filter, data.desc.type == SURFACE_DESC::SPHERICAL_SURFACE);
+		data.pUpdateTexture->update(&chain);
+	}
+	else
+		data.pUpdateTexture->update(texture_image);
 }
 
 // If the coloring is set to global, updates the global Surface color.
@@ -5567,3 +5942,120 @@ Vector2f Surface::getScreenPosition() const
 
 	return { data.vscBuff.displacement.x, data.vscBuff.displacement.y };
 }
+
+// If mesh export is enabled, outputs a Polyhedron descriptor with the current triangle mesh
+// of the Surface, that can be written with the Polyhedron file writers and loaded back later 
+// without evaluating the functions again. Positions and triangles are exported, along with
+// the normals if the Surface is illuminated and the colors if they are per vertex.
+// NOTE: All data is allocated by (new) and its deletion must be handled by the user.
+
+POLYHEDRON_DESC Surface::getMeshDesc() const
+{
+	USER_CHECK(isInit,
+		"Trying to get the mesh of an uninitialized Surface."
+	);
+
+	SurfaceInternals& data = *(SurfaceInternals*)surfaceData;
+
+	USER_CHECK(data.desc.enable_mesh_export,
+		"Trying to get the mesh of a Surface without mesh export enabled.\n"
+		"To export the mesh of a Surface you must set enable_mesh_export to true on its descriptor."
+	);
+
+	// Vertex buffers of updatable implicit surfaces are larger than the mesh, only 
+	// the vertices referenced by the triangles are exported.
+	unsigned vertex_count = 0u;
+	for (unsigned i = 0u; i < data.export_index_count; i++)
+		vertex_count = data.export_indices[i] + 1u > vertex_count ? data.export_indices[i] + 1u : vertex_count;
+
+	POLYHEDRON_DESC desc = {};
+	desc.triangle_count = data.export_index_count / 3u;
+	desc.triangle_list = new Vector3i[desc.triangle_count];
+	memcpy((void*)desc.triangle_list, data.export_indices, 3u * desc.triangle_count * sizeof(unsigned));
+
+	desc.vertex_list = new Vector3f[vertex_count];
+	memcpy(desc.vertex_list, data.export_vertices, vertex_count * sizeof(Vector3f));
+
+	desc.global_color = data.desc.global_color;
+	desc.double_sided_rendering = data.desc.double_sided_rendering;
+	desc.enable_illuminated = data.desc.enable_illuminated;
+	desc.enable_transparency = data.desc.enable_transparency;
+
+	if (data.desc.enable_illuminated)
+	{
+		desc.normal_computation = POLYHEDRON_DESC::PER_VERTEX_LIST_NORMALS;
+		desc.normal_vectors_list = new Vector3f[vertex_count];
+		memcpy(desc.normal_vectors_list, data.export_normals, vertex_count * sizeof(Vector3f));
+	}
+
+	// Polyhedron colors are per triangle corner.
+	if (data.export_colors)
+	{
+		desc.coloring = POLYHEDRON_DESC::PER_VERTEX_COLORING;
+		desc.color_list = new Color[3u * desc.triangle_count];
+
+		for (unsigned i = 0u; i < 3u * desc.triangle_count; i++)
+			desc.color_list[i] = data.export_colors[data.export_indices[i]];
+	}
+	else
+		desc.coloring = POLYHEDRON_DESC::GLOBAL_COLORING;
+
+	return desc;
+}
+
+// If picking is enabled, finds the closest triangle hit by the ray given in world 
+// coordinates, taking into account the rotation, distortion and position of the Surface.
+// Returns false if no triangle is hit, otherwise writes the hit to the valid pointer. 
+// Triangle indices refer to the triangle list exported by getMeshDesc().
+
+bool Surface::pickTriangle(Vector3f origin, Vector3f direction, MESH_PICK* pPick) const
+{
+	USER_CHECK(isInit,
+		"Trying to pick a triangle on an uninitialized Surface."
+	);
+
+	SurfaceInternals& data = *(SurfaceInternals*)surfaceData;
+
+	USER_CHECK(data.desc.enable_picking,
+		"Trying to pick a triangle on a Surface without picking enabled.\n"
+		"To pick triangles of a Surface you must set enable_picking to true on its descriptor."
+	);
+
+	MeshBVH::Hit hit;
+	if (!picking_bvh(data).raycast(data.rotation.getMatrix() * data.distortion, data.position, origin, direction, &hit))
+		return false;
+
+	if (pPick)
+	{
+		pPick->triangle = hit.triangle;
+		pPick->distance = hit.distance;
+		pPick->point = hit.point;
+		pPick->normal = hit.normal;
+		pPick->barycentric = hit.barycentric;
+	}
+	return true;
+}
+
+// If picking is enabled, finds the triangles that intersect the box given in world 
+// coordinates and writes up to the maximum specified to the list. Returns the total
+// number of triangles found, even if it is larger than the maximum.
+
+unsigned Surface::queryBox(Vector3f box_min, Vector3f box_max, unsigned* triangle_list, unsigned max_triangles) const
+{
+	USER_CHECK(isInit,
+		"Trying to query the triangles of an uninitialized Surface."
+	);
+
+	SurfaceInternals& data = *(SurfaceInternals*)surfaceData;
+
+	USER_CHECK(data.desc.enable_picking,
+		"Trying to query the triangles of a Surface without picking enabled.\n"
+		"To query triangles of a Surface you must set enable_picking to true on its descriptor."
+	);
+
+	USER_CHECK(box_min.x <= box_max.x && box_min.y <= box_max.y && box_min.z <= box_max.z,
+		"Trying to query the triangles of a Surface with an invalid box, its minimum is larger than its maximum."
+	);
+
+	return picking_bvh(data).queryBox(data.rotation.getMatrix() * data.distortion, data.position, box_min, box_max, triangle_list, max_triangles);
+}
@@ -597,20 +597,9 @@ void Graphics::pushFrame()
 			// Unmap resource
 			_context->Unmap(data.pCaptureStaging.Get(), 0);
 
-			// If transparent, adjust image RGB values based on alpha.
+			// If transparent, the render target holds premultiplied colors.
 			if (data.oitEnabled)
-			{
-				Color* pixels = data.captureImage->pixels();
-				const unsigned pixel_count = WindowDim.x * WindowDim.y;
-				for (unsigned i = 0u; i < pixel_count; i++)
-				{
-					float alpha = pixels[i].A / 255.f;
-					Color col = pixels[i] / alpha;
-					pixels[i].R = col.R;
-					pixels[i].G = col.G;
-					pixels[i].B = col.B;
-				}
-			}
+				data.captureImage->unpremultiply();
 
 			// Reset image buffer.
 			data.captureImage = nullptr;
@@ -932,3 +921,27 @@ bool Graphics::isTransparencyEnabled() const
 
 	return data.oitEnabled;
 }
+
+// Computes the scene space ray that goes through the pixel specified, for example the
+// mouse position, as seen from the current perspective. The origin lies on the plane 
+// through the center facing the observer, and the direction points into the screen.
+
+void Graphics::getPixelRay(Vector2i pixel, Vector3f* origin, Vector3f* direction) const
+{
+	USER_CHECK(origin && direction,
+		"Found nullptr when trying to get a pixel ray from a Graphics object."
+	);
+
+	// Screen coordinates span the window dimensions over the scale in both directions, and
+	// the observer rotation takes scene positions to screen positions, so it is reverted.
+	Matrix to_scene = cbuff.observer.getMatrix().transposed();
+
+	Vector3f screen_position = {
+		(2.f * pixel.x - WindowDim.x) / Scale,
+		(WindowDim.y - 2.f * pixel.y) / Scale,
+		0.f
+	};
+
+	*origin = Vector3f(cbuff.center) + to_scene * screen_position;
+	*direction = to_scene * Vector3f(0.f, 0.f, 1.f);
+}
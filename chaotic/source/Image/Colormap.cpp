@@ -0,0 +1,504 @@
+#include "Image/Colormap.h"
+
+#include "Error/_erDefault.h"
+
+#include <cstdint>
+#include <cmath>
+
+#if defined _M_X64 || defined _M_IX86 || defined __SSE2__
+#include <emmintrin.h>
+#define _COLORMAP_SSE2
+#elif defined _M_ARM64 || defined __aarch64__
+#include <arm_neon.h>
+#define _COLORMAP_NEON
+#endif
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Built in gradients
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Tables of the built in gradients as 0xRRGGBB values, the 256 colors of the original 
+// matplotlib definitions, the diverging red-blue map is reversed so that it goes up to red.
+
+static const unsigned viridis_table[256] =
+{
+	0x440154, 0x440256, 0x450457, 0x450559, 0x46075A, 0x46085C, 0x460A5D, 0x460B5E, 0x470D60, 0x470E61, 0x471063, 0x471164, 0x471365, 0x481467, 0x481668, 0x481769,
+	0x48186A, 0x481A6C, 0x481B6D, 0x481C6E, 0x481D6F, 0x481F70, 0x482071, 0x482173, 0x482374, 0x482475, 0x482576, 0x482677, 0x482878, 0x482979, 0x472A7A, 0x472C7A,
+	0x472D7B, 0x472E7C, 0x472F7D, 0x46307E, 0x46327E, 0x46337F, 0x463480, 0x453581, 0x453781, 0x453882, 0x443983, 0x443A83, 0x443B84, 0x433D84, 0x433E85, 0x423F85,
+	0x424086, 0x424186, 0x414287, 0x414487, 0x404588, 0x404688, 0x3F4788, 0x3F4889, 0x3E4989, 0x3E4A89, 0x3E4C8A, 0x3D4D8A, 0x3D4E8A, 0x3C4F8A, 0x3C508B, 0x3B518B,
+	0x3B528B, 0x3A538B, 0x3A548C, 0x39558C, 0x39568C, 0x38588C, 0x38598C, 0x375A8C, 0x375B8D, 0x365C8D, 0x365D8D, 0x355E8D, 0x355F8D, 0x34608D, 0x34618D, 0x33628D,
+	0x33638D, 0x32648E, 0x32658E, 0x31668E, 0x31678E, 0x31688E, 0x30698E, 0x306A8E, 0x2F6B8E, 0x2F6C8E, 0x2E6D8E, 0x2E6E8E, 0x2E6F8E, 0x2D708E, 0x2D718E, 0x2C718E,
+	0x2C728E, 0x2C738E, 0x2B748E, 0x2B758E, 0x2A768E, 0x2A778E, 0x2A788E, 0x29798E, 0x297A8E, 0x297B8E, 0x287C8E, 0x287D8E, 0x277E8E, 0x277F8E, 0x27808E, 0x26818E,
+	0x26828E, 0x26828E, 0x25838E, 0x25848E, 0x25858E, 0x24868E, 0x24878E, 0x23888E, 0x23898E, 0x238A8D, 0x228B8D, 0x228C8D, 0x228D8D, 0x218E8D, 0x218F8D, 0x21908D,
+	0x21918C, 0x20928C, 0x20928C, 0x20938C, 0x1F948C, 0x1F958B, 0x1F968B, 0x1F978B, 0x1F988B, 0x1F998A, 0x1F9A8A, 0x1E9B8A, 0x1E9C89, 0x1E9D89, 0x1F9E89, 0x1F9F88,
+	0x1FA088, 0x1FA188, 0x1FA187, 0x1FA287, 0x20A386, 0x20A486, 0x21A585, 0x21A685, 0x22A785, 0x22A884, 0x23A983, 0x24AA83, 0x25AB82, 0x25AC82, 0x26AD81, 0x27AD81,
+	0x28AE80, 0x29AF7F, 0x2AB07F, 0x2CB17E, 0x2DB27D, 0x2EB37C, 0x2FB47C, 0x31B57B, 0x32B67A, 0x34B679, 0x35B779, 0x37B878, 0x38B977, 0x3ABA76, 0x3BBB75, 0x3DBC74,
+	0x3FBC73, 0x40BD72, 0x42BE71, 0x44BF70, 0x46C06F, 0x48C16E, 0x4AC16D, 0x4CC26C, 0x4EC36B, 0x50C46A, 0x52C569, 0x54C568, 0x56C667, 0x58C765, 0x5AC864, 0x5CC863,
+	0x5EC962, 0x60CA60, 0x63CB5F, 0x65CB5E, 0x67CC5C, 0x69CD5B, 0x6CCD5A, 0x6ECE58, 0x70CF57, 0x73D056, 0x75D054, 0x77D153, 0x7AD151, 0x7CD250, 0x7FD34E, 0x81D34D,
+	0x84D44B, 0x86D549, 0x89D548, 0x8BD646, 0x8ED645, 0x90D743, 0x93D741, 0x95D840, 0x98D83E, 0x9BD93C, 0x9DD93B, 0xA0DA39, 0xA2DA37, 0xA5DB36, 0xA8DB34, 0xAADC32,
+	0xADDC30, 0xB0DD2F, 0xB2DD2D, 0xB5DE2B, 0xB8DE29, 0xBADE28, 0xBDDF26, 0xC0DF25, 0xC2DF23, 0xC5E021, 0xC8E020, 0xCAE11F, 0xCDE11D, 0xD0E11C, 0xD2E21B, 0xD5E21A,
+	0xD8E219, 0xDAE319, 0xDDE318, 0xDFE318, 0xE2E418, 0xE5E419, 0xE7E419, 0xEAE51A, 0xECE51B, 0xEFE51C, 0xF1E51D, 0xF4E61E, 0xF6E620, 0xF8E621, 0xFBE723, 0xFDE725,
+};
+
+static const unsigned magma_table[256] =
+{
+	0x000004, 0x010005, 0x010106, 0x010108, 0x020109, 0x02020B, 0x02020D, 0x03030F, 0x030312, 0x040414, 0x050416, 0x060518, 0x06051A, 0x07061C, 0x08071E, 0x090720,
+	0x0A0822, 0x0B0924, 0x0C0926, 0x0D0A29, 0x0E0B2B, 0x100B2D, 0x110C2F, 0x120D31, 0x130D34, 0x140E36, 0x150E38, 0x160F3B, 0x180F3D, 0x19103F, 0x1A1042, 0x1C1044,
+	0x1D1147, 0x1E1149, 0x20114B, 0x21114E, 0x221150, 0x241253, 0x251255, 0x271258, 0x29115A, 0x2A115C, 0x2C115F, 0x2D1161, 0x2F1163, 0x311165, 0x331067, 0x341069,
+	0x36106B, 0x38106C, 0x390F6E, 0x3B0F70, 0x3D0F71, 0x3F0F72, 0x400F74, 0x420F75, 0x440F76, 0x451077, 0x471078, 0x491078, 0x4A1079, 0x4C117A, 0x4E117B, 0x4F127B,
+	0x51127C, 0x52137C, 0x54137D, 0x56147D, 0x57157E, 0x59157E, 0x5A167E, 0x5C167F, 0x5D177F, 0x5F187F, 0x601880, 0x621980, 0x641A80, 0x651A80, 0x671B80, 0x681C81,
+	0x6A1C81, 0x6B1D81, 0x6D1D81, 0x6E1E81, 0x701F81, 0x721F81, 0x732081, 0x752181, 0x762181, 0x782281, 0x792282, 0x7B2382, 0x7C2382, 0x7E2482, 0x802582, 0x812581,
+	0x832681, 0x842681, 0x862781, 0x882781, 0x892881, 0x8B2981, 0x8C2981, 0x8E2A81, 0x902A81, 0x912B81, 0x932B80, 0x942C80, 0x962C80, 0x982D80, 0x992D80, 0x9B2E7F,
+	0x9C2E7F, 0x9E2F7F, 0xA02F7F, 0xA1307E, 0xA3307E, 0xA5317E, 0xA6317D, 0xA8327D, 0xAA337D, 0xAB337C, 0xAD347C, 0xAE347B, 0xB0357B, 0xB2357B, 0xB3367A, 0xB5367A,
+	0xB73779, 0xB83779, 0xBA3878, 0xBC3978, 0xBD3977, 0xBF3A77, 0xC03A76, 0xC23B75, 0xC43C75, 0xC53C74, 0xC73D73, 0xC83E73, 0xCA3E72, 0xCC3F71, 0xCD4071, 0xCF4070,
+	0xD0416F, 0xD2426F, 0xD3436E, 0xD5446D, 0xD6456C, 0xD8456C, 0xD9466B, 0xDB476A, 0xDC4869, 0xDE4968, 0xDF4A68, 0xE04C67, 0xE24D66, 0xE34E65, 0xE44F64, 0xE55064,
+	0xE75263, 0xE85362, 0xE95462, 0xEA5661, 0xEB5760, 0xEC5860, 0xED5A5F, 0xEE5B5E, 0xEF5D5E, 0xF05F5E, 0xF1605D, 0xF2625D, 0xF2645C, 0xF3655C, 0xF4675C, 0xF4695C,
+	0xF56B5C, 0xF66C5C, 0xF66E5C, 0xF7705C, 0xF7725C, 0xF8745C, 0xF8765C, 0xF9785D, 0xF9795D, 0xF97B5D, 0xFA7D5E, 0xFA7F5E, 0xFA815F, 0xFB835F, 0xFB8560, 0xFB8761,
+	0xFC8961, 0xFC8A62, 0xFC8C63, 0xFC8E64, 0xFC9065, 0xFD9266, 0xFD9467, 0xFD9668, 0xFD9869, 0xFD9A6A, 0xFD9B6B, 0xFE9D6C, 0xFE9F6D, 0xFEA16E, 0xFEA36F, 0xFEA571,
+	0xFEA772, 0xFEA973, 0xFEAA74, 0xFEAC76, 0xFEAE77, 0xFEB078, 0xFEB27A, 0xFEB47B, 0xFEB67C, 0xFEB77E, 0xFEB97F, 0xFEBB81, 0xFEBD82, 0xFEBF84, 0xFEC185, 0xFEC287,
+	0xFEC488, 0xFEC68A, 0xFEC88C, 0xFECA8D, 0xFECC8F, 0xFECD90, 0xFECF92, 0xFED194, 0xFED395, 0xFED597, 0xFED799, 0xFED89A, 0xFDDA9C, 0xFDDC9E, 0xFDDEA0, 0xFDE0A1,
+	0xFDE2A3, 0xFDE3A5, 0xFDE5A7, 0xFDE7A9, 0xFDE9AA, 0xFDEBAC, 0xFCECAE, 0xFCEEB0, 0xFCF0B2, 0xFCF2B4, 0xFCF4B6, 0xFCF6B8, 0xFCF7B9, 0xFCF9BB, 0xFCFBBD, 0xFCFDBF,
+};
+
+static const unsigned inferno_table[256] =
+{
+	0x000004, 0x010005, 0x010106, 0x010108, 0x02010A, 0x02020C, 0x02020E, 0x030210, 0x040312, 0x040314, 0x050417, 0x060419, 0x07051B, 0x08051D, 0x09061F, 0x0A0722,
+	0x0B0724, 0x0C0826, 0x0D0829, 0x0E092B, 0x10092D, 0x110A30, 0x120A32, 0x140B34, 0x150B37, 0x160B39, 0x180C3C, 0x190C3E, 0x1B0C41, 0x1C0C43, 0x1E0C45, 0x1F0C48,
+	0x210C4A, 0x230C4C, 0x240C4F, 0x260C51, 0x280B53, 0x290B55, 0x2B0B57, 0x2D0B59, 0x2F0A5B, 0x310A5C, 0x320A5E, 0x340A5F, 0x360961, 0x380962, 0x390963, 0x3B0964,
+	0x3D0965, 0x3E0966, 0x400A67, 0x420A68, 0x440A68, 0x450A69, 0x470B6A, 0x490B6A, 0x4A0C6B, 0x4C0C6B, 0x4D0D6C, 0x4F0D6C, 0x510E6C, 0x520E6D, 0x540F6D, 0x550F6D,
+	0x57106E, 0x59106E, 0x5A116E, 0x5C126E, 0x5D126E, 0x5F136E, 0x61136E, 0x62146E, 0x64156E, 0x65156E, 0x67166E, 0x69166E, 0x6A176E, 0x6C186E, 0x6D186E, 0x6F196E,
+	0x71196E, 0x721A6E, 0x741A6E, 0x751B6E, 0x771C6D, 0x781C6D, 0x7A1D6D, 0x7C1D6D, 0x7D1E6D, 0x7F1E6C, 0x801F6C, 0x82206C, 0x84206B, 0x85216B, 0x87216B, 0x88226A,
+	0x8A226A, 0x8C2369, 0x8D2369, 0x8F2469, 0x902568, 0x922568, 0x932667, 0x952667, 0x972766, 0x982766, 0x9A2865, 0x9B2964, 0x9D2964, 0x9F2A63, 0xA02A63, 0xA22B62,
+	0xA32C61, 0xA52C60, 0xA62D60, 0xA82E5F, 0xA92E5E, 0xAB2F5E, 0xAD305D, 0xAE305C, 0xB0315B, 0xB1325A, 0xB3325A, 0xB43359, 0xB63458, 0xB73557, 0xB93556, 0xBA3655,
+	0xBC3754, 0xBD3853, 0xBF3952, 0xC03A51, 0xC13A50, 0xC33B4F, 0xC43C4E, 0xC63D4D, 0xC73E4C, 0xC83F4B, 0xCA404A, 0xCB4149, 0xCC4248, 0xCE4347, 0xCF4446, 0xD04545,
+	0xD24644, 0xD34743, 0xD44842, 0xD54A41, 0xD74B3F, 0xD84C3E, 0xD94D3D, 0xDA4E3C, 0xDB503B, 0xDD513A, 0xDE5238, 0xDF5337, 0xE05536, 0xE15635, 0xE25734, 0xE35933,
+	0xE45A31, 0xE55C30, 0xE65D2F, 0xE75E2E, 0xE8602D, 0xE9612B, 0xEA632A, 0xEB6429, 0xEB6628, 0xEC6726, 0xED6925, 0xEE6A24, 0xEF6C23, 0xEF6E21, 0xF06F20, 0xF1711F,
+	0xF1731D, 0xF2741C, 0xF3761B, 0xF37819, 0xF47918, 0xF57B17, 0xF57D15, 0xF67E14, 0xF68013, 0xF78212, 0xF78410, 0xF8850F, 0xF8870E, 0xF8890C, 0xF98B0B, 0xF98C0A,
+	0xF98E09, 0xFA9008, 0xFA9207, 0xFA9407, 0xFB9606, 0xFB9706, 0xFB9906, 0xFB9B06, 0xFB9D07, 0xFC9F07, 0xFCA108, 0xFCA309, 0xFCA50A, 0xFCA60C, 0xFCA80D, 0xFCAA0F,
+	0xFCAC11, 0xFCAE12, 0xFCB014, 0xFCB216, 0xFCB418, 0xFBB61A, 0xFBB81D, 0xFBBA1F, 0xFBBC21, 0xFBBE23, 0xFAC026, 0xFAC228, 0xFAC42A, 0xFAC62D, 0xF9C72F, 0xF9C932,
+	0xF9CB35, 0xF8CD37, 0xF8CF3A, 0xF7D13D, 0xF7D340, 0xF6D543, 0xF6D746, 0xF5D949, 0xF5DB4C, 0xF4DD4F, 0xF4DF53, 0xF4E156, 0xF3E35A, 0xF3E55D, 0xF2E661, 0xF2E865,
+	0xF2EA69, 0xF1EC6D, 0xF1ED71, 0xF1EF75, 0xF1F179, 0xF2F27D, 0xF2F482, 0xF3F586, 0xF3F68A, 0xF4F88E, 0xF5F992, 0xF6FA96, 0xF8FB9A, 0xF9FC9D, 0xFAFDA1, 0xFCFFA4,
+};
+
+static const unsigned plasma_table[256] =
+{
+	0x0D0887, 0x100788, 0x130789, 0x16078A, 0x19068C, 0x1B068D, 0x1D068E, 0x20068F, 0x220690, 0x240691, 0x260591, 0x280592, 0x2A0593, 0x2C0594, 0x2E0595, 0x2F0596,
+	0x310597, 0x330597, 0x350498, 0x370499, 0x38049A, 0x3A049A, 0x3C049B, 0x3E049C, 0x3F049C, 0x41049D, 0x43039E, 0x44039E, 0x46039F, 0x48039F, 0x4903A0, 0x4B03A1,
+	0x4C02A1, 0x4E02A2, 0x5002A2, 0x5102A3, 0x5302A3, 0x5502A4, 0x5601A4, 0x5801A4, 0x5901A5, 0x5B01A5, 0x5C01A6, 0x5E01A6, 0x6001A6, 0x6100A7, 0x6300A7, 0x6400A7,
+	0x6600A7, 0x6700A8, 0x6900A8, 0x6A00A8, 0x6C00A8, 0x6E00A8, 0x6F00A8, 0x7100A8, 0x7201A8, 0x7401A8, 0x7501A8, 0x7701A8, 0x7801A8, 0x7A02A8, 0x7B02A8, 0x7D03A8,
+	0x7E03A8, 0x8004A8, 0x8104A7, 0x8305A7, 0x8405A7, 0x8606A6, 0x8707A6, 0x8808A6, 0x8A09A5, 0x8B0AA5, 0x8D0BA5, 0x8E0CA4, 0x8F0DA4, 0x910EA3, 0x920FA3, 0x9410A2,
+	0x9511A1, 0x9613A1, 0x9814A0, 0x99159F, 0x9A169F, 0x9C179E, 0x9D189D, 0x9E199D, 0xA01A9C, 0xA11B9B, 0xA21D9A, 0xA31E9A, 0xA51F99, 0xA62098, 0xA72197, 0xA82296,
+	0xAA2395, 0xAB2494, 0xAC2694, 0xAD2793, 0xAE2892, 0xB02991, 0xB12A90, 0xB22B8F, 0xB32C8E, 0xB42E8D, 0xB52F8C, 0xB6308B, 0xB7318A, 0xB83289, 0xBA3388, 0xBB3488,
+	0xBC3587, 0xBD3786, 0xBE3885, 0xBF3984, 0xC03A83, 0xC13B82, 0xC23C81, 0xC33D80, 0xC43E7F, 0xC5407E, 0xC6417D, 0xC7427C, 0xC8437B, 0xC9447A, 0xCA457A, 0xCB4679,
+	0xCC4778, 0xCC4977, 0xCD4A76, 0xCE4B75, 0xCF4C74, 0xD04D73, 0xD14E72, 0xD24F71, 0xD35171, 0xD45270, 0xD5536F, 0xD5546E, 0xD6556D, 0xD7566C, 0xD8576B, 0xD9586A,
+	0xDA5A6A, 0xDA5B69, 0xDB5C68, 0xDC5D67, 0xDD5E66, 0xDE5F65, 0xDE6164, 0xDF6263, 0xE06363, 0xE16462, 0xE26561, 0xE26660, 0xE3685F, 0xE4695E, 0xE56A5D, 0xE56B5D,
+	0xE66C5C, 0xE76E5B, 0xE76F5A, 0xE87059, 0xE97158, 0xE97257, 0xEA7457, 0xEB7556, 0xEB7655, 0xEC7754, 0xED7953, 0xED7A52, 0xEE7B51, 0xEF7C51, 0xEF7E50, 0xF07F4F,
+	0xF0804E, 0xF1814D, 0xF1834C, 0xF2844B, 0xF3854B, 0xF3874A, 0xF48849, 0xF48948, 0xF58B47, 0xF58C46, 0xF68D45, 0xF68F44, 0xF79044, 0xF79143, 0xF79342, 0xF89441,
+	0xF89540, 0xF9973F, 0xF9983E, 0xF99A3E, 0xFA9B3D, 0xFA9C3C, 0xFA9E3B, 0xFB9F3A, 0xFBA139, 0xFBA238, 0xFCA338, 0xFCA537, 0xFCA636, 0xFCA835, 0xFCA934, 0xFDAB33,
+	0xFDAC33, 0xFDAE32, 0xFDAF31, 0xFDB130, 0xFDB22F, 0xFDB42F, 0xFDB52E, 0xFEB72D, 0xFEB82C, 0xFEBA2C, 0xFEBB2B, 0xFEBD2A, 0xFEBE2A, 0xFEC029, 0xFDC229, 0xFDC328,
+	0xFDC527, 0xFDC627, 0xFDC827, 0xFDCA26, 0xFDCB26, 0xFCCD25, 0xFCCE25, 0xFCD025, 0xFCD225, 0xFBD324, 0xFBD524, 0xFBD724, 0xFAD824, 0xFADA24, 0xF9DC24, 0xF9DD25,
+	0xF8DF25, 0xF8E125, 0xF7E225, 0xF7E425, 0xF6E626, 0xF6E826, 0xF5E926, 0xF5EB27, 0xF4ED27, 0xF3EE27, 0xF3F027, 0xF2F227, 0xF1F426, 0xF1F525, 0xF0F724, 0xF0F921,
+};
+
+static const unsigned turbo_table[256] =
+{
+	0x30123B, 0x321543, 0x33184A, 0x341B51, 0x351E58, 0x36215F, 0x372466, 0x38276D, 0x392A73, 0x3A2D79, 0x3B2F80, 0x3C3286, 0x3D358B, 0x3E3891, 0x3F3B97, 0x3F3E9C,
+	0x4040A2, 0x4143A7, 0x4146AC, 0x4249B1, 0x424BB5, 0x434EBA, 0x4451BF, 0x4454C3, 0x4456C7, 0x4559CB, 0x455CCF, 0x455ED3, 0x4661D6, 0x4664DA, 0x4666DD, 0x4669E0,
+	0x466BE3, 0x476EE6, 0x4771E9, 0x4773EB, 0x4776EE, 0x4778F0, 0x477BF2, 0x467DF4, 0x4680F6, 0x4682F8, 0x4685FA, 0x4687FB, 0x458AFC, 0x458CFD, 0x448FFE, 0x4391FE,
+	0x4294FF, 0x4196FF, 0x4099FF, 0x3E9BFE, 0x3D9EFE, 0x3BA0FD, 0x3AA3FC, 0x38A5FB, 0x37A8FA, 0x35ABF8, 0x33ADF7, 0x31AFF5, 0x2FB2F4, 0x2EB4F2, 0x2CB7F0, 0x2AB9EE,
+	0x28BCEB, 0x27BEE9, 0x25C0E7, 0x23C3E4, 0x22C5E2, 0x20C7DF, 0x1FC9DD, 0x1ECBDA, 0x1CCDD8, 0x1BD0D5, 0x1AD2D2, 0x1AD4D0, 0x19D5CD, 0x18D7CA, 0x18D9C8, 0x18DBC5,
+	0x18DDC2, 0x18DEC0, 0x18E0BD, 0x19E2BB, 0x19E3B9, 0x1AE4B6, 0x1CE6B4, 0x1DE7B2, 0x1FE9AF, 0x20EAAC, 0x22EBAA, 0x25ECA7, 0x27EEA4, 0x2AEFA1, 0x2CF09E, 0x2FF19B,
+	0x32F298, 0x35F394, 0x38F491, 0x3CF58E, 0x3FF68A, 0x43F787, 0x46F884, 0x4AF880, 0x4EF97D, 0x52FA7A, 0x55FA76, 0x59FB73, 0x5DFC6F, 0x61FC6C, 0x65FD69, 0x69FD66,
+	0x6DFE62, 0x71FE5F, 0x75FE5C, 0x79FE59, 0x7DFF56, 0x80FF53, 0x84FF51, 0x88FF4E, 0x8BFF4B, 0x8FFF49, 0x92FF47, 0x96FE44, 0x99FE42, 0x9CFE40, 0x9FFD3F, 0xA1FD3D,
+	0xA4FC3C, 0xA7FC3A, 0xA9FB39, 0xACFB38, 0xAFFA37, 0xB1F936, 0xB4F836, 0xB7F735, 0xB9F635, 0xBCF534, 0xBEF434, 0xC1F334, 0xC3F134, 0xC6F034, 0xC8EF34, 0xCBED34,
+	0xCDEC34, 0xD0EA34, 0xD2E935, 0xD4E735, 0xD7E535, 0xD9E436, 0xDBE236, 0xDDE037, 0xDFDF37, 0xE1DD37, 0xE3DB38, 0xE5D938, 0xE7D739, 0xE9D539, 0xEBD339, 0xECD13A,
+	0xEECF3A, 0xEFCD3A, 0xF1CB3A, 0xF2C93A, 0xF4C73A, 0xF5C53A, 0xF6C33A, 0xF7C13A, 0xF8BE39, 0xF9BC39, 0xFABA39, 0xFBB838, 0xFBB637, 0xFCB336, 0xFCB136, 0xFDAE35,
+	0xFDAC34, 0xFEA933, 0xFEA732, 0xFEA431, 0xFEA130, 0xFE9E2F, 0xFE9B2D, 0xFE992C, 0xFE962B, 0xFE932A, 0xFE9029, 0xFD8D27, 0xFD8A26, 0xFC8725, 0xFC8423, 0xFB8122,
+	0xFB7E21, 0xFA7B1F, 0xF9781E, 0xF9751D, 0xF8721C, 0xF76F1A, 0xF66C19, 0xF56918, 0xF46617, 0xF36315, 0xF26014, 0xF15D13, 0xF05B12, 0xEF5811, 0xED5510, 0xEC530F,
+	0xEB500E, 0xEA4E0D, 0xE84B0C, 0xE7490C, 0xE5470B, 0xE4450A, 0xE2430A, 0xE14109, 0xDF3F08, 0xDD3D08, 0xDC3B07, 0xDA3907, 0xD83706, 0xD63506, 0xD43305, 0xD23105,
+	0xD02F05, 0xCE2D04, 0xCC2B04, 0xCA2A04, 0xC82803, 0xC52603, 0xC32503, 0xC12302, 0xBE2102, 0xBC2002, 0xB91E02, 0xB71D02, 0xB41B01, 0xB21A01, 0xAF1801, 0xAC1701,
+	0xA91601, 0xA71401, 0xA41301, 0xA11201, 0x9E1001, 0x9B0F01, 0x980E01, 0x950D01, 0x920B01, 0x8E0A01, 0x8B0902, 0x880802, 0x850702, 0x810602, 0x7E0502, 0x7A0403,
+};
+
+static const unsigned coolwarm_table[256] =
+{
+	0x3B4CC0, 0x3C4EC2, 0x3D50C3, 0x3E51C5, 0x3F53C6, 0x4055C8, 0x4257C9, 0x4358CB, 0x445ACC, 0x455CCE, 0x465ECF, 0x485FD1, 0x4961D2, 0x4A63D3, 0x4B64D5, 0x4C66D6,
+	0x4E68D8, 0x4F69D9, 0x506BDA, 0x516DDB, 0x536EDD, 0x5470DE, 0x5572DF, 0x5673E0, 0x5875E1, 0x5977E3, 0x5A78E4, 0x5B7AE5, 0x5D7CE6, 0x5E7DE7, 0x5F7FE8, 0x6180E9,
+	0x6282EA, 0x6384EB, 0x6485EC, 0x6687ED, 0x6788EE, 0x688AEF, 0x6A8BEF, 0x6B8DF0, 0x6C8FF1, 0x6E90F2, 0x6F92F3, 0x7093F3, 0x7295F4, 0x7396F5, 0x7597F6, 0x7699F6,
+	0x779AF7, 0x799CF8, 0x7A9DF8, 0x7B9FF9, 0x7DA0F9, 0x7EA1FA, 0x80A3FA, 0x81A4FB, 0x82A6FB, 0x84A7FC, 0x85A8FC, 0x86A9FC, 0x88ABFD, 0x89ACFD, 0x8BADFD, 0x8CAFFE,
+	0x8DB0FE, 0x8FB1FE, 0x90B2FE, 0x92B4FE, 0x93B5FE, 0x94B6FF, 0x96B7FF, 0x97B8FF, 0x98B9FF, 0x9ABBFF, 0x9BBCFF, 0x9DBDFF, 0x9EBEFF, 0x9FBFFF, 0xA1C0FF, 0xA2C1FF,
+	0xA3C2FE, 0xA5C3FE, 0xA6C4FE, 0xA7C5FE, 0xA9C6FD, 0xAAC7FD, 0xABC8FD, 0xADC9FD, 0xAEC9FC, 0xAFCAFC, 0xB1CBFC, 0xB2CCFB, 0xB3CDFB, 0xB5CDFA, 0xB6CEFA, 0xB7CFF9,
+	0xB9D0F9, 0xBAD0F8, 0xBBD1F8, 0xBCD2F7, 0xBED2F6, 0xBFD3F6, 0xC0D4F5, 0xC1D4F4, 0xC3D5F4, 0xC4D5F3, 0xC5D6F2, 0xC6D6F1, 0xC7D7F0, 0xC9D7F0, 0xCAD8EF, 0xCBD8EE,
+	0xCCD9ED, 0xCDD9EC, 0xCEDAEB, 0xCFDAEA, 0xD1DAE9, 0xD2DBE8, 0xD3DBE7, 0xD4DBE6, 0xD5DBE5, 0xD6DCE4, 0xD7DCE3, 0xD8DCE2, 0xD9DCE1, 0xDADCE0, 0xDBDCDE, 0xDCDDDD,
+	0xDDDCDC, 0xDEDCDB, 0xDFDBD9, 0xE0DBD8, 0xE1DAD6, 0xE2DAD5, 0xE3D9D3, 0xE4D9D2, 0xE5D8D1, 0xE6D7CF, 0xE7D7CE, 0xE8D6CC, 0xE9D5CB, 0xEAD5C9, 0xEAD4C8, 0xEBD3C6,
+	0xECD3C5, 0xEDD2C3, 0xEDD1C2, 0xEED0C0, 0xEFCFBF, 0xEFCEBD, 0xF0CDBB, 0xF1CDBA, 0xF1CCB8, 0xF2CBB7, 0xF2CAB5, 0xF2C9B4, 0xF3C8B2, 0xF3C7B1, 0xF4C6AF, 0xF4C5AD,
+	0xF5C4AC, 0xF5C2AA, 0xF5C1A9, 0xF5C0A7, 0xF6BFA6, 0xF6BEA4, 0xF6BDA2, 0xF7BCA1, 0xF7BA9F, 0xF7B99E, 0xF7B89C, 0xF7B79B, 0xF7B599, 0xF7B497, 0xF7B396, 0xF7B194,
+	0xF7B093, 0xF7AF91, 0xF7AD90, 0xF7AC8E, 0xF7AA8C, 0xF7A98B, 0xF7A889, 0xF7A688, 0xF6A586, 0xF6A385, 0xF6A283, 0xF5A081, 0xF59F80, 0xF59D7E, 0xF59C7D, 0xF49A7B,
+	0xF4987A, 0xF39778, 0xF39577, 0xF39475, 0xF29274, 0xF29072, 0xF18F71, 0xF18D6F, 0xF08B6E, 0xF08A6C, 0xEF886B, 0xEE8669, 0xEE8468, 0xED8366, 0xEC8165, 0xEC7F63,
+	0xEB7D62, 0xEA7B60, 0xE97A5F, 0xE9785D, 0xE8765C, 0xE7745B, 0xE67259, 0xE57058, 0xE46E56, 0xE36C55, 0xE36B54, 0xE26952, 0xE16751, 0xE0654F, 0xDF634E, 0xDE614D,
+	0xDD5F4B, 0xDC5D4A, 0xDA5A49, 0xD95847, 0xD85646, 0xD75445, 0xD65244, 0xD55042, 0xD44E41, 0xD24B40, 0xD1493F, 0xD0473D, 0xCF453C, 0xCD423B, 0xCC403A, 0xCB3E38,
+	0xCA3B37, 0xC83836, 0xC73635, 0xC53334, 0xC43032, 0xC32E31, 0xC12B30, 0xC0282F, 0xBE242E, 0xBD1F2D, 0xBB1B2C, 0xBA162B, 0xB8122A, 0xB70D28, 0xB50927, 0xB40426,
+};
+
+static const unsigned red_blue_table[256] =
+{
+	0x053061, 0x063264, 0x073467, 0x08366A, 0x09386D, 0x0A3B70, 0x0C3D73, 0x0D3F76, 0x0E4179, 0x0F437B, 0x10457E, 0x114781, 0x124984, 0x134C87, 0x144E8A, 0x15508D,
+	0x175290, 0x185493, 0x195696, 0x1A5899, 0x1B5A9C, 0x1C5C9F, 0x1D5FA2, 0x1E61A5, 0x1F63A8, 0x2065AB, 0x2267AC, 0x2369AD, 0x246AAE, 0x266CAF, 0x276EB0, 0x2870B1,
+	0x2A71B2, 0x2B73B3, 0x2C75B4, 0x2E77B5, 0x2F79B5, 0x307AB6, 0x327CB7, 0x337EB8, 0x3480B9, 0x3681BA, 0x3783BB, 0x3885BC, 0x3A87BD, 0x3B88BE, 0x3C8ABE, 0x3E8CBF,
+	0x3F8EC0, 0x408FC1, 0x4291C2, 0x4393C3, 0x4695C4, 0x4997C5, 0x4C99C6, 0x4F9BC7, 0x529DC8, 0x569FC9, 0x59A1CA, 0x5CA3CB, 0x5FA5CD, 0x62A7CE, 0x65A9CF, 0x68ABD0,
+	0x6BACD1, 0x6EAED2, 0x71B0D3, 0x75B2D4, 0x78B4D5, 0x7BB6D6, 0x7EB8D7, 0x81BAD8, 0x84BCD9, 0x87BEDA, 0x8AC0DB, 0x8DC2DC, 0x90C4DD, 0x93C6DE, 0x96C7DF, 0x98C8E0,
+	0x9BC9E0, 0x9DCBE1, 0xA0CCE2, 0xA2CDE3, 0xA5CEE3, 0xA7D0E4, 0xA9D1E5, 0xACD2E5, 0xAED3E6, 0xB1D5E7, 0xB3D6E8, 0xB6D7E8, 0xB8D8E9, 0xBBDAEA, 0xBDDBEA, 0xC0DCEB,
+	0xC2DDEC, 0xC5DFEC, 0xC7E0ED, 0xCAE1EE, 0xCCE2EF, 0xCFE4EF, 0xD1E5F0, 0xD2E6F0, 0xD4E6F1, 0xD5E7F1, 0xD7E8F1, 0xD8E9F1, 0xDAE9F2, 0xDBEAF2, 0xDDEBF2, 0xDEEBF2,
+	0xE0ECF3, 0xE1EDF3, 0xE3EDF3, 0xE4EEF4, 0xE6EFF4, 0xE7F0F4, 0xE9F0F4, 0xEAF1F5, 0xECF2F5, 0xEDF2F5, 0xEFF3F5, 0xF0F4F6, 0xF2F5F6, 0xF3F5F6, 0xF5F6F7, 0xF6F7F7,
+	0xF7F6F6, 0xF7F5F4, 0xF8F4F2, 0xF8F3F0, 0xF8F2EF, 0xF8F1ED, 0xF9F0EB, 0xF9EFE9, 0xF9EEE7, 0xF9EDE5, 0xF9EBE3, 0xFAEAE1, 0xFAE9DF, 0xFAE8DE, 0xFAE7DC, 0xFBE6DA,
+	0xFBE5D8, 0xFBE4D6, 0xFBE3D4, 0xFCE2D2, 0xFCE0D0, 0xFCDFCF, 0xFCDECD, 0xFDDDCB, 0xFDDCC9, 0xFDDBC7, 0xFDD9C4, 0xFCD7C2, 0xFCD5BF, 0xFCD3BC, 0xFBD0B9, 0xFBCEB7,
+	0xFBCCB4, 0xFACAB1, 0xFAC8AF, 0xF9C6AC, 0xF9C4A9, 0xF9C2A7, 0xF8BFA4, 0xF8BDA1, 0xF8BB9E, 0xF7B99C, 0xF7B799, 0xF7B596, 0xF6B394, 0xF6B191, 0xF6AF8E, 0xF5AC8B,
+	0xF5AA89, 0xF5A886, 0xF4A683, 0xF3A481, 0xF2A17F, 0xF19E7D, 0xF09C7B, 0xEF9979, 0xEE9677, 0xEC9374, 0xEB9172, 0xEA8E70, 0xE98B6E, 0xE8896C, 0xE6866A, 0xE58368,
+	0xE48066, 0xE37E64, 0xE27B62, 0xE17860, 0xDF765E, 0xDE735C, 0xDD7059, 0xDC6E57, 0xDB6B55, 0xDA6853, 0xD86551, 0xD7634F, 0xD6604D, 0xD55D4C, 0xD35A4A, 0xD25849,
+	0xD05548, 0xCF5246, 0xCE4F45, 0xCC4C44, 0xCB4942, 0xC94741, 0xC84440, 0xC6413E, 0xC53E3D, 0xC43B3C, 0xC2383A, 0xC13639, 0xBF3338, 0xBE3036, 0xBD2D35, 0xBB2A34,
+	0xBA2832, 0xB82531, 0xB72230, 0xB61F2E, 0xB41C2D, 0xB3192C, 0xB1182B, 0xAE172A, 0xAB162A, 0xA81529, 0xA51429, 0xA21328, 0x9F1228, 0x9C1127, 0x991027, 0x960F27,
+	0x930E26, 0x900D26, 0x8D0C25, 0x8A0B25, 0x870A24, 0x840924, 0x810823, 0x7F0823, 0x7C0722, 0x790622, 0x760521, 0x730421, 0x700320, 0x6D0220, 0x6A011F, 0x67001F,
+};
+
+// Returns the table of the built in gradient, or null if it is not defined by a table.
+
+static const unsigned* builtin_table(COLORMAP map)
+{
+	switch (map)
+	{
+	case COLORMAP_VIRIDIS:		return viridis_table;
+	case COLORMAP_MAGMA:		return magma_table;
+	case COLORMAP_INFERNO:		return inferno_table;
+	case COLORMAP_PLASMA:		return plasma_table;
+	case COLORMAP_TURBO:		return turbo_table;
+	case COLORMAP_COOLWARM:		return coolwarm_table;
+	case COLORMAP_RED_BLUE:		return red_blue_table;
+	default:					return nullptr;
+	}
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Lookup kernel
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Maps the values to the table entries and copies them to the output, that has the stride
+// in bytes specified. Values are scaled to the table and clamped to it, four at a time with 
+// SIMD, and the clamp sends NaN values to the first entry. The copies are single loads and
+// stores, so the whole cost is a few instructions per value.
+
+template<typename T>
+static void map_values(const float* values, const T* table, unsigned size, float min_value, float max_value, unsigned count, unsigned char* out, unsigned stride)
+{
+	const float scale = max_value != min_value ? (size - 1u) / (max_value - min_value) : 0.f;
+	const float top = size - 0.5f;
+
+	unsigned i = 0u;
+#if defined _COLORMAP_SSE2
+	const __m128 v_min = _mm_set1_ps(min_value);
+	const __m128 v_scale = _mm_set1_ps(scale);
+	const __m128 v_half = _mm_set1_ps(0.5f);
+	const __m128 v_zero = _mm_setzero_ps();
+	const __m128 v_top = _mm_set1_ps(top);
+
+	for (; i + 4u <= count; i += 4u)
+	{
+		__m128 t = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(values + i), v_min), v_scale), v_half);
+
+		// The maximum returns the second operand if the first one is NaN.
+		t = _mm_min_ps(_mm_max_ps(t, v_zero), v_top);
+
+		alignas(16) int32_t index[4];
+		_mm_store_si128((__m128i*)index, _mm_cvttps_epi32(t));
+
+		*(T*)(out + (i + 0u) * stride) = table[index[0]];
+		*(T*)(out + (i + 1u) * stride) = table[index[1]];
+		*(T*)(out + (i + 2u) * stride) = table[index[2]];
+		*(T*)(out + (i + 3u) * stride) = table[index[3]];
+	}
+#elif defined _COLORMAP_NEON
+	const float32x4_t v_min = vdupq_n_f32(min_value);
+	const float32x4_t v_scale = vdupq_n_f32(scale);
+	const float32x4_t v_half = vdupq_n_f32(0.5f);
+	const float32x4_t v_zero = vdupq_n_f32(0.f);
+	const float32x4_t v_top = vdupq_n_f32(top);
+
+	for (; i + 4u <= count; i += 4u)
+	{
+		float32x4_t t = vmlaq_f32(v_half, vsubq_f32(vld1q_f32(values + i), v_min), v_scale);
+
+		// The number maximum returns the number if the other operand is NaN.
+		t = vminq_f32(vmaxnmq_f32(t, v_zero), v_top);
+
+		uint32_t index[4];
+		vst1q_u32(index, vcvtq_u32_f32(t));
+
+		*(T*)(out + (i + 0u) * stride) = table[index[0]];
+		*(T*)(out + (i + 1u) * stride) = table[index[1]];
+		*(T*)(out + (i + 2u) * stride) = table[index[2]];
+		*(T*)(out + (i + 3u) * stride) = table[index[3]];
+	}
+#endif
+	for (; i < count; i++)
+	{
+		float t = (values[i] - min_value) * scale + 0.5f;
+		t = t > 0.f ? t : 0.f;
+		t = t < top ? t : top;
+
+		*(T*)(out + i * stride) = table[unsigned(t)];
+	}
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Colormap functions
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Creates the table of the built in gradient with the number of colors specified.
+
+Colormap::Colormap(COLORMAP map, unsigned size)
+{
+	generate(map, size);
+}
+
+// Creates the table of a custom gradient from a list of colors at the positions from 0
+// to 1 specified, in increasing order. If the position list is null the colors are
+// equally spaced. Colors are interpolated in between and extended past the ends.
+
+Colormap::Colormap(const Color* colors, unsigned count, const float* positions, unsigned size)
+{
+	generate(colors, count, positions, size);
+}
+
+// Copies the table of the other colormap.
+
+Colormap::Colormap(const Colormap& other)
+{
+	*this = other;
+}
+
+// Copies the table of the other colormap.
+
+Colormap& Colormap::operator=(const Colormap& other)
+{
+	if (this == &other)
+		return *this;
+
+	if (size_ != other.size_)
+	{
+		delete[] colors_;
+		delete[] colors4_;
+
+		size_ = other.size_;
+		colors_ = size_ ? new Color[size_] : nullptr;
+		colors4_ = size_ ? new _float4color[size_] : nullptr;
+	}
+
+	for (unsigned i = 0u; i < size_; i++)
+	{
+		colors_[i] = other.colors_[i];
+		colors4_[i] = other.colors4_[i];
+	}
+	return *this;
+}
+
+// Frees the table.
+
+Colormap::~Colormap()
+{
+	delete[] colors_;
+	delete[] colors4_;
+}
+
+// Replaces the table with the one of the built in gradient specified.
+
+void Colormap::generate(COLORMAP map, unsigned size)
+{
+	if (map == COLORMAP_GRAYSCALE)
+	{
+		const Color ends[2] = { Color::Black, Color::White };
+		return generate(ends, 2u, nullptr, size);
+	}
+
+	const unsigned* table = builtin_table(map);
+
+	USER_CHECK(table,
+		"Unknown built in gradient found when trying to generate a Colormap."
+	);
+
+	Color colors[256];
+	for (unsigned i = 0u; i < 256u; i++)
+		colors[i] = Color((table[i] >> 16) & 0xFFu, (table[i] >> 8) & 0xFFu, table[i] & 0xFFu);
+
+	generate(colors, 256u, nullptr, size);
+}
+
+// Replaces the table with the one of the custom gradient specified.
+
+void Colormap::generate(const Color* colors, unsigned count, const float* positions, unsigned size)
+{
+	USER_CHECK(colors && count,
+		"Found an empty color list when trying to generate a Colormap."
+	);
+
+	USER_CHECK(size >= 2u,
+		"Found a table size smaller than two when trying to generate a Colormap."
+	);
+
+	if (positions)
+		for (unsigned k = 1u; k < count; k++)
+			USER_CHECK(positions[k] >= positions[k - 1u],
+				"Found a position list that is not in increasing order when trying to generate a Colormap."
+			);
+
+	if (size_ != size)
+	{
+		delete[] colors_;
+		delete[] colors4_;
+
+		size_ = size;
+		colors_ = new Color[size_];
+		colors4_ = new _float4color[size_];
+	}
+
+	// Walk the control colors along the table, interpolating every entry between the
+	// two colors around it, or copying the closest one past the ends.
+	auto position = [&](unsigned n) { return positions ? positions[n] : (count > 1u ? n / float(count - 1u) : 0.f); };
+
+	unsigned k = 0u;
+	for (unsigned i = 0u; i < size_; i++)
+	{
+		const float t = i / float(size_ - 1u);
+
+		while (k + 1u < count && position(k + 1u) <= t)
+			k++;
+
+		if (k + 1u >= count || t <= position(k))
+			colors_[i] = colors[k];
+		else
+		{
+			const float w = (t - position(k)) / (position(k + 1u) - position(k));
+			const Color& c0 = colors[k];
+			const Color& c1 = colors[k + 1u];
+
+			colors_[i] = Color(
+				(unsigned char)(c0.R + (c1.R - c0.R) * w + 0.5f),
+				(unsigned char)(c0.G + (c1.G - c0.G) * w + 0.5f),
+				(unsigned char)(c0.B + (c1.B - c0.B) * w + 0.5f),
+				(unsigned char)(c0.A + (c1.A - c0.A) * w + 0.5f)
+			);
+		}
+		colors4_[i] = colors_[i].getColor4();
+	}
+}
+
+// Returns the color of a single value in the range specified.
+
+Color Colormap::operator()(float value, float min_value, float max_value) const
+{
+	Color color;
+	map(&value, &color, 1u, min_value, max_value);
+	return color;
+}
+
+// Maps the list of values to colors with the range specified, several values at once.
+
+void Colormap::map(const float* values, Color* colors, unsigned count, float min_value, float max_value) const
+{
+	USER_CHECK(size_,
+		"Trying to map values with an empty Colormap."
+	);
+
+	USER_CHECK(values && colors,
+		"Found nullptr when trying to map a list of values with a Colormap."
+	);
+
+	map_values(values, colors_, size_, min_value, max_value, count, (unsigned char*)colors, sizeof(Color));
+}
+
+// Maps the list of values to float colors with the range specified. The stride is the
+// distance in bytes between the output colors, so that they can be written directly
+// inside of interleaved vertex arrays.
+
+void Colormap::map(const float* values, _float4color* colors, unsigned count, float min_value, float max_value, unsigned stride) const
+{
+	USER_CHECK(size_,
+		"Trying to map values with an empty Colormap."
+	);
+
+	USER_CHECK(values && colors,
+		"Found nullptr when trying to map a list of values with a Colormap."
+	);
+
+	map_values(values, colors4_, size_, min_value, max_value, count, (unsigned char*)colors, stride);
+}
+
+// Finds the minimum and maximum values of the list, ignoring NaN and infinite values.
+// If the list has no finite values both are set to zero.
+
+void Colormap::findRange(const float* values, unsigned count, float* min_value, float* max_value)
+{
+	USER_CHECK(values && min_value && max_value,
+		"Found nullptr when trying to find the range of a list of values."
+	);
+
+	float lo = INFINITY;
+	float hi = -INFINITY;
+
+	unsigned i = 0u;
+#if defined _COLORMAP_SSE2
+	// Values that are not finite are replaced by the starting values before comparing.
+	const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 v_inf = _mm_set1_ps(INFINITY);
+	__m128 v_lo = v_inf;
+	__m128 v_hi = _mm_set1_ps(-INFINITY);
+	for (; i + 4u <= count; i += 4u)
+	{
+		const __m128 v = _mm_loadu_ps(values + i);
+		const __m128 finite = _mm_cmplt_ps(_mm_and_ps(v, abs_mask), v_inf);
+		v_lo = _mm_min_ps(v_lo, _mm_or_ps(_mm_and_ps(finite, v), _mm_andnot_ps(finite, v_inf)));
+		v_hi = _mm_max_ps(v_hi, _mm_or_ps(_mm_and_ps(finite, v), _mm_andnot_ps(finite, _mm_sub_ps(_mm_setzero_ps(), v_inf))));
+	}
+
+	alignas(16) float lanes_lo[4], lanes_hi[4];
+	_mm_store_ps(lanes_lo, v_lo);
+	_mm_store_ps(lanes_hi, v_hi);
+	for (unsigned l = 0u; l < 4u; l++)
+	{
+		lo = lanes_lo[l] < lo ? lanes_lo[l] : lo;
+		hi = lanes_hi[l] > hi ? lanes_hi[l] : hi;
+	}
+#elif defined _COLORMAP_NEON
+	// Values that are not finite are replaced by the starting values before comparing.
+	const float32x4_t v_inf = vdupq_n_f32(INFINITY);
+	float32x4_t v_lo = v_inf;
+	float32x4_t v_hi = vdupq_n_f32(-INFINITY);
+	for (; i + 4u <= count; i += 4u)
+	{
+		const float32x4_t v = vld1q_f32(values + i);
+		const uint32x4_t finite = vcltq_f32(vabsq_f32(v), v_inf);
+		v_lo = vminq_f32(v_lo, vbslq_f32(finite, v, v_inf));
+		v_hi = vmaxq_f32(v_hi, vbslq_f32(finite, v, vnegq_f32(v_inf)));
+	}
+	lo = vminvq_f32(v_lo);
+	hi = vmaxvq_f32(v_hi);
+#endif
+	for (; i < count; i++)
+	{
+		if (!(fabsf(values[i]) < INFINITY))
+			continue;
+
+		lo = values[i] < lo ? values[i] : lo;
+		hi = values[i] > hi ? values[i] : hi;
+	}
+
+	if (lo > hi)
+		lo = hi = 0.f;
+
+	*min_value = lo;
+	*max_value = hi;
+}
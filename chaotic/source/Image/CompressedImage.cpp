@@ -0,0 +1,1080 @@
+#include "Image/Image.h"
+
+#include "Error/_erDefault.h"
+#include "ThreadPool.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Block helpers
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Rows of blocks encoded by every thread pool task.
+#define BLOCK_ROW_CHUNK 8u
+
+// Refinement passes of the endpoints, every pass fits them to the chosen indices.
+#define BC1_REFINE_PASSES 2u
+#define BC7_REFINE_PASSES 3u
+
+// Pixels of a block as RGBA bytes, in row order.
+typedef uint8_t BlockPixels[16][4];
+
+// Reads the pixels of the block at the specified block coordinates, the pixels outside
+// the view, in levels smaller than a block, repeat the ones at the edge.
+
+static void read_block(const ImageView& view, unsigned bx, unsigned by, BlockPixels& px)
+{
+	for (unsigned y = 0u; y < 4u; y++)
+	{
+		const Color* row = view.row(std::min(by * 4u + y, view.height() - 1u));
+		for (unsigned x = 0u; x < 4u; x++)
+		{
+			const Color c = row[std::min(bx * 4u + x, view.width() - 1u)];
+			px[y * 4u + x][0] = c.R;
+			px[y * 4u + x][1] = c.G;
+			px[y * 4u + x][2] = c.B;
+			px[y * 4u + x][3] = c.A;
+		}
+	}
+}
+
+// Finds the principal axis of the points, the direction along which they spread the most,
+// by power iteration on their covariance matrix. Also writes the mean of the points.
+
+template<unsigned N>
+static void principal_axis(const float (*points)[N], unsigned count, float mean[N], float axis[N])
+{
+	for (unsigned c = 0u; c < N; c++)
+	{
+		mean[c] = 0.f;
+		for (unsigned i = 0u; i < count; i++)
+			mean[c] += points[i][c];
+		mean[c] /= count;
+	}
+
+	float cov[N][N] = {};
+	for (unsigned i = 0u; i < count; i++)
+		for (unsigned a = 0u; a < N; a++)
+			for (unsigned b = a; b < N; b++)
+				cov[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+	for (unsigned a = 0u; a < N; a++)
+		for (unsigned b = 0u; b < a; b++)
+			cov[a][b] = cov[b][a];
+
+	// Starts from the covariance column of the channel with the biggest variance
+	unsigned widest = 0u;
+	for (unsigned c = 1u; c < N; c++)
+		if (cov[c][c] > cov[widest][widest])
+			widest = c;
+	for (unsigned c = 0u; c < N; c++)
+		axis[c] = cov[c][widest];
+	for (unsigned iteration = 0u; iteration < 8u; iteration++)
+	{
+		float next[N] = {};
+		float length = 0.f;
+		for (unsigned a = 0u; a < N; a++)
+		{
+			for (unsigned b = 0u; b < N; b++)
+				next[a] += cov[a][b] * axis[b];
+			length = std::max(length, fabsf(next[a]));
+		}
+		if (length < 1e-6f)
+			break;
+		for (unsigned c = 0u; c < N; c++)
+			axis[c] = next[c] / length;
+	}
+}
+
+// Fits two endpoints to the points along their principal axis, at the extremes of
+// their projections, clamped to the byte range.
+
+template<unsigned N>
+static void fit_endpoints(const float (*points)[N], unsigned count, float e0[N], float e1[N])
+{
+	float mean[N], axis[N];
+	principal_axis<N>(points, count, mean, axis);
+
+	float length = 0.f;
+	for (unsigned c = 0u; c < N; c++)
+		length += axis[c] * axis[c];
+
+	float t_min = 0.f, t_max = 0.f;
+	if (length > 0.f)
+		for (unsigned i = 0u; i < count; i++)
+		{
+			float t = 0.f;
+			for (unsigned c = 0u; c < N; c++)
+				t += (points[i][c] - mean[c]) * axis[c];
+			t /= length;
+			t_min = std::min(t_min, t);
+			t_max = std::max(t_max, t);
+		}
+
+	for (unsigned c = 0u; c < N; c++)
+	{
+		e0[c] = std::min(std::max(mean[c] + t_max * axis[c], 0.f), 255.f);
+		e1[c] = std::min(std::max(mean[c] + t_min * axis[c], 0.f), 255.f);
+	}
+}
+
+// Solves the endpoints that best reproduce the points by least squares, given the weight
+// of the first endpoint in the color chosen by every point. Returns false if the system is
+// singular, when all points chose the same weight.
+
+template<unsigned N>
+static bool least_squares_endpoints(const float (*points)[N], const float* weights, unsigned count, float e0[N], float e1[N])
+{
+	float aa = 0.f, ab = 0.f, bb = 0.f;
+	float ap[N] = {}, bp[N] = {};
+	for (unsigned i = 0u; i < count; i++)
+	{
+		const float a = weights[i], b = 1.f - weights[i];
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (unsigned c = 0u; c < N; c++)
+		{
+			ap[c] += a * points[i][c];
+			bp[c] += b * points[i][c];
+		}
+	}
+
+	const float det = aa * bb - ab * ab;
+	if (fabsf(det) < 1e-6f)
+		return false;
+
+	for (unsigned c = 0u; c < N; c++)
+	{
+		e0[c] = std::min(std::max((ap[c] * bb - bp[c] * ab) / det, 0.f), 255.f);
+		e1[c] = std::min(std::max((bp[c] * aa - ap[c] * ab) / det, 0.f), 255.f);
+	}
+	return true;
+}
+
+// Writes the value in little endian order.
+
+static inline void store_le(uint8_t* p, uint64_t value, unsigned bytes)
+{
+	for (unsigned i = 0u; i < bytes; i++)
+		p[i] = uint8_t(value >> (8u * i));
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ BC1 and BC3 encoding
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Pairs of 5 and 6 bit endpoints whose color at one third of the way reproduces every
+// byte value best, used for blocks of a single color.
+struct SolidColorTables
+{
+	uint8_t match5[256][2];
+	uint8_t match6[256][2];
+
+	static void build(uint8_t (*table)[2], unsigned bits)
+	{
+		const int levels = 1 << bits;
+		for (int v = 0; v < 256; v++)
+		{
+			int best = 1 << 30;
+			for (int a = 0; a < levels; a++)
+				for (int b = 0; b < levels; b++)
+				{
+					const int ea = bits == 5u ? (a << 3) | (a >> 2) : (a << 2) | (a >> 4);
+					const int eb = bits == 5u ? (b << 3) | (b >> 2) : (b << 2) | (b >> 4);
+
+					// The spread is penalized, decoders round the interpolation differently
+					const int error = abs((2 * ea + eb) / 3 - v) * 100 + abs(ea - eb) * 3;
+					if (error < best)
+					{
+						best = error;
+						table[v][0] = uint8_t(a);
+						table[v][1] = uint8_t(b);
+					}
+				}
+		}
+	}
+
+	SolidColorTables()
+	{
+		build(match5, 5u);
+		build(match6, 6u);
+	}
+};
+
+static const SolidColorTables solid_tables;
+
+// Quantizes the color to the 5:6:5 format of the endpoints.
+
+static inline uint16_t pack_565(const float c[3])
+{
+	const unsigned r = unsigned(c[0] * 31.f / 255.f + 0.5f);
+	const unsigned g = unsigned(c[1] * 63.f / 255.f + 0.5f);
+	const unsigned b = unsigned(c[2] * 31.f / 255.f + 0.5f);
+	return uint16_t((r << 11) | (g << 5) | b);
+}
+
+// Expands the 5:6:5 endpoint to bytes.
+
+static inline void unpack_565(uint16_t v, int c[3])
+{
+	const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+	c[0] = (r << 3) | (r >> 2);
+	c[1] = (g << 2) | (g >> 4);
+	c[2] = (b << 3) | (b >> 2);
+}
+
+// Picks the closest color of the palette the decoders build from the endpoints for every
+// pixel, four colors if c0 > c1, otherwise three colors and a transparent index. Writes
+// the indices and the weight of c0 in every pixel color, returns the squared error.
+
+static unsigned color_indices(const BlockPixels& px, uint16_t c0, uint16_t c1, bool transparent, uint32_t& indices, float weights[16])
+{
+	static constexpr float four_weights[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+	static constexpr float three_weights[4] = { 1.f, 0.f, 0.5f, 0.f };
+
+	int e0[3], e1[3], palette[4][3];
+	unpack_565(c0, e0);
+	unpack_565(c1, e1);
+
+	const bool four = c0 > c1;
+	for (unsigned c = 0u; c < 3u; c++)
+	{
+		palette[0][c] = e0[c];
+		palette[1][c] = e1[c];
+		palette[2][c] = four ? (2 * e0[c] + e1[c]) / 3 : (e0[c] + e1[c]) / 2;
+		palette[3][c] = four ? (e0[c] + 2 * e1[c]) / 3 : 0;
+	}
+	const float* palette_weights = four ? four_weights : three_weights;
+	const unsigned colors = four ? 4u : 3u;
+
+	unsigned error = 0u;
+	indices = 0u;
+	for (unsigned i = 0u; i < 16u; i++)
+	{
+		unsigned best = 0u, best_error = ~0u;
+		if (transparent && px[i][3] < 128u)
+			best = 3u, best_error = 0u;
+		else
+			for (unsigned k = 0u; k < colors; k++)
+			{
+				const int dr = palette[k][0] - px[i][0], dg = palette[k][1] - px[i][1], db = palette[k][2] - px[i][2];
+				const unsigned e = unsigned(dr * dr + dg * dg + db * db);
+				if (e < best_error)
+					best = k, best_error = e;
+			}
+
+		error += best_error;
+		indices |= best << (2u * i);
+		weights[i] = palette_weights[best];
+	}
+	return error;
+}
+
+// Orders the endpoints for the mode required, four colors need c0 > c1 and three colors
+// with transparency need c0 <= c1.
+
+static inline void order_endpoints(uint16_t& c0, uint16_t& c1, bool transparent)
+{
+	if (transparent ? c0 > c1 : c0 < c1)
+		std::swap(c0, c1);
+}
+
+// Encodes the colors of the block as a BC1 color block. If transparency is allowed and
+// some pixel has an alpha below one half the three color mode is used.
+
+static void encode_color_block(const BlockPixels& px, bool allow_transparent, uint8_t* out)
+{
+	bool transparent = false;
+	if (allow_transparent)
+		for (unsigned i = 0u; i < 16u; i++)
+			transparent |= px[i][3] < 128u;
+
+	// Only the visible pixels take part in the fit
+	float points[16][3];
+	unsigned count = 0u;
+	bool solid = true;
+	for (unsigned i = 0u; i < 16u; i++)
+	{
+		if (transparent && px[i][3] < 128u)
+			continue;
+		for (unsigned c = 0u; c < 3u; c++)
+			points[count][c] = px[i][c];
+		solid &= !count || memcmp(px[i], px[0], 3u) == 0;
+		count++;
+	}
+
+	uint16_t c0 = 0u, c1 = 0u;
+	if (!count)
+	{
+		store_le(out, 0u, 4u);
+		store_le(out + 4u, 0xFFFFFFFFu, 4u);
+		return;
+	}
+	else if (solid && !transparent)
+	{
+		const int r = int(points[0][0]), g = int(points[0][1]), b = int(points[0][2]);
+		c0 = uint16_t((solid_tables.match5[r][0] << 11) | (solid_tables.match6[g][0] << 5) | solid_tables.match5[b][0]);
+		c1 = uint16_t((solid_tables.match5[r][1] << 11) | (solid_tables.match6[g][1] << 5) | solid_tables.match5[b][1]);
+	}
+	else
+	{
+		float e0[3], e1[3];
+		fit_endpoints<3>(points, count, e0, e1);
+		c0 = pack_565(e0);
+		c1 = pack_565(e1);
+	}
+	order_endpoints(c0, c1, transparent);
+
+	uint32_t indices;
+	float weights[16];
+	unsigned error = color_indices(px, c0, c1, transparent, indices, weights);
+
+	// Refits the endpoints to the chosen colors while the error improves
+	for (unsigned pass = 0u; pass < BC1_REFINE_PASSES && error && !solid; pass++)
+	{
+		float fit_points[16][3], fit_weights[16];
+		unsigned fit_count = 0u;
+		for (unsigned i = 0u; i < 16u; i++)
+			if (!(transparent && px[i][3] < 128u))
+			{
+				for (unsigned c = 0u; c < 3u; c++)
+					fit_points[fit_count][c] = px[i][c];
+				fit_weights[fit_count++] = weights[i];
+			}
+
+		float e0[3], e1[3];
+		if (!least_squares_endpoints<3>(fit_points, fit_weights, fit_count, e0, e1))
+			break;
+
+		uint16_t n0 = pack_565(e0), n1 = pack_565(e1);
+		order_endpoints(n0, n1, transparent);
+
+		uint32_t new_indices;
+		float new_weights[16];
+		const unsigned new_error = color_indices(px, n0, n1, transparent, new_indices, new_weights);
+		if (new_error >= error)
+			break;
+
+		c0 = n0, c1 = n1, indices = new_indices, error = new_error;
+		memcpy(weights, new_weights, sizeof(weights));
+	}
+
+	store_le(out, c0, 2u);
+	store_le(out + 2u, c1, 2u);
+	store_le(out + 4u, indices, 4u);
+}
+
+// Picks the closest value of the alpha palette for every pixel, writes the 48 bits of
+// indices and returns the squared error.
+
+static unsigned alpha_indices(const BlockPixels& px, const int palette[8], uint64_t& indices)
+{
+	unsigned error = 0u;
+	indices = 0u;
+	for (unsigned i = 0u; i < 16u; i++)
+	{
+		unsigned best = 0u, best_error = ~0u;
+		for (unsigned k = 0u; k < 8u; k++)
+		{
+			const int d = palette[k] - px[i][3];
+			if (unsigned(d * d) < best_error)
+				best = k, best_error = unsigned(d * d);
+		}
+		error += best_error;
+		indices |= uint64_t(best) << (3u * i);
+	}
+	return error;
+}
+
+// Encodes the alpha of the block as a BC3 alpha block. Both modes are tried, eight values
+// between the extremes, or six values with explicit zero and full alpha.
+
+static void encode_alpha_block(const BlockPixels& px, uint8_t* out)
+{
+	int lo = 255, hi = 0, inner_lo = 255, inner_hi = 0;
+	for (unsigned i = 0u; i < 16u; i++)
+	{
+		const int a = px[i][3];
+		lo = std::min(lo, a);
+		hi = std::max(hi, a);
+		if (a != 0 && a != 255)
+		{
+			inner_lo = std::min(inner_lo, a);
+			inner_hi = std::max(inner_hi, a);
+		}
+	}
+
+	if (lo == hi)
+	{
+		out[0] = out[1] = uint8_t(lo);
+		store_le(out + 2u, 0u, 6u);
+		return;
+	}
+
+	// Eight values, a0 > a1
+	int palette[8] = { hi, lo };
+	for (int k = 1; k < 7; k++)
+		palette[k + 1] = ((7 - k) * hi + k * lo + 3) / 7;
+	uint64_t indices;
+	const unsigned error = alpha_indices(px, palette, indices);
+
+	// Six values, a0 <= a1, plus zero and full alpha
+	if (inner_lo > inner_hi)
+		inner_lo = inner_hi = lo;
+	int palette6[8] = { inner_lo, inner_hi, 0, 0, 0, 0, 0, 255 };
+	for (int k = 1; k < 5; k++)
+		palette6[k + 1] = ((5 - k) * inner_lo + k * inner_hi + 2) / 5;
+	uint64_t indices6;
+	const unsigned error6 = alpha_indices(px, palette6, indices6);
+
+	const bool six = error6 < error;
+	out[0] = uint8_t(six ? inner_lo : hi);
+	out[1] = uint8_t(six ? inner_hi : lo);
+	store_le(out + 2u, six ? indices6 : indices, 6u);
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ BC7 encoding
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Interpolation weights of the four bit indices, in 64ths of the second endpoint.
+static constexpr int bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Quantized endpoints of a BC7 mode 6 block, seven bits per channel and a shared low bit.
+struct Bc7Endpoints
+{
+	int q[2][4];		// Seven bit channels
+	int p[2];			// Low bits
+	int value[2][4];	// Eight bit values
+};
+
+// Endpoint pairs close to every byte value that reproduce it exactly at the first eight
+// indices, if any, for both orders of the low bits of the endpoints. Used for blocks of a
+// single color, where the shared low bits do not allow to store the color as it is.
+struct SolidBc7Tables
+{
+	int16_t pair[2][8][256][2];
+
+	SolidBc7Tables()
+	{
+		for (int p = 0; p < 2; p++)
+			for (int k = 0; k < 8; k++)
+				for (int v = 0; v < 256; v++)
+				{
+					int16_t* e = pair[p][k][v];
+					e[0] = e[1] = -1;
+					for (int e0 = (std::max(v - 8, 0) & ~1) | p; e0 <= std::min(v + 8, 255) && e[0] < 0; e0 += 2)
+						for (int e1 = (std::max(v - 8, 0) & ~1) | (p ^ 1); e1 <= std::min(v + 8, 255); e1 += 2)
+							if (((64 - bc7_weights[k]) * e0 + bc7_weights[k] * e1 + 32) >> 6 == v)
+							{
+								e[0] = int16_t(e0);
+								e[1] = int16_t(e1);
+								break;
+							}
+				}
+	}
+};
+
+static const SolidBc7Tables solid_bc7_tables;
+
+// Finds endpoints that reproduce the color of a single color block exactly, at an index
+// whose top bit is zero. Returns false if there are none.
+
+static bool solid_bc7(const BlockPixels& px, Bc7Endpoints& ep, uint8_t indices[16])
+{
+	for (unsigned i = 1u; i < 16u; i++)
+		if (memcmp(px[i], px[0], 4u))
+			return false;
+
+	for (int p = 0; p < 2; p++)
+		for (unsigned k = 0u; k < 8u; k++)
+		{
+			bool exact = true;
+			for (unsigned c = 0u; c < 4u; c++)
+				exact &= solid_bc7_tables.pair[p][k][px[0][c]][0] >= 0;
+			if (!exact)
+				continue;
+
+			ep.p[0] = p;
+			ep.p[1] = p ^ 1;
+			for (unsigned c = 0u; c < 4u; c++)
+			{
+				ep.q[0][c] = solid_bc7_tables.pair[p][k][px[0][c]][0] >> 1;
+				ep.q[1][c] = solid_bc7_tables.pair[p][k][px[0][c]][1] >> 1;
+			}
+			memset(indices, int(k), 16u);
+			return true;
+		}
+	return false;
+}
+
+// Quantizes the endpoints with the low bits specified.
+
+static void quantize_bc7(const float e0[4], const float e1[4], int p0, int p1, Bc7Endpoints& ep)
+{
+	const float* e[2] = { e0, e1 };
+	ep.p[0] = p0;
+	ep.p[1] = p1;
+	for (unsigned k = 0u; k < 2u; k++)
+		for (unsigned c = 0u; c < 4u; c++)
+		{
+			ep.q[k][c] = std::min(std::max(int((e[k][c] - ep.p[k]) * 0.5f + 0.5f), 0), 127);
+			ep.value[k][c] = (ep.q[k][c] << 1) | ep.p[k];
+		}
+}
+
+// Picks the index of every pixel by its projection on the endpoints segment, checking
+// the neighbouring indices, returns the squared error.
+
+static unsigned bc7_indices(const float (*points)[4], const Bc7Endpoints& ep, uint8_t indices[16])
+{
+	float d[4], length = 0.f;
+	for (unsigned c = 0u; c < 4u; c++)
+	{
+		d[c] = float(ep.value[1][c] - ep.value[0][c]);
+		length += d[c] * d[c];
+	}
+
+	unsigned error = 0u;
+	for (unsigned i = 0u; i < 16u; i++)
+	{
+		int guess = 0;
+		if (length > 0.f)
+		{
+			float t = 0.f;
+			for (unsigned c = 0u; c < 4u; c++)
+				t += (points[i][c] - ep.value[0][c]) * d[c];
+			guess = std::min(std::max(int(t / length * 15.f + 0.5f), 0), 15);
+		}
+
+		unsigned best = 0u, best_error = ~0u;
+		for (int k = std::max(guess - 1, 0); k <= std::min(guess + 1, 15); k++)
+		{
+			unsigned e = 0u;
+			for (unsigned c = 0u; c < 4u; c++)
+			{
+				const int v = ((64 - bc7_weights[k]) * ep.value[0][c] + bc7_weights[k] * ep.value[1][c] + 32) >> 6;
+				const int diff = v - int(points[i][c]);
+				e += unsigned(diff * diff);
+			}
+			if (e < best_error)
+				best = unsigned(k), best_error = e;
+		}
+		indices[i] = uint8_t(best);
+		error += best_error;
+	}
+	return error;
+}
+
+// Encodes the block in BC7 mode 6, a single pair of RGBA endpoints with sixteen levels
+// between them, the mode that suits most blocks best on its own.
+
+static void encode_bc7_block(const BlockPixels& px, uint8_t* out)
+{
+	float points[16][4];
+	for (unsigned i = 0u; i < 16u; i++)
+		for (unsigned c = 0u; c < 4u; c++)
+			points[i][c] = px[i][c];
+
+	float e0[4], e1[4];
+	fit_endpoints<4>(points, 16u, e0, e1);
+
+	Bc7Endpoints best;
+	uint8_t best_indices[16];
+	unsigned best_error = solid_bc7(px, best, best_indices) ? 0u : ~0u;
+
+	for (unsigned pass = 0u; pass < BC7_REFINE_PASSES && best_error; pass++)
+	{
+		// Every combination of low bits is tried
+		bool improved = false;
+		for (int p = 0; p < 4; p++)
+		{
+			Bc7Endpoints ep;
+			uint8_t indices[16];
+			quantize_bc7(e0, e1, p & 1, p >> 1, ep);
+			const unsigned error = bc7_indices(points, ep, indices);
+			if (error < best_error)
+			{
+				best = ep;
+				best_error = error;
+				memcpy(best_indices, indices, sizeof(indices));
+				improved = true;
+			}
+		}
+		if (!best_error || !improved)
+			break;
+
+		// Refits the endpoints to the chosen indices
+		float weights[16];
+		for (unsigned i = 0u; i < 16u; i++)
+			weights[i] = 1.f - bc7_weights[best_indices[i]] / 64.f;
+		if (!least_squares_endpoints<4>(points, weights, 16u, e0, e1))
+			break;
+	}
+
+	// The first index is stored with three bits, so its top bit must be zero
+	if (best_indices[0] & 8u)
+	{
+		for (unsigned c = 0u; c < 4u; c++)
+			std::swap(best.q[0][c], best.q[1][c]);
+		std::swap(best.p[0], best.p[1]);
+		for (unsigned i = 0u; i < 16u; i++)
+			best_indices[i] = uint8_t(15u - best_indices[i]);
+	}
+
+	// Packs the fields from the lowest bit
+	memset(out, 0, 16u);
+	unsigned position = 0u;
+	auto put = [&](unsigned value, unsigned bits)
+	{
+		for (unsigned b = 0u; b < bits; b++, position++)
+			out[position >> 3] |= uint8_t(((value >> b) & 1u) << (position & 7u));
+	};
+
+	put(1u << 6, 7u);
+	for (unsigned c = 0u; c < 4u; c++)
+	{
+		put(unsigned(best.q[0][c]), 7u);
+		put(unsigned(best.q[1][c]), 7u);
+	}
+	put(unsigned(best.p[0]), 1u);
+	put(unsigned(best.p[1]), 1u);
+	for (unsigned i = 0u; i < 16u; i++)
+		put(best_indices[i], i ? 4u : 3u);
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Level encoding
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Returns the number of blocks covering the specified number of pixels.
+
+static inline unsigned block_count(unsigned pixels)
+{
+	return std::max((pixels + 3u) / 4u, 1u);
+}
+
+// Returns the size in bytes of a level of a face.
+
+static inline unsigned long long level_bytes(BLOCK_FORMAT format, unsigned width, unsigned height, unsigned level)
+{
+	return (unsigned long long)block_count(std::max(width >> level, 1u)) * block_count(std::max(height >> level, 1u)) * CompressedImage::blockBytes(format);
+}
+
+// Encodes the view as a level, the rows of blocks are spread across the thread pool.
+
+static void encode_level(const ImageView& view, BLOCK_FORMAT format, uint8_t* out)
+{
+	const unsigned blocks_x = block_count(view.width());
+	const unsigned blocks_y = block_count(view.height());
+	const unsigned bytes = CompressedImage::blockBytes(format);
+
+	ThreadPool::parallelFor(blocks_y, BLOCK_ROW_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		BlockPixels px;
+		for (unsigned by = begin; by < end; by++)
+		{
+			uint8_t* block = out + (size_t)by * blocks_x * bytes;
+			for (unsigned bx = 0u; bx < blocks_x; bx++, block += bytes)
+			{
+				read_block(view, bx, by, px);
+				switch (format)
+				{
+				case BLOCK_FORMAT_BC1:
+					encode_color_block(px, true, block);
+					break;
+
+				case BLOCK_FORMAT_BC3:
+					encode_alpha_block(px, block);
+					encode_color_block(px, false, block + 8u);
+					break;
+
+				case BLOCK_FORMAT_BC7:
+					encode_bc7_block(px, block);
+					break;
+				}
+			}
+		}
+	});
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ DDS file format
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Sizes of the DDS headers, the magic number, the header and the DX10 extension.
+#define DDS_HEADER_SIZE 128u
+#define DDS_DX10_SIZE 20u
+
+// Header flags and capabilities used by the files.
+#define DDSD_REQUIRED			0x00001007u	// Caps, height, width and pixel format
+#define DDSD_MIPMAPCOUNT		0x00020000u
+#define DDSD_LINEARSIZE			0x00080000u
+#define DDPF_FOURCC				0x00000004u
+#define DDSCAPS_COMPLEX			0x00000008u
+#define DDSCAPS_TEXTURE			0x00001000u
+#define DDSCAPS_MIPMAP			0x00400000u
+#define DDSCAPS2_CUBEMAP_ALL	0x0000FE00u	// Cube-map with its six faces
+#define DDS_MISC_TEXTURECUBE	0x00000004u
+#define DDS_DIMENSION_TEXTURE2D	3u
+
+// DXGI formats of the blocks, in their unsigned normalized and sRGB variants.
+#define DXGI_BC1		71u
+#define DXGI_BC1_SRGB	72u
+#define DXGI_BC3		77u
+#define DXGI_BC3_SRGB	78u
+#define DXGI_BC7		98u
+#define DXGI_BC7_SRGB	99u
+
+// Builds the four character code as stored in the files.
+#define FOURCC(a, b, c, d) (uint32_t(a) | (uint32_t(b) << 8) | (uint32_t(c) << 16) | (uint32_t(d) << 24))
+
+// Reads a little endian 32 bit value.
+
+static inline uint32_t load_le32(const uint8_t* p)
+{
+	return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Compressed Image functions
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Initializes the image as stored in the DDS file.
+
+CompressedImage::CompressedImage(const char* filename)
+{
+	if (!load(filename))
+		USER_ERROR("Could not create compressed image from file");
+}
+
+// Compresses the image in the format specified, check compress() for more information.
+
+CompressedImage::CompressedImage(const ImageView& image, BLOCK_FORMAT format, bool cubemap)
+{
+	compress(image, format, cubemap);
+}
+
+// Compresses all the levels of the mip chain in the format specified.
+
+CompressedImage::CompressedImage(const MipChain* chain, BLOCK_FORMAT format, bool cubemap)
+{
+	compress(chain, format, cubemap);
+}
+
+// Takes the blocks of the other image, leaving it empty.
+
+CompressedImage::CompressedImage(CompressedImage&& other) noexcept
+	:blocks_{ other.blocks_ }, size_{ other.size_ }, format_{ other.format_ }, width_{ other.width_ }, 
+	height_{ other.height_ }, level_count_{ other.level_count_ }, cubemap_{ other.cubemap_ }
+{
+	other.blocks_ = nullptr;
+	other.size_ = 0u;
+	other.width_ = other.height_ = other.level_count_ = 0u;
+	other.cubemap_ = false;
+}
+
+// Takes the blocks of the other image, leaving it empty.
+
+CompressedImage& CompressedImage::operator=(CompressedImage&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	free(blocks_);
+
+	blocks_ = other.blocks_;
+	size_ = other.size_;
+	format_ = other.format_;
+	width_ = other.width_;
+	height_ = other.height_;
+	level_count_ = other.level_count_;
+	cubemap_ = other.cubemap_;
+
+	other.blocks_ = nullptr;
+	other.size_ = 0u;
+	other.width_ = other.height_ = other.level_count_ = 0u;
+	other.cubemap_ = false;
+	return *this;
+}
+
+// Frees the blocks.
+
+CompressedImage::~CompressedImage()
+{
+	free(blocks_);
+}
+
+// Allocates the blocks for the layout specified, freeing the previous ones.
+
+void CompressedImage::allocate(BLOCK_FORMAT format, unsigned width, unsigned height, unsigned level_count, bool cubemap)
+{
+	free(blocks_);
+
+	format_ = format;
+	width_ = width;
+	height_ = height;
+	level_count_ = level_count;
+	cubemap_ = cubemap;
+
+	size_ = 0u;
+	for (unsigned level = 0u; level < level_count; level++)
+		size_ += level_bytes(format, width, height, level);
+	if (cubemap)
+		size_ *= 6u;
+
+	blocks_ = (unsigned char*)malloc((size_t)size_);
+	USER_CHECK(blocks_,
+		"Failed to allocate the blocks of a compressed image, not enough memory available."
+	);
+}
+
+// Compresses the levels specified, each one half the size of the previous one.
+
+void CompressedImage::compress_levels(const ImageView* levels, unsigned level_count, BLOCK_FORMAT format, bool cubemap)
+{
+	const ImageView& image = levels[0];
+	const unsigned faces = cubemap ? 6u : 1u;
+
+	USER_CHECK(image.pixels() && image.width() && image.height(),
+		"Trying to compress an empty image."
+	);
+	USER_CHECK(!cubemap || image.height() == 6u * image.width(),
+		"Trying to compress a cube-map whose height is not six times its width."
+	);
+	USER_CHECK(image.width() % 4u == 0u && (image.height() / faces) % 4u == 0u,
+		"Trying to compress an image whose dimensions are not multiples of four.\n"
+		"Block compressed textures require the dimensions of the first level to be multiples of four."
+	);
+
+	allocate(format, image.width(), image.height() / faces, level_count, cubemap);
+
+	for (unsigned face = 0u; face < faces; face++)
+		for (unsigned level = 0u; level < level_count; level++)
+		{
+			const unsigned face_height = levels[level].height() / faces;
+			encode_level(levels[level].subview(0u, face * face_height, levels[level].width(), face_height), format, (uint8_t*)blocks(level, face));
+		}
+}
+
+// Compresses the image in the format specified, replacing the previous contents. If
+// cubemap is true the image is expected to have the six faces stacked vertically.
+
+void CompressedImage::compress(const ImageView& image, BLOCK_FORMAT format, bool cubemap)
+{
+	compress_levels(&image, 1u, format, cubemap);
+}
+
+// Compresses all the levels of the mip chain in the format specified. If cubemap is
+// true the chain is expected to have been generated as a cube-map.
+
+void CompressedImage::compress(const MipChain* chain, BLOCK_FORMAT format, bool cubemap)
+{
+	USER_CHECK(chain && chain->levelCount(),
+		"Trying to compress an empty mip chain."
+	);
+
+	ImageView levels[32];
+	for (unsigned level = 0u; level < chain->levelCount(); level++)
+		levels[level] = chain->level(level);
+
+	compress_levels(levels, chain->levelCount(), format, cubemap);
+}
+
+// Loads the image from the specified DDS file, with BC1, BC3 or BC7 blocks.
+
+bool CompressedImage::load(const char* filename)
+{
+	if (!filename || !*filename)
+		return false;
+
+	MappedFile file(filename);
+	if (!file.isOpen())
+		return false;
+
+	const uint8_t* data = (const uint8_t*)file.data();
+	const unsigned long long size = file.size();
+
+	if (size < DDS_HEADER_SIZE || load_le32(data) != FOURCC('D', 'D', 'S', ' ') || load_le32(data + 4) != 124u)
+		return false;
+
+	const uint32_t flags = load_le32(data + 8);
+	const uint32_t height = load_le32(data + 12);
+	const uint32_t width = load_le32(data + 16);
+	const uint32_t mip_count = load_le32(data + 28);
+	const uint32_t pixel_flags = load_le32(data + 80);
+	const uint32_t fourcc = load_le32(data + 84);
+	const uint32_t caps2 = load_le32(data + 112);
+
+	if (!(pixel_flags & DDPF_FOURCC))
+		return false;
+
+	// The format comes from the four character code or the DX10 extension
+	BLOCK_FORMAT format;
+	bool cubemap = (caps2 & DDSCAPS2_CUBEMAP_ALL) == DDSCAPS2_CUBEMAP_ALL;
+	unsigned long long offset = DDS_HEADER_SIZE;
+
+	if (fourcc == FOURCC('D', 'X', 'T', '1'))
+		format = BLOCK_FORMAT_BC1;
+	else if (fourcc == FOURCC('D', 'X', 'T', '5'))
+		format = BLOCK_FORMAT_BC3;
+	else if (fourcc == FOURCC('D', 'X', '1', '0'))
+	{
+		if (size < DDS_HEADER_SIZE + DDS_DX10_SIZE)
+			return false;
+
+		const uint32_t dxgi_format = load_le32(data + 128);
+		const uint32_t dimension = load_le32(data + 132);
+		const uint32_t misc_flags = load_le32(data + 136);
+		const uint32_t array_size = load_le32(data + 140);
+
+		if (dimension != DDS_DIMENSION_TEXTURE2D || array_size != 1u)
+			return false;
+
+		if (dxgi_format == DXGI_BC1 || dxgi_format == DXGI_BC1_SRGB)
+			format = BLOCK_FORMAT_BC1;
+		else if (dxgi_format == DXGI_BC3 || dxgi_format == DXGI_BC3_SRGB)
+			format = BLOCK_FORMAT_BC3;
+		else if (dxgi_format == DXGI_BC7 || dxgi_format == DXGI_BC7_SRGB)
+			format = BLOCK_FORMAT_BC7;
+		else
+			return false;
+
+		cubemap = (misc_flags & DDS_MISC_TEXTURECUBE) != 0u;
+		offset += DDS_DX10_SIZE;
+	}
+	else
+		return false;
+
+	// Only layouts that can be uploaded as textures are accepted
+	const unsigned levels = (flags & DDSD_MIPMAPCOUNT) && mip_count ? mip_count : 1u;
+	if (!width || !height || width % 4u || height % 4u || levels > MipChain::levelCount(width, height))
+		return false;
+	if (cubemap && width != height)
+		return false;
+
+	unsigned long long expected = 0u;
+	for (unsigned level = 0u; level < levels; level++)
+		expected += level_bytes(format, width, height, level);
+	if (cubemap)
+		expected *= 6u;
+	if (expected > size - offset)
+		return false;
+
+	allocate(format, width, height, levels, cubemap);
+	memcpy(blocks_, data + offset, (size_t)size_);
+	return true;
+}
+
+// Saves the image to the specified path as a DDS file.
+
+bool CompressedImage::save(const char* filename) const
+{
+	if (!filename || !*filename || !blocks_)
+		return false;
+
+	// BC7 needs the DX10 extension, BC1 and BC3 use the widely supported codes
+	const bool dx10 = format_ == BLOCK_FORMAT_BC7;
+	const unsigned long long header = DDS_HEADER_SIZE + (dx10 ? DDS_DX10_SIZE : 0u);
+	const unsigned long long file_size = header + size_;
+
+	// The whole file is assembled in memory and written with a single call
+	uint8_t* data = (uint8_t*)calloc(1u, (size_t)file_size);
+	if (!data)
+		return false;
+
+	store_le(data, FOURCC('D', 'D', 'S', ' '), 4u);
+	store_le(data + 4, 124u, 4u);
+	store_le(data + 8, DDSD_REQUIRED | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE, 4u);
+	store_le(data + 12, height_, 4u);
+	store_le(data + 16, width_, 4u);
+	store_le(data + 20, level_bytes(format_, width_, height_, 0u), 4u);
+	store_le(data + 28, level_count_, 4u);
+
+	// Pixel format
+	store_le(data + 76, 32u, 4u);
+	store_le(data + 80, DDPF_FOURCC, 4u);
+	store_le(data + 84, dx10 ? FOURCC('D', 'X', '1', '0') : format_ == BLOCK_FORMAT_BC1 ? FOURCC('D', 'X', 'T', '1') : FOURCC('D', 'X', 'T', '5'), 4u);
+
+	// Capabilities
+	const bool complex = level_count_ > 1u || cubemap_;
+	store_le(data + 108, DDSCAPS_TEXTURE | (complex ? DDSCAPS_COMPLEX : 0u) | (level_count_ > 1u ? DDSCAPS_MIPMAP : 0u), 4u);
+	store_le(data + 112, cubemap_ ? DDSCAPS2_CUBEMAP_ALL : 0u, 4u);
+
+	if (dx10)
+	{
+		store_le(data + 128, DXGI_BC7, 4u);
+		store_le(data + 132, DDS_DIMENSION_TEXTURE2D, 4u);
+		store_le(data + 136, cubemap_ ? DDS_MISC_TEXTURECUBE : 0u, 4u);
+		store_le(data + 140, 1u, 4u);
+	}
+
+	memcpy(data + header, blocks_, (size_t)size_);
+
+	FILE* file = nullptr;
+	fopen_s(&file, filename, "wb");
+	if (!file)
+	{
+		free(data);
+		return false;
+	}
+
+	const bool written = fwrite(data, 1, (size_t)file_size, file) == file_size;
+
+	free(data);
+	fclose(file);
+	return written;
+}
+
+// Returns the size in bytes of a block of the specified format.
+
+unsigned CompressedImage::blockBytes(BLOCK_FORMAT format)
+{
+	return format == BLOCK_FORMAT_BC1 ? 8u : 16u;
+}
+
+// Returns the number of bytes from a row of blocks of the level to the next one.
+
+unsigned CompressedImage::rowPitch(unsigned level) const
+{
+	USER_CHECK(level < level_count_,
+		"Trying to access a compressed image level that does not exist."
+	);
+
+	return block_count(std::max(width_ >> level, 1u)) * blockBytes(format_);
+}
+
+// Returns the pointer to the blocks of the specified level and cube-map face.
+
+const unsigned char* CompressedImage::blocks(unsigned level, unsigned face) const
+{
+	USER_CHECK(level < level_count_ && face < (cubemap_ ? 6u : 1u),
+		"Trying to access a compressed image level that does not exist."
+	);
+
+	// Faces are stored one after the other, each one with all its levels
+	unsigned long long offset = face * (size_ / (cubemap_ ? 6u : 1u));
+	for (unsigned k = 0u; k < level; k++)
+		offset += level_bytes(format_, width_, height_, k);
+
+	return blocks_ + offset;
+}
@@ -1,6 +1,9 @@
 #include "Image/Image.h"
 
 #include "Error/_erDefault.h"
+#include "ThreadPool.h"
+#include "PngCodec.h"
+#include "MappedFile.h"
 
 #include <cstdint>
 #include <cstdarg>
@@ -8,44 +11,209 @@
 #include <cstdlib>
 #include <cstring>
 
+#if defined _M_X64 || defined _M_IX86 || defined __SSE2__
+#include <emmintrin.h>
+#define _IMAGE_SSE2
+#if defined _M_X64 || defined _M_IX86 || defined __SSSE3__
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define _IMAGE_SSSE3
+#endif
+#elif defined _M_ARM64 || defined __ARM_NEON
+#include <arm_neon.h>
+#define _IMAGE_NEON
+#endif
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Helper functions to allocate pixels
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Pixel arrays start at a cache line, so SIMD kernels can use aligned loads.
+#define PIXEL_ALIGNMENT 64u
+
+// Allocates the pixel array aligned to PIXEL_ALIGNMENT, the colors are not initialized.
+
+static Color* allocate_pixels(size_t count)
+{
+    // The size is rounded up to the alignment, as required by aligned_alloc()
+    size_t bytes = (count * sizeof(Color) + PIXEL_ALIGNMENT - 1u) & ~size_t(PIXEL_ALIGNMENT - 1u);
+    if (!bytes)
+        bytes = PIXEL_ALIGNMENT;
+
+#ifdef _WIN32
+    Color* pixels = (Color*)_aligned_malloc(bytes, PIXEL_ALIGNMENT);
+#else
+    Color* pixels = (Color*)aligned_alloc(PIXEL_ALIGNMENT, bytes);
+#endif
+
+    USER_CHECK(pixels,
+        "Failed to allocate the pixels of an image, not enough memory available."
+    );
+    return pixels;
+}
+
+// Frees a pixel array allocated by allocate_pixels().
+
+static void free_pixels(Color* pixels)
+{
+#ifdef _WIN32
+    _aligned_free(pixels);
+#else
+    free(pixels);
+#endif
+}
+
 /*
 -------------------------------------------------------------------------------------------------------
  Helper functions to read and write BMPs
 -------------------------------------------------------------------------------------------------------
 */
 
-static inline void write_le16(FILE* f, uint16_t v) 
+// Number of rows converted by every parallel task when reading or writing BMPs.
+#define BMP_ROW_CHUNK 64u
+
+static inline void store_le16(uint8_t* p, uint16_t v) 
 {
-    uint8_t b[2] = { (uint8_t)(v & 0xFF), (uint8_t)((v >> 8) & 0xFF) };
-    if (fwrite(b, 1, 2, f) != 2) 
-        USER_ERROR("Failed to write in file, possible corruption");
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
 }
-static inline void write_le32(FILE* f, uint32_t v) 
+static inline void store_le32(uint8_t* p, uint32_t v) 
 {
-    uint8_t b[4] = {
-        (uint8_t)(v & 0xFF),
-        (uint8_t)((v >> 8) & 0xFF),
-        (uint8_t)((v >> 16) & 0xFF),
-        (uint8_t)((v >> 24) & 0xFF)
-    };
-    if (fwrite(b, 1, 4, f) != 4) 
-        USER_ERROR("Failed to write in file, possible corruption");
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+    p[2] = (uint8_t)((v >> 16) & 0xFF);
+    p[3] = (uint8_t)((v >> 24) & 0xFF);
+}
+static inline uint16_t load_le16(const uint8_t* p) 
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
 }
-static inline uint16_t read_le16(FILE* f) 
+static inline uint32_t load_le32(const uint8_t* p) 
+{
+    return (uint32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+// Replaces the extension of the file name, or appends it, with the bitmap extension.
+// The buffer must have room for four more characters.
+
+static void force_bmp_extension(char* filename)
 {
-    uint8_t b[2]; 
-    if (fread(b, 1, 2, f) != 2) 
-        USER_ERROR("Failed to read from file, possible corruption");
+    char* base = filename;
+    if (char* p = strrchr(filename, '/'))  base = p + 1;
+    if (char* p = strrchr(filename, '\\')) if (p + 1 > base) base = p + 1;
+
+    char* dot = strrchr(base, '.');
+    char* end = dot ? dot : filename + strlen(filename);
 
-    return (uint16_t)(b[0] | (b[1] << 8));
+    end[0] = '.';
+    end[1] = 'b';
+    end[2] = 'm';
+    end[3] = 'p';
+    end[4] = '\0';
 }
-static inline uint32_t read_le32(FILE* f) 
+
+#ifdef _IMAGE_SSSE3
+// Whether the processor supports SSSE3, every x64 processor since 2006 does, but it is
+// not part of the x64 baseline, so it is checked once at runtime.
+static bool ssse3_supported()
 {
-    uint8_t b[4]; 
-    if (fread(b, 1, 4, f) != 4) 
-        USER_ERROR("Failed to read from file, possible corruption");
+#ifdef _MSC_VER
+    static const bool supported = []() { int info[4]; __cpuid(info, 1); return ((info[2] >> 9) & 1) != 0; }();
+    return supported;
+#else
+    return true;
+#endif
+}
+#endif
 
-    return (uint32_t)(b[0] | (b[1] << 8) | (b[2] << 16) | (b[3] << 24));
+// Expands a row of 24 bit BGR pixels to opaque BGRA colors. With SIMD 16 pixels are
+// loaded at a time, and every group of four is shuffled into place with the alpha set.
+
+static void bgr_to_bgra_row(const uint8_t* in, Color* out, unsigned count)
+{
+    unsigned x = 0u;
+
+#if defined _IMAGE_SSSE3
+    if (ssse3_supported())
+    {
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+
+        for (; x + 16u <= count; x += 16u, in += 48)
+        {
+            const __m128i a = _mm_loadu_si128((const __m128i*)in);
+            const __m128i b = _mm_loadu_si128((const __m128i*)(in + 16));
+            const __m128i c = _mm_loadu_si128((const __m128i*)(in + 32));
+
+            _mm_storeu_si128((__m128i*)(out + x + 0u), _mm_or_si128(_mm_shuffle_epi8(a, shuffle), alpha));
+            _mm_storeu_si128((__m128i*)(out + x + 4u), _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), shuffle), alpha));
+            _mm_storeu_si128((__m128i*)(out + x + 8u), _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), shuffle), alpha));
+            _mm_storeu_si128((__m128i*)(out + x + 12u), _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), shuffle), alpha));
+        }
+    }
+#elif defined _IMAGE_NEON
+    for (; x + 16u <= count; x += 16u, in += 48)
+    {
+        const uint8x16x3_t bgr = vld3q_u8(in);
+
+        uint8x16x4_t bgra;
+        bgra.val[0] = bgr.val[0];
+        bgra.val[1] = bgr.val[1];
+        bgra.val[2] = bgr.val[2];
+        bgra.val[3] = vdupq_n_u8(255);
+        vst4q_u8((uint8_t*)(out + x), bgra);
+    }
+#endif
+
+    for (; x < count; x++)
+    {
+        out[x].B = *(in++);
+        out[x].G = *(in++);
+        out[x].R = *(in++);
+        out[x].A = 255;
+    }
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Helper functions to read and write PNGs
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Returns whether the file name has the PNG extension, in any case.
+
+static bool has_png_extension(const char* filename)
+{
+    const char* base = filename;
+    if (const char* p = strrchr(filename, '/'))  base = p + 1;
+    if (const char* p = strrchr(filename, '\\')) if (p + 1 > base) base = p + 1;
+
+    const char* dot = strrchr(base, '.');
+    return dot && (dot[1] | 32) == 'p' && (dot[2] | 32) == 'n' && (dot[3] | 32) == 'g' && !dot[4];
+}
+
+// Encodes the pixels as PNG in memory and writes the file at once.
+
+static bool write_png(const char* filename, const Color* pixels, unsigned width, unsigned height, unsigned level)
+{
+    unsigned char* data = nullptr;
+    unsigned long long size = 0ull;
+    if (!PngCodec::encode(pixels, width, height, level, &data, &size))
+        return false;
+
+    FILE* file = nullptr;
+    fopen_s(&file, filename, "wb");
+
+    const bool written = file && fwrite(data, 1, (size_t)size, file) == size;
+
+    if (file)
+        fclose(file);
+    free(data);
+    return written;
 }
 
 /*
@@ -80,6 +248,20 @@ const char* Image::internal_formatting(const char* fmt_filename, ...)
     return filename;
 }
 
+// Frees the pixels, or unmaps the file if the image is mapped
+
+void Image::release()
+{
+    if (mapping_)
+        delete (MappedFile*)mapping_;
+
+    else if (pixels_)
+        free_pixels(pixels_);
+
+    mapping_ = nullptr;
+    pixels_ = nullptr;
+}
+
 /*
 -------------------------------------------------------------------------------------------------------
  Constructors / Destructors
@@ -99,8 +281,8 @@ Image::Image(const char* filename)
 Image::Image(const Image& other)
 	:width_(other.width_), height_(other.height_)
 {
-	pixels_ = (Color*)calloc(width_ * height_, sizeof(Color));
-	memcpy(pixels_, other.pixels_, width_ * height_ * sizeof(Color));
+	pixels_ = allocate_pixels((size_t)width_ * height_);
+	memcpy(pixels_, other.pixels_, (size_t)width_ * height_ * sizeof(Color));
 }
 
 // Copies the other image
@@ -110,23 +292,70 @@ Image& Image::operator=(const Image& other)
     if (&other == this) 
         return *this;
 
-    if (pixels_)
-        free(pixels_);
+    release();
 
     width_ = other.width_;
     height_ = other.height_;
-    pixels_ = (Color*)calloc(width_ * height_, sizeof(Color));
-    memcpy(pixels_, other.pixels_, width_ * height_ * sizeof(Color));
+    pixels_ = allocate_pixels((size_t)width_ * height_);
+    memcpy(pixels_, other.pixels_, (size_t)width_ * height_ * sizeof(Color));
 
     return *this;
 }
 
+// Takes the pixels of the other image, leaving it empty.
+
+Image::Image(Image&& other) noexcept
+    :pixels_{ other.pixels_ }, width_{ other.width_ }, height_{ other.height_ }, mapping_{ other.mapping_ }
+{
+    other.pixels_ = nullptr;
+    other.mapping_ = nullptr;
+    other.width_ = 0u;
+    other.height_ = 0u;
+}
+
+// Takes the pixels of the other image, leaving it empty.
+
+Image& Image::operator=(Image&& other) noexcept
+{
+    if (&other == this) 
+        return *this;
+
+    release();
+
+    pixels_ = other.pixels_;
+    mapping_ = other.mapping_;
+    width_ = other.width_;
+    height_ = other.height_;
+
+    other.pixels_ = nullptr;
+    other.mapping_ = nullptr;
+    other.width_ = 0u;
+    other.height_ = 0u;
+
+    return *this;
+}
+
+// Copies the pixels of the view, which can be a region of another image or any
+// external color buffer, into a new image.
+
+Image::Image(const ImageView& view)
+    :width_{ view.width() }, height_{ view.height() }
+{
+    pixels_ = allocate_pixels((size_t)width_ * height_);
+
+    if (view.isContiguous())
+        memcpy(pixels_, view.pixels(), (size_t)width_ * height_ * sizeof(Color));
+
+    else for (unsigned row = 0u; row < height_; row++)
+        memcpy(pixels_ + (size_t)row * width_, view.row(row), width_ * sizeof(Color));
+}
+
 // Stores a copy of the color pointer
 
 Image::Image(Color* pixels, unsigned width, unsigned height)
-    :width_{ width }, height_{ height }, pixels_{ (Color*)calloc(width * height, sizeof(Color)) }
+    :pixels_{ allocate_pixels((size_t)width * height) }, width_{ width }, height_{ height }
 {
-    memcpy(pixels_, pixels, width * height * sizeof(Color));
+    memcpy(pixels_, pixels, (size_t)width * height * sizeof(Color));
 }
 
 // Creates an image with the specified size and color
@@ -140,8 +369,7 @@ Image::Image(unsigned width, unsigned height, Color color)
 
 Image::~Image()
 {
-    if (pixels_)
-	    free(pixels_);
+    release();
 }
 
 // Resets the image to the new dimensions and color.
@@ -149,22 +377,509 @@ Image::~Image()
 void Image::reset(unsigned width, unsigned height, Color color)
 {
     // Free pixels if they exist.
-    if (pixels_)
-        free(pixels_);
+    release();
 
     width_ = width;
     height_ = height;
 
-    pixels_ = (Color*)calloc(width_ * height_, sizeof(Color));
+    pixels_ = allocate_pixels((size_t)width_ * height_);
+
+    for (size_t i = 0; i < (size_t)width_ * height_; i++)
+        pixels_[i] = color;
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Image View functions
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Returns a view of the specified region of the image, that must be inside it.
+
+ImageView Image::view(unsigned x, unsigned y, unsigned width, unsigned height) const
+{
+    return ImageView(*this).subview(x, y, width, height);
+}
+
+// Returns whether the pixels live in a file mapped read only, that can not be modified.
+
+bool Image::isReadOnly() const
+{
+    return mapping_ && !((const MappedFile*)mapping_)->isCopyOnWrite();
+}
+
+// Returns a view of the specified region of this view, that must be inside it.
+
+ImageView ImageView::subview(unsigned x, unsigned y, unsigned width, unsigned height) const
+{
+    USER_CHECK((unsigned long long)x + width <= width_ && (unsigned long long)y + height <= height_,
+        "Trying to create an image view of a region that is not inside the image."
+    );
 
-    if (color != Color::Transparent)
-        for (unsigned int i = 0; i < width_ * height_; i++)
-            pixels_[i] = color;
+    return ImageView(pixels_ + (size_t)y * stride_ + x, width, height, stride_);
 }
 
 /*
 -------------------------------------------------------------------------------------------------------
- BMP image files functions
+ Bulk color operations
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Number of pixels processed by every parallel task of the bulk operations.
+#define BULK_PIXEL_CHUNK 16384u
+
+// Calls the span function for every span of pixels of the image, together with the matching
+// span of the view if there is one. Packed images are split in spans of BULK_PIXEL_CHUNK
+// pixels, otherwise every row is a span, and the spans are spread across the thread pool.
+
+template<typename F>
+static void for_each_span(Image& image, const ImageView* other, const F& span)
+{
+    const unsigned width = image.width();
+    const unsigned height = image.height();
+    Color* pixels = image.pixels();
+
+    USER_CHECK(!image.isReadOnly(),
+        "Trying to modify an image mapped read only, map it with copy on write to modify it."
+    );
+
+    USER_CHECK(!other || (other->width() == width && other->height() == height),
+        "Trying to operate an image with a view of different dimensions."
+    );
+
+    if (!width || !height)
+        return;
+
+    // Packed operands are processed as a single list of pixels
+    if ((!other || other->isContiguous()) && (unsigned long long)width * height <= 0xFFFFFFFFull)
+    {
+        const Color* src = other ? other->pixels() : nullptr;
+
+        ThreadPool::parallelFor(width * height, BULK_PIXEL_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+        {
+            span(pixels + begin, src ? src + begin : nullptr, end - begin);
+        });
+        return;
+    }
+
+    const unsigned row_chunk = width >= BULK_PIXEL_CHUNK ? 1u : BULK_PIXEL_CHUNK / width;
+
+    ThreadPool::parallelFor(height, row_chunk, [&](unsigned begin, unsigned end, unsigned)
+    {
+        for (unsigned y = begin; y < end; y++)
+            span(pixels + (size_t)y * width, other ? other->row(y) : nullptr, width);
+    });
+}
+
+// Divides by 255 rounding to the closest integer, exact for any product of two bytes.
+
+static inline int div255_round(int v)
+{
+    v += 128;
+    return (v + (v >> 8)) >> 8;
+}
+
+#ifdef _IMAGE_SSE2
+// Divides the 16 bit lanes by 255 truncating, exact for any product of two bytes.
+static inline __m128i div255_epu16(__m128i v)
+{
+    return _mm_srli_epi16(_mm_mulhi_epu16(v, _mm_set1_epi16((short)0x8081)), 7);
+}
+
+// Divides the 16 bit lanes by 255 rounding to the closest integer, as div255_round().
+static inline __m128i div255_round_epu16(__m128i v)
+{
+    v = _mm_add_epi16(v, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+}
+
+// Copies the alpha of every pixel, expanded to 16 bit lanes, to all its channels.
+static inline __m128i broadcast_alpha_epu16(__m128i v)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xFF), 0xFF);
+}
+
+// Expands four pixels to four float vectors, one per pixel in BGRA order.
+static inline void unpack_pixels_ps(__m128i px, __m128* p)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = _mm_unpacklo_epi8(px, zero);
+    const __m128i hi = _mm_unpackhi_epi8(px, zero);
+
+    p[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+    p[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+    p[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+    p[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+}
+
+// Truncates the four float pixels back to bytes, saturating at 255.
+static inline __m128i pack_pixels_ps(const __m128* p)
+{
+    const __m128i lo = _mm_packs_epi32(_mm_cvttps_epi32(p[0]), _mm_cvttps_epi32(p[1]));
+    const __m128i hi = _mm_packs_epi32(_mm_cvttps_epi32(p[2]), _mm_cvttps_epi32(p[3]));
+    return _mm_packus_epi16(lo, hi);
+}
+#endif
+
+// Operations of the bulk functions. Every operation combines pixels of the image with pixels 
+// of the other operand, four at a time with SIMD and one at a time for the span tails, the
+// scalar path follows the same arithmetic so both give the same colors.
+
+struct BulkAdd
+{
+#ifdef _IMAGE_SSE2
+    inline __m128i lanes(__m128i a, __m128i b) const { return _mm_adds_epu8(a, b); }
+#endif
+    inline Color pixel(Color a, Color b) const { return a + b; }
+};
+
+struct BulkSubtract
+{
+#ifdef _IMAGE_SSE2
+    inline __m128i lanes(__m128i a, __m128i b) const { return _mm_subs_epu8(a, b); }
+#endif
+    inline Color pixel(Color a, Color b) const { return a - b; }
+};
+
+struct BulkMultiply
+{
+#ifdef _IMAGE_SSE2
+    inline __m128i lanes(__m128i a, __m128i b) const
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i lo = div255_epu16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+        const __m128i hi = div255_epu16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+        return _mm_packus_epi16(lo, hi);
+    }
+#endif
+    inline Color pixel(Color a, Color b) const { return a * b; }
+};
+
+struct BulkLerp
+{
+    int weight; // Weight of the other operand, from 0 to 256
+
+#ifdef _IMAGE_SSE2
+    inline __m128i lanes(__m128i a, __m128i b) const
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i wb = _mm_set1_epi16((short)weight);
+        const __m128i wa = _mm_set1_epi16((short)(256 - weight));
+
+        const __m128i lo = _mm_srli_epi16(_mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), wa), _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), wb)), 8);
+        const __m128i hi = _mm_srli_epi16(_mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), wa), _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), wb)), 8);
+        return _mm_packus_epi16(lo, hi);
+    }
+#endif
+    inline Color pixel(Color a, Color b) const
+    {
+        return Color(
+            (unsigned char)((a.R * (256 - weight) + b.R * weight) >> 8),
+            (unsigned char)((a.G * (256 - weight) + b.G * weight) >> 8),
+            (unsigned char)((a.B * (256 - weight) + b.B * weight) >> 8),
+            (unsigned char)((a.A * (256 - weight) + b.A * weight) >> 8)
+        );
+    }
+};
+
+// The color is the mix of both pixels weighted by the alpha of the one on top, and the
+// alpha is mixed the same way with the top pixel counting as opaque.
+
+struct BulkBlend
+{
+#ifdef _IMAGE_SSE2
+    inline __m128i lanes(__m128i a, __m128i b) const
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i opaque = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+        const __m128i full = _mm_set1_epi16(255);
+
+        __m128i b_lo = _mm_unpacklo_epi8(b, zero);
+        __m128i b_hi = _mm_unpackhi_epi8(b, zero);
+        const __m128i alpha_lo = broadcast_alpha_epu16(b_lo);
+        const __m128i alpha_hi = broadcast_alpha_epu16(b_hi);
+        b_lo = _mm_or_si128(b_lo, opaque);
+        b_hi = _mm_or_si128(b_hi, opaque);
+
+        const __m128i lo = div255_round_epu16(_mm_add_epi16(_mm_mullo_epi16(b_lo, alpha_lo),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_sub_epi16(full, alpha_lo))));
+        const __m128i hi = div255_round_epu16(_mm_add_epi16(_mm_mullo_epi16(b_hi, alpha_hi),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_sub_epi16(full, alpha_hi))));
+        return _mm_packus_epi16(lo, hi);
+    }
+#endif
+    inline Color pixel(Color a, Color b) const
+    {
+        const int alpha = b.A;
+        return Color(
+            (unsigned char)div255_round(b.R * alpha + a.R * (255 - alpha)),
+            (unsigned char)div255_round(b.G * alpha + a.G * (255 - alpha)),
+            (unsigned char)div255_round(b.B * alpha + a.B * (255 - alpha)),
+            (unsigned char)div255_round(255 * alpha + a.A * (255 - alpha))
+        );
+    }
+};
+
+struct BulkPremultiply
+{
+#ifdef _IMAGE_SSE2
+    inline __m128i lanes(__m128i a, __m128i) const
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i color_mask = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+        const __m128i opaque = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+
+        const __m128i a_lo = _mm_unpacklo_epi8(a, zero);
+        const __m128i a_hi = _mm_unpackhi_epi8(a, zero);
+
+        // The alpha channel is multiplied by 255 so that it stays the same
+        const __m128i m_lo = _mm_or_si128(_mm_and_si128(broadcast_alpha_epu16(a_lo), color_mask), opaque);
+        const __m128i m_hi = _mm_or_si128(_mm_and_si128(broadcast_alpha_epu16(a_hi), color_mask), opaque);
+
+        return _mm_packus_epi16(div255_round_epu16(_mm_mullo_epi16(a_lo, m_lo)), div255_round_epu16(_mm_mullo_epi16(a_hi, m_hi)));
+    }
+#endif
+    inline Color pixel(Color a, Color) const
+    {
+        return Color(
+            (unsigned char)div255_round(a.R * a.A),
+            (unsigned char)div255_round(a.G * a.A),
+            (unsigned char)div255_round(a.B * a.A),
+            a.A
+        );
+    }
+};
+
+// The rounded quotient is the truncation of (c * 255 + a / 2 + 1 / 4) / a, computed with the
+// inverse of the alpha. The quarter keeps exact quotients from falling below the integer, and 
+// inexact ones are at least 1 / (2a) away from it, far more than the float error. Transparent 
+// pixels divide by 255 instead, which leaves the channels unchanged.
+
+struct BulkUnpremultiply
+{
+#ifdef _IMAGE_SSE2
+    inline __m128i lanes(__m128i a, __m128i) const
+    {
+        const __m128 color_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+        const __m128 scale = _mm_setr_ps(255.f, 255.f, 255.f, 1.f);
+        const __m128 alpha_bias = _mm_setr_ps(0.f, 0.f, 0.f, 0.25f);
+        const __m128 alpha_one = _mm_setr_ps(0.f, 0.f, 0.f, 1.f);
+
+        // Alphas of the four pixels, with transparent ones replaced by 255
+        __m128 alpha = _mm_cvtepi32_ps(_mm_srli_epi32(a, 24));
+        const __m128 transparent = _mm_cmpeq_ps(alpha, _mm_setzero_ps());
+        alpha = _mm_or_ps(_mm_and_ps(transparent, _mm_set1_ps(255.f)), _mm_andnot_ps(transparent, alpha));
+
+        const __m128 bias = _mm_add_ps(_mm_mul_ps(alpha, _mm_set1_ps(0.5f)), _mm_set1_ps(0.25f));
+        const __m128 inverse = _mm_div_ps(_mm_set1_ps(1.f), alpha);
+
+        __m128 p[4];
+        unpack_pixels_ps(a, p);
+
+        // The alpha channel gets a bias of a quarter and is multiplied by one
+#define UNPREMULTIPLY_PIXEL(k, shuffle) \
+        p[k] = _mm_mul_ps( \
+            _mm_add_ps(_mm_mul_ps(p[k], scale), _mm_or_ps(_mm_and_ps(_mm_shuffle_ps(bias, bias, shuffle), color_mask), alpha_bias)), \
+            _mm_or_ps(_mm_and_ps(_mm_shuffle_ps(inverse, inverse, shuffle), color_mask), alpha_one))
+
+        UNPREMULTIPLY_PIXEL(0, 0x00);
+        UNPREMULTIPLY_PIXEL(1, 0x55);
+        UNPREMULTIPLY_PIXEL(2, 0xAA);
+        UNPREMULTIPLY_PIXEL(3, 0xFF);
+#undef UNPREMULTIPLY_PIXEL
+
+        return pack_pixels_ps(p);
+    }
+#endif
+    inline Color pixel(Color a, Color) const
+    {
+        const float alpha = a.A ? (float)a.A : 255.f;
+        const float bias = alpha * 0.5f + 0.25f;
+        const float inverse = 1.f / alpha;
+
+        auto channel = [bias, inverse](unsigned char c) 
+        {
+            const float v = (c * 255.f + bias) * inverse;
+            return v >= 255.f ? (unsigned char)255 : (unsigned char)v;
+        };
+        return Color(channel(a.R), channel(a.G), channel(a.B), a.A);
+    }
+};
+
+struct BulkScale
+{
+    float factor; // Factor multiplying every channel
+
+#ifdef _IMAGE_SSE2
+    inline __m128i lanes(__m128i a, __m128i) const
+    {
+        const __m128 f = _mm_set1_ps(factor);
+
+        __m128 p[4];
+        unpack_pixels_ps(a, p);
+
+        p[0] = _mm_mul_ps(p[0], f);
+        p[1] = _mm_mul_ps(p[1], f);
+        p[2] = _mm_mul_ps(p[2], f);
+        p[3] = _mm_mul_ps(p[3], f);
+
+        return pack_pixels_ps(p);
+    }
+#endif
+    inline Color pixel(Color a, Color) const { return a * factor; }
+};
+
+// Applies the operation to every pixel of the span. The other operand is a span of the 
+// same length, a single color if uniform, or nothing for operations of the image alone.
+
+template<typename Op>
+static void bulk_span(const Op& op, Color* dst, const Color* src, unsigned count, bool uniform)
+{
+    const Color none = {};
+    if (!src)
+    {
+        src = &none;
+        uniform = true;
+    }
+
+    unsigned i = 0u;
+
+#ifdef _IMAGE_SSE2
+    int packed;
+    memcpy(&packed, src, sizeof(Color));
+    const __m128i color = _mm_set1_epi32(packed);
+
+    for (; i + 4u <= count; i += 4u)
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+        const __m128i b = uniform ? color : _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), op.lanes(a, b));
+    }
+#endif
+
+    for (; i < count; i++)
+        dst[i] = op.pixel(dst[i], src[uniform ? 0u : i]);
+}
+
+// Adds the colors of the view to the image, saturating at 255.
+
+void Image::add(const ImageView& other)
+{
+    for_each_span(*this, &other, [](Color* dst, const Color* src, unsigned count)
+        { bulk_span(BulkAdd(), dst, src, count, false); });
+}
+
+// Adds the color to every pixel, saturating at 255.
+
+void Image::add(Color color)
+{
+    for_each_span(*this, nullptr, [&color](Color* dst, const Color*, unsigned count)
+        { bulk_span(BulkAdd(), dst, &color, count, true); });
+}
+
+// Subtracts the colors of the view from the image, saturating at 0.
+
+void Image::subtract(const ImageView& other)
+{
+    for_each_span(*this, &other, [](Color* dst, const Color* src, unsigned count)
+        { bulk_span(BulkSubtract(), dst, src, count, false); });
+}
+
+// Multiplies the image by the colors of the view, every channel as a fraction of 255.
+
+void Image::multiply(const ImageView& other)
+{
+    for_each_span(*this, &other, [](Color* dst, const Color* src, unsigned count)
+        { bulk_span(BulkMultiply(), dst, src, count, false); });
+}
+
+// Multiplies every pixel by the color, every channel as a fraction of 255.
+
+void Image::multiply(Color color)
+{
+    for_each_span(*this, nullptr, [&color](Color* dst, const Color*, unsigned count)
+        { bulk_span(BulkMultiply(), dst, &color, count, true); });
+}
+
+// Multiplies every channel by the non negative factor, saturating at 255.
+
+void Image::scale(float factor)
+{
+    USER_CHECK(factor >= 0.f,
+        "Trying to scale an image by a negative factor."
+    );
+
+    const BulkScale op = { factor };
+    for_each_span(*this, nullptr, [&op](Color* dst, const Color*, unsigned count)
+        { bulk_span(op, dst, nullptr, count, true); });
+}
+
+// Linearly interpolates every pixel towards the view by the weight, from 0 to 1.
+
+void Image::lerp(const ImageView& other, float weight)
+{
+    USER_CHECK(weight >= 0.f && weight <= 1.f,
+        "Trying to interpolate an image with a weight outside of the range [0,1]."
+    );
+
+    const BulkLerp op = { (int)(weight * 256.f + 0.5f) };
+    for_each_span(*this, &other, [&op](Color* dst, const Color* src, unsigned count)
+        { bulk_span(op, dst, src, count, false); });
+}
+
+// Draws the view over the image, with its alpha as the opacity of every pixel.
+
+void Image::blend(const ImageView& other)
+{
+    for_each_span(*this, &other, [](Color* dst, const Color* src, unsigned count)
+        { bulk_span(BulkBlend(), dst, src, count, false); });
+}
+
+// Multiplies the color channels of every pixel by its alpha.
+
+void Image::premultiply()
+{
+    for_each_span(*this, nullptr, [](Color* dst, const Color*, unsigned count)
+        { bulk_span(BulkPremultiply(), dst, nullptr, count, true); });
+}
+
+// Divides the color channels of every pixel by its alpha, rounding to the closest value.
+
+void Image::unpremultiply()
+{
+    for_each_span(*this, nullptr, [](Color* dst, const Color*, unsigned count)
+        { bulk_span(BulkUnpremultiply(), dst, nullptr, count, true); });
+}
+
+// Replaces every channel by its entry in the table of that channel, channels with a null
+// table are left unchanged. The tables are copied in BGRA order to read them by offset.
+
+void Image::applyLUT(const unsigned char* lut_r, const unsigned char* lut_g, const unsigned char* lut_b, const unsigned char* lut_a)
+{
+    unsigned char tables[4][256];
+    const unsigned char* luts[4] = { lut_b, lut_g, lut_r, lut_a };
+
+    for (unsigned c = 0u; c < 4u; c++)
+        for (unsigned v = 0u; v < 256u; v++)
+            tables[c][v] = luts[c] ? luts[c][v] : (unsigned char)v;
+
+    for_each_span(*this, nullptr, [&tables](Color* dst, const Color*, unsigned count)
+    {
+        for (unsigned i = 0u; i < count; i++)
+        {
+            dst[i].B = tables[0][dst[i].B];
+            dst[i].G = tables[1][dst[i].G];
+            dst[i].R = tables[2][dst[i].R];
+            dst[i].A = tables[3][dst[i].A];
+        }
+    });
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ BMP and PNG image files functions
 -------------------------------------------------------------------------------------------------------
 */
 
@@ -179,24 +894,12 @@ bool Image::save(const char* filename_) const
     strncpy_s(filename, filename_, 507);
     filename[507] = '\0';
 
-    // Force the correct extension
-    char* base = filename;
-    if (char* p = strrchr(filename, '/'))  base = p + 1;
-    if (char* p = strrchr(filename, '\\')) if (p + 1 > base) base = p + 1;
-
-    char* dot = strrchr(base, '.');
-    char* end = dot ? dot : filename + strlen(filename);
-
-    end[0] = '.';
-    end[1] = 'b';
-    end[2] = 'm';
-    end[3] = 'p';
-    end[4] = '\0';
+    // PNG files are compressed with the built in codec
+    if (has_png_extension(filename))
+        return write_png(filename, pixels_, width_, height_, PNG_COMPRESSION_LEVEL);
 
-    FILE* file = nullptr;
-    fopen_s(&file, filename, "wb");
-    if (!file) 
-        return false;
+    // Force the correct extension
+    force_bmp_extension(filename);
 
     const uint16_t bpp = 32u;
     const uint32_t bytes_per_pixel = 4u;
@@ -205,62 +908,65 @@ bool Image::save(const char* filename_) const
     const uint32_t row_stride = width_ * bytes_per_pixel;
     const uint32_t pixel_data_size = row_stride * height_;
 
-    // --- FILE HEADER (14 bytes) ---
-    // Signature "BM"
-    if (fwrite("BM", sizeof(uint8_t), 2, file) != 2)
-    {
-        fclose(file);
+    // File header + BITMAPINFOHEADER, top down pixel arrays start at 64 bytes so that
+    // map() can use them in place with the alignment of the image pixels.
+    const uint32_t bfOffBits = BMP_TOP_DOWN ? 64u : 14u + 40u;
+    const uint32_t bfSize = bfOffBits + pixel_data_size;
+
+    // The whole file is assembled in memory and written with a single call
+    uint8_t* data = (uint8_t*)malloc(bfSize);
+    if (!data)
         return false;
-    }
 
-    const uint32_t bfOffBits = 14u + 40u; // file header + BITMAPINFOHEADER
-    const uint32_t bfSize = bfOffBits + pixel_data_size;
-    write_le32(file, bfSize);
-    write_le16(file, 0); // bfReserved1
-    write_le16(file, 0); // bfReserved2
-    write_le32(file, bfOffBits);
+    // Clears the headers and the gap before the pixels
+    memset(data, 0, bfOffBits);
+
+    // --- FILE HEADER (14 bytes) ---
+    data[0] = 'B';                          // Signature "BM"
+    data[1] = 'M';
+    store_le32(data + 2, bfSize);
+    store_le16(data + 6, 0);                // bfReserved1
+    store_le16(data + 8, 0);                // bfReserved2
+    store_le32(data + 10, bfOffBits);
 
     // --- DIB HEADER: BITMAPINFOHEADER (40 bytes) ---
-    write_le32(file, 40u);                 // biSize
-    write_le32(file, (uint32_t)width_);    // biWidth
-    write_le32(file, (uint32_t)height_);   // biHeight (positive => bottom-up)
-    write_le16(file, 1u);                  // biPlanes
-    write_le16(file, bpp);                 // biBitCount
-    write_le32(file, 0u);                  // biCompression (BI_RGB = 0)
-    write_le32(file, pixel_data_size);     // biSizeImage
-    write_le32(file, 2835u);               // biXPelsPerMeter (~72 DPI)
-    write_le32(file, 2835u);               // biYPelsPerMeter
-    write_le32(file, 0u);                  // biClrUsed
-    write_le32(file, 0u);                  // biClrImportant
-
-    // --- Pixel data (bottom-up BGR[A]) ---
-
-    uint8_t* row = (uint8_t*)calloc(row_stride, sizeof(uint8_t));
-    for (int y = (int)height_ - 1; y >= 0; --y)
-    {
-        uint8_t* out = row;
-        const Color* in = &pixels_[(size_t)y * width_];
-
-            // BGRA
-        for (unsigned x = 0; x < width_; ++x)
+    store_le32(data + 14, 40u);             // biSize
+    store_le32(data + 18, width_);          // biWidth
+    store_le32(data + 22, BMP_TOP_DOWN ? 0u - height_ : height_); // biHeight (negative => top-down)
+    store_le16(data + 26, 1u);              // biPlanes
+    store_le16(data + 28, bpp);             // biBitCount
+    store_le32(data + 30, 0u);              // biCompression (BI_RGB = 0)
+    store_le32(data + 34, pixel_data_size); // biSizeImage
+    store_le32(data + 38, 2835u);           // biXPelsPerMeter (~72 DPI)
+    store_le32(data + 42, 2835u);           // biYPelsPerMeter
+    store_le32(data + 46, 0u);              // biClrUsed
+    store_le32(data + 50, 0u);              // biClrImportant
+
+    // --- Pixel data (BGRA, the same layout as the colors) ---
+    uint8_t* pixel_data = data + bfOffBits;
+
+    ThreadPool::parallelFor(height_, BMP_ROW_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+    {
+        for (unsigned y = begin; y < end; y++)
         {
-            *out++ = in[x].B;
-            *out++ = in[x].G;
-            *out++ = in[x].R;
-            *out++ = in[x].A;
+            const unsigned dst_y = BMP_TOP_DOWN ? y : height_ - 1u - y;
+            memcpy(pixel_data + (size_t)dst_y * row_stride, pixels_ + (size_t)y * width_, row_stride);
         }
+    });
 
-        if (fwrite(row, sizeof(uint8_t), row_stride, file) != row_stride)
-        {
-            free(row);
-            fclose(file);
-            return false;
-        }
+    FILE* file = nullptr;
+    fopen_s(&file, filename, "wb");
+    if (!file)
+    {
+        free(data);
+        return false;
     }
 
-    free(row);
+    const bool written = fwrite(data, 1, bfSize, file) == bfSize;
+
+    free(data);
     fclose(file);
-    return true;
+    return written;
 }
 
 // Saves the image to the specified file path
@@ -274,116 +980,147 @@ bool Image::load(const char* filename_)
     strncpy_s(filename, filename_, 507);
     filename[507] = '\0';
 
-    // Force the correct extension
-    char* base = filename;
-    if (char* p = strrchr(filename, '/'))  base = p + 1;
-    if (char* p = strrchr(filename, '\\')) if (p + 1 > base) base = p + 1;
-
-    char* dot = strrchr(base, '.');
-    char* end = dot ? dot : filename + strlen(filename);
+    // Force the correct extension, unless it is a PNG file
+    if (!has_png_extension(filename))
+        force_bmp_extension(filename);
 
-    end[0] = '.';
-    end[1] = 'b';
-    end[2] = 'm';
-    end[3] = 'p';
-    end[4] = '\0';
+    // The whole file is mapped and read in place
+    MappedFile file(filename);
+    if (!file.isOpen()) 
+        return false;
 
-    FILE* file = nullptr;
-    fopen_s(&file, filename, "rb");
-    if (!file) return false;
+    const uint8_t* data = (const uint8_t*)file.data();
+    const size_t size = (size_t)file.size();
 
-    // Check signature
-    char sig[2];
-    if (fread(sig, 1, 2, file) != 2 || sig[0] != 'B' || sig[1] != 'M')
+    // Check signature, the format is found by the contents of the file
+    if (PngCodec::isPng(data, size))
     {
-        fclose(file);
-        return false;
+        return PngCodec::decode(data, size, this);
     }
 
-    (void)read_le32(file); // bfSize
-    (void)read_le16(file); // bfReserved1
-    (void)read_le16(file); // bfReserved2
-    uint32_t bfOffBits = read_le32(file);
+    if (size < 14u + 40u || data[0] != 'B' || data[1] != 'M')
+        return false;
+
+    uint32_t bfOffBits = load_le32(data + 10);
 
-    uint32_t biSize = read_le32(file);
+    uint32_t biSize = load_le32(data + 14);
     if (biSize < 40u) 
-    { 
-        fclose(file); 
-        return false; 
-    } // we expect BITMAPINFOHEADER or larger
-
-    int32_t biWidth = (int32_t)read_le32(file);
-    int32_t biHeight = (int32_t)read_le32(file);
-    uint16_t biPlanes = read_le16(file);
-    uint16_t biBitCount = read_le16(file);
-    uint32_t biCompression = read_le32(file);
-    (void)read_le32(file); // biSizeImage
-    (void)read_le32(file); // biXPelsPerMeter
-    (void)read_le32(file); // biYPelsPerMeter
-    (void)read_le32(file); // biClrUsed
-    (void)read_le32(file); // biClrImportant
-
-    if (biPlanes != 1 || (biBitCount != 24 && biBitCount != 32) || (biCompression != 0 && biCompression != 3))
-    {
-        fclose(file);
-        return false; // only uncompressed 24/32-bit
-    }
+        return false; // we expect BITMAPINFOHEADER or larger
 
-    // Some BMPs have extra header bytes; seek to pixel array
-    if (fseek(file, (long)bfOffBits, SEEK_SET) != 0) 
-    { 
-        fclose(file); 
-        return false; 
-    }
+    int32_t biWidth = (int32_t)load_le32(data + 18);
+    int32_t biHeight = (int32_t)load_le32(data + 22);
+    uint16_t biPlanes = load_le16(data + 26);
+    uint16_t biBitCount = load_le16(data + 28);
+    uint32_t biCompression = load_le32(data + 30);
+
+    if (biPlanes != 1 || (biBitCount != 24 && biBitCount != 32) || (biCompression != 0 && biCompression != 3) || biWidth < 0)
+        return false; // only uncompressed 24/32-bit
 
     const bool top_down = (biHeight < 0);
     const uint32_t w = (uint32_t)biWidth;
-    const uint32_t h = (uint32_t)(top_down ? -biHeight : biHeight);
+    const uint32_t h = top_down ? 0u - (uint32_t)biHeight : (uint32_t)biHeight;
     const uint32_t bytes_per_pixel = (biBitCount == 32) ? 4u : 3u;
-    const uint32_t row_stride = ((w * bytes_per_pixel + 3u) / 4u) * 4u;
+
+    // Computed in 64 bits, so that huge widths can not wrap around to a small stride
+    const uint64_t row_stride = (((uint64_t)w * bytes_per_pixel + 3u) / 4u) * 4u;
+
+    // Some BMPs have extra header bytes, the pixel array must fit after them. The rows 
+    // are compared against the size per row so that the product can not overflow either.
+    if (bfOffBits > size || (h && row_stride > (size - bfOffBits) / h))
+        return false;
 
     // allocate
-    if (pixels_)
-        free(pixels_);
+    release();
 
     width_ = w; height_ = h;
-    pixels_ = (Color*)calloc(w * h, sizeof(Color));
+    pixels_ = allocate_pixels((size_t)w * h);
+
+    // Rows are converted in parallel straight from the mapped file. 32 bit rows already 
+    // have the layout of the colors, 24 bit rows are expanded.
+    const uint8_t* pixel_data = data + bfOffBits;
 
-    uint8_t* row = (uint8_t*)calloc(row_stride, sizeof(uint8_t));
-    for (uint32_t y = 0; y < h; ++y)
+    ThreadPool::parallelFor(h, BMP_ROW_CHUNK, [&](unsigned begin, unsigned end, unsigned)
     {
-        uint8_t* in = row;
-        if (fread(in, sizeof(uint8_t), row_stride, file) != row_stride) 
-        { 
-            free(row); 
-            fclose(file); 
-            return false; 
+        for (uint32_t y = begin; y < end; ++y)
+        {
+            const uint8_t* in = pixel_data + (size_t)y * row_stride;
+
+            uint32_t dst_y = top_down ? y : (h - 1 - y);
+            Color* out = &pixels_[(size_t)dst_y * w];
+
+            if (biBitCount == 32)
+                memcpy(out, in, (size_t)w * sizeof(Color));
+
+            else
+                bgr_to_bgra_row(in, out, w);
         }
+    });
 
-        uint32_t dst_y = top_down ? y : (h - 1 - y);
-        Color* out = &pixels_[dst_y * w];
+    return true;
+}
 
-        if (biBitCount == 32)
-            for (uint32_t x = 0; x < w; ++x)
-            {
-                out[x].B = *(in++);
-                out[x].G = *(in++);
-                out[x].R = *(in++);
-                out[x].A = *(in++);
-            }
+// Maps the file specified and uses its pixels in place if it is a 32 bit top down 
+// bitmap with aligned pixels, otherwise it is loaded normally.
 
-        else
-            for (uint32_t x = 0; x < w; ++x)
-            {
-                out[x].B = *(in++);
-                out[x].G = *(in++);
-                out[x].R = *(in++);
-                out[x].A = 255;
-            }
+bool Image::map(const char* filename_, bool copy_on_write)
+{
+    if (!filename_ || !*filename_)
+        return 0;
+
+    char filename[512];
+    strncpy_s(filename, filename_, 507);
+    filename[507] = '\0';
+
+    // Force the correct extension, unless it is a PNG file
+    if (!has_png_extension(filename))
+        force_bmp_extension(filename);
+
+    MappedFile* file = new MappedFile(filename, copy_on_write);
+    if (!file->isOpen())
+    {
+        delete file;
+        return false;
     }
 
-    free(row);
-    fclose(file);
+    const uint8_t* data = (const uint8_t*)file->data();
+    const size_t size = (size_t)file->size();
+
+    // Only 32 bit top down bitmaps have the layout of the image, the pixel array is 
+    // stored row after row from the top with no padding. The mapping starts at a page 
+    // boundary, so the pixel offset must keep the 64 byte alignment of the pixels.
+    bool in_place = size >= 14u + 40u && data[0] == 'B' && data[1] == 'M';
+
+    uint32_t bfOffBits = 0u, w = 0u, h = 0u;
+    if (in_place)
+    {
+        bfOffBits = load_le32(data + 10);
+
+        const uint32_t biSize = load_le32(data + 14);
+        const int32_t biWidth = (int32_t)load_le32(data + 18);
+        const int32_t biHeight = (int32_t)load_le32(data + 22);
+        const uint16_t biPlanes = load_le16(data + 26);
+        const uint16_t biBitCount = load_le16(data + 28);
+        const uint32_t biCompression = load_le32(data + 30);
+
+        w = (uint32_t)biWidth;
+        h = 0u - (uint32_t)biHeight;
+
+        in_place = biSize >= 40u && biPlanes == 1 && biBitCount == 32 && (biCompression == 0 || biCompression == 3) &&
+            biWidth >= 0 && biHeight < 0 && bfOffBits % 64u == 0u && bfOffBits <= size && (!h || (uint64_t)w * sizeof(Color) <= (size - bfOffBits) / h);
+    }
+
+    // Any other file is decoded into its own pixels
+    if (!in_place)
+    {
+        delete file;
+        return load(filename);
+    }
+
+    release();
+
+    mapping_ = file;
+    pixels_ = (Color*)(data + bfOffBits);
+    width_ = w; height_ = h;
     return true;
 }
 
@@ -393,192 +1130,386 @@ bool Image::load(const char* filename_)
 -------------------------------------------------------------------------------------------------------
 */
 
-// Helper functions, they take spherical coordinates and a formatted image and sample
-// the color from the specified coordinates in the specified spherical format.
+// Every cube texel direction is an affine function of its face coordinates s and t, 
+// in the range (-1,1) from left to right and top to bottom. For each face and axis the 
+// table stores the constant, the s and the t coefficients, in the order [+X,-X,+Y,-Y,+Z,-Z].
 
-static inline Color interpolate_color(float u, float v, const Image& image)
+static const float cube_face_axes[6][3][3] =
 {
-    // Set the image coordinates to [0,1)x[0,1)
-    u -= floorf(u);
-    if (v > 0.9999f) v = 0.9999f;
-    if (v < 0.f) v = 0.f;
+    { { 0.f,-1.f, 0.f }, { 1.f, 0.f, 0.f }, { 0.f, 0.f,-1.f } },
+    { { 0.f, 1.f, 0.f }, {-1.f, 0.f, 0.f }, { 0.f, 0.f,-1.f } },
+    { { 0.f, 0.f, 1.f }, { 0.f, 1.f, 0.f }, { 1.f, 0.f, 0.f } },
+    { { 0.f, 0.f,-1.f }, { 0.f, 1.f, 0.f }, {-1.f, 0.f, 0.f } },
+    { { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f,-1.f } },
+    { {-1.f, 0.f, 0.f }, { 0.f,-1.f, 0.f }, { 0.f, 0.f,-1.f } },
+};
 
-    // Map to image pixels
-    float x = u * (image.width() - 1.f);
-    float y = v * (image.height() - 1.f);
+// Number of cube rows converted by every parallel task.
+#define CUBE_ROW_CHUNK 16u
 
-    // Get neerest pixel coordinates
-    int x0 = (int)floorf(x);
-    int y0 = (int)floorf(y);
-    int x1 = x0 + 1;
-    int y1 = y0 + 1;
+// Texels marked with this horizontal coordinate are filled instead of sampled.
+#define CUBE_FILL_TEXEL -1.f
 
-    // Get pixel distances
-    float tx = x - (float)x0;
-    float ty = y - (float)y0;
+// Polynomial arctangent of two variables, the error is around 1e-5 radians, a small 
+// fraction of a pixel even for the widest panoramas. The scalar and SIMD versions 
+// follow the same steps, so the conversions barely depend on the code path.
 
-    // Get pixel colors
-    _float4color c00 = image(y0, x0).getColor4();
-    _float4color c10 = image(y0, x1).getColor4();
-    _float4color c01 = image(y1, x0).getColor4();
-    _float4color c11 = image(y1, x1).getColor4();
+static inline float fast_atan2(float y, float x)
+{
+    const float ax = x < 0.f ? -x : x;
+    const float ay = y < 0.f ? -y : y;
+    const float mx = ax > ay ? ax : ay;
+    const float mn = ax > ay ? ay : ax;
+
+    const float a = mx > 0.f ? mn / mx : 0.f;
+    const float s = a * a;
+    float r = a * (0.99986600f + s * (-0.33029950f + s * (0.18014100f + s * (-0.08513300f + s * 0.02083510f))));
+
+    if (ay > ax) r = 1.57079633f - r;
+    if (x < 0.f) r = 3.14159265f - r;
+    return y < 0.f ? -r : r;
+}
 
-    // Interpolation function
-    static auto intrp = [](_float4color c0, _float4color c1, float t) {
-        return _float4color
-        (
-            c0.r * (1.f - t) + c1.r * t,
-            c0.g * (1.f - t) + c1.g * t,
-            c0.b * (1.f - t) + c1.b * t,
-            c0.a * (1.f - t) + c1.a * t
-        );
-    };
+#ifdef _IMAGE_SSE2
+static inline __m128 fast_atan2_ps(__m128 y, __m128 x)
+{
+    const __m128 sign = _mm_set1_ps(-0.f);
+    const __m128 ax = _mm_andnot_ps(sign, x);
+    const __m128 ay = _mm_andnot_ps(sign, y);
+    const __m128 mx = _mm_max_ps(ax, ay);
+    const __m128 mn = _mm_min_ps(ax, ay);
+
+    const __m128 a = _mm_and_ps(_mm_div_ps(mn, mx), _mm_cmpgt_ps(mx, _mm_setzero_ps()));
+    const __m128 s = _mm_mul_ps(a, a);
+
+    __m128 r = _mm_set1_ps(0.02083510f);
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(-0.08513300f));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(0.18014100f));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(-0.33029950f));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(0.99986600f));
+    r = _mm_mul_ps(r, a);
+
+    const __m128 steep = _mm_cmpgt_ps(ay, ax);
+    r = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(_mm_set1_ps(1.57079633f), r)), _mm_andnot_ps(steep, r));
 
-    // Interpolate sideways
-    _float4color c0 = intrp(c00, c10, tx);
-    _float4color c1 = intrp(c01, c11, tx);
+    const __m128 back = _mm_cmplt_ps(x, _mm_setzero_ps());
+    r = _mm_or_ps(_mm_and_ps(back, _mm_sub_ps(_mm_set1_ps(3.14159265f), r)), _mm_andnot_ps(back, r));
 
-    // Interpolate vertically
-    return Color(intrp(c0, c1, ty));
+    return _mm_or_ps(r, _mm_and_ps(_mm_cmplt_ps(y, _mm_setzero_ps()), sign));
 }
-static inline Color sample_from_equirect(float x, float y, float z, const Image& equirect)
+#endif
+
+// Helper functions, they take a row of cube directions and compute the coordinates in 
+// [0,1)x[0,1) where the projection image is to be sampled for every direction.
+
+static void equirect_coordinates(const float* x, const float* y, const float* z, float* u, float* v, unsigned count)
 {
-    // Normalize the coordinates
-    const float norm = sqrtf(x * x + y * y + z * z);
-    x /= norm;
-    y /= norm;
-    z /= norm;
+    unsigned i = 0u;
+
+#ifdef _IMAGE_SSE2
+    for (; i + 4u <= count; i += 4u)
+    {
+        const __m128 X = _mm_loadu_ps(x + i);
+        const __m128 Y = _mm_loadu_ps(y + i);
+        const __m128 Z = _mm_loadu_ps(z + i);
 
-    // Obtain latitude and longitude from the normalized values
-    float theta = atan2f(y, x);
-    float phi = asinf(z);
+        // Latitude and longitude, the latitude is asin(z) of the normalized direction
+        const __m128 theta = fast_atan2_ps(Y, X);
+        const __m128 phi = fast_atan2_ps(Z, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(X, X), _mm_mul_ps(Y, Y))));
 
-    // Divide by 2*PI and add 1/2 to get it in range (0,1)
-    float u = theta * 0.1591549430918953f + 0.5f;
-    // Divide by PI and subtract from 1/2 to get it in range (0,1)
-    float v = 0.5f - phi * 0.3183098861837907f;
+        // Divide by 2*PI and add 1/2, and divide by PI and subtract from 1/2
+        _mm_storeu_ps(u + i, _mm_add_ps(_mm_mul_ps(theta, _mm_set1_ps(0.1591549430918953f)), _mm_set1_ps(0.5f)));
+        _mm_storeu_ps(v + i, _mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(phi, _mm_set1_ps(0.3183098861837907f))));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        const float theta = fast_atan2(y[i], x[i]);
+        const float phi = fast_atan2(z[i], sqrtf(x[i] * x[i] + y[i] * y[i]));
 
-    // Interpolate the obtained image coordinates
-    return interpolate_color(u, v, equirect);
+        u[i] = theta * 0.1591549430918953f + 0.5f;
+        v[i] = 0.5f - phi * 0.3183098861837907f;
+    }
 }
-static inline Color sample_from_fisheye(float x, float y, float z, const Image& fisheye, ToCube::FISHEYE_TYPE type)
+
+static void fisheye_coordinates(const float* x, const float* y, const float* z, float* u, float* v, unsigned count, ToCube::FISHEYE_TYPE type)
 {
-    // Normalize the coordinates
-    const float norm = sqrtf(x * x + y * y + z * z);
-    x /= norm;
-    y /= norm;
-    z /= norm;
+    // The angle around the axis is only needed through its sine and cosine, x/r and y/r, 
+    // and the angle from the axis through its half angle functions, so only the
+    // equidistant projection needs an arctangent.
+    const float div = ToCube::STEREOGRAPHIC_DIV;
+
+    unsigned i = 0u;
+
+#ifdef _IMAGE_SSE2
+    for (; i + 4u <= count; i += 4u)
+    {
+        const __m128 X = _mm_loadu_ps(x + i);
+        const __m128 Y = _mm_loadu_ps(y + i);
+        const __m128 Z = _mm_loadu_ps(z + i);
+
+        const __m128 R = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(X, X), _mm_mul_ps(Y, Y)));
+        const __m128 N = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(R, R), _mm_mul_ps(Z, Z)));
+
+        __m128 rho = _mm_setzero_ps();
+        __m128 fill = _mm_setzero_ps();
+        switch (type)
+        {
+        case ToCube::FISHEYE_EQUIDISTANT:
+            // Divide by pi
+            rho = _mm_mul_ps(fast_atan2_ps(R, Z), _mm_set1_ps(0.3183098861837907f));
+            break;
+
+        case ToCube::FISHEYE_EQUISOLID:
+            // Sine of half the angle
+            rho = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_div_ps(_mm_mul_ps(_mm_set1_ps(0.5f), Z), N)), _mm_setzero_ps()));
+            break;
+
+        case ToCube::FISHEYE_STEREOGRAPHIC:
+        {
+            // Tangent of half the angle, if out of image bounds it is filled
+            const __m128 D = _mm_add_ps(N, Z);
+            fill = _mm_cmpge_ps(R, _mm_mul_ps(_mm_set1_ps(div), D));
+            rho = _mm_andnot_ps(fill, _mm_div_ps(R, _mm_mul_ps(D, _mm_set1_ps(div))));
+            break;
+        }
+
+        default:
+            fill = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            break;
+        }
 
-    // Get the spherical coordinates
-    float theta = atan2f(sqrtf(x * x + y * y), z);
-    float alpha = atan2f(y, x);
+        // Get the circle coordinates in range (0,1)x(0,1)
+        const __m128 axial = _mm_cmpgt_ps(R, _mm_setzero_ps());
+        const __m128 scale = _mm_and_ps(_mm_div_ps(_mm_mul_ps(_mm_set1_ps(0.5f), rho), R), axial);
+        const __m128 U = _mm_add_ps(_mm_set1_ps(0.5f), _mm_or_ps(_mm_and_ps(axial, _mm_mul_ps(X, scale)), _mm_andnot_ps(axial, _mm_mul_ps(_mm_set1_ps(0.5f), rho))));
+        const __m128 V = _mm_add_ps(_mm_set1_ps(0.5f), _mm_mul_ps(Y, scale));
 
-    // Transform the angular distance to radius depending on the type
-    float rho;
-    switch (type)
+        _mm_storeu_ps(u + i, _mm_or_ps(_mm_and_ps(fill, _mm_set1_ps(CUBE_FILL_TEXEL)), _mm_andnot_ps(fill, U)));
+        _mm_storeu_ps(v + i, V);
+    }
+#endif
+
+    for (; i < count; i++)
     {
-    case ToCube::FISHEYE_EQUIDISTANT:
-        // Divide by pi
-        rho = theta * 0.3183098861837907f;
-        break;
+        const float r = sqrtf(x[i] * x[i] + y[i] * y[i]);
+        const float n = sqrtf(r * r + z[i] * z[i]);
 
-    case ToCube::FISHEYE_EQUISOLID:
-        // Transform to radius (0,1)
-        rho = sinf(theta / 2.f);
-        break;
+        float rho;
+        switch (type)
+        {
+        case ToCube::FISHEYE_EQUIDISTANT:
+            // Divide by pi
+            rho = fast_atan2(r, z[i]) * 0.3183098861837907f;
+            break;
+
+        case ToCube::FISHEYE_EQUISOLID:
+            // Sine of half the angle
+            rho = 0.5f - 0.5f * z[i] / n;
+            rho = rho > 0.f ? sqrtf(rho) : 0.f;
+            break;
+
+        case ToCube::FISHEYE_STEREOGRAPHIC:
+            // Tangent of half the angle, if out of image bounds it is filled
+            if (r >= div * (n + z[i]))
+            {
+                u[i] = CUBE_FILL_TEXEL;
+                continue;
+            }
+            rho = r / ((n + z[i]) * div);
+            break;
 
-    case ToCube::FISHEYE_STEREOGRAPHIC:
-        // Transform to radius (0,1)
-        rho = tanf(theta / 2.f) / ToCube::STEREOGRAPHIC_DIV;
-        // If out of image bounds return
-        if (rho > 1.f) return ToCube::STEREOGRAPHIC_FILL;
-        break;
+        default:
+            u[i] = CUBE_FILL_TEXEL;
+            continue;
+        }
 
-    default:
-        return Color::Transparent;
+        // Get the circle coordinates in range (0,1)x(0,1)
+        const float scale = r > 0.f ? 0.5f * rho / r : 0.f;
+        u[i] = 0.5f + (r > 0.f ? x[i] * scale : 0.5f * rho);
+        v[i] = 0.5f + y[i] * scale;
     }
+}
+
+// Converts a row of coordinates in [0,1)x[0,1) to image pixel positions in 8 bit fixed 
+// point, the horizontal coordinate wraps around and the vertical one is clamped.
 
-    // Get the circle coordinates in range (0,1)x(0,1)
-    float u = 0.5f + rho * cosf(alpha) / 2.f;
-    float v = 0.5f + rho * sinf(alpha) / 2.f;
+static void fixed_positions(const ImageView& image, const float* u, const float* v, int* px, int* py, unsigned count)
+{
+    const float scale_x = (image.width() - 1.f) * 256.f;
+    const float scale_y = (image.height() - 1.f) * 256.f;
+
+    unsigned i = 0u;
+
+#ifdef _IMAGE_SSE2
+    for (; i + 4u <= count; i += 4u)
+    {
+        // Set the image coordinates to [0,1)x[0,1)
+        __m128 U = _mm_loadu_ps(u + i);
+        const __m128 whole = _mm_cvtepi32_ps(_mm_cvttps_epi32(U));
+        U = _mm_sub_ps(U, _mm_sub_ps(whole, _mm_and_ps(_mm_cmpgt_ps(whole, U), _mm_set1_ps(1.f))));
+        const __m128 V = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(v + i), _mm_setzero_ps()), _mm_set1_ps(0.9999f));
+
+        _mm_storeu_si128((__m128i*)(px + i), _mm_cvtps_epi32(_mm_mul_ps(U, _mm_set1_ps(scale_x))));
+        _mm_storeu_si128((__m128i*)(py + i), _mm_cvtps_epi32(_mm_mul_ps(V, _mm_set1_ps(scale_y))));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        // Set the image coordinates to [0,1)x[0,1)
+        float U = u[i] - (float)(int)u[i];
+        if (U < 0.f) U += 1.f;
+        const float V = v[i] < 0.f ? 0.f : v[i] > 0.9999f ? 0.9999f : v[i];
 
-    // Interpolate the obtained image coordinates
-    return interpolate_color(u, v, fisheye);
+        px[i] = (int)(U * scale_x + 0.5f);
+        py[i] = (int)(V * scale_y + 0.5f);
+    }
 }
 
-// Equirectangular projections are extremely common, they follow the typical
-// latitude longitude coordinate system and are widely used for all kinds of
-// applications. This function allows you to convert equirectangular projection
-// images to texture cubes.
+// Samples the image at the fixed point pixel position with bilinear interpolation. With 
+// SIMD the four colors are blended at once in 16 bit lanes, two colors per row and then 
+// the two rows.
 
-Image* ToCube::from_equirect(const Image& equirect, unsigned cube_width)
+static inline Color interpolate_color(int px, int py, const ImageView& image)
 {
-    if (!equirect.width() || !equirect.height())
-        return nullptr;
+    // Get nearest pixel coordinates, clamped for single pixel images
+    const unsigned x0 = (unsigned)px >> 8;
+    const unsigned y0 = (unsigned)py >> 8;
+    const unsigned x1 = x0 + 1u < image.width() ? x0 + 1u : x0;
+    const unsigned y1 = y0 + 1u < image.height() ? y0 + 1u : y0;
+
+    // Get pixel distances as weights out of 256
+    const int tx = px & 255;
+    const int ty = py & 255;
+
+    const Color* row0 = image.row(y0);
+    const Color* row1 = image.row(y1);
+
+#ifdef _IMAGE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi16(128);
+
+    uint32_t c00, c10, c01, c11;
+    memcpy(&c00, row0 + x0, 4u);
+    memcpy(&c10, row0 + x1, 4u);
+    memcpy(&c01, row1 + x0, 4u);
+    memcpy(&c11, row1 + x1, 4u);
+
+    // Interpolate sideways, left colors in the low lanes and right colors in the high lanes
+    const __m128i wx = _mm_unpacklo_epi64(_mm_set1_epi16((short)(256 - tx)), _mm_set1_epi16((short)tx));
+    __m128i top = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128((int)c00), _mm_cvtsi32_si128((int)c10)), zero), wx);
+    __m128i bot = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128((int)c01), _mm_cvtsi32_si128((int)c11)), zero), wx);
+    top = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(top, _mm_srli_si128(top, 8)), half), 8);
+    bot = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(bot, _mm_srli_si128(bot, 8)), half), 8);
+
+    // Interpolate vertically, top row in the low lanes and bottom row in the high lanes
+    const __m128i wy = _mm_unpacklo_epi64(_mm_set1_epi16((short)(256 - ty)), _mm_set1_epi16((short)ty));
+    __m128i col = _mm_mullo_epi16(_mm_unpacklo_epi64(top, bot), wy);
+    col = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(col, _mm_srli_si128(col, 8)), half), 8);
+
+    // Pack back to BGRA bytes
+    const uint32_t packed = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(col, zero));
+    return Color((unsigned char)(packed >> 16), (unsigned char)(packed >> 8), (unsigned char)packed, (unsigned char)(packed >> 24));
+#else
+    // Interpolation function
+    auto intrp = [](unsigned c00, unsigned c10, unsigned c01, unsigned c11, int tx, int ty)
+    {
+        const unsigned top = (c00 * (256 - tx) + c10 * tx + 128u) >> 8;
+        const unsigned bot = (c01 * (256 - tx) + c11 * tx + 128u) >> 8;
+        return (unsigned char)((top * (256 - ty) + bot * ty + 128u) >> 8);
+    };
 
-    Image& cube = *new Image(cube_width, 6u * cube_width);
+    Color color;
+    color.B = intrp(row0[x0].B, row0[x1].B, row1[x0].B, row1[x1].B, tx, ty);
+    color.G = intrp(row0[x0].G, row0[x1].G, row1[x0].G, row1[x1].G, tx, ty);
+    color.R = intrp(row0[x0].R, row0[x1].R, row1[x0].R, row1[x1].R, tx, ty);
+    color.A = intrp(row0[x0].A, row0[x1].A, row1[x0].A, row1[x1].A, tx, ty);
+    return color;
+#endif
+}
 
-    for (unsigned row = 0u; row < cube_width; row++)
-        for (unsigned col = 0u; col < cube_width; col++)
-            cube(row + 0u * cube_width, col) = sample_from_equirect(1.f - 2.f * float(col + 0.5f) / cube_width,  1.f, 1.f - 2.f * float(row + 0.5f) / cube_width, equirect);
+// Creates the cube image and fills it in parallel, every task computes the directions of
+// a few cube rows from the face table, maps them with the projection function, and 
+// samples the source image at the resulting coordinates.
 
-    for (unsigned row = 0u; row < cube_width; row++)
-        for (unsigned col = 0u; col < cube_width; col++)
-            cube(row + 1u * cube_width, col) = sample_from_equirect(2.f * float(col + 0.5f) / cube_width - 1.f, -1.f, 1.f - 2.f * float(row + 0.5f) / cube_width, equirect);
+template<class Projection>
+static Image* create_cube(const ImageView& source, unsigned cube_width, Color fill, const Projection& projection)
+{
+    Image& cube = *new Image(cube_width, 6u * cube_width);
 
-    for (unsigned row = 0u; row < cube_width; row++)
-        for (unsigned col = 0u; col < cube_width; col++)
-            cube(row + 2u * cube_width, col) = sample_from_equirect(2.f * float(row + 0.5f) / cube_width - 1.f, 2.f * float(col + 0.5f) / cube_width - 1.f,  1.f, equirect);
+    ThreadPool::parallelFor(6u * cube_width, CUBE_ROW_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+    {
+        float* buffer = new float[5u * cube_width];
+        float* x = buffer;
+        float* y = buffer + cube_width;
+        float* z = buffer + 2u * cube_width;
+        float* u = buffer + 3u * cube_width;
+        float* v = buffer + 4u * cube_width;
+
+        int* positions = new int[2u * cube_width];
+        int* px = positions;
+        int* py = positions + cube_width;
+
+        for (unsigned row = begin; row < end; row++)
+        {
+            const unsigned face = row / cube_width;
+            const float t = 2.f * float(row % cube_width + 0.5f) / cube_width - 1.f;
+            const float (&axes)[3][3] = cube_face_axes[face];
 
-    for (unsigned row = 0u; row < cube_width; row++)
-        for (unsigned col = 0u; col < cube_width; col++)
-            cube(row + 3u * cube_width, col) = sample_from_equirect(1.f - 2.f * float(row + 0.5f) / cube_width, 2.f * float(col + 0.5f) / cube_width - 1.f, -1.f, equirect);
+            for (unsigned col = 0u; col < cube_width; col++)
+            {
+                const float s = 2.f * float(col + 0.5f) / cube_width - 1.f;
+                x[col] = axes[0][0] + axes[0][1] * s + axes[0][2] * t;
+                y[col] = axes[1][0] + axes[1][1] * s + axes[1][2] * t;
+                z[col] = axes[2][0] + axes[2][1] * s + axes[2][2] * t;
+            }
 
-    for (unsigned row = 0u; row < cube_width; row++)
-        for (unsigned col = 0u; col < cube_width; col++)
-            cube(row + 4u * cube_width, col) = sample_from_equirect( 1.f, 2.f * float(col + 0.5f) / cube_width - 1.f, 1.f - 2.f * float(row + 0.5f) / cube_width, equirect);
+            projection(x, y, z, u, v, cube_width);
+            fixed_positions(source, u, v, px, py, cube_width);
 
-    for (unsigned row = 0u; row < cube_width; row++)
-        for (unsigned col = 0u; col < cube_width; col++)
-            cube(row + 5u * cube_width, col) = sample_from_equirect(-1.f, 1.f - 2.f * float(col + 0.5f) / cube_width, 1.f - 2.f * float(row + 0.5f) / cube_width, equirect);
+            Color* out = cube.pixels() + (size_t)row * cube_width;
+            for (unsigned col = 0u; col < cube_width; col++)
+                out[col] = u[col] == CUBE_FILL_TEXEL ? fill : interpolate_color(px[col], py[col], source);
+        }
+
+        delete[] positions;
+        delete[] buffer;
+    });
 
     return &cube;
 }
 
+// Equirectangular projections are extremely common, they follow the typical
+// latitude longitude coordinate system and are widely used for all kinds of
+// applications. This function allows you to convert equirectangular projection
+// images to texture cubes.
+
+Image* ToCube::from_equirect(const ImageView& equirect, unsigned cube_width)
+{
+    if (!equirect.width() || !equirect.height())
+        return nullptr;
+
+    return create_cube(equirect, cube_width, Color::Transparent, 
+        [](const float* x, const float* y, const float* z, float* u, float* v, unsigned count)
+        {
+            equirect_coordinates(x, y, z, u, v, count);
+        });
+}
+
 // Fish-eye or circular panoramic pictures are common as a result of 360 cameras
 // that usually take this format when taking their pictures. This function allows
 // you to convert your fish-eye 360 pictures into texture cubes.
 
-Image* ToCube::from_fisheye(const Image& fisheye, unsigned cube_width, FISHEYE_TYPE type)
+Image* ToCube::from_fisheye(const ImageView& fisheye, unsigned cube_width, FISHEYE_TYPE type)
 {
     if (!fisheye.width() || !fisheye.height())
         return nullptr;
 
-    Image& cube = *new Image(cube_width, 6u * cube_width);
-
-    for (unsigned row = 0u; row < cube_width; row++)
-        for (unsigned col = 0u; col < cube_width; col++)
-            cube(row + 0u * cube_width, col) = sample_from_fisheye(1.f - 2.f * float(col + 0.5f) / cube_width,  1.f, 1.f - 2.f * float(row + 0.5f) / cube_width, fisheye, type);
-
-    for (unsigned row = 0u; row < cube_width; row++)
-        for (unsigned col = 0u; col < cube_width; col++)
-            cube(row + 1u * cube_width, col) = sample_from_fisheye(2.f * float(col + 0.5f) / cube_width - 1.f, -1.f, 1.f - 2.f * float(row + 0.5f) / cube_width, fisheye, type);
-
-    for (unsigned row = 0u; row < cube_width; row++)
-        for (unsigned col = 0u; col < cube_width; col++)
-            cube(row + 2u * cube_width, col) = sample_from_fisheye(2.f * float(row + 0.5f) / cube_width - 1.f, 2.f * float(col + 0.5f) / cube_width - 1.f,  1.f, fisheye, type);
-
-    for (unsigned row = 0u; row < cube_width; row++)
-        for (unsigned col = 0u; col < cube_width; col++)
-            cube(row + 3u * cube_width, col) = sample_from_fisheye(1.f - 2.f * float(row + 0.5f) / cube_width, 2.f * float(col + 0.5f) / cube_width - 1.f, -1.f, fisheye, type);
-
-    for (unsigned row = 0u; row < cube_width; row++)
-        for (unsigned col = 0u; col < cube_width; col++)
-            cube(row + 4u * cube_width, col) = sample_from_fisheye( 1.f, 2.f * float(col + 0.5f) / cube_width - 1.f, 1.f - 2.f * float(row + 0.5f) / cube_width, fisheye, type);
-
-    for (unsigned row = 0u; row < cube_width; row++)
-        for (unsigned col = 0u; col < cube_width; col++)
-            cube(row + 5u * cube_width, col) = sample_from_fisheye(-1.f, 1.f - 2.f * float(col + 0.5f) / cube_width, 1.f - 2.f * float(row + 0.5f) / cube_width, fisheye, type);
-
-    return &cube;
+    return create_cube(fisheye, cube_width, STEREOGRAPHIC_FILL, 
+        [type](const float* x, const float* y, const float* z, float* u, float* v, unsigned count)
+        {
+            fisheye_coordinates(x, y, z, u, v, count, type);
+        });
 }
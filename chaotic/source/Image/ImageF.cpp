@@ -0,0 +1,910 @@
+#include "Image/Image.h"
+
+#include "Error/_erDefault.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#if defined _M_X64 || defined _M_IX86 || defined __SSE2__
+#include <emmintrin.h>
+#define _IMAGEF_SSE2
+#endif
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Helper functions to allocate pixels
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Pixel arrays start at a cache line, like the ones of regular images.
+#define IMAGEF_ALIGNMENT 64u
+
+// Number of pixels processed by every parallel task.
+#define IMAGEF_PIXEL_CHUNK 16384u
+
+// Allocates the pixel array aligned to IMAGEF_ALIGNMENT, the values are not initialized.
+
+static void* allocate_pixels(size_t bytes)
+{
+	// The size is rounded up to the alignment, as required by aligned_alloc()
+	bytes = (bytes + IMAGEF_ALIGNMENT - 1u) & ~size_t(IMAGEF_ALIGNMENT - 1u);
+	if (!bytes)
+		bytes = IMAGEF_ALIGNMENT;
+
+#ifdef _WIN32
+	void* pixels = _aligned_malloc(bytes, IMAGEF_ALIGNMENT);
+#else
+	void* pixels = aligned_alloc(IMAGEF_ALIGNMENT, bytes);
+#endif
+
+	USER_CHECK(pixels,
+		"Failed to allocate the pixels of a float image, not enough memory available."
+	);
+	return pixels;
+}
+
+// Frees a pixel array allocated by allocate_pixels().
+
+static void free_pixels(void* pixels)
+{
+#ifdef _WIN32
+	_aligned_free(pixels);
+#else
+	free(pixels);
+#endif
+}
+
+// Calls the function for consecutive ranges of pixels across the thread pool.
+
+template<typename F>
+static void for_each_chunk(size_t count, const F& func)
+{
+	const unsigned chunks = unsigned((count + IMAGEF_PIXEL_CHUNK - 1u) / IMAGEF_PIXEL_CHUNK);
+
+	ThreadPool::parallelFor(chunks, 1u, [&](unsigned begin, unsigned end, unsigned thread)
+	{
+		const size_t first = (size_t)begin * IMAGEF_PIXEL_CHUNK;
+		const size_t last = (size_t)end * IMAGEF_PIXEL_CHUNK < count ? (size_t)end * IMAGEF_PIXEL_CHUNK : count;
+		func(first, last, thread);
+	});
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Half float conversions
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Bit casts between floats and their 32 bit patterns.
+
+static inline uint32_t float_bits(float f) { uint32_t u; memcpy(&u, &f, 4u); return u; }
+static inline float bits_float(uint32_t u) { float f; memcpy(&f, &u, 4u); return f; }
+
+// Converts a float to a half float rounding to the nearest even. Values too big become
+// infinite, NaN stays NaN, and values too small for a normal half become subnormals,
+// rounded by adding a magic number that aligns their mantissa to the half one.
+
+static inline uint16_t float_to_half(float f)
+{
+	const uint32_t subnormal_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+	uint32_t u = float_bits(f);
+	const uint32_t sign = u & 0x80000000u;
+	u ^= sign;
+
+	uint32_t h;
+	if (u >= (127u + 16u) << 23)
+		h = u > 255u << 23 ? 0x7E00u : 0x7C00u;
+	else if (u < (127u - 14u) << 23)
+		h = float_bits(bits_float(u) + bits_float(subnormal_magic)) - subnormal_magic;
+	else
+		h = (u + ((15u - 127u) << 23) + 0xFFFu + ((u >> 13) & 1u)) >> 13;
+
+	return uint16_t(h | (sign >> 16));
+}
+
+// Converts a half float to a float, the exponent is rebiased by a multiplication, which
+// also normalizes subnormals, and infinities and NaN get the maximum exponent.
+
+static inline float half_to_float(uint16_t h)
+{
+	const uint32_t magnitude = h & 0x7FFFu;
+	uint32_t u = float_bits(bits_float(magnitude << 13) * bits_float((254u - 15u) << 23));
+	if (magnitude > 0x7BFFu)
+		u |= 255u << 23;
+
+	return bits_float(u | (uint32_t(h & 0x8000u) << 16));
+}
+
+#ifdef _IMAGEF_SSE2
+// Converts four floats to half floats, following the same steps as float_to_half(). The
+// halves are returned in the low bits of every 32 bit lane, sign extended, so that they
+// can be packed to 16 bits with signed saturation without changing them.
+static inline __m128i float_to_half_epi32(__m128 f)
+{
+	const __m128i subnormal_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+
+	const __m128 sign = _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000u)));
+	const __m128 abs_f = _mm_xor_ps(f, sign);
+	const __m128i abs_i = _mm_castps_si128(abs_f);
+
+	// Infinities and NaN
+	const __m128i is_regular = _mm_cmpgt_epi32(_mm_set1_epi32((127 + 16) << 23), abs_i);
+	const __m128i nan_bit = _mm_and_si128(_mm_castps_si128(_mm_cmpunord_ps(abs_f, abs_f)), _mm_set1_epi32(0x200));
+	const __m128i special = _mm_or_si128(nan_bit, _mm_set1_epi32(0x7C00));
+
+	// Subnormal results
+	const __m128i is_subnormal = _mm_cmpgt_epi32(_mm_set1_epi32((127 - 14) << 23), abs_i);
+	const __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(abs_f, _mm_castsi128_ps(subnormal_magic))), subnormal_magic);
+
+	// Normal results, rounded to the nearest even
+	const __m128i odd = _mm_srli_epi32(_mm_slli_epi32(abs_i, 31 - 13), 31);
+	const __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(abs_i, _mm_set1_epi32(0xFFF - ((127 - 15) << 23))), odd), 13);
+
+	const __m128i finite = _mm_or_si128(_mm_and_si128(is_subnormal, subnormal), _mm_andnot_si128(is_subnormal, normal));
+	const __m128i half = _mm_or_si128(_mm_and_si128(is_regular, finite), _mm_andnot_si128(is_regular, special));
+
+	return _mm_or_si128(half, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+}
+
+// Converts four half floats, in the low bits of every 32 bit lane, to floats, following
+// the same steps as half_to_float().
+static inline __m128 half_to_float_ps(__m128i h)
+{
+	const __m128i magnitude = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+	const __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, magnitude), 16);
+
+	const __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(magnitude, 13)), _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+	const __m128i is_special = _mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x7BFF));
+	const __m128i special_exponent = _mm_and_si128(is_special, _mm_set1_epi32(255 << 23));
+
+	return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, special_exponent)));
+}
+#endif
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Pixel vectors
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Pixels are processed as vectors of four floats in RGBA order, a single register when SIMD
+// is available and an array otherwise, so every kernel is written once for both paths.
+
+#ifdef _IMAGEF_SSE2
+typedef __m128 pixel4;
+
+static inline pixel4 px_set(float r, float g, float b, float a) { return _mm_setr_ps(r, g, b, a); }
+static inline pixel4 px_set1(float v) { return _mm_set1_ps(v); }
+static inline pixel4 px_load(const float* p) { return _mm_loadu_ps(p); }
+static inline void px_store(float* p, pixel4 v) { _mm_storeu_ps(p, v); }
+static inline pixel4 px_add(pixel4 a, pixel4 b) { return _mm_add_ps(a, b); }
+static inline pixel4 px_mul(pixel4 a, pixel4 b) { return _mm_mul_ps(a, b); }
+static inline pixel4 px_div(pixel4 a, pixel4 b) { return _mm_div_ps(a, b); }
+
+// The limit is returned for NaN values, so clamping also removes NaN values.
+static inline pixel4 px_min(pixel4 v, pixel4 limit) { return _mm_min_ps(v, limit); }
+static inline pixel4 px_max(pixel4 v, pixel4 limit) { return _mm_max_ps(v, limit); }
+
+// Replaces the alpha channel of the first vector with the one of the second.
+static inline pixel4 px_with_alpha(pixel4 color, pixel4 alpha)
+{
+	const __m128 mask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+	return _mm_or_ps(_mm_andnot_ps(mask, color), _mm_and_ps(mask, alpha));
+}
+
+// Base two logarithm of values above one, from the exponent and a polynomial of the
+// mantissa. The error is around 3e-5, far below the precision of a color byte.
+static inline pixel4 px_log2(pixel4 v)
+{
+	const __m128i bits = _mm_castps_si128(v);
+	const __m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+	const __m128 t = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000))), _mm_set1_ps(1.f));
+
+	__m128 p = _mm_set1_ps(0.045885527f);
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.194422672f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(0.415421949f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.708682101f));
+	p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(1.441825795f));
+
+	return _mm_add_ps(exponent, _mm_mul_ps(p, t));
+}
+#else
+struct pixel4 { float v[4]; };
+
+static inline pixel4 px_set(float r, float g, float b, float a) { return { { r, g, b, a } }; }
+static inline pixel4 px_set1(float v) { return { { v, v, v, v } }; }
+static inline pixel4 px_load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+static inline void px_store(float* p, pixel4 v) { for (unsigned c = 0u; c < 4u; c++) p[c] = v.v[c]; }
+static inline pixel4 px_add(pixel4 a, pixel4 b) { for (unsigned c = 0u; c < 4u; c++) a.v[c] += b.v[c]; return a; }
+static inline pixel4 px_mul(pixel4 a, pixel4 b) { for (unsigned c = 0u; c < 4u; c++) a.v[c] *= b.v[c]; return a; }
+static inline pixel4 px_div(pixel4 a, pixel4 b) { for (unsigned c = 0u; c < 4u; c++) a.v[c] /= b.v[c]; return a; }
+
+// Clamping also removes NaN values, as the SIMD version does.
+static inline pixel4 px_min(pixel4 v, pixel4 limit) { for (unsigned c = 0u; c < 4u; c++) v.v[c] = v.v[c] < limit.v[c] ? v.v[c] : limit.v[c]; return v; }
+static inline pixel4 px_max(pixel4 v, pixel4 limit) { for (unsigned c = 0u; c < 4u; c++) v.v[c] = v.v[c] > limit.v[c] ? v.v[c] : limit.v[c]; return v; }
+
+// Replaces the alpha channel of the first vector with the one of the second.
+static inline pixel4 px_with_alpha(pixel4 color, pixel4 alpha) { color.v[3] = alpha.v[3]; return color; }
+
+// Base two logarithm of values above one, the same polynomial as the SIMD version.
+static inline pixel4 px_log2(pixel4 v)
+{
+	for (unsigned c = 0u; c < 4u; c++)
+	{
+		const uint32_t bits = float_bits(v.v[c]);
+		const float t = bits_float((bits & 0x007FFFFFu) | 0x3F800000u) - 1.f;
+		const float p = (((0.045885527f * t - 0.194422672f) * t + 0.415421949f) * t - 0.708682101f) * t + 1.441825795f;
+		v.v[c] = float(int(bits >> 23) - 127) + p * t;
+	}
+	return v;
+}
+#endif
+
+// Loads the pixel at the index from the pixels of the format specified.
+
+template<IMAGEF_FORMAT format>
+static inline pixel4 load_pixel(const void* pixels, size_t index)
+{
+	if (format == IMAGEF_RGBA32F)
+		return px_load((const float*)pixels + 4u * index);
+
+	const uint16_t* h = (const uint16_t*)pixels + 4u * index;
+#ifdef _IMAGEF_SSE2
+	return half_to_float_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)h), _mm_setzero_si128()));
+#else
+	return px_set(half_to_float(h[0]), half_to_float(h[1]), half_to_float(h[2]), half_to_float(h[3]));
+#endif
+}
+
+// Stores the pixel at the index of the pixels of the format specified.
+
+template<IMAGEF_FORMAT format>
+static inline void store_pixel(void* pixels, size_t index, pixel4 p)
+{
+	if (format == IMAGEF_RGBA32F)
+		return px_store((float*)pixels + 4u * index, p);
+
+	uint16_t* h = (uint16_t*)pixels + 4u * index;
+#ifdef _IMAGEF_SSE2
+	const __m128i halves = float_to_half_epi32(p);
+	_mm_storel_epi64((__m128i*)h, _mm_packs_epi32(halves, halves));
+#else
+	for (unsigned c = 0u; c < 4u; c++)
+		h[c] = float_to_half(p.v[c]);
+#endif
+}
+
+// Calls the function with the format of the image as a template argument, so that the
+// loops of every kernel are compiled separately for each format.
+
+#define IMAGEF_DISPATCH(format, call) \
+	((format) == IMAGEF_RGBA32F ? call<IMAGEF_RGBA32F> : call<IMAGEF_RGBA16F>)
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Color conversions
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Size of the table that encodes linear values to sRGB bytes, big enough for every
+// byte to survive the round trip through linear light.
+#define IMAGEF_LINEAR_STEPS 4096u
+
+// Conversion tables between sRGB bytes and linear values.
+struct ImageFTables
+{
+	float to_linear[256];
+	uint8_t to_srgb[IMAGEF_LINEAR_STEPS];
+
+	ImageFTables()
+	{
+		for (unsigned i = 0u; i < 256u; i++)
+		{
+			const float c = i / 255.f;
+			to_linear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (unsigned i = 0u; i < IMAGEF_LINEAR_STEPS; i++)
+		{
+			const float l = i / float(IMAGEF_LINEAR_STEPS - 1u);
+			const float s = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.f / 2.4f) - 0.055f;
+			to_srgb[i] = uint8_t((s < 1.f ? s : 1.f) * 255.f + 0.5f);
+		}
+	}
+};
+
+static const ImageFTables imagef_tables;
+
+// Converts the color to a pixel vector with values from 0 to 1, decoding the color
+// channels from sRGB if linear is true. The alpha channel is never decoded.
+
+static inline pixel4 color_to_pixel(Color c, bool linear)
+{
+	if (linear)
+		return px_set(imagef_tables.to_linear[c.R], imagef_tables.to_linear[c.G], imagef_tables.to_linear[c.B], c.A / 255.f);
+
+#ifdef _IMAGEF_SSE2
+	int packed;
+	memcpy(&packed, &c, sizeof(Color));
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 bgra = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero));
+	return _mm_mul_ps(_mm_shuffle_ps(bgra, bgra, _MM_SHUFFLE(3, 0, 1, 2)), _mm_set1_ps(1.f / 255.f));
+#else
+	return px_set(c.R / 255.f, c.G / 255.f, c.B / 255.f, c.A / 255.f);
+#endif
+}
+
+// Converts the pixel vector, with values from 0 to 1, to a color rounding to the closest
+// byte, encoding the color channels to sRGB if linear is true.
+
+static inline Color pixel_to_color(pixel4 p, bool linear)
+{
+	if (linear)
+	{
+		float v[4];
+		px_store(v, px_add(px_mul(p, px_set(IMAGEF_LINEAR_STEPS - 1.f, IMAGEF_LINEAR_STEPS - 1.f, IMAGEF_LINEAR_STEPS - 1.f, 255.f)), px_set1(0.5f)));
+
+		return Color(
+			imagef_tables.to_srgb[(unsigned)v[0]],
+			imagef_tables.to_srgb[(unsigned)v[1]],
+			imagef_tables.to_srgb[(unsigned)v[2]],
+			(unsigned char)v[3]
+		);
+	}
+
+#ifdef _IMAGEF_SSE2
+	__m128i rgba = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(p, _mm_set1_ps(255.f)), _mm_set1_ps(0.5f)));
+	rgba = _mm_shuffle_epi32(rgba, _MM_SHUFFLE(3, 0, 1, 2));
+	rgba = _mm_packs_epi32(rgba, rgba);
+
+	// The packed bytes are in BGRA order, the memory layout of the colors
+	const unsigned packed = (unsigned)_mm_cvtsi128_si32(_mm_packus_epi16(rgba, rgba));
+
+	return Color(
+		(unsigned char)(packed >> 16),
+		(unsigned char)(packed >> 8),
+		(unsigned char)(packed),
+		(unsigned char)(packed >> 24)
+	);
+#else
+	return Color(
+		(unsigned char)(p.v[0] * 255.f + 0.5f),
+		(unsigned char)(p.v[1] * 255.f + 0.5f),
+		(unsigned char)(p.v[2] * 255.f + 0.5f),
+		(unsigned char)(p.v[3] * 255.f + 0.5f)
+	);
+#endif
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Tone mapping
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Parameters of a tone mapping operator, the scale depends on the maximum of the image
+// for the operators that use it.
+struct ToneMapper
+{
+	TONE_MAP op;
+	float exposure;
+	float scale;
+};
+
+// Applies the tone mapping operator to the color channels of the pixel, and clamps all
+// four channels to the range [0,1]. NaN values become zero.
+
+static inline pixel4 tone_map(pixel4 p, const ToneMapper& tone)
+{
+	const pixel4 zero = px_set1(0.f);
+	const pixel4 one = px_set1(1.f);
+
+	pixel4 c = px_max(px_mul(p, px_set1(tone.exposure)), zero);
+
+	switch (tone.op)
+	{
+	case TONE_MAP_REINHARD:
+		c = px_div(c, px_add(c, one));
+		break;
+
+	case TONE_MAP_ACES:
+		c = px_div(
+			px_mul(c, px_add(px_mul(c, px_set1(2.51f)), px_set1(0.03f))),
+			px_add(px_mul(c, px_add(px_mul(c, px_set1(2.43f)), px_set1(0.59f))), px_set1(0.14f))
+		);
+		break;
+
+	case TONE_MAP_NORMALIZE:
+		c = px_mul(c, px_set1(tone.scale));
+		break;
+
+	case TONE_MAP_LOG:
+		c = px_mul(px_log2(px_add(c, one)), px_set1(tone.scale));
+		break;
+
+	default:
+		break;
+	}
+
+	return px_min(px_max(px_with_alpha(c, p), zero), one);
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Conversion and accumulation kernels
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Converts the colors of a row to the pixels starting at the index.
+
+template<IMAGEF_FORMAT format>
+static void load_row(void* pixels, size_t first, const Color* row, unsigned width, bool linear)
+{
+	for (unsigned x = 0u; x < width; x++)
+		store_pixel<format>(pixels, first + x, color_to_pixel(row[x], linear));
+}
+
+// Tone maps the pixels starting at the index to a row of colors.
+
+template<IMAGEF_FORMAT format>
+static void tone_map_row(const void* pixels, size_t first, Color* row, unsigned width, const ToneMapper& tone, bool linear)
+{
+	for (unsigned x = 0u; x < width; x++)
+		row[x] = pixel_to_color(tone_map(load_pixel<format>(pixels, first + x), tone), linear);
+}
+
+// Adds the colors of a row multiplied by the weight to the pixels starting at the index.
+
+template<IMAGEF_FORMAT format>
+static void add_row(void* pixels, size_t first, const Color* row, unsigned width, float weight, bool linear)
+{
+	const pixel4 w = px_set1(weight);
+
+	for (unsigned x = 0u; x < width; x++)
+		store_pixel<format>(pixels, first + x, px_add(load_pixel<format>(pixels, first + x), px_mul(color_to_pixel(row[x], linear), w)));
+}
+
+// Adds the pixels of the other image, of any format, multiplied by the weight.
+
+template<IMAGEF_FORMAT format, IMAGEF_FORMAT other_format>
+static void add_pixels(void* pixels, const void* other, size_t first, size_t last, float weight)
+{
+	const pixel4 w = px_set1(weight);
+
+	for (size_t i = first; i < last; i++)
+		store_pixel<format>(pixels, i, px_add(load_pixel<format>(pixels, i), px_mul(load_pixel<other_format>(other, i), w)));
+}
+
+// Multiplies the pixels by the factor.
+
+template<IMAGEF_FORMAT format>
+static void scale_pixels(void* pixels, size_t first, size_t last, float factor)
+{
+	const pixel4 f = px_set1(factor);
+
+	for (size_t i = first; i < last; i++)
+		store_pixel<format>(pixels, i, px_mul(load_pixel<format>(pixels, i), f));
+}
+
+// Sets the pixels to the color.
+
+template<IMAGEF_FORMAT format>
+static void fill_pixels(void* pixels, size_t first, size_t last, pixel4 color)
+{
+	for (size_t i = first; i < last; i++)
+		store_pixel<format>(pixels, i, color);
+}
+
+// Converts the pixels of the other format to the pixels of this format.
+
+template<IMAGEF_FORMAT format, IMAGEF_FORMAT other_format>
+static void convert_pixels(void* pixels, const void* other, size_t first, size_t last)
+{
+	for (size_t i = first; i < last; i++)
+		store_pixel<format>(pixels, i, load_pixel<other_format>(other, i));
+}
+
+// Finds the range of the pixels, only finite values update the minimum and maximum.
+
+template<IMAGEF_FORMAT format>
+static void range_pixels(const void* pixels, size_t first, size_t last, pixel4* min_values, pixel4* max_values)
+{
+	pixel4 lo = *min_values;
+	pixel4 hi = *max_values;
+
+	for (size_t i = first; i < last; i++)
+	{
+		const pixel4 p = load_pixel<format>(pixels, i);
+#ifdef _IMAGEF_SSE2
+		// Infinite values are replaced by NaN, that the minimum and maximum ignore
+		const __m128 infinite = _mm_cmpeq_ps(_mm_andnot_ps(_mm_set1_ps(-0.f), p), _mm_set1_ps(INFINITY));
+		const __m128 finite = _mm_or_ps(p, infinite);
+		lo = _mm_min_ps(finite, lo);
+		hi = _mm_max_ps(finite, hi);
+#else
+		for (unsigned c = 0u; c < 4u; c++)
+			if (std::isfinite(p.v[c]))
+			{
+				if (p.v[c] < lo.v[c]) lo.v[c] = p.v[c];
+				if (p.v[c] > hi.v[c]) hi.v[c] = p.v[c];
+			}
+#endif
+	}
+
+	*min_values = lo;
+	*max_values = hi;
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Constructors / Destructors
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Creates a float image with the specified size and format, with all values at zero.
+
+ImageF::ImageF(unsigned width, unsigned height, IMAGEF_FORMAT format)
+{
+	reset(width, height, format);
+}
+
+// Converts the colors of the view to floats in the specified format.
+
+ImageF::ImageF(const ImageView& image, IMAGEF_FORMAT format, bool linear)
+{
+	format_ = format;
+	load(image, linear);
+}
+
+// Copies the other image.
+
+ImageF::ImageF(const ImageF& other)
+{
+	*this = other;
+}
+
+// Copies the other image.
+
+ImageF& ImageF::operator=(const ImageF& other)
+{
+	if (this == &other)
+		return *this;
+
+	const size_t bytes = (size_t)other.width_ * other.height_ * pixelBytes(other.format_);
+
+	if (pixels_)
+		free_pixels(pixels_);
+
+	pixels_ = allocate_pixels(bytes);
+	width_ = other.width_;
+	height_ = other.height_;
+	format_ = other.format_;
+
+	if (bytes)
+		memcpy(pixels_, other.pixels_, bytes);
+
+	return *this;
+}
+
+// Takes the pixels of the other image, leaving it empty.
+
+ImageF::ImageF(ImageF&& other) noexcept
+{
+	*this = (ImageF&&)other;
+}
+
+// Takes the pixels of the other image, leaving it empty.
+
+ImageF& ImageF::operator=(ImageF&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	if (pixels_)
+		free_pixels(pixels_);
+
+	pixels_ = other.pixels_;
+	width_ = other.width_;
+	height_ = other.height_;
+	format_ = other.format_;
+
+	other.pixels_ = nullptr;
+	other.width_ = 0u;
+	other.height_ = 0u;
+
+	return *this;
+}
+
+// Frees the pixels.
+
+ImageF::~ImageF()
+{
+	if (pixels_)
+		free_pixels(pixels_);
+}
+
+// Resets the image to the new dimensions and format, with all values at zero.
+
+void ImageF::reset(unsigned width, unsigned height, IMAGEF_FORMAT format)
+{
+	USER_CHECK(format == IMAGEF_RGBA32F || format == IMAGEF_RGBA16F,
+		"Unknown format found when trying to reset a float image."
+	);
+
+	const size_t bytes = (size_t)width * height * pixelBytes(format);
+
+	if (pixels_)
+		free_pixels(pixels_);
+
+	pixels_ = allocate_pixels(bytes);
+	width_ = width;
+	height_ = height;
+	format_ = format;
+
+	// Zero is all bits zero in both formats
+	if (bytes)
+		memset(pixels_, 0, bytes);
+}
+
+// Sets every pixel to the color.
+
+void ImageF::fill(_float4color color)
+{
+	const pixel4 p = px_set(color.r, color.g, color.b, color.a);
+	auto fill_func = IMAGEF_DISPATCH(format_, fill_pixels);
+
+	for_each_chunk((size_t)width_ * height_, [&](size_t first, size_t last, unsigned)
+	{
+		fill_func(pixels_, first, last, p);
+	});
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Conversion functions
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Converts the colors of the view to floats from 0 to 1, replacing the image contents
+// and keeping its format. If linear is true the colors are decoded from sRGB.
+
+void ImageF::load(const ImageView& image, bool linear)
+{
+	if (width_ != image.width() || height_ != image.height())
+		reset(image.width(), image.height(), format_);
+
+	if (!width_ || !height_)
+		return;
+
+	auto load_func = IMAGEF_DISPATCH(format_, load_row);
+	const unsigned row_chunk = width_ >= IMAGEF_PIXEL_CHUNK ? 1u : IMAGEF_PIXEL_CHUNK / width_;
+
+	ThreadPool::parallelFor(height_, row_chunk, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned y = begin; y < end; y++)
+			load_func(pixels_, (size_t)y * width_, image.row(y), width_, linear);
+	});
+}
+
+// Converts the image to a regular image of the same dimensions, with the tone mapping
+// operator and the exposure specified. If linear is true the colors are encoded to sRGB.
+
+void ImageF::toImage(Image* image, TONE_MAP tone_map, float exposure, bool linear) const
+{
+	USER_CHECK(image,
+		"Found nullptr when trying to convert a float image to an Image."
+	);
+
+	USER_CHECK(exposure >= 0.f,
+		"Trying to convert a float image to an Image with a negative exposure."
+	);
+
+	// Images mapped read only are replaced by their own pixels
+	if (image->width() != width_ || image->height() != height_ || image->isReadOnly())
+		image->reset(width_, height_);
+
+	if (!width_ || !height_)
+		return;
+
+	ToneMapper tone = { tone_map, exposure, 1.f };
+
+	// The scale of the normalizing operators comes from the maximum color channel
+	if (tone_map == TONE_MAP_NORMALIZE || tone_map == TONE_MAP_LOG)
+	{
+		_float4color min_values, max_values;
+		findRange(&min_values, &max_values);
+
+		float max_value = max_values.r;
+		if (max_values.g > max_value) max_value = max_values.g;
+		if (max_values.b > max_value) max_value = max_values.b;
+
+		if (!(max_value > 0.f))
+			tone.scale = 0.f;
+		else if (tone_map == TONE_MAP_NORMALIZE)
+			tone.scale = 1.f / max_value;
+		else
+			tone.scale = 1.f / log2f(1.f + max_value);
+	}
+
+	auto tone_func = IMAGEF_DISPATCH(format_, tone_map_row);
+	const unsigned row_chunk = width_ >= IMAGEF_PIXEL_CHUNK ? 1u : IMAGEF_PIXEL_CHUNK / width_;
+	Color* pixels = image->pixels();
+
+	ThreadPool::parallelFor(height_, row_chunk, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned y = begin; y < end; y++)
+			tone_func(pixels_, (size_t)y * width_, pixels + (size_t)y * width_, width_, tone, linear);
+	});
+}
+
+// Converts the pixels to the specified format.
+
+void ImageF::convert(IMAGEF_FORMAT format)
+{
+	if (format == format_)
+		return;
+
+	ImageF converted(width_, height_, format);
+
+	auto convert_func = format == IMAGEF_RGBA32F ? convert_pixels<IMAGEF_RGBA32F, IMAGEF_RGBA16F> : convert_pixels<IMAGEF_RGBA16F, IMAGEF_RGBA32F>;
+
+	for_each_chunk((size_t)width_ * height_, [&](size_t first, size_t last, unsigned)
+	{
+		convert_func(converted.pixels_, pixels_, first, last);
+	});
+
+	*this = (ImageF&&)converted;
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Accumulation functions
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Adds the colors of the view, as floats from 0 to 1 multiplied by the weight.
+
+void ImageF::add(const ImageView& image, float weight, bool linear)
+{
+	USER_CHECK(image.width() == width_ && image.height() == height_,
+		"Trying to add an image of different dimensions to a float image."
+	);
+
+	if (!width_ || !height_)
+		return;
+
+	auto add_func = IMAGEF_DISPATCH(format_, add_row);
+	const unsigned row_chunk = width_ >= IMAGEF_PIXEL_CHUNK ? 1u : IMAGEF_PIXEL_CHUNK / width_;
+
+	ThreadPool::parallelFor(height_, row_chunk, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned y = begin; y < end; y++)
+			add_func(pixels_, (size_t)y * width_, image.row(y), width_, weight, linear);
+	});
+}
+
+// Adds the values of the other float image multiplied by the weight.
+
+void ImageF::add(const ImageF& other, float weight)
+{
+	USER_CHECK(other.width_ == width_ && other.height_ == height_,
+		"Trying to add a float image of different dimensions to a float image."
+	);
+
+	void (*add_func)(void*, const void*, size_t, size_t, float) = nullptr;
+	if (format_ == IMAGEF_RGBA32F)
+		add_func = other.format_ == IMAGEF_RGBA32F ? add_pixels<IMAGEF_RGBA32F, IMAGEF_RGBA32F> : add_pixels<IMAGEF_RGBA32F, IMAGEF_RGBA16F>;
+	else
+		add_func = other.format_ == IMAGEF_RGBA32F ? add_pixels<IMAGEF_RGBA16F, IMAGEF_RGBA32F> : add_pixels<IMAGEF_RGBA16F, IMAGEF_RGBA16F>;
+
+	for_each_chunk((size_t)width_ * height_, [&](size_t first, size_t last, unsigned)
+	{
+		add_func(pixels_, other.pixels_, first, last, weight);
+	});
+}
+
+// Multiplies every channel by the factor.
+
+void ImageF::scale(float factor)
+{
+	auto scale_func = IMAGEF_DISPATCH(format_, scale_pixels);
+
+	for_each_chunk((size_t)width_ * height_, [&](size_t first, size_t last, unsigned)
+	{
+		scale_func(pixels_, first, last, factor);
+	});
+}
+
+// Finds the minimum and maximum values of every channel, ignoring NaN and infinite values.
+// Every thread keeps its own range, and they are joined at the end.
+
+void ImageF::findRange(_float4color* min_values, _float4color* max_values) const
+{
+	USER_CHECK(min_values && max_values,
+		"Found nullptr when trying to find the range of a float image."
+	);
+
+	const unsigned threads = ThreadPool::threadCount();
+	pixel4* lo = new pixel4[2u * threads];
+	pixel4* hi = lo + threads;
+
+	for (unsigned t = 0u; t < threads; t++)
+	{
+		lo[t] = px_set1(INFINITY);
+		hi[t] = px_set1(-INFINITY);
+	}
+
+	auto range_func = IMAGEF_DISPATCH(format_, range_pixels);
+
+	for_each_chunk((size_t)width_ * height_, [&](size_t first, size_t last, unsigned thread)
+	{
+		range_func(pixels_, first, last, &lo[thread], &hi[thread]);
+	});
+
+	float range[2][4];
+	px_store(range[0], lo[0]);
+	px_store(range[1], hi[0]);
+
+	for (unsigned t = 1u; t < threads; t++)
+	{
+		float thread_range[2][4];
+		px_store(thread_range[0], lo[t]);
+		px_store(thread_range[1], hi[t]);
+
+		for (unsigned c = 0u; c < 4u; c++)
+		{
+			if (thread_range[0][c] < range[0][c]) range[0][c] = thread_range[0][c];
+			if (thread_range[1][c] > range[1][c]) range[1][c] = thread_range[1][c];
+		}
+	}
+	delete[] lo;
+
+	// Channels without finite values keep the initial infinities
+	for (unsigned c = 0u; c < 4u; c++)
+		if (range[0][c] > range[1][c])
+			range[0][c] = range[1][c] = 0.f;
+
+	*min_values = { range[0][0], range[0][1], range[0][2], range[0][3] };
+	*max_values = { range[1][0], range[1][1], range[1][2], range[1][3] };
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Getters and Accessors
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Returns the size in bytes of a pixel of the specified format.
+
+unsigned ImageF::pixelBytes(IMAGEF_FORMAT format)
+{
+	return format == IMAGEF_RGBA32F ? 16u : 8u;
+}
+
+// Returns the color of the specified pixel coordinates, in any format.
+
+_float4color ImageF::getPixel(unsigned row, unsigned col) const
+{
+	USER_CHECK(row < height_ && col < width_,
+		"Trying to read a pixel outside of a float image."
+	);
+
+	float v[4];
+	px_store(v, IMAGEF_DISPATCH(format_, load_pixel)(pixels_, (size_t)row * width_ + col));
+	return { v[0], v[1], v[2], v[3] };
+}
+
+// Sets the color of the specified pixel coordinates, in any format.
+
+void ImageF::setPixel(unsigned row, unsigned col, _float4color color)
+{
+	USER_CHECK(row < height_ && col < width_,
+		"Trying to write a pixel outside of a float image."
+	);
+
+	IMAGEF_DISPATCH(format_, store_pixel)(pixels_, (size_t)row * width_ + col, px_set(color.r, color.g, color.b, color.a));
+}
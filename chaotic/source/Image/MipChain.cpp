@@ -0,0 +1,404 @@
+#include "Image/Image.h"
+
+#include "Error/_erDefault.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#if defined _M_X64 || defined _M_IX86 || defined __SSE2__
+#include <emmintrin.h>
+#define _MIP_SSE2
+#elif defined _M_ARM64 || defined __ARM_NEON
+#include <arm_neon.h>
+#define _MIP_NEON
+#endif
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Color conversion tables
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Size of the table that converts linear values back to bytes, big enough for
+// every byte to survive the round trip through linear light.
+#define MIP_LINEAR_STEPS 4096u
+
+// Conversion tables between color bytes and linear values, the first set is the
+// identity used when filtering is not gamma correct, the second one is sRGB.
+struct MipTables
+{
+	float to_linear[2][256];
+	uint8_t to_byte[2][MIP_LINEAR_STEPS];
+
+	MipTables()
+	{
+		for (unsigned i = 0u; i < 256u; i++)
+		{
+			const float c = i / 255.f;
+			to_linear[0][i] = c;
+			to_linear[1][i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (unsigned i = 0u; i < MIP_LINEAR_STEPS; i++)
+		{
+			const float l = i / float(MIP_LINEAR_STEPS - 1u);
+			const float s = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.f / 2.4f) - 0.055f;
+			to_byte[0][i] = uint8_t(l * 255.f + 0.5f);
+			to_byte[1][i] = uint8_t(std::min(s, 1.f) * 255.f + 0.5f);
+		}
+	}
+};
+
+static const MipTables mip_tables;
+
+// Converts a row of colors to linear values with the alpha premultiplied, so that
+// transparent pixels do not contribute their color to the filtered ones.
+
+static void row_to_linear(const Color* row, unsigned width, const float* to_linear, float* out)
+{
+	for (unsigned x = 0u; x < width; x++, out += 4)
+	{
+		const Color c = row[x];
+		const float a = c.A / 255.f;
+		out[0] = to_linear[c.B] * a;
+		out[1] = to_linear[c.G] * a;
+		out[2] = to_linear[c.R] * a;
+		out[3] = a;
+	}
+}
+
+// Converts a row of premultiplied linear values back to colors, clamping the values
+// that the negative lobes of the sinc filters push outside the range.
+
+static void row_to_colors(const float* row, unsigned width, const uint8_t* to_byte, Color* out)
+{
+	for (unsigned x = 0u; x < width; x++, row += 4)
+	{
+		const float a = std::min(row[3], 1.f);
+		if (!(a > 0.f))
+		{
+			out[x] = Color::Transparent;
+			continue;
+		}
+		const float scale = (MIP_LINEAR_STEPS - 1u) / a;
+		auto channel = [&](float v) { return to_byte[unsigned(std::min(std::max(v * scale, 0.f), float(MIP_LINEAR_STEPS - 1u)) + 0.5f)]; };
+
+		out[x] = Color(channel(row[2]), channel(row[1]), channel(row[0]), uint8_t(a * 255.f + 0.5f));
+	}
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Filter weights
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Radius of the windowed sinc filters, in pixels of the destination level.
+#define MIP_SINC_RADIUS 3.f
+
+// Shape parameter of the Kaiser window, higher values trade sharpness for less ringing.
+#define MIP_KAISER_ALPHA 4.f
+
+// Rows of a level filtered by every thread pool task.
+#define MIP_ROW_CHUNK 32u
+
+// Modified Bessel function of the first kind and order zero, used by the Kaiser window.
+
+static double bessel_i0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	for (unsigned k = 1u; k < 32u && term > 1e-12 * sum; k++)
+	{
+		const double half = x / (2.0 * k);
+		term *= half * half;
+		sum += term;
+	}
+	return sum;
+}
+
+// Evaluates the filter at the distance specified, in pixels of the destination level.
+
+static double filter_kernel(MIP_FILTER filter, double x)
+{
+	x = fabs(x);
+	if (x >= MIP_SINC_RADIUS)
+		return 0.0;
+
+	constexpr double pi = 3.14159265358979323846;
+	auto sinc = [](double t) { return t < 1e-8 ? 1.0 : sin(pi * t) / (pi * t); };
+
+	const double window = filter == MIP_FILTER_LANCZOS
+		? sinc(x / MIP_SINC_RADIUS)
+		: bessel_i0(MIP_KAISER_ALPHA * sqrt(1.0 - (x / MIP_SINC_RADIUS) * (x / MIP_SINC_RADIUS))) / bessel_i0(MIP_KAISER_ALPHA);
+
+	return sinc(x) * window;
+}
+
+// Weights to resample one axis of a level, every destination pixel reads the same
+// number of taps, with the source indices clamped to the edges and zero padding.
+struct FilterAxis
+{
+	unsigned taps = 0u;
+	std::vector<unsigned> index;
+	std::vector<float> weight;
+
+	FilterAxis(unsigned src, unsigned dst, MIP_FILTER filter)
+	{
+		if (src == dst)
+		{
+			taps = 1u;
+			index.resize(dst);
+			weight.assign(dst, 1.f);
+			for (unsigned i = 0u; i < dst; i++)
+				index[i] = i;
+			return;
+		}
+
+		const double scale = double(src) / dst;
+		const double radius = (filter == MIP_FILTER_BOX ? 0.5 : MIP_SINC_RADIUS) * scale;
+
+		// Weights of every destination pixel, from the first source pixel in reach
+		std::vector<int> first(dst);
+		std::vector<std::vector<double>> raw(dst);
+		for (unsigned i = 0u; i < dst; i++)
+		{
+			const double center = (i + 0.5) * scale;
+			const int lo = int(floor(center - radius));
+			const int hi = int(ceil(center + radius));
+
+			std::vector<double>& w = raw[i];
+			for (int j = lo; j < hi; j++)
+			{
+				const double value = filter == MIP_FILTER_BOX
+					? std::max(0.0, std::min(j + 1.0, center + radius) - std::max(double(j), center - radius))
+					: filter_kernel(filter, (j + 0.5 - center) / scale);
+				w.push_back(value);
+			}
+
+			// Trims the taps that do not contribute
+			size_t b = 0u, e = w.size();
+			while (b < e && fabs(w[b]) < 1e-7) b++;
+			while (e > b && fabs(w[e - 1u]) < 1e-7) e--;
+			w = std::vector<double>(w.begin() + b, w.begin() + e);
+			first[i] = lo + int(b);
+
+			taps = std::max(taps, unsigned(w.size()));
+		}
+
+		index.resize(size_t(dst) * taps);
+		weight.resize(size_t(dst) * taps);
+		for (unsigned i = 0u; i < dst; i++)
+		{
+			double sum = 0.0;
+			for (double w : raw[i])
+				sum += w;
+
+			for (unsigned t = 0u; t < taps; t++)
+			{
+				const int j = std::min(std::max(first[i] + int(t), 0), int(src) - 1);
+				index[size_t(i) * taps + t] = unsigned(j);
+				weight[size_t(i) * taps + t] = t < raw[i].size() ? float(raw[i][t] / sum) : 0.f;
+			}
+		}
+	}
+};
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Level filtering
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Adds up the weighted pixels of a row specified by the taps, four channels at once.
+
+static inline void filter_pixel(const float* row, const unsigned* index, const float* weight, unsigned taps, float* out)
+{
+#ifdef _MIP_SSE2
+	__m128 acc = _mm_setzero_ps();
+	for (unsigned t = 0u; t < taps; t++)
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weight[t]), _mm_loadu_ps(row + size_t(index[t]) * 4u)));
+	_mm_storeu_ps(out, acc);
+#elif defined _MIP_NEON
+	float32x4_t acc = vdupq_n_f32(0.f);
+	for (unsigned t = 0u; t < taps; t++)
+		acc = vmlaq_n_f32(acc, vld1q_f32(row + size_t(index[t]) * 4u), weight[t]);
+	vst1q_f32(out, acc);
+#else
+	float acc[4] = {};
+	for (unsigned t = 0u; t < taps; t++)
+		for (unsigned c = 0u; c < 4u; c++)
+			acc[c] += weight[t] * row[size_t(index[t]) * 4u + c];
+	for (unsigned c = 0u; c < 4u; c++)
+		out[c] = acc[c];
+#endif
+}
+
+// Adds the weighted row to the accumulated one, the length is a multiple of four.
+
+static inline void accumulate_row(const float* row, float weight, unsigned length, float* out)
+{
+#ifdef _MIP_SSE2
+	const __m128 w = _mm_set1_ps(weight);
+	for (unsigned i = 0u; i < length; i += 4u)
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(w, _mm_loadu_ps(row + i))));
+#elif defined _MIP_NEON
+	for (unsigned i = 0u; i < length; i += 4u)
+		vst1q_f32(out + i, vmlaq_n_f32(vld1q_f32(out + i), vld1q_f32(row + i), weight));
+#else
+	for (unsigned i = 0u; i < length; i++)
+		out[i] += weight * row[i];
+#endif
+}
+
+// Filters the next level from the source one, face by face. Every task filters a band
+// of destination rows, first horizontally the source rows the band reaches and then
+// vertically from those, so only a few rows are ever stored as linear values.
+
+static void filter_level(const ImageView& src, Image& dst, unsigned faces, MIP_FILTER filter)
+{
+	const unsigned src_width = src.width();
+	const unsigned src_height = src.height() / faces;
+	const unsigned dst_width = dst.width();
+	const unsigned dst_height = dst.height() / faces;
+
+	const FilterAxis horizontal(src_width, dst_width, filter);
+	const FilterAxis vertical(src_height, dst_height, filter);
+
+	const unsigned table = MipChain::GAMMA_CORRECT ? 1u : 0u;
+	const float* to_linear = mip_tables.to_linear[table];
+	const uint8_t* to_byte = mip_tables.to_byte[table];
+
+	ThreadPool::parallelFor(faces * dst_height, MIP_ROW_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		std::vector<float> source_row(size_t(src_width) * 4u);
+		std::vector<float> band;
+		std::vector<float> output(size_t(dst_width) * 4u);
+
+		// Chunks are split at face boundaries, faces are filtered independently
+		while (begin < end)
+		{
+			const unsigned face = begin / dst_height;
+			const unsigned first = begin - face * dst_height;
+			const unsigned last = std::min(end - face * dst_height, dst_height);
+
+			// Source rows reached by the band, the indices grow with the rows
+			const unsigned top = vertical.index[size_t(first) * vertical.taps];
+			const unsigned bottom = vertical.index[size_t(last) * vertical.taps - 1u];
+			const size_t band_stride = size_t(dst_width) * 4u;
+			band.resize((bottom - top + 1u) * band_stride);
+
+			for (unsigned y = top; y <= bottom; y++)
+			{
+				row_to_linear(src.row(face * src_height + y), src_width, to_linear, source_row.data());
+
+				float* out = band.data() + (y - top) * band_stride;
+				for (unsigned x = 0u; x < dst_width; x++)
+					filter_pixel(source_row.data(), &horizontal.index[size_t(x) * horizontal.taps], &horizontal.weight[size_t(x) * horizontal.taps], horizontal.taps, out + x * 4u);
+			}
+
+			for (unsigned y = first; y < last; y++)
+			{
+				std::fill(output.begin(), output.end(), 0.f);
+				for (unsigned t = 0u; t < vertical.taps; t++)
+				{
+					const size_t k = size_t(y) * vertical.taps + t;
+					if (vertical.weight[k] != 0.f)
+						accumulate_row(band.data() + (vertical.index[k] - top) * band_stride, vertical.weight[k], unsigned(band_stride), output.data());
+				}
+				row_to_colors(output.data(), dst_width, to_byte, dst.pixels() + size_t(face * dst_height + y) * dst_width);
+			}
+
+			begin = face * dst_height + last;
+		}
+	});
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Mip Chain functions
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Returns the number of levels of a full chain for the specified dimensions. For
+// cube-maps the face width is to be used as both dimensions.
+
+unsigned MipChain::levelCount(unsigned width, unsigned height)
+{
+	if (!width || !height)
+		return 0u;
+
+	unsigned count = 1u;
+	while (width > 1u || height > 1u)
+	{
+		width = std::max(width / 2u, 1u);
+		height = std::max(height / 2u, 1u);
+		count++;
+	}
+	return count;
+}
+
+// Builds the mip chain of the image, check generate() for more information.
+
+MipChain::MipChain(const ImageView& image, MIP_FILTER filter, bool cubemap, unsigned max_levels)
+{
+	generate(image, filter, cubemap, max_levels);
+}
+
+// Frees the levels of the chain.
+
+MipChain::~MipChain()
+{
+	delete[] levels_;
+}
+
+// Builds the mip chain of the image with the specified filter, replacing the previous
+// one. If cubemap is true the image is expected to have the six faces stacked, and
+// every level keeps that layout. If max levels is not zero the chain is cut there.
+
+void MipChain::generate(const ImageView& image, MIP_FILTER filter, bool cubemap, unsigned max_levels)
+{
+	USER_CHECK(image.pixels() && image.width() && image.height(),
+		"Trying to generate the mip chain of an empty image."
+	);
+	USER_CHECK(!cubemap || image.height() == 6u * image.width(),
+		"Trying to generate the mip chain of a cube-map whose height is not six times its width."
+	);
+
+	delete[] levels_;
+	levels_ = nullptr;
+
+	const unsigned faces = cubemap ? 6u : 1u;
+	unsigned width = image.width();
+	unsigned height = image.height() / faces;
+
+	base_ = image;
+	level_count_ = levelCount(width, height);
+	if (max_levels && max_levels < level_count_)
+		level_count_ = max_levels;
+
+	if (level_count_ > 1u)
+		levels_ = new Image[level_count_ - 1u];
+
+	// Every level is filtered from the previous one
+	for (unsigned i = 1u; i < level_count_; i++)
+	{
+		width = std::max(width / 2u, 1u);
+		height = std::max(height / 2u, 1u);
+
+		levels_[i - 1u].reset(width, height * faces);
+		filter_level(level(i - 1u), levels_[i - 1u], faces, filter);
+	}
+}
+
+// Returns a view of the specified level, the first level is the original image.
+
+ImageView MipChain::level(unsigned index) const
+{
+	USER_CHECK(index < level_count_,
+		"Trying to access a mip level that is not in the chain."
+	);
+
+	return index ? ImageView(levels_[index - 1u]) : base_;
+}
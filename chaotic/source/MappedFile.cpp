@@ -0,0 +1,136 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include "WinHeader.h"
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Mapped File Functions
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Constructor, if the path is valid it will try to open the file.
+
+MappedFile::MappedFile(const char* path, bool copy_on_write)
+{
+	if (path)
+		open(path, copy_on_write);
+}
+
+// Unmaps the file if open.
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+// Maps the file specified, closing the previous one if any. Returns 
+// false if the file could not be opened or mapped.
+
+bool MappedFile::open(const char* path, bool cow)
+{
+	close();
+
+	if (!path)
+		return false;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	file_handle = file;
+	file_size = (unsigned long long)size.QuadPart;
+
+	// Empty files can not be mapped but are valid files.
+	if (file_size)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, cow ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+		{
+			close();
+			return false;
+		}
+		mapping_handle = mapping;
+
+		view = (const char*)MapViewOfFile(mapping, cow ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+		if (!view)
+		{
+			close();
+			return false;
+		}
+	}
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st))
+	{
+		::close(fd);
+		return false;
+	}
+
+	file_size = (unsigned long long)st.st_size;
+
+	if (file_size)
+	{
+		void* map = mmap(nullptr, file_size, cow ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED)
+		{
+			::close(fd);
+			file_size = 0ull;
+			return false;
+		}
+		madvise(map, file_size, MADV_SEQUENTIAL);
+		view = (const char*)map;
+	}
+
+	// The mapping stays valid after closing the descriptor.
+	::close(fd);
+#endif
+
+	copy_on_write = cow;
+	is_open = true;
+	return true;
+}
+
+// Unmaps the file and closes it.
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (view)
+		UnmapViewOfFile(view);
+
+	if (mapping_handle)
+		CloseHandle(mapping_handle);
+
+	if (file_handle)
+		CloseHandle(file_handle);
+#else
+	if (view)
+		munmap((void*)view, file_size);
+#endif
+
+	view = nullptr;
+	file_size = 0ull;
+	mapping_handle = nullptr;
+	file_handle = nullptr;
+	copy_on_write = false;
+	is_open = false;
+}
@@ -0,0 +1,755 @@
+#include "MeshBVH.h"
+#include "ThreadPool.h"
+
+#include <cmath>
+#include <cfloat>
+#include <climits>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Mesh BVH Internals
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Number of bins per axis evaluated by the surface area heuristic, largest leaf allowed,
+// smallest node binned in parallel and number of triangles processed per parallel chunk.
+#define BVH_BINS 16u
+#define BVH_MAX_LEAF 8u
+#define BVH_PARALLEL_NODE 65536u
+#define BVH_CHUNK 16384u
+
+// Depth after which nodes are halved instead of split by the heuristic, which bounds the
+// depth of the tree, and size of the traversal stacks, that always fit the deepest tree.
+#define BVH_MAX_DEPTH 56u
+#define BVH_STACK_SIZE 96u
+
+// Node of the hierarchy. Inner nodes store the index of their first child, the second
+// child is always right after it, and leaves store their range on the triangle list.
+struct BVHNode
+{
+	Vector3f min;
+	unsigned first;		// First child for inner nodes, first triangle for leaves.
+	Vector3f max;
+	unsigned count;		// Number of triangles for leaves, zero for inner nodes.
+};
+
+// Axis aligned box helper used while building.
+struct BVHBox
+{
+	Vector3f min = { FLT_MAX, FLT_MAX, FLT_MAX };
+	Vector3f max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	inline void grow(const Vector3f& p)
+	{
+		grow(p, p);
+	}
+
+	inline void grow(const BVHBox& b)
+	{
+		grow(b.min, b.max);
+	}
+
+	inline void grow(const Vector3f& b_min, const Vector3f& b_max)
+	{
+		min.x = b_min.x < min.x ? b_min.x : min.x;
+		min.y = b_min.y < min.y ? b_min.y : min.y;
+		min.z = b_min.z < min.z ? b_min.z : min.z;
+		max.x = b_max.x > max.x ? b_max.x : max.x;
+		max.y = b_max.y > max.y ? b_max.y : max.y;
+		max.z = b_max.z > max.z ? b_max.z : max.z;
+	}
+
+	inline float area() const
+	{
+		if (min.x > max.x)
+			return 0.f;
+
+		Vector3f e = max - min;
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+};
+
+// Bin of the surface area heuristic, the triangles whose centroid falls inside it.
+struct BVHBin
+{
+	BVHBox box;
+	unsigned count = 0u;
+};
+
+// Struct that stores the internal data of a hierarchy.
+struct MeshBVHInternals
+{
+	BVHNode* nodes = nullptr;
+	unsigned node_count = 0u;
+
+	// Triangles in leaf order, their original index and the referenced positions.
+	unsigned* indices = nullptr;
+	unsigned* triangle_ids = nullptr;
+	unsigned triangle_count = 0u;
+	const Vector3f* positions = nullptr;
+
+	~MeshBVHInternals()
+	{
+		if (nodes)
+			delete[] nodes;
+
+		if (indices)
+			delete[] indices;
+
+		if (triangle_ids)
+			delete[] triangle_ids;
+	}
+};
+
+// Returns the component of a vector along an axis.
+
+static inline float axis_value(const Vector3f& v, unsigned axis)
+{
+	return axis == 0u ? v.x : axis == 1u ? v.y : v.z;
+}
+
+// Scratch data shared by the build steps, triangle boxes and centroids by original index.
+struct BVHBuilder
+{
+	BVHBox* boxes;
+	Vector3f* centroids;
+	unsigned* triangles;
+
+	// Maps centroids to bins along the three axes of a centroid box.
+	struct Binning
+	{
+		float low[3];
+		float scale[3];
+
+		Binning(const BVHBox& centroid_box)
+		{
+			for (unsigned axis = 0u; axis < 3u; axis++)
+			{
+				low[axis] = axis_value(centroid_box.min, axis);
+				float extent = axis_value(centroid_box.max, axis) - low[axis];
+				scale[axis] = extent > 0.f ? float(BVH_BINS) / extent : 0.f;
+			}
+		}
+
+		inline unsigned bin(const Vector3f& c, unsigned axis) const
+		{
+			unsigned b = unsigned((axis_value(c, axis) - low[axis]) * scale[axis]);
+			return b < BVH_BINS ? b : BVH_BINS - 1u;
+		}
+	};
+
+	// Bins the triangles of the range along the three axes.
+	void bin_range(unsigned begin, unsigned end, const Binning& binning, BVHBin* bins) const
+	{
+		for (unsigned i = begin; i < end; i++)
+		{
+			unsigned t = triangles[i];
+
+			for (unsigned axis = 0u; axis < 3u; axis++)
+			{
+				BVHBin& bin = bins[axis * BVH_BINS + binning.bin(centroids[t], axis)];
+				bin.box.grow(boxes[t]);
+				bin.count++;
+			}
+		}
+	}
+
+	// Computes the centroid box of the range and bins it, in parallel if asked. The node box
+	// is the union of the bins of any axis.
+	void analyze(unsigned begin, unsigned end, bool parallel, BVHBox& node_box, BVHBox& centroid_box, BVHBin* bins) const
+	{
+		centroid_box = {};
+
+		if (!parallel)
+		{
+			for (unsigned i = begin; i < end; i++)
+				centroid_box.grow(centroids[triangles[i]]);
+
+			bin_range(begin, end, Binning(centroid_box), bins);
+		}
+		else
+		{
+			// Every chunk writes its own partial result, then they are reduced in order.
+			const unsigned count = end - begin;
+			const unsigned n_chunks = (count + BVH_CHUNK - 1u) / BVH_CHUNK;
+
+			std::vector<BVHBox> chunk_boxes(n_chunks);
+			ThreadPool::parallelFor(count, BVH_CHUNK, [&](unsigned b, unsigned e, unsigned)
+			{
+				for (unsigned i = begin + b; i < begin + e; i++)
+					chunk_boxes[b / BVH_CHUNK].grow(centroids[triangles[i]]);
+			});
+
+			for (unsigned c = 0u; c < n_chunks; c++)
+				centroid_box.grow(chunk_boxes[c]);
+
+			const Binning binning(centroid_box);
+
+			std::vector<BVHBin> chunk_bins(n_chunks * 3u * BVH_BINS);
+			ThreadPool::parallelFor(count, BVH_CHUNK, [&](unsigned b, unsigned e, unsigned)
+			{
+				bin_range(begin + b, begin + e, binning, chunk_bins.data() + (b / BVH_CHUNK) * 3u * BVH_BINS);
+			});
+
+			for (unsigned c = 0u; c < n_chunks; c++)
+			{
+				for (unsigned i = 0u; i < 3u * BVH_BINS; i++)
+				{
+					bins[i].box.grow(chunk_bins[c * 3u * BVH_BINS + i].box);
+					bins[i].count += chunk_bins[c * 3u * BVH_BINS + i].count;
+				}
+			}
+		}
+
+		node_box = {};
+		for (unsigned b = 0u; b < BVH_BINS; b++)
+			node_box.grow(bins[b].box);
+	}
+
+	// Decides how to split the range and partitions it. Returns the index of the first
+	// triangle of the second child, or the end of the range if it has to be a leaf. Nodes
+	// too deep in the tree are halved, so that degenerate inputs can not make it deeper.
+	unsigned split(unsigned begin, unsigned end, unsigned depth, bool parallel, BVHBox& node_box) const
+	{
+		const unsigned count = end - begin;
+
+		BVHBox centroid_box;
+		BVHBin bins[3u * BVH_BINS];
+		analyze(begin, end, parallel, node_box, centroid_box, bins);
+
+		if (depth >= BVH_MAX_DEPTH)
+			return count <= BVH_MAX_LEAF ? end : begin + count / 2u;
+
+		// Sweep the bins of every axis and keep the cheapest split plane.
+		float best_cost = FLT_MAX;
+		unsigned best_axis = 0u, best_bin = 0u;
+
+		for (unsigned axis = 0u; axis < 3u; axis++)
+		{
+			if (axis_value(centroid_box.max, axis) <= axis_value(centroid_box.min, axis))
+				continue;
+
+			const BVHBin* axis_bins = bins + axis * BVH_BINS;
+
+			float right_area[BVH_BINS];
+			unsigned right_count[BVH_BINS];
+
+			BVHBox box;
+			unsigned n = 0u;
+			for (unsigned b = BVH_BINS - 1u; b > 0u; b--)
+			{
+				box.grow(axis_bins[b].box);
+				n += axis_bins[b].count;
+				right_area[b] = box.area();
+				right_count[b] = n;
+			}
+
+			box = {};
+			n = 0u;
+			for (unsigned b = 0u; b < BVH_BINS - 1u; b++)
+			{
+				box.grow(axis_bins[b].box);
+				n += axis_bins[b].count;
+
+				if (!n || !right_count[b + 1u])
+					continue;
+
+				float cost = box.area() * float(n) + right_area[b + 1u] * float(right_count[b + 1u]);
+				if (cost < best_cost)
+				{
+					best_cost = cost;
+					best_axis = axis;
+					best_bin = b;
+				}
+			}
+		}
+
+		// Small nodes become leaves if no split is cheaper than testing all their triangles,
+		// with the cost of a traversal step equal to the cost of a triangle test.
+		const float node_area = node_box.area();
+		if (count <= BVH_MAX_LEAF && (best_cost == FLT_MAX || node_area + best_cost >= node_area * float(count)))
+			return end;
+
+		// Without a valid plane the centroids coincide, the range is simply halved.
+		if (best_cost == FLT_MAX)
+			return begin + count / 2u;
+
+		const Binning binning(centroid_box);
+		unsigned* middle = std::partition(triangles + begin, triangles + end, [&](unsigned t)
+		{
+			return binning.bin(centroids[t], best_axis) <= best_bin;
+		});
+
+		unsigned mid = unsigned(middle - triangles);
+		return (mid == begin || mid == end) ? begin + count / 2u : mid;
+	}
+
+	// Builds the subtree of the range serially, the root is the first node of the list.
+	void build_subtree(unsigned begin, unsigned end, unsigned depth, std::vector<BVHNode>& nodes) const
+	{
+		struct Task { unsigned node, begin, end, depth; };
+
+		std::vector<Task> stack;
+		nodes.push_back({});
+		stack.push_back({ 0u, begin, end, depth });
+
+		while (!stack.empty())
+		{
+			Task task = stack.back();
+			stack.pop_back();
+
+			BVHBox box;
+			unsigned mid = split(task.begin, task.end, task.depth, false, box);
+
+			nodes[task.node].min = box.min;
+			nodes[task.node].max = box.max;
+
+			if (mid == task.end)
+			{
+				nodes[task.node].first = task.begin;
+				nodes[task.node].count = task.end - task.begin;
+				continue;
+			}
+
+			unsigned child = unsigned(nodes.size());
+			nodes[task.node].first = child;
+			nodes[task.node].count = 0u;
+
+			nodes.push_back({});
+			nodes.push_back({});
+			stack.push_back({ child, task.begin, mid, task.depth + 1u });
+			stack.push_back({ child + 1u, mid, task.end, task.depth + 1u });
+		}
+	}
+};
+
+// Computes the box of a triangle from its indices.
+
+static inline BVHBox triangle_box(const Vector3f* positions, const unsigned* triangle)
+{
+	BVHBox box;
+	box.grow(positions[triangle[0]]);
+	box.grow(positions[triangle[1]]);
+	box.grow(positions[triangle[2]]);
+	return box;
+}
+
+// Transforms a mesh space box to world coordinates, returning the box that contains it.
+
+static inline BVHBox world_box(const Matrix& M, const Vector3f& position, const Vector3f& min, const Vector3f& max)
+{
+	Vector3f center = M * ((min + max) * 0.5f) + position;
+	Vector3f half = (max - min) * 0.5f;
+
+	Vector3f extent = {
+		fabsf(M.a00) * half.x + fabsf(M.a01) * half.y + fabsf(M.a02) * half.z,
+		fabsf(M.a10) * half.x + fabsf(M.a11) * half.y + fabsf(M.a12) * half.z,
+		fabsf(M.a20) * half.x + fabsf(M.a21) * half.y + fabsf(M.a22) * half.z,
+	};
+
+	BVHBox box;
+	box.min = center - extent;
+	box.max = center + extent;
+	return box;
+}
+
+// Separating axis test between a triangle and a box given by its center and half size.
+// Tests the three box axes, the triangle normal and the nine edge cross products.
+
+static bool triangle_box_overlap(const Vector3f v[3], const Vector3f& center, const Vector3f& half)
+{
+	const Vector3f p[3] = { v[0] - center, v[1] - center, v[2] - center };
+	const Vector3f edges[3] = { p[1] - p[0], p[2] - p[1], p[0] - p[2] };
+	const Vector3f units[3] = { { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f } };
+
+	Vector3f axes[13];
+	unsigned n_axes = 0u;
+
+	for (unsigned i = 0u; i < 3u; i++)
+		axes[n_axes++] = units[i];
+
+	axes[n_axes++] = edges[0] * edges[1];
+
+	for (unsigned i = 0u; i < 3u; i++)
+		for (unsigned j = 0u; j < 3u; j++)
+			axes[n_axes++] = units[i] * edges[j];
+
+	for (unsigned i = 0u; i < n_axes; i++)
+	{
+		const Vector3f& a = axes[i];
+
+		float p0 = p[0] ^ a, p1 = p[1] ^ a, p2 = p[2] ^ a;
+		float radius = half.x * fabsf(a.x) + half.y * fabsf(a.y) + half.z * fabsf(a.z);
+
+		if (fminf(p0, fminf(p1, p2)) > radius || fmaxf(p0, fmaxf(p1, p2)) < -radius)
+			return false;
+	}
+	return true;
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Mesh BVH Functions
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Frees the hierarchy.
+
+MeshBVH::~MeshBVH()
+{
+	if (bvhData)
+		delete (MeshBVHInternals*)bvhData;
+}
+
+// Builds the hierarchy over the triangles, replacing the previous one. The indices are
+// copied but the positions are only referenced, so they must stay valid for the queries.
+
+void MeshBVH::build(const Vector3f* positions, const unsigned* indices, unsigned triangle_count)
+{
+	if (bvhData)
+		delete (MeshBVHInternals*)bvhData;
+
+	bvhData = new MeshBVHInternals;
+	MeshBVHInternals& data = *(MeshBVHInternals*)bvhData;
+
+	data.positions = positions;
+	data.triangle_count = triangle_count;
+
+	if (!triangle_count)
+		return;
+
+	// Triangle boxes and centroids by original index.
+	BVHBuilder builder;
+	builder.boxes = new BVHBox[triangle_count];
+	builder.centroids = new Vector3f[triangle_count];
+	builder.triangles = new unsigned[triangle_count];
+
+	ThreadPool::parallelFor(triangle_count, BVH_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned t = begin; t < end; t++)
+		{
+			builder.boxes[t] = triangle_box(positions, indices + 3u * t);
+			builder.centroids[t] = (builder.boxes[t].min + builder.boxes[t].max) * 0.5f;
+			builder.triangles[t] = t;
+		}
+	});
+
+	// Top levels are split with parallel binning until the nodes are small enough.
+	struct Task { unsigned node, begin, end, depth; };
+
+	std::vector<BVHNode> top(1u);
+	std::vector<Task> subtrees;
+	std::vector<Task> queue = { { 0u, 0u, triangle_count, 0u } };
+
+	while (!queue.empty())
+	{
+		Task task = queue.back();
+		queue.pop_back();
+
+		if (task.end - task.begin < BVH_PARALLEL_NODE)
+		{
+			subtrees.push_back(task);
+			continue;
+		}
+
+		BVHBox box;
+		unsigned mid = builder.split(task.begin, task.end, task.depth, true, box);
+
+		unsigned child = unsigned(top.size());
+		top[task.node] = { box.min, child, box.max, 0u };
+
+		top.push_back({});
+		top.push_back({});
+		queue.push_back({ child, task.begin, mid, task.depth + 1u });
+		queue.push_back({ child + 1u, mid, task.end, task.depth + 1u });
+	}
+
+	// Then every subtree is built on its own, the largest ones first.
+	std::sort(subtrees.begin(), subtrees.end(), [](const Task& a, const Task& b) { return a.end - a.begin > b.end - b.begin; });
+
+	std::vector<std::vector<BVHNode>> subtree_nodes(subtrees.size());
+	ThreadPool::parallelFor(unsigned(subtrees.size()), 1u, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned s = begin; s < end; s++)
+			builder.build_subtree(subtrees[s].begin, subtrees[s].end, subtrees[s].depth, subtree_nodes[s]);
+	});
+
+	// Join the subtrees after the top nodes, their roots replace the top placeholders.
+	data.node_count = unsigned(top.size());
+	for (const std::vector<BVHNode>& nodes : subtree_nodes)
+		data.node_count += unsigned(nodes.size()) - 1u;
+
+	data.nodes = new BVHNode[data.node_count];
+	memcpy(data.nodes, top.data(), top.size() * sizeof(BVHNode));
+
+	unsigned offset = unsigned(top.size());
+	for (unsigned s = 0u; s < subtrees.size(); s++)
+	{
+		const std::vector<BVHNode>& nodes = subtree_nodes[s];
+
+		// Local node i, except the root, is stored at offset + i - 1.
+		for (unsigned i = 0u; i < nodes.size(); i++)
+		{
+			BVHNode node = nodes[i];
+			if (!node.count)
+				node.first += offset - 1u;
+
+			data.nodes[i ? offset + i - 1u : subtrees[s].node] = node;
+		}
+		offset += unsigned(nodes.size()) - 1u;
+	}
+
+	// Store the triangles in leaf order.
+	data.indices = new unsigned[3u * triangle_count];
+	data.triangle_ids = builder.triangles;
+
+	ThreadPool::parallelFor(triangle_count, BVH_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned i = begin; i < end; i++)
+			for (unsigned k = 0u; k < 3u; k++)
+				data.indices[3u * i + k] = indices[3u * data.triangle_ids[i] + k];
+	});
+
+	delete[] builder.boxes;
+	delete[] builder.centroids;
+}
+
+// Recomputes the node boxes for the new positions, keeping the tree structure. The same
+// triangles must be used, the positions pointer replaces the one given before.
+
+void MeshBVH::refit(const Vector3f* positions)
+{
+	if (!bvhData)
+		return;
+
+	MeshBVHInternals& data = *(MeshBVHInternals*)bvhData;
+	data.positions = positions;
+
+	// Leaves first, in parallel.
+	ThreadPool::parallelFor(data.node_count, BVH_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned n = begin; n < end; n++)
+		{
+			BVHNode& node = data.nodes[n];
+			if (!node.count)
+				continue;
+
+			BVHBox box;
+			for (unsigned i = node.first; i < node.first + node.count; i++)
+				box.grow(triangle_box(positions, data.indices + 3u * i));
+
+			node.min = box.min;
+			node.max = box.max;
+		}
+	});
+
+	// Children are always stored after their parent, so a reverse pass sees them updated.
+	for (unsigned n = data.node_count; n-- > 0u;)
+	{
+		BVHNode& node = data.nodes[n];
+		if (node.count)
+			continue;
+
+		const BVHNode& a = data.nodes[node.first];
+		const BVHNode& b = data.nodes[node.first + 1u];
+
+		node.min = { fminf(a.min.x, b.min.x), fminf(a.min.y, b.min.y), fminf(a.min.z, b.min.z) };
+		node.max = { fmaxf(a.max.x, b.max.x), fmaxf(a.max.y, b.max.y), fmaxf(a.max.z, b.max.z) };
+	}
+}
+
+// Finds the closest triangle hit by the world ray, given the linear transform and the
+// position of the mesh. The direction does not need to be normalized. Returns false if
+// no triangle is hit, both sides of the triangles are considered.
+
+bool MeshBVH::raycast(const Matrix& transform, Vector3f position, Vector3f origin, Vector3f direction, Hit* pHit) const
+{
+	if (!bvhData || !((MeshBVHInternals*)bvhData)->node_count)
+		return false;
+
+	const MeshBVHInternals& data = *(const MeshBVHInternals*)bvhData;
+
+	// The ray parameter is the same in both spaces, so distances only need rescaling.
+	Matrix inverse = transform.inverse();
+	Vector3f o = inverse * (origin - position);
+	Vector3f d = inverse * direction;
+
+	if (!d)
+		return false;
+
+	const Vector3f inv_d = { 1.f / d.x, 1.f / d.y, 1.f / d.z };
+
+	// Returns the entry parameter of the ray on a node box, or infinity if it is missed.
+	auto enter = [&](const BVHNode& node, float t_max)
+	{
+		float t0 = 0.f, t1 = t_max;
+		const float box[2][3] = { { node.min.x, node.min.y, node.min.z }, { node.max.x, node.max.y, node.max.z } };
+		const float ro[3] = { o.x, o.y, o.z };
+		const float ri[3] = { inv_d.x, inv_d.y, inv_d.z };
+
+		for (unsigned a = 0u; a < 3u; a++)
+		{
+			// Rays parallel to the slab only hit it if the origin is inside, the products
+			// below would give NaN for origins lying on the box planes.
+			if (ri[a] == INFINITY || ri[a] == -INFINITY)
+			{
+				if (ro[a] < box[0][a] || ro[a] > box[1][a])
+					return INFINITY;
+				continue;
+			}
+
+			float t_low = (box[0][a] - ro[a]) * ri[a];
+			float t_high = (box[1][a] - ro[a]) * ri[a];
+
+			t0 = fmaxf(t0, fminf(t_low, t_high));
+			t1 = fminf(t1, fmaxf(t_low, t_high));
+		}
+		return t0 <= t1 ? t0 : INFINITY;
+	};
+
+	float best_t = INFINITY;
+	unsigned best = UINT_MAX;
+	float best_u = 0.f, best_v = 0.f;
+
+	unsigned stack[BVH_STACK_SIZE];
+	unsigned depth = 0u;
+
+	if (enter(data.nodes[0], best_t) < INFINITY)
+		stack[depth++] = 0u;
+
+	while (depth)
+	{
+		const BVHNode& node = data.nodes[stack[--depth]];
+
+		if (node.count)
+		{
+			// Moller Trumbore intersection of every triangle of the leaf.
+			for (unsigned i = node.first; i < node.first + node.count; i++)
+			{
+				const Vector3f& v0 = data.positions[data.indices[3u * i + 0u]];
+				const Vector3f& v1 = data.positions[data.indices[3u * i + 1u]];
+				const Vector3f& v2 = data.positions[data.indices[3u * i + 2u]];
+
+				Vector3f e1 = v1 - v0, e2 = v2 - v0;
+				Vector3f p = d * e2;
+				float det = e1 ^ p;
+				if (det == 0.f)
+					continue;
+
+				float inv_det = 1.f / det;
+				Vector3f s = o - v0;
+				float u = (s ^ p) * inv_det;
+				if (u < 0.f || u > 1.f)
+					continue;
+
+				Vector3f q = s * e1;
+				float v = (d ^ q) * inv_det;
+				if (v < 0.f || u + v > 1.f)
+					continue;
+
+				float t = (e2 ^ q) * inv_det;
+				if (t >= 0.f && t < best_t)
+				{
+					best_t = t;
+					best = i;
+					best_u = u;
+					best_v = v;
+				}
+			}
+			continue;
+		}
+
+		// Visit the closest child first, pushing it last.
+		float t_a = enter(data.nodes[node.first], best_t);
+		float t_b = enter(data.nodes[node.first + 1u], best_t);
+
+		unsigned near_child = t_a <= t_b ? node.first : node.first + 1u;
+		unsigned far_child = t_a <= t_b ? node.first + 1u : node.first;
+		float t_near = fminf(t_a, t_b), t_far = fmaxf(t_a, t_b);
+
+		if (t_far < INFINITY)
+			stack[depth++] = far_child;
+		if (t_near < INFINITY)
+			stack[depth++] = near_child;
+	}
+
+	if (best == UINT_MAX)
+		return false;
+
+	if (pHit)
+	{
+		const Vector3f& v0 = data.positions[data.indices[3u * best + 0u]];
+		const Vector3f& v1 = data.positions[data.indices[3u * best + 1u]];
+		const Vector3f& v2 = data.positions[data.indices[3u * best + 2u]];
+
+		// Normals transform with the inverse transposed, the row product does exactly that.
+		Vector3f normal = ((v1 - v0) * (v2 - v0)) * inverse;
+
+		pHit->triangle = data.triangle_ids[best];
+		pHit->distance = best_t * direction.abs();
+		pHit->point = origin + direction * best_t;
+		pHit->normal = normal ? normal.normal() : Vector3f();
+		pHit->barycentric = { best_u, best_v };
+	}
+	return true;
+}
+
+// Finds the triangles that intersect the world box, given the linear transform and the
+// position of the mesh, and writes up to the maximum specified to the list. Returns the
+// total number of triangles found, even if it is larger than the maximum.
+
+unsigned MeshBVH::queryBox(const Matrix& transform, Vector3f position, Vector3f box_min, Vector3f box_max, unsigned* triangles, unsigned max_triangles) const
+{
+	if (!bvhData || !((MeshBVHInternals*)bvhData)->node_count)
+		return 0u;
+
+	const MeshBVHInternals& data = *(const MeshBVHInternals*)bvhData;
+
+	const Vector3f center = (box_min + box_max) * 0.5f;
+	const Vector3f half = (box_max - box_min) * 0.5f;
+
+	unsigned found = 0u;
+	unsigned stack[BVH_STACK_SIZE];
+	unsigned depth = 0u;
+	stack[depth++] = 0u;
+
+	while (depth)
+	{
+		const BVHNode& node = data.nodes[stack[--depth]];
+
+		// Nodes are culled with the world box that contains them.
+		BVHBox box = world_box(transform, position, node.min, node.max);
+		if (box.min.x > box_max.x || box.max.x < box_min.x ||
+			box.min.y > box_max.y || box.max.y < box_min.y ||
+			box.min.z > box_max.z || box.max.z < box_min.z)
+			continue;
+
+		if (!node.count)
+		{
+			stack[depth++] = node.first + 1u;
+			stack[depth++] = node.first;
+			continue;
+		}
+
+		// Leaf triangles are tested exactly in world coordinates.
+		for (unsigned i = node.first; i < node.first + node.count; i++)
+		{
+			const Vector3f v[3] = {
+				transform * data.positions[data.indices[3u * i + 0u]] + position,
+				transform * data.positions[data.indices[3u * i + 1u]] + position,
+				transform * data.positions[data.indices[3u * i + 2u]] + position,
+			};
+
+			if (!triangle_box_overlap(v, center, half))
+				continue;
+
+			if (found < max_triangles && triangles)
+				triangles[found] = data.triangle_ids[i];
+			found++;
+		}
+	}
+	return found;
+}
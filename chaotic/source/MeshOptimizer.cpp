@@ -0,0 +1,471 @@
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+
+#include <cmath>
+#include <climits>
+#include <vector>
+#include <algorithm>
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Vertex Cache Optimizer Internals
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Size of the cache simulated by the vertex cache optimizer, minimum number of triangles of
+// the contiguous chunks optimized in parallel and highest valence with its own score, that
+// is also the maximum number of triangles rescored per vertex, so fans stay linear.
+#define FORSYTH_CACHE_SIZE 32u
+#define FORSYTH_CHUNK 65536u
+#define FORSYTH_MAX_VALENCE 64u
+
+// Score tables of the vertex cache optimizer, by cache position and by remaining triangles.
+// The last cache position is used for vertices outside of the cache.
+struct ForsythTables
+{
+	float cache[FORSYTH_CACHE_SIZE + 1u];
+	float valence[FORSYTH_MAX_VALENCE];
+
+	ForsythTables()
+	{
+		// The vertices of the last triangle get a fixed score, so that the next one
+		// does not always reuse the same edge, the others decay with their position.
+		for (unsigned i = 0u; i < FORSYTH_CACHE_SIZE; i++)
+			cache[i] = i < 3u ? 0.75f : powf(1.f - float(i - 3u) / float(FORSYTH_CACHE_SIZE - 3u), 1.5f);
+		cache[FORSYTH_CACHE_SIZE] = 0.f;
+
+		// Vertices with few triangles left are boosted to get rid of them early.
+		valence[0] = 0.f;
+		for (unsigned i = 1u; i < FORSYTH_MAX_VALENCE; i++)
+			valence[i] = 2.f / sqrtf(float(i));
+	}
+};
+
+static const ForsythTables forsyth_tables;
+
+// Returns the score of a vertex given its cache position and its remaining triangles.
+
+static inline float forsyth_score(unsigned cache_position, unsigned live)
+{
+	if (!live)
+		return -1.f;
+
+	return forsyth_tables.cache[cache_position] + forsyth_tables.valence[live < FORSYTH_MAX_VALENCE ? live : FORSYTH_MAX_VALENCE - 1u];
+}
+
+// Runs the vertex cache optimizer over a contiguous range of triangles and writes their new
+// order to the output range. Vertices are renumbered locally, so the scratch memory is only
+// as big as the chunk, and sorting the corners by vertex also builds the adjacency rows.
+
+static void forsyth_chunk(const unsigned* indices, unsigned first, unsigned count, unsigned* triangle_order)
+{
+	const unsigned corner_count = 3u * count;
+
+	unsigned long long* keys = new unsigned long long[corner_count];
+	unsigned* sorted = new unsigned[corner_count];
+
+	for (unsigned c = 0u; c < corner_count; c++)
+	{
+		keys[c] = indices[3u * first + c];
+		sorted[c] = c;
+	}
+
+	ThreadPool::radixSort(keys, sorted, corner_count, 32u);
+
+	// Local vertex of every corner and corners of every vertex in compressed rows, along
+	// with the slot of every corner inside its row, so that removals are constant time.
+	unsigned* local = new unsigned[corner_count];
+	unsigned* offsets = new unsigned[corner_count + 1u];
+	unsigned* adjacency = new unsigned[corner_count];
+	unsigned* slots = new unsigned[corner_count];
+
+	unsigned vertex_count = 0u;
+	for (unsigned i = 0u; i < corner_count; i++)
+	{
+		if (!i || keys[i] != keys[i - 1u])
+			offsets[vertex_count++] = i;
+
+		local[sorted[i]] = vertex_count - 1u;
+		adjacency[i] = sorted[i];
+		slots[sorted[i]] = i - offsets[vertex_count - 1u];
+	}
+	offsets[vertex_count] = corner_count;
+
+	delete[] keys;
+	delete[] sorted;
+
+	// Emitted triangles are swapped to the end of the rows, live counts the remaining ones.
+	unsigned* live = new unsigned[vertex_count];
+	unsigned* cache_position = new unsigned[vertex_count];
+	float* vertex_score = new float[vertex_count];
+	float* triangle_score = new float[count];
+	bool* emitted = new bool[count]();
+
+	for (unsigned v = 0u; v < vertex_count; v++)
+	{
+		live[v] = offsets[v + 1u] - offsets[v];
+		cache_position[v] = FORSYTH_CACHE_SIZE;
+		vertex_score[v] = forsyth_score(FORSYTH_CACHE_SIZE, live[v]);
+	}
+
+	unsigned best = UINT_MAX;
+	float best_score = -1.f;
+
+	for (unsigned t = 0u; t < count; t++)
+	{
+		triangle_score[t] = vertex_score[local[3u * t]] + vertex_score[local[3u * t + 1u]] + vertex_score[local[3u * t + 2u]];
+		if (triangle_score[t] > best_score)
+		{
+			best_score = triangle_score[t];
+			best = t;
+		}
+	}
+
+	unsigned cache[FORSYTH_CACHE_SIZE + 3u];
+	unsigned cache_count = 0u;
+	unsigned next_unemitted = 0u;
+
+	for (unsigned out = 0u; out < count; out++)
+	{
+		// On a dead end continue with the next triangle in input order.
+		if (best == UINT_MAX)
+		{
+			while (emitted[next_unemitted])
+				next_unemitted++;
+			best = next_unemitted;
+		}
+
+		triangle_order[first + out] = first + best;
+		emitted[best] = true;
+
+		const unsigned* triangle = local + 3u * best;
+
+		// Remove the triangle corners from the rows of their vertices.
+		for (unsigned k = 0u; k < 3u; k++)
+		{
+			unsigned* row = adjacency + offsets[triangle[k]];
+			unsigned& n = live[triangle[k]];
+
+			unsigned corner = 3u * best + k;
+			unsigned last = row[n - 1u];
+
+			row[slots[corner]] = last;
+			slots[last] = slots[corner];
+			row[n - 1u] = corner;
+			slots[corner] = n - 1u;
+			n--;
+		}
+
+		// The triangle vertices go to the front of the cache, followed by the previous ones.
+		unsigned new_cache[FORSYTH_CACHE_SIZE + 3u];
+		unsigned new_count = 0u;
+
+		for (unsigned k = 0u; k < 3u; k++)
+			if (std::find(new_cache, new_cache + new_count, triangle[k]) == new_cache + new_count)
+				new_cache[new_count++] = triangle[k];
+
+		for (unsigned i = 0u; i < cache_count; i++)
+			if (cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2])
+				new_cache[new_count++] = cache[i];
+
+		// Rescore the vertices of the cache, including the ones pushed out of it.
+		for (unsigned i = 0u; i < new_count; i++)
+		{
+			unsigned v = new_cache[i];
+			cache_position[v] = i < FORSYTH_CACHE_SIZE ? i : FORSYTH_CACHE_SIZE;
+			vertex_score[v] = forsyth_score(cache_position[v], live[v]);
+		}
+
+		// Rescore their remaining triangles, the best one is emitted next.
+		best = UINT_MAX;
+		best_score = -1.f;
+
+		for (unsigned i = 0u; i < new_count; i++)
+		{
+			unsigned v = new_cache[i];
+			const unsigned* row = adjacency + offsets[v];
+
+			for (unsigned j = 0u; j < live[v] && j < FORSYTH_MAX_VALENCE; j++)
+			{
+				unsigned t = row[j] / 3u;
+				triangle_score[t] = vertex_score[local[3u * t]] + vertex_score[local[3u * t + 1u]] + vertex_score[local[3u * t + 2u]];
+
+				if (triangle_score[t] > best_score)
+				{
+					best_score = triangle_score[t];
+					best = t;
+				}
+			}
+		}
+
+		cache_count = new_count < FORSYTH_CACHE_SIZE ? new_count : FORSYTH_CACHE_SIZE;
+		for (unsigned i = 0u; i < cache_count; i++)
+			cache[i] = new_cache[i];
+	}
+
+	delete[] local;
+	delete[] offsets;
+	delete[] adjacency;
+	delete[] slots;
+	delete[] live;
+	delete[] cache_position;
+	delete[] vertex_score;
+	delete[] triangle_score;
+	delete[] emitted;
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Overdraw Optimizer Internals
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Size of the FIFO cache simulated to find the cluster boundaries and the statistics.
+#define OVERDRAW_CACHE_SIZE 16u
+
+// Minimal FIFO cache simulation, a vertex is in the cache if less than cache size vertices
+// were transformed after it. Restarting the cache just moves the time forward.
+struct FifoCache
+{
+	unsigned* timestamps;
+	unsigned size;
+	unsigned time;
+
+	FifoCache(unsigned vertex_count, unsigned cache_size)
+		: timestamps(new unsigned[vertex_count]()), size(cache_size), time(cache_size + 1u) {}
+
+	~FifoCache() { delete[] timestamps; }
+
+	void restart() { time += size + 1u; }
+
+	// Returns the number of vertices transformed to draw the triangle.
+	unsigned misses(const unsigned* triangle)
+	{
+		unsigned n = 0u;
+		for (unsigned k = 0u; k < 3u; k++)
+		{
+			if (time - timestamps[triangle[k]] > size)
+			{
+				timestamps[triangle[k]] = time++;
+				n++;
+			}
+		}
+		return n;
+	}
+};
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Mesh Optimizer Functions
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Simulates a FIFO post transform cache of the size specified over the triangle list and
+// returns its statistics. Every index must be smaller than the vertex count.
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const unsigned* indices, unsigned triangle_count, unsigned vertex_count, unsigned cache_size)
+{
+	CacheStats stats = {};
+
+	FifoCache fifo(vertex_count, cache_size ? cache_size : 1u);
+
+	for (unsigned t = 0u; t < triangle_count; t++)
+		stats.transformed_vertices += fifo.misses(indices + 3u * t);
+
+	// Every referenced vertex was transformed at least once.
+	for (unsigned v = 0u; v < vertex_count; v++)
+		stats.referenced_vertices += fifo.timestamps[v] != 0u;
+
+	stats.acmr = triangle_count ? float(stats.transformed_vertices) / triangle_count : 0.f;
+	stats.atvr = stats.referenced_vertices ? float(stats.transformed_vertices) / stats.referenced_vertices : 0.f;
+	return stats;
+}
+
+// Computes a triangle order for the vertex cache, writes for every new position the index
+// of the triangle that goes there. The indices themselves are not modified.
+
+void MeshOptimizer::optimizeVertexCache(const unsigned* indices, unsigned triangle_count, unsigned* triangle_order)
+{
+	// Chunks are as big as possible while keeping every thread busy.
+	unsigned threads = ThreadPool::threadCount();
+	unsigned chunk = (triangle_count + threads - 1u) / threads;
+	if (chunk < FORSYTH_CHUNK)
+		chunk = FORSYTH_CHUNK;
+
+	ThreadPool::parallelFor(triangle_count, chunk, [&](unsigned begin, unsigned end, unsigned)
+	{
+		forsyth_chunk(indices, begin, end - begin, triangle_order);
+	});
+}
+
+// Computes a triangle order that reduces overdraw while keeping most of the vertex cache
+// efficiency of the current order, which should already be cache optimized. Clusters are
+// split wherever the cache efficiency stays within the threshold of the original one.
+
+void MeshOptimizer::optimizeOverdraw(const unsigned* indices, unsigned triangle_count, const Vector3f* positions, unsigned vertex_count, unsigned* triangle_order, float threshold)
+{
+	if (!triangle_count)
+		return;
+
+	FifoCache fifo(vertex_count, OVERDRAW_CACHE_SIZE);
+
+	// Hard boundaries are the triangles where the cache restarts anyway.
+	std::vector<unsigned> hard;
+	for (unsigned t = 0u; t < triangle_count; t++)
+		if (fifo.misses(indices + 3u * t) == 3u || !t)
+			hard.push_back(t);
+	hard.push_back(triangle_count);
+
+	// Soft boundaries split the hard clusters wherever the running cache efficiency
+	// is already within the threshold of the efficiency of the whole cluster.
+	std::vector<unsigned> clusters;
+	for (size_t h = 0u; h + 1u < hard.size(); h++)
+	{
+		const unsigned start = hard[h];
+		const unsigned end = hard[h + 1u];
+
+		fifo.restart();
+		unsigned cluster_misses = 0u;
+		for (unsigned t = start; t < end; t++)
+			cluster_misses += fifo.misses(indices + 3u * t);
+
+		const float cluster_threshold = threshold * float(cluster_misses) / float(end - start);
+
+		fifo.restart();
+		clusters.push_back(start);
+
+		unsigned running_misses = 0u;
+		unsigned running_triangles = 0u;
+		for (unsigned t = start; t + 1u < end; t++)
+		{
+			running_misses += fifo.misses(indices + 3u * t);
+			running_triangles++;
+
+			if (float(running_misses) <= cluster_threshold * running_triangles)
+			{
+				clusters.push_back(t + 1u);
+				fifo.restart();
+				running_misses = 0u;
+				running_triangles = 0u;
+			}
+		}
+	}
+	clusters.push_back(triangle_count);
+
+	// Area weighted centroid and normal of every cluster.
+	const unsigned cluster_count = unsigned(clusters.size() - 1u);
+
+	Vector3f* centroids = new Vector3f[cluster_count];
+	Vector3f* normals = new Vector3f[cluster_count];
+	float* areas = new float[cluster_count];
+
+	ThreadPool::parallelFor(cluster_count, 256u, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned c = begin; c < end; c++)
+		{
+			Vector3f centroid = {};
+			Vector3f normal = {};
+			float area = 0.f;
+
+			for (unsigned t = clusters[c]; t < clusters[c + 1u]; t++)
+			{
+				const Vector3f& v0 = positions[indices[3u * t + 0u]];
+				const Vector3f& v1 = positions[indices[3u * t + 1u]];
+				const Vector3f& v2 = positions[indices[3u * t + 2u]];
+
+				Vector3f n = (v1 - v0) * (v2 - v0);
+				float a = n.abs();
+
+				centroid += (v0 + v1 + v2) * (a / 3.f);
+				normal += n;
+				area += a;
+			}
+
+			centroids[c] = centroid;
+			normals[c] = normal;
+			areas[c] = area;
+		}
+	});
+
+	Vector3f mesh_centroid = {};
+	float mesh_area = 0.f;
+	for (unsigned c = 0u; c < cluster_count; c++)
+	{
+		mesh_centroid += centroids[c];
+		mesh_area += areas[c];
+	}
+	if (mesh_area > 0.f)
+		mesh_centroid = mesh_centroid / mesh_area;
+
+	// Clusters further out along their own normal are drawn first, since they usually
+	// cover the ones behind them.
+	std::vector<std::pair<float, unsigned>> order(cluster_count);
+	for (unsigned c = 0u; c < cluster_count; c++)
+	{
+		float key = 0.f;
+		if (areas[c] > 0.f)
+			key = ((centroids[c] / areas[c] - mesh_centroid) ^ normals[c]) / normals[c].abs();
+
+		order[c] = { -key, c };
+	}
+	std::stable_sort(order.begin(), order.end(), [](const std::pair<float, unsigned>& a, const std::pair<float, unsigned>& b) { return a.first < b.first; });
+
+	unsigned out = 0u;
+	for (auto& [key, c] : order)
+		for (unsigned t = clusters[c]; t < clusters[c + 1u]; t++)
+			triangle_order[out++] = t;
+
+	delete[] centroids;
+	delete[] normals;
+	delete[] areas;
+}
+
+// Optimizes the vertex cache and, if positions are provided, the overdraw of the triangle
+// list, reordering the indices in place. If an order pointer is provided it receives for
+// every new position the original triangle, to reorder any per triangle data along.
+
+void MeshOptimizer::optimizeTriangleOrder(unsigned* indices, unsigned triangle_count, unsigned vertex_count, const Vector3f* positions, unsigned* triangle_order)
+{
+	unsigned* order = triangle_order ? triangle_order : new unsigned[triangle_count];
+	unsigned* reordered = new unsigned[3u * triangle_count];
+
+	optimizeVertexCache(indices, triangle_count, order);
+
+	ThreadPool::parallelFor(triangle_count, 65536u, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned t = begin; t < end; t++)
+			for (unsigned k = 0u; k < 3u; k++)
+				reordered[3u * t + k] = indices[3u * order[t] + k];
+	});
+
+	if (positions)
+	{
+		unsigned* overdraw = new unsigned[triangle_count];
+		unsigned* composed = new unsigned[triangle_count];
+
+		optimizeOverdraw(reordered, triangle_count, positions, vertex_count, overdraw);
+
+		ThreadPool::parallelFor(triangle_count, 65536u, [&](unsigned begin, unsigned end, unsigned)
+		{
+			for (unsigned t = begin; t < end; t++)
+			{
+				composed[t] = order[overdraw[t]];
+				for (unsigned k = 0u; k < 3u; k++)
+					indices[3u * t + k] = reordered[3u * overdraw[t] + k];
+			}
+		});
+
+		for (unsigned t = 0u; t < triangle_count; t++)
+			order[t] = composed[t];
+
+		delete[] overdraw;
+		delete[] composed;
+	}
+	else for (unsigned i = 0u; i < 3u * triangle_count; i++)
+		indices[i] = reordered[i];
+
+	if (!triangle_order)
+		delete[] order;
+
+	delete[] reordered;
+}
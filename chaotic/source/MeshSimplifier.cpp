@@ -0,0 +1,506 @@
+#include "MeshSimplifier.h"
+#include "ThreadPool.h"
+
+#include <cmath>
+#include <cfloat>
+#include <climits>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Mesh Simplifier Internals
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Minimum number of vertices scanned per parallel task and weight of the border planes,
+// relative to the squared length of their edge, so borders are much stiffer than faces.
+#define SIMPLIFY_CHUNK 4096u
+#define SIMPLIFY_BORDER_WEIGHT 10.0
+
+// Cosine of the largest rotation allowed to a triangle normal by a collapse, so that
+// triangles can not fold over their neighbours through a series of small rotations.
+#define SIMPLIFY_MAX_ROTATION 0.25f
+
+// Collapse behaviour of a vertex, border vertices only slide along their border edges.
+enum SimplifyKind : unsigned char
+{
+	SIMPLIFY_MANIFOLD,
+	SIMPLIFY_BORDER,
+	SIMPLIFY_LOCKED,
+	SIMPLIFY_UNUSED,
+};
+
+// Symmetric quadric of the squared distances to a set of weighted planes.
+struct Quadric
+{
+	double a00 = 0., a11 = 0., a22 = 0., a01 = 0., a02 = 0., a12 = 0.;
+	double b0 = 0., b1 = 0., b2 = 0.;
+	double c = 0.;
+	double weight = 0.;
+
+	// Adds the plane with unit normal n and offset d, scaled by the weight.
+	void addPlane(const Vector3f& n, double d, double w)
+	{
+		a00 += w * n.x * n.x; a11 += w * n.y * n.y; a22 += w * n.z * n.z;
+		a01 += w * n.x * n.y; a02 += w * n.x * n.z; a12 += w * n.y * n.z;
+		b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+		c += w * d * d;
+		weight += w;
+	}
+
+	// Adds another quadric to this one.
+	void add(const Quadric& q)
+	{
+		a00 += q.a00; a11 += q.a11; a22 += q.a22;
+		a01 += q.a01; a02 += q.a02; a12 += q.a12;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2;
+		c += q.c;
+		weight += q.weight;
+	}
+
+	// Weighted sum of the squared distances from the point to the planes.
+	double evaluate(const Vector3f& p) const
+	{
+		const double x = p.x, y = p.y, z = p.z;
+		const double r =
+			a00 * x * x + a11 * y * y + a22 * z * z +
+			2. * (a01 * x * y + a02 * x * z + a12 * y * z) +
+			2. * (b0 * x + b1 * y + b2 * z) + c;
+
+		return r > 0. ? r : 0.;
+	}
+};
+
+// Vertex to corner adjacency of the live triangles, as rows of corners per vertex.
+struct SimplifyAdjacency
+{
+	std::vector<unsigned> offsets;
+	std::vector<unsigned> corners;
+
+	// Counting sort of the corners by their vertex.
+	void build(const std::vector<unsigned>& indices, unsigned vertex_count)
+	{
+		offsets.assign(vertex_count + 1u, 0u);
+		corners.resize(indices.size());
+
+		for (unsigned v : indices)
+			offsets[v + 1u]++;
+
+		for (unsigned v = 0u; v < vertex_count; v++)
+			offsets[v + 1u] += offsets[v];
+
+		std::vector<unsigned> cursor(offsets.begin(), offsets.end() - 1);
+		for (unsigned c = 0u; c < unsigned(indices.size()); c++)
+			corners[cursor[indices[c]]++] = c;
+	}
+
+	inline const unsigned* begin(unsigned v) const { return corners.data() + offsets[v]; }
+	inline const unsigned* end(unsigned v) const { return corners.data() + offsets[v + 1u]; }
+};
+
+// Working state of a simplification.
+struct SimplifyState
+{
+	std::vector<unsigned> indices;		// Live triangles.
+	std::vector<unsigned> sources;		// Input corner of every live corner.
+	std::vector<Vector3f> positions;	// Positions scaled to the unit box.
+	std::vector<Quadric> quadrics;		// Accumulated quadric of every vertex.
+	SimplifyAdjacency adjacency;
+
+	const unsigned long long* attributes;
+
+	inline unsigned long long attribute(unsigned corner) const { return attributes ? attributes[sources[corner]] : 0ull; }
+};
+
+// Neighbour of a vertex found while scanning its triangles, with the corners of both
+// vertices in the triangle, so that shared edges can be compared.
+struct SimplifyEdge
+{
+	unsigned vertex;
+	unsigned corner;
+	unsigned other_corner;
+
+	inline bool operator<(const SimplifyEdge& e) const { return vertex < e.vertex; }
+};
+
+// Scans the triangles of a vertex, writes its neighbours with the number of triangles they
+// share, one for border edges, and returns the vertex kind. Edges shared by more than two
+// triangles, attribute seams and vertices where borders meet are locked.
+
+static SimplifyKind scan_vertex(const SimplifyState& state, unsigned u, std::vector<SimplifyEdge>& edges, std::vector<unsigned>& neighbours, std::vector<unsigned>& shared)
+{
+	edges.clear();
+	neighbours.clear();
+	shared.clear();
+
+	const unsigned* row = state.adjacency.begin(u);
+	const unsigned* row_end = state.adjacency.end(u);
+	if (row == row_end)
+		return SIMPLIFY_UNUSED;
+
+	bool uniform = true;
+	const unsigned long long first = state.attribute(*row);
+
+	for (const unsigned* c = row; c < row_end; c++)
+	{
+		const unsigned t = *c / 3u;
+		const unsigned k = *c % 3u;
+		const unsigned c1 = 3u * t + (k + 1u) % 3u;
+		const unsigned c2 = 3u * t + (k + 2u) % 3u;
+
+		edges.push_back({ state.indices[c1], *c, c1 });
+		edges.push_back({ state.indices[c2], *c, c2 });
+
+		if (state.attribute(*c) != first)
+			uniform = false;
+	}
+	std::sort(edges.begin(), edges.end());
+
+	bool locked = !uniform;
+	unsigned borders = 0u;
+
+	for (size_t i = 0u; i < edges.size();)
+	{
+		size_t j = i + 1u;
+		while (j < edges.size() && edges[j].vertex == edges[i].vertex)
+			j++;
+
+		const unsigned count = unsigned(j - i);
+		if (count == 1u)
+			borders++;
+		else if (count > 2u)
+			locked = true;
+		else if (
+			state.attribute(edges[i].corner) != state.attribute(edges[i + 1u].corner) ||
+			state.attribute(edges[i].other_corner) != state.attribute(edges[i + 1u].other_corner))
+			locked = true;
+
+		neighbours.push_back(edges[i].vertex);
+		shared.push_back(count);
+		i = j;
+	}
+
+	if (locked)
+		return SIMPLIFY_LOCKED;
+	if (!borders)
+		return SIMPLIFY_MANIFOLD;
+	if (borders == 2u)
+		return SIMPLIFY_BORDER;
+	return SIMPLIFY_LOCKED;
+}
+
+// Checks that collapsing u onto v rotates no triangle too far and keeps the mesh manifold. The
+// vertices shared by both neighbourhoods must be exactly the ones opposite to the edge,
+// and two vertices of a tetrahedron are never merged.
+
+static bool collapse_valid(const SimplifyState& state, unsigned u, unsigned v, unsigned edge_triangles, const std::vector<unsigned>& u_neighbours, std::vector<unsigned>& scratch)
+{
+	for (const unsigned* c = state.adjacency.begin(u); c < state.adjacency.end(u); c++)
+	{
+		const unsigned* tri = state.indices.data() + 3u * (*c / 3u);
+		if (tri[0] == v || tri[1] == v || tri[2] == v)
+			continue;
+
+		const Vector3f& p0 = state.positions[tri[0]];
+		const Vector3f& p1 = state.positions[tri[1]];
+		const Vector3f& p2 = state.positions[tri[2]];
+		const Vector3f normal = (p1 - p0) * (p2 - p0);
+
+		const Vector3f& q0 = state.positions[tri[0] == u ? v : tri[0]];
+		const Vector3f& q1 = state.positions[tri[1] == u ? v : tri[1]];
+		const Vector3f& q2 = state.positions[tri[2] == u ? v : tri[2]];
+		const Vector3f collapsed = (q1 - q0) * (q2 - q0);
+
+		if (normal && (normal ^ collapsed) <= SIMPLIFY_MAX_ROTATION * normal.abs() * collapsed.abs())
+			return false;
+	}
+
+	scratch.clear();
+	for (const unsigned* c = state.adjacency.begin(v); c < state.adjacency.end(v); c++)
+	{
+		const unsigned* tri = state.indices.data() + 3u * (*c / 3u);
+		for (unsigned k = 0u; k < 3u; k++)
+			if (tri[k] != v && tri[k] != u)
+				scratch.push_back(tri[k]);
+	}
+	std::sort(scratch.begin(), scratch.end());
+	scratch.erase(std::unique(scratch.begin(), scratch.end()), scratch.end());
+
+	unsigned common = 0u;
+	for (unsigned w : u_neighbours)
+		if (w != v && std::binary_search(scratch.begin(), scratch.end(), w))
+			common++;
+
+	if (common != edge_triangles)
+		return false;
+
+	// Closed tetrahedron, the collapse would leave two faces back to back.
+	if (u_neighbours.size() == 3u && scratch.size() == 2u)
+		return false;
+
+	return true;
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Mesh Simplifier Functions
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Simplifies the triangle list until it has at most the target triangle count, or until
+// the next collapse would move the surface further than the target error, given as a
+// fraction of the mesh size. A target error of zero sets no limit, so only the triangle
+// count is used. Corner attributes are optional ids, corners with equal ids have equal
+// attributes. Writes the new triangles, indexing the same vertex list, and for every new
+// corner the input corner its attributes come from. Both outputs must be as long as the
+// input indices. Returns the new triangle count and optionally the error.
+
+unsigned MeshSimplifier::simplify(const unsigned* indices, unsigned triangle_count, const Vector3f* positions, unsigned vertex_count,
+	const unsigned long long* corner_attributes, unsigned target_triangle_count, float target_error,
+	unsigned* out_indices, unsigned* out_corners, float* pResultError)
+{
+	SimplifyState state;
+	state.attributes = corner_attributes;
+
+	// Triangles with repeated vertices are dropped from the start.
+	state.indices.reserve(3u * size_t(triangle_count));
+	state.sources.reserve(3u * size_t(triangle_count));
+	for (unsigned t = 0u; t < triangle_count; t++)
+	{
+		const unsigned* tri = indices + 3u * t;
+		if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0])
+			continue;
+
+		for (unsigned k = 0u; k < 3u; k++)
+		{
+			state.indices.push_back(tri[k]);
+			state.sources.push_back(3u * t + k);
+		}
+	}
+
+	// Positions are moved to the unit box, so that the errors are relative to the size.
+	Vector3f low = { FLT_MAX, FLT_MAX, FLT_MAX };
+	Vector3f high = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (unsigned v : state.indices)
+	{
+		const Vector3f& p = positions[v];
+		low = { fminf(low.x, p.x), fminf(low.y, p.y), fminf(low.z, p.z) };
+		high = { fmaxf(high.x, p.x), fmaxf(high.y, p.y), fmaxf(high.z, p.z) };
+	}
+	const float extent = fmaxf(high.x - low.x, fmaxf(high.y - low.y, high.z - low.z));
+	const float scale = extent > 0.f ? 1.f / extent : 1.f;
+
+	state.positions.resize(vertex_count);
+	ThreadPool::parallelFor(vertex_count, SIMPLIFY_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned v = begin; v < end; v++)
+			state.positions[v] = (positions[v] - low) * scale;
+	});
+
+	// Every vertex accumulates the area weighted planes of its triangles, and the planes
+	// through its border edges, perpendicular to the triangle.
+	state.adjacency.build(state.indices, vertex_count);
+	state.quadrics.resize(vertex_count);
+
+	ThreadPool::parallelFor(vertex_count, SIMPLIFY_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+	{
+		std::vector<SimplifyEdge> edges;
+		std::vector<unsigned> neighbours, shared;
+
+		for (unsigned u = begin; u < end; u++)
+		{
+			Quadric& q = state.quadrics[u];
+
+			for (const unsigned* c = state.adjacency.begin(u); c < state.adjacency.end(u); c++)
+			{
+				const unsigned* tri = state.indices.data() + 3u * (*c / 3u);
+				const Vector3f& p0 = state.positions[tri[0]];
+				Vector3f normal = (state.positions[tri[1]] - p0) * (state.positions[tri[2]] - p0);
+
+				const float area = normal.abs();
+				if (area == 0.f)
+					continue;
+				normal /= area;
+
+				q.addPlane(normal, -(normal ^ p0), 0.5 * area);
+			}
+
+			if (scan_vertex(state, u, edges, neighbours, shared) == SIMPLIFY_UNUSED)
+				continue;
+
+			for (const SimplifyEdge& e : edges)
+			{
+				if (shared[std::lower_bound(neighbours.begin(), neighbours.end(), e.vertex) - neighbours.begin()] != 1u)
+					continue;
+
+				const unsigned* tri = state.indices.data() + 3u * (e.corner / 3u);
+				const Vector3f& p0 = state.positions[tri[0]];
+				const Vector3f normal = (state.positions[tri[1]] - p0) * (state.positions[tri[2]] - p0);
+
+				const Vector3f edge = state.positions[e.vertex] - state.positions[u];
+				Vector3f side = edge * normal;
+				if (!side)
+					continue;
+				side.normalize();
+
+				q.addPlane(side, -(side ^ state.positions[u]), SIMPLIFY_BORDER_WEIGHT * (edge ^ edge));
+			}
+		}
+	});
+
+	// Without a target error every collapse is allowed until the triangle count is reached.
+	const double error_limit = target_error > 0.f ? double(target_error) * double(target_error) : DBL_MAX;
+	double result_error = 0.;
+
+	unsigned live = unsigned(state.indices.size() / 3u);
+
+	std::vector<unsigned> targets(vertex_count);
+	std::vector<float> costs(vertex_count);
+	std::vector<unsigned char> touched(vertex_count);
+	std::vector<unsigned char> dead;
+	std::vector<unsigned long long> keys;
+	std::vector<unsigned> order;
+
+	while (live > target_triangle_count)
+	{
+		// Cheapest valid collapse of every vertex, computed in parallel over the current mesh.
+		ThreadPool::parallelFor(vertex_count, SIMPLIFY_CHUNK, [&](unsigned begin, unsigned end, unsigned)
+		{
+			std::vector<SimplifyEdge> edges;
+			std::vector<unsigned> neighbours, shared, scratch;
+
+			for (unsigned u = begin; u < end; u++)
+			{
+				targets[u] = UINT_MAX;
+
+				const SimplifyKind kind = scan_vertex(state, u, edges, neighbours, shared);
+				if (kind != SIMPLIFY_MANIFOLD && kind != SIMPLIFY_BORDER)
+					continue;
+
+				double best = DBL_MAX;
+				for (size_t i = 0u; i < neighbours.size(); i++)
+				{
+					const unsigned v = neighbours[i];
+					if (kind == SIMPLIFY_BORDER && shared[i] != 1u)
+						continue;
+
+					const Quadric& qu = state.quadrics[u];
+					const Quadric& qv = state.quadrics[v];
+					const double weight = qu.weight + qv.weight;
+
+					double cost = qu.evaluate(state.positions[v]) + qv.evaluate(state.positions[v]);
+					if (weight > 0.)
+						cost /= weight;
+
+					if (cost >= best || !collapse_valid(state, u, v, shared[i], neighbours, scratch))
+						continue;
+
+					best = cost;
+					targets[u] = v;
+				}
+				costs[u] = float(best);
+			}
+		});
+
+		keys.clear();
+		order.clear();
+		for (unsigned u = 0u; u < vertex_count; u++)
+		{
+			if (targets[u] == UINT_MAX || costs[u] > error_limit)
+				continue;
+
+			unsigned bits;
+			memcpy(&bits, &costs[u], sizeof(float));
+			keys.push_back(bits);
+			order.push_back(u);
+		}
+		if (order.empty())
+			break;
+
+		ThreadPool::radixSort(keys.data(), order.data(), unsigned(order.size()), 32u);
+
+		// Greedy collapses in cost order, skipping any that touches a neighbourhood changed
+		// during this pass, so every check made above is still valid when applied.
+		std::fill(touched.begin(), touched.end(), (unsigned char)0);
+		dead.assign(state.indices.size() / 3u, (unsigned char)0);
+
+		unsigned collapsed = 0u;
+		for (unsigned u : order)
+		{
+			if (live <= target_triangle_count)
+				break;
+
+			const unsigned v = targets[u];
+			if (touched[u] || touched[v])
+				continue;
+
+			// The corners moved to v take its attributes in the triangles of the edge.
+			unsigned source = UINT_MAX;
+			for (const unsigned* c = state.adjacency.begin(u); c < state.adjacency.end(u); c++)
+			{
+				const unsigned* tri = state.indices.data() + 3u * (*c / 3u);
+				for (unsigned k = 0u; k < 3u; k++)
+					touched[tri[k]] = 1u;
+
+				if (source == UINT_MAX)
+					for (unsigned k = 0u; k < 3u; k++)
+						if (tri[k] == v)
+							source = state.sources[3u * (*c / 3u) + k];
+			}
+
+			for (const unsigned* c = state.adjacency.begin(u); c < state.adjacency.end(u); c++)
+			{
+				const unsigned t = *c / 3u;
+				const unsigned* tri = state.indices.data() + 3u * t;
+
+				if (tri[0] == v || tri[1] == v || tri[2] == v)
+				{
+					dead[t] = 1u;
+					live--;
+				}
+				else
+				{
+					state.indices[*c] = v;
+					state.sources[*c] = source;
+				}
+			}
+
+			state.quadrics[v].add(state.quadrics[u]);
+			if (costs[u] > result_error)
+				result_error = costs[u];
+			collapsed++;
+		}
+
+		if (!collapsed)
+			break;
+
+		// Removes the collapsed triangles and rebuilds the adjacency for the next pass.
+		unsigned kept = 0u;
+		for (unsigned t = 0u; t < unsigned(dead.size()); t++)
+		{
+			if (dead[t])
+				continue;
+
+			for (unsigned k = 0u; k < 3u; k++)
+			{
+				state.indices[3u * kept + k] = state.indices[3u * t + k];
+				state.sources[3u * kept + k] = state.sources[3u * t + k];
+			}
+			kept++;
+		}
+		state.indices.resize(3u * kept);
+		state.sources.resize(3u * kept);
+
+		state.adjacency.build(state.indices, vertex_count);
+	}
+
+	memcpy(out_indices, state.indices.data(), state.indices.size() * sizeof(unsigned));
+	memcpy(out_corners, state.sources.data(), state.sources.size() * sizeof(unsigned));
+
+	if (pResultError)
+		*pResultError = float(sqrt(result_error));
+
+	return live;
+}
@@ -0,0 +1,591 @@
+#include "ParticleSystem.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+#include "Error/_erDefault.h"
+
+#include <cstring>
+
+#if defined _M_X64 || defined _M_IX86 || defined __SSE2__
+#include <emmintrin.h>
+#define _PARTICLES_SSE
+#endif
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Particle System Internals
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Number of particles processed by every parallel chunk, multiple of four.
+static constexpr unsigned PARTICLE_CHUNK = 4096u;
+
+// Maximum number of forces in a system.
+static constexpr unsigned MAX_PARTICLE_FORCES = 16u;
+
+// Struct that stores the internal data for a given ParticleSystem object.
+struct ParticleSystemInternals
+{
+	unsigned count = 0u;
+
+	// Every array is padded to a multiple of four floats so that the
+	// SIMD loops never need a scalar tail, all live in a single block.
+	unsigned padded = 0u;
+	float* block = nullptr;
+
+	float* x = nullptr;
+	float* y = nullptr;
+	float* z = nullptr;
+	float* vx = nullptr;
+	float* vy = nullptr;
+	float* vz = nullptr;
+	float* rest_x = nullptr;
+	float* rest_y = nullptr;
+	float* rest_z = nullptr;
+
+	Color* colors = nullptr;
+
+	struct Force
+	{
+		PARTICLE_FORCE func;
+		void* user_data;
+	}
+	forces[MAX_PARTICLE_FORCES] = {};
+	unsigned n_forces = 0u;
+
+	// Parameters of the built in forces, pointed by the user data of their kernels.
+	struct BuiltInParams
+	{
+		float a, b, c;
+	}
+	params[MAX_PARTICLE_FORCES] = {};
+
+	// Per-thread acceleration accumulators and random generators.
+	unsigned n_threads = 0u;
+	float* scratch = nullptr;
+	unsigned long long* random_states = nullptr;
+};
+
+// Splitmix64 step, used to seed the xorshift generators from a single seed.
+static inline unsigned long long splitmix64(unsigned long long& state)
+{
+	unsigned long long z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Force kernels and integrator
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// All the helpers below process the arrays in groups of four, relying on the padding.
+
+// Adds a constant value to the accumulator.
+static inline void add_constant(float* a, float value, unsigned count)
+{
+#ifdef _PARTICLES_SSE
+	const __m128 v = _mm_set1_ps(value);
+	for (unsigned i = 0u; i < count; i += 4u)
+		_mm_storeu_ps(a + i, _mm_add_ps(_mm_loadu_ps(a + i), v));
+#else
+	for (unsigned i = 0u; i < count; i++)
+		a[i] += value;
+#endif
+}
+
+// Adds -k * (p - rest) - c * v to the accumulator.
+static inline void add_spring(float* a, const float* p, const float* rest, const float* v, float k, float c, unsigned count)
+{
+#ifdef _PARTICLES_SSE
+	const __m128 vk = _mm_set1_ps(k);
+	const __m128 vc = _mm_set1_ps(c);
+	for (unsigned i = 0u; i < count; i += 4u)
+	{
+		__m128 stretch = _mm_sub_ps(_mm_loadu_ps(p + i), _mm_loadu_ps(rest + i));
+		__m128 force = _mm_add_ps(_mm_mul_ps(vk, stretch), _mm_mul_ps(vc, _mm_loadu_ps(v + i)));
+		_mm_storeu_ps(a + i, _mm_sub_ps(_mm_loadu_ps(a + i), force));
+	}
+#else
+	for (unsigned i = 0u; i < count; i++)
+		a[i] -= k * (p[i] - rest[i]) + c * v[i];
+#endif
+}
+
+// Semi-implicit Euler for one axis, v += a * dt, p += v * dt.
+static inline void integrate_axis(float* p, float* v, const float* a, float dt, unsigned count)
+{
+#ifdef _PARTICLES_SSE
+	const __m128 vdt = _mm_set1_ps(dt);
+	for (unsigned i = 0u; i < count; i += 4u)
+	{
+		__m128 vel = _mm_add_ps(_mm_loadu_ps(v + i), _mm_mul_ps(_mm_loadu_ps(a + i), vdt));
+		_mm_storeu_ps(v + i, vel);
+		_mm_storeu_ps(p + i, _mm_add_ps(_mm_loadu_ps(p + i), _mm_mul_ps(vel, vdt)));
+	}
+#else
+	for (unsigned i = 0u; i < count; i++)
+	{
+		v[i] += a[i] * dt;
+		p[i] += v[i] * dt;
+	}
+#endif
+}
+
+// Built in gravity kernel, the parameters are the acceleration vector.
+static void gravity_kernel(const PARTICLE_SPAN& span, void* user_data)
+{
+	const ParticleSystemInternals::BuiltInParams& g = *(ParticleSystemInternals::BuiltInParams*)user_data;
+
+	add_constant(span.ax, g.a, span.count);
+	add_constant(span.ay, g.b, span.count);
+	add_constant(span.az, g.c, span.count);
+}
+
+// Built in drag kernel, the first parameter is the drag coefficient.
+static void drag_kernel(const PARTICLE_SPAN& span, void* user_data)
+{
+	const float c = ((ParticleSystemInternals::BuiltInParams*)user_data)->a;
+
+	// A spring of zero stiffness is a pure damper.
+	add_spring(span.ax, span.x, span.x, span.vx, 0.f, c, span.count);
+	add_spring(span.ay, span.y, span.y, span.vy, 0.f, c, span.count);
+	add_spring(span.az, span.z, span.z, span.vz, 0.f, c, span.count);
+}
+
+// Built in spring kernel, the parameters are the stiffness and the damping.
+static void spring_kernel(const PARTICLE_SPAN& span, void* user_data)
+{
+	const ParticleSystemInternals::BuiltInParams& s = *(ParticleSystemInternals::BuiltInParams*)user_data;
+
+	add_spring(span.ax, span.x, span.rest_x, span.vx, s.a, s.b, span.count);
+	add_spring(span.ay, span.y, span.rest_y, span.vy, s.a, s.b, span.count);
+	add_spring(span.az, span.z, span.rest_z, span.vz, s.a, s.b, span.count);
+}
+
+// Built in noise kernel, the first parameter is the amplitude.
+static void noise_kernel(const PARTICLE_SPAN& span, void* user_data)
+{
+	const float amplitude = 2.f * ((ParticleSystemInternals::BuiltInParams*)user_data)->a;
+
+	for (unsigned i = 0u; i < span.count; i++)
+	{
+		span.ax[i] += amplitude * (ParticleSystem::random(span.random_state) - 0.5f);
+		span.ay[i] += amplitude * (ParticleSystem::random(span.random_state) - 0.5f);
+		span.az[i] += amplitude * (ParticleSystem::random(span.random_state) - 0.5f);
+	}
+}
+
+// Adds a built in kernel to the force list, storing its parameters inside the system.
+static void add_built_in(ParticleSystemInternals& data, PARTICLE_FORCE kernel, float a, float b, float c)
+{
+	USER_CHECK(data.n_forces < MAX_PARTICLE_FORCES,
+		"Trying to add more than sixteen forces to a ParticleSystem."
+	);
+
+	data.params[data.n_forces] = { a, b, c };
+	data.forces[data.n_forces] = { kernel, &data.params[data.n_forces] };
+	data.n_forces++;
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ Constructors / Destructors
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Particle system constructor, if the pointer is valid it will call the initializer.
+
+ParticleSystem::ParticleSystem(const PARTICLE_SYSTEM_DESC* pDesc)
+{
+	if (pDesc)
+		initialize(pDesc);
+}
+
+// Frees all the particle arrays.
+
+ParticleSystem::~ParticleSystem()
+{
+	if (!particleData)
+		return;
+
+	ParticleSystemInternals& data = *(ParticleSystemInternals*)particleData;
+
+	delete[] data.block;
+	delete[] data.scratch;
+	delete[] data.random_states;
+
+	if (data.colors)
+		delete[] data.colors;
+
+	delete &data;
+}
+
+// Initializes the ParticleSystem, it expects a valid pointer to a descriptor and will
+// allocate and fill the particle arrays, can only be called once per object.
+
+void ParticleSystem::initialize(const PARTICLE_SYSTEM_DESC* pDesc)
+{
+	USER_CHECK(pDesc,
+		"Trying to initialize a ParticleSystem with an invalid descriptor pointer."
+	);
+
+	USER_CHECK(!particleData,
+		"Trying to initialize a ParticleSystem that has already been initialized."
+	);
+
+	USER_CHECK(pDesc->particle_count,
+		"Found zero particle count when trying to create a ParticleSystem."
+	);
+
+	particleData = new ParticleSystemInternals;
+	ParticleSystemInternals& data = *(ParticleSystemInternals*)particleData;
+
+	data.count = pDesc->particle_count;
+	data.padded = (data.count + 3u) & ~3u;
+
+	// Allocate all the arrays in a single zeroed block.
+	data.block = new float[9u * data.padded]();
+	data.x		= data.block + 0u * data.padded;
+	data.y		= data.block + 1u * data.padded;
+	data.z		= data.block + 2u * data.padded;
+	data.vx		= data.block + 3u * data.padded;
+	data.vy		= data.block + 4u * data.padded;
+	data.vz		= data.block + 5u * data.padded;
+	data.rest_x = data.block + 6u * data.padded;
+	data.rest_y = data.block + 7u * data.padded;
+	data.rest_z = data.block + 8u * data.padded;
+
+	// Seed the per-thread generators.
+	unsigned long long seed = pDesc->seed ? pDesc->seed : Timer::get_system_time_ns();
+
+	data.n_threads = ThreadPool::threadCount();
+	data.random_states = new unsigned long long[data.n_threads];
+	for (unsigned t = 0u; t < data.n_threads; t++)
+	{
+		data.random_states[t] = splitmix64(seed);
+
+		// Xorshift states can not be zero.
+		if (!data.random_states[t])
+			data.random_states[t] = 1ull;
+	}
+
+	data.scratch = new float[3u * PARTICLE_CHUNK * data.n_threads];
+
+	// Fill positions, from the list or at random inside the spawn box.
+	if (pDesc->position_list)
+	{
+		for (unsigned i = 0u; i < data.count; i++)
+		{
+			data.x[i] = pDesc->position_list[i].x;
+			data.y[i] = pDesc->position_list[i].y;
+			data.z[i] = pDesc->position_list[i].z;
+		}
+	}
+	else
+	{
+		const Vector3f size = pDesc->spawn_max - pDesc->spawn_min;
+
+		for (unsigned i = 0u; i < data.count; i++)
+		{
+			data.x[i] = pDesc->spawn_min.x + size.x * random(data.random_states);
+			data.y[i] = pDesc->spawn_min.y + size.y * random(data.random_states);
+			data.z[i] = pDesc->spawn_min.z + size.z * random(data.random_states);
+		}
+	}
+
+	// The initial positions are the rest positions.
+	memcpy(data.rest_x, data.x, 3u * data.padded * sizeof(float));
+
+	if (pDesc->velocity_list)
+	{
+		for (unsigned i = 0u; i < data.count; i++)
+		{
+			data.vx[i] = pDesc->velocity_list[i].x;
+			data.vy[i] = pDesc->velocity_list[i].y;
+			data.vz[i] = pDesc->velocity_list[i].z;
+		}
+	}
+
+	if (pDesc->color_list)
+	{
+		data.colors = new Color[data.count];
+		memcpy(data.colors, pDesc->color_list, data.count * sizeof(Color));
+	}
+}
+
+/*
+-----------------------------------------------------------------------------------------------------------
+ User Functions
+-----------------------------------------------------------------------------------------------------------
+*/
+
+// Adds a constant acceleration applied to all particles.
+
+void ParticleSystem::addGravity(Vector3f gravity)
+{
+	USER_CHECK(particleData,
+		"Trying to add a force to an uninitialized ParticleSystem."
+	);
+
+	add_built_in(*(ParticleSystemInternals*)particleData, gravity_kernel, gravity.x, gravity.y, gravity.z);
+}
+
+// Adds a linear drag force, the acceleration is minus the coefficient times the velocity.
+
+void ParticleSystem::addDrag(float coefficient)
+{
+	USER_CHECK(particleData,
+		"Trying to add a force to an uninitialized ParticleSystem."
+	);
+
+	add_built_in(*(ParticleSystemInternals*)particleData, drag_kernel, coefficient, 0.f, 0.f);
+}
+
+// Adds a spring that pulls every particle to its rest position with the stiffness
+// specified, optionally damped proportionally to the particle velocity.
+
+void ParticleSystem::addSprings(float stiffness, float damping)
+{
+	USER_CHECK(particleData,
+		"Trying to add a force to an uninitialized ParticleSystem."
+	);
+
+	add_built_in(*(ParticleSystemInternals*)particleData, spring_kernel, stiffness, damping, 0.f);
+}
+
+// Adds a random acceleration of the amplitude specified in every direction,
+// generated with the per-thread random generators.
+
+void ParticleSystem::addNoise(float amplitude)
+{
+	USER_CHECK(particleData,
+		"Trying to add a force to an uninitialized ParticleSystem."
+	);
+
+	add_built_in(*(ParticleSystemInternals*)particleData, noise_kernel, amplitude, 0.f, 0.f);
+}
+
+// Adds a user defined force kernel, the user data pointer is passed to every call.
+// A maximum of sixteen forces is allowed, built in forces included.
+
+void ParticleSystem::addForce(PARTICLE_FORCE force, void* user_data)
+{
+	USER_CHECK(particleData,
+		"Trying to add a force to an uninitialized ParticleSystem."
+	);
+
+	USER_CHECK(force,
+		"Trying to add an invalid force kernel to a ParticleSystem."
+	);
+
+	ParticleSystemInternals& data = *(ParticleSystemInternals*)particleData;
+
+	USER_CHECK(data.n_forces < MAX_PARTICLE_FORCES,
+		"Trying to add more than sixteen forces to a ParticleSystem."
+	);
+
+	data.forces[data.n_forces++] = { force, user_data };
+}
+
+// Removes all the forces of the system.
+
+void ParticleSystem::clearForces()
+{
+	USER_CHECK(particleData,
+		"Trying to clear the forces of an uninitialized ParticleSystem."
+	);
+
+	ParticleSystemInternals& data = *(ParticleSystemInternals*)particleData;
+
+	data.n_forces = 0u;
+}
+
+// Advances the simulation by the time step specified. Forces are evaluated and the
+// particles integrated with semi-implicit Euler in parallel chunks.
+
+void ParticleSystem::step(float dt)
+{
+	USER_CHECK(particleData,
+		"Trying to step an uninitialized ParticleSystem."
+	);
+
+	ParticleSystemInternals& data = *(ParticleSystemInternals*)particleData;
+
+	ThreadPool::parallelFor(data.count, PARTICLE_CHUNK, [&](unsigned begin, unsigned end, unsigned thread)
+	{
+		// Chunks start at multiples of four, so the padded count stays inside the arrays.
+		const unsigned count = end - begin;
+		const unsigned padded = (count + 3u) & ~3u;
+
+		float* ax = data.scratch + 3u * PARTICLE_CHUNK * thread;
+		float* ay = ax + PARTICLE_CHUNK;
+		float* az = ay + PARTICLE_CHUNK;
+
+		memset(ax, 0, padded * sizeof(float));
+		memset(ay, 0, padded * sizeof(float));
+		memset(az, 0, padded * sizeof(float));
+
+		PARTICLE_SPAN span = {};
+		span.x = data.x + begin;
+		span.y = data.y + begin;
+		span.z = data.z + begin;
+		span.vx = data.vx + begin;
+		span.vy = data.vy + begin;
+		span.vz = data.vz + begin;
+		span.rest_x = data.rest_x + begin;
+		span.rest_y = data.rest_y + begin;
+		span.rest_z = data.rest_z + begin;
+		span.ax = ax;
+		span.ay = ay;
+		span.az = az;
+		span.first = begin;
+		span.count = count;
+		span.dt = dt;
+		span.random_state = &data.random_states[thread];
+
+		for (unsigned f = 0u; f < data.n_forces; f++)
+			data.forces[f].func(span, data.forces[f].user_data);
+
+		integrate_axis(data.x + begin, data.vx + begin, ax, dt, padded);
+		integrate_axis(data.y + begin, data.vy + begin, ay, dt, padded);
+		integrate_axis(data.z + begin, data.vz + begin, az, dt, padded);
+	});
+}
+
+// Writes the current particle positions to the Scatter, that must have been created
+// with updates enabled and a point count equal to the particle count. If specified and
+// the system has colors, they are also written to the point colored Scatter.
+
+void ParticleSystem::upload(Scatter& scatter, bool upload_colors) const
+{
+	USER_CHECK(particleData,
+		"Trying to upload an uninitialized ParticleSystem."
+	);
+
+	ParticleSystemInternals& data = *(ParticleSystemInternals*)particleData;
+
+	scatter.updatePoints(data.x, data.y, data.z, 0u, data.count);
+
+	if (upload_colors)
+	{
+		USER_CHECK(data.colors,
+			"Trying to upload the colors of a ParticleSystem created without a color list."
+		);
+
+		scatter.updateColors(data.colors, 0u, data.count);
+	}
+}
+
+// Returns the number of particles in the system.
+
+unsigned ParticleSystem::getCount() const
+{
+	USER_CHECK(particleData,
+		"Trying to access the count of an uninitialized ParticleSystem."
+	);
+
+	return ((ParticleSystemInternals*)particleData)->count;
+}
+
+// Returns the position of the particle specified.
+
+Vector3f ParticleSystem::getPosition(unsigned index) const
+{
+	USER_CHECK(particleData,
+		"Trying to access a particle of an uninitialized ParticleSystem."
+	);
+
+	ParticleSystemInternals& data = *(ParticleSystemInternals*)particleData;
+
+	USER_CHECK(index < data.count,
+		"Particle index out of bounds when trying to access a particle position."
+	);
+
+	return { data.x[index], data.y[index], data.z[index] };
+}
+
+// Returns the velocity of the particle specified.
+
+Vector3f ParticleSystem::getVelocity(unsigned index) const
+{
+	USER_CHECK(particleData,
+		"Trying to access a particle of an uninitialized ParticleSystem."
+	);
+
+	ParticleSystemInternals& data = *(ParticleSystemInternals*)particleData;
+
+	USER_CHECK(index < data.count,
+		"Particle index out of bounds when trying to access a particle velocity."
+	);
+
+	return { data.vx[index], data.vy[index], data.vz[index] };
+}
+
+// Sets the position and velocity of the particle specified.
+
+void ParticleSystem::setParticle(unsigned index, Vector3f position, Vector3f velocity)
+{
+	USER_CHECK(particleData,
+		"Trying to modify a particle of an uninitialized ParticleSystem."
+	);
+
+	ParticleSystemInternals& data = *(ParticleSystemInternals*)particleData;
+
+	USER_CHECK(index < data.count,
+		"Particle index out of bounds when trying to set a particle."
+	);
+
+	data.x[index] = position.x;
+	data.y[index] = position.y;
+	data.z[index] = position.z;
+
+	data.vx[index] = velocity.x;
+	data.vy[index] = velocity.y;
+	data.vz[index] = velocity.z;
+}
+
+// Sets the color of the particle specified, the system must have been created with colors.
+
+void ParticleSystem::setColor(unsigned index, Color color)
+{
+	USER_CHECK(particleData,
+		"Trying to modify a particle of an uninitialized ParticleSystem."
+	);
+
+	ParticleSystemInternals& data = *(ParticleSystemInternals*)particleData;
+
+	USER_CHECK(data.colors,
+		"Trying to set a particle color on a ParticleSystem created without a color list."
+	);
+
+	USER_CHECK(index < data.count,
+		"Particle index out of bounds when trying to set a particle color."
+	);
+
+	data.colors[index] = color;
+}
+
+// Direct access to the structure of arrays for custom processing, pointers are valid
+// until the system is destroyed. Unused outputs can be set to nullptr.
+
+void ParticleSystem::getArrays(float** x, float** y, float** z, float** vx, float** vy, float** vz, Color** colors)
+{
+	USER_CHECK(particleData,
+		"Trying to access the arrays of an uninitialized ParticleSystem."
+	);
+
+	ParticleSystemInternals& data = *(ParticleSystemInternals*)particleData;
+
+	if (x)	*x = data.x;
+	if (y)	*y = data.y;
+	if (z)	*z = data.z;
+	if (vx) *vx = data.vx;
+	if (vy) *vy = data.vy;
+	if (vz) *vz = data.vz;
+
+	if (colors)
+		*colors = data.colors;
+}
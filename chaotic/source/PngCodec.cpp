@@ -0,0 +1,1521 @@
+#include "PngCodec.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <utility>
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Checksums
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Table of the CRC32 used by the PNG chunks, one byte at a time.
+struct CrcTable
+{
+	uint32_t table[256];
+
+	CrcTable()
+	{
+		for (uint32_t n = 0u; n < 256u; n++)
+		{
+			uint32_t c = n;
+			for (unsigned k = 0u; k < 8u; k++)
+				c = c & 1u ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+	}
+};
+
+static const CrcTable crc_table;
+
+// Updates the CRC32 with the bytes specified.
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t size)
+{
+	crc = ~crc;
+	for (size_t i = 0u; i < size; i++)
+		crc = crc_table.table[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8);
+	return ~crc;
+}
+
+// Computes the Adler32 checksum of the zlib streams. The sums are reduced every 5552
+// bytes, the most that can be added before the 32 bit sums overflow.
+
+static uint32_t adler32(const uint8_t* data, size_t size)
+{
+	uint32_t a = 1u, b = 0u;
+	while (size)
+	{
+		size_t n = size < 5552u ? size : 5552u;
+		size -= n;
+
+		while (n--)
+		{
+			a += *data++;
+			b += a;
+		}
+		a %= 65521u;
+		b %= 65521u;
+	}
+	return (b << 16) | a;
+}
+
+// Big endian helpers for the chunk fields.
+
+static inline uint32_t read_be32(const uint8_t* p)
+{
+	return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static inline void write_be32(uint8_t* p, uint32_t v)
+{
+	p[0] = uint8_t(v >> 24);
+	p[1] = uint8_t(v >> 16);
+	p[2] = uint8_t(v >> 8);
+	p[3] = uint8_t(v);
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Deflate tables
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Base lengths and extra bits of the length symbols 257 to 285.
+static const uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+// Base distances and extra bits of the distance symbols 0 to 29.
+static const uint16_t distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// Order in which the code length code lengths are stored.
+static const uint8_t code_length_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// Lengths of the fixed Huffman codes, literals and lengths followed by distances.
+struct FixedLengths
+{
+	uint8_t literals[288];
+	uint8_t distances[30];
+
+	FixedLengths()
+	{
+		for (unsigned s = 0u; s < 288u; s++)
+			literals[s] = s < 144u ? 8u : s < 256u ? 9u : s < 280u ? 7u : 8u;
+		for (unsigned s = 0u; s < 30u; s++)
+			distances[s] = 5u;
+	}
+};
+
+static const FixedLengths fixed_lengths;
+
+// Reverses the lowest bits of a Huffman code, deflate stores them starting by the top bit.
+
+static inline uint32_t reverse_bits(uint32_t code, unsigned length)
+{
+	uint32_t r = 0u;
+	for (unsigned i = 0u; i < length; i++, code >>= 1)
+		r = (r << 1) | (code & 1u);
+	return r;
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Inflate
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Bits resolved by a single lookup of the Huffman tables, longer codes are decoded
+// canonically from their first length on.
+#define INFLATE_FAST_BITS 10u
+
+// Huffman decoding table, every fast entry stores the symbol and its length.
+struct InflateTable
+{
+	uint16_t fast[1u << INFLATE_FAST_BITS];
+	uint16_t count[16];
+	uint16_t symbols[288];
+
+	// Builds the table from the code lengths, returns false for oversubscribed codes.
+	bool build(const uint8_t* lengths, unsigned n)
+	{
+		memset(count, 0, sizeof(count));
+		memset(fast, 0, sizeof(fast));
+
+		for (unsigned s = 0u; s < n; s++)
+			count[lengths[s]]++;
+		count[0] = 0u;
+
+		int left = 1;
+		for (unsigned l = 1u; l < 16u; l++)
+		{
+			left = 2 * left - count[l];
+			if (left < 0)
+				return false;
+		}
+
+		uint16_t offsets[16];
+		uint32_t next_code[16];
+		offsets[1] = 0u;
+		next_code[1] = 0u;
+		for (unsigned l = 1u; l < 15u; l++)
+		{
+			offsets[l + 1u] = offsets[l] + count[l];
+			next_code[l + 1u] = (next_code[l] + count[l]) << 1;
+		}
+
+		for (unsigned s = 0u; s < n; s++)
+		{
+			const unsigned l = lengths[s];
+			if (!l)
+				continue;
+
+			symbols[offsets[l]++] = uint16_t(s);
+
+			const uint32_t code = next_code[l]++;
+			if (l > INFLATE_FAST_BITS)
+				continue;
+
+			const uint32_t reversed = reverse_bits(code, l);
+			for (uint32_t i = reversed; i < (1u << INFLATE_FAST_BITS); i += 1u << l)
+				fast[i] = uint16_t((s << 4) | l);
+		}
+		return true;
+	}
+};
+
+// Little endian bit reader, reading past the end gives zeros that are counted, so that
+// the caller can detect truncated streams.
+struct BitReader
+{
+	const uint8_t* p;
+	const uint8_t* end;
+	uint64_t bits = 0u;
+	unsigned count = 0u;
+	unsigned padding = 0u;
+
+	BitReader(const uint8_t* data, size_t size) : p{ data }, end{ data + size } {}
+
+	inline void refill()
+	{
+		while (count <= 56u)
+		{
+			uint64_t byte = 0u;
+			if (p < end)
+				byte = *p++;
+			else
+				padding++;
+
+			bits |= byte << count;
+			count += 8u;
+		}
+	}
+
+	inline uint32_t peek(unsigned n) const { return uint32_t(bits & ((1ull << n) - 1u)); }
+
+	inline void consume(unsigned n) { bits >>= n; count -= n; }
+
+	inline uint32_t read(unsigned n)
+	{
+		uint32_t v = peek(n);
+		consume(n);
+		return v;
+	}
+
+	// Whether any of the padding bits has been consumed.
+	inline bool overrun() const { return 8u * padding > count; }
+
+	// Drops the bits up to the next byte and moves the pointer back over the unread bytes.
+	inline void align()
+	{
+		consume(count & 7u);
+		p -= count / 8u - padding;
+		bits = 0u;
+		count = 0u;
+		padding = 0u;
+	}
+
+	// Decodes a symbol, the buffer must hold at least 15 bits.
+	inline int decode(const InflateTable& table)
+	{
+		const uint16_t entry = table.fast[peek(INFLATE_FAST_BITS)];
+		if (entry)
+		{
+			consume(entry & 15u);
+			return entry >> 4;
+		}
+
+		const uint32_t window = peek(15u);
+		int code = 0, first = 0, index = 0;
+		for (unsigned l = 1u; l < 16u; l++)
+		{
+			code |= (window >> (l - 1u)) & 1u;
+			const int n = table.count[l];
+			if (code - n < first)
+			{
+				consume(l);
+				return table.symbols[index + (code - first)];
+			}
+			index += n;
+			first = (first + n) << 1;
+			code <<= 1;
+		}
+		return -1;
+	}
+};
+
+// Inflates a zlib stream into the output, that must have the exact expected size.
+// Returns false if the stream is malformed, truncated or of a different size.
+
+static bool inflate_zlib(const uint8_t* data, size_t size, uint8_t* out, size_t out_size)
+{
+	if (size < 6u || (data[0] & 0x0Fu) != 8u || ((data[0] << 8) | data[1]) % 31u || data[1] & 0x20u)
+		return false;
+
+	static InflateTable fixed_literals, fixed_distances;
+	static const bool fixed_built = fixed_literals.build(fixed_lengths.literals, 288u) && fixed_distances.build(fixed_lengths.distances, 30u);
+	(void)fixed_built;
+
+	InflateTable literals, distances;
+	BitReader reader(data + 2u, size - 2u);
+	size_t pos = 0u;
+
+	bool final = false;
+	while (!final)
+	{
+		reader.refill();
+		final = reader.read(1u);
+		const unsigned type = reader.read(2u);
+
+		if (type == 0u)
+		{
+			if (reader.overrun())
+				return false;
+
+			reader.align();
+			if (reader.end - reader.p < 4)
+				return false;
+
+			const unsigned length = reader.p[0] | (reader.p[1] << 8);
+			const unsigned check = reader.p[2] | (reader.p[3] << 8);
+			reader.p += 4;
+
+			if ((length ^ 0xFFFFu) != check || size_t(reader.end - reader.p) < length || out_size - pos < length)
+				return false;
+
+			memcpy(out + pos, reader.p, length);
+			reader.p += length;
+			pos += length;
+			continue;
+		}
+
+		const InflateTable* lit = &fixed_literals;
+		const InflateTable* dist = &fixed_distances;
+
+		if (type == 2u)
+		{
+			const unsigned n_literals = reader.read(5u) + 257u;
+			const unsigned n_distances = reader.read(5u) + 1u;
+			const unsigned n_lengths = reader.read(4u) + 4u;
+
+			uint8_t code_lengths[19] = {};
+			reader.refill();
+			for (unsigned i = 0u; i < n_lengths; i++)
+				code_lengths[code_length_order[i]] = uint8_t(reader.read(3u));
+
+			InflateTable lengths_table;
+			if (n_literals > 286u || n_distances > 30u || !lengths_table.build(code_lengths, 19u))
+				return false;
+
+			uint8_t lengths[286 + 30];
+			unsigned n = 0u;
+			while (n < n_literals + n_distances)
+			{
+				reader.refill();
+				const int symbol = reader.decode(lengths_table);
+				if (symbol < 0)
+					return false;
+
+				if (symbol < 16)
+				{
+					lengths[n++] = uint8_t(symbol);
+					continue;
+				}
+
+				uint8_t value = 0u;
+				unsigned repeat;
+				if (symbol == 16)
+				{
+					if (!n)
+						return false;
+					value = lengths[n - 1u];
+					repeat = 3u + reader.read(2u);
+				}
+				else if (symbol == 17)
+					repeat = 3u + reader.read(3u);
+				else
+					repeat = 11u + reader.read(7u);
+
+				if (n + repeat > n_literals + n_distances)
+					return false;
+
+				while (repeat--)
+					lengths[n++] = value;
+			}
+
+			if (!lengths[256] || !literals.build(lengths, n_literals) || !distances.build(lengths + n_literals, n_distances))
+				return false;
+
+			lit = &literals;
+			dist = &distances;
+		}
+		else if (type != 1u)
+			return false;
+
+		for (;;)
+		{
+			reader.refill();
+			const int symbol = reader.decode(*lit);
+
+			if (symbol < 256)
+			{
+				if (symbol < 0 || pos == out_size)
+					return false;
+				out[pos++] = uint8_t(symbol);
+				continue;
+			}
+			if (symbol == 256)
+				break;
+			if (symbol > 285)
+				return false;
+
+			const unsigned length = length_base[symbol - 257] + reader.read(length_extra[symbol - 257]);
+
+			const int distance_symbol = reader.decode(*dist);
+			if (distance_symbol < 0 || distance_symbol > 29)
+				return false;
+
+			const size_t distance = distance_base[distance_symbol] + reader.read(distance_extra[distance_symbol]);
+			if (distance > pos || out_size - pos < length)
+				return false;
+
+			uint8_t* to = out + pos;
+			const uint8_t* from = to - distance;
+			if (distance >= length)
+				memcpy(to, from, length);
+			else
+				for (unsigned i = 0u; i < length; i++)
+					to[i] = from[i];
+			pos += length;
+		}
+
+		if (reader.overrun())
+			return false;
+	}
+
+	if (reader.overrun())
+		return false;
+
+	reader.align();
+	if (reader.end - reader.p < 4 || pos != out_size)
+		return false;
+
+	return read_be32(reader.p) == adler32(out, out_size);
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Deflate
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Input bytes compressed independently by every task, tokens per Huffman block and size
+// of the hash table of the match finder.
+#define DEFLATE_CHUNK (1u << 20)
+#define DEFLATE_BLOCK_TOKENS (1u << 15)
+#define DEFLATE_HASH_BITS 15u
+#define DEFLATE_WINDOW 32768u
+
+// Match finder settings of every compression level, as in zlib.
+struct DeflateLevel
+{
+	unsigned lazy;		// Matches shorter than this look for a longer one on the next byte.
+	unsigned nice;		// Matches this long stop the search.
+	unsigned chain;		// Maximum number of positions visited per search.
+};
+
+static const DeflateLevel deflate_levels[10] =
+{
+	{ 0u, 0u, 0u },
+	{ 0u, 8u, 4u },
+	{ 0u, 16u, 8u },
+	{ 0u, 32u, 32u },
+	{ 4u, 16u, 16u },
+	{ 16u, 32u, 32u },
+	{ 16u, 128u, 128u },
+	{ 32u, 128u, 256u },
+	{ 128u, 258u, 1024u },
+	{ 258u, 258u, 4096u },
+};
+
+// Little endian bit writer into a byte vector.
+struct BitWriter
+{
+	std::vector<uint8_t>& out;
+	uint64_t bits = 0u;
+	unsigned count = 0u;
+
+	BitWriter(std::vector<uint8_t>& output) : out{ output } {}
+
+	inline void write(uint32_t value, unsigned n)
+	{
+		bits |= uint64_t(value) << count;
+		count += n;
+		if (count >= 32u)
+		{
+			const uint8_t bytes[4] = { uint8_t(bits), uint8_t(bits >> 8), uint8_t(bits >> 16), uint8_t(bits >> 24) };
+			out.insert(out.end(), bytes, bytes + 4);
+			bits >>= 32;
+			count -= 32u;
+		}
+	}
+
+	// Writes the pending bits, padding the last byte with zeros.
+	inline void flush()
+	{
+		while (count > 0u)
+		{
+			out.push_back(uint8_t(bits));
+			bits >>= 8;
+			count = count > 8u ? count - 8u : 0u;
+		}
+		bits = 0u;
+	}
+};
+
+// LZ77 token, a literal if the distance is zero.
+struct DeflateToken
+{
+	uint16_t value;
+	uint16_t distance;
+};
+
+// Returns the length symbol of a match length.
+
+static inline unsigned length_symbol(unsigned length)
+{
+	unsigned s = 0u;
+	while (s < 28u && length_base[s + 1u] <= length)
+		s++;
+	return s;
+}
+
+// Returns the distance symbol of a match distance.
+
+static inline unsigned distance_symbol(unsigned distance)
+{
+	unsigned s = 0u;
+	while (s < 29u && distance_base[s + 1u] <= distance)
+		s++;
+	return s;
+}
+
+// Lookup tables of the length and distance symbols.
+struct SymbolTables
+{
+	uint8_t length[259];
+	uint8_t distance_low[257];
+	uint8_t distance_high[256];
+
+	SymbolTables()
+	{
+		for (unsigned l = 3u; l < 259u; l++)
+			length[l] = uint8_t(length_symbol(l));
+		for (unsigned d = 1u; d < 257u; d++)
+			distance_low[d] = uint8_t(distance_symbol(d));
+		for (unsigned i = 0u; i < 256u; i++)
+			distance_high[i] = uint8_t(distance_symbol((i << 7) + 1u));
+	}
+
+	inline unsigned distanceSymbol(unsigned d) const { return d <= 256u ? distance_low[d] : distance_high[(d - 1u) >> 7]; }
+};
+
+static const SymbolTables symbol_tables;
+
+// Computes the Huffman code lengths of the frequencies, limited to the maximum length.
+// Lengths that go over the limit are moved to it and the shortest codes are split to
+// restore a complete code. A single used symbol gets a sibling, so the code is complete.
+
+static void huffman_lengths(const uint32_t* frequencies, unsigned n, unsigned max_length, uint8_t* lengths)
+{
+	memset(lengths, 0, n);
+
+	std::vector<unsigned> used;
+	for (unsigned s = 0u; s < n; s++)
+		if (frequencies[s])
+			used.push_back(s);
+
+	if (used.empty())
+		return;
+	if (used.size() == 1u)
+	{
+		lengths[used[0]] = 1u;
+		lengths[used[0] ? 0u : 1u] = 1u;
+		return;
+	}
+
+	// Huffman tree over the used symbols, leaves first and internal nodes after them.
+	const unsigned leaves = unsigned(used.size());
+	std::vector<unsigned> parent(2u * leaves - 1u);
+
+	typedef std::pair<uint64_t, unsigned> Node;
+	std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+	for (unsigned i = 0u; i < leaves; i++)
+		queue.push({ frequencies[used[i]], i });
+
+	unsigned next = leaves;
+	while (queue.size() > 1u)
+	{
+		Node a = queue.top(); queue.pop();
+		Node b = queue.top(); queue.pop();
+		parent[a.second] = next;
+		parent[b.second] = next;
+		queue.push({ a.first + b.first, next++ });
+	}
+
+	std::vector<unsigned> depth(2u * leaves - 1u, 0u);
+	for (unsigned i = next - 1u; i-- > 0u;)
+		depth[i] = depth[parent[i]] + 1u;
+
+	// Count the codes per length, clamping them to the limit, and fix the Kraft sum.
+	unsigned counts[33] = {};
+	for (unsigned i = 0u; i < leaves; i++)
+		counts[depth[i] < max_length ? depth[i] : max_length]++;
+
+	uint32_t total = 0u;
+	for (unsigned l = 1u; l <= max_length; l++)
+		total += counts[l] << (max_length - l);
+
+	while (total > (1u << max_length))
+	{
+		counts[max_length]--;
+		for (unsigned l = max_length - 1u; l > 0u; l--)
+			if (counts[l])
+			{
+				counts[l]--;
+				counts[l + 1u] += 2u;
+				break;
+			}
+		total--;
+	}
+
+	// The most frequent symbols get the shortest lengths.
+	std::stable_sort(used.begin(), used.end(), [&](unsigned a, unsigned b) { return frequencies[a] > frequencies[b]; });
+
+	unsigned index = 0u;
+	for (unsigned l = 1u; l <= max_length; l++)
+		for (unsigned c = 0u; c < counts[l]; c++)
+			lengths[used[index++]] = uint8_t(l);
+}
+
+// Computes the canonical codes of the lengths, already reversed for the bit writer.
+
+static void huffman_codes(const uint8_t* lengths, unsigned n, uint16_t* codes)
+{
+	unsigned counts[16] = {};
+	for (unsigned s = 0u; s < n; s++)
+		counts[lengths[s]]++;
+	counts[0] = 0u;
+
+	uint32_t next_code[16] = {};
+	for (unsigned l = 1u; l < 16u; l++)
+		next_code[l] = (next_code[l - 1u] + counts[l - 1u]) << 1;
+
+	for (unsigned s = 0u; s < n; s++)
+		codes[s] = lengths[s] ? uint16_t(reverse_bits(next_code[lengths[s]]++, lengths[s])) : 0u;
+}
+
+// Writes the stored blocks of the bytes specified, none of them final.
+
+static void write_stored(BitWriter& writer, const uint8_t* data, size_t size, bool final)
+{
+	do
+	{
+		const unsigned length = size < 65535u ? unsigned(size) : 65535u;
+		size -= length;
+
+		writer.write(final && !size ? 1u : 0u, 1u);
+		writer.write(0u, 2u);
+		writer.flush();
+
+		writer.write(length | ((length ^ 0xFFFFu) << 16), 32u);
+		writer.out.insert(writer.out.end(), data, data + length);
+		data += length;
+	}
+	while (size);
+}
+
+// Writes a block of tokens with whichever encoding is smaller, dynamic Huffman codes,
+// the fixed codes or stored bytes, the tokens cover the input bytes given.
+
+static void write_block(BitWriter& writer, const DeflateToken* tokens, unsigned token_count, const uint8_t* data, size_t size, bool final)
+{
+	uint32_t literal_freq[286] = {};
+	uint32_t distance_freq[30] = {};
+
+	for (unsigned i = 0u; i < token_count; i++)
+	{
+		if (!tokens[i].distance)
+			literal_freq[tokens[i].value]++;
+		else
+		{
+			literal_freq[257u + symbol_tables.length[tokens[i].value]]++;
+			distance_freq[symbol_tables.distanceSymbol(tokens[i].distance)]++;
+		}
+	}
+	literal_freq[256]++;
+
+	uint8_t literal_lengths[286], distance_lengths[30];
+	huffman_lengths(literal_freq, 286u, 15u, literal_lengths);
+	huffman_lengths(distance_freq, 30u, 15u, distance_lengths);
+
+	unsigned n_literals = 286u, n_distances = 30u;
+	while (n_literals > 257u && !literal_lengths[n_literals - 1u])
+		n_literals--;
+	while (n_distances > 1u && !distance_lengths[n_distances - 1u])
+		n_distances--;
+
+	// Run length encoding of the code lengths, with the repeat value in the top byte.
+	uint8_t all_lengths[286 + 30];
+	memcpy(all_lengths, literal_lengths, n_literals);
+	memcpy(all_lengths + n_literals, distance_lengths, n_distances);
+	const unsigned n_all = n_literals + n_distances;
+
+	std::vector<uint16_t> runs;
+	uint32_t length_freq[19] = {};
+	for (unsigned i = 0u; i < n_all;)
+	{
+		const uint8_t value = all_lengths[i];
+		unsigned run = 1u;
+		while (i + run < n_all && all_lengths[i + run] == value)
+			run++;
+		i += run;
+
+		if (!value)
+		{
+			while (run >= 3u)
+			{
+				const unsigned r = run < 138u ? run : 138u;
+				runs.push_back(r <= 10u ? uint16_t(17u | ((r - 3u) << 8)) : uint16_t(18u | ((r - 11u) << 8)));
+				length_freq[r <= 10u ? 17u : 18u]++;
+				run -= r;
+			}
+		}
+		else
+		{
+			runs.push_back(value);
+			length_freq[value]++;
+			run--;
+			while (run >= 3u)
+			{
+				const unsigned r = run < 6u ? run : 6u;
+				runs.push_back(uint16_t(16u | ((r - 3u) << 8)));
+				length_freq[16]++;
+				run -= r;
+			}
+		}
+		while (run--)
+		{
+			runs.push_back(value);
+			length_freq[value]++;
+		}
+	}
+
+	uint8_t code_lengths[19];
+	huffman_lengths(length_freq, 19u, 7u, code_lengths);
+
+	unsigned n_lengths = 19u;
+	while (n_lengths > 4u && !code_lengths[code_length_order[n_lengths - 1u]])
+		n_lengths--;
+
+	// Sizes in bits of the three encodings.
+	uint64_t dynamic_bits = 3u + 14u + 3u * n_lengths;
+	uint64_t fixed_bits = 3u;
+	for (unsigned s = 0u; s < 19u; s++)
+		dynamic_bits += uint64_t(length_freq[s]) * (code_lengths[s] + (s == 16u ? 2u : s == 17u ? 3u : s == 18u ? 7u : 0u));
+	for (unsigned s = 0u; s < 286u; s++)
+	{
+		const unsigned extra = s > 256u ? length_extra[s - 257u] : 0u;
+		dynamic_bits += uint64_t(literal_freq[s]) * (literal_lengths[s] + extra);
+		fixed_bits += uint64_t(literal_freq[s]) * (fixed_lengths.literals[s] + extra);
+	}
+	for (unsigned s = 0u; s < 30u; s++)
+	{
+		dynamic_bits += uint64_t(distance_freq[s]) * (distance_lengths[s] + distance_extra[s]);
+		fixed_bits += uint64_t(distance_freq[s]) * (5u + distance_extra[s]);
+	}
+	const uint64_t stored_bits = 8u * (size + 5u * ((size + 65534u) / 65535u + !size)) + 7u;
+
+	if (stored_bits <= dynamic_bits && stored_bits <= fixed_bits)
+	{
+		write_stored(writer, data, size, final);
+		return;
+	}
+
+	const uint8_t* lit_lengths = literal_lengths;
+	const uint8_t* dist_lengths = distance_lengths;
+
+	writer.write(final ? 1u : 0u, 1u);
+	if (fixed_bits < dynamic_bits)
+	{
+		writer.write(1u, 2u);
+		lit_lengths = fixed_lengths.literals;
+		dist_lengths = fixed_lengths.distances;
+	}
+	else
+	{
+		writer.write(2u, 2u);
+		writer.write(n_literals - 257u, 5u);
+		writer.write(n_distances - 1u, 5u);
+		writer.write(n_lengths - 4u, 4u);
+		for (unsigned i = 0u; i < n_lengths; i++)
+			writer.write(code_lengths[code_length_order[i]], 3u);
+
+		uint16_t length_codes[19];
+		huffman_codes(code_lengths, 19u, length_codes);
+
+		for (uint16_t run : runs)
+		{
+			const unsigned symbol = run & 0xFFu;
+			writer.write(length_codes[symbol], code_lengths[symbol]);
+			if (symbol >= 16u)
+				writer.write(run >> 8, symbol == 16u ? 2u : symbol == 17u ? 3u : 7u);
+		}
+	}
+
+	uint16_t literal_codes[288], distance_codes[30];
+	huffman_codes(lit_lengths, lit_lengths == literal_lengths ? 286u : 288u, literal_codes);
+	huffman_codes(dist_lengths, 30u, distance_codes);
+
+	for (unsigned i = 0u; i < token_count; i++)
+	{
+		const DeflateToken& t = tokens[i];
+		if (!t.distance)
+		{
+			writer.write(literal_codes[t.value], lit_lengths[t.value]);
+			continue;
+		}
+
+		const unsigned ls = symbol_tables.length[t.value];
+		writer.write(literal_codes[257u + ls], lit_lengths[257u + ls]);
+		writer.write(t.value - length_base[ls], length_extra[ls]);
+
+		const unsigned ds = symbol_tables.distanceSymbol(t.distance);
+		writer.write(distance_codes[ds], dist_lengths[ds]);
+		writer.write(t.distance - distance_base[ds], distance_extra[ds]);
+	}
+	writer.write(literal_codes[256], lit_lengths[256]);
+}
+
+// Hash of the three bytes starting at the position.
+
+static inline uint32_t deflate_hash(const uint8_t* p)
+{
+	const uint32_t v = uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16);
+	return (v * 2654435761u) >> (32u - DEFLATE_HASH_BITS);
+}
+
+// Compresses a chunk of data on its own. Chunks that are not the last one end with an
+// empty stored block, so that the next chunk starts on a byte boundary.
+
+static void deflate_chunk(const uint8_t* data, size_t size, unsigned level, bool last, std::vector<uint8_t>& out)
+{
+	BitWriter writer(out);
+
+	if (!level)
+	{
+		write_stored(writer, data, size, last);
+		if (!last)
+			write_stored(writer, data, 0u, false);
+		writer.flush();
+		return;
+	}
+
+	const DeflateLevel& settings = deflate_levels[level];
+
+	std::vector<int32_t> head(1u << DEFLATE_HASH_BITS, -1);
+	std::vector<int32_t> prev(size);
+	std::vector<DeflateToken> tokens;
+	tokens.reserve(DEFLATE_BLOCK_TOKENS + 1u);
+
+	auto insert = [&](size_t pos)
+	{
+		if (pos + 3u > size)
+			return;
+		const uint32_t h = deflate_hash(data + pos);
+		prev[pos] = head[h];
+		head[h] = int32_t(pos);
+	};
+
+	// Longest match at the position among the previous ones with the same hash.
+	auto find_match = [&](size_t pos, unsigned& distance) -> unsigned
+	{
+		if (pos + 3u > size)
+			return 0u;
+
+		const unsigned max_length = size - pos < 258u ? unsigned(size - pos) : 258u;
+		const uint8_t* current = data + pos;
+
+		unsigned best = 0u;
+		unsigned chain = settings.chain;
+		for (int32_t candidate = head[deflate_hash(current)]; candidate >= 0 && chain--; candidate = prev[candidate])
+		{
+			if (pos - size_t(candidate) > DEFLATE_WINDOW)
+				break;
+
+			const uint8_t* match = data + candidate;
+			if (match[best] != current[best] || match[0] != current[0] || match[1] != current[1])
+				continue;
+
+			unsigned length = 0u;
+			while (length + 8u <= max_length)
+			{
+				uint64_t a, b;
+				memcpy(&a, match + length, 8u);
+				memcpy(&b, current + length, 8u);
+				if (a != b)
+				{
+					uint64_t x = a ^ b;
+					while (!(x & 0xFFu))
+					{
+						x >>= 8;
+						length++;
+					}
+					break;
+				}
+				length += 8u;
+			}
+			if (length + 8u > max_length)
+				while (length < max_length && match[length] == current[length])
+					length++;
+
+			if (length > best)
+			{
+				best = length;
+				distance = unsigned(pos - candidate);
+				if (best >= settings.nice || best == max_length)
+					break;
+			}
+		}
+		return best >= 3u ? best : 0u;
+	};
+
+	size_t block_start = 0u;
+	auto emit_block = [&](size_t block_end, bool final)
+	{
+		write_block(writer, tokens.data(), unsigned(tokens.size()), data + block_start, block_end - block_start, final);
+		tokens.clear();
+		block_start = block_end;
+	};
+
+	size_t pos = 0u;
+	while (pos < size)
+	{
+		unsigned distance = 0u;
+		unsigned length = find_match(pos, distance);
+		insert(pos);
+
+		// Lazy matching, a longer match on the next byte turns this one into a literal.
+		while (length && length < settings.lazy && pos + 1u < size)
+		{
+			unsigned next_distance = 0u;
+			const unsigned next_length = find_match(pos + 1u, next_distance);
+			if (next_length <= length)
+				break;
+
+			tokens.push_back({ data[pos], 0u });
+			pos++;
+			insert(pos);
+			length = next_length;
+			distance = next_distance;
+		}
+
+		if (length)
+		{
+			tokens.push_back({ uint16_t(length), uint16_t(distance) });
+			for (size_t i = pos + 1u; i < pos + length; i++)
+				insert(i);
+			pos += length;
+		}
+		else
+			tokens.push_back({ data[pos++], 0u });
+
+		if (tokens.size() >= DEFLATE_BLOCK_TOKENS)
+			emit_block(pos, last && pos == size);
+	}
+
+	if (!tokens.empty() || (last && !size) || block_start < size)
+		emit_block(size, last);
+
+	if (!last)
+		write_stored(writer, data, 0u, false);
+	writer.flush();
+}
+
+// Compresses the data into a zlib stream, the chunks are compressed in parallel.
+
+static void deflate_zlib(const uint8_t* data, size_t size, unsigned level, std::vector<uint8_t>& out)
+{
+	const unsigned chunk_count = size ? unsigned((size + DEFLATE_CHUNK - 1u) / DEFLATE_CHUNK) : 1u;
+	std::vector<std::vector<uint8_t>> chunks(chunk_count);
+
+	ThreadPool::parallelFor(chunk_count, 1u, [&](unsigned begin, unsigned end, unsigned)
+	{
+		for (unsigned c = begin; c < end; c++)
+		{
+			const size_t start = size_t(c) * DEFLATE_CHUNK;
+			const size_t length = size - start < DEFLATE_CHUNK ? size - start : DEFLATE_CHUNK;
+			deflate_chunk(data + start, length, level, c + 1u == chunk_count, chunks[c]);
+		}
+	});
+
+	// Header with the level hint, the checksum goes at the end.
+	const uint8_t flags = level < 2u ? 0x01u : level < 6u ? 0x5Eu : level == 6u ? 0x9Cu : 0xDAu;
+	out.push_back(0x78u);
+	out.push_back(flags);
+
+	for (const std::vector<uint8_t>& chunk : chunks)
+		out.insert(out.end(), chunk.begin(), chunk.end());
+
+	uint8_t checksum[4];
+	write_be32(checksum, adler32(data, size));
+	out.insert(out.end(), checksum, checksum + 4);
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ PNG Decoding
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Starting position and step of every Adam7 interlacing pass.
+static const unsigned adam7_x[7] = { 0, 4, 0, 2, 0, 1, 0 };
+static const unsigned adam7_y[7] = { 0, 0, 4, 0, 2, 0, 1 };
+static const unsigned adam7_dx[7] = { 8, 8, 4, 4, 2, 2, 1 };
+static const unsigned adam7_dy[7] = { 8, 8, 8, 4, 4, 2, 2 };
+
+// Paeth predictor of the PNG filters.
+
+static inline uint8_t paeth(int a, int b, int c)
+{
+	const int p = a + b - c;
+	const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	return uint8_t(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+// Reverses the filter of a row in place, the previous row is null for the first one.
+
+static bool unfilter_row(uint8_t filter, uint8_t* row, const uint8_t* prev, size_t length, unsigned bpp)
+{
+	switch (filter)
+	{
+	case 0u:
+		return true;
+
+	case 1u:
+		for (size_t i = bpp; i < length; i++)
+			row[i] = uint8_t(row[i] + row[i - bpp]);
+		return true;
+
+	case 2u:
+		if (prev)
+			for (size_t i = 0u; i < length; i++)
+				row[i] = uint8_t(row[i] + prev[i]);
+		return true;
+
+	case 3u:
+		for (size_t i = 0u; i < length; i++)
+		{
+			const unsigned left = i >= bpp ? row[i - bpp] : 0u;
+			const unsigned up = prev ? prev[i] : 0u;
+			row[i] = uint8_t(row[i] + ((left + up) >> 1));
+		}
+		return true;
+
+	case 4u:
+		for (size_t i = 0u; i < length; i++)
+		{
+			const int left = i >= bpp ? row[i - bpp] : 0;
+			const int up = prev ? prev[i] : 0;
+			const int corner = prev && i >= bpp ? prev[i - bpp] : 0;
+			row[i] = uint8_t(row[i] + paeth(left, up, corner));
+		}
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+// Format of the image being decoded.
+struct PngHeader
+{
+	unsigned width;
+	unsigned height;
+	unsigned depth;
+	unsigned color_type;
+	unsigned channels;
+	bool interlaced;
+
+	Color palette[256];
+	unsigned palette_size = 0u;
+
+	// Transparent sample values of gray and RGB images.
+	bool has_key = false;
+	uint16_t key[3] = {};
+};
+
+// Converts a row of unfiltered samples to colors, writing every pixel with the step given.
+
+static void convert_row(const PngHeader& png, const uint8_t* row, unsigned count, Color* out, unsigned step)
+{
+	const unsigned depth = png.depth;
+	const unsigned channels = png.channels;
+
+	// Common formats first.
+	if (depth == 8u && !png.has_key && (png.color_type == 6u || png.color_type == 2u))
+	{
+		if (channels == 4u)
+			for (unsigned x = 0u; x < count; x++, row += 4)
+				out[x * step] = Color(row[0], row[1], row[2], row[3]);
+		else
+			for (unsigned x = 0u; x < count; x++, row += 3)
+				out[x * step] = Color(row[0], row[1], row[2]);
+		return;
+	}
+
+	// Returns the sample of the channel specified with its full precision.
+	auto sample = [&](unsigned x, unsigned c) -> unsigned
+	{
+		const unsigned index = x * channels + c;
+		if (depth == 8u)
+			return row[index];
+		if (depth == 16u)
+			return (unsigned(row[2u * index]) << 8) | row[2u * index + 1u];
+
+		const unsigned bit = index * depth;
+		return (row[bit >> 3] >> (8u - depth - (bit & 7u))) & ((1u << depth) - 1u);
+	};
+
+	// Scales a sample to a byte.
+	auto to_byte = [&](unsigned v) -> uint8_t
+	{
+		if (depth == 16u)
+			return uint8_t(v >> 8);
+		if (depth == 8u)
+			return uint8_t(v);
+		return uint8_t(v * 255u / ((1u << depth) - 1u));
+	};
+
+	for (unsigned x = 0u; x < count; x++)
+	{
+		Color& color = out[x * step];
+		switch (png.color_type)
+		{
+		case 0u:
+		{
+			const unsigned g = sample(x, 0u);
+			const uint8_t v = to_byte(g);
+			color = Color(v, v, v, png.has_key && g == png.key[0] ? 0u : 255u);
+			break;
+		}
+		case 2u:
+		{
+			const unsigned r = sample(x, 0u), g = sample(x, 1u), b = sample(x, 2u);
+			const bool transparent = png.has_key && r == png.key[0] && g == png.key[1] && b == png.key[2];
+			color = Color(to_byte(r), to_byte(g), to_byte(b), transparent ? 0u : 255u);
+			break;
+		}
+		case 3u:
+		{
+			const unsigned index = sample(x, 0u);
+			color = index < png.palette_size ? png.palette[index] : Color(0u, 0u, 0u, 255u);
+			break;
+		}
+		case 4u:
+		{
+			const uint8_t v = to_byte(sample(x, 0u));
+			color = Color(v, v, v, to_byte(sample(x, 1u)));
+			break;
+		}
+		default:
+			color = Color(to_byte(sample(x, 0u)), to_byte(sample(x, 1u)), to_byte(sample(x, 2u)), to_byte(sample(x, 3u)));
+			break;
+		}
+	}
+}
+
+// Whether the data starts with the PNG signature.
+
+bool PngCodec::isPng(const void* data, unsigned long long size)
+{
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+	return data && size >= 8u && !memcmp(data, signature, 8u);
+}
+
+// Decodes the PNG file data into the image. Returns false if the data is not a valid 
+// PNG file, in which case the image is left unchanged.
+
+bool PngCodec::decode(const void* file_data, unsigned long long size, Image* pImage)
+{
+	if (!isPng(file_data, size))
+		return false;
+
+	const uint8_t* data = (const uint8_t*)file_data;
+	const uint8_t* end = data + size;
+	const uint8_t* p = data + 8u;
+
+	PngHeader png = {};
+	bool has_header = false;
+
+	// The compressed data is used in place if it comes in a single chunk.
+	const uint8_t* stream = nullptr;
+	size_t stream_size = 0u;
+	std::vector<uint8_t> joined;
+	unsigned idat_count = 0u;
+
+	while (end - p >= 12)
+	{
+		const uint32_t length = read_be32(p);
+		const uint8_t* type = p + 4;
+		const uint8_t* chunk = p + 8;
+		if (length > size_t(end - chunk) - 4u)
+			return false;
+		p = chunk + length + 4;
+
+		if (!memcmp(type, "IHDR", 4u))
+		{
+			if (length < 13u)
+				return false;
+
+			png.width = read_be32(chunk);
+			png.height = read_be32(chunk + 4);
+			png.depth = chunk[8];
+			png.color_type = chunk[9];
+			png.interlaced = chunk[12] == 1u;
+
+			static const unsigned channels[7] = { 1u, 0u, 3u, 1u, 2u, 0u, 4u };
+			png.channels = png.color_type < 7u ? channels[png.color_type] : 0u;
+
+			const unsigned d = png.depth;
+			const bool valid_depth =
+				png.color_type == 0u ? d == 1u || d == 2u || d == 4u || d == 8u || d == 16u :
+				png.color_type == 3u ? d == 1u || d == 2u || d == 4u || d == 8u :
+				d == 8u || d == 16u;
+
+			if (!png.width || !png.height || !png.channels || !valid_depth || chunk[10] || chunk[11] || chunk[12] > 1u)
+				return false;
+
+			if (uint64_t(png.width) * png.height > 0x3FFFFFFFull)
+				return false;
+
+			has_header = true;
+		}
+		else if (!memcmp(type, "PLTE", 4u))
+		{
+			png.palette_size = length / 3u < 256u ? length / 3u : 256u;
+			for (unsigned i = 0u; i < png.palette_size; i++)
+				png.palette[i] = Color(chunk[3u * i], chunk[3u * i + 1u], chunk[3u * i + 2u]);
+		}
+		else if (!memcmp(type, "tRNS", 4u))
+		{
+			if (png.color_type == 3u)
+			{
+				for (unsigned i = 0u; i < length && i < png.palette_size; i++)
+					png.palette[i].A = chunk[i];
+			}
+			else if (png.color_type == 0u && length >= 2u)
+			{
+				png.has_key = true;
+				png.key[0] = uint16_t((chunk[0] << 8) | chunk[1]);
+			}
+			else if (png.color_type == 2u && length >= 6u)
+			{
+				png.has_key = true;
+				for (unsigned c = 0u; c < 3u; c++)
+					png.key[c] = uint16_t((chunk[2u * c] << 8) | chunk[2u * c + 1u]);
+			}
+		}
+		else if (!memcmp(type, "IDAT", 4u))
+		{
+			if (!idat_count++)
+			{
+				stream = chunk;
+				stream_size = length;
+			}
+			else
+			{
+				if (idat_count == 2u)
+					joined.assign(stream, stream + stream_size);
+				joined.insert(joined.end(), chunk, chunk + length);
+			}
+		}
+		else if (!memcmp(type, "IEND", 4u))
+			break;
+	}
+
+	if (!has_header || !idat_count || (png.color_type == 3u && !png.palette_size))
+		return false;
+
+	if (idat_count > 1u)
+	{
+		stream = joined.data();
+		stream_size = joined.size();
+	}
+
+	const unsigned bits_per_pixel = png.depth * png.channels;
+	const unsigned bpp = bits_per_pixel < 8u ? 1u : bits_per_pixel / 8u;
+	auto row_bytes = [&](unsigned width) { return (size_t(width) * bits_per_pixel + 7u) / 8u; };
+
+	// Size of the filtered data, one filter byte per row of every pass.
+	size_t raw_size = 0u;
+	if (!png.interlaced)
+		raw_size = png.height * (row_bytes(png.width) + 1u);
+	else
+		for (unsigned pass = 0u; pass < 7u; pass++)
+		{
+			const unsigned pw = (png.width - adam7_x[pass] + adam7_dx[pass] - 1u) / adam7_dx[pass];
+			const unsigned ph = (png.height - adam7_y[pass] + adam7_dy[pass] - 1u) / adam7_dy[pass];
+			if (png.width > adam7_x[pass] && png.height > adam7_y[pass])
+				raw_size += ph * (row_bytes(pw) + 1u);
+		}
+
+	uint8_t* raw = (uint8_t*)malloc(raw_size);
+	if (!raw)
+		return false;
+
+	if (!inflate_zlib(stream, stream_size, raw, raw_size))
+	{
+		free(raw);
+		return false;
+	}
+
+	// Decoded into a new image that only replaces the output if the file is valid.
+	Image image(png.width, png.height);
+	Color* pixels = image.pixels();
+
+	bool valid = true;
+	if (!png.interlaced)
+	{
+		// Rows are unfiltered in order and converted in parallel afterwards.
+		const size_t stride = row_bytes(png.width) + 1u;
+		for (unsigned y = 0u; y < png.height && valid; y++)
+		{
+			uint8_t* row = raw + y * stride;
+			valid = unfilter_row(row[0], row + 1, y ? row + 1 - stride : nullptr, stride - 1u, bpp);
+		}
+
+		if (valid)
+			ThreadPool::parallelFor(png.height, 64u, [&](unsigned begin, unsigned end, unsigned)
+			{
+				for (unsigned y = begin; y < end; y++)
+					convert_row(png, raw + y * stride + 1u, png.width, pixels + size_t(y) * png.width, 1u);
+			});
+	}
+	else
+	{
+		uint8_t* pass_data = raw;
+		for (unsigned pass = 0u; pass < 7u && valid; pass++)
+		{
+			if (png.width <= adam7_x[pass] || png.height <= adam7_y[pass])
+				continue;
+
+			const unsigned pw = (png.width - adam7_x[pass] + adam7_dx[pass] - 1u) / adam7_dx[pass];
+			const unsigned ph = (png.height - adam7_y[pass] + adam7_dy[pass] - 1u) / adam7_dy[pass];
+			const size_t stride = row_bytes(pw) + 1u;
+
+			for (unsigned y = 0u; y < ph; y++)
+			{
+				uint8_t* row = pass_data + y * stride;
+				valid = unfilter_row(row[0], row + 1, y ? row + 1 - stride : nullptr, stride - 1u, bpp);
+
+				// Rows with an unknown filter are not converted, the whole file is rejected.
+				if (!valid)
+					break;
+
+				const unsigned out_y = adam7_y[pass] + y * adam7_dy[pass];
+				convert_row(png, row + 1, pw, pixels + size_t(out_y) * png.width + adam7_x[pass], adam7_dx[pass]);
+			}
+			pass_data += ph * stride;
+		}
+	}
+
+	free(raw);
+
+	if (!valid)
+		return false;
+
+	*pImage = std::move(image);
+	return true;
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ PNG Encoding
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Appends a chunk with its length and checksum to the file.
+
+static void write_chunk(std::vector<uint8_t>& file, const char* type, const uint8_t* data, size_t length)
+{
+	uint8_t field[4];
+	write_be32(field, uint32_t(length));
+	file.insert(file.end(), field, field + 4);
+
+	const size_t start = file.size();
+	file.insert(file.end(), type, type + 4);
+	if (length)
+		file.insert(file.end(), data, data + length);
+
+	write_be32(field, crc32_update(0u, file.data() + start, length + 4u));
+	file.insert(file.end(), field, field + 4);
+}
+
+// Encodes the pixels as a PNG file with the compression level specified, from 0 to 9.
+// The file data is allocated with malloc() and must be freed by the caller.
+
+bool PngCodec::encode(const Color* pixels, unsigned width, unsigned height, unsigned level, unsigned char** pData, unsigned long long* pSize)
+{
+	if (!pixels || !width || !height || !pData || !pSize)
+		return false;
+
+	if (level > 9u)
+		level = 9u;
+
+	const size_t pixel_count = size_t(width) * height;
+
+	// Opaque images are stored without the alpha channel.
+	bool opaque = true;
+	for (size_t i = 0u; i < pixel_count && opaque; i++)
+		opaque = pixels[i].A == 255u;
+
+	const unsigned channels = opaque ? 3u : 4u;
+	const size_t row_length = size_t(width) * channels;
+	const size_t stride = row_length + 1u;
+
+	// Every row picks the filter with the smallest sum of absolute differences, the rows
+	// only depend on the pixels, so they are filtered in parallel.
+	std::vector<uint8_t> filtered(stride * height);
+
+	ThreadPool::parallelFor(height, 16u, [&](unsigned begin, unsigned end, unsigned)
+	{
+		std::vector<uint8_t> current(row_length), previous(row_length), candidate(row_length);
+
+		auto load_row = [&](unsigned y, uint8_t* row)
+		{
+			const Color* in = pixels + size_t(y) * width;
+			if (channels == 4u)
+				for (unsigned x = 0u; x < width; x++, row += 4)
+				{
+					row[0] = in[x].R; row[1] = in[x].G; row[2] = in[x].B; row[3] = in[x].A;
+				}
+			else
+				for (unsigned x = 0u; x < width; x++, row += 3)
+				{
+					row[0] = in[x].R; row[1] = in[x].G; row[2] = in[x].B;
+				}
+		};
+
+		if (begin)
+			load_row(begin - 1u, previous.data());
+
+		for (unsigned y = begin; y < end; y++)
+		{
+			load_row(y, current.data());
+			const uint8_t* up = y ? previous.data() : nullptr;
+			uint8_t* out = filtered.data() + y * stride;
+
+			if (!level)
+			{
+				out[0] = 0u;
+				memcpy(out + 1, current.data(), row_length);
+			}
+			else
+			{
+				uint64_t best_score = ~0ull;
+				for (unsigned filter = 0u; filter < 5u; filter++)
+				{
+					uint64_t score = 0u;
+					for (size_t i = 0u; i < row_length; i++)
+					{
+						const int left = i >= channels ? current[i - channels] : 0;
+						const int above = up ? up[i] : 0;
+						const int corner = up && i >= channels ? up[i - channels] : 0;
+
+						uint8_t prediction = 0u;
+						switch (filter)
+						{
+						case 1u: prediction = uint8_t(left); break;
+						case 2u: prediction = uint8_t(above); break;
+						case 3u: prediction = uint8_t((left + above) >> 1); break;
+						case 4u: prediction = paeth(left, above, corner); break;
+						}
+
+						const uint8_t value = uint8_t(current[i] - prediction);
+						candidate[i] = value;
+						score += value < 128u ? value : 256u - value;
+					}
+
+					if (score < best_score)
+					{
+						best_score = score;
+						out[0] = uint8_t(filter);
+						memcpy(out + 1, candidate.data(), row_length);
+					}
+				}
+			}
+			current.swap(previous);
+		}
+	});
+
+	std::vector<uint8_t> stream;
+	deflate_zlib(filtered.data(), filtered.size(), level, stream);
+	filtered.clear();
+	filtered.shrink_to_fit();
+
+	std::vector<uint8_t> file;
+	file.reserve(stream.size() + 128u);
+
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+	file.insert(file.end(), signature, signature + 8);
+
+	uint8_t header[13];
+	write_be32(header, width);
+	write_be32(header + 4, height);
+	header[8] = 8u;
+	header[9] = opaque ? 2u : 6u;
+	header[10] = header[11] = header[12] = 0u;
+	write_chunk(file, "IHDR", header, 13u);
+
+	// The compressed data is split in chunks of at most a megabyte.
+	for (size_t offset = 0u; offset < stream.size(); offset += DEFLATE_CHUNK)
+		write_chunk(file, "IDAT", stream.data() + offset, stream.size() - offset < DEFLATE_CHUNK ? stream.size() - offset : DEFLATE_CHUNK);
+
+	write_chunk(file, "IEND", nullptr, 0u);
+
+	unsigned char* result = (unsigned char*)malloc(file.size());
+	if (!result)
+		return false;
+
+	memcpy(result, file.data(), file.size());
+	*pData = result;
+	*pSize = file.size();
+	return true;
+}
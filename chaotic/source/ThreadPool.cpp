@@ -0,0 +1,287 @@
+#include "ThreadPool.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Thread Pool Internals
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Whether the current thread is already running a chunk, used to serialize nested calls,
+// and the index of the thread running it, so nested chunks keep the same thread index.
+static thread_local bool inside_pool = false;
+static thread_local unsigned current_thread = 0u;
+
+// Whether the current thread holds the call lock, so that serial jobs can call parallelFor().
+static thread_local bool owns_pool = false;
+
+// Struct that stores the worker threads and the current job of the pool.
+struct ThreadPoolInternals
+{
+	std::thread* workers = nullptr;
+	unsigned n_workers = 0u;
+
+	// Serializes parallelFor() calls from different user threads.
+	std::mutex call_mutex;
+
+	// Protects the job generation and the sleeping workers.
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	unsigned long long generation = 0ull;
+	unsigned busy_workers = 0u;
+	bool quit = false;
+
+	// Current job data.
+	ThreadPool::TASK task = nullptr;
+	void* user_data = nullptr;
+	unsigned count = 0u;
+	unsigned chunk = 0u;
+	std::atomic<unsigned> next = 0u;
+
+	// Takes chunks of the current job until none are left.
+	void run_chunks(unsigned thread)
+	{
+		inside_pool = true;
+		current_thread = thread;
+
+		unsigned begin;
+		while ((begin = next.fetch_add(chunk)) < count)
+			task(begin, (count - begin > chunk) ? begin + chunk : count, thread, user_data);
+
+		inside_pool = false;
+	}
+
+	// Worker loop, sleeps until a new job generation is published.
+	void worker_loop(unsigned thread)
+	{
+		unsigned long long seen = 0ull;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&] { return quit || generation != seen; });
+
+				if (quit)
+					return;
+
+				seen = generation;
+			}
+
+			run_chunks(thread);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy_workers == 0u)
+				done.notify_one();
+		}
+	}
+
+	ThreadPoolInternals()
+	{
+		unsigned hardware = std::thread::hardware_concurrency();
+		n_workers = hardware > 1u ? hardware - 1u : 0u;
+
+		if (!n_workers)
+			return;
+
+		workers = new std::thread[n_workers];
+		for (unsigned i = 0u; i < n_workers; i++)
+			workers[i] = std::thread(&ThreadPoolInternals::worker_loop, this, i + 1u);
+	}
+
+	~ThreadPoolInternals()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wake.notify_all();
+
+		for (unsigned i = 0u; i < n_workers; i++)
+			workers[i].join();
+
+		if (workers)
+			delete[] workers;
+	}
+};
+
+// Returns the pool, created on first use and destroyed at program exit.
+static ThreadPoolInternals& pool()
+{
+	static ThreadPoolInternals internals;
+	return internals;
+}
+
+/*
+-------------------------------------------------------------------------------------------------------
+ Thread Pool Functions
+-------------------------------------------------------------------------------------------------------
+*/
+
+// Returns the number of threads that can run chunks simultaneously, including the
+// calling thread. Thread indices given to the tasks are always smaller than this.
+
+unsigned ThreadPool::threadCount()
+{
+	return pool().n_workers + 1u;
+}
+
+// Splits the range [0, count) in chunks of the size specified and calls the task for
+// every chunk across the pool threads. The call blocks until all chunks are done.
+
+void ThreadPool::parallelFor(unsigned count, unsigned chunk, TASK task, void* user_data)
+{
+	if (!count)
+		return;
+
+	if (!chunk)
+		chunk = 1u;
+
+	ThreadPoolInternals& data = pool();
+
+	// Nested calls run on the calling thread, keeping its thread index.
+	if (inside_pool)
+	{
+		for (unsigned begin = 0u; begin < count; begin += chunk)
+			task(begin, (count - begin > chunk) ? begin + chunk : count, current_thread, user_data);
+		return;
+	}
+
+	// Small jobs also take the call lock, since they use the thread index 0 of the caller.
+	std::unique_lock<std::mutex> call_lock(data.call_mutex, std::defer_lock);
+	if (!owns_pool)
+		call_lock.lock();
+
+	const bool owned = owns_pool;
+	owns_pool = true;
+
+	// Small jobs or single core machines run on the calling thread.
+	if (!data.n_workers || count <= chunk)
+	{
+		for (unsigned begin = 0u; begin < count; begin += chunk)
+			task(begin, (count - begin > chunk) ? begin + chunk : count, 0u, user_data);
+	}
+	else
+	{
+		// Publish the new job, every worker has to acknowledge it.
+		{
+			std::lock_guard<std::mutex> lock(data.mutex);
+			data.task = task;
+			data.user_data = user_data;
+			data.count = count;
+			data.chunk = chunk;
+			data.next = 0u;
+			data.busy_workers = data.n_workers;
+			data.generation++;
+		}
+		data.wake.notify_all();
+
+		// The calling thread also takes chunks.
+		data.run_chunks(0u);
+
+		// Wait for all the workers to finish their last chunk before returning.
+		std::unique_lock<std::mutex> lock(data.mutex);
+		data.done.wait(lock, [&] { return data.busy_workers == 0u; });
+	}
+
+	owns_pool = owned;
+}
+
+// Sorts the keys in ascending order in parallel, moving the values along with them.
+// Least significant digit radix sort, only the lowest key bits specified are sorted,
+// so for example 63 bit Morton codes only need six passes. The sort is stable.
+
+void ThreadPool::radixSort(unsigned long long* keys, unsigned* values, unsigned count, unsigned key_bits)
+{
+	constexpr unsigned RADIX_BITS = 11u;
+	constexpr unsigned RADIX = 1u << RADIX_BITS;
+
+	if (count < 2u)
+		return;
+
+	// Every block counts and scatters its own contiguous range, so the sort stays stable.
+	unsigned blocks = count < 65536u ? 1u : threadCount();
+	unsigned block_size = (count + blocks - 1u) / blocks;
+
+	unsigned* offsets = new unsigned[blocks * RADIX];
+	unsigned long long* tmp_keys = new unsigned long long[count];
+	unsigned* tmp_values = new unsigned[count];
+
+	unsigned long long* src_keys = keys;
+	unsigned long long* dst_keys = tmp_keys;
+	unsigned* src_values = values;
+	unsigned* dst_values = tmp_values;
+
+	for (unsigned shift = 0u; shift < key_bits && shift < 64u; shift += RADIX_BITS)
+	{
+		// Digit histogram of every block.
+		parallelFor(blocks, 1u, [&](unsigned b, unsigned, unsigned)
+		{
+			unsigned* hist = offsets + b * RADIX;
+			for (unsigned d = 0u; d < RADIX; d++)
+				hist[d] = 0u;
+
+			unsigned end = (b + 1u) * block_size < count ? (b + 1u) * block_size : count;
+			for (unsigned i = b * block_size; i < end; i++)
+				hist[(src_keys[i] >> shift) & (RADIX - 1u)]++;
+		});
+
+		// Turn the histograms into output offsets, digit major and block minor.
+		unsigned total = 0u;
+		bool single_digit = false;
+		for (unsigned d = 0u; d < RADIX; d++)
+		{
+			unsigned digit_start = total;
+			for (unsigned b = 0u; b < blocks; b++)
+			{
+				unsigned n = offsets[b * RADIX + d];
+				offsets[b * RADIX + d] = total;
+				total += n;
+			}
+			if (total - digit_start == count)
+				single_digit = true;
+		}
+
+		// All keys share this digit, the pass would not move anything.
+		if (single_digit)
+			continue;
+
+		parallelFor(blocks, 1u, [&](unsigned b, unsigned, unsigned)
+		{
+			unsigned* offset = offsets + b * RADIX;
+
+			unsigned end = (b + 1u) * block_size < count ? (b + 1u) * block_size : count;
+			for (unsigned i = b * block_size; i < end; i++)
+			{
+				unsigned pos = offset[(src_keys[i] >> shift) & (RADIX - 1u)]++;
+				dst_keys[pos] = src_keys[i];
+				dst_values[pos] = src_values[i];
+			}
+		});
+
+		unsigned long long* swap_keys = src_keys; src_keys = dst_keys; dst_keys = swap_keys;
+		unsigned* swap_values = src_values; src_values = dst_values; dst_values = swap_values;
+	}
+
+	// If the sorted data ended on the scratch arrays copy it back.
+	if (src_keys != keys)
+	{
+		parallelFor(count, 65536u, [&](unsigned begin, unsigned end, unsigned)
+		{
+			for (unsigned i = begin; i < end; i++)
+			{
+				keys[i] = src_keys[i];
+				values[i] = src_values[i];
+			}
+		});
+	}
+
+	delete[] offsets;
+	delete[] tmp_keys;
+	delete[] tmp_values;
+}